@@ -0,0 +1,138 @@
+#include "DeviceManagerFactory.h"
+#include "common/TimeSeries.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+/**
+ * @brief 属性历史的基准测试：压缩时间序列每个样本占用的字节数，以及开启历史记录后状态上报的额外开销。
+ *
+ * 第一部分向单条时间序列写入三种典型数据：等间隔的恒定值、带 ±20 毫秒抖动且缓慢变化的温度、完全随机的数值，
+ * 给出每个样本的字节数（原始存储为 16 字节）。第二部分让默认设备管理器中的设备各自上报若干条带两个数值属性的
+ * 状态，对比关闭与开启历史记录时每次上报的耗时，并给出开启时每个样本的平均内存。
+ *
+ * Benchmark of attribute history: bytes per sample of the compressed time series, and the extra cost of
+ * status reports with history enabled. The first part writes three typical series: a constant value at a
+ * regular interval, a slowly drifting temperature with ±20 ms jitter, and fully random values, and prints bytes
+ * per sample (16 bytes raw). The second part has the devices of the default device manager report a number of
+ * statuses with two numeric attributes each, comparing the cost per report with history disabled and enabled,
+ * plus the average memory per sample when enabled.
+ *
+ * 用法 Usage: DeviceHistoryBench [devices] [reports per device]
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-09
+ */
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr long kDEFAULT_DEVICES = 10'000;        // 默认设备数
+constexpr long kDEFAULT_REPORTS = 200;           // 每台设备的默认上报次数
+constexpr int kSERIES_SAMPLES = 1'000'000;       // 压缩测试的样本数
+constexpr int64_t kSTART_MS = 1'750'000'000'000; // 压缩测试的起始时间
+
+/**
+ * @brief 写入一条时间序列并返回每个样本的字节数
+ */
+template <typename Next>
+auto bytesPerSample(Next next) -> double {
+    IOT_NS::TimeSeries series(240);
+    int64_t timestamp = kSTART_MS;
+    for (int i = 0; i < kSERIES_SAMPLES; ++i) {
+        double value = next(timestamp);
+        series.append(timestamp, value);
+    }
+    return static_cast<double>(series.memoryUsage()) / kSERIES_SAMPLES;
+}
+
+/**
+ * @brief 每台设备上报 reports 次，返回每次上报的平均耗时（纳秒）
+ */
+auto ingest(IOT_DEVICE_NS::IDeviceManager& manager, long devices, long reports) -> double {
+    std::vector<IOT_NS::DeviceHandle> handles(devices);
+    for (long i = 0; i < devices; ++i) {
+        manager.registerDevice("dev-" + std::to_string(i), handles[i]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (long r = 0; r < reports; ++r) {
+        std::string temp = std::to_string(20 + r % 7) + ".5";
+        std::string load = std::to_string(r % 100);
+        const IOT_NS::StatusDetails details { { "bench_temp", temp }, { "bench_load", load } };
+        for (long i = 0; i < devices; ++i) {
+            manager.reportStatus(handles[i], "ok", details);
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / static_cast<double>(devices * reports);
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    long devices = argc > 1 ? std::atol(argv[1]) : kDEFAULT_DEVICES;
+    devices = devices > 0 ? devices : kDEFAULT_DEVICES;
+    long reports = argc > 2 ? std::atol(argv[2]) : kDEFAULT_REPORTS;
+    reports = reports > 0 ? reports : kDEFAULT_REPORTS;
+
+    std::mt19937_64 random(46);
+    std::uniform_int_distribution<int> jitter(-20, 20);
+    double regular = bytesPerSample([](int64_t& timestamp) {
+        timestamp += 10'000;
+        return 1.0;
+    });
+    double temperature = 21.5;
+    double drifting = bytesPerSample([&](int64_t& timestamp) {
+        timestamp += 10'000 + jitter(random);
+        temperature += jitter(random) % 3 == 0 ? jitter(random) / 10.0 : 0;
+        return temperature;
+    });
+    std::uniform_real_distribution<double> noise(-1000, 1000);
+    double randomValues = bytesPerSample([&](int64_t& timestamp) {
+        timestamp += 10'000 + jitter(random);
+        return noise(random);
+    });
+
+    // 设备管理器逐条打印上报日志，测量期间关闭标准输出
+    auto* stdoutBuffer = std::cout.rdbuf(nullptr);
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 10min;
+    options.expiryTick = 0ms;
+    double withoutHistory = 0;
+    {
+        auto manager = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+        manager->configure(options);
+        withoutHistory = ingest(*manager, devices, reports);
+        manager->shutdown();
+    }
+    options.historyRetention = 24h;
+    double withHistory = 0;
+    size_t historyBytes = 0;
+    {
+        auto manager = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+        manager->configure(options);
+        withHistory = ingest(*manager, devices, reports);
+        manager->forEachDevice([&historyBytes](const IOT_NS::DeviceSlot& slot) {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            historyBytes += slot.history ? slot.history->memoryUsage() : 0;
+        });
+        manager->shutdown();
+    }
+    std::cout.rdbuf(stdoutBuffer);
+
+    std::printf("regular constant    %8.2f bytes/sample\n", regular);
+    std::printf("drifting, jitter    %8.2f bytes/sample\n", drifting);
+    std::printf("random values       %8.2f bytes/sample\n", randomValues);
+    std::printf("devices x reports   %8ld x %ld\n", devices, reports);
+    std::printf("report, no history  %8.0f ns\n", withoutHistory);
+    std::printf("report, history     %8.0f ns\n", withHistory);
+    std::printf("history memory      %8.2f bytes/sample\n",
+                static_cast<double>(historyBytes) / static_cast<double>(devices * reports * 2));
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "DeviceManagerFactory.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief 二级索引的基准测试：对比按状态计数、按所有者与稀有状态列出设备时，走索引与全表扫描的耗时。
+ *
+ * N 台设备分属 U 个用户，每 1000 台中有 1 台离线。计数只读取按分片维护的计数器，全表扫描则是不带状态条件的
+ * 计数模式列表查询；按所有者列出只遍历该用户的设备列表；列出离线设备遍历离线与在线位图，在线设备只读取心跳时间，
+ * 以找出心跳已超时但尚未被扫描标记的设备。
+ *
+ * Benchmark of the secondary indexes: counting per status, listing one owner's devices and listing a rare
+ * status through the indexes versus a full scan. N devices belong to U users and 1 in 1000 is offline. Counts
+ * only read the per-shard counters while the full scan is a count-only listing that evaluates every device;
+ * listing by owner walks that user's device list and listing offline devices walks the offline and online
+ * bitmaps, reading only the heartbeat of online devices to catch those past their deadline but not swept yet.
+ *
+ * 用法 Usage: DeviceIndexBench [devices] [users]
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-12
+ */
+
+namespace {
+
+constexpr long kDEFAULT_DEVICES = 1'000'000; // 默认设备数
+constexpr long kDEFAULT_USERS = 10'000;      // 默认用户数
+constexpr long kOFFLINE_EVERY = 1000;        // 每多少台设备中有一台离线
+constexpr int kROUNDS = 20;                  // 每项查询的重复次数，取平均
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief 重复执行 kROUNDS 次，返回每次的平均微秒数
+ */
+template <typename Fn>
+auto averageMicros(Fn&& fn) -> double {
+    auto start = Clock::now();
+    for (int round = 0; round < kROUNDS; ++round) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kROUNDS;
+}
+
+/**
+ * @brief 分页列出全部匹配的设备，返回设备数
+ */
+auto listAll(IOT_DEVICE_NS::IDeviceManager& manager, IOT_NS::DeviceQuery query) -> size_t {
+    query.limit = 1000;
+    size_t listed = 0;
+    IOT_NS::DevicePage page;
+    do {
+        manager.listDevices(query, page);
+        listed += page.devices.size();
+        query.cursor = page.nextCursor;
+    } while (!page.nextCursor.empty());
+    return listed;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    long devices = argc > 1 ? std::atol(argv[1]) : kDEFAULT_DEVICES;
+    devices = devices > 0 ? devices : kDEFAULT_DEVICES;
+    long users = argc > 2 ? std::atol(argv[2]) : kDEFAULT_USERS;
+    users = users > 0 ? users : kDEFAULT_USERS;
+
+    auto manager = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = std::chrono::minutes(10);
+    manager->configure(options);
+
+    // 设备管理器逐条打印注册日志，填充期间关闭标准输出
+    auto* stdoutBuffer = std::cout.rdbuf(nullptr);
+    IOT_NS::DeviceHandle handle;
+    for (long i = 0; i < devices; ++i) {
+        auto deviceId = "dev-" + std::to_string(i);
+        manager->registerDevice(deviceId, "user-" + std::to_string(i % users), handle);
+        if (i % kOFFLINE_EVERY == 0) {
+            manager->markDeviceOffline(deviceId);
+        }
+    }
+    std::cout.rdbuf(stdoutBuffer);
+
+    IOT_NS::DeviceCounts counts;
+    double countUs = averageMicros([&]() { manager->countDevices(counts); });
+    IOT_NS::DeviceQuery scan;
+    scan.countOnly = true;
+    IOT_NS::DevicePage page;
+    double scanUs = averageMicros([&]() { manager->listDevices(scan, page); });
+
+    IOT_NS::DeviceQuery byOwner;
+    byOwner.owner = "user-7";
+    size_t owned = 0;
+    double ownerUs = averageMicros([&]() { owned = listAll(*manager, byOwner); });
+
+    IOT_NS::DeviceQuery byStatus;
+    byStatus.status = IOT_NS::DeviceStatus::OFFLINE;
+    size_t offline = 0;
+    double statusUs = averageMicros([&]() { offline = listAll(*manager, byStatus); });
+
+    std::printf("devices             %12ld\n", devices);
+    std::printf("users               %12ld\n", users);
+    std::printf("count (counters)    %12.1f us (%lu online)\n", countUs,
+                static_cast<unsigned long>(counts.of(IOT_NS::DeviceStatus::ONLINE)));
+    std::printf("count (scan)        %12.1f us (%lu devices)\n", scanUs, static_cast<unsigned long>(page.count));
+    std::printf("list by owner       %12.1f us (%zu devices)\n", ownerUs, owned);
+    std::printf("list offline        %12.1f us (%zu devices)\n", statusUs, offline);
+    manager->shutdown();
+    return 0;
+}
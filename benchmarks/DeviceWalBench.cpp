@@ -0,0 +1,128 @@
+#include "DeviceManagerFactory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief 预写日志的基准测试：对比关闭日志与各持久化级别下默认设备管理器的心跳与状态上报吞吐。
+ *
+ * 心跳按句柄刷新，只有在线/离线变化才写日志，因此心跳吞吐应与关闭日志时基本相同；状态上报每条写一条记录。
+ * Sync 级别下每次调用都等待落盘，由多个线程并发上报，体现组提交把并发写入方合并为一次 fdatasync 的效果。
+ *
+ * Benchmark of the write-ahead log: heartbeat and status report throughput of the default device manager with
+ * the log off and at each durability level. Heartbeats refresh by handle and only online/offline transitions
+ * are logged, so heartbeat throughput should match the log-off run; every status report appends one record.
+ * In Sync mode every call waits for durability, so reports come from several threads to show group commit
+ * folding concurrent writers into one fdatasync.
+ *
+ * 用法 Usage: DeviceWalBench [devices] [log directory]
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-07
+ */
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr long kDEFAULT_DEVICES = 100'000;     // 默认设备数
+constexpr long kHEARTBEAT_ROUNDS = 50;         // 心跳轮数，每轮每台设备一次
+constexpr long kREPORTS = 500'000;             // 非 Sync 级别的状态上报条数
+constexpr long kSYNC_REPORTS_PER_THREAD = 500; // Sync 级别每个线程的上报条数
+constexpr int kSYNC_THREADS = 16;              // Sync 级别的并发上报线程数
+
+/**
+ * @brief 每秒操作数
+ */
+auto rate(long operations, std::chrono::steady_clock::time_point start) -> double {
+    return static_cast<double>(operations) /
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief 以一种日志配置运行心跳与状态上报
+ */
+void run(const char* name, std::optional<IOT_NS::WalDurability> durability, long devices, const std::string& dir) {
+    auto manager = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 10min;
+    if (durability) {
+        options.walPath = dir + "/device-wal-bench-" + std::to_string(::getpid()) + ".wal";
+        options.walDurability = *durability;
+        std::filesystem::remove(options.walPath);
+    }
+    manager->configure(options);
+
+    std::vector<IOT_NS::DeviceHandle> handles(static_cast<size_t>(devices));
+    for (long i = 0; i < devices; ++i) {
+        manager->registerDevice("dev-" + std::to_string(i), handles[static_cast<size_t>(i)]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (long round = 0; round < kHEARTBEAT_ROUNDS; ++round) {
+        for (auto handle : handles) {
+            manager->refreshDeviceHeartbeat(handle);
+        }
+    }
+    double heartbeats = rate(kHEARTBEAT_ROUNDS * devices, start);
+
+    const IOT_NS::StatusDetails details { { "bench_temp", "21.5" }, { "bench_mode", "eco" } };
+    long reports = 0;
+    start = std::chrono::steady_clock::now();
+    if (durability == IOT_NS::WalDurability::Sync) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kSYNC_THREADS; ++t) {
+            threads.emplace_back([&, t]() {
+                for (long i = 0; i < kSYNC_REPORTS_PER_THREAD; ++i) {
+                    manager->reportStatus(handles[static_cast<size_t>((t * kSYNC_REPORTS_PER_THREAD + i) % devices)],
+                                          "{\"temp\":21.5}", details);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        reports = kSYNC_THREADS * kSYNC_REPORTS_PER_THREAD;
+    } else {
+        for (; reports < kREPORTS; ++reports) {
+            manager->reportStatus(handles[static_cast<size_t>(reports % devices)], "{\"temp\":21.5}", details);
+        }
+    }
+    double statuses = rate(reports, start);
+
+    manager->shutdown();
+    uint64_t bytes = 0;
+    if (durability) {
+        bytes = std::filesystem::file_size(options.walPath);
+        std::filesystem::remove(options.walPath);
+    }
+    std::printf("%-8s %12.0f heartbeats/s %10.0f reports/s %8.1f MiB logged\n", name, heartbeats, statuses,
+                static_cast<double>(bytes) / (1 << 20));
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    long devices = argc > 1 ? std::atol(argv[1]) : kDEFAULT_DEVICES;
+    devices = devices > 0 ? devices : kDEFAULT_DEVICES;
+    std::string dir = argc > 2 ? argv[2] : std::filesystem::temp_directory_path().string();
+
+    // 设备管理器逐条打印注册与上报日志，测量期间关闭标准输出
+    auto* stdoutBuffer = std::cout.rdbuf(nullptr);
+    run("off", std::nullopt, devices, dir);
+    run("none", IOT_NS::WalDurability::None, devices, dir);
+    run("batched", IOT_NS::WalDurability::Batched, devices, dir);
+    run("sync", IOT_NS::WalDurability::Sync, devices, dir);
+    std::cout.rdbuf(stdoutBuffer);
+    return 0;
+}
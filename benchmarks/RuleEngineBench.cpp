@@ -0,0 +1,94 @@
+#include "RuleEngine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 规则引擎的基准测试：规则数增长时每条状态上报的求值耗时。
+ *
+ * R 条规则分布在 A 个属性上，每条规则是一个阈值比较与一个上升沿（prev）比较的组合，每 4 条规则共用同一个条件；
+ * D 台设备依次上报，每条上报改变 3 个属性的值。属性索引只运行引用了这 3 个属性的规则，
+ * 因此耗时随每个属性上的规则数增长，而不是随规则总数增长。
+ *
+ * Benchmark of the rule engine: evaluation cost per status report as the number of rules grows. R rules are
+ * spread over A attributes, each combining a threshold and a rising-edge (prev) comparison, and every 4 rules
+ * share one condition; D devices report in turn, each report changing 3 attribute values. The attribute index
+ * only runs the rules referencing those 3 attributes, so the cost grows with the rules per attribute rather than
+ * with the total.
+ *
+ * 用法 Usage: RuleEngineBench [rules] [attributes] [devices] [reports]
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-11
+ */
+
+namespace {
+
+constexpr long kDEFAULT_RULES = 5000;      // 默认规则数
+constexpr long kDEFAULT_ATTRIBUTES = 500;  // 默认属性数
+constexpr long kDEFAULT_DEVICES = 10000;   // 默认设备数
+constexpr long kDEFAULT_REPORTS = 1000000; // 默认上报次数
+constexpr int kCHANGED_PER_REPORT = 3;     // 每条上报改变的属性数
+
+using Clock = std::chrono::steady_clock;
+
+auto argument(int argc, char** argv, int index, long fallback) -> long {
+    long value = argc > index ? std::atol(argv[index]) : fallback;
+    return value > 0 ? value : fallback;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    long rules = argument(argc, argv, 1, kDEFAULT_RULES);
+    long attributes = argument(argc, argv, 2, kDEFAULT_ATTRIBUTES);
+    long devices = argument(argc, argv, 3, kDEFAULT_DEVICES);
+    long reports = argument(argc, argv, 4, kDEFAULT_REPORTS);
+
+    std::vector<std::string> sources;
+    for (long r = 0; r < rules; ++r) {
+        auto attribute = "a" + std::to_string(r % attributes);
+        auto threshold = std::to_string(50 + (r / attributes / 4) % 50);
+        sources.push_back("r" + std::to_string(r) + ": " + attribute + " > " + threshold + " && prev(" + attribute +
+                          ") <= " + threshold + " => event");
+    }
+    IOT_NS::RuleEngine engine(sources);
+
+    std::vector<std::string> ids;
+    for (long d = 0; d < devices; ++d) {
+        ids.push_back("dev-" + std::to_string(d));
+    }
+    std::mt19937 random(48);
+    std::uniform_int_distribution<long> pickAttribute(0, attributes - 1);
+    std::uniform_int_distribution<int> pickValue(0, 100);
+    std::vector<IOT_NS::StatusDetails> details(1024);
+    for (auto& report : details) {
+        for (int c = 0; c < kCHANGED_PER_REPORT; ++c) {
+            report.push_back({ "a" + std::to_string(pickAttribute(random)), std::to_string(pickValue(random)) });
+        }
+        report.push_back({ "unreferenced", "1" });
+    }
+
+    std::vector<const IOT_NS::StatusRule*> matched;
+    size_t matches = 0;
+    auto start = Clock::now();
+    for (long n = 0; n < reports; ++n) {
+        matched.clear();
+        matches += engine.evaluate(ids[n % devices], "ok", details[n % details.size()], matched);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(reports);
+
+    std::printf("rules               %10zu\n", engine.rules().size());
+    std::printf("conditions          %10zu\n", engine.conditionCount());
+    std::printf("comparisons         %10zu\n", engine.comparisonCount());
+    std::printf("rules per attribute %10.1f\n", static_cast<double>(rules) / static_cast<double>(attributes));
+    std::printf("reports             %10ld\n", reports);
+    std::printf("matches per report  %10.3f\n", static_cast<double>(matches) / static_cast<double>(reports));
+    std::printf("evaluate            %10.0f ns/report\n", ns);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "StatusAggregator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 状态聚合的基准测试：流式累计每条上报的耗时，以及查询一个窗口的耗时与设备数、分组数的关系。
+ *
+ * N 台设备平均分到 G 个分组，每台设备在一个 1 分钟滚动窗口与一个 5 分钟、步长 1 分钟的滑动窗口内各上报若干次。
+ * 查询只合并窗格中的部分聚合结果，因此耗时随分组数增长，与设备数和上报次数无关。
+ *
+ * Benchmark of status aggregation: cost of accumulating one report, and cost of querying one window versus
+ * the number of devices and groups. N devices are spread evenly over G groups and each reports a few times into
+ * a 1-minute tumbling window and a 5-minute window sliding by 1 minute. Queries only merge the partial
+ * aggregates of the panes, so their cost grows with the groups, not with the devices or reports.
+ *
+ * 用法 Usage: StatusAggregatorBench [devices] [groups] [reports per device]
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-10
+ */
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr long kDEFAULT_DEVICES = 1'000'000;     // 默认设备数
+constexpr long kDEFAULT_GROUPS = 1'000;          // 默认分组数
+constexpr long kDEFAULT_REPORTS = 5;             // 每台设备的默认上报次数
+constexpr int64_t kSTART_MS = 1'750'000'020'000; // 起始时间，恰为 1 分钟窗格的起点
+constexpr int kQUERY_ROUNDS = 20;                // 查询的重复次数，取平均
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+    long devices = argc > 1 ? std::atol(argv[1]) : kDEFAULT_DEVICES;
+    devices = devices > 0 ? devices : kDEFAULT_DEVICES;
+    long groups = argc > 2 ? std::atol(argv[2]) : kDEFAULT_GROUPS;
+    groups = groups > 0 ? groups : kDEFAULT_GROUPS;
+    long reports = argc > 3 ? std::atol(argv[3]) : kDEFAULT_REPORTS;
+    reports = reports > 0 ? reports : kDEFAULT_REPORTS;
+
+    IOT_NS::StatusAggregator aggregator({ { "temp_1m", "temp", 60s }, { "temp_5m", "temp", 300s, 60s } });
+    std::vector<std::string> ids;
+    ids.reserve(devices);
+    for (long i = 0; i < devices; ++i) {
+        ids.push_back("g" + std::to_string(i % groups) + "-" + std::to_string(i));
+    }
+    std::vector<IOT_NS::StatusDetails> details;
+    for (int v = 0; v < 100; ++v) {
+        details.push_back({ { "temp", std::to_string(15 + v % 20) + "." + std::to_string(v % 10) },
+                            { "mode", "eco" } });
+    }
+
+    // 上报均匀分布在 1 分钟内
+    long total = devices * reports;
+    auto start = Clock::now();
+    for (long r = 0; r < reports; ++r) {
+        for (long i = 0; i < devices; ++i) {
+            long n = r * devices + i;
+            aggregator.record(ids[i], details[n % details.size()], kSTART_MS + n * 60000 / total);
+        }
+    }
+    double recordNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / total;
+
+    IOT_NS::AggregateWindow window;
+    double queryMs[2] = {};
+    const char* names[2] = { "temp_1m", "temp_5m" };
+    for (int q = 0; q < 2; ++q) {
+        start = Clock::now();
+        for (int round = 0; round < kQUERY_ROUNDS; ++round) {
+            aggregator.query({ names[q], { 0.5, 0.99 } }, window, kSTART_MS + 60000);
+        }
+        queryMs[q] = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kQUERY_ROUNDS;
+    }
+
+    std::printf("devices x reports   %10ld x %ld\n", devices, reports);
+    std::printf("groups              %10zu\n", window.groups.size());
+    std::printf("record              %10.0f ns/report\n", recordNs);
+    std::printf("query tumbling 1m   %10.2f ms\n", queryMs[0]);
+    std::printf("query sliding 5m    %10.2f ms\n", queryMs[1]);
+    return 0;
+}
@@ -0,0 +1,103 @@
+import argparse
+import time
+
+import grpc
+
+import iot_service_pb2
+import iot_service_pb2_grpc
+
+
+class StatusIngestBench:
+    """
+    状态上报吞吐对比：逐条 reportStatus、单次请求批量 reportStatuses、客户端流 reportStatusBatch。
+    三种方式上报相同数量、相同内容的状态，输出每秒受理的条目数。
+    """
+
+    def __init__(self, server_addr, user_id, auth_token, devices, total, batch_size):
+        self.user_id = user_id
+        self.auth_token = auth_token
+        self.devices = [f"bench-device-{i}" for i in range(devices)]
+        self.total = total
+        self.batch_size = batch_size
+        self._channel = grpc.insecure_channel(server_addr)
+        self._stub = iot_service_pb2_grpc.IoTServiceStub(self._channel)
+
+    def _status(self, i):
+        return iot_service_pb2.DeviceStatus(
+            device_id=self.devices[i % len(self.devices)],
+            status='{"temp": 36.5}',
+            timestamp=int(time.time() * 1000)
+        )
+
+    def _batches(self):
+        for start in range(0, self.total, self.batch_size):
+            end = min(start + self.batch_size, self.total)
+            yield iot_service_pb2.DeviceStatusBatch(
+                user_id=self.user_id,
+                auth_token=self.auth_token,
+                statuses=[self._status(i) for i in range(start, end)]
+            )
+
+    def register_devices(self):
+        """
+        通过一个网关帧注册全部设备，避免批量上报因设备未注册而被拒绝
+        """
+        frame = iot_service_pb2.GatewayFrame(
+            user_id=self.user_id,
+            auth_token=self.auth_token,
+            devices=[iot_service_pb2.GatewayDevice(index=i, device_id=d) for i, d in enumerate(self.devices)]
+        )
+        for ack in self._stub.gatewaySession(iter([frame])):
+            print(f"[Register] code={ack.code}, accepted={ack.accepted}, rejected={ack.rejected}")
+
+    def run_unary(self):
+        accepted = 0
+        for i in range(self.total):
+            request = self._status(i)
+            request.user_id = self.user_id
+            request.auth_token = self.auth_token
+            if self._stub.reportStatus(request).code == 0:
+                accepted += 1
+        return accepted
+
+    def run_repeated(self):
+        return sum(self._stub.reportStatuses(batch).accepted for batch in self._batches())
+
+    def run_stream(self):
+        return self._stub.reportStatusBatch(self._batches()).accepted
+
+    def measure(self, name, func):
+        begin = time.perf_counter()
+        accepted = func()
+        elapsed = time.perf_counter() - begin
+        print(f"{name:<10} {self.total / elapsed:>12.0f} items/s  accepted={accepted}/{self.total}  "
+              f"elapsed={elapsed:.3f}s")
+
+    def close(self):
+        self._channel.close()
+
+
+# ---- 主程序 ----
+
+def main():
+    parser = argparse.ArgumentParser(description="IoT status ingest throughput: unary vs batched")
+    parser.add_argument("--server", default="localhost:50051")
+    parser.add_argument("--user", default="user42")
+    parser.add_argument("--token", default="token123")
+    parser.add_argument("--devices", type=int, default=1000)
+    parser.add_argument("--total", type=int, default=20000)
+    parser.add_argument("--batch", type=int, default=500)
+    args = parser.parse_args()
+
+    bench = StatusIngestBench(args.server, args.user, args.token, args.devices, args.total, args.batch)
+    try:
+        bench.register_devices()
+        bench.measure("unary", bench.run_unary)
+        bench.measure("repeated", bench.run_repeated)
+        bench.measure("stream", bench.run_stream)
+    finally:
+        bench.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "NameSpaceDef.h"
+#include <mutex>
+#include <optional>
+#include <utility>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 合并槽位，最新写入者覆盖尚未处理的旧值
+ *
+ * Coalescing slot where the last writer replaces a value that has not been processed yet.
+ * 生产者调用 offer() 写入新值，只有槽位从空变为非空时才需要调度一次处理；
+ * 处理方调用 take() 取走最新值并清空槽位。每个槽位最多对应一个排队中的处理任务，
+ * 因此积压量受槽位数量约束，而不是消息速率。
+ * Producers call offer(); only the transition from empty to occupied requires scheduling a processing
+ * step. The consumer calls take() to grab the newest value and empty the slot. Each slot has at most one
+ * queued processing step, so the backlog is bounded by the number of slots rather than the message rate.
+ *
+ * 线程安全。
+ * Thread-safe.
+ *
+ * @tparam T 槽位中保存的值类型 Type of the value held by the slot
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-27
+ */
+template <typename T>
+class CoalescingSlot {
+public:
+    /**
+     * @brief 写入新值，覆盖尚未处理的旧值
+     *
+     * Store a new value, replacing an unprocessed one.
+     *
+     * @param value 新值 New value
+     * @return true  槽位原本为空，调用方需要调度一次处理 The slot was empty; the caller must schedule processing
+     * @return false 旧值被原地替换，已有处理在排队 An older value was replaced in place; processing is already queued
+     */
+    auto offer(T value) -> bool {
+        std::lock_guard<std::mutex> lock(mMutex);
+        bool wasEmpty = !mValue.has_value();
+        mValue = std::move(value);
+        return wasEmpty;
+    }
+
+    /**
+     * @brief 写入新值，槽位中已有未处理的旧值时用合并函数把新值并入旧值
+     *
+     * Store a new value; when an unprocessed one is pending, fold the new value into it with the merge function.
+     *
+     * @param value 新值 New value
+     * @param merge 合并函数 merge(pending, value) Function folding value into the pending one
+     * @return true  槽位原本为空，调用方需要调度一次处理 The slot was empty; the caller must schedule processing
+     * @return false 新值已并入旧值，已有处理在排队 Merged into the pending value; processing is already queued
+     */
+    template <typename Merge>
+    auto offer(T value, Merge&& merge) -> bool {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mValue.has_value()) {
+            mValue = std::move(value);
+            return true;
+        }
+        merge(*mValue, std::move(value));
+        return false;
+    }
+
+    /**
+     * @brief 取走最新值并清空槽位
+     *
+     * Take the newest value and empty the slot.
+     *
+     * @return std::optional<T> 最新值，槽位为空时返回 std::nullopt Newest value, or std::nullopt when empty
+     */
+    auto take() -> std::optional<T> {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::optional<T> value = std::move(mValue);
+        mValue.reset();
+        return value;
+    }
+
+private:
+    std::mutex mMutex;       // 保护槽位 Guards the slot
+    std::optional<T> mValue; // 待处理的最新值 Newest pending value
+};
+
+IOT_NS_END
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "NameSpaceDef.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 可合并的分位数草图，给出相对误差有界的分位数
+ *
+ * Mergeable quantile sketch with bounded relative error.
+ * 按对数划分桶：值 x 落入下标为 ceil(log(|x|) / log(gamma)) 的桶，gamma = (1 + a) / (1 - a)，a 为相对精度，
+ * 每个桶只记录计数，因此任意分位数的估计值与真实值的相对误差不超过 a。正负值各用一组桶，绝对值极小的值计为 0。
+ * 两个相同精度的草图按桶相加即可合并，合并结果与把全部样本写入同一个草图完全相同，适合各线程各自累计后再汇总。
+ * Values fall into logarithmic buckets: x goes to index ceil(log(|x|) / log(gamma)) with
+ * gamma = (1 + a) / (1 - a) for a relative accuracy a, and each bucket only keeps a count, so every quantile
+ * estimate is within a relative error a of the true value. Positive and negative values have their own
+ * buckets and values of negligible magnitude count as 0. Two sketches of the same accuracy merge by adding
+ * bucket counts, with exactly the result of writing every sample into one sketch, so threads can accumulate
+ * their own and combine them later.
+ *
+ * 桶数只与数值跨越的数量级有关：精度 1% 时从 0.001 到 10^6 约 1000 个桶。非线程安全。
+ * The number of buckets only depends on the orders of magnitude spanned: about 1000 from 0.001 to 10^6 at 1%
+ * accuracy. Not thread-safe.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-10
+ */
+class QuantileSketch {
+public:
+    static constexpr double kDEFAULT_ACCURACY = 0.01; // 默认相对精度 Default relative accuracy
+
+    /**
+     * @brief 构造函数
+     *
+     * Constructor.
+     *
+     * @param relativeAccuracy 相对精度，取值 (0, 1) Relative accuracy in (0, 1)
+     */
+    explicit QuantileSketch(double relativeAccuracy = kDEFAULT_ACCURACY)
+        : mGamma((1 + relativeAccuracy) / (1 - relativeAccuracy)), mLogGamma(std::log(mGamma)) {}
+
+    /**
+     * @brief 加入一个样本，NaN 被忽略
+     *
+     * Add a sample; NaN is ignored.
+     *
+     * @param value 样本值 Sample value
+     */
+    void add(double value) {
+        if (std::isnan(value)) {
+            return;
+        }
+        if (std::fabs(value) < kMIN_MAGNITUDE) {
+            ++mZero;
+        } else if (value > 0) {
+            ++mPositive[index(value)];
+        } else {
+            ++mNegative[index(-value)];
+        }
+        ++mCount;
+    }
+
+    /**
+     * @brief 合并另一个相同精度的草图
+     *
+     * Merge another sketch of the same accuracy.
+     *
+     * @param other 另一个草图 Other sketch
+     */
+    void merge(const QuantileSketch& other) {
+        for (const auto& [bucket, count] : other.mPositive) {
+            mPositive[bucket] += count;
+        }
+        for (const auto& [bucket, count] : other.mNegative) {
+            mNegative[bucket] += count;
+        }
+        mZero += other.mZero;
+        mCount += other.mCount;
+    }
+
+    /**
+     * @brief 估计分位数
+     *
+     * Estimate a quantile.
+     *
+     * @param q 分位点，取值 [0, 1] Quantile in [0, 1]
+     * @return double 估计值，没有样本时为 NaN Estimate, NaN without samples
+     */
+    [[nodiscard]]
+    auto quantile(double q) const -> double {
+        if (mCount == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        q = std::fmin(std::fmax(q, 0.0), 1.0);
+        auto rank = static_cast<uint64_t>(q * static_cast<double>(mCount - 1));
+        uint64_t seen = 0;
+        // 负值按绝对值从大到小，即从最小的值开始
+        for (auto it = mNegative.rbegin(); it != mNegative.rend(); ++it) {
+            seen += it->second;
+            if (seen > rank) {
+                return -value(it->first);
+            }
+        }
+        seen += mZero;
+        if (seen > rank) {
+            return 0;
+        }
+        for (const auto& [bucket, count] : mPositive) {
+            seen += count;
+            if (seen > rank) {
+                return value(bucket);
+            }
+        }
+        return value(mPositive.rbegin()->first);
+    }
+
+    /**
+     * @brief 样本数量
+     *
+     * Number of samples.
+     */
+    [[nodiscard]]
+    auto count() const -> uint64_t {
+        return mCount;
+    }
+
+private:
+    static constexpr double kMIN_MAGNITUDE = 1e-9; // 小于该绝对值的样本计为 0 Magnitudes below this count as 0
+
+    auto index(double magnitude) const -> int32_t {
+        return static_cast<int32_t>(std::ceil(std::log(magnitude) / mLogGamma));
+    }
+
+    /**
+     * @brief 桶的代表值，与桶内任意值的相对误差不超过精度
+     *
+     * Representative value of a bucket, within the relative accuracy of every value in it.
+     */
+    auto value(int32_t bucket) const -> double {
+        return 2 * std::pow(mGamma, bucket) / (mGamma + 1);
+    }
+
+    double mGamma;                         // 相邻桶边界之比 Ratio between adjacent bucket bounds
+    double mLogGamma;                      // log(gamma)
+    std::map<int32_t, uint64_t> mPositive; // 正值的桶计数 Bucket counts of positive values
+    std::map<int32_t, uint64_t> mNegative; // 负值（按绝对值）的桶计数 Bucket counts of negative values by magnitude
+    uint64_t mZero = 0;                    // 计为 0 的样本数 Samples counted as 0
+    uint64_t mCount = 0;                   // 样本总数 Total samples
+};
+
+IOT_NS_END
@@ -2,6 +2,7 @@
 
 #include "NameSpaceDef.h"
 #include <functional>
+#include <iterator>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
@@ -38,6 +39,18 @@ public:
     ShardedMap()
         : mShards(SHARD_COUNT) {}
 
+    /**
+     * @brief 构造函数，按运行时配置的分片数初始化
+     *
+     * Constructor using a shard count chosen at runtime (e.g. from the server configuration).
+     * 分片数为 0 时退回 SHARD_COUNT。
+     * A shard count of 0 falls back to SHARD_COUNT.
+     *
+     * @param shardCount 分片数 Number of shards
+     */
+    explicit ShardedMap(size_t shardCount)
+        : mShards(shardCount > 0 ? shardCount : SHARD_COUNT) {}
+
     /**
      * @brief 插入或更新键值对
      *
@@ -76,6 +89,60 @@ public:
         return std::nullopt;
     }
 
+    /**
+     * @brief 查询键对应的值，不存在时用工厂函数创建并插入
+     *
+     * Get the value for the key, creating and inserting it with the factory if absent.
+     * 线程安全，查询与插入在同一次分片加锁内完成。
+     * Thread-safe, lookup and insertion happen under a single shard lock.
+     *
+     * @param key     需要查询的键 Key to query
+     * @param factory 键不存在时用于创建值的函数 Function creating the value when absent
+     * @return Value 已存在或新创建的值 Existing or newly created value
+     */
+    template <typename Factory>
+    auto getOrInsert(const Key& key, Factory&& factory) -> Value {
+        auto& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        auto it = shard.mMap.find(key);
+        if (it == shard.mMap.end()) {
+            it = shard.mMap.emplace(key, factory()).first;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief 在一次分片加锁内对同一分片的一批键执行查询或插入
+     *
+     * Look up or insert a batch of keys that all belong to one shard under a single shard lock.
+     * 每个键都必须落在 shardIndex 指定的分片（见 shardIndexOf）；工厂函数与访问函数都在持锁状态下执行，不能访问本映射。
+     * Every key must map to the shard at shardIndex (see shardIndexOf); the factory and the visitor run under the
+     * shard lock and must not call back into this map.
+     *
+     * @param shardIndex 分片下标 Shard index
+     * @param items      批次中的条目 Entries of the batch
+     * @param keyOf      从条目取出键的函数 Function returning the key of an entry
+     * @param factory    键不存在时用于创建值的函数，参数为条目 Function creating the value of an absent entry
+     * @param visitor    访问函数，参数为条目、已存在或新创建的值以及是否新插入
+     *                   Visitor invoked as visitor(entry, value, inserted)
+     */
+    template <typename Items, typename KeyOf, typename Factory, typename Visitor>
+    void getOrInsertMany(size_t shardIndex, const Items& items, KeyOf&& keyOf, Factory&& factory,
+                         Visitor&& visitor) {
+        auto& shard = mShards[shardIndex];
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        shard.mMap.reserve(shard.mMap.size() + std::size(items));
+        for (const auto& item : items) {
+            const Key& key = keyOf(item);
+            auto it = shard.mMap.find(key);
+            bool inserted = it == shard.mMap.end();
+            if (inserted) {
+                it = shard.mMap.emplace(key, factory(item)).first;
+            }
+            visitor(item, it->second, inserted);
+        }
+    }
+
     /**
      * @brief 删除指定键的元素
      *
@@ -93,6 +160,31 @@ public:
         return shard.mMap.erase(key) > 0;
     }
 
+    /**
+     * @brief 在条件成立时删除指定键的元素
+     *
+     * Remove the element with the given key if the predicate holds for its value.
+     * 判断与删除在同一次分片加锁内完成，期间不会有并发的 getOrInsert 取到该值；判断函数不能访问本映射。
+     * The check and the removal share one shard lock, so no concurrent getOrInsert can hand out the value in
+     * between; the predicate must not call back into this map.
+     *
+     * @param key       要删除的键 Key to remove
+     * @param predicate 判断函数，参数为当前值 Predicate invoked as predicate(value)
+     * @return true 删除成功，false 键不存在或条件不成立
+     * True if an element was removed, false if not found or the predicate failed.
+     */
+    template <typename Predicate>
+    auto eraseIf(const Key& key, Predicate&& predicate) -> bool {
+        auto& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        auto it = shard.mMap.find(key);
+        if (it == shard.mMap.end() || !predicate(it->second)) {
+            return false;
+        }
+        shard.mMap.erase(it);
+        return true;
+    }
+
     /**
      * @brief 判断是否包含指定键
      *
@@ -125,6 +217,66 @@ public:
         }
     }
 
+    /**
+     * @brief 遍历所有键值对
+     *
+     * Visit every key-value pair.
+     * 逐个分片加锁遍历，同一时刻只锁住一个分片；访问函数在持锁状态下执行，必须短小且不能访问本映射。
+     * Shards are locked one at a time; the visitor runs under the shard lock, so it must be short and must not
+     * call back into this map.
+     *
+     * @param visitor 访问函数 Visitor invoked as visitor(key, value)
+     */
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        for (const auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mMutex);
+            for (const auto& [key, value] : shard.mMap) {
+                visitor(key, value);
+            }
+        }
+    }
+
+    /**
+     * @brief 元素总数
+     *
+     * Total number of elements.
+     * 逐个分片加锁累加，并发修改时结果只是近似值。
+     * Shards are locked one at a time, so the total is only approximate under concurrent updates.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        size_t total = 0;
+        for (const auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mMutex);
+            total += shard.mMap.size();
+        }
+        return total;
+    }
+
+    /**
+     * @brief 分片数量
+     *
+     * Number of shards.
+     */
+    [[nodiscard]]
+    auto shardCount() const -> size_t {
+        return mShards.size();
+    }
+
+    /**
+     * @brief 键所在分片的下标
+     *
+     * Index of the shard holding the key.
+     *
+     * @param key 输入键 Key
+     * @return size_t 分片下标 Shard index
+     */
+    [[nodiscard]]
+    auto shardIndexOf(const Key& key) const -> size_t {
+        return std::hash<Key> {}(key) % mShards.size();
+    }
+
 private:
     /**
      * @brief 单个分片，包含一个互斥锁和一个unordered_map
@@ -147,8 +299,7 @@ private:
      * @return Shard& 返回对应分片的引用 Reference to the shard
      */
     auto getShard(const Key& key) -> Shard& {
-        size_t hash = std::hash<Key> {}(key);
-        return mShards[hash % SHARD_COUNT];
+        return mShards[shardIndexOf(key)];
     }
 
     /**
@@ -161,8 +312,7 @@ private:
      */
     [[nodiscard]]
     auto getShard(const Key& key) const -> const Shard& {
-        size_t hash = std::hash<Key> {}(key);
-        return mShards[hash % SHARD_COUNT];
+        return mShards[shardIndexOf(key)];
     }
 };
 
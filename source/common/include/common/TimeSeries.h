@@ -0,0 +1,420 @@
+#pragma once
+
+#include "NameSpaceDef.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 压缩的时间序列数据块，固定样本数上限
+ *
+ * Compressed time-series chunk holding up to a fixed number of samples.
+ * 采用 Gorilla 编码：时间戳（Unix 毫秒）存二阶差分，等间隔上报时每个样本只占 1 位，抖动在几十毫秒内时占 9 位；
+ * 数值与上一个样本按位异或，相同时占 1 位，否则只写出异或结果中有效位所在的窗口。典型的传感器数据每个样本
+ * 只需 1 到 4 字节。
+ * Gorilla encoding: timestamps (Unix milliseconds) are stored as deltas of deltas, so a regular reporting
+ * interval costs 1 bit per sample and jitter of a few tens of milliseconds 9 bits; values are XORed with the
+ * previous sample, costing 1 bit when unchanged and otherwise only the window of meaningful XOR bits. Typical
+ * sensor data takes 1 to 4 bytes per sample.
+ *
+ * 只能按时间顺序追加，早于上一个样本的时间戳按上一个样本的时间记录。非线程安全。
+ * Append-only in time order; a timestamp older than the previous sample is recorded at the previous sample's
+ * time. Not thread-safe.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-09
+ */
+class TimeSeriesChunk {
+public:
+    /**
+     * @brief 构造函数
+     *
+     * Constructor.
+     *
+     * @param capacity 样本数上限 Maximum number of samples
+     */
+    explicit TimeSeriesChunk(uint16_t capacity) : mCapacity(capacity) {}
+
+    /**
+     * @brief 追加一个样本
+     *
+     * Append a sample.
+     *
+     * @param timestampMs 时间戳（Unix 毫秒） Timestamp in Unix milliseconds
+     * @param value       样本值 Sample value
+     * @return bool       数据块已满时返回 false Whether the sample fit; false once the chunk is full
+     */
+    auto append(int64_t timestampMs, double value) -> bool {
+        if (mCount >= mCapacity) {
+            return false;
+        }
+        auto bits = std::bit_cast<uint64_t>(value);
+        if (mCount == 0) {
+            writeBits(static_cast<uint64_t>(timestampMs), 64);
+            writeBits(bits, 64);
+            mFirstTimestamp = timestampMs;
+        } else {
+            timestampMs = std::max(timestampMs, mLastTimestamp);
+            int64_t delta = timestampMs - mLastTimestamp;
+            writeDeltaOfDelta(delta - mLastDelta);
+            writeXor(bits ^ mLastValue);
+            mLastDelta = delta;
+        }
+        mLastTimestamp = timestampMs;
+        mLastValue = bits;
+        ++mCount;
+        return true;
+    }
+
+    /**
+     * @brief 释放编码缓冲区的多余容量，数据块写满后调用
+     *
+     * Release the spare capacity of the encoding buffer; called once the chunk is full.
+     */
+    void seal() {
+        mWords.shrink_to_fit();
+    }
+
+    /**
+     * @brief 按时间顺序解码所有样本
+     *
+     * Decode every sample in time order.
+     *
+     * @param visitor 访问函数 visitor(int64_t timestampMs, double value) Visitor
+     */
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        BitReader reader { mWords.data() };
+        int64_t timestamp = 0;
+        int64_t delta = 0;
+        uint64_t value = 0;
+        uint32_t leading = 0;
+        uint32_t trailing = 0;
+        for (uint32_t i = 0; i < mCount; ++i) {
+            if (i == 0) {
+                timestamp = static_cast<int64_t>(reader.read(64));
+                value = reader.read(64);
+            } else {
+                delta += readDeltaOfDelta(reader);
+                timestamp += delta;
+                if (reader.read(1) != 0) {
+                    if (reader.read(1) != 0) {
+                        leading = static_cast<uint32_t>(reader.read(5));
+                        uint32_t length = static_cast<uint32_t>(reader.read(6)) + 1;
+                        trailing = 64 - leading - length;
+                    }
+                    value ^= reader.read(64 - leading - trailing) << trailing;
+                }
+            }
+            visitor(timestamp, std::bit_cast<double>(value));
+        }
+    }
+
+    /**
+     * @brief 样本数量
+     *
+     * Number of samples.
+     */
+    [[nodiscard]]
+    auto size() const -> uint32_t {
+        return mCount;
+    }
+
+    /**
+     * @brief 第一个样本的时间戳
+     *
+     * Timestamp of the first sample.
+     */
+    [[nodiscard]]
+    auto firstTimestamp() const -> int64_t {
+        return mFirstTimestamp;
+    }
+
+    /**
+     * @brief 最后一个样本的时间戳
+     *
+     * Timestamp of the last sample.
+     */
+    [[nodiscard]]
+    auto lastTimestamp() const -> int64_t {
+        return mLastTimestamp;
+    }
+
+    /**
+     * @brief 占用的内存（字节，按容量计，含对象本身）
+     *
+     * Memory held, in bytes, by capacity and including the object itself.
+     */
+    [[nodiscard]]
+    auto memoryUsage() const -> size_t {
+        return sizeof(*this) + mWords.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    /**
+     * @brief 从高位开始的顺序位读取器
+     *
+     * Sequential bit reader, most significant bit first.
+     */
+    struct BitReader {
+        const uint64_t* words;
+        uint64_t position = 0;
+
+        auto read(uint32_t count) -> uint64_t {
+            if (count == 0) {
+                return 0;
+            }
+            auto offset = static_cast<uint32_t>(position % 64);
+            const uint64_t* word = words + position / 64;
+            uint32_t room = 64 - offset;
+            uint64_t high = *word << offset;
+            uint64_t result = high >> (64 - count);
+            if (count > room) {
+                result |= word[1] >> (64 - (count - room));
+            }
+            position += count;
+            return result;
+        }
+    };
+
+    /**
+     * @brief 写入一个值的低 count 位，从高位开始
+     *
+     * Write the low count bits of a value, most significant bit first.
+     */
+    void writeBits(uint64_t value, uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        if (count < 64) {
+            value &= (uint64_t { 1 } << count) - 1;
+        }
+        auto offset = static_cast<uint32_t>(mBits % 64);
+        if (offset == 0) {
+            mWords.push_back(0);
+        }
+        uint32_t room = 64 - offset;
+        if (count <= room) {
+            mWords.back() |= value << (room - count);
+        } else {
+            mWords.back() |= value >> (count - room);
+            mWords.push_back(value << (64 - (count - room)));
+        }
+        mBits += count;
+    }
+
+    /**
+     * @brief 写入时间戳的二阶差分：'0'，或前缀加 7 / 9 / 12 位偏移值，超出范围时写完整的 64 位
+     *
+     * Write a timestamp delta of delta: '0', or a prefix and a 7, 9 or 12-bit biased value, or all 64 bits when
+     * out of range.
+     */
+    void writeDeltaOfDelta(int64_t dod) {
+        if (dod == 0) {
+            writeBits(0b0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            writeBits(0b10, 2);
+            writeBits(static_cast<uint64_t>(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            writeBits(0b110, 3);
+            writeBits(static_cast<uint64_t>(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            writeBits(0b1110, 4);
+            writeBits(static_cast<uint64_t>(dod + 2047), 12);
+        } else {
+            writeBits(0b1111, 4);
+            writeBits(static_cast<uint64_t>(dod), 64);
+        }
+    }
+
+    static auto readDeltaOfDelta(BitReader& reader) -> int64_t {
+        if (reader.read(1) == 0) {
+            return 0;
+        }
+        if (reader.read(1) == 0) {
+            return static_cast<int64_t>(reader.read(7)) - 63;
+        }
+        if (reader.read(1) == 0) {
+            return static_cast<int64_t>(reader.read(9)) - 255;
+        }
+        if (reader.read(1) == 0) {
+            return static_cast<int64_t>(reader.read(12)) - 2047;
+        }
+        return static_cast<int64_t>(reader.read(64));
+    }
+
+    /**
+     * @brief 写入与上一个值的异或结果：'0' 表示相同；'10' 沿用上一个有效位窗口；'11' 加 5 位前导零数与
+     *        6 位有效位长度定义新窗口
+     *
+     * Write the XOR with the previous value: '0' when equal, '10' to reuse the previous window of meaningful
+     * bits, '11' with a 5-bit leading zero count and a 6-bit length to define a new window.
+     */
+    void writeXor(uint64_t bits) {
+        if (bits == 0) {
+            writeBits(0b0, 1);
+            return;
+        }
+        auto leading = std::min<uint32_t>(static_cast<uint32_t>(std::countl_zero(bits)), 31);
+        auto trailing = static_cast<uint32_t>(std::countr_zero(bits));
+        if (mLeading <= 64 && leading >= mLeading && trailing >= mTrailing) {
+            writeBits(0b10, 2);
+            writeBits(bits >> mTrailing, 64 - mLeading - mTrailing);
+            return;
+        }
+        uint32_t length = 64 - leading - trailing;
+        writeBits(0b11, 2);
+        writeBits(leading, 5);
+        writeBits(length - 1, 6);
+        writeBits(bits >> trailing, length);
+        mLeading = static_cast<uint8_t>(leading);
+        mTrailing = static_cast<uint8_t>(trailing);
+    }
+
+    std::vector<uint64_t> mWords; // 编码后的位流 Encoded bit stream
+    int64_t mFirstTimestamp = 0;  // 第一个样本的时间戳 First timestamp
+    int64_t mLastTimestamp = 0;   // 上一个样本的时间戳 Previous timestamp
+    int64_t mLastDelta = 0;       // 上一个时间间隔 Previous timestamp delta
+    uint64_t mLastValue = 0;      // 上一个样本值的位模式 Bits of the previous value
+    uint32_t mBits = 0;           // 已写入的位数 Bits written
+    uint16_t mCount = 0;          // 样本数量 Number of samples
+    uint16_t mCapacity;           // 样本数上限 Maximum number of samples
+    uint8_t mLeading = 0xFF;      // 当前有效位窗口的前导零数，0xFF 表示尚无窗口 Leading zeros of the window
+    uint8_t mTrailing = 0;        // 当前有效位窗口的末尾零数 Trailing zeros of the window
+};
+
+/**
+ * @brief 由压缩数据块组成的时间序列，按保留时长整块淘汰
+ *
+ * Time series made of compressed chunks, expired a whole chunk at a time.
+ * 只有最后一个数据块可写；写满后释放多余容量并开始新块。淘汰只丢弃最后一个样本早于保留起点的整块，
+ * 因此查询时仍需按时间过滤。
+ * Only the last chunk is writable; a full chunk gives back its spare capacity and a new one starts. Expiry only
+ * drops chunks whose last sample is older than the retention start, so reads still filter by time.
+ *
+ * 非线程安全，由调用方加锁。
+ * Not thread-safe; callers lock around it.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-09
+ */
+class TimeSeries {
+public:
+    /**
+     * @brief 构造函数
+     *
+     * Constructor.
+     *
+     * @param chunkSamples 每个数据块的样本数 Samples per chunk
+     */
+    explicit TimeSeries(uint16_t chunkSamples) : mChunkSamples(std::max<uint16_t>(chunkSamples, 2)) {}
+
+    /**
+     * @brief 追加一个样本
+     *
+     * Append a sample.
+     *
+     * @param timestampMs 时间戳（Unix 毫秒） Timestamp in Unix milliseconds
+     * @param value       样本值 Sample value
+     */
+    void append(int64_t timestampMs, double value) {
+        if (!mChunks.empty()) {
+            timestampMs = std::max(timestampMs, mChunks.back().lastTimestamp());
+            if (mChunks.back().append(timestampMs, value)) {
+                return;
+            }
+            mChunks.back().seal();
+        }
+        mChunks.emplace_back(mChunkSamples);
+        mChunks.back().append(timestampMs, value);
+    }
+
+    /**
+     * @brief 丢弃最后一个样本早于指定时间的数据块
+     *
+     * Drop the chunks whose last sample is older than a time.
+     *
+     * @param oldestMs 保留的最早时间（Unix 毫秒） Oldest time kept, in Unix milliseconds
+     */
+    void expire(int64_t oldestMs) {
+        auto keep = std::find_if(mChunks.begin(), mChunks.end(), [oldestMs](const TimeSeriesChunk& chunk) {
+            return chunk.lastTimestamp() >= oldestMs;
+        });
+        mChunks.erase(mChunks.begin(), keep);
+    }
+
+    /**
+     * @brief 按时间顺序访问时间范围内的样本，只解码与范围相交的数据块
+     *
+     * Visit the samples in a time range in order, decoding only the chunks overlapping it.
+     *
+     * @param fromMs  起始时间（含） Range start, inclusive
+     * @param toMs    结束时间（含） Range end, inclusive
+     * @param visitor 访问函数 visitor(int64_t timestampMs, double value) Visitor
+     */
+    template <typename Visitor>
+    void range(int64_t fromMs, int64_t toMs, Visitor&& visitor) const {
+        for (const auto& chunk : mChunks) {
+            if (chunk.lastTimestamp() < fromMs) {
+                continue;
+            }
+            if (chunk.firstTimestamp() > toMs) {
+                break;
+            }
+            chunk.forEach([&](int64_t timestamp, double value) {
+                if (timestamp >= fromMs && timestamp <= toMs) {
+                    visitor(timestamp, value);
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief 是否没有任何样本
+     *
+     * Whether there are no samples.
+     */
+    [[nodiscard]]
+    auto empty() const -> bool {
+        return mChunks.empty();
+    }
+
+    /**
+     * @brief 样本数量
+     *
+     * Number of samples.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        size_t samples = 0;
+        for (const auto& chunk : mChunks) {
+            samples += chunk.size();
+        }
+        return samples;
+    }
+
+    /**
+     * @brief 占用的堆内存（字节，按容量计）
+     *
+     * Heap memory held, in bytes, by capacity.
+     */
+    [[nodiscard]]
+    auto memoryUsage() const -> size_t {
+        size_t bytes = (mChunks.capacity() - mChunks.size()) * sizeof(TimeSeriesChunk);
+        for (const auto& chunk : mChunks) {
+            bytes += chunk.memoryUsage();
+        }
+        return bytes;
+    }
+
+private:
+    uint16_t mChunkSamples;               // 每个数据块的样本数 Samples per chunk
+    std::vector<TimeSeriesChunk> mChunks; // 按时间排列的数据块 Chunks in time order
+};
+
+IOT_NS_END
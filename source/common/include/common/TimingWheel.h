@@ -0,0 +1,155 @@
+#pragma once
+
+#include "NameSpaceDef.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 哈希时间轮，用于大量定时器的 O(1) 调度与到期处理
+ *
+ * A hashed timing wheel providing O(1) scheduling and expiry processing for large numbers of timers.
+ * 定时器按到期 tick 散列到环形槽位中，推进时只访问经过的槽位，开销与到期（及跨圈）条目数成正比，
+ * 与定时器总数无关。不支持显式取消：调用方在到期回调中自行判断条目是否仍然有效（惰性取消）。
+ * Timers hash into ring slots by their deadline tick; advancing only visits the slots that elapsed, so the
+ * cost is proportional to expiring (and wrapping) entries rather than to the total number of timers. There is
+ * no explicit cancel: callers check in the expiry callback whether an entry is still current (lazy cancel).
+ *
+ * 非线程安全，由调用方加锁或限定在单一线程中使用。
+ * Not thread-safe; callers either lock around it or confine it to one thread.
+ *
+ * @tparam T 定时器携带的数据类型 Payload type carried by each timer
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-24
+ */
+template <typename T>
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 构造函数
+     *
+     * Constructor.
+     *
+     * @param tick      每个槽位代表的时间粒度 Time granularity of one slot
+     * @param slotCount 槽位数量 Number of slots in the ring
+     * @param start     时间轮起始时间点 Time point the wheel starts at
+     */
+    TimingWheel(std::chrono::milliseconds tick, size_t slotCount, Clock::time_point start = Clock::now())
+        : mTick(tick), mStart(start), mSlots(slotCount) {}
+
+    /**
+     * @brief 添加定时器
+     *
+     * Schedule a timer.
+     * 已过期的到期时间会在下一次推进时立即触发。
+     * Deadlines already in the past fire on the next advance.
+     *
+     * @param deadline 到期时间点 Deadline
+     * @param value    定时器携带的数据 Timer payload
+     */
+    void schedule(Clock::time_point deadline, T value) {
+        int64_t tick = std::max(toTick(deadline, true), mCurrentTick + 1);
+        mSlots[static_cast<size_t>(tick) % mSlots.size()].push_back(Entry { tick, std::move(value) });
+        ++mSize;
+    }
+
+    /**
+     * @brief 推进时间轮到指定时间点，并对所有到期的定时器调用回调
+     *
+     * Advance the wheel to the given time point and invoke the callback for every expired timer.
+     *
+     * @param now      当前时间点 Current time point
+     * @param onExpire 到期回调，参数为定时器数据 Expiry callback receiving the payload
+     * @return size_t  本次触发的定时器数量 Number of timers fired
+     */
+    template <typename Callback>
+    auto advance(Clock::time_point now, Callback&& onExpire) -> size_t {
+        int64_t target = toTick(now, false);
+        size_t fired = 0;
+        // 一次推进超过一整圈时，每个槽位只需访问一次
+        int64_t first = std::max(mCurrentTick + 1, target - static_cast<int64_t>(mSlots.size()) + 1);
+        for (int64_t tick = first; tick <= target; ++tick) {
+            auto& slot = mSlots[static_cast<size_t>(tick) % mSlots.size()];
+            size_t keep = 0;
+            for (size_t i = 0; i < slot.size(); ++i) {
+                if (slot[i].tick <= target) {
+                    mExpired.push_back(std::move(slot[i].value));
+                } else {
+                    if (keep != i) {
+                        slot[keep] = std::move(slot[i]);
+                    }
+                    ++keep;
+                }
+            }
+            slot.resize(keep);
+        }
+        mCurrentTick = std::max(mCurrentTick, target);
+
+        // 回调在遍历结束后执行，允许回调中重新调度定时器
+        for (auto& value : mExpired) {
+            --mSize;
+            ++fired;
+            onExpire(value);
+        }
+        mExpired.clear();
+        return fired;
+    }
+
+    /**
+     * @brief 当前挂起的定时器数量
+     *
+     * Number of pending timers.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        return mSize;
+    }
+
+private:
+    /**
+     * @brief 单个定时器条目
+     *
+     * A single timer entry.
+     */
+    struct Entry {
+        int64_t tick; // 到期 tick Deadline tick
+        T value;      // 定时器数据 Timer payload
+    };
+
+    /**
+     * @brief 将时间点换算为 tick
+     *
+     * Convert a time point to a tick.
+     * 到期时间向上取整、推进时间向下取整，保证定时器不会提前触发。
+     * Deadlines round up and advance targets round down, so timers never fire early.
+     *
+     * @param tp      时间点 Time point
+     * @param roundUp 是否向上取整 Whether to round up
+     */
+    [[nodiscard]]
+    auto toTick(Clock::time_point tp, bool roundUp) const -> int64_t {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(tp - mStart).count();
+        auto tick = mTick.count();
+        if (elapsed <= 0) {
+            return 0;
+        }
+        return roundUp ? (elapsed + tick - 1) / tick : elapsed / tick;
+    }
+
+    std::chrono::milliseconds mTick;        // 槽位时间粒度 Slot granularity
+    Clock::time_point mStart;               // 起始时间点 Start time point
+    std::vector<std::vector<Entry>> mSlots; // 环形槽位 Ring of slots
+    std::vector<T> mExpired;                // 到期条目暂存 Scratch buffer for expired payloads
+    int64_t mCurrentTick = 0;               // 已推进到的 tick Tick the wheel has advanced to
+    size_t mSize = 0;                       // 挂起的定时器数量 Number of pending timers
+};
+
+IOT_NS_END
@@ -0,0 +1,459 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+IOT_NS_BEGIN
+
+using AttributeKey = uint16_t;                                          // 驻留后的属性键 / Interned attribute key
+using AttributeValue = std::variant<double, bool, std::string>;         // 数值、布尔或字符串属性值 / Typed attribute value
+using StatusDetails = std::vector<std::pair<std::string, std::string>>; // 上报的原始键值对 / Raw reported key-value pairs
+
+/**
+ * @brief 属性键驻留表：属性名到紧凑整数键的全局映射
+ *        Attribute key interner: process-wide mapping from attribute name to a compact integer key.
+ *
+ * 同一属性名在所有设备之间只存一份，设备上只保存 2 字节的键。已存在的键只加读锁查找；
+ * 键的总数有上限，防止客户端用随机属性名无限占用内存，超出上限的新属性被丢弃。
+ * Each attribute name is stored once for the whole fleet and devices keep only a 2-byte key. Existing keys are
+ * looked up under a shared lock. The number of keys is capped so that clients cannot grow the table without
+ * bound with random names; new attributes past the cap are dropped.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-05
+ */
+class AttributeKeys {
+public:
+    static constexpr size_t kMAX_KEYS = 4096; // 属性键数量上限 / Maximum number of distinct keys
+
+    /**
+     * @brief 全局实例
+     *        Process-wide instance.
+     */
+    static auto instance() -> AttributeKeys& {
+        static AttributeKeys keys;
+        return keys;
+    }
+
+    /**
+     * @brief 查找或登记属性名
+     *        Look up or register an attribute name.
+     *
+     * @param name 属性名 / Attribute name
+     * @return std::optional<AttributeKey> 属性键，名称为空或已达上限时为空 / Key, empty if the name is empty or the
+     *         table is full
+     */
+    auto intern(std::string_view name) -> std::optional<AttributeKey> {
+        if (name.empty()) {
+            return std::nullopt;
+        }
+        if (auto key = find(name)) {
+            return key;
+        }
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        auto it = mKeys.find(name);
+        if (it != mKeys.end()) {
+            return it->second;
+        }
+        if (mNames.size() >= kMAX_KEYS) {
+            return std::nullopt;
+        }
+        auto key = static_cast<AttributeKey>(mNames.size());
+        mNames.emplace_back(name);
+        mKeys.emplace(mNames.back(), key);
+        return key;
+    }
+
+    /**
+     * @brief 只查找不登记，用于查询条件中的属性名
+     *        Look up without registering, for attribute names in query filters.
+     *
+     * @param name 属性名 / Attribute name
+     * @return std::optional<AttributeKey> 属性键，未登记时为空 / Key, empty if never registered
+     */
+    [[nodiscard]]
+    auto find(std::string_view name) const -> std::optional<AttributeKey> {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        auto it = mKeys.find(name);
+        if (it == mKeys.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief 属性键对应的属性名，引用在进程生命周期内有效
+     *        Name of a key; the reference stays valid for the lifetime of the process.
+     *
+     * @param key 属性键 / Attribute key
+     */
+    [[nodiscard]]
+    auto name(AttributeKey key) const -> const std::string& {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        return mNames.at(key);
+    }
+
+private:
+    AttributeKeys() = default;
+
+    mutable std::shared_mutex mMutex;                         // 保护驻留表 / Guards the table
+    std::deque<std::string> mNames;                           // 按键排列的属性名，地址稳定 / Names by key, stable addresses
+    std::unordered_map<std::string_view, AttributeKey> mKeys; // 指向 mNames 的属性名到键 / Name (into mNames) to key
+};
+
+/**
+ * @brief 将上报的字符串值解析为类型化的属性值
+ *        Parse a reported string into a typed attribute value.
+ *
+ * "true" / "false" 解析为布尔值，完整的十进制数解析为数值，其余按字符串保存。
+ * "true" / "false" become booleans, a complete decimal number becomes a number, anything else stays a string.
+ *
+ * @param raw 上报的字符串值 / Reported string value
+ * @return AttributeValue 类型化的属性值 / Typed value
+ */
+inline auto parseAttributeValue(std::string_view raw) -> AttributeValue {
+    if (raw == "true") {
+        return true;
+    }
+    if (raw == "false") {
+        return false;
+    }
+    double number = 0;
+    const char* end = raw.data() + raw.size();
+    auto [last, ec] = std::from_chars(raw.data(), end, number);
+    if (!raw.empty() && ec == std::errc {} && last == end) {
+        return number;
+    }
+    return std::string(raw);
+}
+
+/**
+ * @brief 将属性值格式化为字符串，数值使用最短的往返表示
+ *        Format an attribute value as a string, numbers in their shortest round-trip form.
+ *
+ * @param value 属性值 / Attribute value
+ * @return std::string 字符串表示 / String form
+ */
+inline auto formatAttributeValue(const AttributeValue& value) -> std::string {
+    if (const auto* number = std::get_if<double>(&value)) {
+        char buffer[32];
+        auto [last, ec] = std::to_chars(buffer, buffer + sizeof(buffer), *number);
+        return ec == std::errc {} ? std::string(buffer, last) : std::string();
+    }
+    if (const auto* flag = std::get_if<bool>(&value)) {
+        return *flag ? "true" : "false";
+    }
+    return std::get<std::string>(value);
+}
+
+/**
+ * @brief 单个属性的增量更新，值为空表示删除该属性
+ *        Partial update of one attribute; an empty value removes it.
+ */
+struct AttributeUpdate {
+    AttributeKey key = 0;                // 属性键 / Attribute key
+    std::optional<AttributeValue> value; // 新值，为空表示删除 / New value, empty to remove
+};
+
+/**
+ * @brief 设备的结构化状态属性
+ *        Structured status attributes of one device.
+ *
+ * 属性按键有序存放在紧凑的条目数组中，每个条目固定 16 字节：2 字节键、类型标记、以及数值、布尔或字符串位置；
+ * 所有字符串值连续存放在同一块缓冲区里。与 std::map<std::string, std::string> 相比，既没有树节点与每个键的
+ * 字符串对象，也没有每个条目的独立堆分配。更新只合并变化的键，长度不增加的字符串原地覆盖，
+ * 缓冲区中的失效字节超过一半时整体压缩。
+ * Attributes live in a compact array of fixed 16-byte entries sorted by key: a 2-byte key, a type tag and the
+ * number, boolean or string position. All string values share one contiguous buffer. Compared with
+ * std::map<std::string, std::string> there are no tree nodes, no per-key string objects and no per-entry heap
+ * allocation. Updates only merge the keys that changed; a string that does not grow is overwritten in place,
+ * and the buffer is compacted once more than half of it is stale.
+ *
+ * 非线程安全，由设备槽位的互斥锁保护。
+ * Not thread-safe; guarded by the device slot mutex.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-05
+ */
+class DeviceAttributes {
+public:
+    /**
+     * @brief 合并一组增量更新
+     *        Merge a set of partial updates.
+     *
+     * @param updates 增量更新，按顺序应用 / Partial updates, applied in order
+     * @return bool 是否有属性发生变化 / Whether any attribute changed
+     */
+    auto apply(const std::vector<AttributeUpdate>& updates) -> bool {
+        bool changed = false;
+        for (const auto& update : updates) {
+            changed = (update.value ? set(update.key, *update.value) : erase(update.key)) || changed;
+        }
+        compactIfStale();
+        return changed;
+    }
+
+    /**
+     * @brief 读取属性值
+     *        Read an attribute.
+     *
+     * @param key 属性键 / Attribute key
+     * @return std::optional<AttributeValue> 属性值，不存在时为空 / Value, empty if absent
+     */
+    [[nodiscard]]
+    auto get(AttributeKey key) const -> std::optional<AttributeValue> {
+        auto it = lowerBound(key);
+        if (it == mEntries.end() || it->key != key) {
+            return std::nullopt;
+        }
+        return valueOf(*it);
+    }
+
+    /**
+     * @brief 读取可参与数值比较的属性值，布尔值按 1 / 0 处理
+     *        Read an attribute usable in numeric comparisons; booleans read as 1 / 0.
+     *
+     * @param key 属性键 / Attribute key
+     * @return std::optional<double> 数值，不存在或为字符串时为空 / Number, empty if absent or a string
+     */
+    [[nodiscard]]
+    auto number(AttributeKey key) const -> std::optional<double> {
+        auto it = lowerBound(key);
+        if (it == mEntries.end() || it->key != key) {
+            return std::nullopt;
+        }
+        switch (it->type) {
+        case Type::Number:
+            return it->payload.number;
+        case Type::Bool:
+            return it->payload.flag ? 1.0 : 0.0;
+        case Type::String:
+            break;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 按键的顺序遍历所有属性
+     *        Visit every attribute in key order.
+     *
+     * @param visitor 访问函数 visitor(AttributeKey, AttributeValue) / Visitor
+     */
+    template <typename Visitor>
+    void forEach(Visitor&& visitor) const {
+        for (const auto& entry : mEntries) {
+            visitor(entry.key, valueOf(entry));
+        }
+    }
+
+    /**
+     * @brief 属性数量
+     *        Number of attributes.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        return mEntries.size();
+    }
+
+    /**
+     * @brief 是否没有任何属性
+     *        Whether there are no attributes.
+     */
+    [[nodiscard]]
+    auto empty() const -> bool {
+        return mEntries.empty();
+    }
+
+    /**
+     * @brief 属性占用的堆内存（字节，按容量计）
+     *        Heap memory held by the attributes, in bytes, by capacity.
+     */
+    [[nodiscard]]
+    auto memoryUsage() const -> size_t {
+        constexpr size_t kSSO_CAPACITY = 15; // 短字符串优化容量，不占用堆 / Capacity kept inline by std::string
+        return mEntries.capacity() * sizeof(Entry) + (mText.capacity() > kSSO_CAPACITY ? mText.capacity() + 1 : 0);
+    }
+
+private:
+    static constexpr uint32_t kMIN_COMPACT_BYTES = 64; // 失效字节少于该值时不压缩 / Stale bytes tolerated before compacting
+
+    enum class Type : uint8_t { Number, Bool, String };
+
+    /**
+     * @brief 紧凑的属性条目
+     *        Compact attribute entry.
+     */
+    struct Entry {
+        AttributeKey key = 0;     // 属性键 / Attribute key
+        Type type = Type::Number; // 值类型 / Value type
+        uint32_t length = 0;      // 字符串长度 / String length
+        union {
+            double number;
+            bool flag;
+            uint32_t offset; // 字符串在缓冲区中的位置 / String offset in the buffer
+        } payload {};
+    };
+    static_assert(sizeof(Entry) == 16, "attribute entries must stay compact");
+
+    [[nodiscard]]
+    auto lowerBound(AttributeKey key) const -> std::vector<Entry>::const_iterator {
+        return std::lower_bound(mEntries.begin(), mEntries.end(), key,
+                                [](const Entry& entry, AttributeKey k) { return entry.key < k; });
+    }
+
+    [[nodiscard]]
+    auto valueOf(const Entry& entry) const -> AttributeValue {
+        switch (entry.type) {
+        case Type::Number:
+            return entry.payload.number;
+        case Type::Bool:
+            return entry.payload.flag;
+        case Type::String:
+            break;
+        }
+        return mText.substr(entry.payload.offset, entry.length);
+    }
+
+    [[nodiscard]]
+    auto textOf(const Entry& entry) const -> std::string_view {
+        return std::string_view(mText).substr(entry.payload.offset, entry.length);
+    }
+
+    /**
+     * @brief 写入单个属性
+     *        Store one attribute.
+     *
+     * @return bool 值是否发生变化 / Whether the value changed
+     */
+    auto set(AttributeKey key, const AttributeValue& value) -> bool {
+        auto index = static_cast<size_t>(lowerBound(key) - mEntries.begin());
+        bool exists = index < mEntries.size() && mEntries[index].key == key;
+        Entry* old = exists ? &mEntries[index] : nullptr;
+
+        Entry entry;
+        entry.key = key;
+        if (const auto* number = std::get_if<double>(&value)) {
+            if (old && old->type == Type::Number && old->payload.number == *number) {
+                return false;
+            }
+            entry.type = Type::Number;
+            entry.payload.number = *number;
+        } else if (const auto* flag = std::get_if<bool>(&value)) {
+            if (old && old->type == Type::Bool && old->payload.flag == *flag) {
+                return false;
+            }
+            entry.type = Type::Bool;
+            entry.payload.flag = *flag;
+        } else {
+            const auto& text = std::get<std::string>(value);
+            if (old && old->type == Type::String && textOf(*old) == text) {
+                return false;
+            }
+            entry.type = Type::String;
+            entry.length = static_cast<uint32_t>(text.size());
+            if (old && old->type == Type::String && old->length >= text.size()) {
+                // 不变长的字符串原地覆盖 / A string that does not grow is overwritten in place
+                entry.payload.offset = old->payload.offset;
+                mText.replace(old->payload.offset, text.size(), text);
+                mStale += old->length - entry.length;
+                *old = entry;
+                return true;
+            }
+            entry.payload.offset = static_cast<uint32_t>(mText.size());
+            mText.append(text);
+        }
+
+        if (old) {
+            if (old->type == Type::String) {
+                mStale += old->length;
+            }
+            *old = entry;
+        } else {
+            mEntries.insert(mEntries.begin() + static_cast<std::ptrdiff_t>(index), entry);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 删除单个属性
+     *        Remove one attribute.
+     *
+     * @return bool 属性是否存在 / Whether the attribute existed
+     */
+    auto erase(AttributeKey key) -> bool {
+        auto it = lowerBound(key);
+        if (it == mEntries.end() || it->key != key) {
+            return false;
+        }
+        if (it->type == Type::String) {
+            mStale += it->length;
+        }
+        mEntries.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief 失效字节超过缓冲区一半时重建字符串缓冲区
+     *        Rebuild the string buffer once more than half of it is stale.
+     */
+    void compactIfStale() {
+        if (mStale < kMIN_COMPACT_BYTES || mStale * 2 < mText.size()) {
+            return;
+        }
+        std::string text;
+        text.reserve(mText.size() - mStale);
+        for (auto& entry : mEntries) {
+            if (entry.type == Type::String) {
+                auto offset = static_cast<uint32_t>(text.size());
+                text.append(textOf(entry));
+                entry.payload.offset = offset;
+            }
+        }
+        mText = std::move(text);
+        mStale = 0;
+    }
+
+    std::vector<Entry> mEntries; // 按键排序的属性条目 / Entries sorted by key
+    std::string mText;           // 所有字符串值的缓冲区 / Buffer of all string values
+    uint32_t mStale = 0;         // 缓冲区中的失效字节数 / Stale bytes in the buffer
+};
+
+/**
+ * @brief 驻留属性名并解析上报的键值对；值为空字符串表示删除该属性
+ *        Intern names and parse reported key-value pairs; an empty value removes the attribute.
+ *
+ * 属性键已达上限时新的属性名被丢弃。
+ * New names are dropped once the key table is full.
+ *
+ * @param details 上报的键值对 / Reported key-value pairs
+ * @return std::vector<AttributeUpdate> 增量更新 / Partial updates
+ */
+inline auto toAttributeUpdates(const StatusDetails& details) -> std::vector<AttributeUpdate> {
+    std::vector<AttributeUpdate> updates;
+    updates.reserve(details.size());
+    auto& keys = AttributeKeys::instance();
+    for (const auto& [name, raw] : details) {
+        auto key = raw.empty() ? keys.find(name) : keys.intern(name);
+        if (!key) {
+            continue;
+        }
+        updates.push_back({ *key, raw.empty() ? std::nullopt : std::optional(parseAttributeValue(raw)) });
+    }
+    return updates;
+}
+
+IOT_NS_END
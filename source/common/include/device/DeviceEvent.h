@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceInfo.h"
+#include <chrono>
+#include <functional>
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 设备状态变化事件
+ *        Event describing a device state transition.
+ *
+ * 设备管理器只在状态真正发生变化时（如离线→在线、上报内容改变）发出事件，普通心跳与内容不变的上报不会产生事件。
+ * Device managers only emit events on real transitions (e.g. offline→online, a changed status report); plain
+ * heartbeats and unchanged reports produce none.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-22
+ */
+struct DeviceEvent {
+    /**
+     * @brief 事件类型
+     *        Event type.
+     */
+    enum class Type {
+        Online,        // 设备上线 / Device came online
+        Offline,       // 设备离线 / Device went offline
+        StatusChanged, // 上报的状态内容发生变化 / Reported status payload changed
+        Resync,        // 批量导入等一次改变了大量设备，监听方应重新读取注册表，deviceId 为空 / Many devices changed
+                       // at once (bulk import); listeners should re-read the registry, deviceId is empty
+    };
+
+    Type type;                                       // 事件类型 / Event type
+    std::string deviceId;                            // 设备唯一标识符 / Device ID
+    DeviceStatus status;                             // 变化后的状态 / Status after the transition
+    std::chrono::steady_clock::time_point timestamp; // 事件发生时间 / Time of the transition
+    std::string report;                              // 新的状态上报内容，仅 StatusChanged 携带 / New status report, StatusChanged only
+    std::string owner;                               // 设备所有者，为空表示尚未绑定 / Device owner, empty when unbound
+};
+
+/**
+ * @brief 设备事件监听器类型
+ *        Listener invoked for each device event.
+ */
+using DeviceEventListener = std::function<void(const DeviceEvent&)>;
+
+IOT_NS_END
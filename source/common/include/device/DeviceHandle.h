@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <cstdint>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 设备句柄：设备注册时分配的稠密 32 位编号
+ *        Device handle: a dense 32-bit number assigned when a device registers.
+ *
+ * 句柄在设备管理器的生命周期内保持不变。会话与流在建立时解析一次句柄，之后按句柄直接定位设备，
+ * 不再对设备 ID 做哈希与字符串比较。使用强类型枚举，避免与计数、下标等普通整数混用。
+ * A handle stays valid for the lifetime of the device manager. Sessions and streams resolve it once when they
+ * open and then reach the device directly by handle, with no hashing or string compare of the device ID. It is
+ * a scoped enum so it never mixes with counts, indexes and other plain integers.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-05
+ */
+enum class DeviceHandle : uint32_t {};
+
+/// 无效句柄，表示设备未注册或设备管理器不支持句柄 / Invalid handle: device unknown or handles unsupported
+inline constexpr DeviceHandle kINVALID_DEVICE_HANDLE { UINT32_MAX };
+
+/**
+ * @brief 句柄是否有效
+ *        Whether a handle is valid.
+ */
+constexpr auto isValid(DeviceHandle handle) -> bool {
+    return handle != kINVALID_DEVICE_HANDLE;
+}
+
+/**
+ * @brief 句柄对应的稠密下标
+ *        Dense index of a handle.
+ */
+constexpr auto toIndex(DeviceHandle handle) -> uint32_t {
+    return static_cast<uint32_t>(handle);
+}
+
+IOT_NS_END
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "common/TimeSeries.h"
+#include "device/DeviceAttributes.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 设备数值属性的历史
+ *        History of the numeric attributes of one device.
+ *
+ * 每个属性一条压缩的时间序列，按属性键有序存放；布尔值按 1 / 0 记录，字符串属性不记录。
+ * 非线程安全，由设备槽位的互斥锁保护，因此状态上报在写入属性的同一次加锁内追加样本，不需要额外的锁。
+ * One compressed time series per attribute, kept sorted by attribute key; booleans are recorded as 1 / 0 and
+ * string attributes are not recorded. Not thread-safe: guarded by the device slot mutex, so a status report
+ * appends its samples under the same lock that stores its attributes, with no extra lock.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-09
+ */
+class DeviceHistory {
+public:
+    /**
+     * @brief 记录一个属性样本
+     *        Record one attribute sample.
+     *
+     * @param key 属性键 / Attribute key
+     * @param timestampMs 时间戳（Unix 毫秒）/ Timestamp in Unix milliseconds
+     * @param value 样本值 / Sample value
+     * @param chunkSamples 新建序列时每个数据块的样本数 / Samples per chunk when a series is created
+     */
+    void record(AttributeKey key, int64_t timestampMs, double value, uint16_t chunkSamples) {
+        auto it = lowerBound(key);
+        if (it == mSeries.end() || it->first != key) {
+            it = mSeries.emplace(it, key, TimeSeries(chunkSamples));
+        }
+        it->second.append(timestampMs, value);
+    }
+
+    /**
+     * @brief 淘汰早于保留起点的数据块，并移除已清空的序列
+     *        Expire chunks older than the retention start and drop series left empty.
+     *
+     * @param oldestMs 保留的最早时间（Unix 毫秒）/ Oldest time kept, in Unix milliseconds
+     */
+    void expire(int64_t oldestMs) {
+        for (auto& [key, series] : mSeries) {
+            series.expire(oldestMs);
+        }
+        std::erase_if(mSeries, [](const auto& entry) { return entry.second.empty(); });
+    }
+
+    /**
+     * @brief 查找属性的时间序列
+     *        Find the time series of an attribute.
+     *
+     * @param key 属性键 / Attribute key
+     * @return const TimeSeries* 时间序列，没有记录时为 nullptr / The series, nullptr if never recorded
+     */
+    [[nodiscard]]
+    auto find(AttributeKey key) const -> const TimeSeries* {
+        auto it = std::lower_bound(mSeries.begin(), mSeries.end(), key,
+                                   [](const auto& entry, AttributeKey k) { return entry.first < k; });
+        return it != mSeries.end() && it->first == key ? &it->second : nullptr;
+    }
+
+    /**
+     * @brief 是否没有任何序列
+     *        Whether no series is recorded.
+     */
+    [[nodiscard]]
+    auto empty() const -> bool {
+        return mSeries.empty();
+    }
+
+    /**
+     * @brief 占用的堆内存（字节，按容量计）
+     *        Heap memory held, in bytes, by capacity.
+     */
+    [[nodiscard]]
+    auto memoryUsage() const -> size_t {
+        size_t bytes = mSeries.capacity() * sizeof(mSeries[0]);
+        for (const auto& [key, series] : mSeries) {
+            bytes += series.memoryUsage();
+        }
+        return bytes;
+    }
+
+private:
+    auto lowerBound(AttributeKey key) -> std::vector<std::pair<AttributeKey, TimeSeries>>::iterator {
+        return std::lower_bound(mSeries.begin(), mSeries.end(), key,
+                                [](const auto& entry, AttributeKey k) { return entry.first < k; });
+    }
+
+    std::vector<std::pair<AttributeKey, TimeSeries>> mSeries; // 按属性键排序的序列 / Series sorted by attribute key
+};
+
+IOT_NS_END
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceRegistration.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 批量导入设备的文件格式：CSV 与二进制
+ *        File formats for bulk device import: CSV and binary.
+ *
+ * CSV 每行一个设备 `设备ID[,所有者]`，字段两端的空白与行尾的 \r 被忽略；空行、`#` 开头的行以及以 `device_id`
+ * 开头的表头行被跳过。二进制文件以 8 字节魔数开头，之后每个设备依次为 u16 ID 长度、ID、u16 所有者长度、所有者，
+ * 整数按本机字节序存储，解析时无需逐字符扫描。
+ *
+ * CSV holds one device per line as `device_id[,owner]`; whitespace around fields and a trailing \r are ignored,
+ * and blank lines, lines starting with `#` and a header line starting with `device_id` are skipped. A binary
+ * file starts with an 8-byte magic, then each device as a u16 ID length, the ID, a u16 owner length and the
+ * owner, integers in host byte order, so parsing never scans characters.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-13
+ */
+class DeviceImportFile {
+public:
+    /// @brief 二进制文件的魔数 / Magic at the start of a binary file
+    static constexpr std::string_view kMAGIC { "IOTDEV01", 8 };
+
+    /**
+     * @brief 解析 CSV 文本
+     *        Parse CSV text.
+     *
+     * @param text CSV 文本
+     * @param out 追加解析出的设备
+     * @return size_t 字段多于两个而跳过的行数 Lines skipped for having more than two fields
+     */
+    static auto parseCsv(std::string_view text, std::vector<DeviceRegistration>& out) -> size_t {
+        size_t malformed = 0;
+        bool first = true;
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            auto line = trim(text.substr(0, eol));
+            text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+            bool header = first && line.substr(0, 9) == "device_id";
+            first = false;
+            if (line.empty() || line.front() == '#' || header) {
+                continue;
+            }
+            size_t comma = line.find(',');
+            if (comma == std::string_view::npos) {
+                out.push_back({ std::string(line), {} });
+            } else if (line.find(',', comma + 1) != std::string_view::npos) {
+                ++malformed;
+            } else {
+                out.push_back({ std::string(trim(line.substr(0, comma))), std::string(trim(line.substr(comma + 1))) });
+            }
+        }
+        return malformed;
+    }
+
+    /**
+     * @brief 解析二进制数据
+     *        Parse binary data.
+     *
+     * @param data 二进制文件内容
+     * @param out 追加解析出的设备
+     * @return true 成功；false 魔数不符或数据被截断，截断前的设备仍会追加
+     *         false if the magic is missing or the data is truncated; devices before the cut are still appended
+     */
+    static auto parseBinary(std::string_view data, std::vector<DeviceRegistration>& out) -> bool {
+        if (data.substr(0, kMAGIC.size()) != kMAGIC) {
+            return false;
+        }
+        data.remove_prefix(kMAGIC.size());
+        std::string_view id;
+        std::string_view owner;
+        while (!data.empty()) {
+            if (!takeField(data, id) || !takeField(data, owner)) {
+                return false;
+            }
+            out.push_back({ std::string(id), std::string(owner) });
+        }
+        return true;
+    }
+
+    /**
+     * @brief 将设备编码为二进制文件内容
+     *        Encode devices as the content of a binary file.
+     *
+     * @param devices 设备，ID 与所有者都不能超过 65535 字节
+     * @return std::string 二进制文件内容
+     */
+    static auto encodeBinary(const std::vector<DeviceRegistration>& devices) -> std::string {
+        std::string data(kMAGIC);
+        for (const auto& device : devices) {
+            putField(data, device.deviceId);
+            putField(data, device.owner);
+        }
+        return data;
+    }
+
+    /**
+     * @brief 读取文件，以魔数区分二进制与 CSV
+     *        Read a file, telling binary from CSV by the magic.
+     *
+     * @param path 文件路径
+     * @param out 追加读取出的设备
+     * @param malformed 输出跳过的 CSV 行数
+     * @return true 成功；false 文件无法读取或二进制数据被截断
+     */
+    static auto load(const std::string& path, std::vector<DeviceRegistration>& out, size_t& malformed) -> bool {
+        malformed = 0;
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (std::string_view(data).substr(0, kMAGIC.size()) == kMAGIC) {
+            return parseBinary(data, out);
+        }
+        malformed = parseCsv(data, out);
+        return true;
+    }
+
+private:
+    /**
+     * @brief 去掉两端的空白与 \r
+     */
+    static auto trim(std::string_view text) -> std::string_view {
+        constexpr std::string_view kSPACE = " \t\r";
+        size_t begin = text.find_first_not_of(kSPACE);
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        return text.substr(begin, text.find_last_not_of(kSPACE) - begin + 1);
+    }
+
+    /**
+     * @brief 读取一个带 u16 长度前缀的字段
+     */
+    static auto takeField(std::string_view& data, std::string_view& field) -> bool {
+        uint16_t length = 0;
+        if (data.size() < sizeof(length)) {
+            return false;
+        }
+        std::memcpy(&length, data.data(), sizeof(length));
+        if (data.size() - sizeof(length) < length) {
+            return false;
+        }
+        field = data.substr(sizeof(length), length);
+        data.remove_prefix(sizeof(length) + length);
+        return true;
+    }
+
+    /**
+     * @brief 写入一个带 u16 长度前缀的字段
+     */
+    static void putField(std::string& data, const std::string& field) {
+        auto length = static_cast<uint16_t>(field.size());
+        data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        data.append(field.data(), length);
+    }
+};
+
+IOT_NS_END
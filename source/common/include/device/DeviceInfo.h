@@ -1,7 +1,9 @@
 #pragma once
 
 #include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
 #include <chrono>
+#include <cstddef>
 #include <string>
 
 IOT_NS_BEGIN
@@ -24,6 +26,9 @@ enum class DeviceStatus {
     ERROR = 3    // 设备状态错误 / Device is in an error state
 };
 
+/// @brief 设备状态的取值个数，按状态分组的计数与索引以状态值为下标 / Number of statuses, indexing per-status tables
+constexpr size_t kDEVICE_STATUS_COUNT = 4;
+
 /**
  * @brief 设备信息结构体
  *        Structure holding the state and metadata of a device.
@@ -40,6 +45,8 @@ struct DeviceInfo {
     DeviceStatus status = DeviceStatus::UNKNOWN;         // 当前设备状态 / Current device status
     std::string lastStatusReport;                        // 最近一次上报的状态信息 / Last reported custom status string
     std::chrono::steady_clock::time_point lastHeartbeat; // 最近一次心跳时间戳 / Timestamp of the last heartbeat
+    DeviceAttributes attributes;                         // 结构化状态属性 / Structured status attributes
+    std::string owner;                                   // 设备所有者，未绑定时为空 / Owning user, empty when unbound
 };
 
 IOT_NS_END
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 一类设备的心跳超时，按设备 ID 前缀划分
+ *        Heartbeat timeout of a device class, selected by device ID prefix.
+ *
+ * 设备注册时取前缀最长的匹配项；没有匹配项的设备使用 DeviceManagerOptions::heartbeatTimeout。
+ * A device takes the longest matching prefix when it registers; devices matching none use
+ * DeviceManagerOptions::heartbeatTimeout.
+ */
+struct HeartbeatClass {
+    std::string prefix;                      // 设备 ID 前缀 / Device ID prefix
+    std::chrono::milliseconds timeout { 0 }; // 该类设备的心跳超时 / Heartbeat timeout of the class
+};
+
+/**
+ * @brief 注册表预写日志的持久化级别
+ *        Durability level of the registry write-ahead log.
+ */
+enum class WalDurability {
+    None,    // 只写入页缓存，不调用 fsync / Written to the page cache, never fsynced
+    Batched, // 后台按批 fsync，调用方不等待 / Fsynced in background batches, callers never wait
+    Sync,    // 调用方等待所在批次 fsync 完成 / Callers wait until their batch is fsynced
+};
+
+/**
+ * @brief 设备管理器的运行时调优参数
+ *        Runtime tuning options of a device manager.
+ *
+ * 由服务器配置文件或命令行填充，通过 IDeviceManager::configure() 在注册任何设备之前下发。
+ * Filled from the server config file or the command line and handed over through IDeviceManager::configure()
+ * before any device is registered.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-29
+ */
+struct DeviceManagerOptions {
+    size_t shardCount = 32;                                // 设备注册表分片数 / Shards of the device registry
+    std::chrono::milliseconds heartbeatTimeout { 30000 };  // 心跳超时，超过后视为离线 / Heartbeat timeout before offline
+    std::chrono::milliseconds expiryTick { 100 };          // 超时扫描粒度，0 关闭主动扫描 / Expiry sweep tick, 0 disables it
+    std::vector<HeartbeatClass> heartbeatClasses;          // 按设备类别的心跳超时 / Per-class heartbeat timeouts
+    std::string walPath;                                   // 预写日志文件，为空不记录 / Write-ahead log file, empty disables it
+    WalDurability walDurability = WalDurability::Batched;  // 预写日志持久化级别 / Write-ahead log durability
+    std::chrono::milliseconds walFlushInterval { 10 };     // 预写日志后台刷盘间隔 / Write-ahead log flush interval
+    std::string snapshotPath;                              // 注册表快照文件，为空不生成 / Registry snapshot, empty disables it
+    std::chrono::milliseconds snapshotInterval { 300000 }; // 快照间隔，0 只在关闭时生成 / Snapshot interval, 0 on shutdown only
+    std::chrono::milliseconds historyRetention { 0 };      // 属性历史保留时长，0 不记录 / History retention, 0 disables it
+    uint16_t historyChunkSamples = 240;                    // 历史数据块样本数 / Samples per history chunk
+};
+
+IOT_NS_END
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceInfo.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 结构化属性的数值条件
+ *        Numeric condition on a structured attribute.
+ *
+ * 布尔属性按 1 / 0 比较；缺少该属性或属性为字符串的设备不匹配。
+ * Boolean attributes compare as 1 / 0; devices missing the attribute or holding a string never match.
+ */
+struct AttributeFilter {
+    enum class Op { Eq, Ne, Lt, Le, Gt, Ge };
+
+    std::string key;  // 属性名 / Attribute name
+    Op op = Op::Eq;   // 比较方式 / Comparison
+    double value = 0; // 比较的数值 / Value compared against
+
+    /**
+     * @brief 属性值是否满足条件
+     *        Whether an attribute value satisfies the condition.
+     */
+    [[nodiscard]]
+    auto matches(double actual) const -> bool {
+        switch (op) {
+        case Op::Eq:
+            return actual == value;
+        case Op::Ne:
+            return actual != value;
+        case Op::Lt:
+            return actual < value;
+        case Op::Le:
+            return actual <= value;
+        case Op::Gt:
+            return actual > value;
+        case Op::Ge:
+            return actual >= value;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief 设备列表查询条件
+ *        Filters and paging of a device listing.
+ *
+ * 各过滤条件同时满足才匹配；心跳时长为 0 表示不限。游标为空表示从头开始，否则取上一页返回的 nextCursor。
+ * 指定查看者时，已归属其他用户的设备不匹配，尚未绑定所有者的设备仍然匹配。
+ * A device matches when every filter holds; a zero heartbeat age means unbounded. An empty cursor starts from the
+ * beginning, otherwise pass the nextCursor of the previous page. With a viewer, devices owned by another user
+ * never match, while devices with no owner still do.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-03
+ */
+struct DeviceQuery {
+    std::optional<DeviceStatus> status;              // 只匹配该状态，为空表示不限 / Only this status, empty for any
+    std::chrono::milliseconds minHeartbeatAge { 0 }; // 距最近一次心跳至少这么久 / Last heartbeat at least this long ago
+    std::chrono::milliseconds maxHeartbeatAge { 0 }; // 距最近一次心跳至多这么久 / Last heartbeat at most this long ago
+    std::string cursor;                              // 分页游标 / Page cursor
+    size_t limit = 100;                              // 每页设备数上限 / Maximum devices per page
+    bool countOnly = false;                          // 只统计匹配数量，不返回设备 / Count matches only, return no devices
+    std::vector<AttributeFilter> attributes;         // 属性的数值条件 / Numeric attribute conditions
+    std::string owner;                               // 只匹配该所有者的设备，为空表示不限 / Only this owner, empty for any
+    std::string viewer;                              // 跳过属于其他用户的设备，为空表示不限 / Skip other users' devices, empty for none
+};
+
+/**
+ * @brief 查询结果中的单个设备
+ *        One device in a query result.
+ */
+struct DeviceRecord {
+    std::string deviceId; // 设备唯一标识符 / Device ID
+    DeviceInfo info;      // 设备信息，状态已按心跳超时折算 / Device info, status adjusted for heartbeat timeout
+};
+
+/**
+ * @brief 设备列表的一页
+ *        One page of a device listing.
+ */
+struct DevicePage {
+    std::vector<DeviceRecord> devices; // 本页设备 / Devices on this page
+    std::string nextCursor;            // 下一页游标，为空表示已到末尾 / Cursor of the next page, empty at the end
+    uint64_t count = 0;                // 计数模式下的匹配总数 / Total matches in count-only mode
+};
+
+/**
+ * @brief 按状态统计的设备数量
+ *        Device counts per status.
+ *
+ * 统计的是注册表中存储的状态：心跳超时由超时扫描判定，因此在线设备转为离线最多滞后一个扫描粒度。
+ * Counts follow the status stored in the registry: timeouts are judged by the expiry sweeper, so an online
+ * device moves to offline at most one sweep tick late.
+ */
+struct DeviceCounts {
+    uint64_t total = 0;                                     // 已注册设备总数 / Registered devices
+    std::array<uint64_t, kDEVICE_STATUS_COUNT> byStatus {}; // 以状态值为下标的数量 / Count indexed by status value
+
+    /**
+     * @brief 某个状态的设备数量
+     *        Number of devices in one status.
+     */
+    [[nodiscard]]
+    auto of(DeviceStatus status) const -> uint64_t {
+        return byStatus[static_cast<size_t>(status)];
+    }
+};
+
+/**
+ * @brief 设备属性历史查询条件
+ *        Time range and resolution of an attribute history query.
+ *
+ * 步长为 0 时返回原始样本；否则从起始时间起按步长划分时间桶，每个非空的桶返回一个聚合点。
+ * A zero step returns raw samples; otherwise the range is cut into buckets of one step each from the start, and
+ * every non-empty bucket yields one aggregated point.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-09
+ */
+struct HistoryQuery {
+    std::string deviceId;                 // 设备唯一标识符 / Device ID
+    std::string attribute;                // 数值或布尔属性名 / Numeric or boolean attribute name
+    int64_t fromMs = 0;                   // 起始时间（Unix 毫秒，含）/ Range start in Unix ms, inclusive
+    int64_t toMs = 0;                     // 结束时间（Unix 毫秒，含），0 表示当前 / Range end, inclusive, 0 for now
+    std::chrono::milliseconds step { 0 }; // 降采样步长，0 返回原始样本 / Downsampling step, 0 for raw samples
+};
+
+/**
+ * @brief 属性历史中的一个点：原始样本，或一个时间桶的聚合
+ *        One point of an attribute history: a raw sample, or the aggregate of one bucket.
+ */
+struct HistoryPoint {
+    int64_t timestampMs = 0; // 样本时间或时间桶起点（Unix 毫秒）/ Sample time or bucket start in Unix ms
+    double value = 0;        // 样本值或桶内平均值 / Sample value or bucket average
+    double min = 0;          // 桶内最小值 / Bucket minimum
+    double max = 0;          // 桶内最大值 / Bucket maximum
+    uint32_t count = 0;      // 桶内样本数，原始样本为 1 / Samples in the bucket, 1 for a raw sample
+};
+
+/**
+ * @brief 设备查询的结果状态
+ *        Outcome of a device query.
+ */
+enum class DeviceQueryStatus {
+    Ok,              // 查询成功 / Succeeded
+    Unauthenticated, // 鉴权失败 / Authentication failed
+    InvalidCursor,   // 游标格式错误或已失效 / Malformed or stale cursor
+    NotFound,        // 设备未注册 / Device not registered
+};
+
+IOT_NS_END
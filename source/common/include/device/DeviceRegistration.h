@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <cstdint>
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 批量注册中的单个设备
+ *        One device of a bulk registration.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-13
+ */
+struct DeviceRegistration {
+    std::string deviceId; // 设备唯一标识符 / Device ID
+    std::string owner;    // 所有者，为空表示不绑定 / Owning user, empty for none
+};
+
+/**
+ * @brief 批量注册的结果
+ *        Outcome of a bulk registration.
+ *
+ * 每条输入恰好计入一项，各项之和等于输入条数。
+ * Every input entry is counted in exactly one field, so the fields add up to the number of entries.
+ */
+struct DeviceImportResult {
+    uint64_t registered = 0; // 新注册的设备数 / Newly registered devices
+    uint64_t existing = 0;   // 已注册而跳过的设备数 / Devices already registered and skipped
+    uint64_t duplicates = 0; // 批次内重复出现而跳过的条目数 / Entries repeating an earlier one of the batch
+    uint64_t rejected = 0;   // 设备 ID 为空而拒绝的条目数 / Entries rejected for an empty device ID
+};
+
+IOT_NS_END
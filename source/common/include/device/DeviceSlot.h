@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceHandle.h"
+#include "device/DeviceHistory.h"
+#include "device/DeviceInfo.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 设备注册表槽位
+ *        Registry slot holding the live state of one device.
+ *
+ * 热字段（心跳时间戳、状态）以原子变量存放，心跳可在 gRPC 线程上直接写入，无需加锁或经过任务队列；
+ * 冷字段（最近一次状态上报、结构化属性及其历史、所有者）由槽位内的互斥锁保护。
+ * Hot fields (heartbeat timestamp, status) are atomics so heartbeats can be stored directly from the gRPC
+ * thread without a lock or a trip through the task queue; cold fields (last status report, attributes and their
+ * history, owner) are guarded by the slot mutex.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-22
+ */
+struct DeviceSlot {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param id 设备唯一标识符 / Unique identifier of the device
+     * @param h 设备句柄 / Device handle
+     */
+    explicit DeviceSlot(std::string id, DeviceHandle h = kINVALID_DEVICE_HANDLE)
+        : deviceId(std::move(id)),
+          handle(h) {}
+
+    /**
+     * @brief 写入心跳时间戳，并在离线→在线时切换状态
+     *        Store the heartbeat timestamp and switch the status on an offline→online transition.
+     *
+     * 已在线时只有一次 relaxed 写入；仅在状态确实发生变化时才执行原子交换。
+     * When already online this is a single relaxed store; the atomic exchange only runs on a real transition.
+     *
+     * @param now 心跳时间点 / Heartbeat time point
+     * @return true 本次心跳使设备由非在线变为在线 / This heartbeat brought the device online
+     */
+    auto touch(Clock::time_point now = Clock::now()) -> bool {
+        lastHeartbeat.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        if (status.load(std::memory_order_relaxed) == DeviceStatus::ONLINE) {
+            return false;
+        }
+        return status.exchange(DeviceStatus::ONLINE, std::memory_order_acq_rel) != DeviceStatus::ONLINE;
+    }
+
+    /**
+     * @brief 读取最近一次心跳时间点
+     *        Load the last heartbeat time point.
+     */
+    [[nodiscard]]
+    auto heartbeatTime() const -> Clock::time_point {
+        return Clock::time_point(Clock::duration(lastHeartbeat.load(std::memory_order_relaxed)));
+    }
+
+    /**
+     * @brief 生成设备信息快照
+     *        Build a DeviceInfo snapshot of this slot.
+     */
+    [[nodiscard]]
+    auto snapshot() const -> DeviceInfo {
+        DeviceInfo info;
+        info.status = status.load(std::memory_order_acquire);
+        info.lastHeartbeat = heartbeatTime();
+        std::lock_guard<std::mutex> lock(mutex);
+        info.lastStatusReport = lastStatusReport;
+        info.attributes = attributes;
+        info.owner = owner;
+        return info;
+    }
+
+    const std::string deviceId;                                 // 设备唯一标识符 / Device ID
+    const DeviceHandle handle;                                  // 注册时分配的设备句柄 / Handle assigned at registration
+    std::atomic<DeviceStatus> status { DeviceStatus::UNKNOWN }; // 当前设备状态 / Current device status
+    std::atomic<Clock::rep> lastHeartbeat { 0 };                // 最近一次心跳（steady_clock 计数）/ Last heartbeat ticks
+    std::atomic<int64_t> heartbeatTimeoutMs { 0 };              // 本设备的心跳超时，0 用默认值 / Own timeout, 0 for default
+    std::atomic<bool> expiryArmed { false };                    // 已挂入超时扫描时间轮 / Scheduled on the expiry wheel
+    std::atomic<uint32_t> expiryGeneration { 0 };               // 最新超时定时器的代数 / Generation of the live expiry timer
+    mutable std::mutex mutex;                                   // 保护冷字段 / Guards cold fields
+    std::string lastStatusReport;                               // 最近一次上报的状态信息 / Last status report
+    DeviceAttributes attributes;                                // 合并后的结构化状态属性 / Merged status attributes
+    std::unique_ptr<DeviceHistory> history;                     // 数值属性的历史，未启用时为空 / Attribute history, empty when off
+    std::string owner;                                          // 设备所有者，未绑定时为空 / Owning user, empty when unbound
+};
+
+IOT_NS_END
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include <cstdint>
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 批量上报中的单条设备状态
+ *        One device status entry of a batched report.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-01
+ */
+struct DeviceStatusUpdate {
+    std::string deviceId;  // 设备唯一标识符 / Device ID
+    std::string status;    // 状态内容，如 JSON / Status payload, e.g. JSON
+    int64_t timestamp = 0; // 时间戳（毫秒），0 表示未提供 / Timestamp in ms, 0 when absent
+    StatusDetails details; // 变化的属性，空值表示删除 / Changed attributes, an empty value removes one
+};
+
+IOT_NS_END
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 用户管理器的运行时参数
+ *        Runtime options of a user manager.
+ *
+ * 由服务器配置文件或命令行填充，通过 IUserManager::configure() 在校验任何用户之前下发。凭据文件每行一个
+ * `用户ID:令牌`，`#` 开头的行与空行被忽略。未配置凭据文件时拒绝所有用户，除非显式开启 insecure，
+ * 此时只要求用户ID非空，仅供本地开发使用。
+ * Filled from the server config file or the command line and handed over through IUserManager::configure()
+ * before any user is validated. The credentials file holds one `user_id:token` per line, ignoring blank lines
+ * and lines starting with `#`. Without one every user is rejected unless insecure is set explicitly, which only
+ * requires a non-empty user ID and is meant for local development.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-21
+ */
+struct UserManagerOptions {
+    std::string credentialsFile; // 用户凭据文件 / Credentials file
+    bool insecure = false;       // 无凭据文件时放行任意非空用户ID / Accept any non-empty user ID without credentials
+};
+
+IOT_NS_END
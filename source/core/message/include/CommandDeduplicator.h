@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * @brief 下行命令去重头文件
+ *        Header file for outbound command deduplication
+ *
+ * 客户端在超时后重试 sendCommand 时携带相同的幂等键，窗口期内的重复请求直接返回首次提交的结果，
+ * 命令不会再次入队，设备也不会重复执行。
+ * Clients retrying sendCommand after a timeout resend the same idempotency key; duplicates inside the window
+ * replay the original submission result, so the command is neither queued again nor executed twice.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-25
+ */
+
+#include "CommandTracker.h"
+#include "common/NameSpaceDef.h"
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 有界、带时间窗口的命令去重存储
+ *        Bounded, time-windowed command deduplication store.
+ *
+ * 按 设备ID + 幂等键 分片哈希；每个分片用固定容量的环形队列记录插入顺序，
+ * 超出窗口或容量时从环尾淘汰最旧的条目，因此内存占用固定，与命令速率无关。
+ * Entries are hashed into shards by device ID plus idempotency key; each shard records insertion order in a
+ * fixed-capacity ring and evicts the oldest entry once it leaves the window or the ring is full, so memory
+ * stays fixed regardless of the command rate.
+ */
+class CommandDeduplicator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds kDEFAULT_WINDOW { 10 * 60 * 1000 }; // 默认去重窗口 / Default window
+    static constexpr size_t kDEFAULT_SHARD_CAPACITY = 4096;                        // 默认每分片容量 / Default capacity per shard
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param window 去重窗口 / Deduplication window
+     * @param shardCapacity 每个分片最多保留的条目数 / Maximum entries kept per shard
+     */
+    explicit CommandDeduplicator(std::chrono::milliseconds window = kDEFAULT_WINDOW,
+                                 size_t shardCapacity = kDEFAULT_SHARD_CAPACITY);
+
+    /**
+     * @brief 去重提交：窗口内已有相同幂等键时返回原结果，否则执行 submit 并缓存被接受的结果
+     *        Deduplicated submit: replays the original result for a known key, otherwise runs `submit`
+     *        and caches the result if it was accepted.
+     *
+     * 同一分片内的提交串行执行，保证并发重试只有一个真正入队；被拒绝的结果（如队列已满）不缓存，
+     * 客户端稍后重试仍可提交。
+     * Submissions within a shard are serialized so concurrent retries queue the command only once; rejected
+     * results (e.g. a full queue) are not cached, so a later retry can still go through.
+     *
+     * @param deviceId 目标设备ID / Target device ID
+     * @param key 幂等键，为空时不去重 / Idempotency key; empty disables deduplication
+     * @param submit 实际提交函数 / Function performing the real submission
+     * @param now 当前时间点 / Current time point
+     * @return CommandReceipt 提交结果 / Submission result
+     */
+    auto submitOnce(const std::string& deviceId, const std::string& key, const std::function<CommandReceipt()>& submit,
+                    Clock::time_point now = Clock::now()) -> CommandReceipt;
+
+    /**
+     * @brief 当前缓存的条目数量
+     *        Number of cached entries.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t;
+
+private:
+    /**
+     * @brief 环形队列中的条目
+     *        Entry of the expiry ring.
+     */
+    struct Entry {
+        std::string key;              // 设备ID + 幂等键 / Device ID plus idempotency key
+        CommandReceipt receipt;       // 首次提交的结果 / Original submission result
+        Clock::time_point insertedAt; // 插入时间 / Insertion time
+    };
+
+    /**
+     * @brief 单个分片：固定容量的环形队列与键索引
+     *        One shard: fixed-capacity ring plus key index.
+     */
+    struct Shard {
+        mutable std::mutex mutex;                      // 保护本分片 / Guards this shard
+        std::vector<Entry> ring;                       // 按插入顺序排列的条目 / Entries in insertion order
+        size_t head = 0;                               // 最旧条目位置 / Position of the oldest entry
+        size_t count = 0;                              // 有效条目数 / Number of live entries
+        std::unordered_map<std::string, size_t> index; // 键到环位置 / Key to ring position
+    };
+
+    /**
+     * @brief 淘汰超出窗口的条目，环满时再淘汰最旧的一条
+     *        Evict entries past the window, and the oldest one if the ring is still full.
+     */
+    void evict(Shard& shard, Clock::time_point now) const;
+
+private:
+    static constexpr size_t kSHARD_COUNT = 64; // 分片数量 / Number of shards
+
+    std::chrono::milliseconds mWindow;           // 去重窗口 / Deduplication window
+    std::vector<std::unique_ptr<Shard>> mShards; // 分片集合 / Shards
+};
+
+IOT_NS_END
@@ -0,0 +1,338 @@
+#pragma once
+
+/**
+ * @brief 设备下行命令队列头文件
+ *        Header file for per-device outbound command queues
+ *
+ * 为每个设备维护一个有界的下行命令队列，设备通过长连接流订阅后由服务端主动推送命令，
+ * 多条待发送命令会合并为一个批次一次写出。
+ * Maintains a bounded outbound command queue per device; devices subscribe over a long-lived stream and
+ * the server pushes commands to them, batching multiple pending commands into one write.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-23
+ */
+
+#include "common/NameSpaceDef.h"
+#include "common/ShardedMap.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 命令参数集合类型
+ *        Type of the command parameter map.
+ */
+using CommandParams = std::map<std::string, std::string>;
+
+/**
+ * @brief 待下发给设备的命令
+ *        Command waiting to be delivered to a device.
+ */
+struct OutboundCommand {
+    std::string command;    // 命令内容 / Command content
+    CommandParams params;   // 命令参数 / Command parameters
+    int64_t timestamp = 0;  // 命令时间戳（毫秒）/ Command timestamp in milliseconds
+    uint64_t commandId = 0; // 命令ID，由回执跟踪器分配 / Command ID assigned by the ack tracker
+};
+
+/**
+ * @brief 单个设备的有界下行命令队列
+ *        Bounded outbound command queue of a single device.
+ *
+ * 生产者（sendCommand）入队后立即唤醒等待中的投递流，投递流一次取出所有待发命令（不超过批次上限）。
+ * Producers (sendCommand) wake the waiting delivery stream immediately; the stream drains every pending
+ * command (up to the batch limit) in one go.
+ */
+class DeviceOutbox {
+public:
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param capacity 队列容量上限 / Maximum number of queued commands
+     */
+    explicit DeviceOutbox(size_t capacity)
+        : mCapacity(capacity) {}
+
+    /**
+     * @brief 命令入队
+     *        Enqueue a command.
+     *
+     * 入队失败时命令保持原样，调用方可以改投其他队列。
+     * The command is left untouched when it is not queued, so the caller may offer it elsewhere.
+     *
+     * @param command 待下发命令 / Command to deliver
+     * @return true 入队成功 / Queued
+     * @return false 队列已满或已被回收 / Queue is full or retired
+     */
+    auto push(OutboundCommand&& command) -> bool;
+
+    /**
+     * @brief 将投递失败的命令按原顺序放回队首
+     *        Put commands whose delivery failed back at the front, preserving their order.
+     *
+     * @param commands 投递失败的命令 / Commands that could not be delivered
+     */
+    void requeue(std::vector<OutboundCommand>& commands);
+
+    /**
+     * @brief 命令是否仍在队列中等待取出
+     *        Whether a command is still waiting in the queue.
+     *
+     * @param commandId 命令ID / Command ID
+     * @return true 尚未被投递流取出 / Not yet drained by a delivery stream
+     */
+    [[nodiscard]]
+    auto contains(uint64_t commandId) const -> bool;
+
+    /**
+     * @brief 移除仍在队列中的命令
+     *        Remove a command that is still queued.
+     *
+     * @param commandId 命令ID / Command ID
+     * @return true 已移除 / Removed
+     * @return false 命令不在队列中 / The command is not queued
+     */
+    auto remove(uint64_t commandId) -> bool;
+
+    /**
+     * @brief 等待命令到达并批量取出
+     *        Wait for commands and drain them as one batch.
+     *
+     * 有命令入队时立即返回，超时只用于让调用方检查流是否已取消。
+     * Returns as soon as a command is queued; the timeout only lets the caller check for cancellation.
+     *
+     * @param out 输出的命令批次 / Output batch
+     * @param maxBatch 单批次命令上限 / Maximum commands per batch
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @return size_t 取出的命令数量 / Number of drained commands
+     */
+    auto waitAndDrain(std::vector<OutboundCommand>& out, size_t maxBatch, std::chrono::milliseconds timeout) -> size_t;
+
+    /**
+     * @brief 不等待，直接取出当前排队的一批命令
+     *        Drain one batch of the queued commands without waiting.
+     *
+     * @param out 输出的命令批次 / Output batch
+     * @param maxBatch 单批次命令上限 / Maximum commands per batch
+     * @return size_t 取出的命令数量 / Number of drained commands
+     */
+    auto tryDrain(std::vector<OutboundCommand>& out, size_t maxBatch) -> size_t;
+
+    /**
+     * @brief 设置命令就绪监听器，供异步投递流代替阻塞等待
+     *        Install a ready listener, letting async delivery streams replace the blocking wait.
+     *
+     * 监听器在命令入队或放回后、释放队列锁之后调用；新监听器替换旧监听器，传入空函数即解除监听。
+     * The listener runs after a command is queued or requeued, with the queue lock released; a new listener
+     * replaces the previous one and an empty function detaches.
+     *
+     * @param listener 就绪监听器 / Ready listener
+     * @return uint64_t 监听器标识，供 clearReadyListener 使用 / Listener token for clearReadyListener
+     */
+    auto setReadyListener(std::function<void()> listener) -> uint64_t;
+
+    /**
+     * @brief 解除监听，仅当当前监听器仍是 token 标识的那个时生效
+     *        Detach the listener, only if it is still the one identified by the token.
+     *
+     * 设备重连时新的订阅流先装上自己的监听器，旧流随后结束时不会把新监听器清掉。
+     * When a device reconnects the new stream installs its listener first; the old stream ending afterwards
+     * does not wipe it.
+     *
+     * @param token setReadyListener 返回的标识 / Token returned by setReadyListener
+     */
+    void clearReadyListener(uint64_t token);
+
+    /**
+     * @brief 登记一个投递流
+     *        Register a delivery stream.
+     *
+     * @return true 已登记 / Registered
+     * @return false 队列已被回收，应重新获取 / The queue is retired; attach again
+     */
+    auto subscribe() -> bool;
+
+    /**
+     * @brief 注销一个投递流
+     *        Unregister a delivery stream.
+     */
+    void unsubscribe();
+
+    /**
+     * @brief 是否有投递流在订阅
+     *        Whether any delivery stream is subscribed.
+     */
+    [[nodiscard]]
+    auto subscribed() const -> bool;
+
+    /**
+     * @brief 队列为空且没有投递流时将其标记为已回收
+     *        Retire the queue if it is empty and has no delivery stream.
+     *
+     * 已回收的队列拒绝入队与订阅，持有它的调用方据此重新获取新队列，命令不会落入已被移除的队列。
+     * A retired queue refuses pushes and subscriptions, telling holders to attach again, so no command lands in a
+     * queue that was already removed.
+     *
+     * @return true 已回收 / Retired
+     */
+    auto retireIfIdle() -> bool;
+
+    /**
+     * @brief 是否已被回收
+     *        Whether the queue is retired.
+     */
+    [[nodiscard]]
+    auto retired() const -> bool;
+
+    /**
+     * @brief 当前排队的命令数量
+     *        Number of queued commands.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t;
+
+private:
+    /**
+     * @brief 在持锁状态下取出一批命令
+     *        Drain one batch while holding the lock.
+     */
+    auto drainLocked(std::vector<OutboundCommand>& out, size_t maxBatch) -> size_t;
+
+    /**
+     * @brief 通知就绪监听器
+     *        Notify the ready listener.
+     */
+    void notifyReady();
+
+private:
+    const size_t mCapacity;             // 队列容量上限 / Queue capacity
+    mutable std::mutex mMutex;          // 保护队列 / Guards the queue
+    std::condition_variable mCondition; // 命令到达通知 / Signals command arrival
+    std::deque<OutboundCommand> mQueue; // 待下发命令 / Pending commands
+    size_t mSubscribers = 0;            // 订阅中的投递流数量 / Subscribed delivery streams
+    bool mRetired = false;              // 已从集合中回收 / Removed from the collection
+    std::mutex mListenerMutex;          // 保护就绪监听器 / Guards the ready listener
+    std::function<void()> mListener;    // 就绪监听器 / Ready listener
+    uint64_t mListenerToken = 0;        // 当前监听器标识 / Token of the current listener
+};
+
+/**
+ * @brief 所有设备下行命令队列的集合
+ *        Collection of the outbound command queues of all devices.
+ *
+ * 队列在第一次下发命令或设备订阅时按需创建，设备未在线时命令会暂存在队列中，直至设备订阅后推送。
+ * 最后一个投递流退订时，若队列已空则将其移除，集合只保留有订阅或有待发命令的设备。
+ * Queues are created on demand by the first command or subscription; commands for a device without a live
+ * stream stay queued until the device subscribes. When the last delivery stream unsubscribes an empty queue is
+ * removed, so only devices with a subscription or pending commands keep one.
+ */
+class CommandOutbox {
+public:
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param capacity 每个设备队列的容量上限 / Capacity of each device queue
+     */
+    explicit CommandOutbox(size_t capacity = kDEFAULT_CAPACITY)
+        : mCapacity(capacity) {}
+
+    /**
+     * @brief 获取（必要时创建）设备的下行队列
+     *        Get, creating if needed, the outbound queue of a device.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @return std::shared_ptr<DeviceOutbox> 设备下行队列 / Device outbound queue
+     */
+    auto attach(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox>;
+
+    /**
+     * @brief 为投递流订阅设备的下行队列
+     *        Subscribe a delivery stream to the outbound queue of a device.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @return std::shared_ptr<DeviceOutbox> 已登记该投递流的队列 / Queue with the stream registered
+     */
+    auto subscribe(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox>;
+
+    /**
+     * @brief 投递流结束时退订，队列已空且没有其他投递流时将其移除
+     *        Unsubscribe an ending delivery stream, removing the queue once it is empty and has no other stream.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @param outbox subscribe() 返回的队列 / Queue returned by subscribe()
+     */
+    void unsubscribe(const std::string& deviceId, const std::shared_ptr<DeviceOutbox>& outbox);
+
+    /**
+     * @brief 设备当前是否有投递流在订阅
+     *        Whether a delivery stream is currently subscribed for a device.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     */
+    [[nodiscard]]
+    auto subscribed(const std::string& deviceId) const -> bool;
+
+    /**
+     * @brief 当前持有的设备队列数量
+     *        Number of device queues currently held.
+     */
+    [[nodiscard]]
+    auto outboxCount() const -> size_t;
+
+    /**
+     * @brief 命令是否仍在设备队列中等待取出
+     *        Whether a command is still waiting in the queue of a device.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @param commandId 命令ID / Command ID
+     */
+    [[nodiscard]]
+    auto pending(const std::string& deviceId, uint64_t commandId) const -> bool;
+
+    /**
+     * @brief 撤回仍在设备队列中的命令，不创建队列
+     *        Withdraw a command still sitting in the queue of a device, without creating a queue.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @param commandId 命令ID / Command ID
+     * @return true 已撤回 / Withdrawn
+     * @return false 命令不在队列中 / The command is not queued
+     */
+    auto withdraw(const std::string& deviceId, uint64_t commandId) -> bool;
+
+    /**
+     * @brief 向设备下行队列投递命令
+     *        Enqueue a command for a device.
+     *
+     * @param deviceId 设备唯一标识符 / Device ID
+     * @param command 待下发命令 / Command to deliver
+     * @return true 入队成功 / Queued
+     * @return false 队列已满 / Queue is full
+     */
+    auto enqueue(const std::string& deviceId, OutboundCommand command) -> bool;
+
+    /// 默认每个设备的队列容量 / Default per-device queue capacity
+    static constexpr size_t kDEFAULT_CAPACITY = 256;
+
+    /// 单次推送的命令批次上限 / Maximum commands per pushed batch
+    static constexpr size_t kMAX_BATCH = 32;
+
+private:
+    const size_t mCapacity;                                                    // 每个设备的队列容量 / Per-device capacity
+    IOT_NS::ShardedMap<std::string, std::shared_ptr<DeviceOutbox>> mOutboxes; // 设备 ID 到下行队列 / Device ID to queue
+};
+
+IOT_NS_END
@@ -0,0 +1,381 @@
+#pragma once
+
+/**
+ * @brief 下行命令回执跟踪头文件
+ *        Header file for outbound command acknowledgment tracking
+ *
+ * 跟踪每条下行命令从入队、送达到设备回执的全过程，超时后按退避策略有限次重发，
+ * 调用方可以轮询或等待命令的最终状态。
+ * Tracks every outbound command from queueing through delivery to the device acknowledgment, retries
+ * timed-out commands a bounded number of times with backoff, and lets callers poll or await the outcome.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-24
+ */
+
+#include "CommandOutbox.h"
+#include "common/NameSpaceDef.h"
+#include "common/TimingWheel.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 下行命令状态
+ *        State of an outbound command.
+ */
+enum class CommandState {
+    Queued = 1,    // 已入队，等待送达 / Queued, waiting for delivery
+    Delivered = 2, // 已写入设备流，等待回执 / Written to the device stream, waiting for the ack
+    Acked = 3,     // 设备回执成功 / Acknowledged as executed
+    Failed = 4,    // 设备回执失败 / Acknowledged as failed
+    TimedOut = 5   // 重试耗尽仍未收到回执 / No ack after all retries
+};
+
+/**
+ * @brief 命令状态快照
+ *        Snapshot of a command's status.
+ */
+struct CommandStatus {
+    uint64_t commandId = 0;                    // 命令ID / Command ID
+    std::string deviceId;                      // 目标设备ID / Target device ID
+    CommandState state = CommandState::Queued; // 当前状态 / Current state
+    uint32_t attempts = 0;                     // 已发送次数 / Delivery attempts so far
+    int32_t code = 0;                          // 设备回执码 / Code reported by the device
+    std::string message;                       // 设备回执信息 / Message reported by the device
+};
+
+/**
+ * @brief 命令提交结果
+ *        Result of submitting a command.
+ */
+struct CommandReceipt {
+    bool accepted = false;  // 是否已入队 / Whether the command was queued
+    uint64_t commandId = 0; // 分配的命令ID / Assigned command ID
+    std::string message;    // 结果描述 / Result description
+};
+
+/**
+ * @brief 命令重试策略
+ *        Retry policy for outbound commands.
+ */
+struct CommandRetryPolicy {
+    std::chrono::milliseconds ackTimeout { 5000 };   // 每次发送等待回执的时间 / Ack wait per attempt
+    std::chrono::milliseconds backoffBase { 500 };   // 首次重试前的退避时间 / Backoff before the first retry
+    std::chrono::milliseconds backoffMax { 30000 };  // 退避时间上限 / Backoff cap
+    uint32_t maxAttempts = 3;                        // 最大发送次数 / Maximum delivery attempts
+    std::chrono::milliseconds retention { 60000 };   // 终态记录保留时间 / How long terminal records stay queryable
+    std::chrono::milliseconds parkTimeout { 60000 }; // 重试等待设备订阅的时间 / How long a retry waits for a stream
+};
+
+/**
+ * @brief 下行命令回执跟踪器
+ *        Acknowledgment tracker for outbound commands.
+ *
+ * 待回执命令表按设备分片、以命令 ID 为键；命令 ID 的低位编码分片号，按 ID 查询时无需知道设备。
+ * 每个分片持有一个时间轮驱动超时、退避重试与终态记录清理，由单个后台线程推进，
+ * 没有每条命令的线程，也没有全表扫描。
+ * The pending-command table is sharded by device and keyed by command ID; the low bits of the ID encode the
+ * shard so lookups by ID need no device. Each shard owns a timing wheel driving ack timeouts, backoff retries
+ * and cleanup of terminal records, advanced by one background thread: no per-command thread and no table scan.
+ *
+ * 退避结束时设备没有投递流订阅，则重试暂停而不重复入队，设备重新订阅时由 resume() 恢复；
+ * 在 parkTimeout 内未恢复的命令以超时结束。
+ * A retry due while the device has no delivery stream is parked instead of queued again and resumed by
+ * resume() when the device subscribes; a command not resumed within parkTimeout times out.
+ *
+ * 上一份副本仍在设备队列中时重试只重新等待回执，不再入队第二份；命令进入终态时撤回队列中尚未取出的副本，
+ * 因此超时的命令不会在设备之后订阅时才被执行。
+ * A retry whose previous copy is still in the device queue only awaits the ack again instead of queueing a
+ * second copy, and a command reaching a terminal state is withdrawn from the queue if not yet drained, so a
+ * timed-out command never runs when the device subscribes later.
+ */
+class CommandTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 命令完成回调，参数为命令终态或等待超时时的状态；命令不存在时为 std::nullopt
+     *        Completion callback receiving the terminal status, or the status at timeout; std::nullopt when unknown.
+     */
+    using CompletionCallback = std::function<void(const std::optional<CommandStatus>&)>;
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param outbox 命令发送所用的下行队列 / Outbound queues used to (re)send commands
+     * @param policy 重试策略 / Retry policy
+     */
+    explicit CommandTracker(CommandOutbox& outbox, CommandRetryPolicy policy = {});
+
+    /**
+     * @brief 析构函数，停止后台线程
+     *        Destructor: stops the background thread.
+     */
+    ~CommandTracker();
+
+    /**
+     * @brief 启动推进时间轮的后台线程
+     *        Start the background thread advancing the timing wheels.
+     */
+    void start();
+
+    /**
+     * @brief 停止后台线程，并唤醒所有等待者
+     *        Stop the background thread and wake every waiter.
+     */
+    void stop();
+
+    /**
+     * @brief 提交命令：分配命令ID、入队并开始跟踪
+     *        Submit a command: assign an ID, queue it and start tracking.
+     *
+     * @param deviceId 目标设备ID / Target device ID
+     * @param command 待下发命令 / Command to deliver
+     * @return CommandReceipt 提交结果 / Submission result
+     */
+    auto submit(const std::string& deviceId, OutboundCommand command) -> CommandReceipt;
+
+    /**
+     * @brief 标记命令已写入设备流
+     *        Mark a command as written to the device stream.
+     *
+     * @param commandId 命令ID / Command ID
+     */
+    void markDelivered(uint64_t commandId);
+
+    /**
+     * @brief 处理设备回执
+     *        Handle a device acknowledgment.
+     *
+     * @param deviceId 回执设备ID，必须与命令目标一致 / Acking device, must match the command target
+     * @param commandId 命令ID / Command ID
+     * @param code 回执码，0 表示执行成功 / Ack code, 0 means executed
+     * @param message 回执信息 / Ack message
+     * @return true 回执被接受 / Ack accepted
+     * @return false 命令不存在、设备不匹配或已是终态 / Unknown command, device mismatch or already terminal
+     */
+    auto acknowledge(const std::string& deviceId, uint64_t commandId, int32_t code, const std::string& message) -> bool;
+
+    /**
+     * @brief 查询命令状态
+     *        Query the status of a command.
+     *
+     * @param commandId 命令ID / Command ID
+     * @return std::optional<CommandStatus> 命令状态，不存在或已清理时返回 std::nullopt
+     *         Status, or std::nullopt when unknown or already cleaned up
+     */
+    [[nodiscard]]
+    auto status(uint64_t commandId) const -> std::optional<CommandStatus>;
+
+    /**
+     * @brief 等待命令进入终态（成功、失败或超时）
+     *        Wait until a command reaches a terminal state (acked, failed or timed out).
+     *
+     * @param commandId 命令ID / Command ID
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @return std::optional<CommandStatus> 等待结束时的命令状态 / Status when the wait ended
+     */
+    auto await(uint64_t commandId, std::chrono::milliseconds timeout) -> std::optional<CommandStatus>;
+
+    /**
+     * @brief 非阻塞地等待命令进入终态，完成或超时时调用回调
+     *        Wait for a terminal state without blocking; the callback runs on completion or timeout.
+     *
+     * 回调在回执线程或时间轮线程上执行，且不持有任何锁；适用于异步 RPC，避免占用服务线程。
+     * The callback runs on the acking thread or the wheel thread without any lock held; meant for async RPCs
+     * so no server thread is parked.
+     *
+     * @param commandId 命令ID / Command ID
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @param callback 完成回调 / Completion callback
+     */
+    void watch(uint64_t commandId, std::chrono::milliseconds timeout, CompletionCallback callback);
+
+    /**
+     * @brief 设备重新订阅后恢复其暂停的重试
+     *        Resume the parked retries of a device that subscribed again.
+     *
+     * @param deviceId 设备ID / Device ID
+     */
+    void resume(const std::string& deviceId);
+
+    /**
+     * @brief 推进所有分片的时间轮，处理到期的超时、重试与清理
+     *        Advance every shard's timing wheel, handling due timeouts, retries and cleanups.
+     *
+     * @param now 当前时间点 / Current time point
+     */
+    void tick(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 判断状态是否为终态
+     *        Whether a state is terminal.
+     */
+    static auto isTerminal(CommandState state) -> bool {
+        return state == CommandState::Acked || state == CommandState::Failed || state == CommandState::TimedOut;
+    }
+
+private:
+    using Watcher = std::pair<uint32_t, CompletionCallback>; // 等待者编号与回调 / Watcher number and callback
+
+    /**
+     * @brief 单条命令的跟踪记录
+     *        Tracking record of a single command.
+     */
+    struct Record {
+        std::string deviceId;          // 目标设备ID / Target device ID
+        OutboundCommand command;       // 命令内容，重发时使用 / Command content used for resends
+        CommandState state;            // 当前状态 / Current state
+        uint32_t attempts = 0;         // 已发送次数 / Delivery attempts
+        uint32_t generation = 0;       // 定时器代数，用于惰性取消 / Timer generation for lazy cancel
+        bool retryPending = false;     // 是否处于退避等待 / Waiting out a backoff
+        bool parked = false;           // 是否在等待设备订阅 / Waiting for the device to subscribe
+        int32_t code = 0;              // 回执码 / Ack code
+        std::string message;           // 回执信息 / Ack message
+        std::vector<Watcher> watchers; // 非阻塞等待者 / Non-blocking waiters
+    };
+
+    /**
+     * @brief 时间轮定时器数据
+     *        Timing wheel payload.
+     */
+    struct Timer {
+        uint64_t commandId;   // 命令ID / Command ID
+        uint32_t generation;  // 调度时的记录代数 / Record generation when scheduled
+        uint32_t watcher = 0; // 非0 时为等待者超时定时器 / Non-zero for a watcher timeout
+    };
+
+    /**
+     * @brief 待执行的完成回调
+     *        Completion callback due to run.
+     */
+    struct Notification {
+        CompletionCallback callback;         // 完成回调 / Completion callback
+        std::optional<CommandStatus> status; // 回调参数 / Callback argument
+    };
+
+    /**
+     * @brief 单个分片：互斥锁、待回执命令表与时间轮
+     *        One shard: mutex, pending-command table and timing wheel.
+     */
+    struct Shard {
+        Shard()
+            : wheel(kTICK, kWHEEL_SLOTS) {}
+
+        mutable std::mutex mutex;                                      // 保护本分片 / Guards this shard
+        std::condition_variable changed;                               // 命令进入终态时通知 / Signals terminal transitions
+        std::unordered_map<uint64_t, Record> records;                  // 命令ID到记录 / Command ID to record
+        TimingWheel<Timer> wheel;                                      // 超时与清理定时器 / Timeout and cleanup timers
+        uint32_t nextWatcher = 1;                                      // 下一个等待者编号 / Next watcher number
+        std::unordered_map<std::string, std::vector<uint64_t>> parked; // 设备暂停的重试 / Parked retries per device
+    };
+
+    /**
+     * @brief 待重发的命令
+     *        Command due for a resend.
+     */
+    struct Resend {
+        uint64_t commandId;      // 命令ID / Command ID
+        uint32_t generation;     // 退避结束时的记录代数 / Record generation when the backoff ended
+        std::string deviceId;    // 目标设备ID / Target device ID
+        OutboundCommand command; // 命令内容 / Command content
+    };
+
+    /**
+     * @brief 进入终态后待从设备队列撤回的命令
+     *        Command to withdraw from the device queue after reaching a terminal state.
+     */
+    struct Withdrawal {
+        uint64_t commandId;   // 命令ID / Command ID
+        std::string deviceId; // 目标设备ID / Target device ID
+    };
+
+    /**
+     * @brief 根据命令ID定位分片
+     *        Locate the shard of a command ID.
+     */
+    auto shardOf(uint64_t commandId) const -> Shard& {
+        return *mShards[commandId & (kSHARD_COUNT - 1)];
+    }
+
+    /**
+     * @brief 计算第 attempt 次发送失败后的退避时间
+     *        Backoff after the given failed attempt.
+     */
+    auto backoff(uint32_t attempt) const -> std::chrono::milliseconds;
+
+    /**
+     * @brief 在持锁状态下处理一个到期定时器
+     *        Handle one expired timer while holding the shard lock.
+     */
+    void onTimer(Shard& shard, const Timer& timer, Clock::time_point now, std::vector<Resend>& resends,
+                 std::vector<Withdrawal>& withdrawals, std::vector<Notification>& notifications);
+
+    /**
+     * @brief 在释放分片锁后发出退避结束的重试，设备未订阅时暂停，上一份副本仍在队列中时不再入队
+     *        Send the retries whose backoff ended, parking them while the device has no stream and skipping the
+     *        enqueue while the previous copy is still queued; called without the shard lock.
+     */
+    void retry(std::vector<Resend>& resends, Clock::time_point now);
+
+    /**
+     * @brief 在持锁状态下重新发送：计入一次发送并等待回执
+     *        Count one more delivery attempt and await its ack, with the shard lock held.
+     */
+    void rearm(Shard& shard, uint64_t commandId, Record& record, Clock::time_point now);
+
+    /**
+     * @brief 在持锁状态下将命令移出设备的暂停列表
+     *        Take a command off its device's parked list, with the shard lock held.
+     */
+    static void unpark(Shard& shard, uint64_t commandId, Record& record);
+
+    /**
+     * @brief 在持锁状态下将记录置为终态，并安排清理
+     *        Move a record to a terminal state and schedule its cleanup, with the shard lock held.
+     */
+    void finish(Shard& shard, uint64_t commandId, Record& record, CommandState state, Clock::time_point now,
+                std::vector<Notification>& notifications);
+
+    /**
+     * @brief 后台线程主循环
+     *        Background thread main loop.
+     */
+    void loop();
+
+    /**
+     * @brief 生成对外的状态快照
+     *        Build the public status snapshot.
+     */
+    static auto toStatus(uint64_t commandId, const Record& record) -> CommandStatus;
+
+private:
+    static constexpr size_t kSHARD_BITS = 6;                  // 命令ID中分片号的位数 / Shard bits in a command ID
+    static constexpr size_t kSHARD_COUNT = 1u << kSHARD_BITS; // 分片数量 / Number of shards
+    static constexpr std::chrono::milliseconds kTICK { 50 };  // 时间轮粒度 / Wheel granularity
+    static constexpr size_t kWHEEL_SLOTS = 1024;              // 时间轮槽位数 / Wheel slots
+
+    CommandOutbox& mOutbox;                      // 下行命令队列 / Outbound queues
+    CommandRetryPolicy mPolicy;                  // 重试策略 / Retry policy
+    std::vector<std::unique_ptr<Shard>> mShards; // 分片集合 / Shards
+    std::atomic<uint64_t> mSequence { 1 };       // 命令序号 / Command sequence
+    std::atomic<bool> mRunning { false };        // 后台线程运行标志 / Background thread flag
+    std::atomic<bool> mStopped { false };        // 已停止，等待者立即返回 / Stopped; waiters return at once
+    std::thread mTicker;                         // 推进时间轮的后台线程 / Thread advancing the wheels
+};
+
+IOT_NS_END
@@ -0,0 +1,398 @@
+#pragma once
+
+/**
+ * @brief 设备状态订阅（watch）扇出缓冲头文件
+ *        Header file for the fan-out buffer behind device state watches
+ *
+ * 设备管理器发出的状态变化事件写入一个有界环形缓冲，每个订阅者持有自己的读游标按需读取；
+ * 写入方从不等待订阅者，落后超过缓冲容量的订阅者按策略重新同步快照或被断开。
+ * Device manager transition events go into one bounded ring buffer and every watcher reads it through its own
+ * cursor; the writer never waits for a watcher, and a watcher that falls more than the buffer capacity behind is
+ * either resynchronised from a fresh snapshot or dropped, depending on its policy.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-02
+ */
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceEvent.h"
+#include "device/DeviceInfo.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 订阅过滤条件，各条件同时满足才匹配
+ *        Watch filter; a device matches when every given condition holds.
+ */
+struct DeviceWatchFilter {
+    std::unordered_set<std::string> deviceIds; // 只关注这些设备，为空表示不限 / Only these devices, empty for any
+    std::string idPrefix;                      // 设备ID前缀，为空表示不限 / Device ID prefix, empty for any
+    std::string viewer;                        // 只匹配对该用户可见的设备，为空表示不限 / Only devices visible to this user, empty for any
+
+    /**
+     * @brief 判断设备是否匹配过滤条件
+     *        Check whether a device matches the filter.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @return true 匹配 / Matches
+     */
+    [[nodiscard]]
+    auto matches(const std::string& deviceId) const -> bool {
+        if (!deviceIds.empty() && deviceIds.find(deviceId) == deviceIds.end()) {
+            return false;
+        }
+        return deviceId.compare(0, idPrefix.size(), idPrefix) == 0;
+    }
+
+    /**
+     * @brief 判断设备是否匹配过滤条件且对查看者可见
+     *        Check whether a device matches the filter and is visible to the viewer.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param owner 设备所有者，为空表示尚未绑定 / Device owner, empty when unbound
+     * @return true 匹配且可见 / Matches and visible
+     */
+    [[nodiscard]]
+    auto matches(const std::string& deviceId, const std::string& owner) const -> bool {
+        return (viewer.empty() || owner.empty() || owner == viewer) && matches(deviceId);
+    }
+};
+
+/**
+ * @brief 订阅者落后超过缓冲容量时的处理策略
+ *        What happens to a watcher that falls more than the buffer capacity behind.
+ */
+enum class WatchOverflowPolicy {
+    Resync, // 丢弃积压事件，以一份新快照代替（合并）/ Discard the backlog and send a fresh snapshot instead (conflate)
+    Drop,   // 断开订阅 / Drop the watcher
+};
+
+/**
+ * @brief 推送给订阅者的设备状态事件
+ *        Device state event delivered to a watcher.
+ */
+struct DeviceWatchEvent {
+    /**
+     * @brief 事件类型
+     *        Event type.
+     */
+    enum class Type {
+        Snapshot,      // 快照中单个设备的完整状态 / Full state of one device in a snapshot
+        Synced,        // 快照结束，之后均为增量事件 / End of a snapshot, incremental events follow
+        Online,        // 设备上线 / Device came online
+        Offline,       // 设备离线 / Device went offline
+        StatusChanged, // 上报的状态内容发生变化 / Reported status payload changed
+        RuleMatched,   // 状态上报命中了规则 / A status report matched a rule
+        Resync,        // 内部标记：订阅者读到后重新加载快照，从不发给客户端 / Internal marker: watchers reload a
+                       // snapshot on reading it; never delivered to clients
+    };
+
+    Type type = Type::Snapshot;                  // 事件类型 / Event type
+    std::string deviceId;                        // 设备ID，Synced 事件为空 / Device ID, empty for Synced
+    DeviceStatus status = DeviceStatus::UNKNOWN; // 设备在线状态 / Device status
+    std::string report;                          // 最近一次状态上报内容 / Latest status report
+    uint64_t sequence = 0;                       // 缓冲序号，快照事件为快照对应的序号 / Buffer sequence; for snapshots the sequence they reflect
+    std::string event;                           // 规则事件名，仅 RuleMatched 携带 / Rule event name, RuleMatched only
+    std::string owner;                           // 设备所有者，为空表示尚未绑定 / Device owner, empty when unbound
+};
+
+class DeviceWatchHub;
+
+/**
+ * @brief 单个订阅者：先读取订阅时的快照，再沿自己的游标读取增量事件
+ *        One watcher: reads the snapshot taken at subscription, then incremental events along its own cursor.
+ *
+ * poll / waitAndPoll 不可并发调用；就绪监听器与等待中的 waitAndPoll 只在订阅者已读到最新事件后才被唤醒一次，
+ * 因此落后的订阅者不会给写入方带来任何额外开销。
+ * poll / waitAndPoll must not run concurrently; the ready listener and a waiting waitAndPoll are woken once,
+ * only after the watcher has caught up, so a lagging watcher costs the writer nothing.
+ */
+class DeviceWatcher : public std::enable_shared_from_this<DeviceWatcher> {
+public:
+    /**
+     * @brief 构造函数，由 DeviceWatchHub::subscribe 调用
+     *        Constructor, called by DeviceWatchHub::subscribe.
+     *
+     * @param hub 所属扇出缓冲 / Owning hub
+     * @param filter 过滤条件 / Watch filter
+     * @param policy 溢出策略 / Overflow policy
+     */
+    DeviceWatcher(DeviceWatchHub& hub, DeviceWatchFilter filter, WatchOverflowPolicy policy);
+
+    /**
+     * @brief 析构函数，确保已退订
+     *        Destructor: makes sure the watcher is unsubscribed.
+     */
+    ~DeviceWatcher();
+
+    DeviceWatcher(const DeviceWatcher&) = delete;
+    auto operator=(const DeviceWatcher&) -> DeviceWatcher& = delete;
+
+    /**
+     * @brief 不等待，取出一批匹配的事件
+     *        Take one batch of matching events without waiting.
+     *
+     * @param out 输出的事件批次 / Output batch
+     * @param maxBatch 单批次事件上限 / Maximum events per batch
+     * @return true 订阅有效 / Watch still valid
+     * @return false 订阅已关闭，或按 Drop 策略因落后过多被断开 / Closed, or dropped for lagging under the Drop policy
+     */
+    auto poll(std::vector<DeviceWatchEvent>& out, size_t maxBatch) -> bool;
+
+    /**
+     * @brief 等待事件到达并取出一批
+     *        Wait for events and take one batch.
+     *
+     * 有事件时立即返回，超时只用于让调用方检查流是否已取消。
+     * Returns as soon as events are available; the timeout only lets the caller check for cancellation.
+     *
+     * @param out 输出的事件批次 / Output batch
+     * @param maxBatch 单批次事件上限 / Maximum events per batch
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @return 与 poll 相同 / Same as poll
+     */
+    auto waitAndPoll(std::vector<DeviceWatchEvent>& out, size_t maxBatch, std::chrono::milliseconds timeout) -> bool;
+
+    /**
+     * @brief 设置事件就绪监听器，供异步推送流代替阻塞等待
+     *        Install a ready listener, letting async streams replace the blocking wait.
+     *
+     * 监听器在写入方线程上、释放缓冲锁之后调用，不能阻塞；新监听器替换旧监听器，传入空函数即解除监听。
+     * The listener runs on the writer's thread with the buffer lock released and must not block; a new listener
+     * replaces the previous one and an empty function detaches.
+     *
+     * @param listener 就绪监听器 / Ready listener
+     * @return uint64_t 监听器标识，供 clearReadyListener 使用 / Listener token for clearReadyListener
+     */
+    auto setReadyListener(std::function<void()> listener) -> uint64_t;
+
+    /**
+     * @brief 解除监听，仅当当前监听器仍是 token 标识的那个时生效
+     *        Detach the listener, only if it is still the one identified by the token.
+     *
+     * @param token setReadyListener 返回的标识 / Token returned by setReadyListener
+     */
+    void clearReadyListener(uint64_t token);
+
+    /**
+     * @brief 退订，之后 poll 返回 false；可重复调用
+     *        Unsubscribe; poll returns false afterwards. Safe to call more than once.
+     */
+    void close();
+
+    /**
+     * @brief 因落后过多而重新同步快照的次数
+     *        Number of snapshot resyncs caused by lagging.
+     */
+    [[nodiscard]]
+    auto resyncCount() const -> uint64_t {
+        return mResyncs;
+    }
+
+private:
+    friend class DeviceWatchHub;
+
+    /**
+     * @brief 加载给定序号处的快照，末尾追加 Synced 事件
+     *        Load the snapshot at the given sequence, followed by a Synced event.
+     */
+    void loadSnapshot(uint64_t sequence);
+
+    /**
+     * @brief 从待发送的快照中取出事件
+     *        Move events out of the pending snapshot.
+     */
+    void drainSnapshot(std::vector<DeviceWatchEvent>& out, size_t maxBatch);
+
+    /**
+     * @brief 唤醒等待中的 waitAndPoll 并通知就绪监听器
+     *        Wake a waiting waitAndPoll and notify the ready listener.
+     */
+    void notifyReady();
+
+private:
+    DeviceWatchHub& mHub;                    // 所属扇出缓冲 / Owning hub
+    const DeviceWatchFilter mFilter;         // 过滤条件 / Watch filter
+    const WatchOverflowPolicy mPolicy;       // 溢出策略 / Overflow policy
+    uint64_t mCursor = 0;                    // 已读取的最后一个序号，受缓冲锁保护 / Last sequence read, guarded by the hub lock
+    bool mArmed = false;                     // 是否等待唤醒，受缓冲锁保护 / Waiting for a wakeup, guarded by the hub lock
+    bool mClosed = false;                    // 是否已退订，受缓冲锁保护 / Unsubscribed, guarded by the hub lock
+    std::vector<DeviceWatchEvent> mSnapshot; // 待发送的快照 / Pending snapshot
+    size_t mSnapshotPos = 0;                 // 快照发送位置 / Position in the pending snapshot
+    uint64_t mResyncs = 0;                   // 重新同步次数 / Resync count
+    std::mutex mMutex;                       // 保护唤醒标记 / Guards the wakeup flag
+    std::condition_variable mCondition;      // 事件就绪通知 / Signals available events
+    bool mSignalled = false;                 // 是否已被唤醒 / Woken since the last wait
+    std::mutex mListenerMutex;               // 保护就绪监听器 / Guards the ready listener
+    std::function<void()> mListener;         // 就绪监听器 / Ready listener
+    uint64_t mListenerToken = 0;             // 当前监听器标识 / Token of the current listener
+};
+
+/**
+ * @brief 设备状态事件的扇出缓冲
+ *        Fan-out buffer of device state events.
+ *
+ * 所有订阅者共享同一个有界环形缓冲，事件只存一份；写入只在缓冲锁内存放一个指针并递增序号，
+ * 与订阅者数量和读取速度无关。没有订阅者时写入直接返回。
+ * All watchers share one bounded ring and each event is stored once; a write only stores a pointer and bumps
+ * the sequence under the buffer lock, independent of watcher count and speed. With no watchers a write returns
+ * at once.
+ */
+class DeviceWatchHub {
+public:
+    /**
+     * @brief 快照提供函数：按过滤条件生成设备当前状态，事件序号统一填为给定序号
+     *        Snapshot provider: emits the current state of matching devices, stamped with the given sequence.
+     */
+    using SnapshotProvider = std::function<void(const DeviceWatchFilter&, uint64_t, std::vector<DeviceWatchEvent>&)>;
+
+    /**
+     * @brief 订阅者数量在 0 与非 0 之间切换时的回调，参数为是否有订阅者
+     *        Callback run when the watcher count switches between zero and non-zero; the argument tells which.
+     */
+    using ActivityListener = std::function<void(bool)>;
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param capacity 环形缓冲容量（事件数）/ Ring capacity in events
+     */
+    explicit DeviceWatchHub(size_t capacity = kDEFAULT_CAPACITY);
+
+    /**
+     * @brief 设置快照提供函数，须在第一次订阅前设置
+     *        Install the snapshot provider; must be set before the first subscription.
+     */
+    void setSnapshotProvider(SnapshotProvider provider);
+
+    /**
+     * @brief 设置订阅者活跃状态回调，须在第一次订阅前设置
+     *        Install the activity listener; must be set before the first subscription.
+     */
+    void setActivityListener(ActivityListener listener);
+
+    /**
+     * @brief 新建订阅者，其快照反映订阅时刻之后的状态
+     *        Create a watcher whose snapshot reflects the state as of subscription.
+     *
+     * @param filter 过滤条件 / Watch filter
+     * @param policy 溢出策略 / Overflow policy
+     * @return std::shared_ptr<DeviceWatcher> 订阅者 / The watcher
+     */
+    auto subscribe(DeviceWatchFilter filter, WatchOverflowPolicy policy) -> std::shared_ptr<DeviceWatcher>;
+
+    /**
+     * @brief 写入一个设备事件并唤醒已读到最新位置的订阅者
+     *        Publish a device event and wake the watchers that had caught up.
+     *
+     * @param event 设备事件 / Device event
+     */
+    void publish(const DeviceEvent& event);
+
+    /**
+     * @brief 写入一个规则事件：设备的状态上报命中了规则
+     *        Publish a rule event: a status report of the device matched a rule.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param owner 设备所有者 / Device owner
+     * @param event 规则事件名 / Rule event name
+     * @param report 命中规则的状态上报内容 / Status report that matched
+     */
+    void publishRuleEvent(const std::string& deviceId, const std::string& owner, const std::string& event,
+                          const std::string& report);
+
+    /**
+     * @brief 当前订阅者数量
+     *        Current number of watchers.
+     */
+    [[nodiscard]]
+    auto watcherCount() const -> size_t {
+        return mWatchers.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 订阅者因落后过多而溢出（重新同步或断开）的累计次数
+     *        Total number of watcher overflows, whether resynced or dropped.
+     */
+    [[nodiscard]]
+    auto overflowCount() const -> uint64_t {
+        return mOverflows.load(std::memory_order_relaxed);
+    }
+
+    /// 默认环形缓冲容量 / Default ring capacity
+    static constexpr size_t kDEFAULT_CAPACITY = 4096;
+
+    /// 单次推送的事件批次上限 / Maximum events per pushed batch
+    static constexpr size_t kMAX_BATCH = 256;
+
+private:
+    friend class DeviceWatcher;
+
+    using EventPtr = std::shared_ptr<const DeviceWatchEvent>;
+
+    /**
+     * @brief 读取结果
+     *        Outcome of one read.
+     */
+    enum class ReadResult {
+        More,     // 还有未读事件 / More events pending
+        CaughtUp, // 已读到最新位置，订阅者已进入等待唤醒状态 / Caught up, the watcher is armed for a wakeup
+        Overflow, // 未读事件已被覆盖 / Unread events were overwritten
+        Closed,   // 订阅者已退订 / The watcher is closed
+    };
+
+    /**
+     * @brief 将事件存入环形缓冲并唤醒已读到最新位置的订阅者
+     *        Store an event in the ring and wake the watchers that had caught up.
+     */
+    void append(std::shared_ptr<DeviceWatchEvent> entry);
+
+    /**
+     * @brief 沿订阅者游标读取一段事件
+     *        Read a run of events along the watcher's cursor.
+     */
+    auto read(DeviceWatcher& watcher, std::vector<EventPtr>& out, size_t maxCount) -> ReadResult;
+
+    /**
+     * @brief 将订阅者游标移到最新位置，返回该位置的序号
+     *        Move the watcher's cursor to the head and return that sequence.
+     */
+    auto rewind(DeviceWatcher& watcher) -> uint64_t;
+
+    /**
+     * @brief 生成快照
+     *        Produce a snapshot.
+     */
+    void snapshot(const DeviceWatchFilter& filter, uint64_t sequence, std::vector<DeviceWatchEvent>& out) const;
+
+    /**
+     * @brief 退订
+     *        Unsubscribe a watcher.
+     */
+    void unsubscribe(DeviceWatcher& watcher);
+
+private:
+    const size_t mCapacity;                           // 环形缓冲容量 / Ring capacity
+    mutable std::mutex mMutex;                        // 保护环形缓冲、序号与等待唤醒列表 / Guards the ring, sequence and armed list
+    std::vector<EventPtr> mRing;                      // 环形缓冲，按序号取模存放 / Ring indexed by sequence modulo capacity
+    uint64_t mHead = 0;                               // 最新事件序号 / Sequence of the newest event
+    std::vector<std::weak_ptr<DeviceWatcher>> mArmed; // 已读到最新位置、等待唤醒的订阅者 / Caught-up watchers awaiting a wakeup
+    std::atomic<size_t> mWatchers { 0 };              // 订阅者数量 / Watcher count
+    std::atomic<uint64_t> mOverflows { 0 };           // 溢出次数 / Overflow count
+    SnapshotProvider mProvider;                       // 快照提供函数 / Snapshot provider
+    ActivityListener mActivity;                       // 订阅者活跃状态回调 / Activity listener
+};
+
+IOT_NS_END
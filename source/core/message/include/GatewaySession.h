@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ReplayGuard.h"
+#include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include "device/DeviceHandle.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 网关流中已绑定索引的设备
+ *        A device bound to an index on a gateway stream.
+ *
+ * 绑定时解析一次设备句柄与防重放状态，之后该设备的心跳、上报与回执只凭索引处理，不再按设备ID查表。
+ * The device handle and replay state are resolved once at binding time; later heartbeats, reports and acks of
+ * the device are handled by index without any lookup by device ID.
+ */
+struct GatewayDevice {
+    std::string deviceId;                         // 设备唯一标识符 / Device ID
+    DeviceHandle handle = kINVALID_DEVICE_HANDLE; // 缓存的设备句柄 / Cached device handle
+    std::shared_ptr<DeviceReplayState> replay;    // 缓存的防重放状态 / Cached replay state
+};
+
+/**
+ * @brief 网关会话，绑定一条多路复用流与其用户、鉴权结果及流内设备索引表
+ *        Gateway session binding one multiplexed stream to its user, auth verdict and per-stream device table.
+ *
+ * 网关在一条双向流上为成千上万个设备转发消息：鉴权在流上只做一次，设备ID只在首次出现时传输，
+ * 之后以紧凑的流内索引引用。会话过期后重新鉴权，已绑定的索引保持不变。
+ * A gateway forwards messages for thousands of devices over one bidirectional stream: authentication happens
+ * once per stream and a device ID travels only on first mention, after which a compact per-stream index refers
+ * to it. Re-authentication after expiry keeps the bound indexes.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-30
+ */
+struct GatewaySession {
+    using Clock = std::chrono::steady_clock;
+
+    /// 单条流可绑定的设备索引上限，防止稀疏的大索引占用内存 / Index limit per stream, bounding the table size
+    static constexpr uint32_t kMAX_DEVICES = 1u << 16;
+
+    std::string userId;                 // 会话绑定的用户ID / User bound to the session
+    bool authenticated = false;         // 鉴权结果 / Auth verdict
+    Clock::time_point expiresAt;        // 会话过期时间点 / Expiry time point
+    std::vector<GatewayDevice> devices; // 按流内索引存放的设备 / Devices by per-stream index
+
+    /**
+     * @brief 按流内索引查找已绑定的设备
+     *        Look up a bound device by its per-stream index.
+     *
+     * @param index 流内设备索引 / Per-stream device index
+     * @return GatewayDevice* 设备，索引未绑定时为 nullptr / The device, nullptr if the index is unbound
+     */
+    [[nodiscard]]
+    auto device(uint32_t index) -> GatewayDevice* {
+        if (index >= devices.size() || devices[index].deviceId.empty()) {
+            return nullptr;
+        }
+        return &devices[index];
+    }
+
+    /**
+     * @brief 判断会话在给定时间点是否已过期
+     *        Check whether the session has expired at the given time point.
+     *
+     * @param now 当前时间点 / Current time point
+     * @return true 已过期 / Expired
+     */
+    [[nodiscard]]
+    auto expired(Clock::time_point now = Clock::now()) const -> bool {
+        return now >= expiresAt;
+    }
+};
+
+/**
+ * @brief 网关帧中携带的一批设备消息，已从 protobuf 转换为路由器的输入
+ *        A batch of device messages carried by one gateway frame, converted from protobuf for the router.
+ *
+ * 所有条目以流内设备索引引用设备；新索引由同一批次的 bindings 先行绑定。
+ * Every entry refers to its device by per-stream index; new indexes are bound first by the batch's bindings.
+ */
+struct GatewayBatch {
+    /// 索引绑定 / Index binding
+    struct Binding {
+        uint32_t index = 0;   // 流内设备索引 / Per-stream index
+        std::string deviceId; // 设备ID / Device ID
+    };
+
+    /// 心跳 / Heartbeat
+    struct Heartbeat {
+        uint32_t device = 0;   // 流内设备索引 / Per-stream index
+        int64_t timestamp = 0; // 时间戳（毫秒），0 表示未提供 / Timestamp in ms, 0 when absent
+    };
+
+    /// 状态上报 / Status report
+    struct Status {
+        uint32_t device = 0;   // 流内设备索引 / Per-stream index
+        std::string status;    // 状态内容 / Status payload
+        int64_t timestamp = 0; // 时间戳（毫秒），0 表示未提供 / Timestamp in ms, 0 when absent
+        StatusDetails details; // 变化的属性，空值表示删除 / Changed attributes, an empty value removes one
+    };
+
+    /// 命令回执 / Command ack
+    struct Ack {
+        uint32_t device = 0;    // 流内设备索引 / Per-stream index
+        uint64_t commandId = 0; // 命令ID / Command ID
+        int32_t code = 0;       // 回执码，0 表示执行成功 / Ack code, 0 means executed
+        std::string message;    // 回执信息 / Ack message
+    };
+
+    std::vector<Binding> bindings;     // 本批新绑定的设备 / Devices bound by this batch
+    std::vector<Heartbeat> heartbeats; // 心跳 / Heartbeats
+    std::vector<Status> statuses;      // 状态上报 / Status reports
+    std::vector<Ack> acks;             // 命令回执 / Command acks
+};
+
+/**
+ * @brief 网关批次的处理结果
+ *        Outcome of handling a gateway batch.
+ */
+struct GatewayBatchResult {
+    bool authenticated = false;            // 会话是否有效，false 时批次未被处理 / Session valid; false means nothing ran
+    uint32_t accepted = 0;                 // 被受理的条目数 / Entries accepted
+    uint32_t rejected = 0;                 // 被拒绝的条目数 / Entries rejected
+    std::vector<uint32_t> rejectedDevices; // 被拒绝条目的设备索引，按条目顺序 / Device index of each rejected entry
+};
+
+IOT_NS_END
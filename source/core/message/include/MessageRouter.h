@@ -12,14 +12,40 @@
  * @date 2025-06-07
  */
 
+#include "CommandDeduplicator.h"
+#include "CommandOutbox.h"
+#include "CommandTracker.h"
 #include "DeviceManagerFactory.h"
+#include "DeviceWatchHub.h"
+#include "GatewaySession.h"
 #include "MessageTask.h"
+#include "ReplayGuard.h"
+#include "RouterOptions.h"
+#include "RuleEngine.h"
+#include "StatusAggregator.h"
+#include "StatusBatch.h"
+#include "StreamSession.h"
 #include "UserManagerFactory.h"
 #include "handler/HandlerThread.h"
 #include "task/GenericTask.h"
 
+#include "common/CoalescingSlot.h"
 #include "common/NameSpaceDef.h"
+#include "common/ShardedMap.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
+
+/// 路由器默认使用的用户管理器插件名称（Default user manager plugin used by the router）
+#ifdef ENABLE_AUTH_MOCK
+#define MESSAGE_ROUTER_USER_MANAGER USER_MANAGER_MOCK
+#else
+#define MESSAGE_ROUTER_USER_MANAGER USER_MANAGER_DEFAULT
+#endif
 
 IOT_NS_BEGIN
 
@@ -35,14 +61,18 @@ public:
     /**
      * @brief 构造函数，初始化用户管理器、设备管理器和消息线程。
      *        Constructor: initializes user/device managers and handler thread.
+     *
+     * @param userManagerName 用户管理器插件名称 / Name of the user manager plugin used for authentication
+     * @param options 运行时调优参数 / Runtime tuning options
      */
-    MessageRouter();
+    explicit MessageRouter(const std::string& userManagerName = MESSAGE_ROUTER_USER_MANAGER,
+                           const RouterOptions& options = {});
 
     /**
-     * @brief 析构函数（使用默认实现）
-     *        Destructor (default implementation)
+     * @brief 析构函数，解除设备事件监听
+     *        Destructor: detaches the device event listener.
      */
-    ~MessageRouter() = default;
+    ~MessageRouter();
 
     /**
      * @brief 处理来自用户的指令消息
@@ -52,10 +82,119 @@ public:
      * @param command 指令内容 / Command content
      * @param userId 用户ID / User ID
      * @param token 认证token / Authentication token
+     * @param params 命令参数 / Command parameters
+     * @param timestamp 命令时间戳（毫秒），0 表示未提供 / Command timestamp in ms, 0 when absent
      * @return std::string 响应结果 / Response string
      */
     auto handleCommand(const std::string& deviceId, const std::string& command, const std::string& userId,
-                       const std::string& token) -> std::string;
+                       const std::string& token, const CommandParams& params = {},
+                       int64_t timestamp = 0) -> std::string;
+
+    /**
+     * @brief 提交指令并开始跟踪其回执
+     *        Submit a command and start tracking its acknowledgment.
+     *
+     * 设备须已注册且对该用户可见，否则以 "Unauthorized" 拒绝。
+     * The device must be registered and visible to the user, otherwise it is refused as "Unauthorized".
+     *
+     * @param deviceId 目标设备ID / Target device ID
+     * @param command 指令内容 / Command content
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param params 命令参数 / Command parameters
+     * @param idempotencyKey 幂等键，窗口期内重复提交返回首次结果 / Idempotency key; duplicates inside the
+     *        deduplication window replay the original result
+     * @param timestamp 命令时间戳（毫秒），重放的命令被拒绝 / Command timestamp in ms; replays are rejected
+     * @return CommandReceipt 提交结果，包含分配的命令ID / Submission result carrying the assigned command ID
+     */
+    auto submitCommand(const std::string& deviceId, const std::string& command, const std::string& userId,
+                       const std::string& token, const CommandParams& params = {},
+                       const std::string& idempotencyKey = "", int64_t timestamp = 0) -> CommandReceipt;
+
+    /**
+     * @brief 处理设备对指令的回执
+     *        Handle a device's acknowledgment of a command.
+     *
+     * @param deviceId 回执设备ID / Acking device ID
+     * @param commandId 命令ID / Command ID
+     * @param code 回执码，0 表示执行成功 / Ack code, 0 means executed
+     * @param message 回执信息 / Ack message
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @return true 回执被接受 / Ack accepted
+     * @return false 鉴权失败、命令不存在或已是终态 / Auth failed, unknown command or already terminal
+     */
+    auto acknowledgeCommand(const std::string& deviceId, uint64_t commandId, int32_t code, const std::string& message,
+                            const std::string& userId, const std::string& token) -> bool;
+
+    /**
+     * @brief 标记命令已写入设备流
+     *        Mark a command as written to the device stream.
+     *
+     * @param commandId 命令ID / Command ID
+     */
+    void markCommandDelivered(uint64_t commandId);
+
+    /**
+     * @brief 查询命令状态
+     *        Query the status of a command.
+     *
+     * @param commandId 命令ID / Command ID
+     * @return std::optional<CommandStatus> 命令状态 / Command status
+     */
+    auto commandStatus(uint64_t commandId) const -> std::optional<CommandStatus>;
+
+    /**
+     * @brief 等待命令进入终态
+     *        Wait until a command reaches a terminal state.
+     *
+     * @param commandId 命令ID / Command ID
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @return std::optional<CommandStatus> 等待结束时的命令状态 / Status when the wait ended
+     */
+    auto awaitCommand(uint64_t commandId, std::chrono::milliseconds timeout) -> std::optional<CommandStatus>;
+
+    /**
+     * @brief 非阻塞地等待命令进入终态，供异步 RPC 使用
+     *        Wait for a terminal state without blocking, for async RPCs.
+     *
+     * @param commandId 命令ID / Command ID
+     * @param timeout 最长等待时间 / Maximum wait time
+     * @param callback 完成或超时时的回调 / Callback on completion or timeout
+     */
+    void watchCommand(uint64_t commandId, std::chrono::milliseconds timeout,
+                      CommandTracker::CompletionCallback callback);
+
+    /**
+     * @brief 获取设备的下行命令队列，不登记投递流
+     *        Get the outbound command queue of a device without registering a delivery stream.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @return std::shared_ptr<DeviceOutbox> 设备下行队列 / Device outbound queue
+     */
+    auto attachOutbox(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox>;
+
+    /**
+     * @brief 设备订阅流开始时登记到设备的下行命令队列
+     *        Register a device subscription stream on the outbound command queue of the device.
+     *
+     * 设备未订阅期间暂停的重试在此恢复。订阅流结束时必须调用 unsubscribeOutbox()，否则队列不会被回收。
+     * Retries paused while the device had no stream resume here. The stream must call unsubscribeOutbox() when
+     * it ends, otherwise the queue is never reclaimed.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @return std::shared_ptr<DeviceOutbox> 设备下行队列 / Device outbound queue
+     */
+    auto subscribeOutbox(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox>;
+
+    /**
+     * @brief 设备订阅流结束时退订，队列已空且没有其他订阅流时被回收
+     *        Unsubscribe an ending device stream; the queue is reclaimed once empty and without other streams.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param outbox subscribeOutbox() 返回的队列 / Queue returned by subscribeOutbox()
+     */
+    void unsubscribeOutbox(const std::string& deviceId, const std::shared_ptr<DeviceOutbox>& outbox);
 
     /**
      * @brief 处理设备上报的状态信息
@@ -65,9 +204,34 @@ public:
      * @param status 状态内容 / Status string
      * @param userId 用户ID / User ID
      * @param token 认证token / Authentication token
+     * @param timestamp 上报时间戳（毫秒），0 表示未提供 / Report timestamp in ms, 0 when absent
+     * @param details 变化的结构化属性，与已有属性合并，空值表示删除 / Changed attributes, merged into the stored
+     *                ones; an empty value removes one
+     * @return true 上报已受理 / Report accepted
+     * @return false 鉴权失败、设备归属其他用户、设备存储出错或重放的上报 / Auth failed, device owned by another
+     *         user, device storage failed, or replay
+     */
+    auto handleStatusReport(const std::string& deviceId, const std::string& status, const std::string& userId,
+                            const std::string& token, int64_t timestamp = 0, StatusDetails details = {}) -> bool;
+
+    /**
+     * @brief 批量处理设备状态上报（批量入口）
+     *        Handle a batch of device status reports (batched entry point).
+     *
+     * 整批只校验一次 Token，逐条校验设备归属与防重放后一次性交给设备管理器的批量接口，在调用线程上同步完成，
+     * 因此结果中可以带回每条被拒绝的下标，包括未能写入日志的条目；设备存储出错时整批被拒绝。状态内容会从批次中移走。
+     * The token is validated once per batch; after the per-entry ownership and replay checks the batch goes to the
+     * device manager's batched call in one go, synchronously on the calling thread, so the result can carry the index
+     * of every rejected entry, including those that could not be logged; while device storage is failed the whole
+     * batch is refused. Status payloads are moved out of the batch.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param updates 状态上报批次 / Status updates
+     * @return StatusBatchResult 聚合结果 / Aggregated result
      */
-    void handleStatusReport(const std::string& deviceId, const std::string& status, const std::string& userId,
-                            const std::string& token);
+    auto handleStatusBatch(const std::string& userId, const std::string& token,
+                           std::vector<DeviceStatusUpdate>& updates) -> StatusBatchResult;
 
     /**
      * @brief 处理设备心跳包
@@ -76,10 +240,198 @@ public:
      * @param deviceId 设备ID / Device ID
      * @param userId 用户ID / User ID
      * @param token 认证token / Authentication token
+     * @param timestamp 心跳时间戳（毫秒），0 表示未提供 / Heartbeat timestamp in ms, 0 when absent
+     * @return true 心跳有效 / Heartbeat accepted
+     * @return false 鉴权失败、设备归属其他用户或重放 / Auth failed, device owned by another user, or replay
+     */
+    auto handleHeartbeat(const std::string& deviceId, const std::string& userId, const std::string& token,
+                         int64_t timestamp = 0) -> bool;
+
+    /**
+     * @brief 为心跳流建立会话，仅在此处校验一次用户 Token
+     *        Open a session for a heartbeat stream; the user token is validated only here.
+     *
+     * 设备已归属其他用户时会话不通过鉴权。
+     * The session fails authentication when the device is already owned by another user.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @return std::shared_ptr<StreamSession> 会话对象，鉴权结果记录在 authenticated 中
+     *         Session object; the auth verdict is recorded in `authenticated`
+     */
+    auto openSession(const std::string& deviceId, const std::string& userId,
+                     const std::string& token) -> std::shared_ptr<StreamSession>;
+
+    /**
+     * @brief 基于已建立会话处理心跳（快速路径，仅检查会话是否过期）
+     *        Handle a heartbeat on an established session (fast path, only checks expiry).
+     *
+     * 心跳时间戳直接写入会话缓存的设备槽位，不经过任务队列，也不加锁；
+     * 只有设备状态变化（离线→在线）才会作为事件派发到处理线程。
+     * The timestamp is stored straight into the session's cached device slot with no queue and no lock;
+     * only state transitions (offline→online) are dispatched to the handler thread as events.
+     *
+     * @param session 心跳流会话 / Heartbeat stream session
+     * @param timestamp 心跳时间戳（毫秒），0 表示未提供 / Heartbeat timestamp in ms, 0 when absent
      * @return true 心跳有效 / Heartbeat accepted
-     * @return false 心跳无效或失败 / Heartbeat rejected or failed
+     * @return false 会话未通过鉴权、已过期（需要重新建立会话）或心跳被判定为重放
+     *         Session unauthenticated or expired (reopen required), or the heartbeat is a replay
      */
-    auto handleHeartbeat(const std::string& deviceId, const std::string& userId, const std::string& token) -> bool;
+    auto handleHeartbeat(const StreamSession& session, int64_t timestamp = 0) -> bool;
+
+    /**
+     * @brief 为网关多路复用流鉴权（或在会话过期后重新鉴权），已绑定的设备索引保持不变
+     *        Authenticate a gateway multiplexing stream, or re-authenticate it after expiry; bound indexes are kept.
+     *
+     * @param session 网关会话 / Gateway session
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @return true 鉴权通过，会话有效期重新计算 / Authenticated, expiry restarted
+     */
+    auto authenticateGateway(GatewaySession& session, const std::string& userId, const std::string& token) -> bool;
+
+    /**
+     * @brief 处理网关帧中的一批设备消息（批量入口）
+     *        Handle the device messages of one gateway frame (batched entry point).
+     *
+     * 先绑定新的设备索引，再依次处理心跳、状态上报与命令回执；鉴权只检查会话，不再逐条校验 Token。
+     * 心跳直接写入绑定时缓存的设备槽位，状态上报的负载被移入处理任务，批次中的字符串因此会被取走。
+     * New indexes are bound first, then heartbeats, status reports and command acks run in that order; only the
+     * session is checked, never a per-entry token. Heartbeats store straight into the slots cached at binding
+     * time and status payloads are moved into their tasks, so strings in the batch are consumed.
+     *
+     * @param session 网关会话 / Gateway session
+     * @param batch 设备消息批次 / Batch of device messages
+     * @return GatewayBatchResult 受理与拒绝的条目统计 / Accepted and rejected entry counts
+     */
+    auto handleGatewayBatch(GatewaySession& session, GatewayBatch& batch) -> GatewayBatchResult;
+
+    /**
+     * @brief 网关流结束，对其绑定的所有设备执行断开处理
+     *        Gateway stream ended: handle the disconnect of every device bound to it.
+     *
+     * @param session 网关会话 / Gateway session
+     */
+    void closeGatewaySession(const GatewaySession& session);
+
+    /**
+     * @brief 订阅设备状态：先推送匹配设备的当前状态，再推送上线、离线与状态内容变化的增量事件
+     *        Watch device state: the current state of matching devices first, then online, offline and
+     *        status-change events.
+     *
+     * 事件由设备管理器在上报与心跳线程上写入共享的扇出缓冲，订阅者各自按游标读取，写入方从不等待订阅者。
+     * Events are written into the shared fan-out buffer on the report and heartbeat threads and each watcher
+     * reads through its own cursor, so the writer never waits for a watcher.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param filter 过滤条件 / Watch filter
+     * @param policy 落后过多时的处理策略 / Policy for a watcher that falls too far behind
+     * @return std::shared_ptr<DeviceWatcher> 订阅者，鉴权失败时为空 / The watcher, nullptr if auth failed
+     */
+    auto watchDevices(const std::string& userId, const std::string& token, DeviceWatchFilter filter,
+                      WatchOverflowPolicy policy = WatchOverflowPolicy::Resync) -> std::shared_ptr<DeviceWatcher>;
+
+    /**
+     * @brief 按ID批量查询设备
+     *        Look up devices by ID.
+     *
+     * 只读取注册表槽位，不经过处理线程；状态已按心跳超时折算。
+     * Reads the registry slots directly, never a handler thread; status is adjusted for the heartbeat timeout.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param deviceIds 待查询的设备ID / Device IDs to look up
+     * @param found 找到的设备，按请求顺序 / Devices found, in request order
+     * @param missing 未注册或归属其他用户的设备ID / IDs of unregistered devices or of other users' devices
+     * @return bool 鉴权是否成功 / Whether authentication succeeded
+     */
+    auto getDevices(const std::string& userId, const std::string& token, const std::vector<std::string>& deviceIds,
+                    std::vector<DeviceRecord>& found, std::vector<std::string>& missing) -> bool;
+
+    /**
+     * @brief 分页列出匹配查询条件的设备
+     *        List devices matching a query, one page at a time.
+     *
+     * 只列出归属调用者或尚未绑定所有者的设备。
+     * Only devices owned by the caller or by nobody are listed.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param query 过滤条件、游标与每页数量 / Filters, cursor and page size
+     * @param outPage 输出的一页结果 / Output page
+     * @return DeviceQueryStatus 查询结果状态 / Outcome of the query
+     */
+    auto listDevices(const std::string& userId, const std::string& token, const DeviceQuery& query,
+                     DevicePage& outPage) -> DeviceQueryStatus;
+
+    /**
+     * @brief 读取设备某个数值属性的历史记录
+     *        Read the recorded history of a numeric attribute of a device.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param query 设备、属性、时间范围与降采样步长 / Device, attribute, time range and downsampling step
+     * @param outPoints 按时间排序的输出点 / Output points in time order
+     * @return DeviceQueryStatus 查询结果状态，设备未注册时为 NotFound / Outcome, NotFound for an unknown device
+     */
+    auto getDeviceHistory(const std::string& userId, const std::string& token, const HistoryQuery& query,
+                          std::vector<HistoryPoint>& outPoints) -> DeviceQueryStatus;
+
+    /**
+     * @brief 查询状态上报的窗口聚合结果
+     *        Query the windowed aggregates of status reports.
+     *
+     * 结果由各线程的部分聚合合并而来，代价与设备分组数成正比，与设备数无关。
+     * Results are merged from per-thread partial aggregates, at a cost proportional to the number of device
+     * groups rather than devices.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param query 聚合名称、分位点与窗口选择 / Aggregation name, quantiles and window choice
+     * @param out 输出的窗口结果 / Output window
+     * @return DeviceQueryStatus 查询结果状态，聚合名称未配置时为 NotFound / Outcome, NotFound for an unknown
+     *         aggregation
+     */
+    auto getAggregates(const std::string& userId, const std::string& token, const AggregateQuery& query,
+                       AggregateWindow& out) -> DeviceQueryStatus;
+
+    /**
+     * @brief 按状态统计已注册设备数量
+     *        Count registered devices per status.
+     *
+     * 读取设备管理器随状态变化维护的计数器，不扫描注册表。
+     * Reads the counters the device manager keeps with every transition, without scanning the registry.
+     *
+     * @param userId 用户ID / User ID
+     * @param token 认证token / Authentication token
+     * @param outCounts 输出的数量 / Output counts
+     * @return DeviceQueryStatus 查询结果状态，设备管理器不支持计数时为 NotFound / Outcome, NotFound when the
+     *         device manager keeps no counters
+     */
+    auto countDevices(const std::string& userId, const std::string& token, DeviceCounts& outCounts)
+        -> DeviceQueryStatus;
+
+    /**
+     * @brief 开启或关闭状态上报与心跳的合并模式
+     *        Enable or disable coalescing of status reports and heartbeats.
+     *
+     * 开启后同一设备尚未处理的状态上报（或心跳）被新消息原地替换，不再追加队列任务，
+     * 处理线程积压量受设备数量约束而不是消息速率。
+     * When enabled, a device's unprocessed status report (or heartbeat) is replaced in place by a newer one
+     * instead of adding another queue entry, so the worker backlog is bounded by device count, not message rate.
+     *
+     * @param enabled 是否开启 / Whether coalescing is enabled
+     */
+    void setCoalescing(bool enabled);
+
+    /**
+     * @brief 被合并（原地替换而未入队）的消息数量
+     *        Number of messages coalesced into a pending slot instead of being queued.
+     */
+    [[nodiscard]]
+    auto coalescedCount() const -> uint64_t;
 
     /**
      * @brief 处理设备断开连接
@@ -89,6 +441,21 @@ public:
      */
     void handleDisconnect(const std::string& deviceId);
 
+    /**
+     * @brief 把可能等待存储落盘的工作投递到键对应的处理线程上执行
+     *        Run work that may wait for storage durability on the handler thread picked by the key.
+     *
+     * 供 gRPC 回调线程上的 reactor 使用：预写日志为 Sync 时上报与会话建立会等待落盘，不能占住回调线程。
+     * 同一键的工作按投递顺序执行；处理线程不可用时在调用线程上直接执行。
+     * Meant for reactors on gRPC callback threads: with a Sync write-ahead log, reports and session setup wait
+     * for durability and must not hold a callback thread. Work of one key runs in posting order; it runs on the
+     * calling thread when no handler thread is available.
+     *
+     * @param key 选取处理线程的键，通常是设备ID / Key picking the handler thread, usually the device ID
+     * @param work 要执行的工作 / Work to run
+     */
+    void post(const std::string& key, std::function<void()> work);
+
 private:
     /**
      * @brief 将消息任务分发至处理线程
@@ -98,11 +465,151 @@ private:
      */
     void dispatch(const MessageTask& task);
 
+    /**
+     * @brief 以合并方式派发状态上报或心跳任务
+     *        Dispatch a status report or heartbeat task through its per-device pending slot
+     *
+     * @param task 消息任务对象 / Message task to dispatch
+     */
+    void dispatchCoalesced(MessageTask task);
+
+    /**
+     * @brief 在处理线程上执行消息任务
+     *        Run a message task on the handler thread
+     *
+     * @param task 消息任务对象 / Message task to run
+     */
+    void process(const MessageTask& task);
+
+    /**
+     * @brief 设备断开时结清其合并槽位：待处理的状态上报先于离线处理，待处理的心跳丢弃
+     *        Settle a disconnecting device's coalescing slots: a pending status report is processed ahead of
+     *        the offline transition and a pending heartbeat is dropped
+     *
+     * @param deviceId 设备ID / Device ID
+     */
+    void settlePending(const std::string& deviceId);
+
+    /**
+     * @brief 将设备状态变化事件派发至处理线程
+     *        Dispatch a device transition event to the processing thread
+     *
+     * @param event 设备事件 / Device event
+     */
+    void dispatchEvent(const DeviceEvent& event);
+
+    /**
+     * @brief 用一条已受理的状态上报运行规则，并执行命中规则的动作
+     *        Run the rules on an accepted status report and carry out the actions of the matching ones
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param status 上报的状态内容 / Reported status payload
+     * @param details 上报的属性 / Reported attributes
+     */
+    void applyRules(const std::string& deviceId, const std::string& status, const StatusDetails& details);
+
+    /**
+     * @brief 用设备的上线或离线运行规则，并执行命中规则的动作
+     *        Run the rules on a device going online or offline and carry out the actions of the matching ones
+     *
+     * @param event 设备上线或离线事件 / Device online or offline event
+     */
+    void applyTransitionRules(const DeviceEvent& event);
+
+    /**
+     * @brief 执行命中规则的动作
+     *        Carry out the actions of the matching rules
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param status 随规则事件发布的状态内容 / Status payload published with rule events
+     * @param matched 命中的规则 / Matching rules
+     */
+    void runRuleActions(const std::string& deviceId, const std::string& status,
+                        const std::vector<const StatusRule*>& matched);
+
+    /**
+     * @brief 生成匹配设备的状态快照，供设备订阅使用
+     *        Build the state snapshot of matching devices for device watches
+     *
+     * @param filter 过滤条件 / Watch filter
+     * @param sequence 快照对应的缓冲序号 / Buffer sequence the snapshot reflects
+     * @param out 输出的快照事件 / Output snapshot events
+     */
+    void snapshotDevices(const DeviceWatchFilter& filter, uint64_t sequence, std::vector<DeviceWatchEvent>& out);
+
+    /**
+     * @brief 将设备绑定到网关会话的流内索引
+     *        Bind a device to a per-stream index of a gateway session
+     *
+     * @param session 网关会话 / Gateway session
+     * @param binding 索引绑定 / Index binding
+     * @return true 绑定成功 / Bound
+     */
+    auto bindGatewayDevice(GatewaySession& session, GatewayBatch::Binding& binding) -> bool;
+
+    /**
+     * @brief 代表用户注册或认领设备，设备已归属其他用户时拒绝
+     *        Register or claim a device on behalf of a user, refusing one owned by another user
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param userId 用户ID / User ID
+     * @param outHandle 输出的设备句柄，拒绝时为无效句柄 / Output handle, invalid when refused
+     * @return true 设备归属该用户或尚未绑定所有者 / The device is the user's or has no owner
+     */
+    auto claimDevice(const std::string& deviceId, const std::string& userId, DeviceHandle& outHandle) -> bool;
+
+    /**
+     * @brief 校验用户 Token，并确认设备已注册且对该用户可见
+     *        Validate the user token and make sure the device is registered and visible to the user
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param userId 用户ID / User ID
+     * @param token 用户认证令牌 / User token
+     * @return true 通过鉴权且设备可见 / Authenticated and the device is visible
+     */
+    auto authorizeDevice(const std::string& deviceId, const std::string& userId, const std::string& token) -> bool;
+
+    /**
+     * @brief 校验用户 Token，再代表用户注册或认领设备，供设备发出的单条上报与心跳使用
+     *        Validate the user token, then register or claim the device for the user; used by unary device
+     *        reports and heartbeats
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param userId 用户ID / User ID
+     * @param token 用户认证令牌 / User token
+     * @param outHandle 输出的设备句柄 / Output device handle
+     * @return true 通过鉴权且设备归属该用户或尚未绑定所有者 / Authenticated and the device is the user's or unbound
+     */
+    auto admitDevice(const std::string& deviceId, const std::string& userId, const std::string& token,
+                     DeviceHandle& outHandle) -> bool;
+
+    /**
+     * @brief 选取设备对应的处理线程，同一设备的消息始终在同一线程上按序处理
+     *        Pick the handler thread of a device; a device's messages always run in order on the same thread
+     *
+     * @param deviceId 设备ID / Device ID
+     * @return std::shared_ptr<IOT_TASK_NS::IHandler> 任务处理器，线程不可用时为空 / Handler, empty if unavailable
+     */
+    auto handlerFor(const std::string& deviceId) const -> std::shared_ptr<IOT_TASK_NS::IHandler>;
+
 private:
-    static constexpr const char* kTAG = "MessageRouter";                  // 日志标识 / Log tag identifier
-    std::shared_ptr<IOT_USER_NS::IUserManager> mUserManagerFactory;       // 用户管理器工厂 / Factory for creating user managers
-    std::shared_ptr<IOT_DEVICE_NS::IDeviceManager> mDeviceManagerFactory; // 设备管理器工厂 / Factory for creating device managers
-    IOT_TASK_NS::HandlerThread mThead;                                    // 后台消息处理线程 / Background handler thread
+    using PendingSlot = CoalescingSlot<MessageTask>; // 合并模式下单个设备单类消息的待处理槽位 / Pending slot per device and message type
+
+    static constexpr const char* kTAG = "MessageRouter";                     // 日志标识 / Log tag identifier
+    static constexpr std::chrono::minutes kSESSION_TTL { 5 };                // 会话有效期 / Session time-to-live
+    std::shared_ptr<IOT_USER_NS::IUserManager> mUserManagerFactory;          // 用户管理器工厂 / Factory for creating user managers
+    std::shared_ptr<IOT_DEVICE_NS::IDeviceManager> mDeviceManagerFactory;    // 设备管理器工厂 / Factory for creating device managers
+    CommandOutbox mOutbox;                                                   // 设备下行命令队列 / Per-device outbound command queues
+    CommandTracker mTracker { mOutbox };                                     // 下行命令回执跟踪 / Outbound command ack tracking
+    CommandDeduplicator mDeduplicator;                                       // 幂等键去重 / Idempotency-key deduplication
+    ReplayGuard mReplayGuard;                                                // 时间戳防重放 / Timestamp replay protection
+    ShardedMap<std::string, std::shared_ptr<PendingSlot>, 64> mPendingSlots; // 合并模式下的待处理槽位 / Pending slots in coalescing mode
+    DeviceWatchHub mWatchHub;                                                // 设备状态订阅扇出缓冲 / Device watch fan-out buffer
+    StatusAggregator mAggregator;                                            // 状态上报窗口聚合 / Windowed aggregation of status reports
+    RuleEngine mRules;                                                       // 状态上报规则引擎 / Status report rule engine
+    std::atomic<bool> mCoalescing { false };                                 // 是否开启合并模式 / Coalescing mode flag
+    std::atomic<uint64_t> mCoalesced { 0 };                                  // 被合并的消息数量 / Coalesced message count
+    std::vector<std::unique_ptr<IOT_TASK_NS::HandlerThread>> mWorkers;       // 后台消息处理线程 / Background handler threads
 };
 
 IOT_NS_END
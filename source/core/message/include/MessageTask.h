@@ -1,6 +1,8 @@
 #pragma once
 
 #include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include "device/DeviceHandle.h"
 #include <iostream>
 
 IOT_NS_BEGIN
@@ -76,6 +78,18 @@ struct MessageTask {
      *        Authentication token of the user.
      */
     std::string token;
+
+    /**
+     * @brief 状态上报中变化的结构化属性，空值表示删除该属性
+     *        Structured attributes changed by a status report; an empty value removes the attribute.
+     */
+    StatusDetails details;
+
+    /**
+     * @brief 会话缓存的设备句柄，有效时处理线程按句柄访问设备，无需按设备ID查表
+     *        Device handle cached by the session; when valid the handler reaches the device without an ID lookup.
+     */
+    DeviceHandle handle = kINVALID_DEVICE_HANDLE;
 };
 
 IOT_NS_END
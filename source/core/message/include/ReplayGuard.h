@@ -0,0 +1,321 @@
+#pragma once
+
+/**
+ * @brief 消息防重放头文件
+ *        Header file for message replay protection
+ *
+ * 利用 DeviceCommand / DeviceStatus / HeartbeatRequest 中的毫秒时间戳拒绝重放的消息：
+ * 时间戳必须落在服务端时钟的接受窗口内，并且时间戳与负载不能同时与该设备同一通道最近出现过的消息重复。
+ * Uses the millisecond timestamps of DeviceCommand / DeviceStatus / HeartbeatRequest to reject replayed
+ * messages: a timestamp must fall inside the acceptance window around the server clock, and timestamp and
+ * payload together must not repeat a recent message on the same device channel.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-26
+ */
+
+#include "common/NameSpaceDef.h"
+#include "common/ShardedMap.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 防重放通道，不同发送方的时间戳互不影响
+ *        Replay channel; timestamps from different senders never interfere.
+ */
+enum class ReplayChannel {
+    Command = 0,  // 用户下发的命令 / Commands sent by users
+    Status = 1,   // 设备状态上报 / Device status reports
+    Heartbeat = 2 // 设备心跳 / Device heartbeats
+};
+
+/**
+ * @brief 单通道的防重放记录：固定容量的 (时间戳, 负载摘要) 表与一个下限时间戳
+ *        Replay record of one channel: a fixed-capacity table of (timestamp, payload digest) plus a floor.
+ *
+ * 同一毫秒内负载不同的消息（批量上报、网关帧）各自被接受，只有时间戳与负载摘要都相同的消息才视为重放；
+ * 乱序的容忍范围是最近 kCAPACITY 条消息，而不是固定的毫秒数。记录存放在定长数组中，不做堆分配，
+ * 已落出接受窗口的记录随后续检查丢弃。记录满时淘汰最早的一条并把下限抬到它的时间戳，
+ * 不晚于下限的消息一律拒绝，被淘汰消息的重放因此仍会被拒绝；同一毫秒超过 kCAPACITY 条的突发需要使用不同的时间戳。
+ * 非线程安全，由 DeviceReplayState 加锁。
+ * Messages sharing one millisecond but carrying different payloads (batched reports, gateway frames) are each
+ * accepted; only a message repeating both timestamp and payload digest is a replay. Reordering is tolerated
+ * across the last kCAPACITY messages rather than a fixed number of milliseconds. Records live in a fixed array
+ * with no heap allocation, and those that fell out of the acceptance window are dropped by later checks. When
+ * full, the oldest record is evicted and the floor is raised to its timestamp; anything not newer than the
+ * floor is rejected, so replays of evicted messages are still caught, and bursts of more than kCAPACITY
+ * messages within one millisecond need distinct timestamps. Not thread-safe; DeviceReplayState locks around it.
+ */
+class ReplayWindow {
+public:
+    static constexpr size_t kCAPACITY = 32; // 每个通道记住的最近消息数 / Recent messages remembered per channel
+
+    /**
+     * @brief 检查并记录一条消息
+     *        Check and record a message.
+     *
+     * @param timestamp 消息时间戳（毫秒） / Message timestamp in milliseconds
+     * @param digest 负载摘要，无负载的消息为 0 / Payload digest, 0 for messages without a payload
+     * @param horizon 接受窗口的下界，更早的记录可以丢弃 / Lower bound of the acceptance window; older records
+     *        may be dropped
+     * @return true 首次出现，已记录 / First occurrence, recorded
+     * @return false 重放，或不晚于下限 / Replayed, or not newer than the floor
+     */
+    auto accept(int64_t timestamp, uint64_t digest, int64_t horizon) -> bool {
+        if (timestamp <= mFloor) {
+            return false;
+        }
+        // 一次遍历同时丢弃过期记录并查找重复
+        for (size_t i = 0; i < mCount;) {
+            if (mSeen[i].timestamp < horizon) {
+                mSeen[i] = mSeen[--mCount];
+                continue;
+            }
+            if (mSeen[i].timestamp == timestamp && mSeen[i].digest == digest) {
+                return false;
+            }
+            ++i;
+        }
+        if (mCount == kCAPACITY && !evictOldest(timestamp)) {
+            return true; // 新消息本身最早，由下限记住
+        }
+        mSeen[mCount++] = Seen { timestamp, digest };
+        return true;
+    }
+
+    /**
+     * @brief 当前保留的记录数
+     *        Number of records kept.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        return mCount;
+    }
+
+    /**
+     * @brief 下限时间戳，不晚于它的消息一律拒绝
+     *        Floor timestamp; messages not newer than it are rejected.
+     */
+    [[nodiscard]]
+    auto floor() const -> int64_t {
+        return mFloor;
+    }
+
+private:
+    /**
+     * @brief 最近一条消息的记录
+     *        Record of one recent message.
+     */
+    struct Seen {
+        int64_t timestamp; // 消息时间戳 / Message timestamp
+        uint64_t digest;   // 负载摘要 / Payload digest
+    };
+
+    /**
+     * @brief 记录已满：把下限抬到最早的时间戳，并丢弃不再需要的记录
+     *        Full: raise the floor to the oldest timestamp and drop the records it makes redundant.
+     *
+     * @param timestamp 待记录的消息时间戳 / Timestamp of the message being recorded
+     * @return false 待记录的消息本身最早，下限已覆盖它，无需再记录 / The new message is the oldest and the floor
+     *         now covers it, so it needs no record
+     */
+    auto evictOldest(int64_t timestamp) -> bool {
+        int64_t oldest = timestamp;
+        for (size_t i = 0; i < mCount; ++i) {
+            oldest = std::min(oldest, mSeen[i].timestamp);
+        }
+        mFloor = oldest;
+        for (size_t i = 0; i < mCount;) {
+            if (mSeen[i].timestamp <= mFloor) {
+                mSeen[i] = mSeen[--mCount];
+                continue;
+            }
+            ++i;
+        }
+        return timestamp > mFloor;
+    }
+
+    std::array<Seen, kCAPACITY> mSeen {}; // 最近消息，前 mCount 条有效，无序 / Recent messages; first mCount valid, unordered
+    size_t mCount = 0;                    // 有效记录数 / Number of valid records
+    int64_t mFloor = 0;                   // 下限时间戳 / Floor timestamp
+};
+
+/**
+ * @brief 单个设备的防重放状态，每个通道一个滑动窗口
+ *        Replay state of one device: a sliding window per channel.
+ */
+struct DeviceReplayState {
+    std::mutex mutex;                     // 保护所有通道 / Guards every channel
+    std::array<ReplayWindow, 3> channels; // 按 ReplayChannel 索引 / Indexed by ReplayChannel
+    int64_t newest = 0;                   // 已接受的最新时间戳 / Newest accepted timestamp
+};
+
+/**
+ * @brief 消息防重放校验器
+ *        Message replay guard.
+ *
+ * 时间戳为 0 表示客户端未提供时间戳，按旧协议放行；否则必须同时满足：
+ * 与服务端时钟相差不超过接受窗口，且 (时间戳, 负载摘要) 在该设备对应通道的记录中首次出现。
+ * A zero timestamp means the client sent none and is let through as the legacy protocol; otherwise the
+ * timestamp must be within the acceptance window of the server clock and (timestamp, payload digest) must be
+ * new to the device's channel record.
+ */
+class ReplayGuard {
+public:
+    static constexpr std::chrono::milliseconds kDEFAULT_WINDOW { 60000 }; // 默认接受窗口 / Default acceptance window
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param window 接受窗口，时间戳与服务端时钟的最大偏差 / Maximum skew from the server clock
+     */
+    explicit ReplayGuard(std::chrono::milliseconds window = kDEFAULT_WINDOW)
+        : mWindow(window.count()) {}
+
+    /**
+     * @brief 获取设备的防重放状态，供长连接流缓存以跳过查表
+     *        Get a device's replay state so long-lived streams can cache it and skip the lookup.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @return std::shared_ptr<DeviceReplayState> 防重放状态 / Replay state
+     */
+    auto acquire(const std::string& deviceId) -> std::shared_ptr<DeviceReplayState> {
+        return mStates.getOrInsert(deviceId, []() { return std::make_shared<DeviceReplayState>(); });
+    }
+
+    /**
+     * @brief 按设备ID校验时间戳
+     *        Check a timestamp by device ID.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param channel 消息通道 / Message channel
+     * @param timestamp 消息时间戳（毫秒） / Message timestamp in milliseconds
+     * @param digest 负载摘要，见 digest() / Payload digest, see digest()
+     * @param now 服务端当前时间（毫秒） / Server time in milliseconds
+     * @return true 接受 / Accepted
+     */
+    auto accept(const std::string& deviceId, ReplayChannel channel, int64_t timestamp, uint64_t digest = 0,
+                int64_t now = nowMillis()) -> bool {
+        if (timestamp == 0) {
+            return true;
+        }
+        return accept(*acquire(deviceId), channel, timestamp, digest, now);
+    }
+
+    /**
+     * @brief 基于已缓存的设备状态校验时间戳（快速路径）
+     *        Check a timestamp against a cached device state (fast path).
+     *
+     * @param state 设备防重放状态 / Device replay state
+     * @param channel 消息通道 / Message channel
+     * @param timestamp 消息时间戳（毫秒） / Message timestamp in milliseconds
+     * @param digest 负载摘要，见 digest() / Payload digest, see digest()
+     * @param now 服务端当前时间（毫秒） / Server time in milliseconds
+     * @return true 接受 / Accepted
+     */
+    auto accept(DeviceReplayState& state, ReplayChannel channel, int64_t timestamp, uint64_t digest = 0,
+                int64_t now = nowMillis()) const -> bool {
+        if (timestamp == 0) {
+            return true;
+        }
+        if (timestamp > now + mWindow || timestamp < now - mWindow) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.channels[static_cast<size_t>(channel)].accept(timestamp, digest, now - mWindow)) {
+            return false;
+        }
+        state.newest = std::max(state.newest, timestamp);
+        return true;
+    }
+
+    /**
+     * @brief 设备离线后登记其防重放状态，一个接受窗口之后若仍空闲则回收
+     *        Retire a device's replay state after it went offline; it is reclaimed one acceptance window later
+     *        if still idle.
+     *
+     * 立即回收会让窗口内截获的消息在重建的空状态上被再次接受，因此只有在最新记录已落出接受窗口、
+     * 且没有会话或网关绑定持有它时才删除。每次调用顺带清理已到期的登记。
+     * Dropping the state at once would let messages captured within the window be accepted again by a fresh
+     * state, so it is erased only once its newest record fell out of the window and no session or gateway
+     * binding still holds it. Each call also sweeps the entries that came due.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param now 服务端当前时间（毫秒） / Server time in milliseconds
+     */
+    void release(const std::string& deviceId, int64_t now = nowMillis()) {
+        std::lock_guard<std::mutex> lock(mRetiringMutex);
+        while (!mRetiring.empty() && mRetiring.front().second <= now) {
+            mStates.eraseIf(mRetiring.front().first, [this, now](const std::shared_ptr<DeviceReplayState>& state) {
+                if (state.use_count() != 1) {
+                    return false;
+                }
+                std::lock_guard<std::mutex> stateLock(state->mutex);
+                return state->newest < now - mWindow;
+            });
+            mRetiring.pop_front();
+        }
+        if (mStates.contains(deviceId)) {
+            mRetiring.emplace_back(deviceId, now + mWindow);
+        }
+    }
+
+    /**
+     * @brief 当前保留防重放状态的设备数
+     *        Number of devices holding replay state.
+     */
+    [[nodiscard]]
+    auto size() const -> size_t {
+        return mStates.size();
+    }
+
+    /**
+     * @brief 把一段负载累加进摘要（FNV-1a），多段负载依次传入上一段的结果
+     *        Fold one payload part into a digest (FNV-1a); chain parts by passing the previous result.
+     *
+     * 每段之后混入一个分隔字节，因此 ("ab", "c") 与 ("a", "bc") 的摘要不同。
+     * A separator byte is mixed in after each part, so ("ab", "c") and ("a", "bc") differ.
+     *
+     * @param part 负载片段 / Payload part
+     * @param seed 上一段的摘要 / Digest of the previous parts
+     * @return uint64_t 摘要 / Digest
+     */
+    static auto digest(std::string_view part, uint64_t seed = kDIGEST_SEED) -> uint64_t {
+        constexpr uint64_t kPRIME = 1099511628211ULL;
+        for (char c : part) {
+            seed = (seed ^ static_cast<unsigned char>(c)) * kPRIME;
+        }
+        return (seed ^ 0xffU) * kPRIME;
+    }
+
+    static constexpr uint64_t kDIGEST_SEED = 14695981039346656037ULL; // FNV-1a 初始值 / FNV-1a offset basis
+
+    /**
+     * @brief 服务端当前时间（Unix 毫秒）
+     *        Server time in Unix milliseconds.
+     */
+    static auto nowMillis() -> int64_t {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    }
+
+private:
+    int64_t mWindow;                                                         // 接受窗口（毫秒） / Window in ms
+    ShardedMap<std::string, std::shared_ptr<DeviceReplayState>, 64> mStates; // 设备防重放状态 / Per-device state
+    std::mutex mRetiringMutex;                                               // 保护 mRetiring / Guards mRetiring
+    std::deque<std::pair<std::string, int64_t>> mRetiring; // 待回收的设备与到期时间 / Devices to reclaim and due times
+};
+
+IOT_NS_END
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CommandDeduplicator.h"
+#include "CommandOutbox.h"
+#include "CommandTracker.h"
+#include "DeviceWatchHub.h"
+#include "ReplayGuard.h"
+#include "StatusAggregator.h"
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceManagerOptions.h"
+#include "user/UserManagerOptions.h"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 消息路由器的运行时调优参数
+ *        Runtime tuning options of the message router.
+ *
+ * 默认值与此前的编译期常量一致；服务器配置文件与命令行覆盖后整体传入 MessageRouter 构造函数。
+ * Defaults match the former compile-time constants; the server config file and command line overrides fill
+ * it in and hand it to the MessageRouter constructor as a whole.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-29
+ */
+struct RouterOptions {
+    size_t workerThreads = 1;                                                     // 消息处理线程数，同一设备固定落在同一线程 / Handler threads; a device always maps to the same one
+    size_t outboxCapacity = CommandOutbox::kDEFAULT_CAPACITY;                     // 每个设备的下行队列容量 / Per-device outbound queue capacity
+    size_t pendingShardCount = 64;                                                // 合并模式待处理槽位表的分片数 / Shards of the coalescing pending-slot table
+    bool coalescing = false;                                                      // 启动时是否开启合并模式 / Start in coalescing mode
+    CommandRetryPolicy retry;                                                     // 命令回执超时与重试策略 / Command ack timeout and retry policy
+    std::chrono::milliseconds dedupWindow = CommandDeduplicator::kDEFAULT_WINDOW; // 幂等键去重窗口 / Idempotency-key deduplication window
+    size_t dedupShardCapacity = CommandDeduplicator::kDEFAULT_SHARD_CAPACITY;     // 去重表每分片容量 / Deduplication entries per shard
+    std::chrono::milliseconds replayWindow = ReplayGuard::kDEFAULT_WINDOW;        // 防重放接受窗口 / Replay acceptance window
+    size_t watchBufferCapacity = DeviceWatchHub::kDEFAULT_CAPACITY;               // 设备状态订阅扇出缓冲容量（事件数）/ Device watch fan-out buffer capacity in events
+    std::vector<AggregationSpec> aggregations;                                    // 状态上报的窗口聚合规则 / Windowed aggregations of status reports
+    std::string aggregationGroupDelimiter = "-";                                  // 聚合的设备分组分隔符 / Device group delimiter of aggregations
+    std::vector<std::string> rules;                                               // 状态上报规则源码，每条一行 / Status report rule sources, one per entry
+    std::string rulesFile;                                                        // 规则文件，在 rules 之后加载 / Rule file, loaded after rules
+    std::string deviceManager = "default";                                        // 设备管理器插件名称 / Device manager plugin name
+    DeviceManagerOptions device;                                                  // 设备管理器参数 / Device manager options
+    UserManagerOptions user;                                                      // 用户管理器参数 / User manager options
+};
+
+IOT_NS_END
@@ -0,0 +1,338 @@
+#pragma once
+
+/**
+ * @brief 状态上报规则引擎头文件
+ *        Header file for the status report rule engine
+ *
+ * 规则是设备属性与状态变化上的条件，加载时编译为字节码；路由器受理的每条状态上报只运行引用了变化属性的规则，
+ * 命中的规则触发事件或向设备下发命令，告警逻辑因此不必把全部遥测数据导出到外部处理。
+ * Rules are conditions over device attributes and their transitions, compiled into bytecode on load; every
+ * status report accepted by the router only runs the rules referencing an attribute that changed, and matching
+ * rules emit events or queue commands to the device, so alerting no longer needs all telemetry shipped out.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-11
+ */
+
+#include "CommandOutbox.h"
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 规则命中后执行的动作
+ *        Action run when a rule matches.
+ */
+struct RuleAction {
+    /**
+     * @brief 动作类型
+     *        Action type.
+     */
+    enum class Type {
+        Event,   // 向设备订阅者推送规则事件 / Push a rule event to device watchers
+        Command, // 向设备下发命令 / Queue a command to the device
+    };
+
+    Type type = Type::Event; // 动作类型 / Action type
+    std::string name;        // 事件名或命令内容 / Event name or command
+    CommandParams params;    // 命令参数，仅 Command 使用 / Command parameters, Command only
+};
+
+/**
+ * @brief 一条编译后的规则
+ *        One compiled rule.
+ */
+struct StatusRule {
+    std::string name;                // 规则名称 / Rule name
+    uint32_t condition = 0;          // 条件编号，相同条件的规则共用 / Condition index, shared by identical conditions
+    std::vector<RuleAction> actions; // 命中后依次执行的动作 / Actions run in order on a match
+};
+
+/**
+ * @brief 编译型状态上报规则引擎
+ *        Compiled rule engine for status reports.
+ *
+ * 每条规则一行：`名称: 条件 => 动作[; 动作]`。条件由比较通过 &&、||、! 与括号组合而成：
+ * `属性 运算符 字面量`（运算符为 == != < <= > >=，字面量为数值、"字符串"、true 或 false），
+ * `prev(属性) 运算符 字面量` 比较本次上报之前的值，`changed(属性)` 表示本次上报改变了该属性，
+ * 单独的 `属性` 表示其为 true 或非零数值。`$status` 指上报的状态内容字符串，`changed($status)` 只表示内容变化；
+ * 设备的上线与离线由布尔伪属性 `$online` 表示，它只随设备管理器的在线状态变化，不随上报变化。
+ * 动作为 `event [事件名]`（缺省为规则名）或 `command 命令 [键=值 ...]`。例如：
+ * One rule per line: `name: condition => action[; action]`. Conditions combine comparisons with &&, ||, ! and
+ * parentheses: `attribute op literal` (op is one of == != < <= > >=, the literal a number, a "string", true or
+ * false), `prev(attribute) op literal` compares the value before this report, `changed(attribute)` holds when
+ * this report changed the attribute, and a bare `attribute` holds when it is true or a non-zero number.
+ * `$status` is the reported status payload string, so `changed($status)` only means the payload changed; a
+ * device going online or offline is the boolean pseudo attribute `$online`, which follows the device manager's
+ * online state and never changes with a report. An action is `event [name]` (the rule name by default) or
+ * `command cmd [key=value ...]`. For example:
+ *
+ *     overheat: temp > 80 && prev(temp) <= 80 => event; command fan speed=max
+ *     failed: changed($status) && $status == "ERROR" => event device_error
+ *     lost: changed($online) && !$online => event device_lost
+ *
+ * 编译时相同的比较只保留一份，整个条件相同的规则共用同一段字节码；每次上报中比较结果按需求值并缓存，
+ * 被多条规则引用的比较与条件都只求值一次。属性到条件的索引只挑出引用了本次变化属性的条件，
+ * 与规则总数无关；属性值未变的上报不运行任何规则。&& 与 || 编译为短路跳转。
+ * Identical comparisons are compiled once and rules with identical conditions share one program; comparisons
+ * are evaluated lazily and cached per report, so a comparison or condition used by many rules is evaluated once.
+ * An index from attribute to conditions picks only the conditions referencing an attribute this report changed,
+ * independent of the total number of rules, and a report that changes no value runs no rule. && and || compile
+ * into short-circuit jumps.
+ *
+ * 引擎自己按设备保存规则引用到的属性的当前值，用于比较未变化的属性与 prev()，与设备管理器的存储无关；
+ * 设备离线时这些值被丢弃，重新上线后的第一条上报里 prev() 取不到离线之前的值。
+ * 比较的一方缺失时结果为假；数值与字符串按各自的顺序比较，布尔只支持 == 与 !=，类型不同时只有 != 成立。
+ * The engine keeps, per device, the current value of every attribute the rules reference, for comparisons of
+ * unchanged attributes and prev(), independent of the device manager's storage. The values are dropped when the
+ * device goes offline, so after it comes back prev() has no value from before. A comparison with a missing value
+ * is false; numbers and strings compare in their own order, booleans only support == and !=, and values of
+ * different types only satisfy !=.
+ *
+ * 编译后只读；evaluate 可在多个线程上并发调用，同一设备的状态由分片锁保护。
+ * Read-only after compilation; evaluate may run on several threads at once, device state being guarded by
+ * shard locks.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-11
+ */
+class RuleEngine {
+public:
+    static constexpr size_t kSHARDS = 64;             // 设备状态分片数 / Device state shards
+    static constexpr const char* kSTATUS = "$status"; // 上报状态内容的伪属性名 / Pseudo attribute of the status payload
+    static constexpr const char* kONLINE = "$online"; // 设备在线状态的伪属性名 / Pseudo attribute of the online state
+
+    /**
+     * @brief 构造函数，编译规则，无法编译的规则被记录并忽略
+     *        Constructor: compiles the rules; rules that fail to compile are logged and ignored.
+     *
+     * @param sources 规则源码，每条一行 / Rule sources, one per entry
+     */
+    explicit RuleEngine(const std::vector<std::string>& sources = {});
+
+    RuleEngine(const RuleEngine&) = delete;
+    auto operator=(const RuleEngine&) -> RuleEngine& = delete;
+
+    /**
+     * @brief 是否有任何规则
+     *        Whether any rule is loaded.
+     */
+    [[nodiscard]]
+    auto enabled() const -> bool {
+        return !mRules.empty();
+    }
+
+    /**
+     * @brief 是否有规则引用上报的状态内容（$status）
+     *        Whether any rule references the status payload ($status).
+     */
+    [[nodiscard]]
+    auto readsStatus() const -> bool {
+        return mStatusSlot.has_value();
+    }
+
+    /**
+     * @brief 编译后的规则
+     *        Compiled rules.
+     */
+    [[nodiscard]]
+    auto rules() const -> const std::vector<StatusRule>& {
+        return mRules;
+    }
+
+    /**
+     * @brief 去重后的条件数
+     *        Number of distinct conditions.
+     */
+    [[nodiscard]]
+    auto conditionCount() const -> size_t {
+        return mConditions.size();
+    }
+
+    /**
+     * @brief 去重后的比较数
+     *        Number of distinct comparisons.
+     */
+    [[nodiscard]]
+    auto comparisonCount() const -> size_t {
+        return mComparisons.size();
+    }
+
+    /**
+     * @brief 编译一条规则并加入引擎，须在第一次 evaluate 之前调用
+     *        Compile one rule into the engine; must happen before the first evaluate.
+     *
+     * @param source 规则源码 / Rule source
+     * @param error 编译失败时的原因 / Reason of a failure
+     * @return true 编译成功 / Compiled
+     */
+    auto add(std::string_view source, std::string& error) -> bool;
+
+    /**
+     * @brief 用一条状态上报更新设备状态，运行引用了变化属性的规则
+     *        Apply one status report to the device state and run the rules referencing a changed attribute.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param status 上报的状态内容 / Reported status payload
+     * @param details 上报的属性，空值表示删除 / Reported attributes, an empty value removes one
+     * @param matched 追加命中的规则，按规则顺序 / Appends the matching rules, in rule order
+     * @return size_t 命中的规则数 / Number of matching rules
+     */
+    auto evaluate(const std::string& deviceId, const std::string& status, const StatusDetails& details,
+                  std::vector<const StatusRule*>& matched) -> size_t;
+
+    /**
+     * @brief 用设备的上线或离线更新 $online，运行引用了它的规则；离线时随后丢弃该设备保存的值
+     *        Apply a device going online or offline to $online and run the rules referencing it; going offline
+     *        then drops the values kept for the device.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param online 设备是否变为在线 / Whether the device came online
+     * @param matched 追加命中的规则，按规则顺序 / Appends the matching rules, in rule order
+     * @return size_t 命中的规则数 / Number of matching rules
+     */
+    auto transition(const std::string& deviceId, bool online, std::vector<const StatusRule*>& matched) -> size_t;
+
+    /**
+     * @brief 读取规则文件，每行一条规则，空行与 `#` 开头的注释行被忽略
+     *        Read a rule file: one rule per line, blank lines and lines starting with `#` skipped.
+     *
+     * @param path 文件路径 / File path
+     * @param out 追加读到的规则源码 / Appends the rule sources read
+     * @return false 文件无法打开 / The file cannot be opened
+     */
+    static auto loadFile(const std::string& path, std::vector<std::string>& out) -> bool;
+
+private:
+    struct Parser;
+
+    /**
+     * @brief 比较类型
+     *        Comparison kind.
+     */
+    enum class Compare : uint8_t { Eq, Ne, Lt, Le, Gt, Ge, Truthy, Changed };
+
+    /**
+     * @brief 一个比较：属性槽位的当前值或之前的值与字面量比较
+     *        One comparison: the current or previous value of an attribute slot against a literal.
+     */
+    struct Comparison {
+        uint16_t slot = 0;        // 属性槽位 / Attribute slot
+        bool previous = false;    // 是否取本次上报之前的值 / Use the value before this report
+        Compare op = Compare::Eq; // 比较类型 / Comparison kind
+        AttributeValue literal;   // 字面量 / Literal
+    };
+
+    /**
+     * @brief 字节码指令
+     *        Bytecode instruction.
+     */
+    struct Instruction {
+        /**
+         * @brief 操作码
+         *        Opcode.
+         */
+        enum class Op : uint8_t {
+            Test,    // 压入比较 arg 的结果 / Push the result of comparison arg
+            Not,     // 栈顶取反 / Negate the top
+            AndJump, // 栈顶为假则跳到 arg，否则弹出 / Jump to arg if the top is false, else pop it
+            OrJump,  // 栈顶为真则跳到 arg，否则弹出 / Jump to arg if the top is true, else pop it
+        };
+
+        Op op = Op::Test; // 操作码 / Opcode
+        uint32_t arg = 0; // 比较编号或跳转目标 / Comparison index or jump target
+    };
+
+    /**
+     * @brief 一个去重后的条件
+     *        One distinct condition.
+     */
+    struct Condition {
+        std::vector<Instruction> code; // 字节码 / Bytecode
+        std::vector<uint32_t> rules;   // 使用该条件的规则 / Rules using this condition
+    };
+
+    using Facts = std::vector<std::pair<uint16_t, AttributeValue>>; // 按槽位排序的当前值 / Current values by slot
+
+    /**
+     * @brief 设备状态分片
+     *        Shard of device state.
+     */
+    struct Shard {
+        std::mutex mutex;                             // 保护本分片 / Guards this shard
+        std::unordered_map<std::string, Facts> facts; // 设备ID到属性当前值 / Device ID to current values
+    };
+
+    /**
+     * @brief 单次求值的线程私有暂存区，以递增的代号代替逐次清零；各引擎共用同一个代号
+     *        Per-thread scratch of one evaluation; an increasing generation replaces clearing it every time.
+     *        Engines share it, so the generation increases per thread rather than per engine.
+     */
+    struct Scratch {
+        uint64_t generation = 0;                             // 当前求值代号 / Generation of the current evaluation
+        std::vector<uint64_t> changedAt;                     // 槽位在哪一代变化 / Generation a slot changed in
+        std::vector<std::optional<AttributeValue>> previous; // 变化槽位之前的值 / Value of a changed slot before
+        std::vector<uint64_t> testedAt;                      // 比较在哪一代求值 / Generation a comparison was evaluated in
+        std::vector<uint8_t> results;                        // 比较结果 / Comparison results
+        std::vector<uint64_t> queuedAt;                      // 条件在哪一代入选 / Generation a condition was picked in
+        std::vector<uint16_t> changed;                       // 本次变化的槽位 / Slots changed this time
+        std::vector<uint8_t> stack;                          // 字节码求值栈 / Bytecode stack
+    };
+
+    /**
+     * @brief 在设备状态上应用一组变化，运行引用了变化槽位的条件
+     *        Apply a set of changes to the device state and run the conditions referencing a changed slot.
+     */
+    template <typename Changes>
+    auto apply(const std::string& deviceId, bool forget, std::vector<const StatusRule*>& matched, Changes&& changes)
+        -> size_t;
+
+    /**
+     * @brief 求值一个比较
+     *        Evaluate one comparison.
+     */
+    auto test(const Comparison& comparison, const Facts& facts, const Scratch& scratch) const -> bool;
+
+    /**
+     * @brief 设备某个槽位的当前值
+     *        Current value of one slot of a device.
+     */
+    static auto valueOf(const Facts& facts, uint16_t slot) -> const AttributeValue*;
+
+    /**
+     * @brief 运行一个条件的字节码
+     *        Run the bytecode of one condition.
+     */
+    auto run(const Condition& condition, const Facts& facts, Scratch& scratch) const -> bool;
+
+    /**
+     * @brief 当前线程的暂存区，按本引擎的规模扩容
+     *        Scratch of the calling thread, grown to the size of this engine.
+     */
+    auto scratch() const -> Scratch&;
+
+    std::vector<StatusRule> mRules;                            // 编译后的规则 / Compiled rules
+    std::vector<Condition> mConditions;                        // 去重后的条件 / Distinct conditions
+    std::vector<Comparison> mComparisons;                      // 去重后的比较 / Distinct comparisons
+    std::unordered_map<std::string, uint32_t> mConditionKeys;  // 条件规范形式到编号 / Canonical condition to index
+    std::unordered_map<std::string, uint32_t> mComparisonKeys; // 比较规范形式到编号 / Canonical comparison to index
+    std::unordered_map<std::string, uint16_t> mSlots;          // 属性名到槽位 / Attribute name to slot
+    std::vector<std::vector<uint32_t>> mSlotConditions;        // 槽位到引用它的条件 / Slot to the conditions using it
+    std::optional<uint16_t> mStatusSlot;                       // $status 的槽位 / Slot of $status
+    std::optional<uint16_t> mOnlineSlot;                       // $online 的槽位 / Slot of $online
+    std::array<Shard, kSHARDS> mShards;                        // 设备状态分片 / Device state shards
+};
+
+IOT_NS_END
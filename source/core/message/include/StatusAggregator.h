@@ -0,0 +1,234 @@
+#pragma once
+
+/**
+ * @brief 状态上报流式窗口聚合头文件
+ *        Header file for streaming windowed aggregations over status reports
+ *
+ * 路由器受理的每条状态上报按配置的聚合规则累计到所在设备分组的窗口中，查询只合并各窗格的部分聚合结果，
+ * 代价与分组数成正比，与设备数无关，不需要扫描注册表。
+ * Every status report accepted by the router is accumulated into the windows of its device group according to
+ * the configured aggregations; queries only merge the partial aggregates of the panes, at a cost proportional to
+ * the number of groups rather than devices, and never scan the registry.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-10
+ */
+
+#include "common/NameSpaceDef.h"
+#include "common/QuantileSketch.h"
+#include "device/DeviceAttributes.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 一条聚合规则：对某个数值属性按设备分组、按时间窗口聚合
+ *        One aggregation: a numeric attribute aggregated per device group over time windows.
+ *
+ * 滑动步长为 0 或不小于窗口长度时为滚动窗口；否则为滑动窗口，窗口长度向上取整为步长的整数倍。
+ * A slide of 0, or not shorter than the window, gives tumbling windows; otherwise windows slide, and the window
+ * length is rounded up to a multiple of the slide.
+ */
+struct AggregationSpec {
+    std::string name;                           // 聚合名称，查询时引用 / Aggregation name, referenced by queries
+    std::string attribute;                      // 数值或布尔属性名，布尔按 1 / 0 计 / Numeric or boolean attribute
+    std::chrono::milliseconds window { 60000 }; // 窗口长度 / Window length
+    std::chrono::milliseconds slide { 0 };      // 滑动步长，0 为滚动窗口 / Slide, 0 for tumbling windows
+};
+
+/**
+ * @brief 聚合查询条件
+ *        Aggregation query.
+ */
+struct AggregateQuery {
+    std::string name;              // 聚合名称 / Aggregation name
+    std::vector<double> quantiles; // 需要估计的分位点，取值 [0, 1] / Quantiles to estimate, in [0, 1]
+    bool includeOpen = false;      // 是否查询截至当前、尚未结束的窗口 / Query the window still in progress, up to now
+};
+
+/**
+ * @brief 一个设备分组在窗口内的聚合结果
+ *        Aggregate of one device group over a window.
+ */
+struct AggregateGroup {
+    std::string group;             // 设备分组 / Device group
+    uint64_t count = 0;            // 样本数 / Number of samples
+    double sum = 0;                // 总和 / Sum
+    double min = 0;                // 最小值 / Minimum
+    double max = 0;                // 最大值 / Maximum
+    double mean = 0;               // 平均值 / Mean
+    std::vector<double> quantiles; // 与查询的分位点一一对应的估计值 / Estimates for the queried quantiles, in order
+};
+
+/**
+ * @brief 一个窗口的聚合结果
+ *        Aggregates of one window.
+ */
+struct AggregateWindow {
+    int64_t startMs = 0;                // 窗口起点（Unix 毫秒，含）/ Window start in Unix ms, inclusive
+    int64_t endMs = 0;                  // 窗口终点（Unix 毫秒，不含）/ Window end in Unix ms, exclusive
+    std::vector<AggregateGroup> groups; // 按分组名排序，无样本的分组不出现 / Sorted by group, empty ones omitted
+};
+
+/**
+ * @brief 状态上报的流式窗口聚合
+ *        Streaming windowed aggregation of status reports.
+ *
+ * 时间按滑动步长切成窗格，窗口由连续的若干窗格组成，滚动窗口只有一个窗格。每个窗格为每个分组保存可合并的
+ * 部分聚合结果：计数、总和、最小值、最大值与分位数草图。写入按线程分条带：每个线程固定写自己的条带，
+ * 条带锁几乎不会被争用；查询时才把各条带中窗口内的窗格合并起来，代价为 O(条带数 × 窗格数 × 分组数)。
+ * Time is cut into panes one slide long and a window spans consecutive panes; tumbling windows have a single
+ * pane. Every pane keeps a mergeable partial aggregate per group: count, sum, minimum, maximum and a quantile
+ * sketch. Writes are striped by thread: each thread always writes its own stripe, so stripe locks are hardly
+ * ever contended; only queries merge the panes of the window across stripes, at O(stripes x panes x groups).
+ *
+ * 分组取设备 ID 中第一个分隔符之前的部分，如 "sensor-17" 属于 "sensor"；没有分隔符的设备自成一组，
+ * 分隔符为空时全部设备属于同一个名为空串的分组。窗口按到达时间（Unix 毫秒）划分，只保留最近一个完整窗口
+ * 与进行中的窗格，更早的样本被丢弃。
+ * The group of a device is its ID up to the first delimiter, e.g. "sensor-17" belongs to "sensor"; an ID without
+ * the delimiter is a group of its own, and an empty delimiter puts every device into one group named "".
+ * Windows follow arrival time in Unix ms; only the latest complete window and the pane in progress are kept, and
+ * older samples are dropped.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-10
+ */
+class StatusAggregator {
+public:
+    static constexpr size_t kSTRIPES = 16; // 写入条带数 / Write stripes
+
+    /**
+     * @brief 构造函数
+     *        Constructor.
+     *
+     * @param specs 聚合规则，名称为空或窗口长度不为正的规则被忽略 / Aggregations; those without a name or with
+     *        a non-positive window are ignored
+     * @param groupDelimiter 设备分组分隔符 / Device group delimiter
+     */
+    explicit StatusAggregator(const std::vector<AggregationSpec>& specs = {}, std::string groupDelimiter = "-");
+
+    /**
+     * @brief 是否配置了任何聚合规则
+     *        Whether any aggregation is configured.
+     */
+    [[nodiscard]]
+    auto enabled() const -> bool {
+        return !mSpecs.empty();
+    }
+
+    /**
+     * @brief 累计一条状态上报，只读取聚合规则引用的属性
+     *        Accumulate one status report, reading only the attributes the aggregations reference.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param details 上报的属性 / Reported attributes
+     * @param nowMs 到达时间（Unix 毫秒）/ Arrival time in Unix ms
+     */
+    void record(const std::string& deviceId, const StatusDetails& details, int64_t nowMs);
+
+    /**
+     * @brief 查询最近一个完整窗口，或截至当前的窗口
+     *        Query the latest complete window, or the window up to now.
+     *
+     * @param query 聚合名称、分位点与窗口选择 / Aggregation name, quantiles and window choice
+     * @param out 输出的窗口结果 / Output window
+     * @param nowMs 当前时间（Unix 毫秒）/ Current time in Unix ms
+     * @return false 聚合名称未配置 / Unknown aggregation name
+     */
+    auto query(const AggregateQuery& query, AggregateWindow& out, int64_t nowMs) const -> bool;
+
+    /**
+     * @brief 设备所属的分组
+     *        Group of a device.
+     *
+     * @param deviceId 设备ID / Device ID
+     * @param delimiter 分组分隔符 / Group delimiter
+     * @return std::string_view 分组名，引用 deviceId / Group name, viewing into deviceId
+     */
+    static auto groupOf(std::string_view deviceId, std::string_view delimiter) -> std::string_view;
+
+private:
+    /**
+     * @brief 一个分组在一个窗格内的可合并部分聚合结果
+     *        Mergeable partial aggregate of one group in one pane.
+     */
+    struct Partial {
+        uint64_t count = 0;    // 样本数 / Number of samples
+        double sum = 0;        // 总和 / Sum
+        double min = 0;        // 最小值 / Minimum
+        double max = 0;        // 最大值 / Maximum
+        QuantileSketch sketch; // 分位数草图 / Quantile sketch
+
+        void add(double value);
+        void merge(const Partial& other);
+    };
+
+    /**
+     * @brief 支持以 string_view 查找的字符串哈希
+     *        String hash allowing lookups by string_view.
+     */
+    struct GroupHash {
+        using is_transparent = void;
+
+        auto operator()(std::string_view group) const -> size_t {
+            return std::hash<std::string_view> {}(group);
+        }
+    };
+
+    using GroupMap = std::unordered_map<std::string, Partial, GroupHash, std::equal_to<>>;
+
+    /**
+     * @brief 一个窗格：按分组的部分聚合结果
+     *        One pane: partial aggregates per group.
+     */
+    struct Pane {
+        int64_t startMs = 0; // 窗格起点（Unix 毫秒）/ Pane start in Unix ms
+        GroupMap groups;     // 分组到部分聚合结果 / Group to partial aggregate
+    };
+
+    /**
+     * @brief 一个写入条带：每条聚合规则一列按时间排序的窗格
+     *        One write stripe: time-ordered panes per aggregation.
+     */
+    struct Stripe {
+        mutable std::mutex mutex;            // 保护本条带 / Guards this stripe
+        std::vector<std::deque<Pane>> panes; // 每条规则的窗格 / Panes per aggregation
+    };
+
+    /**
+     * @brief 找到或创建时间所在的窗格，并淘汰早于最近一个完整窗口的窗格
+     *        Find or create the pane of a time, expiring panes older than the latest complete window.
+     *
+     * @return Pane* 窗格，样本早于保留范围时为 nullptr / The pane, nullptr if the sample is older than kept
+     */
+    static auto paneFor(std::deque<Pane>& panes, int64_t paneStart, int64_t windowMs) -> Pane*;
+
+    /**
+     * @brief 时间所在窗格的起点
+     *        Start of the pane containing a time.
+     */
+    static auto paneStartOf(int64_t timeMs, int64_t slideMs) -> int64_t;
+
+    /**
+     * @brief 当前线程的写入条带
+     *        Write stripe of the calling thread.
+     */
+    auto stripe() const -> Stripe&;
+
+    std::vector<AggregationSpec> mSpecs;           // 规范化后的聚合规则 / Normalized aggregations
+    std::string mDelimiter;                        // 设备分组分隔符 / Device group delimiter
+    std::vector<std::unique_ptr<Stripe>> mStripes; // 写入条带 / Write stripes
+};
+
+IOT_NS_END
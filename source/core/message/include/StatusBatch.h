@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <cstdint>
+#include <vector>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 批量状态上报的聚合结果
+ *        Aggregated outcome of a batched status report.
+ *
+ * 一个批次只返回一个结果：受理数量加上被拒绝条目在批次中的下标，而不是逐条应答。
+ * A batch yields a single result, the accepted count plus the batch positions of rejected entries, instead of
+ * one answer per entry.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-01
+ */
+struct StatusBatchResult {
+    bool authenticated = false;          // 鉴权是否通过，false 时整批未处理 / Auth verdict; false means nothing ran
+    uint32_t accepted = 0;               // 被受理的条目数 / Entries accepted
+    std::vector<uint32_t> failedIndexes; // 被拒绝条目的下标（设备ID为空、重放或设备未注册），升序 / Rejected positions, ascending
+};
+
+IOT_NS_END
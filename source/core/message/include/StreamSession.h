@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ReplayGuard.h"
+#include "common/NameSpaceDef.h"
+#include "device/DeviceHandle.h"
+#include <chrono>
+#include <memory>
+#include <string>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 流会话结构体，绑定一条长连接流与其设备、用户及鉴权结果。
+ *        Structure binding a long-lived stream to its device, user and auth verdict.
+ *
+ * 心跳流在打开（或收到首条消息）时只做一次 Token 校验，之后的心跳直接复用会话中缓存的鉴权结果，
+ * 仅检查会话是否过期，避免每条消息都携带并校验 user_id / auth_token。
+ * A heartbeat stream validates its token once when it opens (or on the first message); later heartbeats
+ * reuse the cached verdict and only check for session expiry instead of re-validating every message.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-21
+ */
+struct StreamSession {
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 会话绑定的设备唯一标识符
+     *        Unique identifier of the device bound to this session.
+     */
+    std::string deviceId;
+
+    /**
+     * @brief 会话绑定的用户唯一标识符
+     *        Unique identifier of the user bound to this session.
+     */
+    std::string userId;
+
+    /**
+     * @brief 建立会话时的鉴权结果
+     *        Auth verdict computed when the session was opened.
+     */
+    bool authenticated = false;
+
+    /**
+     * @brief 会话过期时间点，过期后需重新鉴权
+     *        Expiry time point; the session must be re-authenticated afterwards.
+     */
+    Clock::time_point expiresAt;
+
+    /**
+     * @brief 缓存的设备句柄，心跳按句柄直接写入设备槽位，无需哈希设备ID
+     *        Cached device handle; heartbeats go straight to the device slot by handle, with no ID hashing.
+     */
+    DeviceHandle handle = kINVALID_DEVICE_HANDLE;
+
+    /**
+     * @brief 缓存的设备防重放状态，心跳时间戳校验无需查表
+     *        Cached device replay state, so heartbeat timestamp checks skip the lookup.
+     */
+    std::shared_ptr<DeviceReplayState> replay;
+
+    /**
+     * @brief 判断会话在给定时间点是否已过期
+     *        Check whether the session has expired at the given time point.
+     *
+     * @param now 当前时间点 / Current time point
+     * @return true 已过期 / Expired
+     */
+    [[nodiscard]]
+    auto expired(Clock::time_point now = Clock::now()) const -> bool {
+        return now >= expiresAt;
+    }
+};
+
+IOT_NS_END
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 服务端推送流的写状态：同一时刻最多一个写操作，流只结束一次
+ *        Write state of a server push stream: at most one write in flight, and the stream finishes once.
+ *
+ * 推送流的写出由就绪通知、写完成与取消三条路径驱动，它们可能并发到达；例如取消先结束了流，
+ * 随后进行中的写操作才以失败完成。各路径都经由本结构决定是否写出、是否结束流，因此不会重复结束。
+ * 本结构不加锁，调用方在自己的互斥锁内访问。
+ * Writes of a push stream are driven by ready notifications, write completions and cancellation, which may
+ * race: a cancel can finish the stream before the in-flight write completes with a failure. Every path asks
+ * this structure whether to write and whether to finish, so the stream is never finished twice. It holds no
+ * lock; callers access it under their own mutex.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-28
+ */
+class StreamWriteState {
+public:
+    /**
+     * @brief 占用写权
+     *        Claim the write.
+     *
+     * @return true 没有写操作在进行且流未结束，调用方应写出 / No write in flight and not finished; write now
+     */
+    auto beginWrite() -> bool {
+        if (mWriting || mFinished) {
+            return false;
+        }
+        mWriting = true;
+        return true;
+    }
+
+    /**
+     * @brief 占用写权后发现无内容可写，释放写权
+     *        Release a claimed write because there was nothing to send.
+     */
+    void cancelWrite() { mWriting = false; }
+
+    /**
+     * @brief 写操作完成
+     *        A write completed.
+     *
+     * 写失败表示流已断开，流随之标记为结束。
+     * A failed write means the stream is gone, so the stream is marked finished.
+     *
+     * @param ok 写操作是否成功 / Whether the write succeeded
+     * @return true 写失败且流尚未被其他路径结束，调用方应结束流 / The write failed and no other path finished the
+     *         stream yet; the caller must finish it
+     */
+    auto endWrite(bool ok) -> bool {
+        mWriting = false;
+        return !ok && finish();
+    }
+
+    /**
+     * @brief 标记流结束
+     *        Mark the stream finished.
+     *
+     * @return true 首次结束，调用方应结束流 / First finish; the caller must finish the stream
+     */
+    auto finish() -> bool {
+        if (mFinished) {
+            return false;
+        }
+        mFinished = true;
+        return true;
+    }
+
+    /**
+     * @brief 流是否已结束
+     *        Whether the stream has finished.
+     */
+    [[nodiscard]]
+    auto finished() const -> bool {
+        return mFinished;
+    }
+
+private:
+    bool mWriting = false;  // 是否有写操作在进行 / A write is in flight
+    bool mFinished = false; // 是否已结束流 / The stream has finished
+};
+
+IOT_NS_END
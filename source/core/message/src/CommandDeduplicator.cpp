@@ -0,0 +1,111 @@
+#include "CommandDeduplicator.h"
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 构造函数，预先分配所有分片的环形队列
+ *        Constructor: preallocates the ring of every shard.
+ *
+ * @param window 去重窗口
+ * @param shardCapacity 每个分片最多保留的条目数
+ */
+CommandDeduplicator::CommandDeduplicator(std::chrono::milliseconds window, size_t shardCapacity)
+    : mWindow(window) {
+    mShards.reserve(kSHARD_COUNT);
+    for (size_t i = 0; i < kSHARD_COUNT; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->ring.resize(std::max<size_t>(shardCapacity, 1));
+        shard->index.reserve(shard->ring.size());
+        mShards.push_back(std::move(shard));
+    }
+}
+
+/**
+ * @brief 去重提交
+ *        Deduplicated submit.
+ *
+ * @param deviceId 目标设备ID
+ * @param key 幂等键
+ * @param submit 实际提交函数
+ * @param now 当前时间点
+ * @return CommandReceipt 提交结果
+ */
+auto CommandDeduplicator::submitOnce(const std::string& deviceId, const std::string& key,
+                                     const std::function<CommandReceipt()>& submit,
+                                     Clock::time_point now) -> CommandReceipt {
+    if (key.empty()) {
+        return submit();
+    }
+
+    // 设备ID中不会出现 '\0'，以此分隔避免不同设备的键相互冲突
+    std::string fullKey;
+    fullKey.reserve(deviceId.size() + 1 + key.size());
+    fullKey.append(deviceId).push_back('\0');
+    fullKey.append(key);
+
+    auto& shard = *mShards[std::hash<std::string> {}(fullKey) % kSHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    evict(shard, now);
+
+    auto it = shard.index.find(fullKey);
+    if (it != shard.index.end()) {
+        return shard.ring[it->second].receipt;
+    }
+
+    auto receipt = submit();
+    if (!receipt.accepted) {
+        return receipt;
+    }
+
+    if (shard.count == shard.ring.size()) {
+        // 窗口内的键已占满环，淘汰最旧的一条为新键腾出位置
+        shard.index.erase(shard.ring[shard.head].key);
+        shard.head = (shard.head + 1) % shard.ring.size();
+        --shard.count;
+    }
+    size_t pos = (shard.head + shard.count) % shard.ring.size();
+    shard.ring[pos] = Entry { fullKey, receipt, now };
+    shard.index.emplace(std::move(fullKey), pos);
+    ++shard.count;
+    return receipt;
+}
+
+/**
+ * @brief 当前缓存的条目数量
+ *        Number of cached entries.
+ *
+ * @return size_t 条目数量
+ */
+auto CommandDeduplicator::size() const -> size_t {
+    size_t total = 0;
+    for (const auto& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->count;
+    }
+    return total;
+}
+
+/**
+ * @brief 从环尾淘汰超出窗口的条目
+ *        Evict entries past the window from the tail of the ring.
+ *
+ * 条目按插入时间有序，遇到第一条仍在窗口内的条目即可停止。
+ * Entries are ordered by insertion time, so eviction stops at the first entry still inside the window.
+ *
+ * @param shard 所在分片
+ * @param now 当前时间点
+ */
+void CommandDeduplicator::evict(Shard& shard, Clock::time_point now) const {
+    while (shard.count > 0) {
+        auto& oldest = shard.ring[shard.head];
+        if (now - oldest.insertedAt < mWindow) {
+            break;
+        }
+        shard.index.erase(oldest.key);
+        oldest = Entry {};
+        shard.head = (shard.head + 1) % shard.ring.size();
+        --shard.count;
+    }
+}
+
+IOT_NS_END
@@ -0,0 +1,362 @@
+#include "CommandOutbox.h"
+
+#include <algorithm>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 命令入队，成功后唤醒等待中的投递流
+ *        Enqueue a command and wake the waiting delivery stream.
+ *
+ * @param command 待下发命令，仅在入队成功时被移走
+ * @return bool 入队成功返回 true，队列已满或已被回收返回 false
+ */
+auto DeviceOutbox::push(OutboundCommand&& command) -> bool {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRetired || mQueue.size() >= mCapacity) {
+            return false;
+        }
+        mQueue.push_back(std::move(command));
+    }
+    mCondition.notify_one(); // 立即唤醒投递流，无需轮询
+    notifyReady();
+    return true;
+}
+
+/**
+ * @brief 将投递失败的命令放回队首，保持原有顺序
+ *        Put undelivered commands back at the front in their original order.
+ *
+ * 放回的命令不受容量限制，避免已出队的命令因队列被新命令占满而丢失。
+ * Requeued commands bypass the capacity check so that drained commands are never lost to newer ones.
+ *
+ * @param commands 投递失败的命令，调用后被清空
+ */
+void DeviceOutbox::requeue(std::vector<OutboundCommand>& commands) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+            mQueue.push_front(std::move(*it));
+        }
+    }
+    commands.clear();
+    mCondition.notify_one();
+    notifyReady();
+}
+
+/**
+ * @brief 命令是否仍在队列中等待取出
+ *        Whether a command is still waiting in the queue.
+ *
+ * @param commandId 命令ID
+ * @return bool 尚未被取出返回 true
+ */
+auto DeviceOutbox::contains(uint64_t commandId) const -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::any_of(mQueue.begin(), mQueue.end(),
+                       [commandId](const OutboundCommand& queued) { return queued.commandId == commandId; });
+}
+
+/**
+ * @brief 移除仍在队列中的命令
+ *        Remove a command that is still queued.
+ *
+ * 队列有容量上限，线性查找的开销有界。
+ * The queue is bounded, so the linear search is too.
+ *
+ * @param commandId 命令ID
+ * @return bool 已移除返回 true
+ */
+auto DeviceOutbox::remove(uint64_t commandId) -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = std::find_if(mQueue.begin(), mQueue.end(),
+                           [commandId](const OutboundCommand& queued) { return queued.commandId == commandId; });
+    if (it == mQueue.end()) {
+        return false;
+    }
+    mQueue.erase(it);
+    return true;
+}
+
+/**
+ * @brief 等待命令到达并批量取出
+ *        Wait for commands and drain them as one batch.
+ *
+ * @param out 输出的命令批次
+ * @param maxBatch 单批次命令上限
+ * @param timeout 最长等待时间
+ * @return size_t 取出的命令数量，超时返回 0
+ */
+auto DeviceOutbox::waitAndDrain(std::vector<OutboundCommand>& out, size_t maxBatch,
+                                std::chrono::milliseconds timeout) -> size_t {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait_for(lock, timeout, [this]() { return !mQueue.empty(); });
+    return drainLocked(out, maxBatch);
+}
+
+/**
+ * @brief 不等待，直接取出一批命令
+ *        Drain one batch without waiting.
+ *
+ * @param out 输出的命令批次
+ * @param maxBatch 单批次命令上限
+ * @return size_t 取出的命令数量
+ */
+auto DeviceOutbox::tryDrain(std::vector<OutboundCommand>& out, size_t maxBatch) -> size_t {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return drainLocked(out, maxBatch);
+}
+
+/**
+ * @brief 设置命令就绪监听器
+ *        Install the ready listener.
+ *
+ * @param listener 就绪监听器，空函数表示解除监听
+ * @return uint64_t 监听器标识
+ */
+auto DeviceOutbox::setReadyListener(std::function<void()> listener) -> uint64_t {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    mListener = std::move(listener);
+    return ++mListenerToken;
+}
+
+/**
+ * @brief 仅当 token 标识的监听器仍在时解除监听
+ *        Detach the listener if the token still identifies it.
+ *
+ * @param token setReadyListener 返回的标识
+ */
+void DeviceOutbox::clearReadyListener(uint64_t token) {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    if (token == mListenerToken) {
+        mListener = nullptr;
+    }
+}
+
+/**
+ * @brief 登记一个投递流
+ *        Register a delivery stream.
+ *
+ * @return bool 已登记返回 true，队列已被回收返回 false
+ */
+auto DeviceOutbox::subscribe() -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mRetired) {
+        return false;
+    }
+    ++mSubscribers;
+    return true;
+}
+
+/**
+ * @brief 注销一个投递流
+ *        Unregister a delivery stream.
+ */
+void DeviceOutbox::unsubscribe() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSubscribers > 0) {
+        --mSubscribers;
+    }
+}
+
+/**
+ * @brief 是否有投递流在订阅
+ *        Whether any delivery stream is subscribed.
+ */
+auto DeviceOutbox::subscribed() const -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSubscribers > 0;
+}
+
+/**
+ * @brief 队列为空且没有投递流时将其标记为已回收
+ *        Retire the queue if it is empty and has no delivery stream.
+ *
+ * @return bool 已回收返回 true
+ */
+auto DeviceOutbox::retireIfIdle() -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRetired && mSubscribers == 0 && mQueue.empty()) {
+        mRetired = true;
+    }
+    return mRetired;
+}
+
+/**
+ * @brief 是否已被回收
+ *        Whether the queue is retired.
+ */
+auto DeviceOutbox::retired() const -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRetired;
+}
+
+/**
+ * @brief 当前排队的命令数量
+ *        Number of queued commands.
+ */
+auto DeviceOutbox::size() const -> size_t {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size();
+}
+
+/**
+ * @brief 在持锁状态下取出一批命令
+ *        Drain one batch while holding the lock.
+ *
+ * @param out 输出的命令批次
+ * @param maxBatch 单批次命令上限
+ * @return size_t 取出的命令数量
+ */
+auto DeviceOutbox::drainLocked(std::vector<OutboundCommand>& out, size_t maxBatch) -> size_t {
+    size_t count = 0;
+    while (!mQueue.empty() && count < maxBatch) {
+        out.push_back(std::move(mQueue.front()));
+        mQueue.pop_front();
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief 通知就绪监听器，监听器在队列锁之外执行
+ *        Notify the ready listener outside the queue lock.
+ */
+void DeviceOutbox::notifyReady() {
+    std::function<void()> listener;
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        listener = mListener;
+    }
+    if (listener) {
+        listener();
+    }
+}
+
+/**
+ * @brief 获取（必要时创建）设备的下行队列
+ *        Get, creating if needed, the outbound queue of a device.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return std::shared_ptr<DeviceOutbox> 设备下行队列
+ */
+auto CommandOutbox::attach(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox> {
+    return mOutboxes.getOrInsert(deviceId, [this]() { return std::make_shared<DeviceOutbox>(mCapacity); });
+}
+
+/**
+ * @brief 为投递流订阅设备的下行队列
+ *        Subscribe a delivery stream to the outbound queue of a device.
+ *
+ * 取到的队列恰好被并发的退订回收时重新获取。
+ * A queue retired by a concurrent unsubscribe in between is replaced by attaching again.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return std::shared_ptr<DeviceOutbox> 已登记该投递流的队列
+ */
+auto CommandOutbox::subscribe(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox> {
+    while (true) {
+        auto outbox = attach(deviceId);
+        if (outbox->subscribe()) {
+            return outbox;
+        }
+    }
+}
+
+/**
+ * @brief 投递流退订，队列已空且没有其他投递流时将其移除
+ *        Unsubscribe a delivery stream, removing the queue once it is empty and has no other stream.
+ *
+ * 回收判断与移除在同一次分片加锁内完成，期间不会有调用方取到该队列。
+ * The idle check and the removal share one shard lock, so no caller can attach to the queue in between.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param outbox subscribe() 返回的队列
+ */
+void CommandOutbox::unsubscribe(const std::string& deviceId, const std::shared_ptr<DeviceOutbox>& outbox) {
+    outbox->unsubscribe();
+    mOutboxes.eraseIf(deviceId, [&outbox](const std::shared_ptr<DeviceOutbox>& current) {
+        return current == outbox && outbox->retireIfIdle();
+    });
+}
+
+/**
+ * @brief 设备当前是否有投递流在订阅
+ *        Whether a delivery stream is currently subscribed for a device.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return bool 有投递流在订阅返回 true
+ */
+auto CommandOutbox::subscribed(const std::string& deviceId) const -> bool {
+    auto outbox = mOutboxes.get(deviceId);
+    return outbox && (*outbox)->subscribed();
+}
+
+/**
+ * @brief 当前持有的设备队列数量
+ *        Number of device queues currently held.
+ */
+auto CommandOutbox::outboxCount() const -> size_t {
+    return mOutboxes.size();
+}
+
+/**
+ * @brief 命令是否仍在设备队列中等待取出
+ *        Whether a command is still waiting in the queue of a device.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param commandId 命令ID
+ * @return bool 尚未被取出返回 true
+ */
+auto CommandOutbox::pending(const std::string& deviceId, uint64_t commandId) const -> bool {
+    auto outbox = mOutboxes.get(deviceId);
+    return outbox && (*outbox)->contains(commandId);
+}
+
+/**
+ * @brief 撤回仍在设备队列中的命令
+ *        Withdraw a command still sitting in the queue of a device.
+ *
+ * 撤回后队列已空且没有投递流时一并移除，与退订时的回收一致。
+ * A queue left empty and without a delivery stream is removed afterwards, as on unsubscribe.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param commandId 命令ID
+ * @return bool 已撤回返回 true
+ */
+auto CommandOutbox::withdraw(const std::string& deviceId, uint64_t commandId) -> bool {
+    auto outbox = mOutboxes.get(deviceId);
+    if (!outbox || !(*outbox)->remove(commandId)) {
+        return false;
+    }
+    mOutboxes.eraseIf(deviceId, [&outbox](const std::shared_ptr<DeviceOutbox>& current) {
+        return current == *outbox && current->retireIfIdle();
+    });
+    return true;
+}
+
+/**
+ * @brief 向设备下行队列投递命令
+ *        Enqueue a command for a device.
+ *
+ * 取到的队列恰好被并发的退订回收时改投新队列。
+ * A command refused by a queue that a concurrent unsubscribe just retired goes to a fresh queue instead.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param command 待下发命令
+ * @return bool 入队成功返回 true，队列已满返回 false
+ */
+auto CommandOutbox::enqueue(const std::string& deviceId, OutboundCommand command) -> bool {
+    while (true) {
+        auto outbox = attach(deviceId);
+        if (outbox->push(std::move(command))) {
+            return true;
+        }
+        if (!outbox->retired()) {
+            return false;
+        }
+    }
+}
+
+IOT_NS_END
@@ -0,0 +1,535 @@
+#include "CommandTracker.h"
+
+#include <algorithm>
+#include <functional>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 构造函数，创建所有分片
+ *        Constructor: creates every shard.
+ *
+ * @param outbox 命令发送所用的下行队列
+ * @param policy 重试策略
+ */
+CommandTracker::CommandTracker(CommandOutbox& outbox, CommandRetryPolicy policy)
+    : mOutbox(outbox), mPolicy(policy) {
+    mShards.reserve(kSHARD_COUNT);
+    for (size_t i = 0; i < kSHARD_COUNT; ++i) {
+        mShards.push_back(std::make_unique<Shard>());
+    }
+}
+
+/**
+ * @brief 析构函数，停止后台线程
+ *        Destructor: stops the background thread.
+ */
+CommandTracker::~CommandTracker() {
+    stop();
+}
+
+/**
+ * @brief 启动推进时间轮的后台线程
+ *        Start the background thread advancing the timing wheels.
+ */
+void CommandTracker::start() {
+    if (mRunning.exchange(true)) {
+        return;
+    }
+    mTicker = std::thread(&CommandTracker::loop, this);
+}
+
+/**
+ * @brief 停止后台线程，并唤醒所有等待者
+ *        Stop the background thread and wake every waiter.
+ *
+ * 停止后新的 watch() 调用立即以当前状态回调。
+ * After stopping, new watch() calls complete at once with the current status.
+ */
+void CommandTracker::stop() {
+    mStopped = true;
+    mRunning = false;
+    if (mTicker.joinable()) {
+        mTicker.join();
+    }
+    // 唤醒阻塞等待者，并以当前状态通知所有非阻塞等待者，保证异步调用都能结束
+    std::vector<Notification> notifications;
+    for (auto& shard : mShards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for (auto& [commandId, record] : shard->records) {
+                for (auto& watcher : record.watchers) {
+                    notifications.push_back(Notification { std::move(watcher.second), toStatus(commandId, record) });
+                }
+                record.watchers.clear();
+            }
+        }
+        shard->changed.notify_all();
+    }
+    for (auto& notification : notifications) {
+        notification.callback(notification.status);
+    }
+}
+
+/**
+ * @brief 提交命令：分配命令ID、入队并开始跟踪
+ *        Submit a command: assign an ID, queue it and start tracking.
+ *
+ * 命令ID = 序号 << kSHARD_BITS | 设备分片号，回执和查询只凭命令ID即可定位分片。
+ * Command ID = sequence << kSHARD_BITS | device shard, so acks and queries locate the shard from the ID alone.
+ *
+ * @param deviceId 目标设备ID
+ * @param command 待下发命令
+ * @return CommandReceipt 提交结果
+ */
+auto CommandTracker::submit(const std::string& deviceId, OutboundCommand command) -> CommandReceipt {
+    uint64_t shardIndex = std::hash<std::string> {}(deviceId) & (kSHARD_COUNT - 1);
+    uint64_t commandId = (mSequence.fetch_add(1, std::memory_order_relaxed) << kSHARD_BITS) | shardIndex;
+    command.commandId = commandId;
+
+    auto& shard = *mShards[shardIndex];
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // 首次投递计为第 1 次发送，其余字段取初始值
+        Record record { deviceId, command, CommandState::Queued, 1, 0, false, false, 0, {}, {} };
+        shard.wheel.schedule(now + mPolicy.ackTimeout, Timer { commandId, record.generation });
+        shard.records.emplace(commandId, std::move(record));
+    }
+
+    if (!mOutbox.enqueue(deviceId, std::move(command))) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.records.erase(commandId); // 残留的定时器到期时会因记录不存在而被忽略
+        return CommandReceipt { false, 0, "Command queue full" };
+    }
+    return CommandReceipt { true, commandId, "Command accepted" };
+}
+
+/**
+ * @brief 标记命令已写入设备流
+ *        Mark a command as written to the device stream.
+ *
+ * @param commandId 命令ID
+ */
+void CommandTracker::markDelivered(uint64_t commandId) {
+    auto& shard = shardOf(commandId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(commandId);
+    if (it != shard.records.end() && it->second.state == CommandState::Queued) {
+        it->second.state = CommandState::Delivered;
+    }
+}
+
+/**
+ * @brief 处理设备回执，命令进入成功或失败终态并唤醒等待者
+ *        Handle a device ack: the command becomes acked or failed and waiters are woken.
+ *
+ * 回执到达时重发的副本可能还在设备队列中，释放分片锁后将其撤回。
+ * A resent copy may still sit in the device queue when the ack arrives; it is withdrawn once the shard lock is
+ * released.
+ *
+ * @param deviceId 回执设备ID
+ * @param commandId 命令ID
+ * @param code 回执码，0 表示执行成功
+ * @param message 回执信息
+ * @return bool 回执被接受返回 true
+ */
+auto CommandTracker::acknowledge(const std::string& deviceId, uint64_t commandId, int32_t code,
+                                 const std::string& message) -> bool {
+    auto& shard = shardOf(commandId);
+    std::vector<Notification> notifications;
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.records.find(commandId);
+        if (it == shard.records.end() || it->second.deviceId != deviceId || isTerminal(it->second.state)) {
+            return false;
+        }
+        queued = it->second.state == CommandState::Queued;
+        it->second.code = code;
+        it->second.message = message;
+        finish(shard, commandId, it->second, code == 0 ? CommandState::Acked : CommandState::Failed, Clock::now(),
+               notifications);
+    }
+    shard.changed.notify_all();
+    if (queued) {
+        mOutbox.withdraw(deviceId, commandId);
+    }
+    for (auto& notification : notifications) {
+        notification.callback(notification.status);
+    }
+    return true;
+}
+
+/**
+ * @brief 查询命令状态
+ *        Query the status of a command.
+ *
+ * @param commandId 命令ID
+ * @return std::optional<CommandStatus> 命令状态
+ */
+auto CommandTracker::status(uint64_t commandId) const -> std::optional<CommandStatus> {
+    const auto& shard = shardOf(commandId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.records.find(commandId);
+    if (it == shard.records.end()) {
+        return std::nullopt;
+    }
+    return toStatus(commandId, it->second);
+}
+
+/**
+ * @brief 等待命令进入终态
+ *        Wait until a command reaches a terminal state.
+ *
+ * @param commandId 命令ID
+ * @param timeout 最长等待时间
+ * @return std::optional<CommandStatus> 等待结束时的命令状态
+ */
+auto CommandTracker::await(uint64_t commandId, std::chrono::milliseconds timeout) -> std::optional<CommandStatus> {
+    auto& shard = shardOf(commandId);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    shard.changed.wait_for(lock, timeout, [&]() {
+        auto it = shard.records.find(commandId);
+        return mStopped || it == shard.records.end() || isTerminal(it->second.state);
+    });
+    auto it = shard.records.find(commandId);
+    if (it == shard.records.end()) {
+        return std::nullopt;
+    }
+    return toStatus(commandId, it->second);
+}
+
+/**
+ * @brief 非阻塞地等待命令进入终态
+ *        Wait for a terminal state without blocking.
+ *
+ * 命令已是终态或不存在时立即回调；否则登记等待者并在时间轮上安排超时定时器。
+ * The callback runs at once when the command is already terminal or unknown; otherwise a watcher is
+ * registered and a timeout timer is scheduled on the wheel.
+ *
+ * @param commandId 命令ID
+ * @param timeout 最长等待时间
+ * @param callback 完成回调
+ */
+void CommandTracker::watch(uint64_t commandId, std::chrono::milliseconds timeout, CompletionCallback callback) {
+    auto& shard = shardOf(commandId);
+    std::optional<CommandStatus> status;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.records.find(commandId);
+        if (it != shard.records.end()) {
+            if (!isTerminal(it->second.state) && !mStopped) {
+                uint32_t watcher = shard.nextWatcher++;
+                if (shard.nextWatcher == 0) {
+                    shard.nextWatcher = 1; // 0 保留给记录自身的定时器
+                }
+                it->second.watchers.emplace_back(watcher, std::move(callback));
+                shard.wheel.schedule(Clock::now() + timeout, Timer { commandId, 0, watcher });
+                return;
+            }
+            status = toStatus(commandId, it->second);
+        }
+    }
+    callback(status);
+}
+
+/**
+ * @brief 设备重新订阅后恢复其暂停的重试
+ *        Resume the parked retries of a device that subscribed again.
+ *
+ * 仍处于入队状态的命令还在设备队列中，新的投递流会送出它，因此只重新等待回执而不重复入队；
+ * 已送达未回执的命令重新发送。
+ * A command still queued sits in the device queue and goes out on the new stream, so it only awaits its ack
+ * again instead of being queued twice; a delivered but unacknowledged command is sent again.
+ *
+ * @param deviceId 设备ID
+ */
+void CommandTracker::resume(const std::string& deviceId) {
+    auto& shard = *mShards[std::hash<std::string> {}(deviceId) & (kSHARD_COUNT - 1)];
+    auto now = Clock::now();
+    std::vector<OutboundCommand> resends;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found = shard.parked.find(deviceId);
+        if (found == shard.parked.end()) {
+            return;
+        }
+        auto commandIds = std::move(found->second);
+        shard.parked.erase(found);
+        for (auto commandId : commandIds) {
+            auto it = shard.records.find(commandId);
+            if (it == shard.records.end() || !it->second.parked) {
+                continue;
+            }
+            auto& record = it->second;
+            record.parked = false;
+            if (record.state == CommandState::Queued) {
+                ++record.generation;
+                shard.wheel.schedule(now + mPolicy.ackTimeout, Timer { commandId, record.generation });
+                continue;
+            }
+            rearm(shard, commandId, record, now);
+            resends.push_back(record.command);
+        }
+    }
+    for (auto& command : resends) {
+        mOutbox.enqueue(deviceId, std::move(command));
+    }
+}
+
+/**
+ * @brief 推进所有分片的时间轮
+ *        Advance every shard's timing wheel.
+ *
+ * 重发与撤回在释放分片锁之后进行，避免持锁访问下行队列。
+ * Resends and withdrawals happen after the shard lock is released so the outbound queues are never touched
+ * under it.
+ *
+ * @param now 当前时间点
+ */
+void CommandTracker::tick(Clock::time_point now) {
+    std::vector<Resend> resends;
+    std::vector<Withdrawal> withdrawals;
+    std::vector<Notification> notifications;
+    for (auto& shard : mShards) {
+        size_t fired = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            fired = shard->wheel.advance(now, [&](const Timer& timer) {
+                onTimer(*shard, timer, now, resends, withdrawals, notifications);
+            });
+        }
+        if (fired > 0) {
+            shard->changed.notify_all();
+        }
+    }
+
+    for (const auto& withdrawal : withdrawals) {
+        mOutbox.withdraw(withdrawal.deviceId, withdrawal.commandId);
+    }
+    retry(resends, now);
+    for (auto& notification : notifications) {
+        notification.callback(notification.status);
+    }
+}
+
+/**
+ * @brief 发出退避结束的重试，设备未订阅时暂停
+ *        Send the retries whose backoff ended, parking them while the device has no stream.
+ *
+ * 订阅状态在加锁前读取。暂停后再次检查，设备恰好在此期间订阅时，它的 resume() 可能早于暂停，由这里补上。
+ * 上一份副本仍在设备队列中（投递流尚未取出）时只重新等待回执并计入一次发送，不再入队第二份，
+ * 因此投递流一直不取出的命令仍会在重试耗尽后超时。
+ * The subscription is read before locking. It is checked again after parking: a device subscribing in between
+ * may have run its resume() before the park, so the resume is repeated here. While the previous copy is still in
+ * the device queue, not yet drained by the stream, the retry only awaits the ack again and counts an attempt
+ * without queueing a second copy, so a command the stream never drains still times out once attempts run out.
+ *
+ * @param resends 退避结束的命令
+ * @param now 当前时间点
+ */
+void CommandTracker::retry(std::vector<Resend>& resends, Clock::time_point now) {
+    for (auto& resend : resends) {
+        bool subscribed = mOutbox.subscribed(resend.deviceId);
+        bool queued = subscribed && mOutbox.pending(resend.deviceId, resend.commandId);
+        auto& shard = shardOf(resend.commandId);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.records.find(resend.commandId);
+            if (it == shard.records.end() || it->second.generation != resend.generation) {
+                continue; // 期间已回执或已清理
+            }
+            auto& record = it->second;
+            if (subscribed) {
+                rearm(shard, resend.commandId, record, now);
+            } else {
+                record.parked = true;
+                ++record.generation;
+                shard.wheel.schedule(now + mPolicy.parkTimeout, Timer { resend.commandId, record.generation });
+                shard.parked[record.deviceId].push_back(resend.commandId);
+            }
+        }
+        if (subscribed && !queued) {
+            // 队列已满时本次发送视为失败，由下一次回执超时继续处理
+            mOutbox.enqueue(resend.deviceId, std::move(resend.command));
+        } else if (!subscribed && mOutbox.subscribed(resend.deviceId)) {
+            resume(resend.deviceId);
+        }
+    }
+}
+
+/**
+ * @brief 重新发送：计入一次发送，回到入队状态并等待回执
+ *        Count one more delivery attempt, go back to queued and await the ack.
+ *
+ * @param shard 所在分片
+ * @param commandId 命令ID
+ * @param record 命令记录
+ * @param now 当前时间点
+ */
+void CommandTracker::rearm(Shard& shard, uint64_t commandId, Record& record, Clock::time_point now) {
+    record.state = CommandState::Queued;
+    ++record.attempts;
+    ++record.generation;
+    shard.wheel.schedule(now + mPolicy.ackTimeout, Timer { commandId, record.generation });
+}
+
+/**
+ * @brief 将命令移出设备的暂停列表，列表为空时一并移除
+ *        Take a command off its device's parked list, dropping the list once empty.
+ *
+ * @param shard 所在分片
+ * @param commandId 命令ID
+ * @param record 命令记录
+ */
+void CommandTracker::unpark(Shard& shard, uint64_t commandId, Record& record) {
+    if (!record.parked) {
+        return;
+    }
+    record.parked = false;
+    auto found = shard.parked.find(record.deviceId);
+    if (found == shard.parked.end()) {
+        return;
+    }
+    auto& commandIds = found->second;
+    commandIds.erase(std::remove(commandIds.begin(), commandIds.end(), commandId), commandIds.end());
+    if (commandIds.empty()) {
+        shard.parked.erase(found);
+    }
+}
+
+/**
+ * @brief 计算退避时间：backoffBase * 2^(attempt-1)，不超过 backoffMax
+ *        Backoff: backoffBase * 2^(attempt-1), capped at backoffMax.
+ *
+ * @param attempt 已失败的发送次数
+ * @return std::chrono::milliseconds 退避时间
+ */
+auto CommandTracker::backoff(uint32_t attempt) const -> std::chrono::milliseconds {
+    auto shift = std::min<uint32_t>(attempt > 0 ? attempt - 1 : 0, 20);
+    return std::min<std::chrono::milliseconds>(mPolicy.backoffBase * (1LL << shift), mPolicy.backoffMax);
+}
+
+/**
+ * @brief 处理一个到期定时器
+ *        Handle one expired timer.
+ *
+ * 代数不匹配的定时器已被后续状态变化取代，直接忽略；
+ * 回执超时时若未达最大次数则进入退避，退避结束后交给 retry() 重发；暂停超时的命令以超时结束；
+ * 终态记录到期后被清理。超时的命令从设备队列中撤回。
+ * Timers whose generation no longer matches were superseded and are ignored. An ack timeout enters backoff
+ * unless attempts are exhausted, and retry() resends once the backoff ends; a parked command that is not
+ * resumed in time times out; terminal records are purged. A command timing out is withdrawn from the device
+ * queue.
+ *
+ * @param shard 所在分片
+ * @param timer 到期定时器
+ * @param now 当前时间点
+ * @param resends 输出的待重发命令
+ * @param withdrawals 输出的待撤回命令
+ * @param notifications 输出的待执行完成回调
+ */
+void CommandTracker::onTimer(Shard& shard, const Timer& timer, Clock::time_point now, std::vector<Resend>& resends,
+                             std::vector<Withdrawal>& withdrawals, std::vector<Notification>& notifications) {
+    auto it = shard.records.find(timer.commandId);
+    if (it == shard.records.end()) {
+        return;
+    }
+
+    if (timer.watcher != 0) {
+        // 等待者超时：仍在等待时以当前状态回调；命令已完成时等待者早已被通知并移除
+        auto& watchers = it->second.watchers;
+        auto watcher = std::find_if(watchers.begin(), watchers.end(),
+                                    [&](const Watcher& w) { return w.first == timer.watcher; });
+        if (watcher != watchers.end()) {
+            notifications.push_back(Notification { std::move(watcher->second), toStatus(timer.commandId, it->second) });
+            watchers.erase(watcher);
+        }
+        return;
+    }
+
+    if (it->second.generation != timer.generation) {
+        return;
+    }
+
+    auto& record = it->second;
+    if (isTerminal(record.state)) {
+        shard.records.erase(it);
+        return;
+    }
+
+    if (record.parked) {
+        withdrawals.push_back(Withdrawal { timer.commandId, record.deviceId });
+        finish(shard, timer.commandId, record, CommandState::TimedOut, now, notifications);
+        return;
+    }
+
+    if (record.retryPending) {
+        // 退避结束，释放分片锁后重新发送或暂停
+        record.retryPending = false;
+        resends.push_back(Resend { timer.commandId, record.generation, record.deviceId, record.command });
+        return;
+    }
+
+    if (record.attempts >= mPolicy.maxAttempts) {
+        withdrawals.push_back(Withdrawal { timer.commandId, record.deviceId });
+        finish(shard, timer.commandId, record, CommandState::TimedOut, now, notifications);
+        return;
+    }
+
+    record.retryPending = true;
+    ++record.generation;
+    shard.wheel.schedule(now + backoff(record.attempts), Timer { timer.commandId, record.generation });
+}
+
+/**
+ * @brief 将记录置为终态，并安排在保留期后清理
+ *        Move a record to a terminal state and schedule its cleanup after the retention period.
+ *
+ * @param shard 所在分片
+ * @param commandId 命令ID
+ * @param record 命令记录
+ * @param state 终态
+ * @param now 当前时间点
+ * @param notifications 输出的待执行完成回调，所有等待者在此被取出
+ */
+void CommandTracker::finish(Shard& shard, uint64_t commandId, Record& record, CommandState state,
+                            Clock::time_point now, std::vector<Notification>& notifications) {
+    unpark(shard, commandId, record);
+    record.state = state;
+    record.retryPending = false;
+    ++record.generation;
+    shard.wheel.schedule(now + mPolicy.retention, Timer { commandId, record.generation });
+
+    auto status = toStatus(commandId, record);
+    for (auto& watcher : record.watchers) {
+        notifications.push_back(Notification { std::move(watcher.second), status });
+    }
+    record.watchers.clear();
+}
+
+/**
+ * @brief 后台线程主循环，每个 tick 推进一次时间轮
+ *        Background thread main loop advancing the wheels once per tick.
+ */
+void CommandTracker::loop() {
+    while (mRunning) {
+        std::this_thread::sleep_for(kTICK);
+        tick();
+    }
+}
+
+/**
+ * @brief 生成对外的状态快照
+ *        Build the public status snapshot.
+ *
+ * @param commandId 命令ID
+ * @param record 命令记录
+ * @return CommandStatus 状态快照
+ */
+auto CommandTracker::toStatus(uint64_t commandId, const Record& record) -> CommandStatus {
+    return CommandStatus { commandId, record.deviceId, record.state, record.attempts, record.code, record.message };
+}
+
+IOT_NS_END
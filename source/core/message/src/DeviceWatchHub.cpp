@@ -0,0 +1,460 @@
+#include "DeviceWatchHub.h"
+
+#include <algorithm>
+
+IOT_NS_BEGIN
+
+namespace {
+
+/**
+ * @brief 设备管理器事件类型转换为订阅事件类型
+ *        Map a device manager event type to a watch event type.
+ */
+auto toWatchType(DeviceEvent::Type type) -> DeviceWatchEvent::Type {
+    switch (type) {
+    case DeviceEvent::Type::Online:
+        return DeviceWatchEvent::Type::Online;
+    case DeviceEvent::Type::Offline:
+        return DeviceWatchEvent::Type::Offline;
+    case DeviceEvent::Type::StatusChanged:
+        return DeviceWatchEvent::Type::StatusChanged;
+    case DeviceEvent::Type::Resync:
+        return DeviceWatchEvent::Type::Resync;
+    }
+    return DeviceWatchEvent::Type::StatusChanged;
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ *        Constructor.
+ *
+ * @param hub 所属扇出缓冲
+ * @param filter 过滤条件
+ * @param policy 溢出策略
+ */
+DeviceWatcher::DeviceWatcher(DeviceWatchHub& hub, DeviceWatchFilter filter, WatchOverflowPolicy policy)
+    : mHub(hub)
+    , mFilter(std::move(filter))
+    , mPolicy(policy) {}
+
+/**
+ * @brief 析构函数，确保已退订
+ *        Destructor: makes sure the watcher is unsubscribed.
+ */
+DeviceWatcher::~DeviceWatcher() {
+    close();
+}
+
+/**
+ * @brief 不等待，取出一批匹配的事件
+ *        Take one batch of matching events without waiting.
+ *
+ * 先发送尚未发完的快照；之后沿游标读取，直到凑满一批或读到最新位置。
+ * 未读事件已被覆盖时，Resync 策略从最新位置重新加载快照，Drop 策略断开订阅。
+ * 读到批量变更的 Resync 标记时，无论哪种策略都从最新位置重新加载快照，以一份快照代替逐设备的事件。
+ * A pending snapshot goes first; then the cursor advances until the batch is full or the watcher catches up.
+ * When unread events were overwritten, Resync reloads a snapshot at the head and Drop ends the watch. On reading
+ * the Resync marker of a bulk change, either policy reloads a snapshot at the head, which stands in for the
+ * per-device events.
+ *
+ * @param out 输出的事件批次
+ * @param maxBatch 单批次事件上限
+ * @return bool 订阅有效返回 true，已退订或被断开返回 false
+ */
+auto DeviceWatcher::poll(std::vector<DeviceWatchEvent>& out, size_t maxBatch) -> bool {
+    drainSnapshot(out, maxBatch);
+
+    std::vector<DeviceWatchHub::EventPtr> chunk;
+    while (out.size() < maxBatch) {
+        chunk.clear();
+        auto result = mHub.read(*this, chunk, maxBatch - out.size());
+        if (result == DeviceWatchHub::ReadResult::Closed) {
+            return false;
+        }
+        if (result == DeviceWatchHub::ReadResult::Overflow) {
+            if (mPolicy == WatchOverflowPolicy::Drop) {
+                close();
+                return false;
+            }
+            ++mResyncs;
+            loadSnapshot(mHub.rewind(*this));
+            drainSnapshot(out, maxBatch);
+            break;
+        }
+
+        // 过滤在缓冲锁之外进行，读取时只复制事件指针
+        bool resync = false;
+        for (const auto& event : chunk) {
+            if (event->type == DeviceWatchEvent::Type::Resync) {
+                resync = true; // 标记之后的事件都已反映在新快照中
+                break;
+            }
+            if (mFilter.matches(event->deviceId, event->owner)) {
+                out.push_back(*event);
+            }
+        }
+        if (resync) {
+            loadSnapshot(mHub.rewind(*this));
+            drainSnapshot(out, maxBatch);
+            break;
+        }
+        if (result == DeviceWatchHub::ReadResult::CaughtUp) {
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 等待事件到达并取出一批
+ *        Wait for events and take one batch.
+ *
+ * @param out 输出的事件批次
+ * @param maxBatch 单批次事件上限
+ * @param timeout 最长等待时间
+ * @return bool 与 poll 相同
+ */
+auto DeviceWatcher::waitAndPoll(std::vector<DeviceWatchEvent>& out, size_t maxBatch,
+                                std::chrono::milliseconds timeout) -> bool {
+    if (!poll(out, maxBatch)) {
+        return false;
+    }
+    if (!out.empty()) {
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait_for(lock, timeout, [this]() { return mSignalled; });
+        mSignalled = false;
+    }
+    return poll(out, maxBatch);
+}
+
+/**
+ * @brief 设置事件就绪监听器
+ *        Install the ready listener.
+ *
+ * @param listener 就绪监听器，空函数表示解除监听
+ * @return uint64_t 监听器标识
+ */
+auto DeviceWatcher::setReadyListener(std::function<void()> listener) -> uint64_t {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    mListener = std::move(listener);
+    return ++mListenerToken;
+}
+
+/**
+ * @brief 仅当 token 标识的监听器仍在时解除监听
+ *        Detach the listener if the token still identifies it.
+ *
+ * @param token setReadyListener 返回的标识
+ */
+void DeviceWatcher::clearReadyListener(uint64_t token) {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    if (token == mListenerToken) {
+        mListener = nullptr;
+    }
+}
+
+/**
+ * @brief 退订
+ *        Unsubscribe.
+ */
+void DeviceWatcher::close() {
+    mHub.unsubscribe(*this);
+}
+
+/**
+ * @brief 加载给定序号处的快照，末尾追加 Synced 事件
+ *        Load the snapshot at the given sequence, followed by a Synced event.
+ *
+ * @param sequence 快照对应的序号
+ */
+void DeviceWatcher::loadSnapshot(uint64_t sequence) {
+    mSnapshot.clear();
+    mSnapshotPos = 0;
+    mHub.snapshot(mFilter, sequence, mSnapshot);
+
+    DeviceWatchEvent synced;
+    synced.type = DeviceWatchEvent::Type::Synced;
+    synced.sequence = sequence;
+    mSnapshot.push_back(std::move(synced));
+}
+
+/**
+ * @brief 从待发送的快照中取出事件
+ *        Move events out of the pending snapshot.
+ *
+ * @param out 输出的事件批次
+ * @param maxBatch 单批次事件上限
+ */
+void DeviceWatcher::drainSnapshot(std::vector<DeviceWatchEvent>& out, size_t maxBatch) {
+    while (mSnapshotPos < mSnapshot.size() && out.size() < maxBatch) {
+        out.push_back(std::move(mSnapshot[mSnapshotPos++]));
+    }
+    if (mSnapshotPos == mSnapshot.size() && !mSnapshot.empty()) {
+        mSnapshot.clear();
+        mSnapshot.shrink_to_fit(); // 快照可能很大，发送完毕后立即释放
+        mSnapshotPos = 0;
+    }
+}
+
+/**
+ * @brief 唤醒等待中的 waitAndPoll 并通知就绪监听器
+ *        Wake a waiting waitAndPoll and notify the ready listener.
+ */
+void DeviceWatcher::notifyReady() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSignalled = true;
+    }
+    mCondition.notify_one();
+
+    std::function<void()> listener;
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        listener = mListener;
+    }
+    if (listener) {
+        listener();
+    }
+}
+
+/**
+ * @brief 构造函数
+ *        Constructor.
+ *
+ * @param capacity 环形缓冲容量，至少为 1
+ */
+DeviceWatchHub::DeviceWatchHub(size_t capacity)
+    : mCapacity(std::max<size_t>(capacity, 1))
+    , mRing(mCapacity) {}
+
+/**
+ * @brief 设置快照提供函数
+ *        Install the snapshot provider.
+ *
+ * @param provider 快照提供函数
+ */
+void DeviceWatchHub::setSnapshotProvider(SnapshotProvider provider) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mProvider = std::move(provider);
+}
+
+/**
+ * @brief 设置订阅者活跃状态回调
+ *        Install the activity listener.
+ *
+ * @param listener 活跃状态回调
+ */
+void DeviceWatchHub::setActivityListener(ActivityListener listener) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mActivity = std::move(listener);
+}
+
+/**
+ * @brief 新建订阅者
+ *        Create a watcher.
+ *
+ * 先通知活跃状态（使设备管理器开始发出状态内容变化事件），再确定订阅起点，最后加载快照，
+ * 因此起点之后的变化要么已反映在快照中，要么随后作为增量事件送达。
+ * The activity listener runs first (so the device manager starts emitting status change events), then the
+ * starting sequence is fixed, then the snapshot is loaded; every change after the start is therefore either in
+ * the snapshot or delivered afterwards as an incremental event.
+ *
+ * @param filter 过滤条件
+ * @param policy 溢出策略
+ * @return std::shared_ptr<DeviceWatcher> 订阅者
+ */
+auto DeviceWatchHub::subscribe(DeviceWatchFilter filter, WatchOverflowPolicy policy)
+    -> std::shared_ptr<DeviceWatcher> {
+    auto watcher = std::make_shared<DeviceWatcher>(*this, std::move(filter), policy);
+    uint64_t start = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mWatchers.fetch_add(1, std::memory_order_relaxed) == 0 && mActivity) {
+            mActivity(true);
+        }
+        start = mHead;
+        watcher->mCursor = start;
+    }
+    watcher->loadSnapshot(start);
+    return watcher;
+}
+
+/**
+ * @brief 写入一个设备事件并唤醒已读到最新位置的订阅者
+ *        Publish a device event and wake the watchers that had caught up.
+ *
+ * 事件对象在锁外构造；锁内只存放指针、递增序号并取走等待唤醒列表，唤醒在锁外进行。
+ * 仍在读取积压事件的订阅者不在等待唤醒列表中，不会被重复唤醒。
+ * The event is built outside the lock; inside it only a pointer is stored, the sequence bumped and the armed
+ * list taken, and wakeups happen outside. Watchers still reading a backlog are not armed and are not woken again.
+ *
+ * @param event 设备事件
+ */
+void DeviceWatchHub::publish(const DeviceEvent& event) {
+    if (mWatchers.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    auto entry = std::make_shared<DeviceWatchEvent>();
+    entry->type = toWatchType(event.type);
+    entry->deviceId = event.deviceId;
+    entry->status = event.status;
+    entry->report = event.report;
+    entry->owner = event.owner;
+    append(std::move(entry));
+}
+
+/**
+ * @brief 写入一个规则事件
+ *        Publish a rule event.
+ *
+ * 命中规则的上报刚被受理，设备因此记为在线。
+ * The matching report has just been accepted, so the device is reported online.
+ *
+ * @param deviceId 设备ID
+ * @param owner 设备所有者
+ * @param event 规则事件名
+ * @param report 命中规则的状态上报内容
+ */
+void DeviceWatchHub::publishRuleEvent(const std::string& deviceId, const std::string& owner,
+                                      const std::string& event, const std::string& report) {
+    if (mWatchers.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    auto entry = std::make_shared<DeviceWatchEvent>();
+    entry->type = DeviceWatchEvent::Type::RuleMatched;
+    entry->deviceId = deviceId;
+    entry->status = DeviceStatus::ONLINE;
+    entry->report = report;
+    entry->event = event;
+    entry->owner = owner;
+    append(std::move(entry));
+}
+
+/**
+ * @brief 将事件存入环形缓冲并唤醒已读到最新位置的订阅者
+ *        Store an event in the ring and wake the watchers that had caught up.
+ *
+ * @param entry 已构造好的事件
+ */
+void DeviceWatchHub::append(std::shared_ptr<DeviceWatchEvent> entry) {
+    std::vector<std::weak_ptr<DeviceWatcher>> wake;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry->sequence = ++mHead;
+        mRing[mHead % mCapacity] = std::move(entry);
+        wake.swap(mArmed);
+        std::erase_if(wake, [](const std::weak_ptr<DeviceWatcher>& weak) {
+            auto watcher = weak.lock();
+            if (!watcher || watcher->mClosed) {
+                return true;
+            }
+            watcher->mArmed = false;
+            return false;
+        });
+    }
+
+    for (const auto& weak : wake) {
+        if (auto watcher = weak.lock()) {
+            watcher->notifyReady();
+        }
+    }
+}
+
+/**
+ * @brief 沿订阅者游标读取一段事件
+ *        Read a run of events along the watcher's cursor.
+ *
+ * 读到最新位置时把订阅者加入等待唤醒列表；判断与加入在同一次加锁内完成，不会错过之后写入的事件。
+ * On catching up the watcher joins the armed list; the check and the join share one lock, so no later write
+ * can be missed.
+ *
+ * @param watcher 订阅者
+ * @param out 输出的事件指针
+ * @param maxCount 读取上限
+ * @return ReadResult 读取结果
+ */
+auto DeviceWatchHub::read(DeviceWatcher& watcher, std::vector<EventPtr>& out, size_t maxCount) -> ReadResult {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (watcher.mClosed) {
+        return ReadResult::Closed;
+    }
+    if (mHead - watcher.mCursor > mCapacity) {
+        mOverflows.fetch_add(1, std::memory_order_relaxed);
+        return ReadResult::Overflow;
+    }
+
+    while (watcher.mCursor < mHead && out.size() < maxCount) {
+        ++watcher.mCursor;
+        out.push_back(mRing[watcher.mCursor % mCapacity]);
+    }
+    if (watcher.mCursor < mHead) {
+        return ReadResult::More;
+    }
+    if (!watcher.mArmed) {
+        watcher.mArmed = true;
+        mArmed.push_back(watcher.weak_from_this());
+    }
+    return ReadResult::CaughtUp;
+}
+
+/**
+ * @brief 将订阅者游标移到最新位置
+ *        Move the watcher's cursor to the head.
+ *
+ * @param watcher 订阅者
+ * @return uint64_t 最新位置的序号
+ */
+auto DeviceWatchHub::rewind(DeviceWatcher& watcher) -> uint64_t {
+    std::lock_guard<std::mutex> lock(mMutex);
+    watcher.mCursor = mHead;
+    return mHead;
+}
+
+/**
+ * @brief 生成快照，快照提供函数在缓冲锁之外执行
+ *        Produce a snapshot; the provider runs outside the buffer lock.
+ *
+ * @param filter 过滤条件
+ * @param sequence 快照对应的序号
+ * @param out 输出的快照事件
+ */
+void DeviceWatchHub::snapshot(const DeviceWatchFilter& filter, uint64_t sequence,
+                              std::vector<DeviceWatchEvent>& out) const {
+    SnapshotProvider provider;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        provider = mProvider;
+    }
+    if (provider) {
+        provider(filter, sequence, out);
+    }
+}
+
+/**
+ * @brief 退订，可重复调用
+ *        Unsubscribe; safe to call more than once.
+ *
+ * 等待唤醒列表中的弱引用无需移除，写入时会跳过已失效或已退订的订阅者。
+ * Weak references in the armed list are left in place; publishing skips expired or closed watchers.
+ *
+ * @param watcher 订阅者
+ */
+void DeviceWatchHub::unsubscribe(DeviceWatcher& watcher) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (watcher.mClosed) {
+        return;
+    }
+    watcher.mClosed = true;
+    if (mWatchers.fetch_sub(1, std::memory_order_relaxed) == 1 && mActivity) {
+        mActivity(false);
+    }
+}
+
+IOT_NS_END
@@ -2,10 +2,86 @@
 
 #include "user/User.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 IOT_NS_BEGIN
 
+namespace {
+
+/**
+ * @brief 合并同一设备两次未处理的状态上报：状态内容取新值，属性按键合并，同一键取新值
+ *        Merge two pending status reports of a device: the newer status wins and attributes merge by key,
+ *        the newer value winning per key.
+ *
+ * @param pending 槽位中尚未处理的上报
+ * @param next 新到达的上报
+ */
+void mergeStatusReport(MessageTask& pending, MessageTask&& next) {
+    pending.commandOrStatus = std::move(next.commandOrStatus);
+    pending.userId = std::move(next.userId);
+    pending.token = std::move(next.token);
+    if (isValid(next.handle)) {
+        pending.handle = next.handle;
+    }
+    for (auto& detail : next.details) {
+        auto it = std::find_if(pending.details.begin(), pending.details.end(),
+                               [&detail](const auto& existing) { return existing.first == detail.first; });
+        if (it != pending.details.end()) {
+            it->second = std::move(detail.second);
+        } else {
+            pending.details.push_back(std::move(detail));
+        }
+    }
+}
+
+/**
+ * @brief 合并模式下的待处理槽位键：设备ID + '\0' + 消息类型，状态上报与心跳互不覆盖
+ *        Pending slot key in coalescing mode: device ID + '\0' + message type, so status reports and heartbeats
+ *        never replace each other.
+ */
+auto pendingKey(const std::string& deviceId, MessageTask::Type type) -> std::string {
+    std::string key = deviceId;
+    key.push_back('\0');
+    key.push_back(type == MessageTask::Type::StatusReport ? 'S' : 'H');
+    return key;
+}
+
+/**
+ * @brief 当前 Unix 时间（毫秒），用于状态聚合的窗口与规则命令的时间戳
+ */
+auto unixMillis() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief 消息负载的防重放摘要：正文与各键值对依次累加
+ *        Replay digest of a message payload: the body followed by every key-value pair.
+ */
+template <typename Pairs>
+auto payloadDigest(const std::string& body, const Pairs& pairs) -> uint64_t {
+    auto digest = ReplayGuard::digest(body);
+    for (const auto& [key, value] : pairs) {
+        digest = ReplayGuard::digest(value, ReplayGuard::digest(key, digest));
+    }
+    return digest;
+}
+
+/**
+ * @brief 汇总配置中的规则源码与规则文件
+ */
+auto ruleSources(const RouterOptions& options) -> std::vector<std::string> {
+    auto sources = options.rules;
+    if (!options.rulesFile.empty() && !RuleEngine::loadFile(options.rulesFile, sources)) {
+        std::cerr << "MessageRouter: cannot open rules file " << options.rulesFile << std::endl;
+    }
+    return sources;
+}
+
+} // namespace
+
 /**
  * @brief 消息路由器类，实现设备消息的分发与处理逻辑
  *        MessageRouter class that implements dispatch and handling of device messages.
@@ -19,10 +95,63 @@ IOT_NS_BEGIN
  * @version 1.0
  * @date 2025-06-07
  */
-MessageRouter::MessageRouter() {
-    mThead.start(); // 启动内部处理线程，保证消息异步处理
-    mDeviceManagerFactory = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
-    mUserManagerFactory = IOT_USER_NS::UserManagerFactory::instance().create(USER_MANAGER_DEFAULT);
+MessageRouter::MessageRouter(const std::string& userManagerName, const RouterOptions& options)
+    : mOutbox(options.outboxCapacity)
+    , mTracker(mOutbox, options.retry)
+    , mDeduplicator(options.dedupWindow, options.dedupShardCapacity)
+    , mReplayGuard(options.replayWindow)
+    , mPendingSlots(options.pendingShardCount)
+    , mWatchHub(options.watchBufferCapacity)
+    , mAggregator(options.aggregations, options.aggregationGroupDelimiter)
+    , mRules(ruleSources(options))
+    , mCoalescing(options.coalescing) {
+    // 启动内部处理线程，保证消息异步处理；至少保留一个线程
+    size_t workers = std::max<size_t>(options.workerThreads, 1);
+    for (size_t i = 0; i < workers; ++i) {
+        mWorkers.push_back(std::make_unique<IOT_TASK_NS::HandlerThread>("Router-" + std::to_string(i)));
+        mWorkers.back()->start();
+    }
+    mTracker.start(); // 启动回执跟踪的时间轮线程
+    mDeviceManagerFactory = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(options.deviceManager);
+    if (!mDeviceManagerFactory) {
+        std::cerr << "MessageRouter: unknown device manager " << options.deviceManager << ", using "
+                  << DEVICE_MANAGER_DEFAULT << std::endl;
+        mDeviceManagerFactory = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    }
+    mUserManagerFactory = IOT_USER_NS::UserManagerFactory::instance().create(userManagerName);
+    if (mUserManagerFactory) {
+        mUserManagerFactory->configure(options.user);
+    }
+    if (mDeviceManagerFactory) {
+        mDeviceManagerFactory->configure(options.device);
+        mDeviceManagerFactory->setEventListener([this](const DeviceEvent& event) {
+            // 订阅缓冲在上报线程上直接写入；状态内容变化与批量变更只供订阅者使用，不进入处理线程
+            mWatchHub.publish(event);
+            if (event.type == DeviceEvent::Type::Offline) {
+                mReplayGuard.release(event.deviceId); // 一个接受窗口后回收离线设备的防重放状态
+            }
+            if (event.type == DeviceEvent::Type::Online || event.type == DeviceEvent::Type::Offline) {
+                if (mRules.enabled()) {
+                    applyTransitionRules(event);
+                }
+                dispatchEvent(event);
+            }
+        });
+        // 只在有订阅者时让设备管理器比较并复制状态内容
+        mWatchHub.setActivityListener([this](bool active) { mDeviceManagerFactory->setStatusEventsEnabled(active); });
+    }
+    mWatchHub.setSnapshotProvider([this](const DeviceWatchFilter& filter, uint64_t sequence,
+                                         std::vector<DeviceWatchEvent>& out) { snapshotDevices(filter, sequence, out); });
+}
+
+/**
+ * @brief 析构函数，解除设备事件监听，避免设备管理器回调已销毁的路由器
+ *        Destructor: detach the event listener so the device manager never calls back into a dead router.
+ */
+MessageRouter::~MessageRouter() {
+    if (mDeviceManagerFactory) {
+        mDeviceManagerFactory->setEventListener(nullptr);
+    }
 }
 
 /**
@@ -33,12 +162,161 @@ MessageRouter::MessageRouter() {
  * @param command  命令内容字符串
  * @param userId   用户唯一标识符
  * @param token    用户认证令牌
- * @return std::string 返回处理结果字符串，固定为"Command accepted"
+ * @param params   命令参数
+ * @param timestamp 命令时间戳（毫秒）
+ * @return std::string 返回处理结果字符串，入队成功为"Command accepted"，队列已满为"Command queue full"，
+ *         重放的命令为"Replay rejected"，鉴权失败或设备不属于该用户为"Unauthorized"
  */
 auto MessageRouter::handleCommand(const std::string& deviceId, const std::string& command, const std::string& userId,
-                                  const std::string& token) -> std::string {
-    dispatch(MessageTask { MessageTask::Type::Command, deviceId, command, userId, token });
-    return "Command accepted";
+                                  const std::string& token, const CommandParams& params,
+                                  int64_t timestamp) -> std::string {
+    return submitCommand(deviceId, command, userId, token, params, "", timestamp).message;
+}
+
+/**
+ * @brief 提交设备命令：鉴权后交给回执跟踪器分配命令ID并入队
+ *        Submit a device command: after authorization the ack tracker assigns an ID and queues it.
+ *
+ * 只有通过鉴权、且设备已注册并对该用户可见时才继续处理，否则不会创建下行队列、防重放状态或跟踪记录。
+ * 携带幂等键的重复提交在去重窗口内直接返回首次结果，不会再次入队；
+ * 去重之后才做时间戳防重放校验，因此客户端原样重试不会被误判为重放。
+ * Nothing proceeds unless the user authenticates and the device is registered and visible to them, so no
+ * outbox, replay state or tracker record is created for arbitrary IDs. A duplicate carrying a known
+ * idempotency key replays the original result inside the deduplication window and is not queued again. The
+ * timestamp replay check runs after deduplication, so a verbatim client retry is not mistaken for a replay.
+ *
+ * @param deviceId       设备唯一标识符
+ * @param command        命令内容字符串
+ * @param userId         用户唯一标识符
+ * @param token          用户认证令牌
+ * @param params         命令参数
+ * @param idempotencyKey 幂等键，为空时不去重
+ * @param timestamp      命令时间戳（毫秒）
+ * @return CommandReceipt 提交结果
+ */
+auto MessageRouter::submitCommand(const std::string& deviceId, const std::string& command, const std::string& userId,
+                                  const std::string& token, const CommandParams& params,
+                                  const std::string& idempotencyKey, int64_t timestamp) -> CommandReceipt {
+    if (!authorizeDevice(deviceId, userId, token)) {
+        return CommandReceipt { false, 0, "Unauthorized" };
+    }
+
+    return mDeduplicator.submitOnce(deviceId, idempotencyKey, [&]() {
+        if (!mReplayGuard.accept(deviceId, ReplayChannel::Command, timestamp, payloadDigest(command, params))) {
+            return CommandReceipt { false, 0, "Replay rejected" };
+        }
+
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        OutboundCommand outbound { command, params,
+                                   std::chrono::duration_cast<std::chrono::milliseconds>(now).count() };
+
+        // 写入设备下行队列，唤醒设备的订阅流推送，并开始等待回执
+        return mTracker.submit(deviceId, std::move(outbound));
+    });
+}
+
+/**
+ * @brief 处理设备回执，先校验用户 Token 与设备归属，再交给回执跟踪器
+ *        Handle a device ack: validate the user token and device ownership, then hand it to the ack tracker.
+ *
+ * @param deviceId  回执设备ID
+ * @param commandId 命令ID
+ * @param code      回执码
+ * @param message   回执信息
+ * @param userId    用户唯一标识符
+ * @param token     用户认证令牌
+ * @return bool 回执被接受返回 true
+ */
+auto MessageRouter::acknowledgeCommand(const std::string& deviceId, uint64_t commandId, int32_t code,
+                                       const std::string& message, const std::string& userId,
+                                       const std::string& token) -> bool {
+    if (!authorizeDevice(deviceId, userId, token)) {
+        return false;
+    }
+    return mTracker.acknowledge(deviceId, commandId, code, message);
+}
+
+/**
+ * @brief 标记命令已写入设备流
+ *        Mark a command as written to the device stream.
+ *
+ * @param commandId 命令ID
+ */
+void MessageRouter::markCommandDelivered(uint64_t commandId) {
+    mTracker.markDelivered(commandId);
+}
+
+/**
+ * @brief 查询命令状态
+ *        Query the status of a command.
+ *
+ * @param commandId 命令ID
+ * @return std::optional<CommandStatus> 命令状态
+ */
+auto MessageRouter::commandStatus(uint64_t commandId) const -> std::optional<CommandStatus> {
+    return mTracker.status(commandId);
+}
+
+/**
+ * @brief 等待命令进入终态
+ *        Wait until a command reaches a terminal state.
+ *
+ * @param commandId 命令ID
+ * @param timeout   最长等待时间
+ * @return std::optional<CommandStatus> 等待结束时的命令状态
+ */
+auto MessageRouter::awaitCommand(uint64_t commandId, std::chrono::milliseconds timeout)
+    -> std::optional<CommandStatus> {
+    return mTracker.await(commandId, timeout);
+}
+
+/**
+ * @brief 非阻塞地等待命令进入终态
+ *        Wait for a terminal state without blocking.
+ *
+ * @param commandId 命令ID
+ * @param timeout   最长等待时间
+ * @param callback  完成或超时时的回调
+ */
+void MessageRouter::watchCommand(uint64_t commandId, std::chrono::milliseconds timeout,
+                                 CommandTracker::CompletionCallback callback) {
+    mTracker.watch(commandId, timeout, std::move(callback));
+}
+
+/**
+ * @brief 获取设备的下行命令队列
+ *        Get the outbound command queue of a device.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return std::shared_ptr<DeviceOutbox> 设备下行队列
+ */
+auto MessageRouter::attachOutbox(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox> {
+    return mOutbox.attach(deviceId);
+}
+
+/**
+ * @brief 设备订阅流登记到设备的下行命令队列，并恢复等待设备订阅的重试
+ *        Register a device subscription stream on its outbound command queue and resume the retries waiting
+ *        for the device to subscribe.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return std::shared_ptr<DeviceOutbox> 设备下行队列
+ */
+auto MessageRouter::subscribeOutbox(const std::string& deviceId) -> std::shared_ptr<DeviceOutbox> {
+    auto outbox = mOutbox.subscribe(deviceId);
+    mTracker.resume(deviceId);
+    return outbox;
+}
+
+/**
+ * @brief 设备订阅流退订，空闲的队列被回收
+ *        Unsubscribe a device stream; an idle queue is reclaimed.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param outbox subscribeOutbox() 返回的队列
+ */
+void MessageRouter::unsubscribeOutbox(const std::string& deviceId, const std::shared_ptr<DeviceOutbox>& outbox) {
+    mOutbox.unsubscribe(deviceId, outbox);
 }
 
 /**
@@ -49,10 +327,125 @@ auto MessageRouter::handleCommand(const std::string& deviceId, const std::string
  * @param status   状态内容字符串
  * @param userId   用户唯一标识符
  * @param token    用户认证令牌
+ * 与心跳流建立会话一样，先校验 Token 并代表用户注册或认领设备，设备已归属其他用户时拒绝。
+ * As when a heartbeat stream opens its session, the token is validated and the device registered or claimed on
+ * behalf of the user first; a device owned by another user is refused.
+ *
+ * @param timestamp 上报时间戳（毫秒）
+ * @param details  变化的结构化属性
+ * @return bool 上报已受理返回 true，鉴权失败、设备归属其他用户、设备存储出错或重放的上报返回 false
  */
-void MessageRouter::handleStatusReport(const std::string& deviceId, const std::string& status,
-                                       const std::string& userId, const std::string& token) {
-    dispatch(MessageTask { MessageTask::Type::StatusReport, deviceId, status, userId, token });
+auto MessageRouter::handleStatusReport(const std::string& deviceId, const std::string& status,
+                                       const std::string& userId, const std::string& token, int64_t timestamp,
+                                       StatusDetails details) -> bool {
+    DeviceHandle handle = kINVALID_DEVICE_HANDLE;
+    if (!admitDevice(deviceId, userId, token, handle)) {
+        return false;
+    }
+    if (mDeviceManagerFactory && mDeviceManagerFactory->storageFailed()) {
+        std::cout << "Status report for device " << deviceId << " refused, device storage failed" << std::endl;
+        return false;
+    }
+    if (!mReplayGuard.accept(deviceId, ReplayChannel::Status, timestamp, payloadDigest(status, details))) {
+        std::cout << "Replayed status report rejected for device " << deviceId << std::endl;
+        return false;
+    }
+    dispatch(MessageTask { MessageTask::Type::StatusReport, deviceId, status, userId, token, std::move(details),
+                           handle });
+    return true;
+}
+
+/**
+ * @brief 批量处理设备状态上报
+ *        Handle a batch of device status reports.
+ *
+ * 设备须已注册且对该用户可见，通过归属与防重放校验的条目在批次内原地压缩后整体交给设备管理器，
+ * 设备管理器返回的下标再映射回原始位置。
+ * Each device must be registered and visible to the user. Entries passing the ownership and replay checks are
+ * compacted in place and handed to the device manager as a whole; the indexes it returns are mapped back to the
+ * original positions.
+ *
+ * @param userId  用户唯一标识符
+ * @param token   用户认证令牌
+ * @param updates 状态上报批次，状态内容会被移走
+ * @return StatusBatchResult 聚合结果
+ */
+auto MessageRouter::handleStatusBatch(const std::string& userId, const std::string& token,
+                                      std::vector<DeviceStatusUpdate>& updates) -> StatusBatchResult {
+    StatusBatchResult result;
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on status batch" << std::endl;
+        return result;
+    }
+    result.authenticated = true;
+    if (mDeviceManagerFactory && mDeviceManagerFactory->storageFailed()) {
+        std::cout << "Status batch of user " << userId << " refused, device storage failed" << std::endl;
+        for (uint32_t i = 0; i < updates.size(); ++i) {
+            result.failedIndexes.push_back(i);
+        }
+        return result;
+    }
+
+    // 原地压缩通过校验的条目，origin 记录其在原批次中的下标
+    std::vector<uint32_t> origin;
+    origin.reserve(updates.size());
+    for (uint32_t i = 0; i < updates.size(); ++i) {
+        auto& update = updates[i];
+        if (update.deviceId.empty() || !mDeviceManagerFactory
+            || !mDeviceManagerFactory->isDeviceVisibleTo(update.deviceId, userId)
+            || !mReplayGuard.accept(update.deviceId, ReplayChannel::Status, update.timestamp,
+                                    payloadDigest(update.status, update.details))) {
+            result.failedIndexes.push_back(i);
+            continue;
+        }
+        if (origin.size() != i) {
+            updates[origin.size()] = std::move(update);
+        }
+        origin.push_back(i);
+    }
+    updates.resize(origin.size());
+
+    // 设备管理器会移走状态内容，规则引用 $status 时先保留一份
+    std::vector<std::string> statuses;
+    if (mRules.readsStatus()) {
+        statuses.reserve(updates.size());
+        for (const auto& update : updates) {
+            statuses.push_back(update.status);
+        }
+    }
+
+    std::vector<uint32_t> unknown;
+    if (mDeviceManagerFactory) {
+        unknown = mDeviceManagerFactory->reportStatusBatch(updates);
+    } else {
+        for (uint32_t i = 0; i < origin.size(); ++i) {
+            unknown.push_back(i);
+        }
+    }
+    for (auto index : unknown) {
+        result.failedIndexes.push_back(origin[index]);
+    }
+    if (mAggregator.enabled() || mRules.enabled()) {
+        // 未注册设备的上报不参与聚合，也不运行规则
+        std::sort(unknown.begin(), unknown.end());
+        auto nowMs = unixMillis();
+        for (uint32_t i = 0; i < updates.size(); ++i) {
+            if (std::binary_search(unknown.begin(), unknown.end(), i)) {
+                continue;
+            }
+            if (mAggregator.enabled()) {
+                mAggregator.record(updates[i].deviceId, updates[i].details, nowMs);
+            }
+            if (mRules.enabled()) {
+                applyRules(updates[i].deviceId, statuses.empty() ? updates[i].status : statuses[i],
+                           updates[i].details);
+            }
+        }
+    }
+    std::sort(result.failedIndexes.begin(), result.failedIndexes.end());
+    result.accepted = static_cast<uint32_t>(origin.size() - unknown.size());
+    return result;
 }
 
 /**
@@ -62,13 +455,320 @@ void MessageRouter::handleStatusReport(const std::string& deviceId, const std::s
  * @param deviceId 设备唯一标识符
  * @param userId   用户唯一标识符
  * @param token    用户认证令牌
- * @return bool   始终返回 true，表示心跳接收成功
+ * 与心跳流建立会话一样，先校验 Token 并代表用户注册或认领设备，设备已归属其他用户时拒绝。
+ * As when a heartbeat stream opens its session, the token is validated and the device registered or claimed on
+ * behalf of the user first; a device owned by another user is refused.
+ *
+ * @param timestamp 心跳时间戳（毫秒）
+ * @return bool   心跳接收成功返回 true，鉴权失败、设备归属其他用户或重放的心跳返回 false
  */
-auto MessageRouter::handleHeartbeat(const std::string& deviceId, const std::string& userId,
-                                    const std::string& token) -> bool {
+auto MessageRouter::handleHeartbeat(const std::string& deviceId, const std::string& userId, const std::string& token,
+                                    int64_t timestamp) -> bool {
+    DeviceHandle handle = kINVALID_DEVICE_HANDLE;
+    if (!admitDevice(deviceId, userId, token, handle)) {
+        return false;
+    }
+    if (!mReplayGuard.accept(deviceId, ReplayChannel::Heartbeat, timestamp)) {
+        return false;
+    }
     dispatch(MessageTask { MessageTask::Type::Heartbeat, deviceId,
                            "", // 心跳无附加负载
-                           userId, token });
+                           userId, token, {} });
+    return true;
+}
+
+/**
+ * @brief 为心跳流建立会话并完成一次性鉴权
+ *        Open a heartbeat stream session and perform the one-time authentication.
+ *
+ * 鉴权在调用线程上同步完成，结果缓存在会话中，会话在 kSESSION_TTL 后过期。设备已归属其他用户时会话不通过鉴权。
+ * Authentication runs synchronously on the calling thread; the verdict is cached in the session,
+ * which expires after kSESSION_TTL. A device already owned by another user fails authentication.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param userId   用户唯一标识符
+ * @param token    用户认证令牌
+ * @return std::shared_ptr<StreamSession> 新建立的会话
+ */
+auto MessageRouter::openSession(const std::string& deviceId, const std::string& userId,
+                                const std::string& token) -> std::shared_ptr<StreamSession> {
+    auto session = std::make_shared<StreamSession>();
+    session->deviceId = deviceId;
+    session->userId = userId;
+    session->expiresAt = StreamSession::Clock::now() + kSESSION_TTL;
+
+    User user { userId, token };
+    session->authenticated = !deviceId.empty() && mUserManagerFactory && mUserManagerFactory->validateUser(user);
+    if (!session->authenticated) {
+        std::cout << "Token validation failed for user " << userId << " on device " << deviceId << std::endl;
+        return session;
+    }
+
+    // 缓存设备句柄，首次出现的设备在建立会话时注册，并归属于通过鉴权的用户
+    if (!claimDevice(deviceId, userId, session->handle)) {
+        session->authenticated = false;
+        std::cout << "Device " << deviceId << " is owned by another user, session rejected for " << userId
+                  << std::endl;
+        return session;
+    }
+    session->replay = mReplayGuard.acquire(deviceId);
+    return session;
+}
+
+/**
+ * @brief 基于会话处理心跳消息，仅检查会话有效性后派发
+ *        Handle a heartbeat on a session; only the session validity is checked before dispatch.
+ *
+ * 会话缓存了设备句柄时，直接在调用线程上按句柄写入原子时间戳；否则退回任务队列，且任务不携带用户 ID 与 Token。
+ * With a cached handle the atomic timestamp is stored by handle on the calling thread; otherwise it falls back
+ * to the task queue, without carrying the user ID and token.
+ *
+ * @param session   心跳流会话
+ * @param timestamp 心跳时间戳（毫秒）
+ * @return bool 会话有效且心跳已处理返回 true，否则返回 false
+ */
+auto MessageRouter::handleHeartbeat(const StreamSession& session, int64_t timestamp) -> bool {
+    if (!session.authenticated || session.expired()) {
+        return false;
+    }
+
+    // 使用会话缓存的防重放状态，避免按设备ID查表
+    bool fresh = session.replay ? mReplayGuard.accept(*session.replay, ReplayChannel::Heartbeat, timestamp)
+                                : mReplayGuard.accept(session.deviceId, ReplayChannel::Heartbeat, timestamp);
+    if (!fresh) {
+        return false;
+    }
+
+    if (isValid(session.handle)) {
+        mDeviceManagerFactory->refreshDeviceHeartbeat(session.handle);
+        return true;
+    }
+
+    dispatch(MessageTask { MessageTask::Type::Heartbeat, session.deviceId, "", "", "", {} });
+    return true;
+}
+
+/**
+ * @brief 为网关流鉴权，或在会话过期后重新鉴权
+ *        Authenticate a gateway stream, or re-authenticate it after expiry.
+ *
+ * 鉴权失败时会话保持未鉴权状态，其后的批次全部被拒绝；已绑定的设备索引不受影响。
+ * On failure the session stays unauthenticated and later batches are rejected; bound indexes are untouched.
+ *
+ * @param session 网关会话
+ * @param userId  用户唯一标识符
+ * @param token   用户认证令牌
+ * @return bool 鉴权通过返回 true
+ */
+auto MessageRouter::authenticateGateway(GatewaySession& session, const std::string& userId,
+                                        const std::string& token) -> bool {
+    User user { userId, token };
+    session.userId = userId;
+    session.authenticated = mUserManagerFactory && mUserManagerFactory->validateUser(user);
+    session.expiresAt = GatewaySession::Clock::now() + kSESSION_TTL;
+    if (!session.authenticated) {
+        std::cout << "Token validation failed for gateway user " << userId << std::endl;
+    }
+    return session.authenticated;
+}
+
+/**
+ * @brief 处理一个网关帧中的设备消息批次
+ *        Handle the batch of device messages carried by one gateway frame.
+ *
+ * 每个条目独立受理或拒绝：索引未绑定、时间戳重放或回执无效只拒绝该条目，不影响同批其他设备。
+ * Each entry is accepted or rejected on its own: an unbound index, a replayed timestamp or an invalid ack only
+ * rejects that entry, never the other devices in the batch.
+ *
+ * @param session 网关会话
+ * @param batch   设备消息批次，状态上报负载会被移走
+ * @return GatewayBatchResult 处理结果
+ */
+auto MessageRouter::handleGatewayBatch(GatewaySession& session, GatewayBatch& batch) -> GatewayBatchResult {
+    GatewayBatchResult result;
+    if (!session.authenticated || session.expired()) {
+        return result;
+    }
+    result.authenticated = true;
+
+    auto reject = [&result](uint32_t index) {
+        ++result.rejected;
+        result.rejectedDevices.push_back(index);
+    };
+
+    for (auto& binding : batch.bindings) {
+        if (!bindGatewayDevice(session, binding)) {
+            reject(binding.index);
+        }
+    }
+
+    for (const auto& heartbeat : batch.heartbeats) {
+        auto* device = session.device(heartbeat.device);
+        if (!device || !mReplayGuard.accept(*device->replay, ReplayChannel::Heartbeat, heartbeat.timestamp)) {
+            reject(heartbeat.device);
+            continue;
+        }
+        if (isValid(device->handle)) {
+            mDeviceManagerFactory->refreshDeviceHeartbeat(device->handle);
+        } else {
+            dispatch(MessageTask { MessageTask::Type::Heartbeat, device->deviceId, "", "", "", {} });
+        }
+        ++result.accepted;
+    }
+
+    for (auto& report : batch.statuses) {
+        auto* device = session.device(report.device);
+        if (!device
+            || !mReplayGuard.accept(*device->replay, ReplayChannel::Status, report.timestamp,
+                                    payloadDigest(report.status, report.details))) {
+            reject(report.device);
+            continue;
+        }
+        dispatch(MessageTask { MessageTask::Type::StatusReport, device->deviceId, std::move(report.status),
+                               session.userId, "", std::move(report.details), device->handle });
+        ++result.accepted;
+    }
+
+    for (const auto& ack : batch.acks) {
+        auto* device = session.device(ack.device);
+        if (!device || !mTracker.acknowledge(device->deviceId, ack.commandId, ack.code, ack.message)) {
+            reject(ack.device);
+            continue;
+        }
+        ++result.accepted;
+    }
+    return result;
+}
+
+/**
+ * @brief 网关流结束时对其绑定的设备逐一执行断开处理
+ *        Handle the disconnect of every device bound to an ended gateway stream.
+ *
+ * @param session 网关会话
+ */
+void MessageRouter::closeGatewaySession(const GatewaySession& session) {
+    if (!session.authenticated) {
+        return;
+    }
+    for (const auto& device : session.devices) {
+        if (!device.deviceId.empty()) {
+            handleDisconnect(device.deviceId);
+        }
+    }
+}
+
+/**
+ * @brief 将设备绑定到网关会话的流内索引，解析并缓存设备句柄与防重放状态
+ *        Bind a device to a gateway stream index, resolving and caching its handle and replay state.
+ *
+ * 首次出现的设备在绑定时注册并归属于会话的用户；同一索引可以重新绑定到其他设备。
+ * 设备已归属其他用户时拒绝绑定，该索引原有的绑定随之解除，后续引用该索引的条目都被拒绝。
+ * Devices seen for the first time are registered on binding and owned by the session's user; an index may be
+ * rebound to another device. A device already owned by another user is refused, and the index loses its previous
+ * binding, so later entries referring to it are rejected.
+ *
+ * @param session 网关会话
+ * @param binding 索引绑定，设备ID会被移走
+ * @return bool 索引越界、设备ID为空或设备归属其他用户时返回 false
+ */
+auto MessageRouter::bindGatewayDevice(GatewaySession& session, GatewayBatch::Binding& binding) -> bool {
+    if (binding.index >= GatewaySession::kMAX_DEVICES || binding.deviceId.empty()) {
+        return false;
+    }
+    if (binding.index >= session.devices.size()) {
+        session.devices.resize(binding.index + 1);
+    }
+
+    auto& device = session.devices[binding.index];
+    if (!claimDevice(binding.deviceId, session.userId, device.handle)) {
+        std::cout << "Device " << binding.deviceId << " is owned by another user, gateway binding rejected for "
+                  << session.userId << std::endl;
+        device = {};
+        return false;
+    }
+    device.deviceId = std::move(binding.deviceId);
+    device.replay = mReplayGuard.acquire(device.deviceId);
+    return true;
+}
+
+/**
+ * @brief 代表用户注册或认领设备
+ *        Register or claim a device on behalf of a user.
+ *
+ * 新设备归属该用户，尚未绑定所有者的设备由其认领；设备已归属其他用户时拒绝，且不返回句柄。
+ * A new device is bound to the user and one without an owner is claimed by it; a device already owned by another
+ * user is refused and no handle is returned.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param userId 通过鉴权的用户
+ * @param outHandle 输出的设备句柄
+ * @return bool 设备已注册且归属该用户或尚未绑定所有者时返回 true
+ */
+auto MessageRouter::claimDevice(const std::string& deviceId, const std::string& userId, DeviceHandle& outHandle)
+    -> bool {
+    outHandle = kINVALID_DEVICE_HANDLE;
+    if (!mDeviceManagerFactory) {
+        return true;
+    }
+    mDeviceManagerFactory->registerDevice(deviceId, userId, outHandle);
+    if (!mDeviceManagerFactory->isDeviceVisibleTo(deviceId, userId)) {
+        outHandle = kINVALID_DEVICE_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 校验用户 Token，再代表用户注册或认领设备
+ *        Validate the user token, then register or claim the device on behalf of the user.
+ *
+ * 供设备自身发出的单条上报与心跳使用，与心跳流建立会话的鉴权一致。
+ * Used by the unary reports and heartbeats a device sends itself, matching how a heartbeat stream session
+ * authenticates.
+ *
+ * @param deviceId  设备唯一标识符
+ * @param userId    用户唯一标识符
+ * @param token     用户认证令牌
+ * @param outHandle 输出的设备句柄
+ * @return bool 通过鉴权且设备归属该用户或尚未绑定所有者时返回 true
+ */
+auto MessageRouter::admitDevice(const std::string& deviceId, const std::string& userId, const std::string& token,
+                                DeviceHandle& outHandle) -> bool {
+    User user { userId, token };
+    if (deviceId.empty() || !mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device " << deviceId << std::endl;
+        return false;
+    }
+    if (!claimDevice(deviceId, userId, outHandle)) {
+        std::cout << "Device " << deviceId << " is owned by another user, rejected for " << userId << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 校验用户 Token，并确认设备已注册且对该用户可见
+ *        Validate the user token and make sure the device is registered and visible to the user.
+ *
+ * 设备不存在与设备属于其他用户一样按鉴权失败处理，调用方无法借此探测其他用户的设备。
+ * A missing device is refused just like one owned by another user, so callers cannot probe other users' devices.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param userId   用户唯一标识符
+ * @param token    用户认证令牌
+ * @return bool 通过鉴权且设备可见返回 true
+ */
+auto MessageRouter::authorizeDevice(const std::string& deviceId, const std::string& userId,
+                                    const std::string& token) -> bool {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device " << deviceId << std::endl;
+        return false;
+    }
+    if (!mDeviceManagerFactory || !mDeviceManagerFactory->isDeviceVisibleTo(deviceId, userId)) {
+        std::cout << "Device " << deviceId << " is not registered to user " << userId << std::endl;
+        return false;
+    }
     return true;
 }
 
@@ -79,7 +779,212 @@ auto MessageRouter::handleHeartbeat(const std::string& deviceId, const std::stri
  * @param deviceId 设备唯一标识符
  */
 void MessageRouter::handleDisconnect(const std::string& deviceId) {
-    dispatch(MessageTask { MessageTask::Type::Disconnect, deviceId, "", "", "" });
+    dispatch(MessageTask { MessageTask::Type::Disconnect, deviceId, "", "", "", {} });
+}
+
+/**
+ * @brief 把可能等待存储落盘的工作投递到键对应的处理线程上执行
+ *        Run work that may wait for storage durability on the handler thread picked by the key.
+ *
+ * 与同一设备的消息任务共用处理线程，因此同一设备的上报仍按到达顺序生效。
+ * Shares the handler thread with the device's message tasks, so a device's reports still apply in arrival order.
+ *
+ * @param key  选取处理线程的键
+ * @param work 要执行的工作
+ */
+void MessageRouter::post(const std::string& key, std::function<void()> work) {
+    auto handler = handlerFor(key);
+    if (!handler) {
+        work();
+        return;
+    }
+    handler->post(std::make_shared<IOT_TASK_NS::GenericTask<std::function<void()>>>(
+        std::move(work), [](const std::function<void()>& w) { w(); }));
+}
+
+/**
+ * @brief 订阅设备状态
+ *        Watch device state.
+ *
+ * Token 只在订阅时校验一次，之后推送不再鉴权；订阅以调用者为查看者，快照与增量事件都不包含其他用户的设备。
+ * The token is validated once at subscription and pushes afterwards are not re-authenticated. The caller is the
+ * viewer of the watch, so neither the snapshot nor later events include devices owned by another user.
+ *
+ * @param userId 用户唯一标识符
+ * @param token  用户认证令牌
+ * @param filter 过滤条件
+ * @param policy 落后过多时的处理策略
+ * @return std::shared_ptr<DeviceWatcher> 订阅者，鉴权失败返回空
+ */
+auto MessageRouter::watchDevices(const std::string& userId, const std::string& token, DeviceWatchFilter filter,
+                                 WatchOverflowPolicy policy) -> std::shared_ptr<DeviceWatcher> {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device watch" << std::endl;
+        return nullptr;
+    }
+    filter.viewer = userId;
+    return mWatchHub.subscribe(std::move(filter), policy);
+}
+
+/**
+ * @brief 按ID批量查询设备
+ *        Look up devices by ID.
+ *
+ * @param userId 用户ID
+ * @param token 认证token
+ * 已归属其他用户的设备与未注册的设备一样列入 missing，不暴露其是否存在。
+ * Devices owned by another user are reported missing like unregistered ones, so their existence is not revealed.
+ *
+ * @param deviceIds 待查询的设备ID
+ * @param found 找到的设备
+ * @param missing 未注册或归属其他用户的设备ID
+ * @return bool 鉴权是否成功
+ */
+auto MessageRouter::getDevices(const std::string& userId, const std::string& token,
+                               const std::vector<std::string>& deviceIds, std::vector<DeviceRecord>& found,
+                               std::vector<std::string>& missing) -> bool {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device query" << std::endl;
+        return false;
+    }
+    found.clear();
+    missing.clear();
+    found.reserve(deviceIds.size());
+    for (const auto& deviceId : deviceIds) {
+        DeviceRecord record { deviceId, {} };
+        if (mDeviceManagerFactory && mDeviceManagerFactory->getDeviceInfo(deviceId, record.info)
+            && (record.info.owner.empty() || record.info.owner == userId)) {
+            found.push_back(std::move(record));
+        } else {
+            missing.push_back(deviceId);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 分页列出匹配查询条件的设备
+ *        List devices matching a query, one page at a time.
+ *
+ * 查询以调用者为查看者，已归属其他用户的设备不会被列出或计数。
+ * The caller is the viewer of the query, so devices owned by another user are never listed or counted.
+ *
+ * @param userId 用户ID
+ * @param token 认证token
+ * @param query 过滤条件、游标与每页数量
+ * @param outPage 输出的一页结果
+ * @return DeviceQueryStatus 查询结果状态
+ */
+auto MessageRouter::listDevices(const std::string& userId, const std::string& token, const DeviceQuery& query,
+                                DevicePage& outPage) -> DeviceQueryStatus {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device listing" << std::endl;
+        return DeviceQueryStatus::Unauthenticated;
+    }
+    DeviceQuery scoped = query;
+    scoped.viewer = userId;
+    if (!mDeviceManagerFactory || !mDeviceManagerFactory->listDevices(scoped, outPage)) {
+        return DeviceQueryStatus::InvalidCursor;
+    }
+    return DeviceQueryStatus::Ok;
+}
+
+/**
+ * @brief 读取设备某个数值属性的历史记录
+ *        Read the recorded history of a numeric attribute of a device.
+ *
+ * 已归属其他用户的设备与未注册的设备一样返回 NotFound。
+ * A device owned by another user reports NotFound like an unregistered one.
+ *
+ * @param userId 用户ID
+ * @param token 认证token
+ * @param query 设备、属性、时间范围与降采样步长
+ * @param outPoints 按时间排序的输出点
+ * @return DeviceQueryStatus 查询结果状态
+ */
+auto MessageRouter::getDeviceHistory(const std::string& userId, const std::string& token, const HistoryQuery& query,
+                                     std::vector<HistoryPoint>& outPoints) -> DeviceQueryStatus {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device history" << std::endl;
+        return DeviceQueryStatus::Unauthenticated;
+    }
+    if (!mDeviceManagerFactory || !mDeviceManagerFactory->isDeviceVisibleTo(query.deviceId, userId)
+        || !mDeviceManagerFactory->getDeviceHistory(query, outPoints)) {
+        return DeviceQueryStatus::NotFound;
+    }
+    return DeviceQueryStatus::Ok;
+}
+
+/**
+ * @brief 查询状态上报的窗口聚合结果
+ *        Query the windowed aggregates of status reports.
+ *
+ * @param userId 用户ID
+ * @param token 认证token
+ * @param query 聚合名称、分位点与窗口选择
+ * @param out 输出的窗口结果
+ * @return DeviceQueryStatus 查询结果状态
+ */
+auto MessageRouter::getAggregates(const std::string& userId, const std::string& token, const AggregateQuery& query,
+                                  AggregateWindow& out) -> DeviceQueryStatus {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on aggregates" << std::endl;
+        return DeviceQueryStatus::Unauthenticated;
+    }
+    if (!mAggregator.query(query, out, unixMillis())) {
+        return DeviceQueryStatus::NotFound;
+    }
+    return DeviceQueryStatus::Ok;
+}
+
+/**
+ * @brief 按状态统计已注册设备数量
+ *        Count registered devices per status.
+ *
+ * @param userId 用户ID
+ * @param token 认证token
+ * @param outCounts 输出的数量
+ * @return DeviceQueryStatus 查询结果状态
+ */
+auto MessageRouter::countDevices(const std::string& userId, const std::string& token, DeviceCounts& outCounts)
+    -> DeviceQueryStatus {
+    User user { userId, token };
+    if (!mUserManagerFactory || !mUserManagerFactory->validateUser(user)) {
+        std::cout << "Token validation failed for user " << userId << " on device counts" << std::endl;
+        return DeviceQueryStatus::Unauthenticated;
+    }
+    if (!mDeviceManagerFactory || !mDeviceManagerFactory->countDevices(outCounts)) {
+        return DeviceQueryStatus::NotFound;
+    }
+    return DeviceQueryStatus::Ok;
+}
+
+/**
+ * @brief 开启或关闭状态上报与心跳的合并模式
+ *        Enable or disable coalescing of status reports and heartbeats.
+ *
+ * 关闭后已在槽位中的消息仍会被已排队的任务处理。
+ * Messages already sitting in a slot are still processed by their queued task after disabling.
+ *
+ * @param enabled 是否开启
+ */
+void MessageRouter::setCoalescing(bool enabled) {
+    mCoalescing.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 被合并的消息数量
+ *        Number of coalesced messages.
+ *
+ * @return uint64_t 消息数量
+ */
+auto MessageRouter::coalescedCount() const -> uint64_t {
+    return mCoalesced.load(std::memory_order_relaxed);
 }
 
 /**
@@ -87,52 +992,285 @@ void MessageRouter::handleDisconnect(const std::string& deviceId) {
  *        Dispatch message task to background thread for processing.
  *
  * 先获取线程处理器，若不可用则打印错误日志。
- * 根据任务类型调用不同的设备管理操作，
- * 并进行用户身份验证，验证失败则打印警告并中止处理。
+ * 合并模式下状态上报与心跳走设备待处理槽位，其余任务直接入队。
  *
  * @param task 待处理的消息任务
  */
 void MessageRouter::dispatch(const MessageTask& task) {
-    auto handler = mThead.getHandler();
+    bool coalescable = task.type == MessageTask::Type::StatusReport || task.type == MessageTask::Type::Heartbeat;
+    if (coalescable && mCoalescing.load(std::memory_order_relaxed)) {
+        dispatchCoalesced(task);
+        return;
+    }
+
+    auto handler = handlerFor(task.deviceId);
     if (!handler) {
         std::cerr << "No handler thread available." << std::endl;
         return;
     }
 
     // 创建异步任务，在线程中执行具体业务逻辑
-    handler->post(std::make_shared<IOT_TASK_NS::GenericTask<MessageTask>>(task, [this](const MessageTask& t) {
-        //        User user { t.userId, t.token };
-        //        if (!mUserManagerFactory->validateUser(user)) { // 验证用户Token
-        //            std::cout << "Token validation failed for user " << t.userId << std::endl;
-        //            return;
-        //        }
-
-        // 根据任务类型执行不同操作
-        switch (t.type) {
-        case MessageTask::Type::Command:
-            // 若设备不在线则注册设备
-            std::cout << "Processing command for device " << t.deviceId << ": " << t.commandOrStatus << std::endl;
-            if (!mDeviceManagerFactory->isDeviceOnline(t.deviceId)) {
-                mDeviceManagerFactory->registerDevice(t.deviceId);
+    handler->post(std::make_shared<IOT_TASK_NS::GenericTask<MessageTask>>(
+        task, [this](const MessageTask& t) { process(t); }));
+}
+
+/**
+ * @brief 以合并方式派发任务：写入设备的待处理槽位，仅在槽位由空变为非空时入队一次
+ *        Coalesced dispatch: store the task in the device's pending slot and queue a step only when the
+ *        slot goes from empty to occupied.
+ *
+ * 处理线程执行时取走槽位中最新的任务，期间到达的新消息原地替换旧消息，不产生新的队列任务；
+ * 状态上报的属性是增量的，因此新旧上报的属性按键合并而不是整体替换。
+ * When the step runs it takes the newest task in the slot; messages arriving meanwhile replace the older
+ * one in place and add no queue entries. Status attributes are partial updates, so the attributes of the
+ * two reports are merged by key rather than replaced.
+ *
+ * @param task 状态上报或心跳任务
+ */
+void MessageRouter::dispatchCoalesced(MessageTask task) {
+    auto handler = handlerFor(task.deviceId);
+    if (!handler) {
+        std::cerr << "No handler thread available." << std::endl;
+        return;
+    }
+
+    auto slot = mPendingSlots.getOrInsert(pendingKey(task.deviceId, task.type),
+                                          []() { return std::make_shared<PendingSlot>(); });
+
+    bool first = task.type == MessageTask::Type::StatusReport ? slot->offer(std::move(task), mergeStatusReport)
+                                                               : slot->offer(std::move(task));
+    if (!first) {
+        mCoalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    handler->post(std::make_shared<IOT_TASK_NS::GenericTask<std::shared_ptr<PendingSlot>>>(
+        slot, [this](const std::shared_ptr<PendingSlot>& pending) {
+            auto latest = pending->take();
+            if (latest) {
+                process(*latest);
             }
-            std::cout << "Command '" << t.commandOrStatus << "' sent to device " << t.deviceId << std::endl;
-            break;
+        }));
+}
 
-        case MessageTask::Type::StatusReport:
-            //            mDeviceManagerFactory->reportStatus(t.deviceId, t.commandOrStatus);
-            break;
+/**
+ * @brief 在处理线程上执行消息任务
+ *        Run a message task on the handler thread.
+ *
+ * 根据任务类型调用不同的设备管理操作。
+ *
+ * @param t 待处理的消息任务
+ */
+void MessageRouter::process(const MessageTask& t) {
+    // 根据任务类型执行不同操作
+    switch (t.type) {
+    case MessageTask::Type::Command:
+        // 命令由回执跟踪器直接写入下行队列，不经过处理线程
+        break;
+
+    case MessageTask::Type::StatusReport:
+        // 网关会话的上报携带句柄，无需按设备ID查表
+        if (!isValid(t.handle) || !mDeviceManagerFactory->reportStatus(t.handle, t.commandOrStatus, t.details)) {
+            mDeviceManagerFactory->reportStatus(t.deviceId, t.commandOrStatus, t.details);
+        }
+        if (mAggregator.enabled()) {
+            mAggregator.record(t.deviceId, t.details, unixMillis());
+        }
+        if (mRules.enabled()) {
+            applyRules(t.deviceId, t.commandOrStatus, t.details);
+        }
+        break;
+
+    case MessageTask::Type::Heartbeat:
+        mDeviceManagerFactory->refreshDeviceHeartbeat(t.deviceId);
+        break;
 
-        case MessageTask::Type::Heartbeat:
-            std::cout << "Heartbeat received from device " << t.deviceId << std::endl;
-            //            mDeviceManagerFactory->refreshDeviceHeartbeat(t.deviceId);
-            break;
+    case MessageTask::Type::Disconnect:
+        std::cout << "Device " << t.deviceId << " disconnected." << std::endl;
+        settlePending(t.deviceId);
+        mDeviceManagerFactory->markDeviceOffline(t.deviceId);
+        break;
+    }
+}
 
-        case MessageTask::Type::Disconnect:
-            std::cout << "Device " << t.deviceId << " disconnected." << std::endl;
-            //            mDeviceManagerFactory->markDeviceOffline(t.deviceId);
-            break;
+/**
+ * @brief 设备断开时结清其合并槽位：待处理的状态上报先于离线处理，待处理的心跳丢弃，槽位随后移除
+ *        Settle a disconnecting device's coalescing slots: a pending status report is processed ahead of the
+ *        offline transition, a pending heartbeat is dropped, and the slots are removed.
+ *
+ * 槽位中的消息若在断开之后才由各自排队的处理步骤取出，心跳会让刚离线的设备重新上线。
+ * 排队中的处理步骤仍持有槽位，取出时为空而什么也不做；此后到达的消息建立新槽位，排在断开之后。
+ * Left to their own queued steps, those messages would run after the disconnect and a heartbeat would bring
+ * the device straight back online. The queued steps still hold their slots and find them empty; messages
+ * arriving later open new slots, queued after the disconnect.
+ *
+ * @param deviceId 断开的设备ID
+ */
+void MessageRouter::settlePending(const std::string& deviceId) {
+    auto statusKey = pendingKey(deviceId, MessageTask::Type::StatusReport);
+    if (auto status = mPendingSlots.get(statusKey)) {
+        mPendingSlots.erase(statusKey);
+        if (auto latest = (*status)->take()) {
+            process(*latest);
         }
+    }
+    auto heartbeatKey = pendingKey(deviceId, MessageTask::Type::Heartbeat);
+    if (auto heartbeat = mPendingSlots.get(heartbeatKey)) {
+        mPendingSlots.erase(heartbeatKey);
+        (*heartbeat)->take();
+    }
+}
+
+/**
+ * @brief 设备状态变化事件派发函数，将事件交给后台线程处理
+ *        Dispatch a device transition event to the background thread.
+ *
+ * 设备管理器只在状态变化时回调，因此心跳快速路径本身不会产生队列任务。
+ * The device manager only calls back on transitions, so the heartbeat fast path itself never enqueues tasks.
+ *
+ * @param event 设备状态变化事件
+ */
+void MessageRouter::dispatchEvent(const DeviceEvent& event) {
+    auto handler = handlerFor(event.deviceId);
+    if (!handler) {
+        std::cerr << "No handler thread available." << std::endl;
+        return;
+    }
+
+    handler->post(std::make_shared<IOT_TASK_NS::GenericTask<DeviceEvent>>(event, [](const DeviceEvent& e) {
+        std::cout << "Device " << e.deviceId << " is now "
+                  << (e.type == DeviceEvent::Type::Online ? "online" : "offline") << std::endl;
     }));
 }
 
+/**
+ * @brief 用一条已受理的状态上报运行规则，并执行命中规则的动作
+ *        Run the rules on an accepted status report and carry out the actions of the matching ones.
+ *
+ * 在受理上报的线程上同步执行：事件写入设备订阅的扇出缓冲，命令交给回执跟踪器入队并跟踪回执，
+ * 与用户提交的命令一样受队列容量与重试策略约束。
+ * Runs synchronously on the thread that accepted the report: events go into the device watch fan-out buffer
+ * and commands go to the ack tracker, queued and tracked like user-submitted ones, under the same queue
+ * capacity and retry policy.
+ *
+ * @param deviceId 设备ID
+ * @param status 上报的状态内容
+ * @param details 上报的属性
+ */
+void MessageRouter::applyRules(const std::string& deviceId, const std::string& status,
+                               const StatusDetails& details) {
+    std::vector<const StatusRule*> matched;
+    if (mRules.evaluate(deviceId, status, details, matched) != 0) {
+        runRuleActions(deviceId, status, matched);
+    }
+}
+
+/**
+ * @brief 用设备的上线或离线运行规则，并执行命中规则的动作
+ *        Run the rules on a device going online or offline and carry out the actions of the matching ones.
+ *
+ * 在发生状态变化的线程上同步执行，先于随后的上报；离线时规则引擎丢弃该设备保存的值。
+ * Runs synchronously on the thread that made the transition, ahead of any later report; going offline makes the
+ * rule engine drop the values it keeps for the device.
+ *
+ * @param event 设备上线或离线事件
+ */
+void MessageRouter::applyTransitionRules(const DeviceEvent& event) {
+    std::vector<const StatusRule*> matched;
+    if (mRules.transition(event.deviceId, event.type == DeviceEvent::Type::Online, matched) != 0) {
+        runRuleActions(event.deviceId, {}, matched);
+    }
+}
+
+/**
+ * @brief 执行命中规则的动作
+ *        Carry out the actions of the matching rules.
+ *
+ * @param deviceId 设备ID
+ * @param status 随规则事件发布的状态内容，设备上线或离线时为空
+ * @param matched 命中的规则
+ */
+void MessageRouter::runRuleActions(const std::string& deviceId, const std::string& status,
+                                   const std::vector<const StatusRule*>& matched) {
+    std::optional<std::string> owner; // 首次发布规则事件时才查询
+    for (const auto* rule : matched) {
+        for (const auto& action : rule->actions) {
+            if (action.type == RuleAction::Type::Event) {
+                if (!owner) {
+                    DeviceInfo info;
+                    bool known = mDeviceManagerFactory && mDeviceManagerFactory->getDeviceInfo(deviceId, info);
+                    owner = known ? std::move(info.owner) : std::string();
+                }
+                mWatchHub.publishRuleEvent(deviceId, *owner, action.name, status);
+                continue;
+            }
+            auto receipt = mTracker.submit(deviceId, OutboundCommand { action.name, action.params, unixMillis() });
+            if (!receipt.accepted) {
+                std::cerr << "Rule " << rule->name << ": command " << action.name << " for device " << deviceId
+                          << " rejected: " << receipt.message << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 生成匹配设备的状态快照
+ *        Build the state snapshot of matching devices.
+ *
+ * 指定了设备ID时逐个查找，否则遍历整个注册表；在订阅者所在线程上执行，不经过处理线程。
+ * Listed device IDs are looked up one by one, otherwise the whole registry is scanned; runs on the watcher's
+ * thread, never on a handler thread.
+ *
+ * @param filter 过滤条件
+ * @param sequence 快照对应的缓冲序号
+ * @param out 输出的快照事件
+ */
+void MessageRouter::snapshotDevices(const DeviceWatchFilter& filter, uint64_t sequence,
+                                    std::vector<DeviceWatchEvent>& out) {
+    if (!mDeviceManagerFactory) {
+        return;
+    }
+    auto append = [&out, &filter, sequence](const std::string& deviceId, DeviceInfo&& info) {
+        if (filter.matches(deviceId, info.owner)) {
+            out.push_back(DeviceWatchEvent { DeviceWatchEvent::Type::Snapshot, deviceId, info.status,
+                                             std::move(info.lastStatusReport), sequence, {},
+                                             std::move(info.owner) });
+        }
+    };
+
+    if (!filter.deviceIds.empty()) {
+        for (const auto& deviceId : filter.deviceIds) {
+            DeviceInfo info;
+            if (filter.matches(deviceId) && mDeviceManagerFactory->getDeviceInfo(deviceId, info)) {
+                append(deviceId, std::move(info));
+            }
+        }
+        return;
+    }
+    mDeviceManagerFactory->forEachDevice([&filter, &append](const DeviceSlot& slot) {
+        if (filter.matches(slot.deviceId)) {
+            append(slot.deviceId, slot.snapshot());
+        }
+    });
+}
+
+/**
+ * @brief 按设备ID散列选取处理线程
+ *        Pick a handler thread by hashing the device ID.
+ *
+ * 同一设备的命令、上报、心跳与状态事件始终落在同一线程上，保持单设备内的处理顺序；
+ * 不同设备分散到多个线程并行处理。
+ * Commands, reports, heartbeats and events of one device always land on the same thread, keeping per-device
+ * order, while different devices spread across threads.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 任务处理器，线程未启动时为空
+ */
+auto MessageRouter::handlerFor(const std::string& deviceId) const -> std::shared_ptr<IOT_TASK_NS::IHandler> {
+    if (mWorkers.size() == 1) {
+        return mWorkers.front()->getHandler();
+    }
+    return mWorkers[std::hash<std::string> {}(deviceId) % mWorkers.size()]->getHandler();
+}
+
 IOT_NS_END
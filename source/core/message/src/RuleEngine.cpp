@@ -0,0 +1,701 @@
+#include "RuleEngine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+IOT_NS_BEGIN
+
+namespace {
+
+/**
+ * @brief 去除首尾空白
+ */
+auto trim(std::string_view text) -> std::string_view {
+    auto begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+/**
+ * @brief 按空白切分
+ */
+auto words(std::string_view text) -> std::vector<std::string_view> {
+    std::vector<std::string_view> out;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        auto begin = text.find_first_not_of(" \t", pos);
+        if (begin == std::string_view::npos) {
+            break;
+        }
+        auto end = std::min(text.find_first_of(" \t", begin), text.size());
+        out.push_back(text.substr(begin, end - begin));
+        pos = end;
+    }
+    return out;
+}
+
+/**
+ * @brief 属性名中允许的字符，首字符不能是数字或 '-'
+ */
+auto isNameChar(char c, bool first) -> bool {
+    auto u = static_cast<unsigned char>(c);
+    return std::isalpha(u) || c == '_' || c == '$' || (!first && (std::isdigit(u) || c == '.' || c == '-'));
+}
+
+/**
+ * @brief 解析动作列表
+ *
+ * @param text 动作源码，以 ';' 分隔
+ * @param rule 规则名，缺省的事件名
+ * @param out 输出的动作
+ * @param error 失败原因
+ * @return true 解析成功
+ */
+auto parseActions(std::string_view text, const std::string& rule, std::vector<RuleAction>& out,
+                  std::string& error) -> bool {
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        auto end = std::min(text.find(';', begin), text.size());
+        auto parts = words(text.substr(begin, end - begin));
+        begin = end + 1;
+        if (parts.empty()) {
+            continue;
+        }
+        RuleAction action;
+        if (parts[0] == "event" && parts.size() <= 2) {
+            action.name = parts.size() == 2 ? std::string(parts[1]) : rule;
+        } else if (parts[0] == "command" && parts.size() >= 2) {
+            action.type = RuleAction::Type::Command;
+            action.name = parts[1];
+            for (size_t i = 2; i < parts.size(); ++i) {
+                auto eq = parts[i].find('=');
+                if (eq == 0 || eq == std::string_view::npos) {
+                    error = "expected key=value command parameter, got " + std::string(parts[i]);
+                    return false;
+                }
+                action.params[std::string(parts[i].substr(0, eq))] = parts[i].substr(eq + 1);
+            }
+        } else {
+            error = "expected `event [name]` or `command cmd [key=value ...]`";
+            return false;
+        }
+        out.push_back(std::move(action));
+    }
+    if (out.empty()) {
+        error = "no action";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 有序比较：数值与数值、字符串与字符串，其余组合不成立
+ */
+template <typename Compare>
+auto ordered(const AttributeValue& value, const AttributeValue& literal, Compare compare) -> bool {
+    if (value.index() != literal.index() || std::holds_alternative<bool>(value)) {
+        return false;
+    }
+    if (const auto* number = std::get_if<double>(&value)) {
+        return compare(*number, std::get<double>(literal));
+    }
+    return compare(std::get<std::string>(value), std::get<std::string>(literal));
+}
+
+} // namespace
+
+/**
+ * @brief 条件的递归下降解析器，边解析边生成字节码
+ *        Recursive-descent parser of conditions, emitting bytecode as it goes.
+ *
+ * 每个子表达式同时生成规范形式：比较以去重后的编号表示，用于识别相同的条件。
+ * Every subexpression also yields a canonical form, comparisons written as their deduplicated index, used to
+ * recognise identical conditions.
+ *
+ *     or     := and ('||' and)*
+ *     and    := unary ('&&' unary)*
+ *     unary  := '!' unary | '(' or ')' | 'changed(' name ')' | operand [op literal]
+ *     operand:= name | 'prev(' name ')'
+ */
+struct RuleEngine::Parser {
+    RuleEngine& engine;            // 所属引擎，比较与槽位登记在其中 / Engine the comparisons and slots go into
+    std::string_view text;         // 条件源码 / Condition source
+    size_t pos = 0;                // 解析位置 / Parse position
+    std::vector<Instruction> code; // 生成的字节码 / Emitted bytecode
+    std::vector<uint16_t> slots;   // 引用的槽位 / Referenced slots
+    std::string error;             // 第一个错误 / First error
+
+    auto atEnd() -> bool {
+        skipSpace();
+        return pos >= text.size();
+    }
+
+    auto parseOr(std::string& key) -> bool {
+        if (!parseAnd(key)) {
+            return false;
+        }
+        while (eat("||")) {
+            code.push_back({ Instruction::Op::OrJump, 0 });
+            auto jump = code.size() - 1;
+            std::string right;
+            if (!parseAnd(right)) {
+                return false;
+            }
+            code[jump].arg = static_cast<uint32_t>(code.size());
+            key = "(" + key + "|" + right + ")";
+        }
+        return true;
+    }
+
+private:
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+    }
+
+    auto eat(std::string_view token) -> bool {
+        skipSpace();
+        if (text.substr(pos, token.size()) != token) {
+            return false;
+        }
+        pos += token.size();
+        return true;
+    }
+
+    auto fail(const std::string& message) -> bool {
+        if (error.empty()) {
+            error = message + " at offset " + std::to_string(pos);
+        }
+        return false;
+    }
+
+    auto name() -> std::string_view {
+        skipSpace();
+        auto begin = pos;
+        while (pos < text.size() && isNameChar(text[pos], pos == begin)) {
+            ++pos;
+        }
+        return text.substr(begin, pos - begin);
+    }
+
+    auto parseAnd(std::string& key) -> bool {
+        if (!parseUnary(key)) {
+            return false;
+        }
+        while (eat("&&")) {
+            code.push_back({ Instruction::Op::AndJump, 0 });
+            auto jump = code.size() - 1;
+            std::string right;
+            if (!parseUnary(right)) {
+                return false;
+            }
+            code[jump].arg = static_cast<uint32_t>(code.size());
+            key = "(" + key + "&" + right + ")";
+        }
+        return true;
+    }
+
+    auto parseUnary(std::string& key) -> bool {
+        if (eat("!")) {
+            if (!parseUnary(key)) {
+                return false;
+            }
+            code.push_back({ Instruction::Op::Not, 0 });
+            key = "!" + key;
+            return true;
+        }
+        if (eat("(")) {
+            return parseOr(key) && (eat(")") || fail("expected )"));
+        }
+        return parseComparison(key);
+    }
+
+    auto parseComparison(std::string& key) -> bool {
+        Comparison comparison;
+        auto word = name();
+        if ((word == "changed" || word == "prev") && eat("(")) {
+            auto attribute = name();
+            if (attribute.empty() || !eat(")")) {
+                return fail("expected attribute)");
+            }
+            comparison.op = word == "changed" ? Compare::Changed : Compare::Eq;
+            comparison.previous = word == "prev";
+            word = attribute;
+        } else if (word.empty()) {
+            return fail("expected attribute");
+        }
+        if (!slot(word, comparison.slot)) {
+            return false;
+        }
+        if (comparison.op != Compare::Changed) {
+            if (!parseOperator(comparison.op)) {
+                comparison.op = Compare::Truthy;
+            } else if (!parseLiteral(comparison.literal)) {
+                return false;
+            }
+        }
+        auto id = intern(comparison);
+        code.push_back({ Instruction::Op::Test, id });
+        key = "#" + std::to_string(id);
+        return true;
+    }
+
+    auto parseOperator(Compare& op) -> bool {
+        static const std::pair<std::string_view, Compare> kOPERATORS[] = {
+            { "==", Compare::Eq }, { "!=", Compare::Ne }, { "<=", Compare::Le },
+            { ">=", Compare::Ge }, { "<", Compare::Lt },  { ">", Compare::Gt },
+        };
+        for (const auto& [token, value] : kOPERATORS) {
+            if (eat(token)) {
+                op = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto parseLiteral(AttributeValue& out) -> bool {
+        skipSpace();
+        if (pos < text.size() && text[pos] == '"') {
+            auto end = text.find('"', pos + 1);
+            if (end == std::string_view::npos) {
+                return fail("unterminated string");
+            }
+            out = std::string(text.substr(pos + 1, end - pos - 1));
+            pos = end + 1;
+            return true;
+        }
+        auto begin = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '.' ||
+                                     text[pos] == '-' || text[pos] == '+')) {
+            ++pos;
+        }
+        auto token = text.substr(begin, pos - begin);
+        if (token == "true" || token == "false") {
+            out = token == "true";
+            return true;
+        }
+        double number = 0;
+        auto [last, ec] = std::from_chars(token.data(), token.data() + token.size(), number);
+        if (token.empty() || ec != std::errc {} || last != token.data() + token.size()) {
+            pos = begin;
+            return fail("expected number, \"string\", true or false");
+        }
+        out = number;
+        return true;
+    }
+
+    auto slot(std::string_view attribute, uint16_t& out) -> bool {
+        auto it = engine.mSlots.find(std::string(attribute));
+        if (it == engine.mSlots.end()) {
+            if (engine.mSlots.size() > std::numeric_limits<uint16_t>::max()) {
+                return fail("too many attributes");
+            }
+            auto next = static_cast<uint16_t>(engine.mSlots.size());
+            it = engine.mSlots.emplace(std::string(attribute), next).first;
+            engine.mSlotConditions.emplace_back();
+            if (attribute == kSTATUS) {
+                engine.mStatusSlot = next;
+            } else if (attribute == kONLINE) {
+                engine.mOnlineSlot = next;
+            }
+        }
+        out = it->second;
+        if (std::find(slots.begin(), slots.end(), out) == slots.end()) {
+            slots.push_back(out);
+        }
+        return true;
+    }
+
+    auto intern(Comparison& comparison) -> uint32_t {
+        auto key = std::to_string(comparison.slot) + (comparison.previous ? "p" : "c") +
+                   std::to_string(static_cast<int>(comparison.op)) + std::to_string(comparison.literal.index()) +
+                   formatAttributeValue(comparison.literal);
+        auto [it, inserted] =
+            engine.mComparisonKeys.try_emplace(std::move(key), static_cast<uint32_t>(engine.mComparisons.size()));
+        if (inserted) {
+            engine.mComparisons.push_back(std::move(comparison));
+        }
+        return it->second;
+    }
+};
+
+/**
+ * @brief 构造函数，逐条编译规则
+ *        Constructor: compiles the rules one by one.
+ *
+ * @param sources 规则源码
+ */
+RuleEngine::RuleEngine(const std::vector<std::string>& sources) {
+    for (const auto& source : sources) {
+        std::string error;
+        if (!add(source, error)) {
+            std::cerr << "RuleEngine: ignoring rule `" << source << "`: " << error << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief 编译一条规则
+ *        Compile one rule.
+ *
+ * 先解析动作再解析条件；条件解析失败时撤销这条规则登记的比较与槽位，引擎保持不变。
+ * Actions are parsed before the condition; if the condition fails, the comparisons and slots this rule
+ * registered are rolled back and the engine is left unchanged.
+ *
+ * @param source 规则源码
+ * @param error 编译失败时的原因
+ * @return true 编译成功
+ */
+auto RuleEngine::add(std::string_view source, std::string& error) -> bool {
+    auto colon = source.find(':');
+    auto arrow = source.find("=>", colon == std::string_view::npos ? 0 : colon);
+    if (colon == std::string_view::npos || arrow == std::string_view::npos) {
+        error = "expected `name: condition => action`";
+        return false;
+    }
+    StatusRule rule;
+    rule.name = trim(source.substr(0, colon));
+    if (rule.name.empty() || rule.name.find_first_of(" \t") != std::string::npos) {
+        error = "invalid rule name";
+        return false;
+    }
+    if (!parseActions(source.substr(arrow + 2), rule.name, rule.actions, error)) {
+        return false;
+    }
+
+    auto comparisons = mComparisons.size();
+    auto slotCount = mSlots.size();
+    Parser parser { *this, source.substr(colon + 1, arrow - colon - 1), 0, {}, {}, {} };
+    std::string key;
+    if (!parser.parseOr(key) || !parser.atEnd()) {
+        error = parser.error.empty() ? "unexpected `" + std::string(trim(parser.text.substr(parser.pos))) + "`"
+                                     : parser.error;
+        mComparisons.resize(comparisons);
+        std::erase_if(mComparisonKeys, [comparisons](const auto& entry) { return entry.second >= comparisons; });
+        std::erase_if(mSlots, [slotCount](const auto& entry) { return entry.second >= slotCount; });
+        mSlotConditions.resize(slotCount);
+        if (mStatusSlot && *mStatusSlot >= slotCount) {
+            mStatusSlot.reset();
+        }
+        if (mOnlineSlot && *mOnlineSlot >= slotCount) {
+            mOnlineSlot.reset();
+        }
+        return false;
+    }
+
+    auto [it, inserted] = mConditionKeys.try_emplace(key, static_cast<uint32_t>(mConditions.size()));
+    if (inserted) {
+        mConditions.push_back(Condition { std::move(parser.code), {} });
+        for (auto slot : parser.slots) {
+            mSlotConditions[slot].push_back(it->second);
+        }
+    }
+    rule.condition = it->second;
+    mConditions[rule.condition].rules.push_back(static_cast<uint32_t>(mRules.size()));
+    mRules.push_back(std::move(rule));
+    return true;
+}
+
+/**
+ * @brief 在设备状态上应用一组变化并运行规则
+ *        Apply a set of changes to the device state and run the rules.
+ *
+ * 值未变的槽位不算变化。之后只运行引用了变化槽位的条件，每个条件至多运行一次。
+ * An unchanged value is no change. Then only the conditions referencing a changed slot run, each at most once.
+ *
+ * @param deviceId 设备ID
+ * @param forget 运行规则后是否丢弃该设备保存的值
+ * @param matched 追加命中的规则
+ * @param changes 以 changes(当前值, update) 调用，通过 update(槽位, 新值) 写入变化，空值表示删除
+ * @return size_t 命中的规则数
+ */
+template <typename Changes>
+auto RuleEngine::apply(const std::string& deviceId, bool forget, std::vector<const StatusRule*>& matched,
+                       Changes&& changes) -> size_t {
+    auto& scratch = this->scratch();
+    auto generation = ++scratch.generation;
+    scratch.changed.clear();
+
+    auto& shard = mShards[std::hash<std::string> {}(deviceId) % kSHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.facts.find(deviceId);
+    Facts* facts = found == shard.facts.end() ? nullptr : &found->second;
+
+    auto update = [&](uint16_t slot, std::optional<AttributeValue> value) {
+        if (!facts) {
+            if (!value) {
+                return;
+            }
+            facts = &shard.facts[deviceId];
+        }
+        auto pos = std::lower_bound(facts->begin(), facts->end(), slot,
+                                    [](const auto& fact, uint16_t key) { return fact.first < key; });
+        bool present = pos != facts->end() && pos->first == slot;
+        if (present ? value && pos->second == *value : !value) {
+            return;
+        }
+        if (scratch.changedAt[slot] != generation) {
+            scratch.changedAt[slot] = generation;
+            scratch.previous[slot] = present ? std::optional<AttributeValue>(pos->second) : std::nullopt;
+            scratch.changed.push_back(slot);
+        }
+        if (!value) {
+            facts->erase(pos);
+        } else if (present) {
+            pos->second = std::move(*value);
+        } else {
+            facts->insert(pos, { slot, std::move(*value) });
+        }
+    };
+    changes(static_cast<const Facts*>(facts), update);
+
+    auto first = matched.size();
+    for (auto slot : scratch.changed) {
+        for (auto index : mSlotConditions[slot]) {
+            if (scratch.queuedAt[index] == generation) {
+                continue;
+            }
+            scratch.queuedAt[index] = generation;
+            const auto& condition = mConditions[index];
+            if (run(condition, *facts, scratch)) {
+                for (auto rule : condition.rules) {
+                    matched.push_back(&mRules[rule]);
+                }
+            }
+        }
+    }
+    if (facts && (forget || facts->empty())) {
+        shard.facts.erase(deviceId);
+    }
+    std::sort(matched.begin() + static_cast<std::ptrdiff_t>(first), matched.end());
+    return matched.size() - first;
+}
+
+/**
+ * @brief 用一条状态上报更新设备状态并运行规则
+ *        Apply one status report to the device state and run the rules.
+ *
+ * 只有规则引用的属性被记录；值未变的属性不算变化。$online 不随上报变化。
+ * Only attributes referenced by rules are recorded and an unchanged value is no change. $online never changes
+ * with a report.
+ *
+ * @param deviceId 设备ID
+ * @param status 上报的状态内容
+ * @param details 上报的属性
+ * @param matched 追加命中的规则
+ * @return size_t 命中的规则数
+ */
+auto RuleEngine::evaluate(const std::string& deviceId, const std::string& status, const StatusDetails& details,
+                          std::vector<const StatusRule*>& matched) -> size_t {
+    if (mRules.empty()) {
+        return 0;
+    }
+    return apply(deviceId, false, matched, [&](const Facts* facts, const auto& update) {
+        if (mStatusSlot) {
+            const auto* current = facts ? valueOf(*facts, *mStatusSlot) : nullptr;
+            const auto* previous = current ? std::get_if<std::string>(current) : nullptr;
+            if (!previous || *previous != status) {
+                update(*mStatusSlot, AttributeValue(status));
+            }
+        }
+        for (const auto& [attribute, raw] : details) {
+            auto it = mSlots.find(attribute);
+            if (it != mSlots.end() && it->second != mOnlineSlot) {
+                update(it->second, raw.empty() ? std::nullopt : std::optional(parseAttributeValue(raw)));
+            }
+        }
+    });
+}
+
+/**
+ * @brief 用设备的上线或离线更新 $online 并运行规则
+ *        Apply a device going online or offline to $online and run the rules.
+ *
+ * 离线时在运行规则之后丢弃该设备保存的全部值，不再上报的设备因此不会一直占用内存。
+ * Going offline drops every value kept for the device once the rules have run, so devices that stop reporting
+ * do not hold memory forever.
+ *
+ * @param deviceId 设备ID
+ * @param online 设备是否变为在线
+ * @param matched 追加命中的规则
+ * @return size_t 命中的规则数
+ */
+auto RuleEngine::transition(const std::string& deviceId, bool online, std::vector<const StatusRule*>& matched)
+    -> size_t {
+    if (mRules.empty()) {
+        return 0;
+    }
+    return apply(deviceId, !online, matched, [&](const Facts*, const auto& update) {
+        if (mOnlineSlot) {
+            update(*mOnlineSlot, AttributeValue(online));
+        }
+    });
+}
+
+/**
+ * @brief 读取规则文件
+ *        Read a rule file.
+ *
+ * @param path 文件路径
+ * @param out 追加读到的规则源码
+ * @return false 文件无法打开
+ */
+auto RuleEngine::loadFile(const std::string& path, std::vector<std::string>& out) -> bool {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        auto rule = trim(line);
+        if (!rule.empty() && rule[0] != '#') {
+            out.emplace_back(rule);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 求值一个比较
+ *        Evaluate one comparison.
+ *
+ * @param comparison 比较
+ * @param facts 设备的属性当前值
+ * @param scratch 本次求值的暂存区，提供变化标记与之前的值
+ * @return bool 比较结果
+ */
+auto RuleEngine::test(const Comparison& comparison, const Facts& facts, const Scratch& scratch) const -> bool {
+    bool changed = scratch.changedAt[comparison.slot] == scratch.generation;
+    if (comparison.op == Compare::Changed) {
+        return changed;
+    }
+    const AttributeValue* value = valueOf(facts, comparison.slot);
+    if (comparison.previous && changed) {
+        const auto& previous = scratch.previous[comparison.slot];
+        value = previous ? &*previous : nullptr;
+    }
+    if (!value) {
+        return false;
+    }
+
+    const auto& literal = comparison.literal;
+    switch (comparison.op) {
+    case Compare::Eq:
+        return *value == literal;
+    case Compare::Ne:
+        return *value != literal;
+    case Compare::Lt:
+        return ordered(*value, literal, std::less<> {});
+    case Compare::Le:
+        return ordered(*value, literal, std::less_equal<> {});
+    case Compare::Gt:
+        return ordered(*value, literal, std::greater<> {});
+    case Compare::Ge:
+        return ordered(*value, literal, std::greater_equal<> {});
+    case Compare::Truthy:
+        if (const auto* flag = std::get_if<bool>(value)) {
+            return *flag;
+        }
+        if (const auto* number = std::get_if<double>(value)) {
+            return *number != 0;
+        }
+        return false;
+    case Compare::Changed:
+        break;
+    }
+    return false;
+}
+
+/**
+ * @brief 设备某个槽位的当前值
+ *        Current value of one slot of a device.
+ *
+ * @param facts 设备的属性当前值，按槽位排序
+ * @param slot 属性槽位
+ * @return const AttributeValue* 当前值，缺失时为 nullptr
+ */
+auto RuleEngine::valueOf(const Facts& facts, uint16_t slot) -> const AttributeValue* {
+    auto pos = std::lower_bound(facts.begin(), facts.end(), slot,
+                                [](const auto& fact, uint16_t key) { return fact.first < key; });
+    return pos != facts.end() && pos->first == slot ? &pos->second : nullptr;
+}
+
+/**
+ * @brief 运行一个条件的字节码
+ *        Run the bytecode of one condition.
+ *
+ * 比较结果按代号缓存在暂存区中，被多个条件引用的比较在一次上报中只求值一次。
+ * Comparison results are cached in the scratch by generation, so a comparison shared by several conditions is
+ * evaluated once per report.
+ *
+ * @param condition 条件
+ * @param facts 设备的属性当前值
+ * @param scratch 本次求值的暂存区
+ * @return bool 条件是否成立
+ */
+auto RuleEngine::run(const Condition& condition, const Facts& facts, Scratch& scratch) const -> bool {
+    auto& stack = scratch.stack;
+    stack.clear();
+    size_t pc = 0;
+    while (pc < condition.code.size()) {
+        const auto& instruction = condition.code[pc];
+        switch (instruction.op) {
+        case Instruction::Op::Test:
+            if (scratch.testedAt[instruction.arg] != scratch.generation) {
+                scratch.testedAt[instruction.arg] = scratch.generation;
+                scratch.results[instruction.arg] = test(mComparisons[instruction.arg], facts, scratch);
+            }
+            stack.push_back(scratch.results[instruction.arg]);
+            ++pc;
+            break;
+        case Instruction::Op::Not:
+            stack.back() = !stack.back();
+            ++pc;
+            break;
+        case Instruction::Op::AndJump:
+        case Instruction::Op::OrJump:
+            // 短路：结果已定时保留栈顶跳到子表达式末尾，否则弹出并求值右侧
+            if ((stack.back() != 0) == (instruction.op == Instruction::Op::OrJump)) {
+                pc = instruction.arg;
+            } else {
+                stack.pop_back();
+                ++pc;
+            }
+            break;
+        }
+    }
+    return !stack.empty() && stack.back();
+}
+
+/**
+ * @brief 当前线程的暂存区
+ *        Scratch of the calling thread.
+ *
+ * @return Scratch& 已按本引擎的槽位、比较与条件数扩容的暂存区
+ */
+auto RuleEngine::scratch() const -> Scratch& {
+    thread_local Scratch scratch;
+    if (scratch.changedAt.size() < mSlots.size()) {
+        scratch.changedAt.resize(mSlots.size());
+        scratch.previous.resize(mSlots.size());
+    }
+    if (scratch.testedAt.size() < mComparisons.size()) {
+        scratch.testedAt.resize(mComparisons.size());
+        scratch.results.resize(mComparisons.size());
+    }
+    if (scratch.queuedAt.size() < mConditions.size()) {
+        scratch.queuedAt.resize(mConditions.size());
+    }
+    return scratch;
+}
+
+IOT_NS_END
@@ -0,0 +1,236 @@
+#include "StatusAggregator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <variant>
+
+IOT_NS_BEGIN
+
+/**
+ * @brief 构造函数，规范化聚合规则并创建写入条带
+ *        Constructor: normalizes the aggregations and creates the write stripes.
+ *
+ * @param specs 聚合规则
+ * @param groupDelimiter 设备分组分隔符
+ */
+StatusAggregator::StatusAggregator(const std::vector<AggregationSpec>& specs, std::string groupDelimiter)
+    : mDelimiter(std::move(groupDelimiter)) {
+    for (auto spec : specs) {
+        if (spec.name.empty() || spec.attribute.empty() || spec.window.count() <= 0) {
+            std::cerr << "StatusAggregator: ignoring invalid aggregation " << spec.name << std::endl;
+            continue;
+        }
+        if (spec.slide.count() <= 0 || spec.slide > spec.window) {
+            spec.slide = spec.window;
+        }
+        auto panes = (spec.window.count() + spec.slide.count() - 1) / spec.slide.count();
+        spec.window = spec.slide * panes;
+        mSpecs.push_back(std::move(spec));
+    }
+    mStripes.reserve(kSTRIPES);
+    for (size_t i = 0; i < kSTRIPES; ++i) {
+        auto stripe = std::make_unique<Stripe>();
+        stripe->panes.resize(mSpecs.size());
+        mStripes.push_back(std::move(stripe));
+    }
+}
+
+/**
+ * @brief 累计一条状态上报
+ *        Accumulate one status report.
+ *
+ * 只有上报中含有规则引用的数值或布尔属性时才获取条带锁。
+ * The stripe lock is only taken when the report carries a numeric or boolean attribute an aggregation uses.
+ *
+ * @param deviceId 设备ID
+ * @param details 上报的属性
+ * @param nowMs 到达时间（Unix 毫秒）
+ */
+void StatusAggregator::record(const std::string& deviceId, const StatusDetails& details, int64_t nowMs) {
+    if (mSpecs.empty() || details.empty()) {
+        return;
+    }
+    auto group = groupOf(deviceId, mDelimiter);
+    Stripe* stripe = nullptr;
+    std::unique_lock<std::mutex> lock;
+    for (size_t i = 0; i < mSpecs.size(); ++i) {
+        const auto& spec = mSpecs[i];
+        auto detail = std::find_if(details.begin(), details.end(),
+                                   [&spec](const auto& entry) { return entry.first == spec.attribute; });
+        if (detail == details.end()) {
+            continue;
+        }
+        auto parsed = parseAttributeValue(detail->second);
+        double value = 0;
+        if (const auto* number = std::get_if<double>(&parsed)) {
+            value = *number;
+        } else if (const auto* flag = std::get_if<bool>(&parsed)) {
+            value = *flag ? 1 : 0;
+        } else {
+            continue;
+        }
+        if (!stripe) {
+            stripe = &this->stripe();
+            lock = std::unique_lock<std::mutex>(stripe->mutex);
+        }
+        auto* pane = paneFor(stripe->panes[i], paneStartOf(nowMs, spec.slide.count()), spec.window.count());
+        if (!pane) {
+            continue;
+        }
+        auto it = pane->groups.find(group);
+        if (it == pane->groups.end()) {
+            it = pane->groups.try_emplace(std::string(group)).first;
+        }
+        it->second.add(value);
+    }
+}
+
+/**
+ * @brief 查询一个窗口
+ *        Query one window.
+ *
+ * 默认查询以当前窗格起点结束的完整窗口；includeOpen 时窗口以当前窗格终点结束，包含尚未结束的窗格。
+ * By default the complete window ending where the current pane starts is queried; with includeOpen the window
+ * ends where the current pane ends, including the pane still in progress.
+ *
+ * @param query 聚合名称、分位点与窗口选择
+ * @param out 输出的窗口结果
+ * @param nowMs 当前时间（Unix 毫秒）
+ * @return false 聚合名称未配置
+ */
+auto StatusAggregator::query(const AggregateQuery& query, AggregateWindow& out, int64_t nowMs) const -> bool {
+    out = {};
+    auto spec = std::find_if(mSpecs.begin(), mSpecs.end(),
+                             [&query](const AggregationSpec& s) { return s.name == query.name; });
+    if (spec == mSpecs.end()) {
+        return false;
+    }
+    auto index = static_cast<size_t>(spec - mSpecs.begin());
+    int64_t slide = spec->slide.count();
+    out.endMs = paneStartOf(nowMs, slide) + (query.includeOpen ? slide : 0);
+    out.startMs = out.endMs - spec->window.count();
+
+    GroupMap merged;
+    for (const auto& stripe : mStripes) {
+        std::lock_guard<std::mutex> lock(stripe->mutex);
+        for (const auto& pane : stripe->panes[index]) {
+            if (pane.startMs < out.startMs || pane.startMs >= out.endMs) {
+                continue;
+            }
+            for (const auto& [group, partial] : pane.groups) {
+                merged[group].merge(partial);
+            }
+        }
+    }
+
+    out.groups.reserve(merged.size());
+    for (auto& [group, partial] : merged) {
+        AggregateGroup result { group, partial.count, partial.sum, partial.min, partial.max,
+                                partial.sum / static_cast<double>(partial.count), {} };
+        result.quantiles.reserve(query.quantiles.size());
+        for (double q : query.quantiles) {
+            result.quantiles.push_back(partial.sketch.quantile(q));
+        }
+        out.groups.push_back(std::move(result));
+    }
+    std::sort(out.groups.begin(), out.groups.end(),
+              [](const AggregateGroup& a, const AggregateGroup& b) { return a.group < b.group; });
+    return true;
+}
+
+/**
+ * @brief 设备所属的分组
+ *        Group of a device.
+ *
+ * @param deviceId 设备ID
+ * @param delimiter 分组分隔符
+ * @return std::string_view 分组名
+ */
+auto StatusAggregator::groupOf(std::string_view deviceId, std::string_view delimiter) -> std::string_view {
+    if (delimiter.empty()) {
+        return {};
+    }
+    return deviceId.substr(0, deviceId.find(delimiter));
+}
+
+/**
+ * @brief 累计一个样本
+ *        Accumulate one sample.
+ */
+void StatusAggregator::Partial::add(double value) {
+    min = count == 0 ? value : std::min(min, value);
+    max = count == 0 ? value : std::max(max, value);
+    sum += value;
+    ++count;
+    sketch.add(value);
+}
+
+/**
+ * @brief 合并另一个部分聚合结果
+ *        Merge another partial aggregate.
+ */
+void StatusAggregator::Partial::merge(const Partial& other) {
+    if (other.count == 0) {
+        return;
+    }
+    min = count == 0 ? other.min : std::min(min, other.min);
+    max = count == 0 ? other.max : std::max(max, other.max);
+    sum += other.sum;
+    count += other.count;
+    sketch.merge(other.sketch);
+}
+
+/**
+ * @brief 找到或创建窗格
+ *        Find or create a pane.
+ *
+ * 窗格按起点递增排列，新窗格几乎总是追加在末尾；只保留起点不早于「最新窗格起点 - 窗口长度」的窗格，
+ * 即最近一个完整窗口加上进行中的窗格。
+ * Panes are ordered by start and a new one is nearly always appended; only panes starting no earlier than the
+ * newest pane start minus the window are kept, i.e. the latest complete window plus the pane in progress.
+ *
+ * @param panes 一条规则的窗格
+ * @param paneStart 样本所在窗格的起点
+ * @param windowMs 窗口长度
+ * @return Pane* 窗格，样本早于保留范围时为 nullptr
+ */
+auto StatusAggregator::paneFor(std::deque<Pane>& panes, int64_t paneStart, int64_t windowMs) -> Pane* {
+    if (panes.empty() || panes.back().startMs < paneStart) {
+        panes.push_back(Pane { paneStart, {} });
+        while (panes.front().startMs < paneStart - windowMs) {
+            panes.pop_front();
+        }
+        return &panes.back();
+    }
+    if (paneStart < panes.back().startMs - windowMs) {
+        return nullptr;
+    }
+    // 乱序到达的样本（同一条带上另一个线程先推进了时间）：二分查找所在位置
+    auto it = std::lower_bound(panes.begin(), panes.end(), paneStart,
+                               [](const Pane& pane, int64_t start) { return pane.startMs < start; });
+    if (it == panes.end() || it->startMs != paneStart) {
+        it = panes.insert(it, Pane { paneStart, {} });
+    }
+    return &*it;
+}
+
+/**
+ * @brief 时间所在窗格的起点
+ *        Start of the pane containing a time.
+ */
+auto StatusAggregator::paneStartOf(int64_t timeMs, int64_t slideMs) -> int64_t {
+    int64_t offset = timeMs % slideMs;
+    return timeMs - (offset < 0 ? offset + slideMs : offset);
+}
+
+/**
+ * @brief 当前线程的写入条带，按线程 ID 哈希选取并在线程内缓存
+ *        Write stripe of the calling thread, picked by thread ID hash and cached per thread.
+ */
+auto StatusAggregator::stripe() const -> Stripe& {
+    thread_local const size_t slot = std::hash<std::thread::id> {}(std::this_thread::get_id());
+    return *mStripes[slot % kSTRIPES];
+}
+
+IOT_NS_END
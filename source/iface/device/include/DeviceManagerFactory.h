@@ -8,6 +8,9 @@
 /// 默认设备管理器插件名称（Default implementation plugin name）
 #define DEVICE_MANAGER_DEFAULT "default"
 
+/// 列式设备管理器插件名称，适合频繁全量扫描的大规模设备集（Columnar plugin name, for scan-heavy large fleets）
+#define DEVICE_MANAGER_COLUMNAR "columnar"
+
 IOT_DEVICE_NS_BEGIN
 
 /**
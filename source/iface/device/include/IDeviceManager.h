@@ -1,8 +1,21 @@
 #pragma once
 
 #include "common/NameSpaceDef.h"
+#include "device/DeviceEvent.h"
+#include "device/DeviceHandle.h"
 #include "device/DeviceInfo.h"
+#include "device/DeviceManagerOptions.h"
+#include "device/DeviceQuery.h"
+#include "device/DeviceRegistration.h"
+#include "device/DeviceSlot.h"
+#include "device/DeviceStatusUpdate.h"
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 IOT_DEVICE_NS_BEGIN
 
@@ -42,6 +55,17 @@ public:
      */
     virtual void shutdown() = 0;
 
+    /**
+     * @brief Apply runtime tuning options.
+     * @brief 应用运行时调优参数
+     *
+     * Must be called before any device is registered; implementations may ignore options they do not support.
+     * 必须在注册任何设备之前调用；实现可以忽略不支持的参数。
+     *
+     * @param options Tuning options such as shard count and heartbeat timeout. 分片数、心跳超时等调优参数
+     */
+    virtual void configure(const DeviceManagerOptions& options) { (void)options; }
+
     /**
      * @brief Register a device by its ID.
      * @brief 注册设备
@@ -63,6 +87,215 @@ public:
      */
     virtual void refreshDeviceHeartbeat(const std::string& deviceId) = 0;
 
+    /**
+     * @brief Acquire the registry slot of a device for lock-free heartbeat updates.
+     * @brief 获取设备的注册表槽位，用于无锁心跳更新
+     *
+     * For callers that need the slot itself, such as watch snapshots; sessions cache a DeviceHandle instead.
+     * 供需要槽位本身的调用方使用，如订阅快照；会话改为缓存 DeviceHandle。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @return The slot, or nullptr if the device is not registered.
+     *         设备槽位，未注册时返回 nullptr。
+     */
+    virtual auto acquireSlot(const std::string& deviceId) -> std::shared_ptr<DeviceSlot> = 0;
+
+    /**
+     * @brief Refresh the heartbeat directly on a registry slot.
+     * @brief 直接在注册表槽位上刷新心跳
+     *
+     * Must be lock-free and safe to call from any thread; only an offline→online transition emits an event.
+     * 必须无锁且可在任意线程调用；只有离线→在线的状态变化才会发出事件。
+     *
+     * @param slot Slot obtained from acquireSlot(). 通过 acquireSlot() 获取的槽位
+     */
+    virtual void refreshDeviceHeartbeat(DeviceSlot& slot) = 0;
+
+    /**
+     * @brief Register a device and return its handle.
+     * @brief 注册设备并返回其句柄
+     *
+     * The handle is filled in whether the device is new or already registered. The default implementation
+     * registers by ID and reports no handle.
+     * 无论设备是新注册还是已存在，都会填入句柄；默认实现按 ID 注册，不提供句柄。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param outHandle Output handle, kINVALID_DEVICE_HANDLE when unsupported. 输出的句柄，不支持时为无效句柄
+     * @return true if the device was newly registered, false if it already existed.
+     *         新注册返回 true，已存在返回 false。
+     */
+    virtual auto registerDevice(const std::string& deviceId, DeviceHandle& outHandle) -> bool {
+        outHandle = kINVALID_DEVICE_HANDLE;
+        return registerDevice(deviceId);
+    }
+
+    /**
+     * @brief Register a device on behalf of an owner and return its handle.
+     * @brief 代表所有者注册设备并返回其句柄
+     *
+     * A new device is bound to the owner; an existing device without an owner is claimed by it, and one that
+     * already has an owner keeps it. The default implementation records no owners.
+     * 新设备绑定到该所有者；已存在但尚未绑定的设备由其认领，已有所有者的设备保持不变；默认实现不记录所有者。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param owner Owning user, empty for none. 所有者，为空表示不绑定
+     * @param outHandle Output handle, kINVALID_DEVICE_HANDLE when unsupported. 输出的句柄，不支持时为无效句柄
+     * @return true if the device was newly registered, false if it already existed.
+     *         新注册返回 true，已存在返回 false。
+     */
+    virtual auto registerDevice(const std::string& deviceId, const std::string& owner, DeviceHandle& outHandle)
+        -> bool {
+        (void)owner;
+        return registerDevice(deviceId, outHandle);
+    }
+
+    /**
+     * @brief Bind a registered device to another owner.
+     * @brief 将已注册设备改绑到其他所有者
+     *
+     * The default implementation records no owners.
+     * 默认实现不记录所有者。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param owner New owner, empty to unbind. 新的所有者，为空表示解除绑定
+     * @return true if applied, false if the device is not registered or owners are unsupported.
+     *         设置成功返回 true，设备未注册或不支持时返回 false。
+     */
+    virtual auto setDeviceOwner(const std::string& deviceId, const std::string& owner) -> bool {
+        (void)deviceId;
+        (void)owner;
+        return false;
+    }
+
+    /**
+     * @brief Register a batch of devices.
+     * @brief 批量注册设备
+     *
+     * Entries repeating a device ID earlier in the batch are skipped, and existing devices are claimed by the
+     * entry's owner as in registerDevice(). The default implementation registers the entries one at a time.
+     * 批次内重复的设备 ID 只保留第一次出现；已存在的设备与 registerDevice() 一样由条目的所有者认领。
+     * 默认实现逐条注册。
+     *
+     * @param devices Devices to register. 待注册的设备
+     * @param outResult Output tally of the batch. 输出的批次统计
+     * @return true once the whole batch is processed. 整批处理完成后返回 true
+     */
+    virtual auto registerDevices(const std::vector<DeviceRegistration>& devices, DeviceImportResult& outResult)
+        -> bool {
+        outResult = {};
+        std::unordered_set<std::string_view> seen;
+        DeviceHandle handle;
+        for (const auto& device : devices) {
+            if (device.deviceId.empty()) {
+                ++outResult.rejected;
+            } else if (!seen.insert(device.deviceId).second) {
+                ++outResult.duplicates;
+            } else if (registerDevice(device.deviceId, device.owner, handle)) {
+                ++outResult.registered;
+            } else {
+                ++outResult.existing;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Resolve the handle of a registered device.
+     * @brief 解析已注册设备的句柄
+     *
+     * Meant to be called once per session or stream; later calls go through the handle overloads.
+     * The default implementation supports no handles.
+     * 每个会话或流只需调用一次，之后使用按句柄的重载；默认实现不支持句柄。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @return The handle, or kINVALID_DEVICE_HANDLE if the device is not registered.
+     *         设备句柄，未注册时返回无效句柄。
+     */
+    virtual auto acquireHandle(const std::string& deviceId) -> DeviceHandle {
+        (void)deviceId;
+        return kINVALID_DEVICE_HANDLE;
+    }
+
+    /**
+     * @brief Refresh the heartbeat of a device by handle.
+     * @brief 按句柄刷新设备心跳
+     *
+     * Same contract as the slot overload: lock-free, no hashing, and only an offline→online transition emits an
+     * event. The default implementation ignores the call.
+     * 与槽位重载约定相同：无锁、不做哈希，只有离线→在线的变化才发出事件；默认实现忽略该调用。
+     *
+     * @param handle Handle from registerDevice() or acquireHandle(). 设备句柄
+     */
+    virtual void refreshDeviceHeartbeat(DeviceHandle handle) { (void)handle; }
+
+    /**
+     * @brief Report the status of a device by handle.
+     * @brief 按句柄上报设备状态
+     *
+     * @param handle Device handle. 设备句柄
+     * @param status Status string. 状态信息
+     * @param details Changed attributes, an empty value removes one. 变化的属性，空值表示删除
+     * @return false if the handle is unknown or handles are unsupported.
+     *         句柄无效或不支持句柄时返回 false。
+     */
+    virtual auto reportStatus(DeviceHandle handle, const std::string& status, const StatusDetails& details)
+        -> bool {
+        (void)handle;
+        (void)status;
+        (void)details;
+        return false;
+    }
+
+    /**
+     * @brief Retrieve device information by handle.
+     * @brief 按句柄获取设备信息
+     *
+     * @param handle Device handle. 设备句柄
+     * @param outInfo Output device info. 输出的设备信息
+     * @return false if the handle is unknown or handles are unsupported.
+     *         句柄无效或不支持句柄时返回 false。
+     */
+    virtual auto getDeviceInfo(DeviceHandle handle, DeviceInfo& outInfo) -> bool {
+        (void)handle;
+        (void)outInfo;
+        return false;
+    }
+
+    /**
+     * @brief Install the listener receiving device state transition events.
+     * @brief 设置设备状态变化事件监听器
+     *
+     * The listener may be invoked from any thread and must not block.
+     * 监听器可能在任意线程被调用，且不能阻塞。
+     *
+     * @param listener Event listener, empty to remove. 事件监听器，传空表示移除
+     */
+    virtual void setEventListener(DeviceEventListener listener) = 0;
+
+    /**
+     * @brief Enable or disable StatusChanged events.
+     * @brief 开启或关闭状态内容变化事件
+     *
+     * Off by default so that status reports cost no comparison or copy while nobody watches them.
+     * Implementations that do not support status events may ignore it.
+     * 默认关闭，无人关注时状态上报不做比较也不复制内容；不支持该事件的实现可以忽略。
+     *
+     * @param enabled Whether changed status reports emit events. 内容变化的上报是否发出事件
+     */
+    virtual void setStatusEventsEnabled(bool enabled) { (void)enabled; }
+
+    /**
+     * @brief Whether persistent storage failed, so updates are no longer made durable.
+     * @brief 持久化存储是否已出错，更新不再落盘
+     *
+     * Callers should fail writes while this holds. The default implementation keeps nothing on disk.
+     * 为 true 期间调用方应让写入请求失败；默认实现不落盘。
+     *
+     * @return true if the last write to storage failed and it has not recovered.
+     *         最近一次写入存储失败且尚未恢复时返回 true。
+     */
+    virtual auto storageFailed() -> bool { return false; }
+
     /**
      * @brief Mark a device as offline.
      * @brief 标记设备为离线
@@ -71,6 +304,25 @@ public:
      */
     virtual void markDeviceOffline(const std::string& deviceId) = 0;
 
+    /**
+     * @brief Override the heartbeat timeout of one device.
+     * @brief 单独设置某个设备的心跳超时
+     *
+     * Takes precedence over the device class and the manager default; the default implementation supports no
+     * per-device timeout.
+     * 优先于设备类别与管理器默认值；默认实现不支持单设备超时。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param timeout Heartbeat timeout, 0 to fall back to the class or default. 心跳超时，0 表示恢复类别或默认值
+     * @return true if applied, false if the device is not registered or unsupported.
+     *         设置成功返回 true，设备未注册或不支持时返回 false。
+     */
+    virtual auto setHeartbeatTimeout(const std::string& deviceId, std::chrono::milliseconds timeout) -> bool {
+        (void)deviceId;
+        (void)timeout;
+        return false;
+    }
+
     /**
      * @brief Report current status of the device.
      * @brief 上报设备状态
@@ -80,6 +332,47 @@ public:
      */
     virtual void reportStatus(const std::string& deviceId, const std::string& status) = 0;
 
+    /**
+     * @brief Report the status of a device together with changed structured attributes.
+     * @brief 上报设备状态以及变化的结构化属性
+     *
+     * Attributes are partial: listed keys are merged into the stored ones and an empty value removes a key.
+     * The default implementation ignores the attributes and falls back to reportStatus().
+     * 属性是增量的：列出的键与已保存的属性合并，空值表示删除该键；默认实现忽略属性，调用 reportStatus()。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param status Status string. 状态信息
+     * @param details Changed attributes as reported. 上报的变化属性
+     */
+    virtual void reportStatus(const std::string& deviceId, const std::string& status, const StatusDetails& details) {
+        (void)details;
+        reportStatus(deviceId, status);
+    }
+
+    /**
+     * @brief Report the status of many devices at once.
+     * @brief 批量上报设备状态
+     *
+     * Status payloads are moved out of the updates. The default implementation falls back to reportStatus().
+     * 状态内容会从批次中移走；默认实现逐条调用 reportStatus()。
+     *
+     * @param updates Status updates. 状态上报批次
+     * @return Indexes of updates whose device is not registered or whose update could not be made durable, in
+     *         ascending order.
+     *         设备未注册或上报未能落盘的条目下标，按升序排列。
+     */
+    virtual auto reportStatusBatch(std::vector<DeviceStatusUpdate>& updates) -> std::vector<uint32_t> {
+        std::vector<uint32_t> unknown;
+        for (uint32_t i = 0; i < updates.size(); ++i) {
+            if (!acquireSlot(updates[i].deviceId)) {
+                unknown.push_back(i);
+                continue;
+            }
+            reportStatus(updates[i].deviceId, updates[i].status, updates[i].details);
+        }
+        return unknown;
+    }
+
     /**
      * @brief Check if a device is currently online.
      * @brief 判断设备是否在线
@@ -100,6 +393,92 @@ public:
      *         成功返回 true，否则返回 false。
      */
     virtual auto getDeviceInfo(const std::string& deviceId, DeviceInfo& outInfo) -> bool = 0;
+
+    /**
+     * @brief Check whether a registered device is visible to a user.
+     * @brief 检查已注册设备对用户是否可见
+     *
+     * A device is visible to its owner, and to every user while it has no owner. The default implementation
+     * reads the owner through getDeviceInfo; implementations that keep owners in the registry should override it.
+     * 设备对其所有者可见，尚未绑定所有者时对所有用户可见；默认实现经 getDeviceInfo 读取所有者，在注册表中保存
+     * 所有者的实现应覆盖它。
+     *
+     * @param deviceId Unique identifier of the device. 设备唯一标识符
+     * @param viewer User asking for the device. 查询的用户
+     * @return true if the device is registered and visible to the user, false otherwise.
+     *         设备已注册且对该用户可见返回 true，否则返回 false。
+     */
+    virtual auto isDeviceVisibleTo(const std::string& deviceId, const std::string& viewer) -> bool {
+        DeviceInfo info;
+        return getDeviceInfo(deviceId, info) && (info.owner.empty() || info.owner == viewer);
+    }
+
+    /**
+     * @brief List devices matching a query, one page at a time.
+     * @brief 分页列出匹配查询条件的设备
+     *
+     * Implementations must never hold registry locks for a whole listing, so that listing millions of devices
+     * cannot stall heartbeats. The default implementation supports no listing and reports an invalid cursor.
+     * 实现不能在整个列出过程中持有注册表锁，列出数百万设备时也不能阻塞心跳；默认实现不支持列出，返回 false。
+     *
+     * @param query Filters, cursor and page size. 过滤条件、游标与每页数量
+     * @param outPage Output page. 输出的一页结果
+     * @return true on success, false if the cursor is malformed or stale.
+     *         成功返回 true，游标格式错误或已失效返回 false。
+     */
+    virtual auto listDevices(const DeviceQuery& query, DevicePage& outPage) -> bool {
+        (void)query;
+        outPage = {};
+        return false;
+    }
+
+    /**
+     * @brief Count registered devices per status.
+     * @brief 按状态统计已注册设备数量
+     *
+     * Must not scan the registry: implementations keep counters updated with every transition. The default
+     * implementation keeps none and reports the counts as unsupported.
+     * 不能扫描注册表，实现需随每次状态变化维护计数；默认实现不维护计数，返回 false。
+     *
+     * @param outCounts Output counts. 输出的数量
+     * @return true on success, false if counting is unsupported.
+     *         成功返回 true，不支持时返回 false。
+     */
+    virtual auto countDevices(DeviceCounts& outCounts) -> bool {
+        outCounts = {};
+        return false;
+    }
+
+    /**
+     * @brief Read the recorded history of a numeric attribute of a device.
+     * @brief 读取设备某个数值属性的历史记录
+     *
+     * Raw samples when the query step is zero, otherwise one aggregated point per non-empty bucket. The default
+     * implementation records no history and reports every device as unknown.
+     * 查询步长为 0 时返回原始样本，否则每个非空的时间桶返回一个聚合点；默认实现不记录历史，所有设备都视为未知。
+     *
+     * @param query Device, attribute, time range and step. 设备、属性、时间范围与步长
+     * @param outPoints Output points in time order, empty if nothing was recorded. 按时间排序的输出点，无记录时为空
+     * @return true if the device is registered, false otherwise.
+     *         设备已注册返回 true，否则返回 false。
+     */
+    virtual auto getDeviceHistory(const HistoryQuery& query, std::vector<HistoryPoint>& outPoints) -> bool {
+        (void)query;
+        outPoints.clear();
+        return false;
+    }
+
+    /**
+     * @brief Visit the registry slot of every registered device.
+     * @brief 遍历所有已注册设备的注册表槽位
+     *
+     * The visitor may run while part of the registry is locked, so it must be short and must not call back into
+     * the device manager. The default implementation visits nothing.
+     * 访问函数执行时注册表的一部分可能处于加锁状态，因此必须短小且不能回调设备管理器；默认实现不访问任何设备。
+     *
+     * @param visitor Visitor invoked once per device. 每个设备调用一次的访问函数
+     */
+    virtual void forEachDevice(const std::function<void(const DeviceSlot&)>& visitor) { (void)visitor; }
 };
 
 IOT_DEVICE_NS_END
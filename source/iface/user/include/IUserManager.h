@@ -1,6 +1,7 @@
 #pragma once
 
 #include "user/User.h"
+#include "user/UserManagerOptions.h"
 
 IOT_USER_NS_BEGIN
 
@@ -30,6 +31,17 @@ public:
      * @return bool Returns true if the user is valid, false otherwise / 返回 true 表示用户验证通过，false 表示验证失败
      */
     virtual auto validateUser(const User& user) -> bool = 0;
+
+    /**
+     * @brief Apply runtime options.
+     * @brief 应用运行时参数
+     *
+     * Must be called before any user is validated; implementations may ignore options they do not support.
+     * 必须在校验任何用户之前调用；实现可以忽略不支持的参数。
+     *
+     * @param options Options such as the credentials file. 凭据文件等参数
+     */
+    virtual void configure(const UserManagerOptions& options) { (void)options; }
 };
 
 IOT_USER_NS_END
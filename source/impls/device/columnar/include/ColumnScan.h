@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <cstddef>
+#include <cstdint>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief 列式设备状态的向量化扫描内核
+ * @brief Vectorized scan kernels over columnar device state.
+ *
+ * 每次处理一个 64 个设备的块，返回 64 位匹配掩码（第 i 位对应块内第 i 个设备），
+ * 调用方用按位运算组合多个条件，再用 popcount 计数或逐位取出匹配的设备。
+ * 在 x86-64 上运行时检测 CPU：支持 AVX2 时使用 256 位指令，否则字节比较使用 SSE2、64 位比较退回标量；
+ * 其他架构使用标量实现。
+ * Each call handles one block of 64 devices and returns a 64-bit match mask (bit i is device i of the block).
+ * Callers combine conditions with bitwise operations, then popcount the mask or walk its set bits. On x86-64
+ * the CPU is probed at startup: AVX2 uses 256-bit instructions, otherwise byte compares use SSE2 and 64-bit
+ * compares fall back to scalar code; other architectures use the scalar kernels.
+ *
+ * 内核以普通向量加载读取列，与并发写入的原子存储之间不加同步：扫描结果是一份近似快照，
+ * 每个元素要么是旧值要么是新值。
+ * Kernels read the columns with plain vector loads, unsynchronized with concurrent atomic stores: a scan is a
+ * loose snapshot in which every element is either its old or its new value.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-06
+ */
+struct ColumnScan {
+    /// @brief Devices per scan block, one bit each in a mask
+    /// @brief 每个扫描块的设备数，掩码中每个设备占一位
+    static constexpr size_t kBLOCK = 64;
+
+    /**
+     * @brief Mask of the bytes equal to a value.
+     * @brief 等于给定值的字节掩码
+     *
+     * @param bytes kBLOCK bytes
+     * @param value Value compared against
+     */
+    static auto equalMask(const uint8_t* bytes, uint8_t value) -> uint64_t;
+
+    /**
+     * @brief Mask of the values strictly less than a bound.
+     * @brief 严格小于上界的 64 位整数掩码
+     *
+     * @param values kBLOCK signed 64-bit values
+     * @param bound Exclusive upper bound
+     */
+    static auto lessMask(const int64_t* values, int64_t bound) -> uint64_t;
+
+    /**
+     * @brief Instruction set picked at startup: "avx2", "sse2" or "scalar".
+     * @brief 启动时选用的指令集："avx2"、"sse2" 或 "scalar"
+     */
+    static auto isa() -> const char*;
+};
+
+IOT_DEVICE_NS_END
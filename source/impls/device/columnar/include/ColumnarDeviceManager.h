@@ -0,0 +1,494 @@
+#pragma once
+
+#include "DeviceManagerFactory.h"
+#include "IDeviceManager.h"
+#include "PluginFactory.h"
+#include "PluginRegistry.h"
+#include "common/NameSpaceDef.h"
+#include "common/ShardedMap.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief Columnar (struct-of-arrays) implementation of IDeviceManager for scan-heavy workloads.
+ * @brief 面向扫描密集型负载的列式（数组结构）IDeviceManager 实现
+ *
+ * Hot fields live in contiguous columns indexed by the device handle: one status byte and one heartbeat
+ * timestamp per device. Listings, status counts and the expiry sweep stream over these columns with the
+ * ColumnScan kernels, 64 devices per mask, and only touch the ID and cold data of the devices that match.
+ * Cold data (last status report and attributes) lives out of line and is allocated on the first report.
+ * 热字段按设备句柄存放在连续的列中：每个设备一个状态字节和一个心跳时间戳。列表查询、状态计数与超时扫描
+ * 都用 ColumnScan 内核顺序扫描这些列，每个掩码覆盖 64 个设备，只有匹配的设备才会访问其 ID 与冷数据。
+ * 冷数据（最近一次状态上报与属性）存放在列之外，首次上报时才分配。
+ *
+ * All devices share the manager's heartbeat timeout: per-device overrides and device classes are not supported.
+ * There are no registry slots either, so acquireSlot() always returns nullptr and callers use handles or IDs.
+ * Attribute history is not recorded.
+ * 所有设备共用管理器的心跳超时，不支持单设备超时与设备类别；也没有注册表槽位，acquireSlot() 始终返回
+ * nullptr，调用方使用句柄或设备 ID。不记录属性历史。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-06
+ */
+class ColumnarDeviceManager : public IDeviceManager {
+public:
+    /**
+     * @brief Constructor
+     * @brief 构造函数
+     */
+    ColumnarDeviceManager();
+
+    /**
+     * @brief Destructor
+     * @brief 析构函数
+     */
+    ~ColumnarDeviceManager() override;
+
+    /**
+     * @brief Initialize internal resources.
+     * @brief 初始化内部资源
+     */
+    void init() override;
+
+    /**
+     * @brief Cleanup resources before shutdown.
+     * @brief 释放资源，准备关闭
+     */
+    void shutdown() override;
+
+    /**
+     * @brief Apply shard count, heartbeat timeout and expiry tick.
+     * @brief 应用分片数、心跳超时与超时扫描粒度配置
+     *
+     * Stops the expiry sweeper and drops every column; heartbeat classes are ignored.
+     * 停止超时扫描线程并清空所有列；忽略设备类别。
+     *
+     * @param options Tuning options
+     */
+    void configure(const DeviceManagerOptions& options) override;
+
+    /**
+     * @brief Register a device by its ID.
+     * @brief 根据设备 ID 注册设备
+     *
+     * @param deviceId Unique identifier of the device
+     * @return Whether registration is successful
+     */
+    auto registerDevice(const std::string& deviceId) -> bool override;
+
+    /**
+     * @brief Update device's heartbeat timestamp to maintain online state.
+     * @brief 刷新设备心跳时间以保持在线状态
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    void refreshDeviceHeartbeat(const std::string& deviceId) override;
+
+    /**
+     * @brief Registry slots are not supported; always nullptr.
+     * @brief 不支持注册表槽位，始终返回 nullptr
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    auto acquireSlot(const std::string& deviceId) -> std::shared_ptr<DeviceSlot> override;
+
+    /**
+     * @brief Heartbeat refresh for a slot built by forEachDevice(), resolved by its device ID.
+     * @brief 为 forEachDevice() 构造的槽位刷新心跳，按其设备 ID 查找
+     *
+     * @param slot Slot carrying the device ID
+     */
+    void refreshDeviceHeartbeat(DeviceSlot& slot) override;
+
+    /**
+     * @brief Register a device and return its handle, which is also its column index.
+     * @brief 注册设备并返回其句柄，句柄即设备在列中的下标
+     *
+     * @param deviceId Unique identifier of the device
+     * @param outHandle Output handle, filled in for new and existing devices
+     * @return true if the device was newly registered
+     */
+    auto registerDevice(const std::string& deviceId, DeviceHandle& outHandle) -> bool override;
+
+    /**
+     * @brief Resolve the handle of a registered device.
+     * @brief 解析已注册设备的句柄
+     *
+     * @param deviceId Unique identifier of the device
+     * @return The handle, kINVALID_DEVICE_HANDLE if the device is not registered
+     */
+    auto acquireHandle(const std::string& deviceId) -> DeviceHandle override;
+
+    /**
+     * @brief Lock-free heartbeat refresh by handle: one store into the heartbeat column.
+     * @brief 按句柄无锁刷新心跳：只向心跳列写入一次
+     *
+     * @param handle Device handle
+     */
+    void refreshDeviceHeartbeat(DeviceHandle handle) override;
+
+    /**
+     * @brief Report the status of a device by handle.
+     * @brief 按句柄上报设备状态
+     *
+     * @param handle Device handle
+     * @param status Status string
+     * @param details Changed attributes, an empty value removes one
+     * @return false if the handle is unknown
+     */
+    auto reportStatus(DeviceHandle handle, const std::string& status, const StatusDetails& details)
+        -> bool override;
+
+    /**
+     * @brief Get device information by handle.
+     * @brief 按句柄获取设备信息
+     *
+     * @param handle Device handle
+     * @param outInfo Output parameter to store device info
+     * @return false if the handle is unknown
+     */
+    auto getDeviceInfo(DeviceHandle handle, DeviceInfo& outInfo) -> bool override;
+
+    /**
+     * @brief Install the device event listener.
+     * @brief 设置设备事件监听器
+     *
+     * @param listener Event listener
+     */
+    void setEventListener(DeviceEventListener listener) override;
+
+    /**
+     * @brief Enable or disable StatusChanged events.
+     * @brief 开启或关闭状态内容变化事件
+     *
+     * @param enabled Whether changed status reports emit events
+     */
+    void setStatusEventsEnabled(bool enabled) override;
+
+    /**
+     * @brief Mark a device as offline.
+     * @brief 将设备标记为离线
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    void markDeviceOffline(const std::string& deviceId) override;
+
+    /**
+     * @brief Report current status of a device.
+     * @brief 上报设备当前状态
+     *
+     * @param deviceId Unique identifier of the device
+     * @param status Status string (e.g., JSON/XML format)
+     */
+    void reportStatus(const std::string& deviceId, const std::string& status) override;
+
+    /**
+     * @brief Report the status of a device and merge changed structured attributes.
+     * @brief 上报设备状态并合并变化的结构化属性
+     *
+     * @param deviceId Unique identifier of the device
+     * @param status Status string
+     * @param details Changed attributes, an empty value removes one
+     */
+    void reportStatus(const std::string& deviceId, const std::string& status, const StatusDetails& details) override;
+
+    /**
+     * @brief Report the status of many devices at once.
+     * @brief 批量上报设备状态
+     *
+     * @param updates Status updates, payloads are moved into the cold data
+     * @return Indexes of updates whose device is not registered
+     */
+    auto reportStatusBatch(std::vector<DeviceStatusUpdate>& updates) -> std::vector<uint32_t> override;
+
+    /**
+     * @brief Check if the device is currently online.
+     * @brief 查询设备是否处于在线状态
+     *
+     * @param deviceId Unique identifier of the device
+     * @return true if device is online, false otherwise
+     */
+    auto isDeviceOnline(const std::string& deviceId) -> bool override;
+
+    /**
+     * @brief Get detailed information about the device.
+     * @brief 获取设备的详细信息
+     *
+     * @param deviceId Unique identifier of the device
+     * @param outInfo Output parameter to store device info
+     * @return Whether retrieval was successful
+     */
+    auto getDeviceInfo(const std::string& deviceId, DeviceInfo& outInfo) -> bool override;
+
+    /**
+     * @brief List devices matching a query, one page at a time.
+     * @brief 分页列出匹配查询条件的设备
+     *
+     * Status and heartbeat-age filters are evaluated on whole blocks of the columns without any lock; the cursor
+     * is the column index to resume from.
+     * 状态与心跳时长条件在列上按块求值，不加任何锁；游标是继续扫描的列下标。
+     *
+     * @param query Filters, cursor and page size
+     * @param outPage Output page
+     * @return false if the cursor is malformed or beyond the registered devices
+     */
+    auto listDevices(const DeviceQuery& query, DevicePage& outPage) -> bool override;
+
+    /**
+     * @brief Visit every registered device through a transient slot.
+     * @brief 通过临时构造的槽位遍历所有已注册设备
+     *
+     * @param visitor Visitor invoked once per device, outside any lock
+     */
+    void forEachDevice(const std::function<void(const DeviceSlot&)>& visitor) override;
+
+private:
+    /// @brief Devices per column chunk (as a power of two) and chunks the columns can hold
+    /// @brief 每个列块的设备数（以 2 的幂表示）与列可容纳的块数
+    static constexpr uint32_t kCHUNK_BITS = 14;
+    static constexpr uint32_t kCHUNK_SIZE = 1u << kCHUNK_BITS;
+    static constexpr uint32_t kMAX_CHUNKS = 1u << 14;
+    static constexpr uint32_t kCAPACITY = kCHUNK_SIZE * kMAX_CHUNKS;
+
+    /// @brief Mutex stripes guarding the cold data of a chunk
+    /// @brief 每个列块中保护冷数据的互斥锁条带数
+    static constexpr uint32_t kCOLD_STRIPES = 64;
+
+    /// @brief Status byte of a column entry whose device is not registered yet
+    /// @brief 尚未完成注册的列位置的状态字节
+    static constexpr uint8_t kEMPTY = 0xFF;
+
+    /// @brief Maximum devices per listing page
+    /// @brief 列表每页设备数上限
+    static constexpr size_t kMAX_PAGE_SIZE = 1000;
+
+    /**
+     * @brief Cold data of one device, allocated on its first status report.
+     * @brief 单个设备的冷数据，首次上报状态时分配
+     */
+    struct ColdData {
+        std::string lastStatusReport; // 最近一次上报的状态信息 / Last status report
+        DeviceAttributes attributes;  // 合并后的结构化状态属性 / Merged status attributes
+    };
+
+    /**
+     * @brief One fixed-size chunk of every column.
+     * @brief 所有列中固定大小的一块
+     *
+     * Hot columns are cache-line aligned so every scan block starts on a line boundary. Chunks are allocated
+     * on demand and never move, so a handle stays a stable (chunk, offset) pair.
+     * 热列按缓存行对齐，每个扫描块都从行首开始；列块按需分配且从不移动，因此句柄始终对应固定的（块，偏移）。
+     */
+    struct Chunk {
+        Chunk() {
+            status.fill(kEMPTY);
+            heartbeat.fill(0);
+        }
+
+        alignas(64) std::array<int64_t, kCHUNK_SIZE> heartbeat;  // 最近一次心跳（steady_clock 计数）/ Last heartbeat ticks
+        alignas(64) std::array<uint8_t, kCHUNK_SIZE> status;     // DeviceStatus 或 kEMPTY / DeviceStatus or kEMPTY
+        std::array<std::string, kCHUNK_SIZE> ids;                // 设备唯一标识符 / Device IDs
+        std::array<std::unique_ptr<ColdData>, kCHUNK_SIZE> cold; // 冷数据，未上报过时为空 / Cold data, empty until reported
+        std::array<std::mutex, kCOLD_STRIPES> coldMutex;         // 按下标条带保护冷数据 / Cold data guards, striped by index
+    };
+
+    /**
+     * @brief Column position of a device.
+     * @brief 设备在列中的位置
+     */
+    struct Cell {
+        Chunk* chunk;    // 所在列块 / Chunk holding the device
+        uint32_t offset; // 块内偏移 / Offset within the chunk
+        uint32_t index;  // 列下标，即设备句柄 / Column index, i.e. the device handle
+    };
+
+    /**
+     * @brief Position of a handle, empty if the handle is unknown or its device not fully registered.
+     * @brief 句柄对应的位置，句柄未知或设备尚未完成注册时为空
+     *
+     * @param handle Device handle
+     */
+    auto cellOf(DeviceHandle handle) const -> std::optional<Cell>;
+
+    /**
+     * @brief Position of a device ID, empty if the device is not registered.
+     * @brief 设备 ID 对应的位置，设备未注册时为空
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    auto cellOf(const std::string& deviceId) const -> std::optional<Cell>;
+
+    /**
+     * @brief Chunk holding a column index, allocating it on first use.
+     * @brief 列下标所在的块，首次使用时分配
+     *
+     * @param index Column index
+     */
+    auto chunkFor(uint32_t index) -> Chunk&;
+
+    /**
+     * @brief Number of column entries a scan must cover.
+     * @brief 扫描需要覆盖的列长度
+     */
+    auto scanBound() const -> uint32_t;
+
+    /**
+     * @brief Store a heartbeat and emit an online event on an offline→online transition.
+     * @brief 写入心跳，离线→在线时发出上线事件
+     *
+     * @param cell Column position of the device
+     */
+    void touch(const Cell& cell);
+
+    /**
+     * @brief Store a report in the cold data, refresh the heartbeat and emit the resulting events.
+     * @brief 将上报写入冷数据、刷新心跳并发出相应事件
+     *
+     * @param cell Column position of the device
+     * @param status Status report, moved into the cold data
+     * @param details Changed attributes
+     */
+    void applyStatus(const Cell& cell, std::string&& status, const StatusDetails& details);
+
+    /**
+     * @brief Whether the cold data of a device satisfies every attribute filter of a query.
+     * @brief 设备冷数据中的属性是否满足查询中的全部属性条件
+     *
+     * @param cell Column position of the device
+     * @param filters Filters with their resolved attribute keys
+     */
+    static auto matchesAttributes(const Cell& cell,
+                                  const std::vector<std::pair<AttributeKey, const AttributeFilter*>>& filters) -> bool;
+
+    /**
+     * @brief Visit the column blocks from an index up to the registered devices.
+     * @brief 从给定下标开始遍历各列的块，直到已注册设备的末尾
+     *
+     * @param from Column index to start from, rounded down to its block
+     * @param visitor Called with (chunk, offset in chunk, column index of the block); returns false to stop
+     */
+    template <typename Visitor>
+    void forEachBlock(uint32_t from, Visitor&& visitor) const;
+
+    /**
+     * @brief Build the device info of a column position.
+     * @brief 生成列位置对应的设备信息
+     *
+     * @param cell Column position of the device
+     * @param now Current time point, used to adjust the status for the heartbeat timeout
+     */
+    auto infoOf(const Cell& cell, DeviceSlot::Clock::time_point now) const -> DeviceInfo;
+
+    /**
+     * @brief Mask of the devices of one block whose effective status equals a value.
+     * @brief 块内按心跳超时折算后状态等于给定值的设备掩码
+     *
+     * @param chunk Column chunk
+     * @param offset Offset of the block within the chunk
+     * @param status Status compared against
+     * @param staleBound Heartbeats older than this bound count as timed out
+     */
+    static auto statusMask(const Chunk& chunk, uint32_t offset, DeviceStatus status, int64_t staleBound) -> uint64_t;
+
+    /**
+     * @brief Emit an event for a device transition to the installed listener.
+     * @brief 向监听器发出设备状态变化事件
+     *
+     * @param type Event type
+     * @param cell Column position of the device
+     * @param report New status report, only carried by StatusChanged events
+     */
+    void emitEvent(DeviceEvent::Type type, const Cell& cell, std::string report = {});
+
+    /**
+     * @brief Start the expiry sweeper thread if enabled and not running.
+     * @brief 启动超时扫描线程（已启用且尚未运行时）
+     */
+    void startSweeper();
+
+    /**
+     * @brief Stop the expiry sweeper thread.
+     * @brief 停止超时扫描线程
+     */
+    void stopSweeper();
+
+    /**
+     * @brief Scan the columns and mark every online device past its timeout offline.
+     * @brief 扫描各列，将超过心跳超时的在线设备标记为离线
+     *
+     * @param now Current time point
+     */
+    void sweep(DeviceSlot::Clock::time_point now);
+
+private:
+    /// @brief Log tag used for debugging and logging
+    /// @brief 用于日志打印的标签
+    static constexpr const char* kTAG = "ColumnarDeviceManager";
+
+    /// @brief Default number of shards of the ID index
+    /// @brief 设备 ID 索引的默认分片数量
+    static constexpr int SHARD_COUNT = 32;
+
+    /// @brief Tuning options: shard count, heartbeat timeout and expiry tick
+    /// @brief 调优参数：分片数量、心跳超时与超时扫描粒度
+    DeviceManagerOptions mOptions;
+
+    /// @brief Sharded map from device ID to column index
+    /// @brief 设备 ID 到列下标的分片哈希表
+    IOT_NS::ShardedMap<std::string, uint32_t, SHARD_COUNT> mIndex;
+
+    /// @brief Chunk directory read lock-free, chunks allocated on demand and never moved
+    /// @brief 无锁读取的列块目录，列块按需分配且从不移动
+    std::unique_ptr<std::atomic<Chunk*>[]> mChunks;
+
+    /// @brief Owner of the allocated chunks, guarded by mChunkMutex
+    /// @brief 已分配列块的所有者，由 mChunkMutex 保护
+    std::vector<std::unique_ptr<Chunk>> mChunkStore;
+
+    /// @brief Mutex guarding chunk allocation
+    /// @brief 保护列块分配的互斥锁
+    std::mutex mChunkMutex;
+
+    /// @brief Next column index to assign
+    /// @brief 下一个待分配的列下标
+    std::atomic<uint32_t> mNextIndex { 0 };
+
+    /// @brief Background thread scanning for expired devices, started with the first registration
+    /// @brief 扫描超时设备的后台线程，在首次注册设备时启动
+    std::thread mSweeper;
+
+    /// @brief Whether the sweeper should keep running
+    /// @brief 超时扫描线程运行标志
+    std::atomic<bool> mSweeping { false };
+
+    /// @brief Mutex and condition used to wake the sweeper on shutdown
+    /// @brief 用于在关闭时唤醒扫描线程的互斥锁与条件变量
+    std::mutex mSweeperMutex;
+    std::condition_variable mSweeperWake;
+
+    /// @brief Listener receiving device transition events (only touched on transitions)
+    /// @brief 设备状态变化事件监听器（仅在状态变化时访问）
+    DeviceEventListener mListener;
+
+    /// @brief Mutex guarding the event listener
+    /// @brief 保护事件监听器的互斥锁
+    std::mutex mListenerMutex;
+
+    /// @brief Whether changed status reports emit events, read lock-free on the status report path
+    /// @brief 内容变化的状态上报是否发出事件，状态上报路径上无锁读取
+    std::atomic<bool> mStatusEvents { false };
+};
+
+IOT_DEVICE_NS_END
@@ -0,0 +1,119 @@
+/**
+ * @brief ColumnScan 向量化扫描内核的实现
+ * @brief Implementation of the ColumnScan vectorized kernels.
+ *
+ * AVX2 内核通过函数级 target 属性编译，无需对整个工程开启 -mavx2；启动时按 CPU 能力选定一次函数指针。
+ * AVX2 kernels are compiled through function-level target attributes, so the project needs no -mavx2; the
+ * function pointers are picked once at startup from the CPU features.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-06
+ */
+
+#include "ColumnScan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define IOT_COLUMN_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+IOT_DEVICE_NS_BEGIN
+
+namespace {
+
+auto equalMaskScalar(const uint8_t* bytes, uint8_t value) -> uint64_t {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ColumnScan::kBLOCK; ++i) {
+        mask |= static_cast<uint64_t>(bytes[i] == value) << i;
+    }
+    return mask;
+}
+
+auto lessMaskScalar(const int64_t* values, int64_t bound) -> uint64_t {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ColumnScan::kBLOCK; ++i) {
+        mask |= static_cast<uint64_t>(values[i] < bound) << i;
+    }
+    return mask;
+}
+
+#ifdef IOT_COLUMN_SCAN_X86
+
+auto equalMaskSse2(const uint8_t* bytes, uint8_t value) -> uint64_t {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ColumnScan::kBLOCK; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        auto bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2"))) auto equalMaskAvx2(const uint8_t* bytes, uint8_t value) -> uint64_t {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(value));
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + 32));
+    auto lowBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle)));
+    auto highBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle)));
+    return static_cast<uint64_t>(lowBits) | (static_cast<uint64_t>(highBits) << 32);
+}
+
+__attribute__((target("avx2"))) auto lessMaskAvx2(const int64_t* values, int64_t bound) -> uint64_t {
+    const __m256i limit = _mm256_set1_epi64x(bound);
+    uint64_t mask = 0;
+    for (size_t i = 0; i < ColumnScan::kBLOCK; i += 4) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        // limit > value 即 value < limit，每个 64 位元素贡献一位
+        auto bits = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(limit, chunk))));
+        mask |= static_cast<uint64_t>(bits) << i;
+    }
+    return mask;
+}
+
+#endif
+
+/**
+ * @brief 启动时选定的内核
+ */
+struct Kernels {
+    uint64_t (*equalMask)(const uint8_t*, uint8_t) = equalMaskScalar;
+    uint64_t (*lessMask)(const int64_t*, int64_t) = lessMaskScalar;
+    const char* isa = "scalar";
+
+    Kernels() {
+#ifdef IOT_COLUMN_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            equalMask = equalMaskAvx2;
+            lessMask = lessMaskAvx2;
+            isa = "avx2";
+        } else {
+            equalMask = equalMaskSse2;
+            isa = "sse2";
+        }
+#endif
+    }
+};
+
+auto kernels() -> const Kernels& {
+    static const Kernels selected;
+    return selected;
+}
+
+} // namespace
+
+auto ColumnScan::equalMask(const uint8_t* bytes, uint8_t value) -> uint64_t {
+    return kernels().equalMask(bytes, value);
+}
+
+auto ColumnScan::lessMask(const int64_t* values, int64_t bound) -> uint64_t {
+    return kernels().lessMask(values, bound);
+}
+
+auto ColumnScan::isa() -> const char* {
+    return kernels().isa;
+}
+
+IOT_DEVICE_NS_END
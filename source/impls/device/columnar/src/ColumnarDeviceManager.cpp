@@ -0,0 +1,870 @@
+/**
+ * @brief Implementation of ColumnarDeviceManager class
+ * @brief ColumnarDeviceManager 类的实现文件
+ *
+ * Writers touch one element of a column through std::atomic_ref; scans read whole blocks with the ColumnScan
+ * kernels and re-check each matching element with an acquire load before reading its ID or cold data.
+ * 写入方通过 std::atomic_ref 修改列中的单个元素；扫描用 ColumnScan 内核按块读取，对每个匹配的元素
+ * 先做一次 acquire 读取确认，再读取其 ID 与冷数据。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-06
+ */
+
+#include "ColumnarDeviceManager.h"
+#include "ColumnScan.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief 注册列式设备管理器插件（Register the columnar device manager plugin）
+ *
+ * 插件名称由宏 `DEVICE_MANAGER_COLUMNAR` 定义，通过路由参数 device-manager 选用。
+ */
+static PluginRegistrar<IDeviceManager> registerColumnarDeviceManager(
+    DEVICE_MANAGER_COLUMNAR,
+    []() { return std::make_shared<ColumnarDeviceManager>(); });
+
+static_assert(sizeof(DeviceSlot::Clock::rep) == sizeof(int64_t), "heartbeat column stores steady_clock ticks");
+
+namespace {
+
+/**
+ * @brief 状态字节 / Status byte of a device status
+ */
+constexpr auto statusByte(DeviceStatus status) -> uint8_t {
+    return static_cast<uint8_t>(status);
+}
+
+/**
+ * @brief 当前时间的 steady_clock 计数 / Current steady_clock ticks
+ */
+auto ticksOf(DeviceSlot::Clock::time_point time) -> int64_t {
+    return time.time_since_epoch().count();
+}
+
+/**
+ * @brief 时长对应的 steady_clock 计数 / steady_clock ticks of a duration
+ */
+auto ticksOf(std::chrono::milliseconds duration) -> int64_t {
+    return std::chrono::duration_cast<DeviceSlot::Clock::duration>(duration).count();
+}
+
+} // namespace
+
+/**
+ * @brief Visit the column blocks from an index
+ * @brief 从给定下标开始遍历各列的块
+ *
+ * 下标已分配但列块尚在分配中的块直接跳过，其中的设备都还未完成注册。
+ * Blocks whose chunk is still being allocated are skipped; none of their devices finished registering yet.
+ *
+ * @param from 起始列下标，向下取整到所在块
+ * @param visitor 访问函数，返回 false 时停止
+ */
+template <typename Visitor>
+void ColumnarDeviceManager::forEachBlock(uint32_t from, Visitor&& visitor) const {
+    static_assert(kCHUNK_SIZE % ColumnScan::kBLOCK == 0, "scan blocks must not straddle column chunks");
+    uint32_t bound = scanBound();
+    for (uint32_t base = from & ~static_cast<uint32_t>(ColumnScan::kBLOCK - 1); base < bound;
+         base += ColumnScan::kBLOCK) {
+        auto* chunk = mChunks[base >> kCHUNK_BITS].load(std::memory_order_acquire);
+        if (chunk && !visitor(*chunk, base & (kCHUNK_SIZE - 1), base)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Constructor
+ * @brief 构造函数
+ */
+ColumnarDeviceManager::ColumnarDeviceManager()
+    : mChunks(std::make_unique<std::atomic<Chunk*>[]>(kMAX_CHUNKS)) {
+    std::cout << "[ColumnarDeviceManager] Constructor, scan isa " << ColumnScan::isa() << "\n";
+}
+
+/**
+ * @brief Destructor
+ * @brief 析构函数
+ */
+ColumnarDeviceManager::~ColumnarDeviceManager() {
+    stopSweeper();
+    std::cout << "[ColumnarDeviceManager] Destructor\n";
+}
+
+/**
+ * @brief Initialize the manager
+ * @brief 初始化管理器
+ */
+void ColumnarDeviceManager::init() {
+    std::cout << "[ColumnarDeviceManager] init()\n";
+}
+
+/**
+ * @brief Shutdown and cleanup
+ * @brief 关闭并清理资源
+ */
+void ColumnarDeviceManager::shutdown() {
+    std::cout << "[ColumnarDeviceManager] shutdown()\n";
+    stopSweeper();
+}
+
+/**
+ * @brief Apply runtime tuning options
+ * @brief 应用运行时调优参数
+ *
+ * 必须在注册设备之前调用，已有的列会被丢弃；设备类别与单设备超时不受支持，所有设备使用 heartbeatTimeout。
+ * Must run before any registration; existing columns are dropped. Device classes and per-device timeouts are
+ * not supported, every device uses heartbeatTimeout.
+ *
+ * @param options 分片数、心跳超时与超时扫描粒度
+ */
+void ColumnarDeviceManager::configure(const DeviceManagerOptions& options) {
+    stopSweeper();
+    mOptions = options;
+    mIndex = IOT_NS::ShardedMap<std::string, uint32_t, SHARD_COUNT>(options.shardCount);
+    mChunks = std::make_unique<std::atomic<Chunk*>[]>(kMAX_CHUNKS);
+    mChunkStore.clear();
+    mNextIndex.store(0, std::memory_order_relaxed);
+    if (!options.heartbeatClasses.empty()) {
+        std::cerr << kTAG << ": heartbeat classes are not supported and ignored" << std::endl;
+    }
+}
+
+/**
+ * @brief Register a new device with given ID
+ * @brief 根据设备 ID 注册新设备
+ *
+ * @param deviceId 设备唯一标识符
+ * @return true 注册成功
+ * @return false 设备已存在或列已写满
+ */
+auto ColumnarDeviceManager::registerDevice(const std::string& deviceId) -> bool {
+    DeviceHandle handle;
+    return registerDevice(deviceId, handle);
+}
+
+/**
+ * @brief Register a device and return its handle
+ * @brief 注册设备并返回其句柄
+ *
+ * 列下标在 ID 索引的分片锁内分配并写入列，状态字节最后以 release 写入，作为该位置已可读的标志。
+ * 列写满后不再接受新设备。
+ * The column index is assigned and filled under the shard lock of the ID index, and the status byte is stored
+ * last with release semantics, marking the position as readable. Once the columns are full no more devices
+ * are accepted.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param outHandle 输出的句柄，设备已存在时为其原有句柄
+ * @return true 新注册；false 设备已存在或列已写满
+ */
+auto ColumnarDeviceManager::registerDevice(const std::string& deviceId, DeviceHandle& outHandle) -> bool {
+    bool created = false;
+    uint32_t index = mIndex.getOrInsert(deviceId, [this, &deviceId, &created]() -> uint32_t {
+        created = true;
+        if (mNextIndex.load(std::memory_order_relaxed) >= kCAPACITY) {
+            return kCAPACITY;
+        }
+        uint32_t fresh = mNextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (fresh >= kCAPACITY) {
+            return kCAPACITY;
+        }
+        auto& chunk = chunkFor(fresh);
+        uint32_t offset = fresh & (kCHUNK_SIZE - 1);
+        chunk.ids[offset] = deviceId;
+        std::atomic_ref<int64_t>(chunk.heartbeat[offset]).store(ticksOf(DeviceSlot::Clock::now()),
+                                                                std::memory_order_relaxed);
+        std::atomic_ref<uint8_t>(chunk.status[offset]).store(statusByte(DeviceStatus::ONLINE),
+                                                             std::memory_order_release);
+        return fresh;
+    });
+
+    if (index >= kCAPACITY) {
+        if (created) {
+            mIndex.erase(deviceId);
+            std::cerr << kTAG << ": columns full, device rejected: " << deviceId << std::endl;
+        }
+        outHandle = kINVALID_DEVICE_HANDLE;
+        return false;
+    }
+    outHandle = DeviceHandle { index };
+    if (!created) {
+        return false;
+    }
+
+    startSweeper();
+    std::cout << "[ColumnarDeviceManager] Device registered: " << deviceId << std::endl;
+    emitEvent(DeviceEvent::Type::Online,
+              Cell { mChunks[index >> kCHUNK_BITS].load(std::memory_order_acquire), index & (kCHUNK_SIZE - 1),
+                     index });
+    return true;
+}
+
+/**
+ * @brief Refresh heartbeat time of a device
+ * @brief 刷新设备的心跳时间
+ *
+ * @param deviceId 设备唯一标识符
+ */
+void ColumnarDeviceManager::refreshDeviceHeartbeat(const std::string& deviceId) {
+    if (auto cell = cellOf(deviceId)) {
+        touch(*cell);
+    }
+}
+
+/**
+ * @brief Registry slots are not supported
+ * @brief 不支持注册表槽位
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 始终为 nullptr
+ */
+auto ColumnarDeviceManager::acquireSlot(const std::string& deviceId) -> std::shared_ptr<DeviceSlot> {
+    (void)deviceId;
+    return nullptr;
+}
+
+/**
+ * @brief Heartbeat refresh for a slot carrying a device ID
+ * @brief 为携带设备 ID 的槽位刷新心跳
+ *
+ * @param slot 槽位，只使用其设备 ID
+ */
+void ColumnarDeviceManager::refreshDeviceHeartbeat(DeviceSlot& slot) {
+    refreshDeviceHeartbeat(slot.deviceId);
+}
+
+/**
+ * @brief Resolve the handle of a registered device
+ * @brief 解析已注册设备的句柄
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 设备句柄，未注册时为无效句柄
+ */
+auto ColumnarDeviceManager::acquireHandle(const std::string& deviceId) -> DeviceHandle {
+    auto cell = cellOf(deviceId);
+    return cell ? DeviceHandle { cell->index } : kINVALID_DEVICE_HANDLE;
+}
+
+/**
+ * @brief Lock-free heartbeat refresh by handle
+ * @brief 按句柄无锁刷新心跳
+ *
+ * @param handle 设备句柄
+ */
+void ColumnarDeviceManager::refreshDeviceHeartbeat(DeviceHandle handle) {
+    if (auto cell = cellOf(handle)) {
+        touch(*cell);
+    }
+}
+
+/**
+ * @brief Report device status by handle
+ * @brief 按句柄上报设备状态
+ *
+ * @param handle 设备句柄
+ * @param status 状态信息
+ * @param details 变化的属性，空值表示删除
+ * @return true 上报成功；false 句柄无效
+ */
+auto ColumnarDeviceManager::reportStatus(DeviceHandle handle, const std::string& status,
+                                         const StatusDetails& details) -> bool {
+    auto cell = cellOf(handle);
+    if (!cell) {
+        return false;
+    }
+    applyStatus(*cell, std::string(status), details);
+    std::cout << "[ColumnarDeviceManager] Status reported for device: " << cell->chunk->ids[cell->offset]
+              << std::endl;
+    return true;
+}
+
+/**
+ * @brief Get device info by handle
+ * @brief 按句柄获取设备信息
+ *
+ * @param handle 设备句柄
+ * @param outInfo 输出的设备信息结构体
+ * @return true 获取成功；false 句柄无效
+ */
+auto ColumnarDeviceManager::getDeviceInfo(DeviceHandle handle, DeviceInfo& outInfo) -> bool {
+    auto cell = cellOf(handle);
+    if (!cell) {
+        return false;
+    }
+    outInfo = infoOf(*cell, DeviceSlot::Clock::now());
+    return true;
+}
+
+/**
+ * @brief Mark a device as offline
+ * @brief 将设备标记为离线状态
+ *
+ * @param deviceId 设备唯一标识符
+ */
+void ColumnarDeviceManager::markDeviceOffline(const std::string& deviceId) {
+    auto cell = cellOf(deviceId);
+    if (!cell) {
+        return;
+    }
+    auto previous = std::atomic_ref<uint8_t>(cell->chunk->status[cell->offset])
+                        .exchange(statusByte(DeviceStatus::OFFLINE), std::memory_order_acq_rel);
+    std::cout << "[ColumnarDeviceManager] Device marked offline: " << deviceId << std::endl;
+    if (previous != statusByte(DeviceStatus::OFFLINE)) {
+        emitEvent(DeviceEvent::Type::Offline, *cell);
+    }
+}
+
+/**
+ * @brief Report status for a device
+ * @brief 上报设备状态信息
+ *
+ * @param deviceId 设备唯一标识符
+ * @param status 状态字符串（例如 JSON/XML）
+ */
+void ColumnarDeviceManager::reportStatus(const std::string& deviceId, const std::string& status) {
+    reportStatus(deviceId, status, {});
+}
+
+/**
+ * @brief Report device status and merge changed structured attributes
+ * @brief 上报设备状态并合并变化的结构化属性
+ *
+ * @param deviceId 设备唯一标识符
+ * @param status 状态信息
+ * @param details 变化的属性，空值表示删除
+ */
+void ColumnarDeviceManager::reportStatus(const std::string& deviceId, const std::string& status,
+                                         const StatusDetails& details) {
+    if (auto cell = cellOf(deviceId)) {
+        applyStatus(*cell, std::string(status), details);
+        std::cout << "[ColumnarDeviceManager] Status reported for device: " << deviceId << std::endl;
+    }
+}
+
+/**
+ * @brief Report status for many devices at once
+ * @brief 批量上报设备状态信息
+ *
+ * @param updates 状态上报批次
+ * @return 设备未注册的条目下标
+ */
+auto ColumnarDeviceManager::reportStatusBatch(std::vector<DeviceStatusUpdate>& updates) -> std::vector<uint32_t> {
+    std::vector<uint32_t> unknown;
+    for (uint32_t i = 0; i < updates.size(); ++i) {
+        auto cell = cellOf(updates[i].deviceId);
+        if (!cell) {
+            unknown.push_back(i);
+            continue;
+        }
+        applyStatus(*cell, std::move(updates[i].status), updates[i].details);
+    }
+    std::cout << "[ColumnarDeviceManager] Status batch reported: " << updates.size() - unknown.size() << "/"
+              << updates.size() << std::endl;
+    return unknown;
+}
+
+/**
+ * @brief Check if a device is online based on heartbeat timeout
+ * @brief 根据心跳超时时间判断设备是否在线
+ *
+ * @param deviceId 设备唯一标识符
+ * @return true 设备在线
+ * @return false 设备离线或不存在
+ */
+auto ColumnarDeviceManager::isDeviceOnline(const std::string& deviceId) -> bool {
+    auto cell = cellOf(deviceId);
+    if (!cell) {
+        return false;
+    }
+    std::atomic_ref<uint8_t> status(cell->chunk->status[cell->offset]);
+    auto heartbeat = std::atomic_ref<int64_t>(cell->chunk->heartbeat[cell->offset]).load(std::memory_order_relaxed);
+    if (ticksOf(DeviceSlot::Clock::now()) - heartbeat > ticksOf(mOptions.heartbeatTimeout)) {
+        // 仅由在线切换为离线的调用方发出离线事件
+        uint8_t expected = statusByte(DeviceStatus::ONLINE);
+        if (status.compare_exchange_strong(expected, statusByte(DeviceStatus::OFFLINE), std::memory_order_acq_rel)) {
+            emitEvent(DeviceEvent::Type::Offline, *cell);
+        }
+        return false;
+    }
+    return status.load(std::memory_order_acquire) == statusByte(DeviceStatus::ONLINE);
+}
+
+/**
+ * @brief Get full device info
+ * @brief 获取完整的设备信息
+ *
+ * @param deviceId 设备唯一标识符
+ * @param outInfo 输出的设备信息结构体
+ * @return true 获取成功
+ * @return false 设备不存在
+ */
+auto ColumnarDeviceManager::getDeviceInfo(const std::string& deviceId, DeviceInfo& outInfo) -> bool {
+    auto cell = cellOf(deviceId);
+    if (!cell) {
+        return false;
+    }
+    outInfo = infoOf(*cell, DeviceSlot::Clock::now());
+    return true;
+}
+
+/**
+ * @brief List devices matching a query, one page at a time
+ * @brief 分页列出匹配查询条件的设备
+ *
+ * 按列下标顺序扫描，游标即下一个列下标。状态与心跳时长条件合成为每块一个 64 位掩码，
+ * 计数模式且没有属性条件时只对掩码做 popcount，不访问任何设备 ID；其余情况只对掩码中的设备读取冷数据。
+ * Devices are walked in column order and the cursor is the next column index. Status and heartbeat-age
+ * filters fold into one 64-bit mask per block; a count without attribute filters only popcounts the masks and
+ * never touches a device ID, otherwise only the devices in the mask have their cold data read. Owners are not
+ * recorded, so a query by owner always yields an empty page and every device is visible to any viewer.
+ *
+ * @param query 过滤条件、游标与每页数量
+ * @param outPage 输出的一页结果
+ * @return true 成功；false 游标格式错误或超出范围
+ */
+auto ColumnarDeviceManager::listDevices(const DeviceQuery& query, DevicePage& outPage) -> bool {
+    outPage = {};
+    if (!query.owner.empty()) {
+        return true; // 不记录所有者，没有设备能匹配
+    }
+    uint32_t start = 0;
+    if (!query.cursor.empty()) {
+        const char* end = query.cursor.data() + query.cursor.size();
+        auto [last, ec] = std::from_chars(query.cursor.data(), end, start);
+        if (ec != std::errc {} || last != end || start > scanBound()) {
+            return false;
+        }
+    }
+
+    // 属性名只解析一次；从未上报过的属性名不可能匹配任何设备
+    std::vector<std::pair<AttributeKey, const AttributeFilter*>> attributeFilters;
+    attributeFilters.reserve(query.attributes.size());
+    for (const auto& filter : query.attributes) {
+        auto key = AttributeKeys::instance().find(filter.key);
+        if (!key) {
+            return true;
+        }
+        attributeFilters.emplace_back(*key, &filter);
+    }
+
+    size_t limit = std::clamp<size_t>(query.limit, 1, kMAX_PAGE_SIZE);
+    auto now = DeviceSlot::Clock::now();
+    int64_t nowTicks = ticksOf(now);
+    int64_t staleBound = nowTicks - ticksOf(mOptions.heartbeatTimeout);
+    // 心跳时长按毫秒取整比较：age >= min 即心跳早于 now - min + 1；age <= max 即心跳不早于 now - (max + 1ms) + 1
+    int64_t minAgeBound = nowTicks - ticksOf(query.minHeartbeatAge) + 1;
+    int64_t maxAgeBound = nowTicks - ticksOf(query.maxHeartbeatAge + std::chrono::milliseconds(1)) + 1;
+
+    forEachBlock(start, [&](Chunk& chunk, uint32_t offset, uint32_t base) {
+        uint64_t mask = query.status ? statusMask(chunk, offset, *query.status, staleBound)
+                                     : ~ColumnScan::equalMask(&chunk.status[offset], kEMPTY);
+        if (base < start) {
+            mask &= ~uint64_t { 0 } << (start - base);
+        }
+        if (mask && query.minHeartbeatAge.count() > 0) {
+            mask &= ColumnScan::lessMask(&chunk.heartbeat[offset], minAgeBound);
+        }
+        if (mask && query.maxHeartbeatAge.count() > 0) {
+            mask &= ~ColumnScan::lessMask(&chunk.heartbeat[offset], maxAgeBound);
+        }
+        if (query.countOnly && attributeFilters.empty()) {
+            outPage.count += static_cast<uint64_t>(std::popcount(mask));
+            return true;
+        }
+
+        for (; mask != 0; mask &= mask - 1) {
+            auto bit = static_cast<uint32_t>(std::countr_zero(mask));
+            Cell cell { &chunk, offset + bit, base + bit };
+            if (std::atomic_ref<uint8_t>(chunk.status[cell.offset]).load(std::memory_order_acquire) == kEMPTY ||
+                (!attributeFilters.empty() && !matchesAttributes(cell, attributeFilters))) {
+                continue;
+            }
+            if (query.countOnly) {
+                ++outPage.count;
+                continue;
+            }
+            outPage.devices.push_back(DeviceRecord { chunk.ids[cell.offset], infoOf(cell, now) });
+            if (outPage.devices.size() == limit) {
+                outPage.nextCursor = std::to_string(cell.index + 1);
+                return false;
+            }
+        }
+        return true;
+    });
+    return true;
+}
+
+/**
+ * @brief Visit every registered device
+ * @brief 遍历所有已注册设备
+ *
+ * 每个设备构造一个临时槽位并复制其状态，访问函数在任何锁之外执行。
+ * A transient slot is built and filled for every device, and the visitor runs outside any lock.
+ *
+ * @param visitor 访问函数
+ */
+void ColumnarDeviceManager::forEachDevice(const std::function<void(const DeviceSlot&)>& visitor) {
+    forEachBlock(0, [this, &visitor](Chunk& chunk, uint32_t offset, uint32_t base) {
+        for (uint64_t mask = ~ColumnScan::equalMask(&chunk.status[offset], kEMPTY); mask != 0; mask &= mask - 1) {
+            auto bit = static_cast<uint32_t>(std::countr_zero(mask));
+            Cell cell { &chunk, offset + bit, base + bit };
+            auto status = std::atomic_ref<uint8_t>(chunk.status[cell.offset]).load(std::memory_order_acquire);
+            if (status == kEMPTY) {
+                continue;
+            }
+            DeviceSlot slot(chunk.ids[cell.offset], DeviceHandle { cell.index });
+            auto info = infoOf(cell, DeviceSlot::Clock::now());
+            slot.status.store(static_cast<DeviceStatus>(status), std::memory_order_relaxed);
+            slot.lastHeartbeat.store(ticksOf(info.lastHeartbeat), std::memory_order_relaxed);
+            slot.lastStatusReport = std::move(info.lastStatusReport);
+            slot.attributes = std::move(info.attributes);
+            visitor(slot);
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief Install the device event listener
+ * @brief 设置设备事件监听器
+ *
+ * @param listener 事件监听器
+ */
+void ColumnarDeviceManager::setEventListener(DeviceEventListener listener) {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    mListener = std::move(listener);
+}
+
+/**
+ * @brief Enable or disable StatusChanged events
+ * @brief 开启或关闭状态内容变化事件
+ *
+ * @param enabled 内容变化的上报是否发出事件
+ */
+void ColumnarDeviceManager::setStatusEventsEnabled(bool enabled) {
+    mStatusEvents.store(enabled, std::memory_order_release);
+}
+
+/**
+ * @brief Position of a handle
+ * @brief 句柄对应的位置
+ *
+ * 不加锁：一次读列块目录，一次 acquire 读状态字节确认设备已完成注册。
+ * Lock-free: one load of the chunk directory and one acquire load of the status byte, confirming the device
+ * finished registering.
+ *
+ * @param handle 设备句柄
+ * @return 设备位置，句柄未知时为空
+ */
+auto ColumnarDeviceManager::cellOf(DeviceHandle handle) const -> std::optional<Cell> {
+    if (!isValid(handle) || toIndex(handle) >= scanBound()) {
+        return std::nullopt;
+    }
+    uint32_t index = toIndex(handle);
+    auto* chunk = mChunks[index >> kCHUNK_BITS].load(std::memory_order_acquire);
+    if (!chunk) {
+        return std::nullopt;
+    }
+    uint32_t offset = index & (kCHUNK_SIZE - 1);
+    if (std::atomic_ref<uint8_t>(chunk->status[offset]).load(std::memory_order_acquire) == kEMPTY) {
+        return std::nullopt;
+    }
+    return Cell { chunk, offset, index };
+}
+
+/**
+ * @brief Position of a device ID
+ * @brief 设备 ID 对应的位置
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 设备位置，设备未注册时为空
+ */
+auto ColumnarDeviceManager::cellOf(const std::string& deviceId) const -> std::optional<Cell> {
+    auto index = mIndex.get(deviceId);
+    if (!index) {
+        return std::nullopt;
+    }
+    return cellOf(DeviceHandle { *index });
+}
+
+/**
+ * @brief Chunk holding a column index
+ * @brief 列下标所在的块
+ *
+ * 只有每块的第一个设备需要加锁分配，其余只是一次 acquire 读取。
+ * Only the first device of each chunk takes the lock to allocate it; every other one is a single acquire load.
+ *
+ * @param index 列下标
+ * @return 列块
+ */
+auto ColumnarDeviceManager::chunkFor(uint32_t index) -> Chunk& {
+    auto& entry = mChunks[index >> kCHUNK_BITS];
+    auto* chunk = entry.load(std::memory_order_acquire);
+    if (!chunk) {
+        std::lock_guard<std::mutex> lock(mChunkMutex);
+        chunk = entry.load(std::memory_order_relaxed);
+        if (!chunk) {
+            mChunkStore.push_back(std::make_unique<Chunk>());
+            chunk = mChunkStore.back().get();
+            entry.store(chunk, std::memory_order_release);
+        }
+    }
+    return *chunk;
+}
+
+/**
+ * @brief Number of column entries a scan must cover
+ * @brief 扫描需要覆盖的列长度
+ *
+ * @return 已分配的列下标数，不超过列容量
+ */
+auto ColumnarDeviceManager::scanBound() const -> uint32_t {
+    return std::min(mNextIndex.load(std::memory_order_acquire), kCAPACITY);
+}
+
+/**
+ * @brief Store a heartbeat
+ * @brief 写入心跳
+ *
+ * 已在线时只有一次心跳写入与一次状态读取；仅在状态确实变化时才执行原子交换并发出上线事件。
+ * When already online this is one heartbeat store and one status load; only a real transition runs the
+ * atomic exchange and emits an online event.
+ *
+ * @param cell 设备位置
+ */
+void ColumnarDeviceManager::touch(const Cell& cell) {
+    std::atomic_ref<int64_t>(cell.chunk->heartbeat[cell.offset])
+        .store(ticksOf(DeviceSlot::Clock::now()), std::memory_order_relaxed);
+    std::atomic_ref<uint8_t> status(cell.chunk->status[cell.offset]);
+    if (status.load(std::memory_order_relaxed) == statusByte(DeviceStatus::ONLINE)) {
+        return;
+    }
+    if (status.exchange(statusByte(DeviceStatus::ONLINE), std::memory_order_acq_rel) !=
+        statusByte(DeviceStatus::ONLINE)) {
+        emitEvent(DeviceEvent::Type::Online, cell);
+    }
+}
+
+/**
+ * @brief Store a report, refresh the heartbeat and emit events
+ * @brief 写入上报、刷新心跳并发出事件
+ *
+ * 内容与已存储的上报相同时不产生事件；状态事件关闭时既不比较也不复制上报内容。
+ * An unchanged report produces no event; with status events disabled the report is neither compared nor copied.
+ *
+ * @param cell 设备位置
+ * @param status 状态上报，移入冷数据
+ * @param details 变化的属性
+ */
+void ColumnarDeviceManager::applyStatus(const Cell& cell, std::string&& status, const StatusDetails& details) {
+    auto updates = toAttributeUpdates(details);
+    bool watched = mStatusEvents.load(std::memory_order_acquire);
+    std::optional<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(cell.chunk->coldMutex[cell.offset % kCOLD_STRIPES]);
+        auto& cold = cell.chunk->cold[cell.offset];
+        if (!cold) {
+            cold = std::make_unique<ColdData>();
+        }
+        bool attributesChanged = !updates.empty() && cold->attributes.apply(updates);
+        if (!watched) {
+            cold->lastStatusReport = std::move(status);
+        } else if (cold->lastStatusReport != status || attributesChanged) {
+            cold->lastStatusReport = status;
+            changed = std::move(status);
+        }
+    }
+    touch(cell);
+    if (changed) {
+        emitEvent(DeviceEvent::Type::StatusChanged, cell, std::move(*changed));
+    }
+}
+
+/**
+ * @brief Build the device info of a column position
+ * @brief 生成列位置对应的设备信息
+ *
+ * @param cell 设备位置
+ * @param now 当前时间点
+ * @return 设备信息，状态已按心跳超时折算
+ */
+auto ColumnarDeviceManager::infoOf(const Cell& cell, DeviceSlot::Clock::time_point now) const -> DeviceInfo {
+    DeviceInfo info;
+    auto status = static_cast<DeviceStatus>(
+        std::atomic_ref<uint8_t>(cell.chunk->status[cell.offset]).load(std::memory_order_acquire));
+    auto heartbeat = std::atomic_ref<int64_t>(cell.chunk->heartbeat[cell.offset]).load(std::memory_order_relaxed);
+    info.lastHeartbeat = DeviceSlot::Clock::time_point(DeviceSlot::Clock::duration(heartbeat));
+    info.status = status == DeviceStatus::ONLINE && now - info.lastHeartbeat > mOptions.heartbeatTimeout
+                      ? DeviceStatus::OFFLINE
+                      : status;
+    std::lock_guard<std::mutex> lock(cell.chunk->coldMutex[cell.offset % kCOLD_STRIPES]);
+    if (const auto& cold = cell.chunk->cold[cell.offset]) {
+        info.lastStatusReport = cold->lastStatusReport;
+        info.attributes = cold->attributes;
+    }
+    return info;
+}
+
+/**
+ * @brief Whether the cold data of a device satisfies every attribute filter
+ * @brief 设备冷数据中的属性是否满足全部属性条件
+ *
+ * 没有冷数据、缺少该属性或属性为字符串时不匹配。
+ * A device without cold data, or with a missing or string-valued attribute, never matches.
+ *
+ * @param cell 设备位置
+ * @param filters 已解析出属性键的条件
+ * @return true 全部满足
+ */
+auto ColumnarDeviceManager::matchesAttributes(
+    const Cell& cell, const std::vector<std::pair<AttributeKey, const AttributeFilter*>>& filters) -> bool {
+    std::lock_guard<std::mutex> lock(cell.chunk->coldMutex[cell.offset % kCOLD_STRIPES]);
+    const auto& cold = cell.chunk->cold[cell.offset];
+    if (!cold) {
+        return false;
+    }
+    for (const auto& [key, filter] : filters) {
+        auto value = cold->attributes.number(key);
+        if (!value || !filter->matches(*value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Mask of the devices of one block whose effective status equals a value
+ * @brief 块内按心跳超时折算后状态等于给定值的设备掩码
+ *
+ * 在线且心跳超时的设备按离线计：查在线时从在线掩码中去掉超时设备，查离线时把它们并入离线掩码。
+ * An online device past its timeout counts as offline: it is removed from the online mask and added to the
+ * offline one.
+ *
+ * @param chunk 列块
+ * @param offset 块在列块内的偏移
+ * @param status 查询的状态
+ * @param staleBound 心跳早于该值视为超时
+ * @return 匹配掩码
+ */
+auto ColumnarDeviceManager::statusMask(const Chunk& chunk, uint32_t offset, DeviceStatus status, int64_t staleBound)
+    -> uint64_t {
+    const uint8_t* statuses = &chunk.status[offset];
+    switch (status) {
+    case DeviceStatus::ONLINE: {
+        uint64_t online = ColumnScan::equalMask(statuses, statusByte(DeviceStatus::ONLINE));
+        return online ? online & ~ColumnScan::lessMask(&chunk.heartbeat[offset], staleBound) : 0;
+    }
+    case DeviceStatus::OFFLINE: {
+        uint64_t online = ColumnScan::equalMask(statuses, statusByte(DeviceStatus::ONLINE));
+        uint64_t offline = ColumnScan::equalMask(statuses, statusByte(DeviceStatus::OFFLINE));
+        return online ? offline | (online & ColumnScan::lessMask(&chunk.heartbeat[offset], staleBound)) : offline;
+    }
+    default:
+        return ColumnScan::equalMask(statuses, statusByte(status));
+    }
+}
+
+/**
+ * @brief Start the expiry sweeper thread
+ * @brief 启动超时扫描线程
+ *
+ * 扫描粒度为 0 时不启动，设备只在被查询时按超时判定。
+ * Not started when the tick is 0; devices are then only judged against their timeout when queried.
+ */
+void ColumnarDeviceManager::startSweeper() {
+    if (mOptions.expiryTick.count() <= 0 || mSweeping.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mSweeperMutex);
+    if (mSweeping.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    mSweeper = std::thread([this]() {
+        std::unique_lock<std::mutex> wait(mSweeperMutex);
+        while (!mSweeperWake.wait_for(wait, mOptions.expiryTick, [this]() { return !mSweeping.load(); })) {
+            wait.unlock();
+            sweep(DeviceSlot::Clock::now());
+            wait.lock();
+        }
+    });
+}
+
+/**
+ * @brief Stop the expiry sweeper thread
+ * @brief 停止超时扫描线程
+ */
+void ColumnarDeviceManager::stopSweeper() {
+    {
+        std::lock_guard<std::mutex> lock(mSweeperMutex);
+        mSweeping.store(false, std::memory_order_release);
+    }
+    mSweeperWake.notify_all();
+    if (mSweeper.joinable()) {
+        mSweeper.join();
+    }
+}
+
+/**
+ * @brief Mark every online device past its timeout offline
+ * @brief 将超过心跳超时的在线设备标记为离线
+ *
+ * 没有时间轮：每次完整扫描状态列，只对含在线设备的块读取心跳列，开销约为每设备 9 字节的顺序读取。
+ * 命中的设备在比较交换前重新读取一次心跳，刚刚发来心跳的设备不会被误判离线。
+ * There is no timing wheel: every tick scans the whole status column and reads the heartbeat column only for
+ * blocks holding online devices, roughly 9 bytes of sequential reads per device. A hit re-reads its heartbeat
+ * before the compare-exchange, so a device that just sent a heartbeat is not expired.
+ *
+ * @param now 当前时间点
+ */
+void ColumnarDeviceManager::sweep(DeviceSlot::Clock::time_point now) {
+    int64_t staleBound = ticksOf(now) - ticksOf(mOptions.heartbeatTimeout);
+    forEachBlock(0, [this, staleBound](Chunk& chunk, uint32_t offset, uint32_t base) {
+        uint64_t mask = ColumnScan::equalMask(&chunk.status[offset], statusByte(DeviceStatus::ONLINE));
+        if (mask) {
+            mask &= ColumnScan::lessMask(&chunk.heartbeat[offset], staleBound);
+        }
+        for (; mask != 0; mask &= mask - 1) {
+            auto bit = static_cast<uint32_t>(std::countr_zero(mask));
+            Cell cell { &chunk, offset + bit, base + bit };
+            if (std::atomic_ref<int64_t>(chunk.heartbeat[cell.offset]).load(std::memory_order_relaxed) >= staleBound) {
+                continue;
+            }
+            uint8_t expected = statusByte(DeviceStatus::ONLINE);
+            if (std::atomic_ref<uint8_t>(chunk.status[cell.offset])
+                    .compare_exchange_strong(expected, statusByte(DeviceStatus::OFFLINE), std::memory_order_acq_rel)) {
+                emitEvent(DeviceEvent::Type::Offline, cell);
+            }
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief Emit a transition event to the listener
+ * @brief 向监听器发出状态变化事件
+ *
+ * @param type 事件类型
+ * @param cell 设备位置
+ * @param report 新的状态上报内容，仅 StatusChanged 事件携带
+ */
+void ColumnarDeviceManager::emitEvent(DeviceEvent::Type type, const Cell& cell, std::string report) {
+    DeviceEventListener listener;
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        listener = mListener;
+    }
+    if (listener) {
+        auto status = std::atomic_ref<uint8_t>(cell.chunk->status[cell.offset]).load(std::memory_order_acquire);
+        listener(DeviceEvent { type, cell.chunk->ids[cell.offset], static_cast<DeviceStatus>(status),
+                               std::chrono::steady_clock::now(), std::move(report), {} });
+    }
+}
+
+IOT_DEVICE_NS_END
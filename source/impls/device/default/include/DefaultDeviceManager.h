@@ -1,13 +1,26 @@
 #pragma once
 
 #include "DeviceManagerFactory.h"
+#include "DeviceSnapshot.h"
+#include "DeviceWal.h"
 #include "IDeviceManager.h"
 #include "PluginFactory.h"
 #include "PluginRegistry.h"
 #include "common/NameSpaceDef.h"
 #include "common/ShardedMap.h"
+#include "common/TimingWheel.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 IOT_DEVICE_NS_BEGIN
 
@@ -18,6 +31,27 @@ IOT_DEVICE_NS_BEGIN
  * Provides basic registration, heartbeat, status reporting and querying functionalities.
  * 提供设备注册、心跳维护、状态上报和信息查询等基础功能。
  *
+ * Silent devices are expired actively: every online device sits on the timing wheel of its shard, and a
+ * background thread marks it offline and emits an Offline event shortly after its heartbeat deadline.
+ * 静默设备会被主动判定超时：每个在线设备挂在所在分片的时间轮上，后台线程在心跳截止时间过后不久将其标记为离线并发出离线事件。
+ *
+ * With DeviceManagerOptions::walPath set, registrations, online/offline transitions, status reports and timeout
+ * overrides are appended to a DeviceWal and replayed by configure() after a restart.
+ * 设置 DeviceManagerOptions::walPath 后，注册、在线/离线变化、状态上报与超时设置都追加到 DeviceWal，
+ * 重启后由 configure() 回放恢复。
+ *
+ * Every mutation also updates the secondary indexes of the device's shard inside the same critical section:
+ * per-status counters, per-status membership bitmaps keyed by device handle, and the owner→devices index. Fleet
+ * counts therefore cost one load per shard, and listings by status or owner skip the devices that cannot match.
+ * 每次变更都在同一临界区内更新设备所在分片的二级索引：按状态的计数器、以设备句柄为键的按状态成员位图，
+ * 以及所有者→设备索引。因此统计全网设备数只需每个分片一次读取，按状态或所有者列出设备时也跳过不可能匹配的设备。
+ *
+ * With DeviceManagerOptions::snapshotPath set as well, the registry is periodically written to a DeviceSnapshot
+ * and the log segments it covers are deleted. configure() then maps the snapshot, replays only the log tail and
+ * returns; the remaining devices are materialized from the snapshot on first access or by a background hydrator.
+ * 同时设置 DeviceManagerOptions::snapshotPath 后，注册表定期写出为 DeviceSnapshot，并删除其已覆盖的日志段。
+ * configure() 于是只需映射快照、回放日志尾部即可返回；其余设备在首次访问时或由后台线程从快照中逐个恢复。
+ *
  * @author Solo
  * @version 1.1
  * @date 2025-06-12
@@ -45,9 +79,24 @@ public:
     /**
      * @brief Cleanup resources before shutdown.
      * @brief 释放资源，准备关闭
+     *
+     * Writes a final registry snapshot when snapshots are configured.
+     * 配置了快照时先写出最后一次注册表快照。
      */
     void shutdown() override;
 
+    /**
+     * @brief Apply shard count, heartbeat timeouts and expiry tick.
+     * @brief 应用分片数、心跳超时与超时扫描粒度配置
+     *
+     * Stops the background threads and rebuilds the (still empty) device registry with the configured shard count,
+     * then restores it from the snapshot and the write-ahead log when they are configured.
+     * 停止后台线程，并以配置的分片数重建（尚为空的）设备注册表；配置了快照与预写日志时再从中恢复。
+     *
+     * @param options Tuning options
+     */
+    void configure(const DeviceManagerOptions& options) override;
+
     /**
      * @brief Register a device by its ID.
      * @brief 根据设备 ID 注册设备
@@ -66,6 +115,135 @@ public:
      */
     void refreshDeviceHeartbeat(const std::string& deviceId) override;
 
+    /**
+     * @brief Acquire the registry slot of a device.
+     * @brief 获取设备的注册表槽位
+     *
+     * @param deviceId Unique identifier of the device
+     * @return Slot pointer, nullptr if the device is not registered
+     */
+    auto acquireSlot(const std::string& deviceId) -> std::shared_ptr<DeviceSlot> override;
+
+    /**
+     * @brief Lock-free heartbeat refresh on a registry slot.
+     * @brief 在注册表槽位上无锁刷新心跳
+     *
+     * @param slot Registry slot of the device
+     */
+    void refreshDeviceHeartbeat(DeviceSlot& slot) override;
+
+    /**
+     * @brief Register a device and return its handle.
+     * @brief 注册设备并返回其句柄
+     *
+     * @param deviceId Unique identifier of the device
+     * @param outHandle Output handle, filled in for new and existing devices
+     * @return true if the device was newly registered
+     */
+    auto registerDevice(const std::string& deviceId, DeviceHandle& outHandle) -> bool override;
+
+    /**
+     * @brief Register a device on behalf of an owner and return its handle.
+     * @brief 代表所有者注册设备并返回其句柄
+     *
+     * @param deviceId Unique identifier of the device
+     * @param owner Owning user, bound to a new device or claimed for an unbound one
+     * @param outHandle Output handle, filled in for new and existing devices
+     * @return true if the device was newly registered
+     */
+    auto registerDevice(const std::string& deviceId, const std::string& owner, DeviceHandle& outHandle)
+        -> bool override;
+
+    /**
+     * @brief Bind a registered device to another owner.
+     * @brief 将已注册设备改绑到其他所有者
+     *
+     * @param deviceId Unique identifier of the device
+     * @param owner New owner, empty to unbind
+     * @return false if the device is not registered or the change could not be logged
+     */
+    auto setDeviceOwner(const std::string& deviceId, const std::string& owner) -> bool override;
+
+    /**
+     * @brief Register a batch of devices, loading the registry shards in parallel.
+     * @brief 批量注册设备，并行装载各注册表分片
+     *
+     * The batch is partitioned by registry shard and each worker thread loads whole shards, taking each shard's
+     * registry and index locks once per kIMPORT_CHUNK devices rather than once per device. New devices are
+     * written to the log as one commit per chunk, and a single Resync event replaces their Online events.
+     * 批次按注册表分片划分，每个工作线程装载整个分片；每 kIMPORT_CHUNK 个设备才获取一次分片的注册表锁与索引锁，
+     * 而不是每个设备一次。新设备按块作为一次提交写入日志，并以一个 Resync 事件代替逐个的上线事件。
+     *
+     * @param devices Devices to register
+     * @param outResult Output tally of the batch
+     * @return true once the whole batch is processed
+     */
+    auto registerDevices(const std::vector<DeviceRegistration>& devices, DeviceImportResult& outResult)
+        -> bool override;
+
+    /**
+     * @brief Resolve the handle of a registered device.
+     * @brief 解析已注册设备的句柄
+     *
+     * @param deviceId Unique identifier of the device
+     * @return The handle, kINVALID_DEVICE_HANDLE if the device is not registered
+     */
+    auto acquireHandle(const std::string& deviceId) -> DeviceHandle override;
+
+    /**
+     * @brief Lock-free heartbeat refresh by handle.
+     * @brief 按句柄无锁刷新心跳
+     *
+     * @param handle Device handle
+     */
+    void refreshDeviceHeartbeat(DeviceHandle handle) override;
+
+    /**
+     * @brief Report the status of a device by handle.
+     * @brief 按句柄上报设备状态
+     *
+     * @param handle Device handle
+     * @param status Status string
+     * @param details Changed attributes, an empty value removes one
+     * @return false if the handle is unknown
+     */
+    auto reportStatus(DeviceHandle handle, const std::string& status, const StatusDetails& details)
+        -> bool override;
+
+    /**
+     * @brief Get device information by handle.
+     * @brief 按句柄获取设备信息
+     *
+     * @param handle Device handle
+     * @param outInfo Output parameter to store device info
+     * @return false if the handle is unknown
+     */
+    auto getDeviceInfo(DeviceHandle handle, DeviceInfo& outInfo) -> bool override;
+
+    /**
+     * @brief Install the device event listener.
+     * @brief 设置设备事件监听器
+     *
+     * @param listener Event listener
+     */
+    void setEventListener(DeviceEventListener listener) override;
+
+    /**
+     * @brief Enable or disable StatusChanged events.
+     * @brief 开启或关闭状态内容变化事件
+     *
+     * @param enabled Whether changed status reports emit events
+     */
+    void setStatusEventsEnabled(bool enabled) override;
+
+    /**
+     * @brief Whether the write-ahead log refuses writes after an error.
+     * @brief 预写日志是否因出错而拒绝写入
+     *
+     * @return true until a snapshot rotates the damaged log away
+     */
+    auto storageFailed() -> bool override;
+
     /**
      * @brief Mark a device as offline.
      * @brief 将设备标记为离线
@@ -74,6 +252,16 @@ public:
      */
     void markDeviceOffline(const std::string& deviceId) override;
 
+    /**
+     * @brief Override the heartbeat timeout of one device.
+     * @brief 单独设置某个设备的心跳超时
+     *
+     * @param deviceId Unique identifier of the device
+     * @param timeout Heartbeat timeout, 0 to fall back to the class or default
+     * @return false if the device is not registered or the change could not be logged
+     */
+    auto setHeartbeatTimeout(const std::string& deviceId, std::chrono::milliseconds timeout) -> bool override;
+
     /**
      * @brief Report current status of a device.
      * @brief 上报设备当前状态
@@ -84,6 +272,28 @@ public:
      */
     void reportStatus(const std::string& deviceId, const std::string& status) override;
 
+    /**
+     * @brief Report the status of a device and merge changed structured attributes.
+     * @brief 上报设备状态并合并变化的结构化属性
+     *
+     * Attribute names are interned and values parsed before the slot is locked.
+     * 属性名驻留与值解析都在加锁之前完成。
+     *
+     * @param deviceId Unique identifier of the device
+     * @param status Status string
+     * @param details Changed attributes, an empty value removes one
+     */
+    void reportStatus(const std::string& deviceId, const std::string& status, const StatusDetails& details) override;
+
+    /**
+     * @brief Report the status of many devices at once.
+     * @brief 批量上报设备状态
+     *
+     * @param updates Status updates, payloads are moved into the registry
+     * @return Indexes of updates whose device is not registered or whose report could not be logged
+     */
+    auto reportStatusBatch(std::vector<DeviceStatusUpdate>& updates) -> std::vector<uint32_t> override;
+
     /**
      * @brief Check if the device is currently online.
      * @brief 查询设备是否处于在线状态
@@ -104,18 +314,630 @@ public:
      */
     auto getDeviceInfo(const std::string& deviceId, DeviceInfo& outInfo) -> bool override;
 
+    /**
+     * @brief Check whether a registered device is visible to a user
+     * @brief 检查已注册设备对用户是否可见
+     *
+     * @param deviceId Unique identifier of the device
+     * @param viewer User asking for the device
+     * @return Whether the device is registered and visible
+     * @return 设备已注册且可见返回 true
+     */
+    auto isDeviceVisibleTo(const std::string& deviceId, const std::string& viewer) -> bool override;
+
+    /**
+     * @brief List devices matching a query, one page at a time.
+     * @brief 分页列出匹配查询条件的设备
+     *
+     * Served from the owner index when the query names an owner, from the status bitmaps when it names a status,
+     * and from the registration-order index otherwise.
+     * 查询指定所有者时基于所有者索引，指定状态时基于状态位图，否则基于注册顺序索引。
+     *
+     * @param query Filters, cursor and page size
+     * @param outPage Output page
+     * @return false if the cursor is malformed or stale
+     */
+    auto listDevices(const DeviceQuery& query, DevicePage& outPage) -> bool override;
+
+    /**
+     * @brief Read the recorded history of a numeric attribute of a device.
+     * @brief 读取设备某个数值属性的历史记录
+     *
+     * Only chunks overlapping the range are decoded, under the slot mutex. History lives in memory only: it is
+     * neither logged nor snapshotted, so it starts empty after a restart.
+     * 只解码与时间范围重叠的数据块，在槽位锁内完成。历史只保存在内存中，不写入日志与快照，重启后为空。
+     *
+     * @param query Device, attribute, time range and step
+     * @param outPoints Output points in time order
+     * @return false if the device is not registered
+     */
+    auto getDeviceHistory(const HistoryQuery& query, std::vector<HistoryPoint>& outPoints) -> bool override;
+
+    /**
+     * @brief Count registered devices per status.
+     * @brief 按状态统计已注册设备数量
+     *
+     * Sums the per-shard counters and the stored status counts of snapshot rows not hydrated yet, without taking
+     * any lock or waiting for hydration.
+     * 不加锁，也不等待快照恢复，只累加各分片的计数器与尚未恢复的快照行按存储状态的计数。
+     *
+     * @param outCounts Output counts
+     * @return Always true
+     */
+    auto countDevices(DeviceCounts& outCounts) -> bool override;
+
+    /**
+     * @brief Visit the registry slot of every registered device.
+     * @brief 遍历所有已注册设备的注册表槽位
+     *
+     * Slot pointers are copied in bounded chunks under the index shard lock and visited outside it. While the
+     * snapshot is hydrating, each index shard is hydrated just before it is visited.
+     * 槽位指针在索引分片锁内按有限大小分块复制，在锁外访问。快照恢复期间，每个索引分片在被访问之前才恢复。
+     *
+     * @param visitor Visitor invoked once per device, outside the index shard lock
+     */
+    void forEachDevice(const std::function<void(const DeviceSlot&)>& visitor) override;
+
+private:
+    /**
+     * @brief Slot of a handle, nullptr if the handle was never assigned.
+     * @brief 句柄对应的槽位，句柄未分配时为 nullptr
+     *
+     * Two acquire loads and no lock: one for the handle chunk and one for the slot pointer.
+     * 不加锁，只有两次 acquire 读取：一次读句柄块，一次读槽位指针。
+     *
+     * @param handle Device handle
+     */
+    auto slotOf(DeviceHandle handle) const -> DeviceSlot*;
+
+    /**
+     * @brief Publish a freshly created slot in the handle table.
+     * @brief 将新建的槽位发布到句柄表
+     *
+     * Runs before the slot becomes visible in the registry, so whoever finds the device by ID can resolve its
+     * handle at once.
+     * 在槽位出现在注册表之前执行，因此按 ID 找到设备的调用方立即可以解析其句柄。
+     *
+     * @param slot Newly created slot
+     */
+    void publishHandle(DeviceSlot& slot);
+
+    /**
+     * @brief Find or create the slot of a device, assigning its handle and indexing it for listings.
+     * @brief 查找或创建设备槽位，新建时分配句柄并加入列表索引
+     *
+     * While the snapshot is being hydrated, a device found in it is restored from its row instead of created.
+     * 快照恢复期间，快照中已有的设备按其所在行恢复，而不是新建。
+     *
+     * @param deviceId Unique identifier of the device
+     * @param created Set to true when the device was registered by this call rather than found or restored
+     * @param row Snapshot row of the device if already known
+     * @param owner Owner bound to the device if this call creates it
+     * @return Slot of the device
+     */
+    auto insertSlot(const std::string& deviceId, bool& created, std::optional<size_t> row = std::nullopt,
+                    const std::string& owner = {}) -> std::shared_ptr<DeviceSlot>;
+
+    /**
+     * @brief Create the slot of a device not yet in the registry and publish its handle.
+     * @brief 为尚未出现在注册表中的设备创建槽位并发布其句柄
+     *
+     * Called under the registry shard lock. While the snapshot is being hydrated, a device found in it is restored
+     * from its row, which is then stored in row.
+     * 在注册表分片锁内调用。快照恢复期间，快照中已有的设备按其所在行恢复，并将行号写入 row。
+     *
+     * @param deviceId Unique identifier of the device
+     * @param row Snapshot row of the device if already known, filled in when found in the snapshot
+     * @return The new slot
+     */
+    auto makeSlot(const std::string& deviceId, std::optional<size_t>& row) -> std::shared_ptr<DeviceSlot>;
+
+    /**
+     * @brief Copy the state stored in a snapshot row into a fresh slot.
+     * @brief 将快照行中存储的状态复制到新建的槽位
+     *
+     * @param slot Slot not yet visible in the registry
+     * @param row Snapshot row of the device
+     */
+    void restoreSlot(DeviceSlot& slot, size_t row);
+
+    /**
+     * @brief Start materializing every snapshot row in the background.
+     * @brief 启动后台线程，逐行恢复快照中的全部设备
+     */
+    void startHydrator();
+
+    /**
+     * @brief Stop the hydrator, leaving unvisited rows unrestored.
+     * @brief 停止快照恢复线程，未处理的行不再恢复
+     */
+    void stopHydrator();
+
+    /**
+     * @brief Block until every snapshot row is in the registry.
+     * @brief 阻塞直到快照中的设备全部进入注册表
+     */
+    void awaitHydration();
+
+    /**
+     * @brief Bring every snapshot row of one index shard into the registry, on the calling thread.
+     * @brief 在调用线程上将属于某个索引分片的快照行全部恢复到注册表
+     *
+     * Scans touch only the shards they walk, so a query during hydration restores those and never waits for the
+     * background hydrator. Once hydration is over this is a single atomic load.
+     * 扫描只恢复其遍历到的分片，因此恢复期间的查询从不等待后台恢复线程；恢复完成后只是一次原子读取。
+     *
+     * @param index Index shard
+     */
+    void hydrateShard(size_t index);
+
+    /**
+     * @brief Snapshot rows grouped by index shard, computed on first use.
+     * @brief 按索引分片分组的快照行，首次使用时计算
+     */
+    auto snapshotRows() -> const std::vector<std::vector<uint32_t>>&;
+
+    /**
+     * @brief Start the periodic snapshot thread if snapshots are configured.
+     * @brief 配置了快照时启动定期快照线程
+     */
+    void startSnapshotter();
+
+    /**
+     * @brief Stop the periodic snapshot thread.
+     * @brief 停止定期快照线程
+     */
+    void stopSnapshotter();
+
+    /**
+     * @brief Rotate the write-ahead log and write a snapshot covering every older generation.
+     * @brief 轮转预写日志，并写出覆盖所有更早代数的快照
+     *
+     * @return false if the log could not be rotated or the snapshot could not be written
+     */
+    auto writeSnapshot() -> bool;
+
+    /**
+     * @brief Apply one replayed log record, without logging it again or emitting events.
+     * @brief 应用一条回放的日志记录，不重复记录也不发出事件
+     *
+     * @param record Log record
+     */
+    void replayRecord(const WalRecord& record);
+
+    /**
+     * @brief Store a report in a slot, refresh its heartbeat and emit the resulting events.
+     * @brief 将上报写入槽位、刷新心跳并发出相应事件
+     *
+     * @param slot Registry slot of the device
+     * @param status Status report, moved into the slot
+     * @param details Changed attributes
+     * @return false if the report could not be logged; it is still applied in memory
+     */
+    auto applyStatus(DeviceSlot& slot, std::string&& status, const StatusDetails& details) -> bool;
+
+    /**
+     * @brief Emit an event for a device transition to the installed listener.
+     * @brief 向监听器发出设备状态变化事件
+     *
+     * @param type Event type
+     * @param slot Registry slot of the device
+     * @param report New status report, only carried by StatusChanged events
+     */
+    void emitEvent(DeviceEvent::Type type, const DeviceSlot& slot, std::string report = {});
+
+    /**
+     * @brief Emit one Resync event in place of the per-device events of a bulk change.
+     * @brief 发出一个 Resync 事件，代替批量变更的逐设备事件
+     */
+    void emitResync();
+
+    /**
+     * @brief Store a status report and merge attribute updates in a slot, logging it under the same lock.
+     * @brief 将状态上报写入槽位并合并属性更新，并在同一把锁内记录日志
+     *
+     * @param slot Registry slot of the device
+     * @param status Status report, moved into the slot
+     * @param details Changed attributes as reported, for the log
+     * @param updates Parsed attribute updates
+     * @param logged Receives the log ticket; the caller awaits it once the slot lock is released
+     * @return The report when status events are enabled and the report or an attribute changed, empty otherwise
+     */
+    auto storeStatus(DeviceSlot& slot, std::string&& status, const StatusDetails& details,
+                     const std::vector<AttributeUpdate>& updates, WalTicket& logged) -> std::optional<std::string>;
+
+    /**
+     * @brief Append numeric and boolean updates to the attribute history of a slot and expire old chunks.
+     * @brief 将数值与布尔更新追加到槽位的属性历史，并淘汰过期的数据块
+     *
+     * Called under the slot mutex.
+     * 在槽位锁内调用。
+     *
+     * @param slot Registry slot of the device
+     * @param updates Parsed attribute updates
+     * @param nowMs Report time in Unix milliseconds
+     */
+    void recordHistory(DeviceSlot& slot, const std::vector<AttributeUpdate>& updates, int64_t nowMs) const;
+
+    /**
+     * @brief Whether the attributes of a slot satisfy every attribute filter of a query.
+     * @brief 槽位的属性是否满足查询中的全部属性条件
+     *
+     * @param slot Registry slot of the device
+     * @param filters Filters with their resolved attribute keys
+     */
+    static auto matchesAttributes(const DeviceSlot& slot,
+                                  const std::vector<std::pair<AttributeKey, const AttributeFilter*>>& filters) -> bool;
+
+    /**
+     * @brief Whether a slot is visible to a user: owned by that user or by nobody.
+     * @brief 槽位对某用户是否可见：归属该用户或尚未绑定所有者
+     *
+     * @param slot Registry slot of the device
+     * @param viewer Querying user
+     */
+    static auto visibleTo(const DeviceSlot& slot, const std::string& viewer) -> bool;
+
+    /// @brief Maximum devices per listing page
+    /// @brief 列表每页设备数上限
+    static constexpr size_t kMAX_PAGE_SIZE = 1000;
+
+private:
+    /**
+     * @brief Secondary indexes of one registry shard.
+     * @brief 一个注册表分片的二级索引
+     *
+     * The registration-order list is append-only: a slot keeps its position for the lifetime of the manager, so a
+     * cursor (shard, position) stays valid across pages without holding any lock in between. Owner lists keep
+     * registration order too, but lose entries when devices change owner. Counters are only written under the
+     * mutex and read without it.
+     * 注册顺序列表只追加不删除：槽位的位置在管理器生命周期内不变，因此游标（分片，位置）在分页之间无需持锁也始终有效。
+     * 所有者列表同样按注册顺序排列，但设备改绑时会移除条目。计数器只在锁内写入，读取时不加锁。
+     */
+    struct IndexShard {
+        mutable std::mutex mutex;                       // 保护以下索引 / Guards the indexes below
+        std::vector<std::shared_ptr<DeviceSlot>> slots; // 按注册顺序排列的槽位 / Slots in registration order
+        // 所有者到其槽位的索引 / Slots of each owner
+        std::unordered_map<std::string, std::vector<std::shared_ptr<DeviceSlot>>> owners;
+        // 以状态值为下标的设备数 / Devices per status, indexed by status value
+        std::array<std::atomic<int64_t>, kDEVICE_STATUS_COUNT> counts {};
+        // 快照中属于本分片的设备都已进入注册表 / Every snapshot row of the shard is in the registry
+        std::atomic<bool> hydrated { false };
+    };
+
+    /**
+     * @brief Expiry timer of one device.
+     * @brief 单个设备的超时定时器
+     *
+     * Slots live as long as the registry, so timers hold plain pointers. Scheduling a new timer bumps the slot's
+     * generation, which turns any older timer of the device into a no-op.
+     * 槽位与注册表同生命周期，因此定时器直接持有指针；安排新的定时器会递增槽位代数，使该设备较早的定时器失效。
+     */
+    struct ExpiryTimer {
+        DeviceSlot* slot;    // 设备注册表槽位 / Registry slot of the device
+        uint32_t generation; // 安排时的槽位代数 / Slot generation when scheduled
+    };
+
+    /**
+     * @brief One shard of the expiry sweeper.
+     * @brief 超时扫描的一个分片
+     */
+    struct ExpiryShard {
+        explicit ExpiryShard(std::chrono::milliseconds tick)
+            : wheel(tick, kEXPIRY_WHEEL_SLOTS) {}
+
+        std::mutex mutex;                       // 保护时间轮 / Guards the wheel
+        IOT_NS::TimingWheel<ExpiryTimer> wheel; // 心跳截止时间 / Heartbeat deadlines
+    };
+
+    /**
+     * @brief Change the stored status of a slot and move it between the status indexes of its shard.
+     * @brief 修改槽位存储的状态，并在其所在分片的状态索引之间移动
+     *
+     * Every status change of a published slot goes through here, under the index lock of its shard, so the
+     * counters and bitmaps never disagree with the slots.
+     * 已发布槽位的每次状态变化都经由这里、在其所在分片的索引锁内完成，因此计数器与位图始终与槽位一致。
+     *
+     * @param slot Registry slot of the device
+     * @param to New status
+     * @param from Only change the status if it currently is this one
+     * @param logged When given, the change is logged under the index lock and the log ticket stored here
+     * @return true if the status changed
+     */
+    auto setStatus(DeviceSlot& slot, DeviceStatus to, std::optional<DeviceStatus> from = std::nullopt,
+                   WalTicket* logged = nullptr) -> bool;
+
+    /**
+     * @brief Move a slot between the status counters and bitmaps of its shard.
+     * @brief 在所在分片的状态计数器与位图之间移动槽位
+     *
+     * Called under the shard's index lock.
+     * 在分片的索引锁内调用。
+     *
+     * @param shard Index shard of the device
+     * @param slot Registry slot of the device
+     * @param from Previous status, empty when the slot is first indexed
+     * @param to New status
+     */
+    void indexStatus(IndexShard& shard, const DeviceSlot& slot, std::optional<DeviceStatus> from, DeviceStatus to);
+
+    /**
+     * @brief Set or clear the bit of a handle in a status bitmap.
+     * @brief 设置或清除句柄在某个状态位图中的位
+     *
+     * @param handle Device handle, ignored when invalid
+     * @param status Status bitmap
+     * @param member Whether the device is in the status
+     */
+    void markMember(DeviceHandle handle, DeviceStatus status, bool member);
+
+    /**
+     * @brief Bind a slot to an owner and move it in the owner index.
+     * @brief 将槽位绑定到所有者，并在所有者索引中移动
+     *
+     * Called under the shard's index lock.
+     * 在分片的索引锁内调用。
+     *
+     * @param shard Index shard of the device
+     * @param slot Registry slot of the device
+     * @param owner New owner, empty to unbind
+     * @param claim Only bind a slot that has no owner yet
+     * @return true if the owner changed
+     */
+    static auto bindOwner(IndexShard& shard, const std::shared_ptr<DeviceSlot>& slot, const std::string& owner,
+                          bool claim) -> bool;
+
+    /**
+     * @brief Index shard of a device, the same shard as in the registry.
+     * @brief 设备所在的索引分片，与注册表中的分片相同
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    auto indexShardOf(const std::string& deviceId) -> IndexShard&;
+
+    /**
+     * @brief Add a new slot to the secondary indexes of its shard.
+     * @brief 将新槽位加入所在分片的二级索引
+     *
+     * Called under the registry shard lock and the shard's index lock, before the slot becomes visible.
+     * 在注册表分片锁与该分片的索引锁内、槽位可见之前调用。
+     *
+     * @param shard Index shard of the device
+     * @param slot The new slot
+     * @param restored Whether the slot was restored from the snapshot, keeping its stored owner
+     * @param owner Owner bound to a device registered rather than restored
+     */
+    void indexSlot(IndexShard& shard, const std::shared_ptr<DeviceSlot>& slot, bool restored,
+                   const std::string& owner);
+
+    /**
+     * @brief Register the devices of one registry shard for registerDevices().
+     * @brief 为 registerDevices() 注册属于同一注册表分片的设备
+     *
+     * @param shardIndex Registry shard of every device
+     * @param devices Devices of the shard, without duplicates
+     * @param outResult Tally of the shard, added to
+     */
+    void registerShard(size_t shardIndex, const std::vector<const DeviceRegistration*>& devices,
+                       DeviceImportResult& outResult);
+
+    /**
+     * @brief Serve a listing filtered by status from the status bitmaps, in handle order.
+     * @brief 按句柄顺序，基于状态位图处理按状态过滤的列表查询
+     *
+     * Only the words of the bitmaps are scanned; devices outside the candidate statuses are never touched.
+     * 只扫描位图的字，不在候选状态中的设备不会被访问。
+     *
+     * @param query Filters, cursor and page size; the cursor reads "#handle"
+     * @param accept Filters a device and adds it to the page, returning true once the page is full
+     * @param outPage Output page
+     * @return false if the cursor is malformed
+     */
+    auto listByStatus(const DeviceQuery& query, const std::function<bool(const DeviceSlot&)>& accept,
+                      DevicePage& outPage) -> bool;
+
+    /**
+     * @brief Heartbeat timeout of a slot: its own override, else the manager default.
+     * @brief 槽位的心跳超时：设备自身的设置，否则为管理器默认值
+     *
+     * @param slot Registry slot of the device
+     */
+    auto timeoutOf(const DeviceSlot& slot) const -> std::chrono::milliseconds;
+
+    /**
+     * @brief Heartbeat timeout of the device class matching an ID, 0 when no class matches.
+     * @brief 设备 ID 所属类别的心跳超时，没有匹配的类别时为 0
+     *
+     * @param deviceId Unique identifier of the device
+     */
+    auto classTimeout(const std::string& deviceId) const -> std::chrono::milliseconds;
+
+    /**
+     * @brief Put an online device on the expiry wheel unless it is already there.
+     * @brief 将在线设备挂入超时时间轮，已挂入时不重复
+     *
+     * @param slot Registry slot of the device
+     */
+    void armExpiry(DeviceSlot& slot);
+
+    /**
+     * @brief Schedule an expiry check at the current heartbeat deadline of a slot.
+     * @brief 按槽位当前的心跳截止时间安排一次超时检查
+     *
+     * @param slot Registry slot of the device
+     */
+    void scheduleExpiry(DeviceSlot& slot);
+
+    /**
+     * @brief Handle a fired expiry timer: mark the device offline, or re-arm it at its new deadline.
+     * @brief 处理到期的超时定时器：设备已超时则标记离线，否则按新的截止时间重新挂入
+     *
+     * @param timer Fired timer
+     * @param now Current time point
+     */
+    void checkExpiry(const ExpiryTimer& timer, DeviceSlot::Clock::time_point now);
+
+    /**
+     * @brief Start the expiry sweeper thread if enabled and not running.
+     * @brief 启动超时扫描线程（已启用且尚未运行时）
+     */
+    void startSweeper();
+
+    /**
+     * @brief Stop the expiry sweeper thread.
+     * @brief 停止超时扫描线程
+     */
+    void stopSweeper();
+
+    /**
+     * @brief Advance every expiry wheel and expire silent devices.
+     * @brief 推进所有超时时间轮，判定静默设备超时
+     *
+     * @param now Current time point
+     */
+    void sweep(DeviceSlot::Clock::time_point now);
+
+    /**
+     * @brief Status of a slot adjusted for the heartbeat timeout, without changing the slot.
+     * @brief 按心跳超时折算后的设备状态，不修改槽位
+     *
+     * @param slot Registry slot of the device
+     * @param now Current time point
+     */
+    auto effectiveStatus(const DeviceSlot& slot, DeviceSlot::Clock::time_point now) const -> DeviceStatus;
+
 private:
     /// @brief Log tag used for debugging and logging
     /// @brief 用于日志打印的标签
     static constexpr const char* kTAG = "DeviceManager";
 
-    /// @brief Number of shards used in internal device map for concurrency
-    /// @brief 内部设备映射的分片数量，用于并发优化
+    /// @brief Default number of shards used in internal device map for concurrency
+    /// @brief 内部设备映射的默认分片数量，用于并发优化
     static constexpr int SHARD_COUNT = 32;
 
-    /// @brief Sharded map storing device information keyed by device ID
-    /// @brief 基于设备 ID 存储设备信息的分片哈希表
-    IOT_NS::ShardedMap<std::string, DeviceInfo, SHARD_COUNT> mDevices;
+    /// @brief Handles per chunk of the handle table (as a power of two) and chunks the table can hold
+    /// @brief 句柄表每块的句柄数（以 2 的幂表示）与可容纳的块数
+    static constexpr uint32_t kHANDLE_CHUNK_BITS = 12;
+    static constexpr uint32_t kHANDLE_CHUNK_SIZE = 1u << kHANDLE_CHUNK_BITS;
+    static constexpr uint32_t kMAX_HANDLE_CHUNKS = 1u << 16;
+
+    /// @brief Slots of each expiry wheel; deadlines beyond one turn wrap around
+    /// @brief 每个超时时间轮的槽位数，超过一圈的截止时间会绕圈
+    static constexpr size_t kEXPIRY_WHEEL_SLOTS = 1024;
+
+    /// @brief Devices registered per lock of a shard by registerDevices(), bounding how long lookups wait
+    /// @brief registerDevices() 每次对分片加锁注册的设备数，限制查询的等待时间
+    static constexpr size_t kIMPORT_CHUNK = 1024;
+
+    /// @brief Tuning options: shard count and heartbeat timeout after which a device is considered offline
+    /// @brief 调优参数：分片数量与心跳超时时间（超过后设备视为离线）
+    DeviceManagerOptions mOptions;
+
+    /// @brief Sharded map storing device registry slots keyed by device ID
+    /// @brief 基于设备 ID 存储设备注册表槽位的分片哈希表
+    IOT_NS::ShardedMap<std::string, std::shared_ptr<DeviceSlot>, SHARD_COUNT> mDevices;
+
+    /// @brief Secondary indexes (registration order, owners, status counters), sharded like the registry
+    /// @brief 二级索引（注册顺序、所有者、状态计数器），与注册表按相同方式分片
+    std::vector<IndexShard> mIndexShards;
+
+    /// @brief One fixed-size chunk of the handle table, with the status membership bits of its handles
+    /// @brief 句柄表中固定大小的一块，附带其句柄的状态成员位
+    struct HandleChunk {
+        // 句柄对应的槽位 / Slot of each handle
+        std::array<std::atomic<DeviceSlot*>, kHANDLE_CHUNK_SIZE> slots;
+        // 以状态值为下标的成员位图，每个句柄一位 / Membership bitmaps indexed by status value, one bit per handle
+        std::array<std::array<std::atomic<uint64_t>, kHANDLE_CHUNK_SIZE / 64>, kDEVICE_STATUS_COUNT> members;
+    };
+
+    /// @brief Dense handle table: chunk directory read lock-free, chunks allocated on demand and never moved
+    /// @brief 稠密句柄表：块目录无锁读取，块按需分配且从不移动
+    std::unique_ptr<std::atomic<HandleChunk*>[]> mHandleChunks;
+
+    /// @brief Owner of the allocated chunks, guarded by mHandleMutex
+    /// @brief 已分配块的所有者，由 mHandleMutex 保护
+    std::vector<std::unique_ptr<HandleChunk>> mHandleChunkStore;
+
+    /// @brief Mutex guarding chunk allocation
+    /// @brief 保护句柄块分配的互斥锁
+    std::mutex mHandleMutex;
+
+    /// @brief Next handle to assign
+    /// @brief 下一个待分配的句柄
+    std::atomic<uint32_t> mNextHandle { 0 };
+
+    /// @brief Expiry wheels, sharded like the registry
+    /// @brief 超时时间轮，与注册表按相同方式分片
+    std::vector<std::unique_ptr<ExpiryShard>> mExpiryShards;
+
+    /// @brief Background thread advancing the expiry wheels, started with the first registration
+    /// @brief 推进超时时间轮的后台线程，在首次注册设备时启动
+    std::thread mSweeper;
+
+    /// @brief Whether the sweeper should keep running
+    /// @brief 超时扫描线程运行标志
+    std::atomic<bool> mSweeping { false };
+
+    /// @brief Mutex and condition used to wake the sweeper on shutdown
+    /// @brief 用于在关闭时唤醒扫描线程的互斥锁与条件变量
+    std::mutex mSweeperMutex;
+    std::condition_variable mSweeperWake;
+
+    /// @brief Listener receiving device transition events (only touched on transitions)
+    /// @brief 设备状态变化事件监听器（仅在状态变化时访问）
+    DeviceEventListener mListener;
+
+    /// @brief Mutex guarding the event listener
+    /// @brief 保护事件监听器的互斥锁
+    std::mutex mListenerMutex;
+
+    /// @brief Whether changed status reports emit events, read lock-free on the status report path
+    /// @brief 内容变化的状态上报是否发出事件，状态上报路径上无锁读取
+    std::atomic<bool> mStatusEvents { false };
+
+    /// @brief Write-ahead log of registry mutations, empty when disabled; only replaced by configure()
+    /// @brief 注册表变更的预写日志，未启用时为空；只由 configure() 替换
+    std::unique_ptr<DeviceWal> mWal;
+
+    /// @brief Snapshot being hydrated or already hydrated, empty when none was loaded; only replaced by configure()
+    /// @brief 正在恢复或已恢复的快照，未加载时为空；只由 configure() 替换
+    std::unique_ptr<DeviceSnapshot> mSnapshot;
+
+    /// @brief Whether snapshot rows may still be missing from the registry, read on every registry miss
+    /// @brief 快照中是否可能还有设备未进入注册表，每次注册表查找未命中时读取
+    std::atomic<bool> mHydrating { false };
+
+    /// @brief Background thread materializing snapshot rows, and its stop flag
+    /// @brief 逐行恢复快照的后台线程及其停止标志
+    std::thread mHydrator;
+    std::atomic<bool> mHydratorStop { false };
+
+    /// @brief Mutex and condition signalled once hydration completes; the mutex also guards mSnapshotRows
+    /// @brief 快照恢复完成时通知的互斥锁与条件变量；互斥锁同时保护 mSnapshotRows
+    std::mutex mHydrateMutex;
+    std::condition_variable mHydrated;
+
+    /// @brief Snapshot rows of each index shard, empty until the first scan during hydration needs them
+    /// @brief 每个索引分片的快照行，恢复期间首次扫描需要时才计算
+    std::vector<std::vector<uint32_t>> mSnapshotRows;
+
+    /// @brief Snapshot rows not in the registry yet, per stored status
+    /// @brief 尚未进入注册表的快照行数，按存储的状态区分
+    std::array<std::atomic<int64_t>, kDEVICE_STATUS_COUNT> mUnhydrated {};
+
+    /// @brief Background thread writing periodic snapshots, and its stop flag
+    /// @brief 定期写出快照的后台线程及其停止标志
+    std::thread mSnapshotter;
+    bool mSnapshotting = false;
+
+    /// @brief Mutex and condition used to wake the snapshot thread on shutdown, guarding mSnapshotting
+    /// @brief 用于在关闭时唤醒快照线程的互斥锁与条件变量，保护 mSnapshotting
+    std::mutex mSnapshotterMutex;
+    std::condition_variable mSnapshotterWake;
+
+    /// @brief Serializes snapshot writers: the periodic thread and shutdown()
+    /// @brief 串行化快照写入：定期快照线程与 shutdown()
+    std::mutex mSnapshotWriteMutex;
 };
 
 IOT_DEVICE_NS_END
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include "device/DeviceInfo.h"
+#include "device/DeviceSlot.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief Compact, memory-mapped snapshot of the device registry.
+ * @brief 内存映射的紧凑设备注册表快照
+ *
+ * A versioned binary file: a checksummed header, then a table of device IDs sorted by ID and fixed-width
+ * columns (status, heartbeat timeout, owner) indexed by row, plus offset-indexed blobs for reports and attributes.
+ * Attribute names and owners are stored once in their own tables and referenced by index. Every section starts
+ * 8-byte aligned, so the columns are read in place from the mapping.
+ * 带版本的二进制文件：带校验的文件头，之后是按设备 ID 排序的 ID 表与按行号索引的定宽列（状态、心跳超时、所有者），
+ * 以及按偏移索引的上报内容与属性数据块。属性名与所有者各自在表中只存一次，按下标引用。每个段都按 8 字节对齐，
+ * 列直接从映射中原地读取。
+ *
+ * Opening a snapshot only maps it and checks the header: rows are found by binary search over the sorted ID
+ * table and decoded on demand, so a snapshot of millions of devices is usable right away. Only the header is
+ * checksummed; the file is written to a temporary path, synced and renamed, so it is never seen half written.
+ * 打开快照只做映射与文件头校验：按 ID 表二分查找行号，行内容按需解码，因此数百万设备的快照打开后即可使用。
+ * 只有文件头带校验；文件先写入临时路径、落盘后再重命名，因此不会读到写了一半的快照。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-08
+ */
+class DeviceSnapshot {
+public:
+    /**
+     * @brief Map a snapshot file.
+     * @brief 映射快照文件
+     *
+     * @param path Snapshot file path
+     * @return The snapshot, nullptr if the file is missing, of an unknown version or malformed
+     */
+    static auto open(const std::string& path) -> std::unique_ptr<DeviceSnapshot>;
+
+    /**
+     * @brief Write a snapshot of registry slots.
+     * @brief 写出注册表槽位的快照
+     *
+     * Each column is written in its own pass over the slots, taking the slot mutex only while one report or
+     * attribute set is copied, so writers are never stopped.
+     * 每一列各自遍历一次槽位，只在复制单个上报或属性集时持有槽位锁，写入方从不被暂停。
+     *
+     * @param path Snapshot file path, replaced atomically
+     * @param walGeneration First log generation not covered by the snapshot
+     * @param slots Slots sorted by device ID
+     * @return false on an I/O error; the previous snapshot is then left in place
+     */
+    static auto write(const std::string& path, uint64_t walGeneration,
+                      const std::vector<std::shared_ptr<DeviceSlot>>& slots) -> bool;
+
+    ~DeviceSnapshot();
+
+    DeviceSnapshot(const DeviceSnapshot&) = delete;
+    auto operator=(const DeviceSnapshot&) -> DeviceSnapshot& = delete;
+
+    /**
+     * @brief Number of devices.
+     * @brief 设备数量
+     */
+    auto size() const -> size_t;
+
+    /**
+     * @brief First log generation not covered by the snapshot.
+     * @brief 快照未覆盖的第一代日志
+     */
+    auto walGeneration() const -> uint64_t;
+
+    /**
+     * @brief Row of a device, by binary search over the sorted ID table.
+     * @brief 按排序的 ID 表二分查找设备所在行
+     *
+     * @param deviceId Unique identifier of the device
+     * @return The row, empty if the device is not in the snapshot
+     */
+    auto find(std::string_view deviceId) const -> std::optional<size_t>;
+
+    /**
+     * @brief Device ID of a row.
+     * @brief 行的设备 ID
+     */
+    auto deviceId(size_t row) const -> std::string_view;
+
+    /**
+     * @brief Stored status of a row.
+     * @brief 行中存储的设备状态
+     */
+    auto status(size_t row) const -> DeviceStatus;
+
+    /**
+     * @brief Heartbeat timeout of a row in milliseconds, 0 for the manager default.
+     * @brief 行的心跳超时毫秒数，0 表示管理器默认值
+     */
+    auto heartbeatTimeoutMs(size_t row) const -> int64_t;
+
+    /**
+     * @brief Last status report of a row.
+     * @brief 行的最近一次状态上报
+     */
+    auto report(size_t row) const -> std::string_view;
+
+    /**
+     * @brief Attributes of a row as updates against an empty attribute set.
+     * @brief 行的属性，以作用于空属性集的更新形式给出
+     */
+    auto attributes(size_t row) const -> std::vector<AttributeUpdate>;
+
+    /**
+     * @brief Owner of a row, empty when unbound.
+     * @brief 行的所有者，未绑定时为空
+     */
+    auto owner(size_t row) const -> std::string_view;
+
+private:
+    DeviceSnapshot() = default;
+
+    /**
+     * @brief Bytes of a row in an offset-indexed blob, empty when the offsets are out of range.
+     * @brief 按偏移索引的数据块中某一行的字节，偏移越界时为空
+     */
+    static auto blob(const uint64_t* offsets, const char* bytes, uint64_t size, size_t row) -> std::string_view;
+
+    /// @brief Log tag
+    /// @brief 日志标签
+    static constexpr const char* kTAG = "DeviceSnapshot";
+
+    void* mImage = nullptr;                              // 文件映射 / File mapping
+    size_t mImageBytes = 0;                              // 映射长度 / Mapping length
+    uint64_t mCount = 0;                                 // 设备数量 / Number of devices
+    uint64_t mWalGeneration = 0;                         // 未覆盖的第一代日志 / First uncovered log generation
+    const uint64_t* mIdOffsets = nullptr;                // ID 偏移，count + 1 项 / ID offsets, count + 1 entries
+    const char* mIdBytes = nullptr;                      // 排序的 ID 字节 / Sorted ID bytes
+    uint64_t mIdBytesSize = 0;                           // ID 字节数 / ID bytes length
+    const uint8_t* mStatus = nullptr;                    // 状态列 / Status column
+    const int64_t* mTimeouts = nullptr;                  // 心跳超时列 / Heartbeat timeout column
+    const uint64_t* mReportOffsets = nullptr;            // 上报偏移 / Report offsets
+    const char* mReportBytes = nullptr;                  // 上报字节 / Report bytes
+    uint64_t mReportBytesSize = 0;                       // 上报字节数 / Report bytes length
+    const uint64_t* mAttributeOffsets = nullptr;         // 属性偏移 / Attribute offsets
+    const char* mAttributeBytes = nullptr;               // 属性字节 / Attribute bytes
+    uint64_t mAttributeBytesSize = 0;                    // 属性字节数 / Attribute bytes length
+    std::vector<std::optional<AttributeKey>> mKeys;      // 键表下标到驻留键 / Key table index to interned key
+    const uint32_t* mOwnerIndex = nullptr;               // 所有者列 / Owner column
+    std::vector<std::string_view> mOwners;               // 所有者表，指向映射 / Owner table, pointing into the mapping
+};
+
+IOT_DEVICE_NS_END
@@ -0,0 +1,367 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include "device/DeviceAttributes.h"
+#include "device/DeviceInfo.h"
+#include "device/DeviceManagerOptions.h"
+#include "device/DeviceRegistration.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief One mutation of the device registry as stored in the write-ahead log.
+ * @brief 预写日志中记录的一次设备注册表变更
+ */
+struct WalRecord {
+    enum class Type : uint8_t {
+        Register = 1, // 设备注册 / Device registered
+        Transition,   // 在线状态变化 / Online status changed
+        Status,       // 状态上报 / Status reported
+        Timeout,      // 单设备心跳超时 / Per-device heartbeat timeout set
+        Owner,        // 设备所有者变化 / Device owner changed
+    };
+
+    Type type = Type::Register;                  // 变更类型 / Mutation type
+    std::string deviceId;                        // 设备唯一标识符 / Device ID
+    DeviceStatus status = DeviceStatus::UNKNOWN; // Transition：新状态 / Transition: new status
+    std::string report;                          // Status：上报内容 / Status: reported payload
+    StatusDetails details;                       // Status：变化的属性 / Status: changed attributes
+    int64_t timeoutMs = 0;                       // Timeout：心跳超时毫秒数 / Timeout: heartbeat timeout in ms
+    std::string owner;                           // Owner：新的所有者，空表示解绑 / Owner: new owner, empty when unbound
+};
+
+/**
+ * @brief Position of an appended record, used to wait for it to become durable.
+ * @brief 已追加记录的位置，用于等待其落盘
+ */
+struct WalTicket {
+    uint64_t generation = 0; // 记录所在的日志代数 / Generation the record went to
+    uint64_t end = 0;        // 记录之后的文件偏移，0 表示无需等待 / File offset past the record, 0 when nothing to wait
+    bool refused = false;    // 写入出错后记录被拒绝 / The record was refused after a write error
+};
+
+/**
+ * @brief Append-only write-ahead log of device registry mutations with group commit.
+ * @brief 带组提交的设备注册表只追加预写日志
+ *
+ * Callers encode their record on their own thread and append it to a shared in-memory batch under a short lock;
+ * a background flusher writes whole batches and fsyncs them, so concurrent writers share one fsync. With
+ * WalDurability::Sync a caller waits until its batch is durable; the other levels never block. A caller that
+ * appends under its own lock, so the log order matches the order of its in-memory updates, can defer that wait
+ * with a WalTicket and call awaitDurable() once the lock is released.
+ * 调用方在自己的线程上编码记录，只在短暂加锁时追加到共享的内存批次；后台刷盘线程整批写入并 fsync，
+ * 并发写入方共享同一次 fsync。WalDurability::Sync 级别下调用方等待所在批次落盘，其余级别从不阻塞。
+ * 在自己的锁内追加记录、使日志顺序与内存更新顺序一致的调用方，可以通过 WalTicket 推迟等待，释放锁后再调用
+ * awaitDurable()。
+ *
+ * On Linux the flusher submits the write and the fdatasync of a batch as one linked io_uring submission, falling
+ * back to pwrite and fdatasync when io_uring is unavailable. Heartbeats are never logged, only online/offline
+ * transitions, so steady-state heartbeats cost nothing extra.
+ * 在 Linux 上，刷盘线程把一个批次的写入与 fdatasync 作为一次链接的 io_uring 提交；io_uring 不可用时退回
+ * pwrite 与 fdatasync。心跳本身从不记录，只记录在线/离线状态变化，稳定状态下的心跳没有额外开销。
+ *
+ * File layout: a 16-byte header (8-byte magic with the format version, then the log generation as u64), then
+ * records framed as [payload length u32][CRC-32C u32][payload], integers in host byte order. A torn or corrupt
+ * tail is cut off on open.
+ * 文件格式：16 字节文件头（含格式版本的 8 字节魔数与 u64 日志代数），之后每条记录为
+ * [负载长度 u32][CRC-32C u32][负载]，整数为主机字节序；打开时截掉不完整或损坏的尾部。
+ *
+ * A failed write or sync is sticky: the records of that batch and every later append are refused, callers
+ * waiting on them get false, and the log accepts writes again only after rotate() moved the damaged file aside.
+ * 写入或同步失败是粘滞的：该批次的记录与之后的追加一律被拒绝，等待它们的调用方得到 false，
+ * 只有 rotate() 把损坏的文件移到一旁之后日志才重新接受写入。
+ *
+ * rotate() renames the current file to "<path>.<generation>" and continues in a fresh file one generation
+ * later. A registry snapshot taken right after a rotation covers every older generation, so open() only replays
+ * generations from the snapshot on and dropBefore() deletes the rest.
+ * rotate() 把当前文件重命名为 "<路径>.<代数>"，并在代数加一的新文件中继续追加。轮转之后立即生成的注册表快照
+ * 覆盖所有更早的代数，因此 open() 只回放快照之后的代数，dropBefore() 删除其余的轮转段。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-07
+ */
+class DeviceWal {
+public:
+    /// @brief Callback receiving each record while the log is replayed
+    /// @brief 回放日志时逐条接收记录的回调
+    using Replayer = std::function<void(const WalRecord&)>;
+
+    /**
+     * @brief Constructor
+     * @brief 构造函数
+     *
+     * @param path Log file path
+     * @param durability Durability level
+     * @param flushInterval Background flush interval
+     */
+    DeviceWal(std::string path, WalDurability durability, std::chrono::milliseconds flushInterval);
+
+    /**
+     * @brief Destructor: flushes and closes the log
+     * @brief 析构函数：刷盘并关闭日志
+     */
+    ~DeviceWal();
+
+    DeviceWal(const DeviceWal&) = delete;
+    auto operator=(const DeviceWal&) -> DeviceWal& = delete;
+
+    /**
+     * @brief Replay the existing log, cut off a torn tail and start appending.
+     * @brief 回放已有日志，截掉不完整的尾部并开始追加
+     *
+     * @param replay Callback receiving each valid record in order
+     * @param minGeneration Oldest generation to replay; older rotated segments are deleted
+     * @return false if the file cannot be opened or is not a device log
+     */
+    auto open(const Replayer& replay, uint64_t minGeneration = 0) -> bool;
+
+    /**
+     * @brief Flush every appended record and stop the flusher.
+     * @brief 刷写全部已追加的记录并停止刷盘线程
+     */
+    void close();
+
+    /**
+     * @brief Move the current file aside and continue in a new generation.
+     * @brief 将当前文件移到一旁，在新一代文件中继续追加
+     *
+     * Every record appended before the call ends up in the rotated segment, every later one in the new file.
+     * Appends arriving while the rotated segment is being written wait for the switch.
+     * 调用之前追加的记录都在轮转出的段中，之后的记录都在新文件中；轮转段写出期间到达的追加等待切换完成。
+     *
+     * @return The new generation, empty if rotation failed and the log is unchanged
+     */
+    auto rotate() -> std::optional<uint64_t>;
+
+    /**
+     * @brief Delete rotated segments older than a generation.
+     * @brief 删除早于指定代数的轮转段
+     *
+     * @param generation Oldest generation still needed
+     */
+    void dropBefore(uint64_t generation);
+
+    /**
+     * @brief Generation of the current log file.
+     * @brief 当前日志文件的代数
+     */
+    auto generation() const -> uint64_t;
+
+    /**
+     * @brief Log a device registration.
+     * @brief 记录设备注册
+     *
+     * @param deviceId Unique identifier of the device
+     * @return false if the log refused the record after a write error
+     */
+    auto logRegister(const std::string& deviceId) -> bool;
+
+    /**
+     * @brief Log an online/offline transition.
+     * @brief 记录在线/离线状态变化
+     *
+     * @param deviceId Unique identifier of the device
+     * @param status New status
+     * @param deferred When given, the Sync wait is left to the caller through awaitDurable()
+     * @return false if the log refused the record after a write error, or the Sync wait failed
+     */
+    auto logTransition(const std::string& deviceId, DeviceStatus status, WalTicket* deferred = nullptr) -> bool;
+
+    /**
+     * @brief Log a status report.
+     * @brief 记录状态上报
+     *
+     * @param deviceId Unique identifier of the device
+     * @param report Status payload
+     * @param details Changed attributes
+     * @param deferred When given, the Sync wait is left to the caller through awaitDurable()
+     * @return false if the log refused the record after a write error, or the Sync wait failed
+     */
+    auto logStatus(const std::string& deviceId, const std::string& report, const StatusDetails& details,
+                   WalTicket* deferred = nullptr) -> bool;
+
+    /**
+     * @brief Log a per-device heartbeat timeout.
+     * @brief 记录单设备心跳超时
+     *
+     * @param deviceId Unique identifier of the device
+     * @param timeout Heartbeat timeout, 0 for the class or default
+     * @param deferred When given, the Sync wait is left to the caller through awaitDurable()
+     * @return false if the log refused the record after a write error, or the Sync wait failed
+     */
+    auto logTimeout(const std::string& deviceId, std::chrono::milliseconds timeout, WalTicket* deferred = nullptr)
+        -> bool;
+
+    /**
+     * @brief Log an owner change.
+     * @brief 记录设备所有者变化
+     *
+     * @param deviceId Unique identifier of the device
+     * @param owner New owner, empty when unbound
+     * @param deferred When given, the Sync wait is left to the caller through awaitDurable()
+     * @return false if the log refused the record after a write error, or the Sync wait failed
+     */
+    auto logOwner(const std::string& deviceId, const std::string& owner, WalTicket* deferred = nullptr) -> bool;
+
+    /**
+     * @brief Log a batch of registrations and owner claims as one commit.
+     * @brief 将一批设备注册与所有者认领作为一次提交记录
+     *
+     * Each new device yields a registration record followed by an owner record when it has an owner; each claim
+     * yields an owner record. In Sync mode the caller waits once for the whole batch.
+     * 每个新设备记为一条注册记录，有所有者时再跟一条所有者记录；每次认领记为一条所有者记录。Sync 级别下整批只等待一次落盘。
+     *
+     * @param created Newly registered devices
+     * @param claimed Existing devices claimed by the owner of the entry
+     * @return false if the log refused the batch after a write error, or the Sync wait failed
+     */
+    auto logRegistrations(const std::vector<const DeviceRegistration*>& created,
+                          const std::vector<const DeviceRegistration*>& claimed) -> bool;
+
+    /**
+     * @brief Wait until a deferred record is durable; returns at once unless the level is Sync.
+     * @brief 等待推迟等待的记录落盘；非 Sync 级别立即返回
+     *
+     * @param ticket Ticket filled by a log call
+     * @return false if the record was refused, or the batch holding it failed to write or sync
+     */
+    auto awaitDurable(const WalTicket& ticket) -> bool;
+
+    /**
+     * @brief Whether a write error has made the log refuse appends until the next rotation.
+     * @brief 是否因写入错误而拒绝追加，直到下一次轮转
+     */
+    auto failed() const -> bool;
+
+    /**
+     * @brief Bytes of the log file, including records not flushed yet.
+     * @brief 日志文件字节数，包括尚未刷盘的记录
+     */
+    auto size() const -> uint64_t;
+
+    /**
+     * @brief Write backend in use: "io_uring" or "pwrite".
+     * @brief 使用的写入方式："io_uring" 或 "pwrite"
+     */
+    auto backend() const -> const char*;
+
+private:
+    /// @brief Linked write + fdatasync submissions through io_uring
+    /// @brief 通过 io_uring 提交链接的写入与 fdatasync
+    struct Uring;
+
+    /**
+     * @brief Append an encoded record to the pending batch, waiting for it to be durable in Sync mode.
+     * @brief 将编码后的记录追加到待写批次，Sync 级别下等待其落盘
+     *
+     * @param record Framed record
+     * @param deferred When given, receives the ticket instead of waiting
+     * @return false if the log refused the record after a write error, or the Sync wait failed
+     */
+    auto commit(const std::string& record, WalTicket* deferred = nullptr) -> bool;
+
+    /**
+     * @brief Wait under the log lock until a ticket is durable.
+     * @brief 持有日志锁时等待凭据对应的记录落盘
+     *
+     * A rotation writes out the whole previous generation first, so a ticket of an older generation is durable.
+     * 轮转会先写完上一代的全部记录，因此更早代数的凭据已经落盘。
+     *
+     * @param lock Held log lock
+     * @param ticket Record position
+     * @return false if the batch holding the record failed to write or sync
+     */
+    auto waitDurable(std::unique_lock<std::mutex>& lock, const WalTicket& ticket) -> bool;
+
+    /**
+     * @brief Whether a ticket points into a batch lost to a write error; requires the log lock.
+     * @brief 凭据是否落在因写入错误而丢失的批次中；调用方须持有日志锁
+     *
+     * @param ticket Record position
+     */
+    auto lostLocked(const WalTicket& ticket) const -> bool;
+
+    /**
+     * @brief Body of the flusher thread.
+     * @brief 刷盘线程主体
+     */
+    void flushLoop();
+
+    /**
+     * @brief Write a batch at an offset and sync it as the durability level requires.
+     * @brief 在指定偏移写入一个批次，并按持久化级别同步
+     *
+     * @param fd Log file descriptor
+     * @param batch Bytes to write
+     * @param offset File offset
+     * @return false on a write or sync error
+     */
+    auto writeBatch(int fd, const std::string& batch, uint64_t offset) -> bool;
+
+    /**
+     * @brief Map a log file and replay its records.
+     * @brief 映射日志文件并回放其中的记录
+     *
+     * @param fd Log file descriptor
+     * @param minGeneration Oldest generation to replay
+     * @param replay Record callback
+     * @param generation Output generation of the file
+     * @param valid Output length of the valid prefix including the header, 0 when nothing was replayed
+     * @return false if the file cannot be mapped or is not a device log
+     */
+    static auto scanLog(int fd, uint64_t minGeneration, const Replayer& replay, uint64_t& generation,
+                        uint64_t& valid) -> bool;
+
+    /**
+     * @brief Replay the records of a mapped log image.
+     * @brief 回放映射到内存的日志内容
+     *
+     * @param data Log contents
+     * @param size Log size
+     * @param replay Record callback
+     * @return Length of the valid prefix; anything after it is torn or corrupt
+     */
+    static auto replayImage(const char* data, uint64_t size, const Replayer& replay) -> uint64_t;
+
+    /// @brief Pending batch size that wakes the flusher before its interval
+    /// @brief 提前唤醒刷盘线程的待写批次大小
+    static constexpr size_t kFLUSH_BYTES = 1 << 20;
+
+    /// @brief Log tag
+    /// @brief 日志标签
+    static constexpr const char* kTAG = "DeviceWal";
+
+    const std::string mPath;                        // 日志文件路径 / Log file path
+    const WalDurability mDurability;                // 持久化级别 / Durability level
+    const std::chrono::milliseconds mFlushInterval; // 后台刷盘间隔 / Background flush interval
+    int mFd = -1;                                   // 日志文件描述符，轮转时在锁内替换 / Log fd, swapped under lock
+    std::unique_ptr<Uring> mUring;                  // io_uring 实例，不可用时为空 / io_uring, empty when unavailable
+
+    mutable std::mutex mMutex;            // 保护以下字段 / Guards the fields below
+    std::condition_variable mFlushWake;   // 唤醒刷盘线程 / Wakes the flusher
+    std::condition_variable mDurableWake; // 通知等待落盘的调用方 / Wakes callers waiting for durability
+    std::string mPending;                 // 待写批次 / Pending batch
+    uint64_t mGeneration = 0;             // 当前文件的代数 / Generation of the current file
+    uint64_t mAppended = 0;               // 已追加的文件末尾偏移 / File end offset including pending records
+    uint64_t mDurable = 0;                // 已写入（并按级别同步）的偏移 / Offset written and synced as configured
+    bool mRunning = false;                // 刷盘线程运行标志 / Whether the flusher runs
+    bool mRotating = false;               // 轮转中：新追加等待，刷盘线程立即写出 / Rotating: appends wait, flush now
+    bool mFailed = false;                 // 写入出错，轮转前拒绝追加 / Write failed; appends refused until rotation
+    uint64_t mLostGeneration = 0;         // 出错批次所在的代数 / Generation of the failed batch
+    uint64_t mLostFrom = UINT64_MAX;      // 出错批次的起始偏移，之后的记录均未落盘 / Start of the failed batch
+    std::thread mFlusher;                 // 后台刷盘线程 / Background flusher
+};
+
+IOT_DEVICE_NS_END
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common/NameSpaceDef.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+IOT_DEVICE_NS_BEGIN
+
+/**
+ * @brief CRC-32C (Castagnoli) of a byte range, as used by the device log and snapshot files.
+ * @brief 一段字节的 CRC-32C（Castagnoli）校验值，用于设备日志与快照文件
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU has it; the table-driven fallback gives identical results.
+ * CPU 支持时使用 SSE4.2 的 crc32 指令；查表实现的结果与之相同。
+ *
+ * @param data Bytes to checksum
+ * @param size Number of bytes
+ * @return The checksum
+ */
+auto crc32c(const char* data, size_t size) -> uint32_t;
+
+/**
+ * @brief Fsync the directory holding a file, making its creation or rename durable.
+ * @brief 同步文件所在的目录，使文件的创建或重命名落盘
+ *
+ * @param path Path of the file
+ */
+void syncDirectory(const std::string& path);
+
+IOT_DEVICE_NS_END
@@ -12,8 +12,28 @@
 
 #include "DefaultDeviceManager.h"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <functional>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
 IOT_DEVICE_NS_BEGIN
 
+namespace {
+
+/**
+ * @brief 当前 Unix 时间（毫秒），属性历史的时间戳
+ */
+auto unixMillis() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
 /**
  * @brief 注册默认设备管理器插件（Register the default device manager plugin）
  *
@@ -29,7 +49,12 @@ static PluginRegistrar<IDeviceManager> registerDefaultDeviceManager(
  * @brief Constructor
  * @brief 构造函数
  */
-DefaultDeviceManager::DefaultDeviceManager() {
+DefaultDeviceManager::DefaultDeviceManager()
+    : mIndexShards(SHARD_COUNT),
+      mHandleChunks(std::make_unique<std::atomic<HandleChunk*>[]>(kMAX_HANDLE_CHUNKS)) {
+    for (size_t i = 0; i < mIndexShards.size(); ++i) {
+        mExpiryShards.push_back(std::make_unique<ExpiryShard>(mOptions.expiryTick));
+    }
     std::cout << "[DefaultDeviceManager] Constructor\n";
 }
 
@@ -38,6 +63,12 @@ DefaultDeviceManager::DefaultDeviceManager() {
  * @brief 析构函数
  */
 DefaultDeviceManager::~DefaultDeviceManager() {
+    stopSnapshotter();
+    stopHydrator();
+    stopSweeper();
+    if (mWal) {
+        mWal->close();
+    }
     std::cout << "[DefaultDeviceManager] Destructor\n";
 }
 
@@ -55,6 +86,101 @@ void DefaultDeviceManager::init() {
  */
 void DefaultDeviceManager::shutdown() {
     std::cout << "[DefaultDeviceManager] shutdown()\n";
+    stopSnapshotter();
+    if (!mOptions.snapshotPath.empty()) {
+        writeSnapshot();
+    }
+    stopHydrator();
+    stopSweeper();
+    if (mWal) {
+        mWal->close();
+    }
+}
+
+/**
+ * @brief Apply runtime tuning options
+ * @brief 应用运行时调优参数
+ *
+ * 必须在注册设备之前调用，重建注册表会丢弃已有条目；超时扫描线程先停止，下一次注册时按新的粒度重新启动。
+ * Must run before any registration; rebuilding the registry drops existing entries. The expiry sweeper is
+ * stopped first and restarts with the new tick on the next registration.
+ *
+ * 配置了预写日志时，重建的注册表随即按日志恢复。恢复的设备都获得一次新的心跳作为宽限期：由超时判定的离线
+ * 不写入日志，仍然静默的设备会在宽限期结束后再次被判定离线。
+ * With a write-ahead log configured, the rebuilt registry is restored from it right away. Every restored device
+ * gets a fresh heartbeat as a grace period: expiry-driven offline transitions are not logged, and a device that
+ * stays silent expires again once the grace period ends.
+ *
+ * 配置了快照时先映射快照，日志只回放快照之后的代数；快照中的设备不在这里逐个插入，而是在首次访问时或由后台
+ * 线程恢复，因此启动耗时取决于日志尾部的长度，与设备总数无关。
+ * With a snapshot configured it is mapped first and the log is only replayed from the snapshot's generation on.
+ * Snapshot devices are not inserted here but on first access or by a background thread, so startup time follows
+ * the length of the log tail rather than the fleet size.
+ *
+ * @param options 分片数、心跳超时、超时扫描粒度与预写日志
+ */
+void DefaultDeviceManager::configure(const DeviceManagerOptions& options) {
+    stopSnapshotter();
+    stopHydrator();
+    stopSweeper();
+    if (mWal) {
+        mWal->close();
+        mWal.reset();
+    }
+    mSnapshot.reset();
+    mSnapshotRows.clear();
+    for (auto& count : mUnhydrated) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    mOptions = options;
+    mDevices = IOT_NS::ShardedMap<std::string, std::shared_ptr<DeviceSlot>, SHARD_COUNT>(options.shardCount);
+    mIndexShards = std::vector<IndexShard>(mDevices.shardCount());
+    mHandleChunks = std::make_unique<std::atomic<HandleChunk*>[]>(kMAX_HANDLE_CHUNKS);
+    mHandleChunkStore.clear();
+    mNextHandle.store(0, std::memory_order_relaxed);
+    mExpiryShards.clear();
+    for (size_t i = 0; i < mIndexShards.size(); ++i) {
+        mExpiryShards.push_back(std::make_unique<ExpiryShard>(
+            std::max(options.expiryTick, std::chrono::milliseconds(1))));
+    }
+
+    if (!options.snapshotPath.empty()) {
+        mSnapshot = DeviceSnapshot::open(options.snapshotPath);
+        if (mSnapshot) {
+            // 只扫描一字节宽的状态列，使恢复期间的统计无需等待
+            for (size_t row = 0; row < mSnapshot->size(); ++row) {
+                mUnhydrated[static_cast<size_t>(mSnapshot->status(row))].fetch_add(1, std::memory_order_relaxed);
+            }
+            mHydrating.store(true, std::memory_order_release);
+            std::cout << "[DefaultDeviceManager] Mapped snapshot " << options.snapshotPath << " with "
+                      << mSnapshot->size() << " devices" << std::endl;
+        }
+    }
+    if (!options.walPath.empty()) {
+        auto wal = std::make_unique<DeviceWal>(options.walPath, options.walDurability, options.walFlushInterval);
+        if (wal->open([this](const WalRecord& record) { replayRecord(record); },
+                      mSnapshot ? mSnapshot->walGeneration() : 0)) {
+            mWal = std::move(wal);
+        } else {
+            std::cerr << kTAG << ": write-ahead log disabled" << std::endl;
+        }
+    }
+
+    uint32_t restored = mNextHandle.load(std::memory_order_relaxed);
+    if (restored > 0 || mSnapshot) {
+        startSweeper();
+        mDevices.forEach([this](const std::string&, const std::shared_ptr<DeviceSlot>& slot) {
+            if (slot->status.load(std::memory_order_relaxed) == DeviceStatus::ONLINE) {
+                armExpiry(*slot);
+            }
+        });
+    }
+    if (restored > 0) {
+        std::cout << "[DefaultDeviceManager] Restored " << restored << " devices from " << options.walPath
+                  << std::endl;
+    }
+    startHydrator();
+    startSnapshotter();
 }
 
 /**
@@ -66,21 +192,226 @@ void DefaultDeviceManager::shutdown() {
  * @return false 设备已存在
  */
 auto DefaultDeviceManager::registerDevice(const std::string& deviceId) -> bool {
-    if (mDevices.contains(deviceId)) {
+    DeviceHandle handle;
+    return registerDevice(deviceId, handle);
+}
+
+/**
+ * @brief Register a device and return its handle
+ * @brief 注册设备并返回其句柄
+ *
+ * 句柄按注册顺序稠密分配；句柄表写满时设备仍可注册，只是没有句柄，只能按 ID 访问。
+ * Handles are assigned densely in registration order; once the handle table is full devices still register,
+ * without a handle, and are reachable by ID only.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param outHandle 输出的句柄，设备已存在时为其原有句柄
+ * @return true 新注册；false 设备已存在
+ */
+auto DefaultDeviceManager::registerDevice(const std::string& deviceId, DeviceHandle& outHandle) -> bool {
+    return registerDevice(deviceId, {}, outHandle);
+}
+
+/**
+ * @brief Register a device on behalf of an owner and return its handle
+ * @brief 代表所有者注册设备并返回其句柄
+ *
+ * 新设备在插入注册表的同一临界区内计入所有者索引；已存在的设备只在尚未绑定时由该所有者认领。
+ * A new device enters the owner index in the same critical section that inserts it into the registry; an
+ * existing device is only claimed by the owner while it has none.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param owner 所有者，为空表示不绑定
+ * @param outHandle 输出的句柄，设备已存在时为其原有句柄
+ * @return true 新注册；false 设备已存在
+ */
+auto DefaultDeviceManager::registerDevice(const std::string& deviceId, const std::string& owner,
+                                          DeviceHandle& outHandle) -> bool {
+    bool created = false;
+    auto slot = insertSlot(deviceId, created, std::nullopt, owner);
+    outHandle = slot->handle;
+    if (!created) {
+        if (!owner.empty()) {
+            bool claimed = false;
+            {
+                auto& shard = indexShardOf(deviceId);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                claimed = bindOwner(shard, slot, owner, true);
+            }
+            if (claimed && mWal) {
+                mWal->logOwner(deviceId, owner);
+            }
+        }
         return false;
     }
+    if (mWal) {
+        mWal->logRegister(deviceId);
+        if (!owner.empty()) {
+            mWal->logOwner(deviceId, owner);
+        }
+    }
+
+    startSweeper();
+    armExpiry(*slot);
+    std::cout << "[DefaultDeviceManager] Device registered: " << deviceId << std::endl;
+    emitEvent(DeviceEvent::Type::Online, *slot);
+    return true;
+}
 
-    DeviceInfo info;
-    info.status = DeviceStatus::ONLINE;
-    info.lastHeartbeat = std::chrono::steady_clock::now();
-    info.lastStatusReport.clear();
+/**
+ * @brief Register a batch of devices
+ * @brief 批量注册设备
+ *
+ * 先按注册表分片划分批次，再由最多 hardware_concurrency 个线程各自领取整个分片装载，分片之间互不竞争锁；
+ * 批次内的重复在各分片内剔除。新设备与逐个注册时一样分配句柄并挂入超时时间轮，但不逐个发出上线事件，
+ * 整批结束后只发出一个 Resync 事件，订阅者据此重新加载快照，也只打印一行汇总日志。
+ * 快照尚在恢复时先等待恢复完成，而不是与恢复线程争抢分片锁。
+ * The batch is first partitioned by registry shard, then up to hardware_concurrency threads each claim whole
+ * shards, so they never contend for a lock. Duplicates within the batch are dropped inside each shard. New
+ * devices get handles and expiry timers exactly as when registered one at a time, but instead of an Online event
+ * each, a single Resync event follows the whole batch and watchers reload a snapshot from it; only one summary
+ * line is logged. A snapshot still hydrating is waited for first rather than fought over shard locks.
+ *
+ * @param devices 待注册的设备
+ * @param outResult 输出的批次统计
+ * @return 始终为 true
+ */
+auto DefaultDeviceManager::registerDevices(const std::vector<DeviceRegistration>& devices,
+                                           DeviceImportResult& outResult) -> bool {
+    awaitHydration();
+    auto start = std::chrono::steady_clock::now();
+    outResult = {};
+    std::vector<std::vector<const DeviceRegistration*>> shards(mDevices.shardCount());
+    for (const auto& device : devices) {
+        if (device.deviceId.empty()) {
+            ++outResult.rejected;
+            continue;
+        }
+        shards[mDevices.shardIndexOf(device.deviceId)].push_back(&device);
+    }
+    if (devices.size() > outResult.rejected) {
+        startSweeper();
+    }
 
-    mDevices.insert(deviceId, std::move(info));
+    // 小批次不值得启动线程
+    size_t workers = devices.size() < kIMPORT_CHUNK
+        ? 1
+        : std::clamp<size_t>(std::thread::hardware_concurrency(), 1, shards.size());
+    std::vector<DeviceImportResult> tallies(workers);
+    std::atomic<size_t> nextShard { 0 };
+    auto work = [this, &shards, &tallies, &nextShard](size_t worker) {
+        for (size_t index; (index = nextShard.fetch_add(1, std::memory_order_relaxed)) < shards.size();) {
+            registerShard(index, shards[index], tallies[worker]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t worker = 1; worker < workers; ++worker) {
+        threads.emplace_back(work, worker);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& tally : tallies) {
+        outResult.registered += tally.registered;
+        outResult.existing += tally.existing;
+        outResult.duplicates += tally.duplicates;
+    }
 
-    std::cout << "[DefaultDeviceManager] Device registered: " << deviceId << std::endl;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "[DefaultDeviceManager] Registered " << outResult.registered << " of " << devices.size()
+              << " devices (" << outResult.existing << " existing, " << outResult.duplicates << " duplicates, "
+              << outResult.rejected << " rejected) with " << workers << " threads in " << elapsed.count() << " ms"
+              << std::endl;
+    if (outResult.registered > 0) {
+        emitResync();
+    }
     return true;
 }
 
+/**
+ * @brief Register the devices of one registry shard
+ * @brief 注册属于同一注册表分片的设备
+ *
+ * 每块设备只获取一次注册表分片锁，索引锁在其内首次需要时获取，加锁顺序与 insertSlot() 相同。
+ * 写日志与挂入时间轮都在锁外按块进行；不发出逐设备事件，由 registerDevices() 在整批结束后统一发出 Resync。
+ * Each chunk takes the registry shard lock once, and the index lock inside it when first needed, in the same
+ * order as insertSlot(). Logging and arming expiry timers happen per chunk outside the locks; no per-device
+ * events are emitted, registerDevices() emits one Resync once the whole batch is in.
+ *
+ * @param shardIndex 全部设备所在的注册表分片
+ * @param devices 该分片的设备
+ * @param outResult 累加该分片的统计
+ */
+void DefaultDeviceManager::registerShard(size_t shardIndex, const std::vector<const DeviceRegistration*>& devices,
+                                         DeviceImportResult& outResult) {
+    auto& shard = mIndexShards[shardIndex];
+    std::unordered_set<std::string_view> seen;
+    seen.reserve(devices.size());
+    std::vector<const DeviceRegistration*> chunk;
+    std::vector<const DeviceRegistration*> created;
+    std::vector<const DeviceRegistration*> claimed;
+    std::vector<std::shared_ptr<DeviceSlot>> armed;
+    auto idOf = [](const DeviceRegistration* device) -> const std::string& { return device->deviceId; };
+    for (size_t next = 0; next < devices.size();) {
+        chunk.clear();
+        for (; next < devices.size() && chunk.size() < kIMPORT_CHUNK; ++next) {
+            if (seen.insert(devices[next]->deviceId).second) {
+                chunk.push_back(devices[next]);
+            } else {
+                ++outResult.duplicates;
+            }
+        }
+
+        created.clear();
+        claimed.clear();
+        armed.clear();
+        {
+            std::unique_lock<std::mutex> indexLock(shard.mutex, std::defer_lock);
+            bool fresh = false;
+            mDevices.getOrInsertMany(
+                shardIndex, chunk, idOf,
+                [&](const DeviceRegistration* device) {
+                    std::optional<size_t> row;
+                    auto slot = makeSlot(device->deviceId, row);
+                    // 索引锁在注册表分片锁内获取，整块只获取一次
+                    if (!indexLock.owns_lock()) {
+                        indexLock.lock();
+                    }
+                    indexSlot(shard, slot, row.has_value(), device->owner);
+                    fresh = !row;
+                    if (slot->status.load(std::memory_order_relaxed) == DeviceStatus::ONLINE) {
+                        armed.push_back(slot);
+                    }
+                    return slot;
+                },
+                [&](const DeviceRegistration* device, const std::shared_ptr<DeviceSlot>& slot, bool inserted) {
+                    if (inserted && std::exchange(fresh, false)) {
+                        created.push_back(device);
+                        return;
+                    }
+                    ++outResult.existing;
+                    if (!device->owner.empty()) {
+                        if (!indexLock.owns_lock()) {
+                            indexLock.lock();
+                        }
+                        if (bindOwner(shard, slot, device->owner, true)) {
+                            claimed.push_back(device);
+                        }
+                    }
+                });
+        }
+
+        if (mWal) {
+            mWal->logRegistrations(created, claimed);
+        }
+        for (const auto& slot : armed) {
+            armExpiry(*slot);
+        }
+        outResult.registered += created.size();
+    }
+}
+
 /**
  * @brief Refresh heartbeat time of a device
  * @brief 刷新设备的心跳时间
@@ -88,16 +419,123 @@ auto DefaultDeviceManager::registerDevice(const std::string& deviceId) -> bool {
  * @param deviceId 设备唯一标识符
  */
 void DefaultDeviceManager::refreshDeviceHeartbeat(const std::string& deviceId) {
-    auto opt = mDevices.get(deviceId);
-    if (opt.has_value()) {
-        auto& info = opt.value();
-        info.lastHeartbeat = std::chrono::steady_clock::now();
-        info.status = DeviceStatus::ONLINE;
-        mDevices.insert(deviceId, info); // 更新信息
-        std::cout << "[DefaultDeviceManager] Heartbeat refreshed for device: " << deviceId << std::endl;
+    auto slot = acquireSlot(deviceId);
+    if (slot) {
+        refreshDeviceHeartbeat(*slot);
+    }
+}
+
+/**
+ * @brief Acquire the registry slot of a device
+ * @brief 获取设备的注册表槽位
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 设备槽位，未注册时返回 nullptr
+ */
+auto DefaultDeviceManager::acquireSlot(const std::string& deviceId) -> std::shared_ptr<DeviceSlot> {
+    if (auto slot = mDevices.get(deviceId)) {
+        return *slot;
+    }
+    if (!mSnapshot) {
+        return nullptr;
+    }
+    if (!mHydrating.load(std::memory_order_acquire)) {
+        // 恢复线程在清除标志之前已插入全部设备；再查一次，以免与其最后的插入交错
+        // The hydrator inserts every row before clearing the flag; look again in case its last inserts raced ours
+        return mDevices.get(deviceId).value_or(nullptr);
+    }
+    if (!mSnapshot->find(deviceId)) {
+        return nullptr;
+    }
+    bool created = false;
+    return insertSlot(deviceId, created);
+}
+
+/**
+ * @brief Lock-free heartbeat refresh on a registry slot
+ * @brief 在注册表槽位上无锁刷新心跳
+ *
+ * 只写入原子时间戳，不触碰超时时间轮与索引；仅当设备由非在线变为在线时才加锁更新索引、重新挂入时间轮并发出上线事件。
+ * Only stores the atomic timestamp and leaves the expiry wheel and the indexes alone; only when the device was not
+ * online are the indexes updated under their lock, the device put back on the wheel and an online event emitted.
+ *
+ * @param slot 设备注册表槽位
+ */
+void DefaultDeviceManager::refreshDeviceHeartbeat(DeviceSlot& slot) {
+    slot.lastHeartbeat.store(DeviceSlot::Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    WalTicket logged;
+    if (slot.status.load(std::memory_order_relaxed) != DeviceStatus::ONLINE &&
+        setStatus(slot, DeviceStatus::ONLINE, std::nullopt, &logged)) {
+        if (mWal) {
+            mWal->awaitDurable(logged);
+        }
+        armExpiry(slot);
+        emitEvent(DeviceEvent::Type::Online, slot);
+    }
+}
+
+/**
+ * @brief Resolve the handle of a registered device
+ * @brief 解析已注册设备的句柄
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 设备句柄，未注册时为无效句柄
+ */
+auto DefaultDeviceManager::acquireHandle(const std::string& deviceId) -> DeviceHandle {
+    auto slot = acquireSlot(deviceId);
+    return slot ? slot->handle : kINVALID_DEVICE_HANDLE;
+}
+
+/**
+ * @brief Lock-free heartbeat refresh by handle
+ * @brief 按句柄无锁刷新心跳
+ *
+ * @param handle 设备句柄
+ */
+void DefaultDeviceManager::refreshDeviceHeartbeat(DeviceHandle handle) {
+    if (auto* slot = slotOf(handle)) {
+        refreshDeviceHeartbeat(*slot);
     }
 }
 
+/**
+ * @brief Report device status by handle
+ * @brief 按句柄上报设备状态
+ *
+ * @param handle 设备句柄
+ * @param status 状态信息
+ * @param details 变化的属性，空值表示删除
+ * @return true 上报成功；false 句柄无效
+ */
+auto DefaultDeviceManager::reportStatus(DeviceHandle handle, const std::string& status, const StatusDetails& details)
+    -> bool {
+    auto* slot = slotOf(handle);
+    if (!slot) {
+        return false;
+    }
+    applyStatus(*slot, std::string(status), details);
+    std::cout << "[DefaultDeviceManager] Status reported for device: " << slot->deviceId << std::endl;
+    return true;
+}
+
+/**
+ * @brief Get device info by handle
+ * @brief 按句柄获取设备信息
+ *
+ * @param handle 设备句柄
+ * @param outInfo 输出的设备信息结构体
+ * @return true 获取成功；false 句柄无效
+ */
+auto DefaultDeviceManager::getDeviceInfo(DeviceHandle handle, DeviceInfo& outInfo) -> bool {
+    auto* slot = slotOf(handle);
+    if (!slot) {
+        return false;
+    }
+    outInfo = slot->snapshot();
+    outInfo.status = effectiveStatus(*slot, DeviceSlot::Clock::now());
+    return true;
+}
+
 /**
  * @brief Mark a device as offline
  * @brief 将设备标记为离线状态
@@ -105,15 +543,84 @@ void DefaultDeviceManager::refreshDeviceHeartbeat(const std::string& deviceId) {
  * @param deviceId 设备唯一标识符
  */
 void DefaultDeviceManager::markDeviceOffline(const std::string& deviceId) {
-    auto opt = mDevices.get(deviceId);
-    if (opt.has_value()) {
-        auto& info = opt.value();
-        info.status = DeviceStatus::OFFLINE;
-        mDevices.insert(deviceId, info); // 更新信息
+    auto slot = acquireSlot(deviceId);
+    if (slot) {
+        WalTicket logged;
+        bool changed = setStatus(*slot, DeviceStatus::OFFLINE, std::nullopt, &logged);
         std::cout << "[DefaultDeviceManager] Device marked offline: " << deviceId << std::endl;
+        if (changed) {
+            if (mWal) {
+                mWal->awaitDurable(logged);
+            }
+            emitEvent(DeviceEvent::Type::Offline, *slot);
+        }
     }
 }
 
+/**
+ * @brief Override the heartbeat timeout of one device
+ * @brief 单独设置某个设备的心跳超时
+ *
+ * 已挂入的定时器仍按旧的截止时间触发，因此在线设备会按新的截止时间补挂一个定时器，旧定时器随之失效；
+ * 超时缩短后设备也能在新的截止时间附近被判定离线。
+ * The armed timer still fires at the old deadline, so an online device gets a fresh timer at the new deadline
+ * and the old one is retired; a shortened timeout thus expires the device close to its new deadline.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param timeout 心跳超时，0 表示恢复类别或默认值
+ * @return true 设置成功；false 设备未注册，或日志写入失败（内存中的设置仍生效）
+ */
+auto DefaultDeviceManager::setHeartbeatTimeout(const std::string& deviceId, std::chrono::milliseconds timeout)
+    -> bool {
+    auto slot = acquireSlot(deviceId);
+    if (!slot) {
+        return false;
+    }
+    auto effective = timeout.count() > 0 ? timeout : classTimeout(deviceId);
+    WalTicket logged;
+    {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        slot->heartbeatTimeoutMs.store(effective.count(), std::memory_order_relaxed);
+        if (mWal) {
+            mWal->logTimeout(deviceId, timeout, &logged);
+        }
+    }
+    bool durable = !mWal || mWal->awaitDurable(logged);
+    if (mSweeping.load(std::memory_order_acquire) &&
+        slot->status.load(std::memory_order_acquire) == DeviceStatus::ONLINE) {
+        slot->expiryArmed.store(true, std::memory_order_relaxed);
+        scheduleExpiry(*slot);
+    }
+    return durable;
+}
+
+/**
+ * @brief Bind a registered device to another owner
+ * @brief 将已注册设备改绑到其他所有者
+ *
+ * 所有者不变时既不修改索引也不记录日志。
+ * An unchanged owner neither touches the index nor writes to the log.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param owner 新的所有者，为空表示解除绑定
+ * @return true 设置成功；false 设备未注册，或日志写入失败（内存中的绑定仍生效）
+ */
+auto DefaultDeviceManager::setDeviceOwner(const std::string& deviceId, const std::string& owner) -> bool {
+    auto slot = acquireSlot(deviceId);
+    if (!slot) {
+        return false;
+    }
+    WalTicket logged;
+    {
+        auto& shard = indexShardOf(deviceId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (bindOwner(shard, slot, owner, false) && mWal) {
+            mWal->logOwner(deviceId, owner, &logged);
+        }
+    }
+    return !mWal || mWal->awaitDurable(logged);
+}
+
 /**
  * @brief Report status for a device
  * @brief 上报设备状态信息
@@ -122,17 +629,54 @@ void DefaultDeviceManager::markDeviceOffline(const std::string& deviceId) {
  * @param status 状态字符串（例如 JSON/XML）
  */
 void DefaultDeviceManager::reportStatus(const std::string& deviceId, const std::string& status) {
-    auto opt = mDevices.get(deviceId);
-    if (opt.has_value()) {
-        auto& info = opt.value();
-        info.lastStatusReport = status;
-        info.lastHeartbeat = std::chrono::steady_clock::now();
-        info.status = DeviceStatus::ONLINE;
-        mDevices.insert(deviceId, info); // 更新信息
+    reportStatus(deviceId, status, {});
+}
+
+/**
+ * @brief Report device status and merge changed structured attributes
+ * @brief 上报设备状态并合并变化的结构化属性
+ *
+ * @param deviceId 设备唯一标识符
+ * @param status 状态信息
+ * @param details 变化的属性，空值表示删除
+ */
+void DefaultDeviceManager::reportStatus(const std::string& deviceId, const std::string& status,
+                                        const StatusDetails& details) {
+    auto slot = acquireSlot(deviceId);
+    if (slot) {
+        applyStatus(*slot, std::string(status), details);
         std::cout << "[DefaultDeviceManager] Status reported for device: " << deviceId << std::endl;
     }
 }
 
+/**
+ * @brief Report status for many devices at once
+ * @brief 批量上报设备状态信息
+ *
+ * 每条只做一次分片查找和一次槽位加锁，状态内容直接移入槽位；整批只输出一条日志。
+ * Each entry costs one shard lookup and one slot lock, with the payload moved into the slot; the whole batch
+ * logs a single line.
+ *
+ * @param updates 状态上报批次
+ * @return 设备未注册或上报未能写入日志的条目下标
+ */
+auto DefaultDeviceManager::reportStatusBatch(std::vector<DeviceStatusUpdate>& updates) -> std::vector<uint32_t> {
+    std::vector<uint32_t> unknown;
+    for (uint32_t i = 0; i < updates.size(); ++i) {
+        auto slot = acquireSlot(updates[i].deviceId);
+        if (!slot) {
+            unknown.push_back(i);
+            continue;
+        }
+        if (!applyStatus(*slot, std::move(updates[i].status), updates[i].details)) {
+            unknown.push_back(i);
+        }
+    }
+    std::cout << "[DefaultDeviceManager] Status batch reported: " << updates.size() - unknown.size() << "/"
+              << updates.size() << std::endl;
+    return unknown;
+}
+
 /**
  * @brief Check if a device is online based on heartbeat timeout
  * @brief 根据心跳超时时间判断设备是否在线
@@ -142,22 +686,22 @@ void DefaultDeviceManager::reportStatus(const std::string& deviceId, const std::
  * @return false 设备离线或不存在
  */
 auto DefaultDeviceManager::isDeviceOnline(const std::string& deviceId) -> bool {
-    auto opt = mDevices.get(deviceId);
-    if (!opt.has_value()) {
+    auto slot = acquireSlot(deviceId);
+    if (!slot) {
         return false;
     }
 
-    auto& info = opt.value();
+    // 扫描线程两次推进之间，查询方自己按心跳超时判定
     auto now = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - info.lastHeartbeat).count();
-
-    if (duration > 30) {
-        info.status = DeviceStatus::OFFLINE;
-        mDevices.insert(deviceId, info); // 更新为离线状态
+    if (now - slot->heartbeatTime() > timeoutOf(*slot)) {
+        // 仅由在线切换为离线的调用方发出离线事件
+        if (setStatus(*slot, DeviceStatus::OFFLINE, DeviceStatus::ONLINE)) {
+            emitEvent(DeviceEvent::Type::Offline, *slot);
+        }
         return false;
     }
 
-    return info.status == DeviceStatus::ONLINE;
+    return slot->status.load(std::memory_order_acquire) == DeviceStatus::ONLINE;
 }
 
 /**
@@ -170,13 +714,1288 @@ auto DefaultDeviceManager::isDeviceOnline(const std::string& deviceId) -> bool {
  * @return false 设备不存在
  */
 auto DefaultDeviceManager::getDeviceInfo(const std::string& deviceId, DeviceInfo& outInfo) -> bool {
-    auto opt = mDevices.get(deviceId);
-    if (!opt.has_value()) {
+    auto slot = acquireSlot(deviceId);
+    if (!slot) {
+        return false;
+    }
+
+    outInfo = slot->snapshot();
+    outInfo.status = effectiveStatus(*slot, DeviceSlot::Clock::now());
+    return true;
+}
+
+/**
+ * @brief Check whether a registered device is visible to a user
+ * @brief 检查已注册设备对用户是否可见
+ *
+ * 只在槽位锁内比较所有者，不复制设备信息。
+ * Only the owner is compared under the slot lock; no device info is copied.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param viewer 查询的用户
+ * @return true 设备已注册且归属该用户或尚未绑定所有者
+ */
+auto DefaultDeviceManager::isDeviceVisibleTo(const std::string& deviceId, const std::string& viewer) -> bool {
+    auto slot = acquireSlot(deviceId);
+    return slot && visibleTo(*slot, viewer);
+}
+
+/**
+ * @brief List devices matching a query, one page at a time
+ * @brief 分页列出匹配查询条件的设备
+ *
+ * 按（索引分片，注册顺序）遍历，游标记为 "分片:位置"。每次只在索引分片锁内复制 kSCAN_CHUNK 个槽位指针，
+ * 过滤与生成结果都在锁外进行，因此即使列出数百万设备，单次持锁时间也与设备总数无关，心跳与注册不会被阻塞。
+ * Devices are walked in (index shard, registration order) and the cursor reads "shard:position". Only
+ * kSCAN_CHUNK slot pointers are copied per lock of an index shard, and filtering and record building happen
+ * outside it, so no single lock hold grows with the fleet size and heartbeats and registrations are never
+ * stalled, even when listing millions of devices.
+ *
+ * 指定所有者时改为遍历各分片中该所有者的列表，游标格式不变；设备在翻页期间改绑可能导致其后一个设备被跳过。
+ * 只指定状态时改由 listByStatus() 扫描状态位图。快照恢复期间不等待恢复完成：每个分片在遍历之前才恢复。
+ * With an owner, the owner's list in each shard is walked instead, with the same cursor format; a device changing
+ * owner between pages may cause the one after it to be skipped. With only a status, listByStatus() scans the
+ * status bitmaps instead. While the snapshot is hydrating nothing waits for it: each shard is hydrated just
+ * before it is walked.
+ *
+ * @param query 过滤条件、游标与每页数量
+ * @param outPage 输出的一页结果
+ * @return true 成功；false 游标格式错误或超出范围
+ */
+auto DefaultDeviceManager::listDevices(const DeviceQuery& query, DevicePage& outPage) -> bool {
+    constexpr size_t kSCAN_CHUNK = 256; // 每次加锁复制的槽位数
+
+    outPage = {};
+
+    // 属性名只解析一次；从未上报过的属性名不可能匹配任何设备
+    std::vector<std::pair<AttributeKey, const AttributeFilter*>> attributeFilters;
+    attributeFilters.reserve(query.attributes.size());
+    for (const auto& filter : query.attributes) {
+        auto key = AttributeKeys::instance().find(filter.key);
+        if (!key) {
+            return true;
+        }
+        attributeFilters.emplace_back(*key, &filter);
+    }
+
+    size_t limit = std::clamp<size_t>(query.limit, 1, kMAX_PAGE_SIZE);
+    auto now = DeviceSlot::Clock::now();
+    auto accept = [&](const DeviceSlot& slot) {
+        auto status = effectiveStatus(slot, now);
+        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - slot.heartbeatTime());
+        if ((query.status && status != *query.status) ||
+            (query.minHeartbeatAge.count() > 0 && age < query.minHeartbeatAge) ||
+            (query.maxHeartbeatAge.count() > 0 && age > query.maxHeartbeatAge) ||
+            (!query.viewer.empty() && !visibleTo(slot, query.viewer)) ||
+            (!attributeFilters.empty() && !matchesAttributes(slot, attributeFilters))) {
+            return false;
+        }
+        if (query.countOnly) {
+            ++outPage.count;
+            return false;
+        }
+        DeviceRecord record { slot.deviceId, slot.snapshot() };
+        record.info.status = status;
+        outPage.devices.push_back(std::move(record));
+        return outPage.devices.size() == limit;
+    };
+
+    // 没有句柄的设备不在位图中，句柄表写满后退回全量遍历。快照恢复期间尚未恢复的设备也不在位图中，
+    // 因此新的查询改为逐分片遍历；已开始的分页沿用其游标所属的方式
+    bool byHandle = query.cursor.empty() ? !mHydrating.load(std::memory_order_acquire) : query.cursor[0] == '#';
+    if (query.status && query.owner.empty() && byHandle &&
+        mNextHandle.load(std::memory_order_acquire) < kMAX_HANDLE_CHUNKS * kHANDLE_CHUNK_SIZE) {
+        return listByStatus(query, accept, outPage);
+    }
+
+    size_t shardIndex = 0;
+    size_t position = 0;
+    if (!query.cursor.empty()) {
+        const char* begin = query.cursor.data();
+        const char* end = begin + query.cursor.size();
+        auto [sep, ec1] = std::from_chars(begin, end, shardIndex);
+        if (ec1 != std::errc {} || sep == end || *sep != ':') {
+            return false;
+        }
+        auto [last, ec2] = std::from_chars(sep + 1, end, position);
+        if (ec2 != std::errc {} || last != end || shardIndex >= mIndexShards.size()) {
+            return false;
+        }
+    }
+
+    std::vector<std::shared_ptr<DeviceSlot>> chunk;
+    chunk.reserve(kSCAN_CHUNK);
+    for (; shardIndex < mIndexShards.size(); ++shardIndex, position = 0) {
+        hydrateShard(shardIndex);
+        const auto& shard = mIndexShards[shardIndex];
+        while (true) {
+            chunk.clear();
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                const std::vector<std::shared_ptr<DeviceSlot>>* slots = &shard.slots;
+                if (!query.owner.empty()) {
+                    // 所有者列表会因改绑而缩短，越界的位置视为该分片已遍历完
+                    auto owned = shard.owners.find(query.owner);
+                    if (owned == shard.owners.end() || position >= owned->second.size()) {
+                        break;
+                    }
+                    slots = &owned->second;
+                } else if (position > slots->size()) {
+                    return false;
+                }
+                auto first = slots->begin() + static_cast<std::ptrdiff_t>(position);
+                auto last =
+                    slots->begin() + static_cast<std::ptrdiff_t>(std::min(slots->size(), position + kSCAN_CHUNK));
+                chunk.assign(first, last);
+            }
+            if (chunk.empty()) {
+                break;
+            }
+
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                if (accept(*chunk[i])) {
+                    outPage.nextCursor = std::to_string(shardIndex) + ":" + std::to_string(position + i + 1);
+                    return true;
+                }
+            }
+            position += chunk.size();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Serve a listing filtered by status from the status bitmaps
+ * @brief 基于状态位图处理按状态过滤的列表查询
+ *
+ * 每次读取一个 64 位的字，只访问其中置位的设备，因此少见状态（如 ERROR）的列出与计数几乎只取决于句柄总数的
+ * 1/64。列出离线设备时同时扫描在线位图：心跳已超时、但尚未被超时扫描标记的设备按离线处理。
+ * Each 64-bit word is read once and only its set bits are visited, so listing or counting a rare status such as
+ * ERROR costs little more than 1/64 of the handle count. Listing offline devices scans the online bitmap too:
+ * devices past their heartbeat deadline that the sweeper has not marked yet count as offline.
+ *
+ * @param query 过滤条件、游标与每页数量，游标记为 "#句柄"
+ * @param accept 过滤设备并加入本页，本页已满时返回 true
+ * @param outPage 输出的一页结果
+ * @return true 成功；false 游标格式错误
+ */
+auto DefaultDeviceManager::listByStatus(const DeviceQuery& query, const std::function<bool(const DeviceSlot&)>& accept,
+                                        DevicePage& outPage) -> bool {
+    uint32_t from = 0;
+    if (!query.cursor.empty()) {
+        const char* end = query.cursor.data() + query.cursor.size();
+        auto [last, ec] = std::from_chars(query.cursor.data() + 1, end, from);
+        if (query.cursor[0] != '#' || ec != std::errc {} || last != end) {
+            return false;
+        }
+    }
+
+    auto wanted = static_cast<size_t>(*query.status);
+    bool withOnline = *query.status == DeviceStatus::OFFLINE;
+    uint32_t handles = mNextHandle.load(std::memory_order_acquire);
+    for (uint32_t index = from; index < handles;) {
+        auto* chunk = mHandleChunks[index >> kHANDLE_CHUNK_BITS].load(std::memory_order_acquire);
+        uint32_t offset = index & (kHANDLE_CHUNK_SIZE - 1);
+        if (!chunk) {
+            index += kHANDLE_CHUNK_SIZE - offset;
+            continue;
+        }
+        size_t word = offset / 64;
+        uint64_t bits = chunk->members[wanted][word].load(std::memory_order_acquire);
+        if (withOnline) {
+            bits |= chunk->members[static_cast<size_t>(DeviceStatus::ONLINE)][word].load(std::memory_order_acquire);
+        }
+        bits &= ~uint64_t { 0 } << (offset % 64);
+        uint32_t wordStart = index - offset % 64;
+        for (; bits != 0; bits &= bits - 1) {
+            uint32_t handle = wordStart + static_cast<uint32_t>(std::countr_zero(bits));
+            auto* slot = chunk->slots[handle & (kHANDLE_CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+            if (slot && accept(*slot)) {
+                outPage.nextCursor = "#" + std::to_string(handle + 1);
+                return true;
+            }
+        }
+        index = wordStart + 64;
+    }
+    return true;
+}
+
+/**
+ * @brief Read the recorded history of a numeric attribute
+ * @brief 读取数值属性的历史记录
+ *
+ * 降采样时时间桶从查询起点按步长对齐，每个非空的桶给出平均值、最小值、最大值与样本数。
+ * Downsampling aligns buckets to the query start in steps; every non-empty bucket yields the average, minimum,
+ * maximum and sample count.
+ *
+ * @param query 设备、属性、时间范围与步长
+ * @param outPoints 输出的点
+ * @return false 设备未注册
+ */
+auto DefaultDeviceManager::getDeviceHistory(const HistoryQuery& query, std::vector<HistoryPoint>& outPoints)
+    -> bool {
+    outPoints.clear();
+    auto slot = acquireSlot(query.deviceId);
+    if (!slot) {
         return false;
     }
+    auto key = AttributeKeys::instance().find(query.attribute);
+    if (!key) {
+        return true;
+    }
+    int64_t toMs = query.toMs > 0 ? query.toMs : unixMillis();
+    int64_t step = query.step.count();
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    const TimeSeries* series = slot->history ? slot->history->find(*key) : nullptr;
+    if (!series) {
+        return true;
+    }
+    series->range(query.fromMs, toMs, [&](int64_t timestampMs, double value) {
+        if (step <= 0) {
+            outPoints.push_back({ timestampMs, value, value, value, 1 });
+            return;
+        }
+        int64_t bucket = query.fromMs + (timestampMs - query.fromMs) / step * step;
+        if (outPoints.empty() || outPoints.back().timestampMs != bucket) {
+            outPoints.push_back({ bucket, value, value, value, 1 });
+            return;
+        }
+        auto& point = outPoints.back();
+        point.value += value;
+        point.min = std::min(point.min, value);
+        point.max = std::max(point.max, value);
+        ++point.count;
+    });
+    if (step > 0) {
+        for (auto& point : outPoints) {
+            point.value /= point.count;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Count registered devices per status
+ * @brief 按状态统计已注册设备数量
+ *
+ * 代价与分片数成正比，与设备数无关。各分片的计数器在锁内成对修改，不加锁读取时正在变化的设备可能被少计或多计一次。
+ * 快照恢复期间，尚未恢复的行按快照中存储的状态计入，无需等待恢复完成。
+ * Costs one pass over the shards regardless of the fleet size. Each shard's counters change in pairs under its
+ * lock; read without it, a device moving at that instant may be counted zero times or twice. While the snapshot
+ * is hydrating, rows not restored yet count under their stored status, so nothing waits for hydration.
+ *
+ * @param outCounts 输出的数量
+ * @return 始终为 true
+ */
+auto DefaultDeviceManager::countDevices(DeviceCounts& outCounts) -> bool {
+    outCounts = {};
+    auto add = [&outCounts](size_t status, int64_t value) {
+        auto count = static_cast<uint64_t>(std::max<int64_t>(value, 0));
+        outCounts.byStatus[status] += count;
+        outCounts.total += count;
+    };
+    for (const auto& shard : mIndexShards) {
+        for (size_t status = 0; status < kDEVICE_STATUS_COUNT; ++status) {
+            add(status, shard.counts[status].load());
+        }
+    }
+    for (size_t status = 0; status < kDEVICE_STATUS_COUNT; ++status) {
+        add(status, mUnhydrated[status].load(std::memory_order_relaxed));
+    }
+    return true;
+}
+
+/**
+ * @brief Status adjusted for the heartbeat timeout
+ * @brief 按心跳超时折算后的设备状态
+ *
+ * 与 isDeviceOnline 的判断一致，但只读不写，列表查询不会改变设备状态或发出事件。
+ * Same rule as isDeviceOnline, but read-only: a listing never changes device state or emits events.
+ *
+ * @param slot 设备注册表槽位
+ * @param now 当前时间点
+ * @return DeviceStatus 折算后的状态
+ */
+auto DefaultDeviceManager::effectiveStatus(const DeviceSlot& slot, DeviceSlot::Clock::time_point now) const
+    -> DeviceStatus {
+    auto status = slot.status.load(std::memory_order_acquire);
+    if (status == DeviceStatus::ONLINE && now - slot.heartbeatTime() > timeoutOf(slot)) {
+        return DeviceStatus::OFFLINE;
+    }
+    return status;
+}
 
-    outInfo = opt.value();
+/**
+ * @brief Change the stored status of a slot and move it between the status indexes
+ * @brief 修改槽位存储的状态，并在状态索引之间移动
+ *
+ * 读取与写入都在索引锁内，因此同一设备的并发状态变化依次生效，每次变化恰好被一个调用方看到；
+ * 需要记录的变化也在锁内追加到日志，日志中的顺序与生效顺序一致。
+ * Both the read and the write happen under the index lock, so concurrent changes of one device apply one after
+ * the other and each change is seen by exactly one caller; a logged change is appended under the lock too, so
+ * the log order matches the order the changes took effect in.
+ *
+ * @param slot 设备注册表槽位
+ * @param to 新状态
+ * @param from 仅当当前状态为该值时才修改
+ * @param logged 非空时在锁内记录状态变化，日志凭据写入此处
+ * @return true 状态发生了变化
+ */
+auto DefaultDeviceManager::setStatus(DeviceSlot& slot, DeviceStatus to, std::optional<DeviceStatus> from,
+                                     WalTicket* logged) -> bool {
+    auto& shard = indexShardOf(slot.deviceId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto current = slot.status.load(std::memory_order_relaxed);
+    if (current == to || (from && current != *from)) {
+        return false;
+    }
+    slot.status.store(to, std::memory_order_release);
+    indexStatus(shard, slot, current, to);
+    if (logged && mWal) {
+        mWal->logTransition(slot.deviceId, to, logged);
+    }
     return true;
 }
 
+/**
+ * @brief Move a slot between the status counters and bitmaps of its shard
+ * @brief 在所在分片的状态计数器与位图之间移动槽位
+ *
+ * @param shard 设备所在的索引分片，调用方持有其锁
+ * @param slot 设备注册表槽位
+ * @param from 原状态，首次建立索引时为空
+ * @param to 新状态
+ */
+void DefaultDeviceManager::indexStatus(IndexShard& shard, const DeviceSlot& slot, std::optional<DeviceStatus> from,
+                                       DeviceStatus to) {
+    if (from) {
+        shard.counts[static_cast<size_t>(*from)].fetch_sub(1, std::memory_order_relaxed);
+        markMember(slot.handle, *from, false);
+    }
+    shard.counts[static_cast<size_t>(to)].fetch_add(1, std::memory_order_relaxed);
+    markMember(slot.handle, to, true);
+}
+
+/**
+ * @brief Set or clear the bit of a handle in a status bitmap
+ * @brief 设置或清除句柄在某个状态位图中的位
+ *
+ * 同一个字由相邻句柄共享，它们可能属于不同的分片，因此用原子的按位或与按位与修改。
+ * Neighbouring handles share a word and may live in different shards, hence the atomic OR and AND.
+ *
+ * @param handle 设备句柄，无效时忽略
+ * @param status 状态位图
+ * @param member 设备是否处于该状态
+ */
+void DefaultDeviceManager::markMember(DeviceHandle handle, DeviceStatus status, bool member) {
+    if (!isValid(handle)) {
+        return;
+    }
+    uint32_t index = toIndex(handle);
+    auto* chunk = mHandleChunks[index >> kHANDLE_CHUNK_BITS].load(std::memory_order_acquire);
+    if (!chunk) {
+        return;
+    }
+    uint32_t offset = index & (kHANDLE_CHUNK_SIZE - 1);
+    auto& word = chunk->members[static_cast<size_t>(status)][offset / 64];
+    uint64_t bit = uint64_t { 1 } << (offset % 64);
+    if (member) {
+        word.fetch_or(bit, std::memory_order_release);
+    } else {
+        word.fetch_and(~bit, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief Bind a slot to an owner and move it in the owner index
+ * @brief 将槽位绑定到所有者，并在所有者索引中移动
+ *
+ * 从原所有者的列表中按顺序删除，改绑很少发生，列表保持注册顺序更利于分页。
+ * The slot is erased from the previous owner's list in place: owner changes are rare, and keeping registration
+ * order makes paging steadier.
+ *
+ * @param shard 设备所在的索引分片，调用方持有其锁
+ * @param slot 设备注册表槽位
+ * @param owner 新的所有者，为空表示解除绑定
+ * @param claim 仅绑定尚无所有者的槽位
+ * @return true 所有者发生了变化
+ */
+auto DefaultDeviceManager::bindOwner(IndexShard& shard, const std::shared_ptr<DeviceSlot>& slot,
+                                     const std::string& owner, bool claim) -> bool {
+    std::string previous;
+    {
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (slot->owner == owner || (claim && !slot->owner.empty())) {
+            return false;
+        }
+        previous = std::exchange(slot->owner, owner);
+    }
+    if (auto owned = shard.owners.find(previous); owned != shard.owners.end()) {
+        auto& slots = owned->second;
+        if (auto it = std::find(slots.begin(), slots.end(), slot); it != slots.end()) {
+            slots.erase(it);
+        }
+        if (slots.empty()) {
+            shard.owners.erase(owned);
+        }
+    }
+    if (!owner.empty()) {
+        shard.owners[owner].push_back(slot);
+    }
+    return true;
+}
+
+/**
+ * @brief Index shard of a device
+ * @brief 设备所在的索引分片
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 与注册表分片下标相同的索引分片
+ */
+auto DefaultDeviceManager::indexShardOf(const std::string& deviceId) -> IndexShard& {
+    return mIndexShards[mDevices.shardIndexOf(deviceId)];
+}
+
+/**
+ * @brief Heartbeat timeout of a slot
+ * @brief 槽位的心跳超时
+ *
+ * @param slot 设备注册表槽位
+ * @return 设备自身或所属类别的超时，都未设置时为管理器默认值
+ */
+auto DefaultDeviceManager::timeoutOf(const DeviceSlot& slot) const -> std::chrono::milliseconds {
+    auto own = slot.heartbeatTimeoutMs.load(std::memory_order_relaxed);
+    return own > 0 ? std::chrono::milliseconds(own) : mOptions.heartbeatTimeout;
+}
+
+/**
+ * @brief Heartbeat timeout of the device class matching an ID
+ * @brief 设备 ID 所属类别的心跳超时
+ *
+ * 取前缀最长的匹配类别；只在注册与重置超时时调用，类别很少，线性查找即可。
+ * Takes the longest matching prefix; only runs on registration and timeout resets, and classes are few, so a
+ * linear scan is enough.
+ *
+ * @param deviceId 设备唯一标识符
+ * @return 类别超时，没有匹配的类别时为 0
+ */
+auto DefaultDeviceManager::classTimeout(const std::string& deviceId) const -> std::chrono::milliseconds {
+    const HeartbeatClass* best = nullptr;
+    for (const auto& heartbeatClass : mOptions.heartbeatClasses) {
+        if (deviceId.compare(0, heartbeatClass.prefix.size(), heartbeatClass.prefix) == 0 &&
+            (!best || heartbeatClass.prefix.size() > best->prefix.size())) {
+            best = &heartbeatClass;
+        }
+    }
+    return best ? best->timeout : std::chrono::milliseconds(0);
+}
+
+/**
+ * @brief Put an online device on the expiry wheel unless it is already there
+ * @brief 将在线设备挂入超时时间轮，已挂入时不重复
+ *
+ * 与 checkExpiry 配对：这里先写状态再读挂入标志，checkExpiry 先清挂入标志再读状态，两侧的栅栏保证
+ * 上线与定时器到期并发时至少有一方看到对方的写入，设备不会在在线状态下脱离时间轮。
+ * Pairs with checkExpiry: here the status is written before the armed flag is read, there the flag is cleared
+ * before the status is read, and the fences on both sides guarantee that when a device comes online while its
+ * timer fires at least one side sees the other's write, so an online device never falls off the wheel.
+ *
+ * @param slot 设备注册表槽位
+ */
+void DefaultDeviceManager::armExpiry(DeviceSlot& slot) {
+    if (!mSweeping.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!slot.expiryArmed.exchange(true, std::memory_order_relaxed)) {
+        scheduleExpiry(slot);
+    }
+}
+
+/**
+ * @brief Schedule an expiry check at the current heartbeat deadline of a slot
+ * @brief 按槽位当前的心跳截止时间安排一次超时检查
+ *
+ * @param slot 设备注册表槽位
+ */
+void DefaultDeviceManager::scheduleExpiry(DeviceSlot& slot) {
+    uint32_t generation = slot.expiryGeneration.fetch_add(1, std::memory_order_acq_rel) + 1;
+    auto deadline = slot.heartbeatTime() + timeoutOf(slot);
+    auto& shard = *mExpiryShards[std::hash<std::string> {}(slot.deviceId) % mExpiryShards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.wheel.schedule(deadline, ExpiryTimer { &slot, generation });
+}
+
+/**
+ * @brief Handle a fired expiry timer
+ * @brief 处理到期的超时定时器
+ *
+ * 心跳只写时间戳而不移动定时器，定时器到期时才检查最新的心跳：仍在超时内则按新的截止时间重新挂入，
+ * 否则标记离线并发出离线事件。离线设备不留在时间轮上，下次上线时重新挂入。
+ * Heartbeats only store a timestamp and never move the timer; the latest heartbeat is checked when the timer
+ * fires. A device still within its timeout is re-armed at its new deadline, otherwise it is marked offline and
+ * an offline event is emitted. Offline devices leave the wheel and are re-armed when they come back online.
+ *
+ * @param timer 到期的定时器
+ * @param now 当前时间点
+ */
+void DefaultDeviceManager::checkExpiry(const ExpiryTimer& timer, DeviceSlot::Clock::time_point now) {
+    auto& slot = *timer.slot;
+    if (timer.generation != slot.expiryGeneration.load(std::memory_order_acquire)) {
+        return; // 已被更新的定时器取代
+    }
+    slot.expiryArmed.store(false, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (slot.status.load(std::memory_order_relaxed) != DeviceStatus::ONLINE) {
+        return;
+    }
+    if (now - slot.heartbeatTime() <= timeoutOf(slot)) {
+        armExpiry(slot);
+        return;
+    }
+    if (setStatus(slot, DeviceStatus::OFFLINE, DeviceStatus::ONLINE)) {
+        emitEvent(DeviceEvent::Type::Offline, slot);
+    }
+}
+
+/**
+ * @brief Start the expiry sweeper thread
+ * @brief 启动超时扫描线程
+ *
+ * 扫描粒度为 0 时不启动，设备只在被查询时按超时判定。
+ * Not started when the tick is 0; devices are then only judged against their timeout when queried.
+ */
+void DefaultDeviceManager::startSweeper() {
+    if (mOptions.expiryTick.count() <= 0 || mSweeping.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mSweeperMutex);
+    if (mSweeping.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    mSweeper = std::thread([this]() {
+        std::unique_lock<std::mutex> wait(mSweeperMutex);
+        while (!mSweeperWake.wait_for(wait, mOptions.expiryTick, [this]() { return !mSweeping.load(); })) {
+            wait.unlock();
+            sweep(DeviceSlot::Clock::now());
+            wait.lock();
+        }
+    });
+}
+
+/**
+ * @brief Stop the expiry sweeper thread
+ * @brief 停止超时扫描线程
+ */
+void DefaultDeviceManager::stopSweeper() {
+    {
+        std::lock_guard<std::mutex> lock(mSweeperMutex);
+        mSweeping.store(false, std::memory_order_release);
+    }
+    mSweeperWake.notify_all();
+    if (mSweeper.joinable()) {
+        mSweeper.join();
+    }
+}
+
+/**
+ * @brief Advance every expiry wheel and expire silent devices
+ * @brief 推进所有超时时间轮，判定静默设备超时
+ *
+ * 每次只访问经过的时间轮槽位，开销与到期的定时器数成正比，与设备总数无关；到期处理在分片锁外进行，
+ * 重新挂入与事件回调都不会持有时间轮锁。
+ * Only the elapsed wheel slots are visited, so the cost follows the number of fired timers rather than the
+ * fleet size; fired timers are handled outside the shard locks, so re-arming and event callbacks never run
+ * under a wheel lock.
+ *
+ * @param now 当前时间点
+ */
+void DefaultDeviceManager::sweep(DeviceSlot::Clock::time_point now) {
+    std::vector<ExpiryTimer> fired;
+    for (auto& shard : mExpiryShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->wheel.advance(now, [&fired](const ExpiryTimer& timer) { fired.push_back(timer); });
+    }
+    for (const auto& timer : fired) {
+        checkExpiry(timer, now);
+    }
+}
+
+/**
+ * @brief Visit every registered device
+ * @brief 遍历所有已注册设备
+ *
+ * 与 listDevices() 一样，每次只在索引分片锁内复制 kSCAN_CHUNK 个槽位指针，访问函数在锁外执行，
+ * 耗时的访问不会阻塞同一分片上的注册与上下线。快照恢复期间，每个索引分片在访问之前才恢复，不等待后台恢复线程。
+ * As in listDevices(), only kSCAN_CHUNK slot pointers are copied per lock of an index shard and the visitor runs
+ * outside it, so a slow visitor never stalls registrations or transitions on that shard. While the snapshot is
+ * hydrating, each index shard is hydrated just before it is visited instead of waiting for the background
+ * hydrator.
+ *
+ * @param visitor 访问函数，在索引分片锁外执行
+ */
+void DefaultDeviceManager::forEachDevice(const std::function<void(const DeviceSlot&)>& visitor) {
+    constexpr size_t kSCAN_CHUNK = 256; // 每次加锁复制的槽位数
+
+    std::vector<std::shared_ptr<DeviceSlot>> chunk;
+    chunk.reserve(kSCAN_CHUNK);
+    for (size_t index = 0; index < mIndexShards.size(); ++index) {
+        hydrateShard(index);
+        const auto& shard = mIndexShards[index];
+        for (size_t position = 0;; position += chunk.size()) {
+            chunk.clear();
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (position >= shard.slots.size()) {
+                    break;
+                }
+                auto first = shard.slots.begin() + static_cast<std::ptrdiff_t>(position);
+                auto last = shard.slots.begin() +
+                            static_cast<std::ptrdiff_t>(std::min(shard.slots.size(), position + kSCAN_CHUNK));
+                chunk.assign(first, last);
+            }
+            for (const auto& slot : chunk) {
+                visitor(*slot);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Install the device event listener
+ * @brief 设置设备事件监听器
+ *
+ * @param listener 事件监听器
+ */
+void DefaultDeviceManager::setEventListener(DeviceEventListener listener) {
+    std::lock_guard<std::mutex> lock(mListenerMutex);
+    mListener = std::move(listener);
+}
+
+/**
+ * @brief Enable or disable StatusChanged events
+ * @brief 开启或关闭状态内容变化事件
+ *
+ * @param enabled 内容变化的上报是否发出事件
+ */
+void DefaultDeviceManager::setStatusEventsEnabled(bool enabled) {
+    mStatusEvents.store(enabled, std::memory_order_release);
+}
+
+/**
+ * @brief Whether the write-ahead log refuses writes after an error
+ * @brief 预写日志是否因出错而拒绝写入
+ *
+ * 日志在下一次快照轮转之前保持拒绝状态。
+ * The log keeps refusing writes until the next snapshot rotates it.
+ *
+ * @return true 最近一次日志写入失败且尚未轮转
+ */
+auto DefaultDeviceManager::storageFailed() -> bool {
+    return mWal && mWal->failed();
+}
+
+/**
+ * @brief Slot of a handle
+ * @brief 句柄对应的槽位
+ *
+ * @param handle 设备句柄
+ * @return 设备槽位，句柄未分配时为 nullptr
+ */
+auto DefaultDeviceManager::slotOf(DeviceHandle handle) const -> DeviceSlot* {
+    if (!isValid(handle)) {
+        return nullptr;
+    }
+    uint32_t index = toIndex(handle);
+    if ((index >> kHANDLE_CHUNK_BITS) >= kMAX_HANDLE_CHUNKS) {
+        return nullptr;
+    }
+    auto* chunk = mHandleChunks[index >> kHANDLE_CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk ? chunk->slots[index & (kHANDLE_CHUNK_SIZE - 1)].load(std::memory_order_acquire) : nullptr;
+}
+
+/**
+ * @brief Publish a freshly created slot in the handle table
+ * @brief 将新建的槽位发布到句柄表
+ *
+ * 只有每块的第一个句柄需要加锁分配新块，其余只是一次 release 写入。
+ * Only the first handle of each chunk takes the lock to allocate it; every other one is a single release store.
+ *
+ * @param slot 新建的槽位
+ */
+void DefaultDeviceManager::publishHandle(DeviceSlot& slot) {
+    if (!isValid(slot.handle)) {
+        return;
+    }
+    uint32_t index = toIndex(slot.handle);
+    auto& entry = mHandleChunks[index >> kHANDLE_CHUNK_BITS];
+    auto* chunk = entry.load(std::memory_order_acquire);
+    if (!chunk) {
+        std::lock_guard<std::mutex> lock(mHandleMutex);
+        chunk = entry.load(std::memory_order_relaxed);
+        if (!chunk) {
+            mHandleChunkStore.push_back(std::make_unique<HandleChunk>());
+            chunk = mHandleChunkStore.back().get();
+            entry.store(chunk, std::memory_order_release);
+        }
+    }
+    chunk->slots[index & (kHANDLE_CHUNK_SIZE - 1)].store(&slot, std::memory_order_release);
+}
+
+/**
+ * @brief Find or create the slot of a device
+ * @brief 查找或创建设备槽位
+ *
+ * 查找、插入与建立索引在同一次分片加锁内完成，并发注册同一设备时只有一方创建槽位、分配句柄并写入索引。
+ * 快照恢复期间，快照中的设备在同一次加锁内按其所在行恢复，因此首次访问与恢复线程并发时也只恢复一次。
+ * Lookup, insertion and indexing share one shard lock, so when a device registers concurrently only one caller
+ * creates the slot, assigns its handle and indexes it. While the snapshot is hydrating, a snapshot device is restored
+ * from its row under the same lock, so a first access racing the hydrator restores it only once.
+ *
+ * @param deviceId 设备唯一标识符
+ * @param created 本次调用新注册了设备（而非找到或从快照恢复）时置为 true
+ * @param row 已知的快照行
+ * @param owner 本次调用新建设备时绑定的所有者
+ * @return 设备槽位
+ */
+auto DefaultDeviceManager::insertSlot(const std::string& deviceId, bool& created, std::optional<size_t> row,
+                                      const std::string& owner) -> std::shared_ptr<DeviceSlot> {
+    bool inserted = false;
+    auto slot = mDevices.getOrInsert(deviceId, [this, &deviceId, &inserted, &row, &owner]() {
+        inserted = true;
+        auto fresh = makeSlot(deviceId, row);
+
+        // 在注册表分片锁内建立索引，设备一旦可见就已计入全部索引
+        // Indexed under the registry shard lock, so a device is in every index as soon as it is visible
+        auto& shard = indexShardOf(deviceId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        indexSlot(shard, fresh, row.has_value(), owner);
+        return fresh;
+    });
+    created = inserted && !row;
+    if (inserted && row && slot->status.load(std::memory_order_relaxed) == DeviceStatus::ONLINE) {
+        armExpiry(*slot);
+    }
+    return slot;
+}
+
+/**
+ * @brief Create the slot of a device not yet in the registry
+ * @brief 为尚未出现在注册表中的设备创建槽位
+ *
+ * @param deviceId 设备唯一标识符
+ * @param row 已知的快照行；快照恢复期间在快照中找到设备时写入其行号
+ * @return 已发布句柄的新槽位
+ */
+auto DefaultDeviceManager::makeSlot(const std::string& deviceId, std::optional<size_t>& row)
+    -> std::shared_ptr<DeviceSlot> {
+    if (!row && mHydrating.load(std::memory_order_acquire)) {
+        row = mSnapshot->find(deviceId);
+    }
+    auto handle = kINVALID_DEVICE_HANDLE;
+    if (mNextHandle.load(std::memory_order_relaxed) < kMAX_HANDLE_CHUNKS * kHANDLE_CHUNK_SIZE) {
+        handle = DeviceHandle { mNextHandle.fetch_add(1, std::memory_order_relaxed) };
+    }
+    auto slot = std::make_shared<DeviceSlot>(deviceId, handle);
+    slot->heartbeatTimeoutMs.store(classTimeout(deviceId).count(), std::memory_order_relaxed);
+    slot->touch();
+    if (row) {
+        restoreSlot(*slot, *row);
+    }
+    publishHandle(*slot);
+    return slot;
+}
+
+/**
+ * @brief Add a new slot to the secondary indexes of its shard
+ * @brief 将新槽位加入所在分片的二级索引
+ *
+ * @param shard 设备所在的索引分片
+ * @param slot 尚未出现在注册表中的新槽位
+ * @param restored 槽位是否从快照恢复，恢复的槽位保留快照中的所有者
+ * @param owner 新注册（而非恢复）的设备绑定的所有者
+ */
+void DefaultDeviceManager::indexSlot(IndexShard& shard, const std::shared_ptr<DeviceSlot>& slot, bool restored,
+                                     const std::string& owner) {
+    shard.slots.push_back(slot);
+    if (!restored && !owner.empty()) {
+        bindOwner(shard, slot, owner, true);
+    } else if (!slot->owner.empty()) {
+        shard.owners[slot->owner].push_back(slot);
+    }
+    indexStatus(shard, *slot, std::nullopt, slot->status.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Copy the state of a snapshot row into a fresh slot
+ * @brief 将快照行中的状态复制到新建的槽位
+ *
+ * 与日志回放一样，恢复的设备以当前时间作为最近一次心跳，获得一个完整的超时周期作为宽限期。
+ * As with log replay, a restored device takes the current time as its last heartbeat and so gets one full
+ * timeout as a grace period.
+ *
+ * @param slot 尚未出现在注册表中的槽位
+ * @param row 快照行
+ */
+void DefaultDeviceManager::restoreSlot(DeviceSlot& slot, size_t row) {
+    slot.status.store(mSnapshot->status(row), std::memory_order_relaxed);
+    mUnhydrated[static_cast<size_t>(mSnapshot->status(row))].fetch_sub(1, std::memory_order_relaxed);
+    slot.heartbeatTimeoutMs.store(mSnapshot->heartbeatTimeoutMs(row), std::memory_order_relaxed);
+    auto report = mSnapshot->report(row);
+    auto updates = mSnapshot->attributes(row);
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    slot.lastStatusReport.assign(report);
+    slot.owner.assign(mSnapshot->owner(row));
+    if (!updates.empty()) {
+        slot.attributes.apply(updates);
+    }
+}
+
+/**
+ * @brief Start materializing every snapshot row in the background
+ * @brief 启动后台线程逐行恢复快照
+ *
+ * 按快照行序插入，已在首次访问或日志回放时恢复的设备直接跳过；全部完成后清除恢复标志，之后注册表查找未命中
+ * 不再查询快照。
+ * Rows are inserted in snapshot order, skipping devices already restored on first access or by log replay. Once
+ * all are in, the hydrating flag is cleared and registry misses stop consulting the snapshot.
+ */
+void DefaultDeviceManager::startHydrator() {
+    if (!mHydrating.load(std::memory_order_acquire)) {
+        return;
+    }
+    mHydratorStop.store(false, std::memory_order_relaxed);
+    mHydrator = std::thread([this]() {
+        auto start = std::chrono::steady_clock::now();
+        size_t rows = mSnapshot->size();
+        for (size_t row = 0; row < rows && !mHydratorStop.load(std::memory_order_relaxed); ++row) {
+            bool created = false;
+            insertSlot(std::string(mSnapshot->deviceId(row)), created, row);
+        }
+        if (mHydratorStop.load(std::memory_order_relaxed)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mHydrateMutex);
+            mHydrating.store(false, std::memory_order_release);
+        }
+        mHydrated.notify_all();
+        std::cout << "[DefaultDeviceManager] Hydrated " << rows << " devices from " << mOptions.snapshotPath
+                  << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                         .count()
+                  << " ms" << std::endl;
+    });
+}
+
+/**
+ * @brief Stop the hydrator
+ * @brief 停止快照恢复线程
+ *
+ * 只在重新配置或关闭时调用；此后不再有线程等待恢复完成，恢复标志随之清除。
+ * Only called when reconfiguring or shutting down; nobody waits for hydration afterwards, so the flag is cleared.
+ */
+void DefaultDeviceManager::stopHydrator() {
+    mHydratorStop.store(true, std::memory_order_relaxed);
+    if (mHydrator.joinable()) {
+        mHydrator.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mHydrateMutex);
+        mHydrating.store(false, std::memory_order_release);
+    }
+    mHydrated.notify_all();
+}
+
+/**
+ * @brief Block until every snapshot row is in the registry
+ * @brief 阻塞直到快照中的设备全部进入注册表
+ *
+ * 批量注册与写快照需要完整的注册表；查询只恢复其遍历的分片，见 hydrateShard()。快照已恢复时只是一次原子读取。
+ * Bulk registration and snapshot writes need the complete registry; queries only hydrate the shards they walk,
+ * see hydrateShard(). Once hydrated this is a single atomic load.
+ */
+void DefaultDeviceManager::awaitHydration() {
+    if (!mHydrating.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mHydrateMutex);
+    mHydrated.wait(lock, [this]() { return !mHydrating.load(std::memory_order_acquire); });
+}
+
+/**
+ * @brief Hydrate one index shard on the calling thread
+ * @brief 在调用线程上恢复一个索引分片
+ *
+ * 与后台恢复线程并发时，同一设备由注册表分片锁保证只恢复一次。
+ * Racing the background hydrator is safe: the registry shard lock restores each device only once.
+ *
+ * @param index 索引分片下标
+ */
+void DefaultDeviceManager::hydrateShard(size_t index) {
+    auto& shard = mIndexShards[index];
+    if (!mHydrating.load(std::memory_order_acquire) || shard.hydrated.load(std::memory_order_acquire)) {
+        return;
+    }
+    for (auto row : snapshotRows()[index]) {
+        bool created = false;
+        insertSlot(std::string(mSnapshot->deviceId(row)), created, row);
+    }
+    shard.hydrated.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Snapshot rows grouped by index shard
+ * @brief 按索引分片分组的快照行
+ *
+ * 只散列一遍设备 ID，不解码行内容；计算后直到下次 configure() 都不再修改，因此返回的引用可在锁外使用。
+ * Only hashes every device ID once without decoding any row; the result is not modified again until the next
+ * configure(), so the returned reference may be used outside the lock.
+ */
+auto DefaultDeviceManager::snapshotRows() -> const std::vector<std::vector<uint32_t>>& {
+    std::lock_guard<std::mutex> lock(mHydrateMutex);
+    if (mSnapshotRows.empty()) {
+        mSnapshotRows.resize(mIndexShards.size());
+        for (size_t row = 0; row < mSnapshot->size(); ++row) {
+            // 与 ShardedMap::shardIndexOf 相同：std::string 与 std::string_view 的散列值相等
+            auto shard = std::hash<std::string_view> {}(mSnapshot->deviceId(row)) % mIndexShards.size();
+            mSnapshotRows[shard].push_back(static_cast<uint32_t>(row));
+        }
+    }
+    return mSnapshotRows;
+}
+
+/**
+ * @brief Start the periodic snapshot thread
+ * @brief 启动定期快照线程
+ *
+ * 未配置快照路径或间隔为 0 时不启动，快照只在 shutdown() 时写出。
+ * Not started without a snapshot path or with a zero interval; the snapshot is then only written by shutdown().
+ */
+void DefaultDeviceManager::startSnapshotter() {
+    if (mOptions.snapshotPath.empty() || mOptions.snapshotInterval.count() <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotterMutex);
+        mSnapshotting = true;
+    }
+    mSnapshotter = std::thread([this]() {
+        std::unique_lock<std::mutex> wait(mSnapshotterMutex);
+        while (!mSnapshotterWake.wait_for(wait, mOptions.snapshotInterval, [this]() { return !mSnapshotting; })) {
+            wait.unlock();
+            writeSnapshot();
+            wait.lock();
+        }
+    });
+}
+
+/**
+ * @brief Stop the periodic snapshot thread
+ * @brief 停止定期快照线程
+ */
+void DefaultDeviceManager::stopSnapshotter() {
+    {
+        std::lock_guard<std::mutex> lock(mSnapshotterMutex);
+        mSnapshotting = false;
+    }
+    mSnapshotterWake.notify_all();
+    if (mSnapshotter.joinable()) {
+        mSnapshotter.join();
+    }
+}
+
+/**
+ * @brief Rotate the log and write a snapshot covering every older generation
+ * @brief 轮转日志并写出覆盖所有更早代数的快照
+ *
+ * 先轮转日志再读取槽位：轮转之前的变更都已在槽位中，轮转之后的变更都在新一代日志里，快照期间写入方照常运行，
+ * 重启时回放新一代日志即可补齐。快照写出成功后才删除被覆盖的日志段。
+ * The log is rotated before any slot is read: every earlier mutation is already in the slots and every later one
+ * lands in the new generation, so writers keep running during the snapshot and replaying the new generation on
+ * restart fills in whatever the snapshot missed. Covered segments are only deleted once the snapshot is written.
+ *
+ * @return true 快照写出成功
+ */
+auto DefaultDeviceManager::writeSnapshot() -> bool {
+    constexpr size_t kSCAN_CHUNK = 4096; // 每次加锁复制的槽位数
+
+    std::lock_guard<std::mutex> writeLock(mSnapshotWriteMutex);
+    awaitHydration();
+    auto start = std::chrono::steady_clock::now();
+    uint64_t generation = 0;
+    if (mWal) {
+        auto rotated = mWal->rotate();
+        if (!rotated) {
+            std::cerr << kTAG << ": snapshot skipped, write-ahead log rotation failed" << std::endl;
+            return false;
+        }
+        generation = *rotated;
+    }
+
+    std::vector<std::shared_ptr<DeviceSlot>> slots;
+    slots.reserve(mNextHandle.load(std::memory_order_relaxed));
+    for (const auto& shard : mIndexShards) {
+        for (size_t position = 0;; position += kSCAN_CHUNK) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (position >= shard.slots.size()) {
+                break;
+            }
+            auto first = shard.slots.begin() + static_cast<std::ptrdiff_t>(position);
+            auto last = shard.slots.begin() +
+                        static_cast<std::ptrdiff_t>(std::min(shard.slots.size(), position + kSCAN_CHUNK));
+            slots.insert(slots.end(), first, last);
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [](const auto& a, const auto& b) { return a->deviceId < b->deviceId; });
+
+    if (!DeviceSnapshot::write(mOptions.snapshotPath, generation, slots)) {
+        return false;
+    }
+    if (mWal) {
+        mWal->dropBefore(generation);
+    }
+    std::cout << "[DefaultDeviceManager] Wrote snapshot of " << slots.size() << " devices to "
+              << mOptions.snapshotPath << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                     .count()
+              << " ms" << std::endl;
+    return true;
+}
+
+/**
+ * @brief Apply one replayed log record
+ * @brief 应用一条回放的日志记录
+ *
+ * 只在 configure() 中、注册表尚未对外可见时调用，直接写入槽位，不重复记录日志也不发出事件。
+ * Only runs inside configure() before the registry is visible to anyone, writing slots directly without logging
+ * again or emitting events.
+ *
+ * @param record 日志记录
+ */
+void DefaultDeviceManager::replayRecord(const WalRecord& record) {
+    bool created = false;
+    auto slot = record.type == WalRecord::Type::Register ? insertSlot(record.deviceId, created)
+                                                         : acquireSlot(record.deviceId);
+    if (!slot) {
+        return; // 日志中注册记录总在该设备的其他记录之前，缺失时忽略
+    }
+    switch (record.type) {
+    case WalRecord::Type::Register:
+        break;
+    case WalRecord::Type::Transition:
+        setStatus(*slot, record.status);
+        break;
+    case WalRecord::Type::Status: {
+        auto updates = toAttributeUpdates(record.details);
+        std::lock_guard<std::mutex> lock(slot->mutex);
+        if (!updates.empty()) {
+            slot->attributes.apply(updates);
+        }
+        slot->lastStatusReport = record.report;
+        break;
+    }
+    case WalRecord::Type::Timeout: {
+        auto timeout = std::chrono::milliseconds(record.timeoutMs);
+        auto effective = timeout.count() > 0 ? timeout : classTimeout(record.deviceId);
+        slot->heartbeatTimeoutMs.store(effective.count(), std::memory_order_relaxed);
+        break;
+    }
+    case WalRecord::Type::Owner: {
+        auto& shard = indexShardOf(record.deviceId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bindOwner(shard, slot, record.owner, false);
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Store a report, refresh the heartbeat and emit events
+ * @brief 写入上报、刷新心跳并发出事件
+ *
+ * @param slot 设备注册表槽位
+ * @param status 状态上报，移入槽位
+ * @param details 变化的属性
+ * @return true 已记录；false 日志写入失败，上报仍写入内存
+ */
+auto DefaultDeviceManager::applyStatus(DeviceSlot& slot, std::string&& status, const StatusDetails& details) -> bool {
+    // 在槽位锁内写入并记录日志，同一设备的并发上报在日志中的顺序与写入槽位的顺序一致；Sync 级别释放锁后再等待落盘。
+    // 快照在轮转日志之后读取槽位，未被快照读到的上报必然记录在新一代日志中
+    // Stored and logged under the slot lock, so concurrent reports of a device reach the log in the order they
+    // reached the slot; in Sync mode the wait happens after the lock is released. Snapshots read slots after
+    // rotating the log, so a report the snapshot missed is always logged in the new generation
+    WalTicket logged;
+    auto changed = storeStatus(slot, std::move(status), details, toAttributeUpdates(details), logged);
+    bool durable = !mWal || mWal->awaitDurable(logged);
+    refreshDeviceHeartbeat(slot);
+    if (changed) {
+        emitEvent(DeviceEvent::Type::StatusChanged, slot, std::move(*changed));
+    }
+    return durable;
+}
+
+/**
+ * @brief Store a status report in a slot
+ * @brief 将状态上报写入槽位
+ *
+ * 内容与已存储的上报相同时不产生事件；状态事件关闭时既不比较也不复制上报内容。
+ * An unchanged report produces no event; with status events disabled the report is neither compared nor copied.
+ *
+ * @param slot 设备注册表槽位
+ * @param status 状态上报，移入槽位
+ * @param details 上报的原始属性，用于记录日志
+ * @param updates 解析后的属性更新
+ * @param logged 输出的日志凭据
+ * @return 需要随 StatusChanged 事件发出的上报内容，无需发出事件时为空
+ */
+auto DefaultDeviceManager::storeStatus(DeviceSlot& slot, std::string&& status, const StatusDetails& details,
+                                       const std::vector<AttributeUpdate>& updates, WalTicket& logged)
+    -> std::optional<std::string> {
+    bool watched = mStatusEvents.load(std::memory_order_acquire);
+    bool recorded = mOptions.historyRetention.count() > 0 && !updates.empty();
+    int64_t nowMs = recorded ? unixMillis() : 0;
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    if (mWal) {
+        mWal->logStatus(slot.deviceId, status, details, &logged);
+    }
+    bool attributesChanged = !updates.empty() && slot.attributes.apply(updates);
+    if (recorded) {
+        recordHistory(slot, updates, nowMs);
+    }
+    if (!watched) {
+        slot.lastStatusReport = std::move(status);
+        return std::nullopt;
+    }
+    if (slot.lastStatusReport == status && !attributesChanged) {
+        return std::nullopt;
+    }
+    slot.lastStatusReport = status;
+    return std::move(status);
+}
+
+/**
+ * @brief Append numeric and boolean updates to the attribute history
+ * @brief 将数值与布尔更新追加到属性历史
+ *
+ * 历史在首次记录时才分配；淘汰只丢弃整个数据块，因此保留的样本最多比保留时长多出一个数据块。
+ * History is allocated on first use; expiry drops whole chunks only, so at most one chunk beyond the retention
+ * is kept.
+ *
+ * @param slot 设备注册表槽位，调用方持有其互斥锁
+ * @param updates 属性更新
+ * @param nowMs 上报时间（Unix 毫秒）
+ */
+void DefaultDeviceManager::recordHistory(DeviceSlot& slot, const std::vector<AttributeUpdate>& updates,
+                                         int64_t nowMs) const {
+    uint16_t chunkSamples = std::max<uint16_t>(mOptions.historyChunkSamples, 1);
+    for (const auto& update : updates) {
+        if (!update.value) {
+            continue;
+        }
+        double value = 0;
+        if (const auto* number = std::get_if<double>(&*update.value)) {
+            value = *number;
+        } else if (const auto* flag = std::get_if<bool>(&*update.value)) {
+            value = *flag ? 1 : 0;
+        } else {
+            continue;
+        }
+        if (!slot.history) {
+            slot.history = std::make_unique<DeviceHistory>();
+        }
+        slot.history->record(update.key, nowMs, value, chunkSamples);
+    }
+    if (slot.history) {
+        slot.history->expire(nowMs - mOptions.historyRetention.count());
+    }
+}
+
+/**
+ * @brief Whether the attributes of a slot satisfy every attribute filter
+ * @brief 槽位的属性是否满足全部属性条件
+ *
+ * 缺少该属性或属性为字符串时不匹配。
+ * A missing or string-valued attribute never matches.
+ *
+ * @param slot 设备注册表槽位
+ * @param filters 已解析出属性键的条件
+ * @return true 全部满足
+ */
+auto DefaultDeviceManager::matchesAttributes(
+    const DeviceSlot& slot, const std::vector<std::pair<AttributeKey, const AttributeFilter*>>& filters) -> bool {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    for (const auto& [key, filter] : filters) {
+        auto value = slot.attributes.number(key);
+        if (!value || !filter->matches(*value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Whether a slot is visible to a user
+ * @brief 槽位对某用户是否可见
+ *
+ * 尚未绑定所有者的设备可由任何用户认领，因此对所有用户可见。
+ * A device without an owner may be claimed by any user, so it is visible to all of them.
+ *
+ * @param slot 设备注册表槽位
+ * @param viewer 查询的用户
+ * @return true 归属该用户或尚未绑定所有者
+ */
+auto DefaultDeviceManager::visibleTo(const DeviceSlot& slot, const std::string& viewer) -> bool {
+    std::lock_guard<std::mutex> lock(slot.mutex);
+    return slot.owner.empty() || slot.owner == viewer;
+}
+
+/**
+ * @brief Emit a transition event to the listener
+ * @brief 向监听器发出状态变化事件
+ *
+ * 事件携带设备所有者，订阅方据此只向可见的用户推送。
+ * The event carries the device owner, so watchers only forward it to users who can see the device.
+ *
+ * @param type 事件类型
+ * @param slot 设备注册表槽位
+ * @param report 新的状态上报内容，仅 StatusChanged 事件携带
+ */
+void DefaultDeviceManager::emitEvent(DeviceEvent::Type type, const DeviceSlot& slot, std::string report) {
+    DeviceEventListener listener;
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        listener = mListener;
+    }
+    if (listener) {
+        std::string owner;
+        {
+            std::lock_guard<std::mutex> lock(slot.mutex);
+            owner = slot.owner;
+        }
+        listener(DeviceEvent { type, slot.deviceId, slot.status.load(std::memory_order_acquire),
+                               std::chrono::steady_clock::now(), std::move(report), std::move(owner) });
+    }
+}
+
+/**
+ * @brief Emit one Resync event for a bulk change
+ * @brief 为批量变更发出一个 Resync 事件
+ *
+ * 批量导入逐个发出上线事件会淹没订阅缓冲，迫使每个订阅者溢出后重新同步；直接发出一个 Resync 事件代价相同但只有一次。
+ * Per-device Online events of a bulk import would flood the watch ring and force every watcher to overflow and
+ * resync anyway; a single Resync gets the same result at once.
+ */
+void DefaultDeviceManager::emitResync() {
+    DeviceEventListener listener;
+    {
+        std::lock_guard<std::mutex> lock(mListenerMutex);
+        listener = mListener;
+    }
+    if (listener) {
+        listener(DeviceEvent { DeviceEvent::Type::Resync, {}, DeviceStatus::UNKNOWN, std::chrono::steady_clock::now(),
+                               {}, {} });
+    }
+}
+
 IOT_DEVICE_NS_END
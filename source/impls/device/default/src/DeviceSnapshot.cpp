@@ -0,0 +1,520 @@
+/**
+ * @brief Implementation of DeviceSnapshot class
+ * @brief DeviceSnapshot 类的实现文件
+ *
+ * The writer streams each section through one buffered file in a single pass over the slots; only the report
+ * and attribute offsets are kept in memory, because those blobs are copied under the slot mutex and may change
+ * between passes.
+ * 写入方通过一个带缓冲的文件按段流式写出，每段对槽位只遍历一次；只有上报与属性的偏移保存在内存中，
+ * 因为这两类数据在槽位锁内复制，两次遍历之间可能变化。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-08
+ */
+
+#include "DeviceSnapshot.h"
+#include "StorageUtil.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <variant>
+
+IOT_DEVICE_NS_BEGIN
+
+namespace {
+
+constexpr char kMAGIC[8] = { 'I', 'O', 'T', 'S', 'N', 'A', 'P', 'S' }; // 文件头魔数
+constexpr uint32_t kVERSION = 2;                                       // 文件格式版本
+constexpr size_t kWRITE_BUFFER = 1 << 20;                              // 写入缓冲区大小
+
+/**
+ * @brief 文件中的一段：起始偏移与长度
+ */
+struct Section {
+    uint64_t at;
+    uint64_t bytes;
+};
+
+/**
+ * @brief 快照文件头，整数为主机字节序
+ */
+struct Header {
+    char magic[8];            // 魔数
+    uint32_t version;         // 文件格式版本
+    uint32_t headerBytes;     // 文件头长度
+    uint64_t walGeneration;   // 快照未覆盖的第一代日志
+    uint64_t deviceCount;     // 设备数量
+    int64_t createdAtMs;      // 生成时间（Unix 毫秒）
+    Section ids;              // 排序的设备 ID 字节
+    Section idOffsets;        // 设备 ID 偏移，u64 × (count + 1)
+    Section status;           // 设备状态，u8 × count
+    Section timeouts;         // 心跳超时毫秒数，i64 × count
+    Section reports;          // 状态上报字节
+    Section reportOffsets;    // 状态上报偏移，u64 × (count + 1)
+    Section attributes;       // 属性字节
+    Section attributeOffsets; // 属性偏移，u64 × (count + 1)
+    Section keys;             // 属性键表
+    Section owners;           // 所有者表
+    Section ownerIndex;       // 所有者表下标加一，u32 × count，0 表示未绑定
+    uint32_t reserved;        // 保留，写 0
+    uint32_t crc;             // 之前所有字段的 CRC-32C
+};
+
+static_assert(sizeof(Header) == 224 && sizeof(Header) % 8 == 0, "snapshot header layout changed");
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * @brief 带缓冲的顺序写入器，记录当前偏移与第一个错误
+ */
+class SectionWriter {
+public:
+    explicit SectionWriter(FILE* file) : mFile(file) {}
+
+    void write(const void* data, size_t size) {
+        if (mOk && size > 0 && std::fwrite(data, 1, size, mFile) != size) {
+            mOk = false;
+        }
+        mOffset += size;
+    }
+
+    template <typename T>
+    void write(T value) {
+        write(&value, sizeof(value));
+    }
+
+    /**
+     * @brief 补齐到 8 字节边界并开始新的一段
+     */
+    auto begin() -> uint64_t {
+        static constexpr char kZEROS[8] {};
+        write(kZEROS, (8 - mOffset % 8) % 8);
+        return mOffset;
+    }
+
+    auto end(uint64_t at) const -> Section {
+        return Section { at, mOffset - at };
+    }
+
+    auto ok() const -> bool {
+        return mOk;
+    }
+
+private:
+    FILE* mFile;
+    uint64_t mOffset = sizeof(Header);
+    bool mOk = true;
+};
+
+/**
+ * @brief 段在文件范围内，且需要时按 8 字节对齐、长度符合预期
+ */
+auto validSection(const Section& section, uint64_t fileSize, bool aligned, std::optional<uint64_t> bytes) -> bool {
+    return section.at <= fileSize && section.bytes <= fileSize - section.at && (!aligned || section.at % 8 == 0) &&
+           (!bytes || section.bytes == *bytes);
+}
+
+/**
+ * @brief 属性数据的顺序读取器，越界后 ok 置为 false
+ */
+struct BlobReader {
+    const char* cursor;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    auto get() -> T {
+        T value {};
+        if (!ok || static_cast<size_t>(end - cursor) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    auto getString() -> std::string_view {
+        auto size = get<uint32_t>();
+        if (!ok || static_cast<size_t>(end - cursor) < size) {
+            ok = false;
+            return {};
+        }
+        std::string_view text(cursor, size);
+        cursor += size;
+        return text;
+    }
+};
+
+} // namespace
+
+auto DeviceSnapshot::open(const std::string& path) -> std::unique_ptr<DeviceSnapshot> {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            std::cerr << kTAG << ": cannot open " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        return nullptr;
+    }
+    struct stat info {};
+    void* image = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<uint64_t>(info.st_size) >= sizeof(Header)) {
+        image = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (image == MAP_FAILED) {
+        std::cerr << kTAG << ": " << path << " is too short or cannot be mapped" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<DeviceSnapshot> snapshot(new DeviceSnapshot());
+    snapshot->mImage = image;
+    snapshot->mImageBytes = static_cast<size_t>(info.st_size);
+
+    const auto* base = static_cast<const char*>(image);
+    const uint64_t fileSize = snapshot->mImageBytes;
+    Header header {};
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMAGIC, sizeof(kMAGIC)) != 0 || header.version != kVERSION ||
+        header.headerBytes != sizeof(Header) || header.crc != crc32c(base, offsetof(Header, crc))) {
+        std::cerr << kTAG << ": " << path << " is not a device snapshot of version " << kVERSION << std::endl;
+        return nullptr;
+    }
+    const uint64_t count = header.deviceCount;
+    if (count > fileSize / sizeof(uint64_t)) {
+        std::cerr << kTAG << ": " << path << " has a corrupt device count" << std::endl;
+        return nullptr;
+    }
+    const uint64_t offsetsBytes = (count + 1) * sizeof(uint64_t);
+    if (!validSection(header.ids, fileSize, false, std::nullopt) ||
+        !validSection(header.idOffsets, fileSize, true, offsetsBytes) ||
+        !validSection(header.status, fileSize, false, count) ||
+        !validSection(header.timeouts, fileSize, true, count * sizeof(int64_t)) ||
+        !validSection(header.reports, fileSize, false, std::nullopt) ||
+        !validSection(header.reportOffsets, fileSize, true, offsetsBytes) ||
+        !validSection(header.attributes, fileSize, false, std::nullopt) ||
+        !validSection(header.attributeOffsets, fileSize, true, offsetsBytes) ||
+        !validSection(header.keys, fileSize, false, std::nullopt) ||
+        !validSection(header.owners, fileSize, false, std::nullopt) ||
+        !validSection(header.ownerIndex, fileSize, true, count * sizeof(uint32_t))) {
+        std::cerr << kTAG << ": " << path << " has a section out of range" << std::endl;
+        return nullptr;
+    }
+
+    snapshot->mCount = count;
+    snapshot->mWalGeneration = header.walGeneration;
+    snapshot->mIdBytes = base + header.ids.at;
+    snapshot->mIdBytesSize = header.ids.bytes;
+    snapshot->mIdOffsets = reinterpret_cast<const uint64_t*>(base + header.idOffsets.at);
+    snapshot->mStatus = reinterpret_cast<const uint8_t*>(base + header.status.at);
+    snapshot->mTimeouts = reinterpret_cast<const int64_t*>(base + header.timeouts.at);
+    snapshot->mReportBytes = base + header.reports.at;
+    snapshot->mReportBytesSize = header.reports.bytes;
+    snapshot->mReportOffsets = reinterpret_cast<const uint64_t*>(base + header.reportOffsets.at);
+    snapshot->mAttributeBytes = base + header.attributes.at;
+    snapshot->mAttributeBytesSize = header.attributes.bytes;
+    snapshot->mAttributeOffsets = reinterpret_cast<const uint64_t*>(base + header.attributeOffsets.at);
+
+    // 键表很小，打开时即驻留；驻留表已满的键解码时跳过
+    // The key table is small and interned up front; keys that no longer fit the intern table are skipped
+    BlobReader keys { base + header.keys.at, base + header.keys.at + header.keys.bytes };
+    auto keyCount = keys.get<uint32_t>();
+    for (uint32_t i = 0; keys.ok && i < keyCount; ++i) {
+        auto name = keys.getString();
+        if (keys.ok) {
+            snapshot->mKeys.push_back(AttributeKeys::instance().intern(name));
+        }
+    }
+    if (!keys.ok) {
+        std::cerr << kTAG << ": " << path << " has a corrupt attribute key table" << std::endl;
+        return nullptr;
+    }
+
+    snapshot->mOwnerIndex = reinterpret_cast<const uint32_t*>(base + header.ownerIndex.at);
+    BlobReader owners { base + header.owners.at, base + header.owners.at + header.owners.bytes };
+    auto ownerCount = owners.get<uint32_t>();
+    for (uint32_t i = 0; owners.ok && i < ownerCount; ++i) {
+        auto name = owners.getString();
+        if (owners.ok) {
+            snapshot->mOwners.push_back(name);
+        }
+    }
+    if (!owners.ok) {
+        std::cerr << kTAG << ": " << path << " has a corrupt owner table" << std::endl;
+        return nullptr;
+    }
+    return snapshot;
+}
+
+auto DeviceSnapshot::write(const std::string& path, uint64_t walGeneration,
+                           const std::vector<std::shared_ptr<DeviceSlot>>& slots) -> bool {
+    const std::string staging = path + ".tmp";
+    FILE* file = std::fopen(staging.c_str(), "wbe");
+    if (file == nullptr) {
+        std::cerr << kTAG << ": cannot create " << staging << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(kWRITE_BUFFER);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    Header header {};
+    std::memcpy(header.magic, kMAGIC, sizeof(kMAGIC));
+    header.version = kVERSION;
+    header.headerBytes = sizeof(Header);
+    header.walGeneration = walGeneration;
+    header.deviceCount = slots.size();
+    header.createdAtMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
+    std::fwrite(&header, 1, sizeof(header), file);
+
+    SectionWriter out(file);
+    auto at = out.begin();
+    for (const auto& slot : slots) {
+        out.write(slot->deviceId.data(), slot->deviceId.size());
+    }
+    header.ids = out.end(at);
+
+    at = out.begin();
+    uint64_t offset = 0;
+    out.write(offset);
+    for (const auto& slot : slots) {
+        offset += slot->deviceId.size();
+        out.write(offset);
+    }
+    header.idOffsets = out.end(at);
+
+    at = out.begin();
+    for (const auto& slot : slots) {
+        out.write(static_cast<uint8_t>(slot->status.load(std::memory_order_acquire)));
+    }
+    header.status = out.end(at);
+
+    at = out.begin();
+    for (const auto& slot : slots) {
+        out.write(slot->heartbeatTimeoutMs.load(std::memory_order_relaxed));
+    }
+    header.timeouts = out.end(at);
+
+    std::vector<uint64_t> offsets;
+    offsets.reserve(slots.size() + 1);
+    at = out.begin();
+    offset = 0;
+    offsets.push_back(offset);
+    std::string scratch;
+    for (const auto& slot : slots) {
+        {
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            scratch.assign(slot->lastStatusReport);
+        }
+        out.write(scratch.data(), scratch.size());
+        offset += scratch.size();
+        offsets.push_back(offset);
+    }
+    header.reports = out.end(at);
+
+    at = out.begin();
+    out.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+    header.reportOffsets = out.end(at);
+
+    // 属性键按首次出现的顺序编入本地键表，每个属性只占 2 字节键下标
+    // Attribute keys get local indexes in order of first use, so each attribute stores a 2-byte key index
+    std::vector<int32_t> localIndex(size_t { std::numeric_limits<AttributeKey>::max() } + 1, -1);
+    std::vector<AttributeKey> localKeys;
+    offsets.clear();
+    at = out.begin();
+    offset = 0;
+    offsets.push_back(offset);
+    for (const auto& slot : slots) {
+        scratch.clear();
+        {
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            slot->attributes.forEach([&](AttributeKey key, const AttributeValue& value) {
+                if (localIndex[key] < 0) {
+                    localIndex[key] = static_cast<int32_t>(localKeys.size());
+                    localKeys.push_back(key);
+                }
+                put(scratch, static_cast<uint16_t>(localIndex[key]));
+                put(scratch, static_cast<uint8_t>(value.index()));
+                if (const auto* number = std::get_if<double>(&value)) {
+                    put(scratch, *number);
+                } else if (const auto* flag = std::get_if<bool>(&value)) {
+                    put(scratch, static_cast<uint8_t>(*flag));
+                } else {
+                    const auto& text = std::get<std::string>(value);
+                    put(scratch, static_cast<uint32_t>(text.size()));
+                    scratch.append(text);
+                }
+            });
+        }
+        out.write(scratch.data(), scratch.size());
+        offset += scratch.size();
+        offsets.push_back(offset);
+    }
+    header.attributes = out.end(at);
+
+    at = out.begin();
+    out.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+    header.attributeOffsets = out.end(at);
+
+    at = out.begin();
+    out.write(static_cast<uint32_t>(localKeys.size()));
+    for (auto key : localKeys) {
+        const auto& name = AttributeKeys::instance().name(key);
+        out.write(static_cast<uint32_t>(name.size()));
+        out.write(name.data(), name.size());
+    }
+    header.keys = out.end(at);
+
+    // 所有者同样按首次出现的顺序编入表中，每台设备只存一个下标
+    // Owners likewise get table indexes in order of first use, so each device stores a single index
+    std::unordered_map<std::string, uint32_t> ownerIndex;
+    std::vector<const std::string*> owners;
+    at = out.begin();
+    for (const auto& slot : slots) {
+        {
+            std::lock_guard<std::mutex> lock(slot->mutex);
+            scratch.assign(slot->owner);
+        }
+        uint32_t index = 0;
+        if (!scratch.empty()) {
+            auto [entry, added] = ownerIndex.try_emplace(scratch, static_cast<uint32_t>(owners.size() + 1));
+            if (added) {
+                owners.push_back(&entry->first);
+            }
+            index = entry->second;
+        }
+        out.write(index);
+    }
+    header.ownerIndex = out.end(at);
+
+    at = out.begin();
+    out.write(static_cast<uint32_t>(owners.size()));
+    for (const auto* owner : owners) {
+        out.write(static_cast<uint32_t>(owner->size()));
+        out.write(owner->data(), owner->size());
+    }
+    header.owners = out.end(at);
+
+    header.crc = crc32c(reinterpret_cast<const char*>(&header), offsetof(Header, crc));
+    bool ok = out.ok() && std::fseek(file, 0, SEEK_SET) == 0 &&
+              std::fwrite(&header, 1, sizeof(header), file) == sizeof(header) && std::fflush(file) == 0 &&
+              fsync(fileno(file)) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(staging.c_str(), path.c_str()) != 0) {
+        std::cerr << kTAG << ": cannot write " << path << ": " << std::strerror(errno) << std::endl;
+        std::remove(staging.c_str());
+        return false;
+    }
+    syncDirectory(path);
+    return true;
+}
+
+DeviceSnapshot::~DeviceSnapshot() {
+    if (mImage != nullptr) {
+        munmap(mImage, mImageBytes);
+    }
+}
+
+auto DeviceSnapshot::size() const -> size_t {
+    return static_cast<size_t>(mCount);
+}
+
+auto DeviceSnapshot::walGeneration() const -> uint64_t {
+    return mWalGeneration;
+}
+
+auto DeviceSnapshot::find(std::string_view deviceId) const -> std::optional<size_t> {
+    size_t low = 0;
+    size_t high = size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (this->deviceId(middle) < deviceId) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < size() && this->deviceId(low) == deviceId) {
+        return low;
+    }
+    return std::nullopt;
+}
+
+auto DeviceSnapshot::deviceId(size_t row) const -> std::string_view {
+    return blob(mIdOffsets, mIdBytes, mIdBytesSize, row);
+}
+
+auto DeviceSnapshot::status(size_t row) const -> DeviceStatus {
+    auto value = mStatus[row];
+    return value <= static_cast<uint8_t>(DeviceStatus::ERROR) ? static_cast<DeviceStatus>(value)
+                                                              : DeviceStatus::UNKNOWN;
+}
+
+auto DeviceSnapshot::heartbeatTimeoutMs(size_t row) const -> int64_t {
+    return std::max<int64_t>(mTimeouts[row], 0);
+}
+
+auto DeviceSnapshot::report(size_t row) const -> std::string_view {
+    return blob(mReportOffsets, mReportBytes, mReportBytesSize, row);
+}
+
+auto DeviceSnapshot::attributes(size_t row) const -> std::vector<AttributeUpdate> {
+    auto bytes = blob(mAttributeOffsets, mAttributeBytes, mAttributeBytesSize, row);
+    BlobReader reader { bytes.data(), bytes.data() + bytes.size() };
+    std::vector<AttributeUpdate> updates;
+    while (reader.ok && reader.cursor < reader.end) {
+        auto index = reader.get<uint16_t>();
+        auto type = reader.get<uint8_t>();
+        AttributeValue value;
+        switch (type) {
+        case 0:
+            value = reader.get<double>();
+            break;
+        case 1:
+            value = reader.get<uint8_t>() != 0;
+            break;
+        case 2:
+            value = std::string(reader.getString());
+            break;
+        default:
+            reader.ok = false;
+            break;
+        }
+        if (reader.ok && index < mKeys.size() && mKeys[index]) {
+            updates.push_back(AttributeUpdate { *mKeys[index], std::move(value) });
+        }
+    }
+    return updates;
+}
+
+auto DeviceSnapshot::owner(size_t row) const -> std::string_view {
+    uint32_t index = mOwnerIndex[row];
+    return index > 0 && index <= mOwners.size() ? mOwners[index - 1] : std::string_view {};
+}
+
+auto DeviceSnapshot::blob(const uint64_t* offsets, const char* bytes, uint64_t size, size_t row) -> std::string_view {
+    uint64_t begin = offsets[row];
+    uint64_t end = offsets[row + 1];
+    if (begin > end || end > size) {
+        return {};
+    }
+    return std::string_view(bytes + begin, end - begin);
+}
+
+IOT_DEVICE_NS_END
@@ -0,0 +1,979 @@
+/**
+ * @brief Implementation of DeviceWal class
+ * @brief DeviceWal 类的实现文件
+ *
+ * io_uring is driven through its raw system calls so the build needs no liburing; the ring has a handful of
+ * entries because the flusher never has more than one batch (a write and its fdatasync) in flight.
+ * io_uring 直接通过系统调用使用，构建无需 liburing；刷盘线程同时最多只有一个批次（一次写入加一次 fdatasync）
+ * 在途，因此环只需几个条目。
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-07
+ */
+
+#include "DeviceWal.h"
+#include "StorageUtil.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define IOT_WAL_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+IOT_DEVICE_NS_BEGIN
+
+namespace {
+
+constexpr std::string_view kMAGIC { "IOTWAL02", 8 }; // 文件头魔数，含格式版本
+constexpr uint64_t kHEADER_BYTES = 16;               // 文件头：魔数与日志代数
+constexpr uint32_t kFRAME_BYTES = 8;                 // 记录头：负载长度与 CRC-32C
+constexpr uint32_t kMAX_RECORD = 64u << 20;          // 单条记录负载上限，超过视为损坏
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, std::string_view text) {
+    put(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+/**
+ * @brief 开始编码一条记录：预留记录头并写入类型与设备 ID
+ */
+auto beginRecord(WalRecord::Type type, const std::string& deviceId) -> std::string& {
+    thread_local std::string scratch;
+    scratch.assign(kFRAME_BYTES, '\0');
+    put(scratch, static_cast<uint8_t>(type));
+    putString(scratch, deviceId);
+    return scratch;
+}
+
+/**
+ * @brief 填写记录头：负载长度与负载的 CRC-32C
+ */
+auto finishRecord(std::string& record) -> const std::string& {
+    auto length = static_cast<uint32_t>(record.size() - kFRAME_BYTES);
+    uint32_t crc = crc32c(record.data() + kFRAME_BYTES, length);
+    std::memcpy(record.data(), &length, sizeof(length));
+    std::memcpy(record.data() + sizeof(length), &crc, sizeof(crc));
+    return record;
+}
+
+/**
+ * @brief 记录负载的顺序读取器，越界后 ok 置为 false 且后续读取都返回空值
+ */
+struct PayloadReader {
+    const char* cursor;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    auto get() -> T {
+        T value {};
+        if (!ok || static_cast<size_t>(end - cursor) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    auto getString() -> std::string {
+        auto size = get<uint32_t>();
+        if (!ok || static_cast<size_t>(end - cursor) < size) {
+            ok = false;
+            return {};
+        }
+        std::string text(cursor, size);
+        cursor += size;
+        return text;
+    }
+};
+
+/**
+ * @brief 解码一条记录的负载
+ *
+ * @return 负载完整且类型已知时返回 true
+ */
+auto decodeRecord(const char* payload, uint32_t size, WalRecord& record) -> bool {
+    PayloadReader reader { payload, payload + size };
+    record.type = static_cast<WalRecord::Type>(reader.get<uint8_t>());
+    record.deviceId = reader.getString();
+    switch (record.type) {
+    case WalRecord::Type::Register:
+        break;
+    case WalRecord::Type::Transition:
+        record.status = static_cast<DeviceStatus>(reader.get<uint8_t>());
+        break;
+    case WalRecord::Type::Status: {
+        record.report = reader.getString();
+        auto count = reader.get<uint32_t>();
+        record.details.clear();
+        for (uint32_t i = 0; reader.ok && i < count; ++i) {
+            auto key = reader.getString();
+            auto value = reader.getString();
+            record.details.emplace_back(std::move(key), std::move(value));
+        }
+        break;
+    }
+    case WalRecord::Type::Timeout:
+        record.timeoutMs = reader.get<int64_t>();
+        break;
+    case WalRecord::Type::Owner:
+        record.owner = reader.getString();
+        break;
+    default:
+        return false;
+    }
+    return reader.ok && reader.cursor == reader.end;
+}
+
+/**
+ * @brief 解析文件头
+ *
+ * @param data 文件内容
+ * @param size 文件长度
+ * @param generation 输出的日志代数
+ * @return 文件头长度，不是设备日志时为 0
+ */
+auto parseHeader(const char* data, uint64_t size, uint64_t& generation) -> uint64_t {
+    if (size >= kHEADER_BYTES && std::string_view(data, kMAGIC.size()) == kMAGIC) {
+        std::memcpy(&generation, data + kMAGIC.size(), sizeof(generation));
+        return kHEADER_BYTES;
+    }
+    return 0;
+}
+
+/**
+ * @brief 创建只含文件头的新日志并落盘
+ *
+ * @param path 文件路径，已存在时被清空
+ * @param generation 日志代数
+ * @return 文件描述符，失败时为 -1
+ */
+auto createLog(const std::string& path, uint64_t generation) -> int {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    std::string header(kMAGIC);
+    put(header, generation);
+    if (pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()) || fdatasync(fd) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 已轮转日志段的路径：当前日志路径加 "." 与代数
+ */
+auto segmentPath(const std::string& path, uint64_t generation) -> std::string {
+    return path + "." + std::to_string(generation);
+}
+
+/**
+ * @brief 列出当前日志的全部轮转段，按代数升序
+ */
+auto listSegments(const std::string& path) -> std::vector<std::pair<uint64_t, std::string>> {
+    std::vector<std::pair<uint64_t, std::string>> segments;
+    std::filesystem::path current(path);
+    auto directory = current.has_parent_path() ? current.parent_path() : std::filesystem::path(".");
+    std::string prefix = current.filename().string() + ".";
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        uint64_t generation = 0;
+        const char* begin = name.data() + prefix.size();
+        const char* end = name.data() + name.size();
+        auto [last, error] = std::from_chars(begin, end, generation);
+        if (error == std::errc {} && last == end) {
+            segments.emplace_back(generation, entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+} // namespace
+
+#ifdef IOT_WAL_URING
+
+/**
+ * @brief 最小化的 io_uring 封装：每次提交一次写入，可选链接一次 fdatasync，并等待全部完成
+ */
+struct DeviceWal::Uring {
+    ~Uring() {
+        if (sqes) {
+            munmap(sqes, sqesBytes);
+        }
+        if (cqRing && cqRing != sqRing) {
+            munmap(cqRing, cqBytes);
+        }
+        if (sqRing) {
+            munmap(sqRing, sqBytes);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /**
+     * @brief 创建 io_uring 实例，内核不支持或被禁止时返回空
+     */
+    static auto create() -> std::unique_ptr<Uring> {
+        io_uring_params params {};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, 4, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto ring = std::make_unique<Uring>();
+        ring->fd = fd;
+        ring->sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            ring->sqBytes = ring->cqBytes = std::max(ring->sqBytes, ring->cqBytes);
+        }
+        ring->sqRing = mmap(nullptr, ring->sqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                            IORING_OFF_SQ_RING);
+        if (ring->sqRing == MAP_FAILED) {
+            ring->sqRing = nullptr;
+            return nullptr;
+        }
+        ring->cqRing = single ? ring->sqRing
+                              : mmap(nullptr, ring->cqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            ring->cqRing = nullptr;
+            return nullptr;
+        }
+        ring->sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, ring->sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(ring->sqRing);
+        auto* cq = static_cast<char*>(ring->cqRing);
+        ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    /**
+     * @brief 提交一次写入（可选链接 fdatasync）并等待完成
+     *
+     * @param file 目标文件描述符
+     * @param data 待写数据
+     * @param size 数据长度
+     * @param offset 文件偏移
+     * @param sync 是否在写入后链接 fdatasync
+     * @param writeResult 写入结果：写入字节数或负的错误码
+     * @param syncResult 同步结果：0 或负的错误码（写入不完整时为 -ECANCELED）
+     * @return false 提交或等待失败，结果不可用
+     */
+    auto submit(int file, const char* data, uint32_t size, uint64_t offset, bool sync, int& writeResult,
+                int& syncResult) -> bool {
+        unsigned tail = *sqTail;
+        auto prepare = [this, &tail](uint8_t opcode) -> io_uring_sqe& {
+            unsigned index = tail & sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqArray[index] = index;
+            ++tail;
+            return sqe;
+        };
+
+        io_uring_sqe& write = prepare(IORING_OP_WRITE);
+        write.fd = file;
+        write.addr = reinterpret_cast<uint64_t>(data);
+        write.len = size;
+        write.off = offset;
+        write.user_data = 0;
+        unsigned count = 1;
+        if (sync) {
+            write.flags = IOSQE_IO_LINK; // 写入完整成功后才执行同步
+            io_uring_sqe& fsync = prepare(IORING_OP_FSYNC);
+            fsync.fd = file;
+            fsync.fsync_flags = IORING_FSYNC_DATASYNC;
+            fsync.user_data = 1;
+            count = 2;
+        }
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        writeResult = -ECANCELED;
+        syncResult = -ECANCELED;
+        unsigned toSubmit = count;
+        unsigned reaped = 0;
+        while (reaped < count) {
+            long rc = syscall(__NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(rc));
+            unsigned head = *cqHead;
+            unsigned ready = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != ready; ++head, ++reaped) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                (cqe.user_data == 0 ? writeResult : syncResult) = cqe.res;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+    int fd = -1;                   // io_uring 实例
+    void* sqRing = nullptr;        // 提交队列环映射
+    void* cqRing = nullptr;        // 完成队列环映射，单次映射时与 sqRing 相同
+    size_t sqBytes = 0;            // 提交队列环映射长度
+    size_t cqBytes = 0;            // 完成队列环映射长度
+    io_uring_sqe* sqes = nullptr;  // 提交队列条目数组
+    size_t sqesBytes = 0;          // 提交队列条目映射长度
+    unsigned* sqTail = nullptr;    // 提交队列尾
+    unsigned sqMask = 0;           // 提交队列掩码
+    unsigned* sqArray = nullptr;   // 提交队列下标数组
+    unsigned* cqHead = nullptr;    // 完成队列头
+    unsigned* cqTail = nullptr;    // 完成队列尾
+    unsigned cqMask = 0;           // 完成队列掩码
+    io_uring_cqe* cqes = nullptr;  // 完成队列条目数组
+};
+
+#else
+
+/**
+ * @brief 非 Linux 平台没有 io_uring，始终使用 pwrite 与 fdatasync
+ */
+struct DeviceWal::Uring {
+    static auto create() -> std::unique_ptr<Uring> { return nullptr; }
+
+    auto submit(int, const char*, uint32_t, uint64_t, bool, int&, int&) -> bool { return false; }
+};
+
+#endif
+
+/**
+ * @brief Constructor
+ * @brief 构造函数
+ */
+DeviceWal::DeviceWal(std::string path, WalDurability durability, std::chrono::milliseconds flushInterval)
+    : mPath(std::move(path)),
+      mDurability(durability),
+      mFlushInterval(std::max(flushInterval, std::chrono::milliseconds(1))) {}
+
+/**
+ * @brief Destructor
+ * @brief 析构函数
+ */
+DeviceWal::~DeviceWal() {
+    close();
+}
+
+/**
+ * @brief Replay the existing log and start appending
+ * @brief 回放已有日志并开始追加
+ *
+ * 先按代数回放不早于 minGeneration 的轮转段，更早的段已被快照覆盖，直接删除；再回放当前日志。日志以只读映射回放，
+ * 不复制文件内容；当前日志中第一条无法解析或校验失败的记录及其之后的内容被截掉，之后的追加从有效内容末尾开始。
+ * Rotated segments not older than minGeneration are replayed first, in generation order; older ones are covered
+ * by a snapshot and deleted. The current log follows. Logs are replayed from read-only mappings without copying
+ * them; in the current log the first record that fails to parse or verify is cut off together with everything
+ * after it, and appends continue from the valid end.
+ *
+ * @param replay 逐条接收记录的回调
+ * @param minGeneration 需要回放的最早代数
+ * @return true 打开成功；false 文件无法打开或不是设备日志
+ */
+auto DeviceWal::open(const Replayer& replay, uint64_t minGeneration) -> bool {
+    uint64_t nextGeneration = minGeneration;
+    for (const auto& [generation, segment] : listSegments(mPath)) {
+        std::error_code ec;
+        if (generation < minGeneration) {
+            std::filesystem::remove(segment, ec);
+            continue;
+        }
+        int fd = ::open(segment.c_str(), O_RDONLY | O_CLOEXEC);
+        uint64_t header = 0;
+        uint64_t valid = 0;
+        if (fd < 0 || !scanLog(fd, minGeneration, replay, header, valid)) {
+            std::cerr << kTAG << ": skipping unreadable segment " << segment << std::endl;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        nextGeneration = std::max(nextGeneration, generation + 1);
+    }
+
+    mFd = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (mFd < 0) {
+        std::cerr << kTAG << ": cannot open " << mPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    uint64_t generation = 0;
+    uint64_t valid = 0;
+    if (!scanLog(mFd, minGeneration, replay, generation, valid)) {
+        std::cerr << kTAG << ": " << mPath << " is not a device log" << std::endl;
+        ::close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    struct stat st {};
+    fstat(mFd, &st);
+    auto fileSize = static_cast<uint64_t>(st.st_size);
+    if (valid == 0) {
+        // 新文件、创建时写入文件头之前就中断的文件，或内容已被快照覆盖的文件
+        ::close(mFd);
+        generation = nextGeneration;
+        mFd = createLog(mPath, generation);
+        if (mFd < 0) {
+            std::cerr << kTAG << ": cannot initialize " << mPath << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        valid = kHEADER_BYTES;
+    } else if (valid < fileSize) {
+        std::cerr << kTAG << ": cutting " << fileSize - valid << " torn bytes off " << mPath << std::endl;
+        if (ftruncate(mFd, static_cast<off_t>(valid)) != 0) {
+            std::cerr << kTAG << ": cannot truncate " << mPath << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    mUring = Uring::create();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGeneration = generation;
+        mAppended = valid;
+        mDurable = valid;
+        mRunning = true;
+    }
+    mFlusher = std::thread([this]() { flushLoop(); });
+    std::cout << "[DeviceWal] Opened " << mPath << ", generation " << generation << ", " << valid
+              << " bytes, backend " << backend() << std::endl;
+    return true;
+}
+
+/**
+ * @brief Flush every appended record and stop the flusher
+ * @brief 刷写全部已追加的记录并停止刷盘线程
+ */
+void DeviceWal::close() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mFlushWake.notify_all();
+    if (mFlusher.joinable()) {
+        mFlusher.join();
+    }
+    mUring.reset();
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+}
+
+/**
+ * @brief Start a new log generation
+ * @brief 开始新一代日志
+ *
+ * 新文件在锁外创建并落盘；锁内只等待刷盘线程写完已追加的记录，然后做两次重命名并切换文件描述符，
+ * 写入方只在这段很短的时间内等待。轮转期间新的追加一律等待，因此开始时记下的目标偏移不会被持续的写入推远。
+ * 写入出错后日志拒绝追加，成功的轮转把损坏的文件移作轮转段并恢复写入。
+ * The new file is created and synced outside the lock; under it the caller only waits for the flusher to write
+ * the records appended so far, then renames twice and swaps descriptors, so writers wait only for that short
+ * window. New appends wait while the rotation is pending, so the target captured at its start cannot move away
+ * under a steady stream of writers. After a write error the log refuses appends; a successful rotation moves the
+ * damaged file aside as a segment and lets writes resume.
+ *
+ * @return 新的代数；失败时为空，日志保持原样
+ */
+auto DeviceWal::rotate() -> std::optional<uint64_t> {
+    uint64_t next = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRunning) {
+            return std::nullopt;
+        }
+        next = mGeneration + 1;
+    }
+    std::string staging = mPath + ".tmp";
+    int fd = createLog(staging, next);
+    if (fd < 0) {
+        std::cerr << kTAG << ": cannot create " << staging << ": " << std::strerror(errno) << std::endl;
+        return std::nullopt;
+    }
+
+    int retired = -1;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        uint64_t target = mAppended;
+        mRotating = true;
+        mFlushWake.notify_one();
+        mDurableWake.wait(lock, [this, target]() { return mDurable >= target || mFailed; });
+        mRotating = false;
+        mDurableWake.notify_all(); // 放行等待轮转的追加 / Release appends waiting for the rotation
+        auto segment = segmentPath(mPath, mGeneration);
+        bool renamed = mRunning && ::rename(mPath.c_str(), segment.c_str()) == 0;
+        if (renamed && ::rename(staging.c_str(), mPath.c_str()) != 0) {
+            ::rename(segment.c_str(), mPath.c_str());
+            renamed = false;
+        }
+        if (!renamed) {
+            lock.unlock();
+            std::cerr << kTAG << ": cannot rotate " << mPath << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            ::unlink(staging.c_str());
+            return std::nullopt;
+        }
+        retired = mFd;
+        mFd = fd;
+        mGeneration = next;
+        mAppended = kHEADER_BYTES;
+        mDurable = kHEADER_BYTES;
+        mFailed = false; // 损坏的文件已移走，新文件重新接受写入 / The damaged file moved aside; the new one takes writes
+    }
+    syncDirectory(mPath);
+    ::close(retired);
+    return next;
+}
+
+/**
+ * @brief Delete rotated segments older than a generation
+ * @brief 删除早于指定代数的轮转段
+ *
+ * @param generation 仍需保留的最早代数
+ */
+void DeviceWal::dropBefore(uint64_t generation) {
+    for (const auto& [segmentGeneration, segment] : listSegments(mPath)) {
+        if (segmentGeneration < generation) {
+            std::error_code ec;
+            std::filesystem::remove(segment, ec);
+        }
+    }
+}
+
+/**
+ * @brief Generation of the current log file
+ * @brief 当前日志文件的代数
+ */
+auto DeviceWal::generation() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mGeneration;
+}
+
+/**
+ * @brief Log a device registration
+ * @brief 记录设备注册
+ *
+ * @param deviceId 设备唯一标识符
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logRegister(const std::string& deviceId) -> bool {
+    return commit(finishRecord(beginRecord(WalRecord::Type::Register, deviceId)));
+}
+
+/**
+ * @brief Log an online/offline transition
+ * @brief 记录在线/离线状态变化
+ *
+ * @param deviceId 设备唯一标识符
+ * @param status 新状态
+ * @param deferred 非空时不等待落盘，凭据写入此处
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logTransition(const std::string& deviceId, DeviceStatus status, WalTicket* deferred) -> bool {
+    auto& record = beginRecord(WalRecord::Type::Transition, deviceId);
+    put(record, static_cast<uint8_t>(status));
+    return commit(finishRecord(record), deferred);
+}
+
+/**
+ * @brief Log a status report
+ * @brief 记录状态上报
+ *
+ * @param deviceId 设备唯一标识符
+ * @param report 状态内容
+ * @param details 变化的属性
+ * @param deferred 非空时不等待落盘，凭据写入此处
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logStatus(const std::string& deviceId, const std::string& report, const StatusDetails& details,
+                          WalTicket* deferred) -> bool {
+    auto& record = beginRecord(WalRecord::Type::Status, deviceId);
+    putString(record, report);
+    put(record, static_cast<uint32_t>(details.size()));
+    for (const auto& [key, value] : details) {
+        putString(record, key);
+        putString(record, value);
+    }
+    return commit(finishRecord(record), deferred);
+}
+
+/**
+ * @brief Log a per-device heartbeat timeout
+ * @brief 记录单设备心跳超时
+ *
+ * @param deviceId 设备唯一标识符
+ * @param timeout 心跳超时，0 表示恢复类别或默认值
+ * @param deferred 非空时不等待落盘，凭据写入此处
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logTimeout(const std::string& deviceId, std::chrono::milliseconds timeout, WalTicket* deferred)
+    -> bool {
+    auto& record = beginRecord(WalRecord::Type::Timeout, deviceId);
+    put(record, static_cast<int64_t>(timeout.count()));
+    return commit(finishRecord(record), deferred);
+}
+
+/**
+ * @brief Log an owner change
+ * @brief 记录设备所有者变化
+ *
+ * @param deviceId 设备唯一标识符
+ * @param owner 新的所有者，为空表示解绑
+ * @param deferred 非空时不等待落盘，凭据写入此处
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logOwner(const std::string& deviceId, const std::string& owner, WalTicket* deferred) -> bool {
+    auto& record = beginRecord(WalRecord::Type::Owner, deviceId);
+    putString(record, owner);
+    return commit(finishRecord(record), deferred);
+}
+
+/**
+ * @brief Log a batch of registrations and owner claims as one commit
+ * @brief 将一批设备注册与所有者认领作为一次提交记录
+ *
+ * @param created 新注册的设备
+ * @param claimed 被条目所有者认领的已有设备
+ * @return false 写入出错后日志拒绝记录，或 Sync 级别下落盘失败
+ */
+auto DeviceWal::logRegistrations(const std::vector<const DeviceRegistration*>& created,
+                                 const std::vector<const DeviceRegistration*>& claimed) -> bool {
+    thread_local std::string batch;
+    batch.clear();
+    for (const auto* device : created) {
+        batch += finishRecord(beginRecord(WalRecord::Type::Register, device->deviceId));
+        if (!device->owner.empty()) {
+            auto& record = beginRecord(WalRecord::Type::Owner, device->deviceId);
+            putString(record, device->owner);
+            batch += finishRecord(record);
+        }
+    }
+    for (const auto* device : claimed) {
+        auto& record = beginRecord(WalRecord::Type::Owner, device->deviceId);
+        putString(record, device->owner);
+        batch += finishRecord(record);
+    }
+    return batch.empty() || commit(batch);
+}
+
+/**
+ * @brief Wait until a deferred record is durable
+ * @brief 等待推迟等待的记录落盘
+ *
+ * @param ticket 日志调用填写的凭据
+ * @return true 已落盘或无需等待；false 记录被拒绝，或所在批次写入或同步失败
+ */
+auto DeviceWal::awaitDurable(const WalTicket& ticket) -> bool {
+    if (ticket.refused) {
+        return false;
+    }
+    if (mDurability != WalDurability::Sync || ticket.end == 0) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    return waitDurable(lock, ticket);
+}
+
+/**
+ * @brief Whether the log refuses appends after a write error
+ * @brief 日志是否因写入错误而拒绝追加
+ *
+ * @return true 出错后尚未轮转
+ */
+auto DeviceWal::failed() const -> bool {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailed;
+}
+
+/**
+ * @brief Bytes of the log file
+ * @brief 日志文件字节数
+ *
+ * @return 包括尚未刷盘记录在内的文件长度
+ */
+auto DeviceWal::size() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mAppended;
+}
+
+/**
+ * @brief Write backend in use
+ * @brief 使用的写入方式
+ *
+ * @return "io_uring" 或 "pwrite"
+ */
+auto DeviceWal::backend() const -> const char* {
+    return mUring ? "io_uring" : "pwrite";
+}
+
+/**
+ * @brief Append an encoded record to the pending batch
+ * @brief 将编码后的记录追加到待写批次
+ *
+ * 锁内只做一次内存追加，轮转期间先等待其完成。Sync 级别下唤醒刷盘线程并等待：刷盘线程写入上一批次期间到达的记录
+ * 会合并为下一批次，共享同一次 fdatasync，这就是组提交。写入出错后到下一次轮转之前，记录直接被拒绝。
+ * Only a memory append happens under the lock, after waiting out a pending rotation. In Sync mode the flusher is
+ * woken and the caller waits: records arriving while the flusher writes the previous batch gather into the next
+ * one and share one fdatasync, which is the group commit. After a write error records are refused outright until
+ * the next rotation.
+ *
+ * @param record 带记录头的完整记录
+ * @param deferred 非空时不等待落盘，凭据写入此处
+ * @return true 已追加（Sync 级别且未推迟时已落盘），日志已关闭时记录被忽略；false 写入出错后拒绝追加或落盘失败
+ */
+auto DeviceWal::commit(const std::string& record, WalTicket* deferred) -> bool {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDurableWake.wait(lock, [this]() { return !mRotating; });
+    if (!mRunning || mFailed) {
+        if (deferred) {
+            deferred->refused = mFailed;
+        }
+        return !mFailed;
+    }
+    mPending += record;
+    mAppended += record.size();
+    if (mDurability == WalDurability::Sync) {
+        WalTicket ticket { mGeneration, mAppended, false };
+        mFlushWake.notify_one();
+        if (!deferred) {
+            return waitDurable(lock, ticket);
+        }
+        *deferred = ticket;
+    } else if (mPending.size() >= kFLUSH_BYTES) {
+        mFlushWake.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Wait under the log lock until a ticket is durable
+ * @brief 持有日志锁时等待凭据对应的记录落盘
+ *
+ * @param lock 已持有的日志锁
+ * @param ticket 记录位置
+ * @return true 已落盘；false 所在批次写入或同步失败
+ */
+auto DeviceWal::waitDurable(std::unique_lock<std::mutex>& lock, const WalTicket& ticket) -> bool {
+    mDurableWake.wait(lock, [this, &ticket]() {
+        return mGeneration != ticket.generation || mDurable >= ticket.end || lostLocked(ticket);
+    });
+    return !lostLocked(ticket);
+}
+
+/**
+ * @brief Whether a ticket points into a lost batch
+ * @brief 凭据是否落在丢失的批次中
+ *
+ * 出错之后该代数不再接受追加，因此出错批次起始偏移之后的记录都没有落盘。
+ * The generation takes no appends after the error, so every record past the start of the failed batch is lost.
+ *
+ * @param ticket 记录位置
+ * @return true 记录未落盘
+ */
+auto DeviceWal::lostLocked(const WalTicket& ticket) const -> bool {
+    return ticket.generation == mLostGeneration && ticket.end > mLostFrom;
+}
+
+/**
+ * @brief Body of the flusher thread
+ * @brief 刷盘线程主体
+ *
+ * 与待写批次交换缓冲区后在锁外写入，两块缓冲区交替使用，稳定后不再分配内存；停止前写完所有剩余记录。
+ * 写入或同步失败时不推进落盘偏移：记下出错批次的位置，丢弃其后已追加的记录，唤醒的等待方据此得到失败。
+ * The pending buffer is swapped out and written outside the lock; the two buffers alternate and stop
+ * allocating once warm. Every remaining record is written before the thread stops. A failed write or sync does
+ * not advance the durable offset: the position of the failed batch is recorded, the records appended after it
+ * are dropped, and the woken waiters see the failure.
+ */
+void DeviceWal::flushLoop() {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mFlushWake.wait_for(lock, mFlushInterval, [this]() {
+            return !mRunning || mPending.size() >= kFLUSH_BYTES ||
+                   ((mDurability == WalDurability::Sync || mRotating) && !mPending.empty());
+        });
+        if (mPending.empty()) {
+            if (!mRunning) {
+                return;
+            }
+            continue;
+        }
+        batch.swap(mPending);
+        uint64_t end = mAppended;
+        uint64_t start = end - batch.size();
+        int fd = mFd;
+        lock.unlock();
+
+        bool ok = writeBatch(fd, batch, start);
+        batch.clear();
+
+        lock.lock();
+        if (ok) {
+            mDurable = end;
+        } else {
+            std::cerr << kTAG << ": write to " << mPath << " failed, refusing appends until the log is rotated"
+                      << std::endl;
+            mFailed = true;
+            mLostGeneration = mGeneration;
+            mLostFrom = start;
+            mAppended = start;
+            mPending.clear();
+        }
+        mDurableWake.notify_all();
+    }
+}
+
+/**
+ * @brief Write a batch and sync it
+ * @brief 写入一个批次并同步
+ *
+ * 优先以一次链接的 io_uring 提交完成写入与 fdatasync；写入不完整或 io_uring 不可用时，用 pwrite 补齐剩余部分并单独同步。
+ * Prefers a single linked io_uring submission for the write and the fdatasync; on a short write or without
+ * io_uring the rest is written with pwrite and synced separately.
+ *
+ * @param fd 日志文件描述符
+ * @param batch 待写数据
+ * @param offset 文件偏移
+ * @return true 成功；false 写入或同步出错
+ */
+auto DeviceWal::writeBatch(int fd, const std::string& batch, uint64_t offset) -> bool {
+    bool sync = mDurability != WalDurability::None;
+    size_t written = 0;
+    bool synced = false;
+    if (mUring && batch.size() <= UINT32_MAX) {
+        int writeResult = 0;
+        int syncResult = 0;
+        if (mUring->submit(fd, batch.data(), static_cast<uint32_t>(batch.size()), offset, sync, writeResult,
+                           syncResult)) {
+            written = writeResult > 0 ? static_cast<size_t>(writeResult) : 0;
+            synced = sync && written == batch.size() && syncResult == 0;
+            if (writeResult == -EINVAL || writeResult == -EOPNOTSUPP) {
+                mUring.reset(); // 内核不支持该操作，之后直接使用 pwrite
+            }
+        }
+    }
+    while (written < batch.size()) {
+        ssize_t n = pwrite(fd, batch.data() + written, batch.size() - written, static_cast<off_t>(offset + written));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return !sync || synced || fdatasync(fd) == 0;
+}
+
+/**
+ * @brief Map a log file and replay its records
+ * @brief 映射日志文件并回放其中的记录
+ *
+ * @param fd 日志文件描述符
+ * @param minGeneration 需要回放的最早代数，更早的日志不回放
+ * @param replay 记录回调
+ * @param generation 输出的日志代数
+ * @param valid 输出的有效前缀长度（含文件头）；空文件、文件头不完整或代数过早时为 0
+ * @return false 文件无法映射或不是设备日志
+ */
+auto DeviceWal::scanLog(int fd, uint64_t minGeneration, const Replayer& replay, uint64_t& generation,
+                        uint64_t& valid) -> bool {
+    struct stat st {};
+    fstat(fd, &st);
+    auto fileSize = static_cast<uint64_t>(st.st_size);
+    generation = 0;
+    valid = 0;
+    if (fileSize < kMAGIC.size()) {
+        return true;
+    }
+    void* image = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED) {
+        return false;
+    }
+    const auto* data = static_cast<const char*>(image);
+    uint64_t header = parseHeader(data, fileSize, generation);
+    // 文件头未写完整（创建时中断）的文件按空日志处理；其他格式版本的完整日志不是本版本的日志，不予改写
+    bool isLog = header > 0 || (fileSize < kHEADER_BYTES && std::string_view(data, kMAGIC.size()) == kMAGIC);
+    if (header > 0 && generation >= minGeneration) {
+        madvise(image, fileSize, MADV_SEQUENTIAL);
+        valid = header + replayImage(data + header, fileSize - header, replay);
+    }
+    munmap(image, fileSize);
+    return isLog;
+}
+
+/**
+ * @brief Replay the records of a mapped log image
+ * @brief 回放映射到内存的日志内容
+ *
+ * @param data 文件头之后的日志内容
+ * @param size 内容长度
+ * @param replay 记录回调
+ * @return 有效前缀的长度
+ */
+auto DeviceWal::replayImage(const char* data, uint64_t size, const Replayer& replay) -> uint64_t {
+    uint64_t offset = 0;
+    WalRecord record;
+    while (size - offset >= kFRAME_BYTES) {
+        uint32_t length = 0;
+        uint32_t crc = 0;
+        std::memcpy(&length, data + offset, sizeof(length));
+        std::memcpy(&crc, data + offset + sizeof(length), sizeof(crc));
+        const char* payload = data + offset + kFRAME_BYTES;
+        if (length == 0 || length > kMAX_RECORD || length > size - offset - kFRAME_BYTES ||
+            crc32c(payload, length) != crc || !decodeRecord(payload, length, record)) {
+            break;
+        }
+        if (replay) {
+            replay(record);
+        }
+        offset += kFRAME_BYTES + length;
+    }
+    return offset;
+}
+
+IOT_DEVICE_NS_END
@@ -0,0 +1,117 @@
+/**
+ * @brief Implementation of the storage helpers shared by the device log and snapshot
+ * @brief 设备日志与快照共用的存储工具函数的实现文件
+ *
+ * CRC-32C 启动时按 CPU 选定实现：x86-64 支持 SSE4.2 时使用 crc32 指令，否则查表；两种实现结果相同，
+ * 日志与快照可在不同机器间迁移。
+ * The CRC-32C implementation is picked at startup: the crc32 instruction on x86-64 with SSE4.2, a lookup table
+ * otherwise. Both give the same result, so logs and snapshots move freely between machines.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-07-08
+ */
+
+#include "StorageUtil.h"
+
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define IOT_CRC32C_X86 1
+#include <immintrin.h>
+#endif
+
+IOT_DEVICE_NS_BEGIN
+
+namespace {
+
+/**
+ * @brief 生成 CRC-32C（Castagnoli，反射多项式 0x82F63B78）查找表
+ */
+constexpr auto makeCrcTable() -> std::array<uint32_t, 256> {
+    std::array<uint32_t, 256> table {};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr auto kCRC_TABLE = makeCrcTable();
+
+auto crc32cScalar(const char* data, size_t size) -> uint32_t {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = kCRC_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef IOT_CRC32C_X86
+
+/**
+ * @brief SSE4.2 crc32 指令版本，每条指令处理 8 字节
+ */
+__attribute__((target("sse4.2"))) auto crc32cSse42(const char* data, size_t size) -> uint32_t {
+    uint64_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    auto crc32 = static_cast<uint32_t>(crc);
+    for (; i < size; ++i) {
+        crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(data[i]));
+    }
+    return ~crc32;
+}
+
+#endif
+
+} // namespace
+
+/**
+ * @brief Compute the CRC-32C of a byte range
+ * @brief 计算一段字节的 CRC-32C
+ *
+ * @param data 数据
+ * @param size 数据长度
+ * @return 校验值
+ */
+auto crc32c(const char* data, size_t size) -> uint32_t {
+    static const auto kernel = []() {
+#ifdef IOT_CRC32C_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2")) {
+            return crc32cSse42;
+        }
+#endif
+        return crc32cScalar;
+    }();
+    return kernel(data, size);
+}
+
+/**
+ * @brief Fsync the directory holding a file
+ * @brief 同步文件所在的目录
+ *
+ * @param path 文件路径
+ */
+void syncDirectory(const std::string& path) {
+    auto directory = std::filesystem::path(path).parent_path();
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+}
+
+IOT_DEVICE_NS_END
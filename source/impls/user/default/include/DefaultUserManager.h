@@ -6,6 +6,8 @@
 #include "UserManagerFactory.h"
 
 #include <iostream>
+#include <string>
+#include <unordered_map>
 
 IOT_USER_NS_BEGIN
 
@@ -13,8 +15,13 @@ IOT_USER_NS_BEGIN
  * @brief 默认用户管理器实现类
  * @brief Default implementation of IUserManager
  *
- * 负责实现用户验证的具体逻辑。
- * Implements the concrete logic for user validation.
+ * 负责实现用户验证的具体逻辑：配置了凭据文件时按用户ID比对令牌；未配置时拒绝所有用户，
+ * 只有显式开启 insecure 才进入开放模式，只要求用户ID非空。
+ * 凭据在 configure() 中一次性加载，之后只读，validateUser 可在多个线程上并发调用。
+ * Implements the concrete logic for user validation: with a credentials file the token is compared against the
+ * one recorded for the user ID; without one every user is rejected, and only an explicit insecure option opens
+ * the manager to any non-empty user ID.
+ * Credentials are loaded once in configure() and read-only afterwards, so validateUser may run concurrently.
  *
  * @author Solo
  * @version 1.1
@@ -37,8 +44,18 @@ public:
      */
     auto validateUser(const User& user) -> bool override;
 
+    /**
+     * @brief 加载凭据文件
+     * @brief Load the credentials file
+     *
+     * @param options 用户管理器参数 / User manager options
+     */
+    void configure(const UserManagerOptions& options) override;
+
 private:
     static constexpr const char* kTAG = "DefaultUserManager";
+    std::unordered_map<std::string, std::string> mCredentials; // 用户ID到令牌 / User ID to token
+    bool mOpen = false;                                        // 显式开放模式，不校验令牌 / Explicit open mode, tokens unchecked
 };
 
 IOT_USER_NS_END
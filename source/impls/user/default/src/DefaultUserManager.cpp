@@ -2,6 +2,8 @@
 #include "PluginFactory.h"
 #include "PluginRegistry.h"
 
+#include <fstream>
+
 IOT_USER_NS_BEGIN
 
 /**
@@ -40,15 +42,82 @@ DefaultUserManager::~DefaultUserManager() {
 /**
  * @brief 验证用户合法性
  * @brief Validate user legitimacy
- * TODO: 实现真实验证逻辑，如调用 GRPC 服务或数据库接口。
- * implement real validation logic such as calling GRPC service or database.
+ *
+ * 用户ID为空时总是失败；开放模式直接通过，否则令牌必须与该用户记录的令牌一致，未加载凭据时全部失败。
+ * An empty user ID always fails; open mode passes the user, otherwise the token must equal the one recorded
+ * for the user, so every user fails while no credentials are loaded.
  *
  * @param user 需要验证的用户对象 / The user object to validate
  * @return bool 返回验证结果 / Returns validation result
  */
 auto DefaultUserManager::validateUser(const User& user) -> bool {
-    // TODO: 这里实现真实的验证逻辑，比如调用 GRPC 服务或数据库接口
-    return false;
+    if (user.userId.empty()) {
+        return false;
+    }
+    if (mOpen) {
+        return true;
+    }
+    auto it = mCredentials.find(user.userId);
+    return it != mCredentials.end() && it->second == user.token;
+}
+
+/**
+ * @brief 加载凭据文件
+ * @brief Load the credentials file
+ *
+ * 每行 `用户ID:令牌`，两端空白被忽略；缺少冒号、用户ID或令牌为空的行被跳过并打印警告。
+ * 未配置凭据文件或文件无法打开时拒绝所有用户；只有显式开启 insecure 且未配置凭据文件时进入开放模式。
+ * One `user_id:token` per line with surrounding whitespace ignored; lines without a colon, a user ID or a token
+ * are skipped with a warning. Without a credentials file, or with one that cannot be opened, every user is
+ * rejected; only an explicit insecure option without a credentials file enters open mode.
+ *
+ * @param options 用户管理器参数 / User manager options
+ */
+void DefaultUserManager::configure(const UserManagerOptions& options) {
+    mCredentials.clear();
+    mOpen = options.credentialsFile.empty() && options.insecure;
+    if (mOpen) {
+        std::cerr << "[" << kTAG << "] Insecure mode: no credentials file, accepting every non-empty user ID\n";
+        return;
+    }
+    if (options.credentialsFile.empty()) {
+        std::cerr << "[" << kTAG << "] No credentials file configured, rejecting every user\n";
+        return;
+    }
+
+    std::ifstream file(options.credentialsFile);
+    if (!file) {
+        std::cerr << "[" << kTAG << "] Cannot open credentials file " << options.credentialsFile
+                  << ", rejecting every user\n";
+        return;
+    }
+
+    auto trim = [](const std::string& text) {
+        auto begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+    };
+    std::string line;
+    size_t number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        line = trim(line);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        auto colon = line.find(':');
+        auto userId = colon == std::string::npos ? std::string() : trim(line.substr(0, colon));
+        auto token = colon == std::string::npos ? std::string() : trim(line.substr(colon + 1));
+        if (userId.empty() || token.empty()) {
+            std::cerr << "[" << kTAG << "] Skipping malformed line " << number << " of "
+                      << options.credentialsFile << "\n";
+            continue;
+        }
+        mCredentials[userId] = token;
+    }
+    std::cout << "[" << kTAG << "] Loaded credentials from " << options.credentialsFile << "\n";
 }
 
 IOT_USER_NS_END
@@ -0,0 +1,466 @@
+#include "ServerConfig.h"
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr const char* kTAG = "ServerConfig";     // 日志标识符，用于日志输出
+constexpr const char* kCONFIG_ARG = "--config="; // 指定配置文件的命令行参数前缀
+
+/**
+ * @brief 启动打印时写在对应键之前的说明，打印结果仍可直接作为配置文件使用
+ */
+constexpr std::pair<const char*, const char*> kKEY_NOTES[] = {
+    { "cqs", "cqs, min-pollers and max-pollers apply in sync mode only; callback mode ignores them" },
+};
+
+/**
+ * @brief 单个配置键：键名、解析函数与格式化函数
+ *
+ * 配置文件、命令行与启动打印共用同一张键表，保证三者的键名一致。
+ */
+struct ConfigKey {
+    const char* name;                                             // 配置键名
+    std::function<bool(ServerConfig&, const std::string&)> parse; // 解析并写入配置值
+    std::function<std::string(const ServerConfig&)> format;       // 格式化当前配置值
+};
+
+/**
+ * @brief 去除字符串首尾空白
+ */
+auto trim(const std::string& text) -> std::string {
+    auto begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    auto end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+/**
+ * @brief 解析非负整数，整串必须是合法数字
+ */
+template <typename T>
+auto parseNumber(const std::string& text, T& out) -> bool {
+    T value {};
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc {} || ptr != text.data() + text.size()) {
+        return false;
+    }
+    if constexpr (std::is_signed_v<T>) {
+        if (value < 0) {
+            return false;
+        }
+    }
+    out = value;
+    return true;
+}
+
+/**
+ * @brief 解析布尔值，接受 true/false、1/0、on/off
+ */
+auto parseBool(const std::string& text, bool& out) -> bool {
+    if (text == "true" || text == "1" || text == "on") {
+        out = true;
+        return true;
+    }
+    if (text == "false" || text == "0" || text == "off") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 整数配置键
+ *
+ * @param name 键名
+ * @param field 返回配置字段引用的访问器，需同时接受 const 与非 const 配置
+ */
+template <typename Field>
+auto numberKey(const char* name, Field field) -> ConfigKey {
+    return { name, [field](ServerConfig& c, const std::string& v) { return parseNumber(v, field(c)); },
+             [field](const ServerConfig& c) { return std::to_string(field(c)); } };
+}
+
+/**
+ * @brief 毫秒时长配置键
+ */
+template <typename Field>
+auto millisKey(const char* name, Field field) -> ConfigKey {
+    return { name,
+             [field](ServerConfig& c, const std::string& v) {
+                 int64_t ms = 0;
+                 if (!parseNumber(v, ms)) {
+                     return false;
+                 }
+                 field(c) = std::chrono::milliseconds(ms);
+                 return true;
+             },
+             [field](const ServerConfig& c) { return std::to_string(field(c).count()); } };
+}
+
+/**
+ * @brief 布尔配置键
+ */
+template <typename Field>
+auto boolKey(const char* name, Field field) -> ConfigKey {
+    return { name, [field](ServerConfig& c, const std::string& v) { return parseBool(v, field(c)); },
+             [field](const ServerConfig& c) -> std::string { return field(c) ? "true" : "false"; } };
+}
+
+/**
+ * @brief 按设备类别的心跳超时配置键，值形如 `前缀:毫秒,前缀:毫秒`，空值表示不分类别
+ */
+template <typename Field>
+auto heartbeatClassesKey(const char* name, Field field) -> ConfigKey {
+    return { name,
+             [field](ServerConfig& c, const std::string& v) {
+                 std::vector<IOT_NS::HeartbeatClass> classes;
+                 size_t begin = 0;
+                 while (begin < v.size()) {
+                     auto end = v.find(',', begin);
+                     auto item = trim(v.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+                     auto colon = item.rfind(':');
+                     int64_t ms = 0;
+                     if (colon == std::string::npos || colon == 0 || !parseNumber(item.substr(colon + 1), ms) ||
+                         ms == 0) {
+                         return false;
+                     }
+                     classes.push_back({ item.substr(0, colon), std::chrono::milliseconds(ms) });
+                     begin = end == std::string::npos ? v.size() : end + 1;
+                 }
+                 field(c) = std::move(classes);
+                 return true;
+             },
+             [field](const ServerConfig& c) {
+                 std::string out;
+                 for (const auto& heartbeatClass : field(c)) {
+                     out += (out.empty() ? "" : ",") + heartbeatClass.prefix + ":" +
+                            std::to_string(heartbeatClass.timeout.count());
+                 }
+                 return out;
+             } };
+}
+
+/**
+ * @brief 状态聚合规则配置键，值形如 `名称:属性:窗口毫秒[:步长毫秒],...`，空值表示不聚合
+ */
+template <typename Field>
+auto aggregationsKey(const char* name, Field field) -> ConfigKey {
+    return { name,
+             [field](ServerConfig& c, const std::string& v) {
+                 std::vector<IOT_NS::AggregationSpec> specs;
+                 size_t begin = 0;
+                 while (begin < v.size()) {
+                     auto end = v.find(',', begin);
+                     auto item = trim(v.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+                     std::vector<std::string> parts;
+                     for (size_t from = 0;;) {
+                         auto colon = item.find(':', from);
+                         parts.push_back(item.substr(from, colon == std::string::npos ? colon : colon - from));
+                         if (colon == std::string::npos) {
+                             break;
+                         }
+                         from = colon + 1;
+                     }
+                     int64_t window = 0;
+                     int64_t slide = 0;
+                     if (parts.size() < 3 || parts.size() > 4 || parts[0].empty() || parts[1].empty() ||
+                         !parseNumber(parts[2], window) || window == 0 ||
+                         (parts.size() == 4 && !parseNumber(parts[3], slide))) {
+                         return false;
+                     }
+                     specs.push_back({ parts[0], parts[1], std::chrono::milliseconds(window),
+                                       std::chrono::milliseconds(slide) });
+                     begin = end == std::string::npos ? v.size() : end + 1;
+                 }
+                 field(c) = std::move(specs);
+                 return true;
+             },
+             [field](const ServerConfig& c) {
+                 std::string out;
+                 for (const auto& spec : field(c)) {
+                     out += (out.empty() ? "" : ",") + spec.name + ":" + spec.attribute + ":" +
+                            std::to_string(spec.window.count());
+                     if (spec.slide.count() > 0) {
+                         out += ":" + std::to_string(spec.slide.count());
+                     }
+                 }
+                 return out;
+             } };
+}
+
+/**
+ * @brief 全部配置键，顺序即启动打印的顺序
+ */
+auto configKeys() -> const std::vector<ConfigKey>& {
+    static const std::vector<ConfigKey> keys = {
+        { "address",
+          [](ServerConfig& c, const std::string& v) {
+              if (v.empty()) {
+                  return false;
+              }
+              c.address = v;
+              return true;
+          },
+          [](const ServerConfig& c) { return c.address; } },
+        { "mode",
+          [](ServerConfig& c, const std::string& v) {
+              if (v != "callback" && v != "sync") {
+                  return false;
+              }
+              c.callbackApi = v == "callback";
+              return true;
+          },
+          [](const ServerConfig& c) -> std::string { return c.callbackApi ? "callback" : "sync"; } },
+        numberKey("cqs", [](auto& c) -> auto& { return c.numCqs; }),
+        numberKey("min-pollers", [](auto& c) -> auto& { return c.minPollers; }),
+        numberKey("max-pollers", [](auto& c) -> auto& { return c.maxPollers; }),
+        numberKey("resource-quota-bytes", [](auto& c) -> auto& { return c.resourceQuotaBytes; }),
+        numberKey("max-threads", [](auto& c) -> auto& { return c.maxThreads; }),
+        numberKey("max-concurrent-streams", [](auto& c) -> auto& { return c.maxConcurrentStreams; }),
+        numberKey("max-receive-message-bytes", [](auto& c) -> auto& { return c.maxReceiveMessageBytes; }),
+        numberKey("max-send-message-bytes", [](auto& c) -> auto& { return c.maxSendMessageBytes; }),
+        numberKey("keepalive-time-ms", [](auto& c) -> auto& { return c.keepaliveTimeMs; }),
+        numberKey("keepalive-timeout-ms", [](auto& c) -> auto& { return c.keepaliveTimeoutMs; }),
+        boolKey("keepalive-permit-without-calls", [](auto& c) -> auto& { return c.keepalivePermitWithoutCalls; }),
+        numberKey("router-workers", [](auto& c) -> auto& { return c.router.workerThreads; }),
+        numberKey("outbox-capacity", [](auto& c) -> auto& { return c.router.outboxCapacity; }),
+        numberKey("pending-shards", [](auto& c) -> auto& { return c.router.pendingShardCount; }),
+        boolKey("coalescing", [](auto& c) -> auto& { return c.router.coalescing; }),
+        millisKey("ack-timeout-ms", [](auto& c) -> auto& { return c.router.retry.ackTimeout; }),
+        millisKey("backoff-base-ms", [](auto& c) -> auto& { return c.router.retry.backoffBase; }),
+        millisKey("backoff-max-ms", [](auto& c) -> auto& { return c.router.retry.backoffMax; }),
+        numberKey("max-attempts", [](auto& c) -> auto& { return c.router.retry.maxAttempts; }),
+        millisKey("command-retention-ms", [](auto& c) -> auto& { return c.router.retry.retention; }),
+        millisKey("park-timeout-ms", [](auto& c) -> auto& { return c.router.retry.parkTimeout; }),
+        millisKey("dedup-window-ms", [](auto& c) -> auto& { return c.router.dedupWindow; }),
+        numberKey("dedup-shard-capacity", [](auto& c) -> auto& { return c.router.dedupShardCapacity; }),
+        millisKey("replay-window-ms", [](auto& c) -> auto& { return c.router.replayWindow; }),
+        numberKey("watch-buffer-capacity", [](auto& c) -> auto& { return c.router.watchBufferCapacity; }),
+        aggregationsKey("aggregations", [](auto& c) -> auto& { return c.router.aggregations; }),
+        { "aggregation-group-delimiter",
+          [](ServerConfig& c, const std::string& v) { c.router.aggregationGroupDelimiter = v; return true; },
+          [](const ServerConfig& c) { return c.router.aggregationGroupDelimiter; } },
+        { "rules-file", [](ServerConfig& c, const std::string& v) { c.router.rulesFile = v; return true; },
+          [](const ServerConfig& c) { return c.router.rulesFile; } },
+        { "credentials-file",
+          [](ServerConfig& c, const std::string& v) { c.router.user.credentialsFile = v; return true; },
+          [](const ServerConfig& c) { return c.router.user.credentialsFile; } },
+        boolKey("insecure-auth", [](auto& c) -> auto& { return c.router.user.insecure; }),
+        { "device-manager",
+          [](ServerConfig& c, const std::string& v) {
+              if (v.empty()) {
+                  return false;
+              }
+              c.router.deviceManager = v;
+              return true;
+          },
+          [](const ServerConfig& c) -> std::string { return c.router.deviceManager; } },
+        numberKey("device-shards", [](auto& c) -> auto& { return c.router.device.shardCount; }),
+        millisKey("heartbeat-timeout-ms", [](auto& c) -> auto& { return c.router.device.heartbeatTimeout; }),
+        millisKey("heartbeat-sweep-ms", [](auto& c) -> auto& { return c.router.device.expiryTick; }),
+        heartbeatClassesKey("heartbeat-classes", [](auto& c) -> auto& { return c.router.device.heartbeatClasses; }),
+        { "wal-path", [](ServerConfig& c, const std::string& v) { c.router.device.walPath = v; return true; },
+          [](const ServerConfig& c) { return c.router.device.walPath; } },
+        { "wal-durability",
+          [](ServerConfig& c, const std::string& v) {
+              static const std::pair<const char*, IOT_NS::WalDurability> kLEVELS[] = {
+                  { "none", IOT_NS::WalDurability::None },
+                  { "batched", IOT_NS::WalDurability::Batched },
+                  { "sync", IOT_NS::WalDurability::Sync },
+              };
+              for (const auto& [name, level] : kLEVELS) {
+                  if (v == name) {
+                      c.router.device.walDurability = level;
+                      return true;
+                  }
+              }
+              return false;
+          },
+          [](const ServerConfig& c) -> std::string {
+              switch (c.router.device.walDurability) {
+              case IOT_NS::WalDurability::None:
+                  return "none";
+              case IOT_NS::WalDurability::Sync:
+                  return "sync";
+              default:
+                  return "batched";
+              }
+          } },
+        millisKey("wal-flush-ms", [](auto& c) -> auto& { return c.router.device.walFlushInterval; }),
+        { "snapshot-path", [](ServerConfig& c, const std::string& v) { c.router.device.snapshotPath = v; return true; },
+          [](const ServerConfig& c) { return c.router.device.snapshotPath; } },
+        millisKey("snapshot-interval-ms", [](auto& c) -> auto& { return c.router.device.snapshotInterval; }),
+        millisKey("history-retention-ms", [](auto& c) -> auto& { return c.router.device.historyRetention; }),
+        numberKey("history-chunk-samples", [](auto& c) -> auto& { return c.router.device.historyChunkSamples; }),
+    };
+    return keys;
+}
+
+} // namespace
+
+/**
+ * @brief 设置单个配置项
+ *
+ * @param key 配置键
+ * @param value 配置值
+ * @return true 设置成功；false 键未知或值非法
+ */
+auto ServerConfig::set(const std::string& key, const std::string& value) -> bool {
+    for (const auto& entry : configKeys()) {
+        if (key == entry.name) {
+            if (!entry.parse(*this, value)) {
+                std::cerr << kTAG << ": invalid value for " << key << ": " << value << std::endl;
+                return false;
+            }
+            return true;
+        }
+    }
+    std::cerr << kTAG << ": unknown key " << key << std::endl;
+    return false;
+}
+
+/**
+ * @brief 从配置文件加载配置项
+ *
+ * 每行一个 `键 = 值`，空行与 `#` 开头的注释行被忽略。
+ *
+ * @param path 配置文件路径
+ * @return true 加载成功；false 文件无法打开或存在非法行
+ */
+auto ServerConfig::loadFile(const std::string& path) -> bool {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << kTAG << ": cannot open config file " << path << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << kTAG << ": " << path << ":" << lineNo << ": expected key = value" << std::endl;
+            ok = false;
+            continue;
+        }
+        ok = set(trim(line.substr(0, eq)), trim(line.substr(eq + 1))) && ok;
+    }
+    return ok;
+}
+
+/**
+ * @brief 解析命令行参数
+ *
+ * 配置文件先于其余参数加载，因此命令行上的 --键=值 总是覆盖文件中的同名配置，与参数顺序无关。
+ *
+ * @param argc 命令行参数数量
+ * @param argv 命令行参数数组
+ * @return true 解析成功；false 存在无法加载的文件或非法参数
+ */
+auto ServerConfig::parseArgs(int argc, char** argv) -> bool {
+    bool ok = true;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind(kCONFIG_ARG, 0) == 0) {
+            ok = loadFile(arg.substr(std::char_traits<char>::length(kCONFIG_ARG))) && ok;
+        }
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind(kCONFIG_ARG, 0) == 0) {
+            continue;
+        }
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::cerr << kTAG << ": expected --key=value, got " << arg << std::endl;
+            ok = false;
+            continue;
+        }
+        ok = set(arg.substr(2, eq - 2), arg.substr(eq + 1)) && ok;
+    }
+    return ok;
+}
+
+/**
+ * @brief 将 gRPC 相关配置应用到服务构建器，值为 0 的配置项保持 gRPC 默认值
+ *
+ * @param builder gRPC 服务构建器
+ */
+void ServerConfig::applyTo(grpc::ServerBuilder& builder) const {
+    if (resourceQuotaBytes > 0 || maxThreads > 0) {
+        grpc::ResourceQuota quota("iot-server");
+        if (resourceQuotaBytes > 0) {
+            quota.Resize(static_cast<size_t>(resourceQuotaBytes));
+        }
+        if (maxThreads > 0) {
+            quota.SetMaxThreads(maxThreads);
+        }
+        builder.SetResourceQuota(quota);
+    }
+    if (maxConcurrentStreams > 0) {
+        builder.AddChannelArgument(GRPC_ARG_MAX_CONCURRENT_STREAMS, maxConcurrentStreams);
+    }
+    if (maxReceiveMessageBytes > 0) {
+        builder.SetMaxReceiveMessageSize(maxReceiveMessageBytes);
+    }
+    if (maxSendMessageBytes > 0) {
+        builder.SetMaxSendMessageSize(maxSendMessageBytes);
+    }
+    if (keepaliveTimeMs > 0) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS, keepaliveTimeMs);
+    }
+    if (keepaliveTimeoutMs > 0) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepaliveTimeoutMs);
+    }
+    if (keepalivePermitWithoutCalls) {
+        builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    }
+    // 轮询线程参数只对同步实现生效，回调实现的线程由 gRPC 内部回调线程池管理
+    if (!callbackApi) {
+        if (numCqs > 0) {
+            builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS, numCqs);
+        }
+        if (minPollers > 0) {
+            builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, minPollers);
+        }
+        if (maxPollers > 0) {
+            builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, maxPollers);
+        }
+    }
+}
+
+/**
+ * @brief 打印生效的完整配置
+ *
+ * 只对部分模式生效的键前附加一行 `#` 说明，例如轮询线程参数只在同步模式下生效。
+ *
+ * @param out 输出流
+ */
+void ServerConfig::print(std::ostream& out) const {
+    out << "# effective server configuration" << '\n';
+    for (const auto& entry : configKeys()) {
+        for (const auto& [name, note] : kKEY_NOTES) {
+            if (std::string_view(entry.name) == name) {
+                out << "# " << note << '\n';
+            }
+        }
+        out << entry.name << " = " << entry.format(*this) << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,834 @@
+#include "IoTCallbackServiceImpl.h"
+#include "RpcConvert.h"
+#include "StreamWriteState.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+/**
+ * @brief 心跳流 reactor：读一条心跳、写一条应答，循环直到客户端关闭或鉴权失败
+ *
+ * 语义与同步实现一致：首条心跳（或会话过期、设备切换后）建立会话并鉴权一次，之后只走会话快速路径；
+ * 鉴权失败写出应答后以 UNAUTHENTICATED 结束流；重放的心跳只回复拒绝，不结束流。
+ * 建立会话与设备上线都可能等待预写日志落盘，因此读完成后把处理投递到设备的处理线程，由该线程发起写操作，
+ * gRPC 回调线程不会被存储阻塞。
+ * 同一时刻最多只有一个读、写或处理在进行，因此 reactor 内部不需要加锁。
+ */
+class HeartbeatReactor final : public grpc::ServerBidiReactor<iot::HeartbeatRequest, iot::Ack> {
+public:
+    HeartbeatReactor(IOT_NS::MessageRouter& router, int32_t replayCode)
+        : mRouter(router), mReplayCode(replayCode) {
+        StartRead(&mRequest);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            Finish(grpc::Status::OK); // 客户端关闭了写端
+            return;
+        }
+        const auto& key = mRequest.device_id().empty() && mSession ? mSession->deviceId : mRequest.device_id();
+        mRouter.post(key, [this]() {
+            handle();
+            StartWrite(&mAck);
+        });
+    }
+
+    void OnWriteDone(bool ok) override {
+        if (!ok) {
+            Finish(grpc::Status::OK);
+            return;
+        }
+        if (mAuthFailed) {
+            Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return;
+        }
+        StartRead(&mRequest);
+    }
+
+    void OnDone() override {
+        // 流结束表示客户端断开，调用断开处理
+        if (mSession && mSession->authenticated) {
+            mRouter.handleDisconnect(mSession->deviceId);
+        } else {
+            std::cerr << "Heartbeat ended without an authenticated session" << std::endl;
+        }
+        delete this;
+    }
+
+private:
+    /**
+     * @brief 处理当前读取的心跳并填好应答，在设备的处理线程上执行
+     */
+    void handle() {
+        // 首条消息、会话过期或设备切换时重新建立会话并鉴权
+        bool switched = !mRequest.device_id().empty() && mSession && mRequest.device_id() != mSession->deviceId;
+        if (!mSession || mSession->expired() || switched) {
+            mSession = mRouter.openSession(mRequest.device_id(), mRequest.user_id(), mRequest.auth_token());
+        }
+
+        bool alive = mRouter.handleHeartbeat(*mSession, mRequest.timestamp());
+        bool replayed = !alive && mSession->authenticated && !mSession->expired();
+        mAuthFailed = !alive && !replayed;
+
+        mAck.set_code(alive ? 0 : (replayed ? mReplayCode : 1));
+        mAck.set_message(alive ? "Alive" : (replayed ? "Replay rejected" : "Auth failed"));
+    }
+
+    IOT_NS::MessageRouter& mRouter;                  // 消息路由器
+    const int32_t mReplayCode;                       // 重放被拒绝的应答码
+    iot::HeartbeatRequest mRequest;                  // 当前读取的心跳
+    iot::Ack mAck;                                   // 当前写出的应答
+    std::shared_ptr<IOT_NS::StreamSession> mSession; // 当前流绑定的会话
+    bool mAuthFailed = false;                        // 本次应答写出后是否结束流
+};
+
+/**
+ * @brief 命令订阅流 reactor：由设备下行队列的就绪监听器驱动写出命令批次
+ *
+ * reactor 由自身持有的 shared_ptr 管理生命周期，监听器只持有 weak_ptr，
+ * 因此 OnDone 之后迟到的就绪通知不会访问已销毁的对象。
+ * 同一时刻最多一个写操作在进行，写失败时未送达的命令放回队首，等待设备重新订阅。
+ */
+class SubscribeReactor final : public grpc::ServerWriteReactor<iot::CommandBatch> {
+public:
+    explicit SubscribeReactor(IOT_NS::MessageRouter& router)
+        : mRouter(router) {}
+
+    /**
+     * @brief 鉴权并挂接下行队列，返回交给 gRPC 的 reactor 指针
+     */
+    static auto start(IOT_NS::MessageRouter& router, const iot::CommandSubscription* request) -> SubscribeReactor* {
+        auto reactor = std::make_shared<SubscribeReactor>(router);
+        reactor->mSelf = reactor;
+
+        auto session = router.openSession(request->device_id(), request->user_id(), request->auth_token());
+        if (!session->authenticated) {
+            reactor->finishOnce(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor.get();
+        }
+
+        reactor->mDeviceId = session->deviceId;
+        reactor->mOutbox = router.subscribeOutbox(session->deviceId);
+        std::weak_ptr<SubscribeReactor> weak = reactor;
+        reactor->mListener = reactor->mOutbox->setReadyListener([weak]() {
+            if (auto self = weak.lock()) {
+                self->writeNext();
+            }
+        });
+        reactor->writeNext(); // 推送订阅前已排队的命令
+        return reactor.get();
+    }
+
+    void OnWriteDone(bool ok) override {
+        std::vector<IOT_NS::OutboundCommand> written;
+        bool finish = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            written.swap(mPending);
+            // 写失败时先标记结束，放回命令触发的就绪通知不会再次写出；流已被取消结束时不再重复结束
+            finish = mState.endWrite(ok);
+        }
+
+        // 放回队列会同步触发就绪监听器，必须在释放 mMutex 之后进行
+        if (!ok) {
+            mOutbox->requeue(written);
+            if (finish) {
+                Finish(grpc::Status::OK);
+            }
+            return;
+        }
+
+        // 写出成功后命令进入等待回执状态
+        for (const auto& command : written) {
+            mRouter.markCommandDelivered(command.commandId);
+        }
+        writeNext();
+    }
+
+    void OnCancel() override {
+        finishOnce(grpc::Status::CANCELLED);
+    }
+
+    void OnDone() override {
+        if (mOutbox) {
+            mOutbox->clearReadyListener(mListener); // 设备已重新订阅时保留新流的监听器
+            mRouter.unsubscribeOutbox(mDeviceId, mOutbox);
+        }
+        auto self = std::move(mSelf); // 最后一个强引用释放后 reactor 被销毁
+    }
+
+private:
+    /**
+     * @brief 没有写操作在进行时，取出一批命令并开始写出
+     */
+    void writeNext() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mOutbox || !mState.beginWrite()) {
+                return;
+            }
+            if (mOutbox->tryDrain(mPending, IOT_NS::CommandOutbox::kMAX_BATCH) == 0) {
+                mState.cancelWrite();
+                return;
+            }
+            mBatch.Clear();
+            rpc_convert::fillBatch(mDeviceId, mPending, &mBatch);
+        }
+        StartWrite(&mBatch); // 在锁外发起写操作，避免内联回调时重入加锁
+    }
+
+    /**
+     * @brief 只结束一次流
+     */
+    void finishOnce(const grpc::Status& status) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mState.finish()) {
+                return;
+            }
+        }
+        Finish(status);
+    }
+
+    IOT_NS::MessageRouter& mRouter;                // 消息路由器
+    std::shared_ptr<SubscribeReactor> mSelf;       // 自持引用，OnDone 时释放
+    std::shared_ptr<IOT_NS::DeviceOutbox> mOutbox; // 设备下行队列
+    uint64_t mListener = 0;                        // 本流装在下行队列上的监听器标识
+    std::string mDeviceId;                         // 订阅的设备ID
+    std::mutex mMutex;                             // 保护写状态与待确认命令
+    std::vector<IOT_NS::OutboundCommand> mPending; // 正在写出的命令
+    iot::CommandBatch mBatch;                      // 正在写出的批次
+    IOT_NS::StreamWriteState mState;               // 写操作与结束状态
+};
+
+/**
+ * @brief 批量状态上报流 reactor：每读取一个批次交给路由器处理，流结束或鉴权失败时写出聚合应答
+ *
+ * 批次的受理会等待预写日志落盘，因此读完成后把处理投递到路由器的处理线程，由该线程发起下一次读或结束流。
+ * 同一时刻最多只有一个读或处理在进行，因此 reactor 内部不需要加锁。
+ */
+class StatusBatchReactor final : public grpc::ServerReadReactor<iot::DeviceStatusBatch> {
+public:
+    StatusBatchReactor(IOT_NS::MessageRouter& router, iot::Ack* response)
+        : mRouter(router), mResponse(response) {
+        StartRead(&mBatch);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            rpc_convert::finishStatusAck(true, mResponse); // 客户端关闭了写端
+            Finish(grpc::Status::OK);
+            return;
+        }
+
+        // 之后的批次未携带凭据时沿用首个批次的凭据
+        if (!mBatch.user_id().empty()) {
+            mUserId = mBatch.user_id();
+            mToken = mBatch.auth_token();
+        }
+        mRouter.post(mUserId, [this]() { handle(); });
+    }
+
+    void OnDone() override { delete this; }
+
+private:
+    /**
+     * @brief 处理当前读取的批次并继续读取，鉴权失败时结束流；在路由器的处理线程上执行
+     */
+    void handle() {
+        rpc_convert::toStatusUpdates(mBatch, mUpdates);
+        auto count = static_cast<uint32_t>(mUpdates.size());
+        auto result = mRouter.handleStatusBatch(mUserId, mToken, mUpdates);
+        if (!result.authenticated) {
+            rpc_convert::finishStatusAck(false, mResponse);
+            Finish(grpc::Status::OK);
+            return;
+        }
+        rpc_convert::accumulateStatusAck(result, mBase, mResponse);
+        mBase += count;
+        StartRead(&mBatch);
+    }
+
+    IOT_NS::MessageRouter& mRouter;                   // 消息路由器
+    iot::Ack* mResponse;                              // 聚合应答
+    iot::DeviceStatusBatch mBatch;                    // 当前读取的批次
+    std::vector<IOT_NS::DeviceStatusUpdate> mUpdates; // 复用的路由器批次输入
+    std::string mUserId;                              // 流上使用的用户ID
+    std::string mToken;                               // 流上使用的认证令牌
+    uint32_t mBase = 0;                               // 当前批次首个条目在整条流中的下标
+};
+
+/**
+ * @brief 网关流 reactor：读一帧、交给路由器批量处理、写一条应答，循环直到网关关闭或鉴权失败
+ *
+ * 与心跳流相同，同一时刻最多只有一个读或写操作在进行，会话只在 reactor 内部访问，因此不需要加锁。
+ */
+class GatewayReactor final : public grpc::ServerBidiReactor<iot::GatewayFrame, iot::GatewayFrameAck> {
+public:
+    explicit GatewayReactor(IOT_NS::MessageRouter& router)
+        : mRouter(router) {
+        StartRead(&mFrame);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            Finish(grpc::Status::OK); // 网关关闭了写端
+            return;
+        }
+
+        // 首帧或会话过期时鉴权，已绑定的设备索引保持不变
+        if (!mOpened || mSession.expired()) {
+            mOpened = true;
+            mRouter.authenticateGateway(mSession, mFrame.user_id(), mFrame.auth_token());
+        }
+
+        auto batch = rpc_convert::toGatewayBatch(mFrame);
+        auto result = mRouter.handleGatewayBatch(mSession, batch);
+        mAuthFailed = !result.authenticated;
+        rpc_convert::fillGatewayAck(mFrame.sequence(), result, &mAck);
+        StartWrite(&mAck);
+    }
+
+    void OnWriteDone(bool ok) override {
+        if (!ok) {
+            Finish(grpc::Status::OK);
+            return;
+        }
+        if (mAuthFailed) {
+            Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return;
+        }
+        StartRead(&mFrame);
+    }
+
+    void OnDone() override {
+        // 流结束时对该网关绑定的所有设备执行断开处理
+        mRouter.closeGatewaySession(mSession);
+        delete this;
+    }
+
+private:
+    IOT_NS::MessageRouter& mRouter;  // 消息路由器
+    iot::GatewayFrame mFrame;        // 当前读取的网关帧
+    iot::GatewayFrameAck mAck;       // 当前写出的应答
+    IOT_NS::GatewaySession mSession; // 当前流绑定的网关会话
+    bool mOpened = false;            // 是否已对首帧鉴权
+    bool mAuthFailed = false;        // 本次应答写出后是否结束流
+};
+
+/**
+ * @brief 设备状态订阅流 reactor：由订阅者的就绪监听器驱动写出事件批次
+ *
+ * 生命周期管理与命令订阅流相同：reactor 自持 shared_ptr，监听器只持有 weak_ptr。
+ * 就绪监听器在上报线程上调用，只在订阅者已读到最新位置后触发一次；写操作进行中时直接返回，
+ * 写完成后再读取期间积压的事件，因此慢速的订阅流不会让上报线程等待。
+ */
+class WatchReactor final : public grpc::ServerWriteReactor<iot::DeviceWatchBatch> {
+public:
+    /**
+     * @brief 鉴权并订阅，返回交给 gRPC 的 reactor 指针
+     */
+    static auto start(IOT_NS::MessageRouter& router, const iot::DeviceWatchRequest* request) -> WatchReactor* {
+        auto reactor = std::make_shared<WatchReactor>();
+        reactor->mSelf = reactor;
+
+        reactor->mWatcher = router.watchDevices(request->user_id(), request->auth_token(),
+                                                rpc_convert::toWatchFilter(*request),
+                                                rpc_convert::toWatchPolicy(*request));
+        if (!reactor->mWatcher) {
+            reactor->finishOnce(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor.get();
+        }
+
+        std::weak_ptr<WatchReactor> weak = reactor;
+        reactor->mListener = reactor->mWatcher->setReadyListener([weak]() {
+            if (auto self = weak.lock()) {
+                self->writeNext();
+            }
+        });
+        reactor->writeNext(); // 推送初始快照
+        return reactor.get();
+    }
+
+    void OnWriteDone(bool ok) override {
+        bool finish = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            finish = mState.endWrite(ok);
+        }
+        if (finish) {
+            Finish(grpc::Status::OK);
+            return;
+        }
+        if (ok) {
+            writeNext();
+        }
+    }
+
+    void OnCancel() override {
+        finishOnce(grpc::Status::CANCELLED);
+    }
+
+    void OnDone() override {
+        if (mWatcher) {
+            mWatcher->clearReadyListener(mListener);
+            mWatcher->close();
+        }
+        auto self = std::move(mSelf); // 最后一个强引用释放后 reactor 被销毁
+    }
+
+private:
+    /**
+     * @brief 没有写操作在进行时，取出一批事件并开始写出；订阅者被断开时结束流
+     */
+    void writeNext() {
+        bool dropped = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mWatcher || !mState.beginWrite()) {
+                return;
+            }
+            mEvents.clear();
+            dropped = !mWatcher->poll(mEvents, IOT_NS::DeviceWatchHub::kMAX_BATCH);
+            if (!dropped && mEvents.empty()) {
+                mState.cancelWrite();
+                return;
+            }
+            if (dropped) {
+                mState.cancelWrite();
+            } else {
+                mBatch.Clear();
+                rpc_convert::fillWatchBatch(mEvents, &mBatch);
+            }
+        }
+        if (dropped) {
+            finishOnce(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Watcher too slow"));
+            return;
+        }
+        StartWrite(&mBatch); // 在锁外发起写操作，避免内联回调时重入加锁
+    }
+
+    /**
+     * @brief 只结束一次流
+     */
+    void finishOnce(const grpc::Status& status) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mState.finish()) {
+                return;
+            }
+        }
+        Finish(status);
+    }
+
+    std::shared_ptr<WatchReactor> mSelf;             // 自持引用，OnDone 时释放
+    std::shared_ptr<IOT_NS::DeviceWatcher> mWatcher; // 设备状态订阅者
+    uint64_t mListener = 0;                          // 本流装在订阅者上的监听器标识
+    std::mutex mMutex;                               // 保护写状态
+    std::vector<IOT_NS::DeviceWatchEvent> mEvents;   // 正在转换的事件
+    iot::DeviceWatchBatch mBatch;                    // 正在写出的批次
+    IOT_NS::StreamWriteState mState;                 // 写操作与结束状态
+};
+
+} // namespace
+
+/**
+ * @brief 构造函数，为所有一元 RPC 注册基于 arena 的消息分配器
+ *
+ * 流式 RPC 由各自的 reactor 持有消息并在整条流上复用，不需要分配器。
+ *
+ * @param options 消息路由器的运行时调优参数
+ */
+IoTCallbackServiceImpl::IoTCallbackServiceImpl(const IOT_NS::RouterOptions& options)
+    : mMessageRouter(MESSAGE_ROUTER_USER_MANAGER, options) {
+    SetMessageAllocatorFor_sendCommand(&mSendCommandAllocator);
+    SetMessageAllocatorFor_reportStatus(&mReportStatusAllocator);
+    SetMessageAllocatorFor_ackCommand(&mAckCommandAllocator);
+    SetMessageAllocatorFor_getCommandStatus(&mCommandStatusAllocator);
+    SetMessageAllocatorFor_reportStatuses(&mReportStatusesAllocator);
+    SetMessageAllocatorFor_getDevice(&mGetDeviceAllocator);
+    SetMessageAllocatorFor_batchGetDevices(&mBatchGetDevicesAllocator);
+    SetMessageAllocatorFor_listDevices(&mListDevicesAllocator);
+    SetMessageAllocatorFor_getDeviceHistory(&mDeviceHistoryAllocator);
+    SetMessageAllocatorFor_getAggregates(&mAggregatesAllocator);
+    SetMessageAllocatorFor_countDevices(&mDeviceCountsAllocator);
+}
+
+/**
+ * @brief 处理发送设备命令的异步 RPC 调用
+ *
+ * 提交命令后立即返回；请求携带 wait_ack_ms 时，由回执跟踪器在命令进入终态或等待超时时回调结束 RPC。
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备ID、命令、用户ID、认证Token的命令请求
+ * @param response 返回命令执行结果代码、信息、命令ID与命令状态
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::sendCommand(grpc::CallbackServerContext* context, const iot::DeviceCommand* request,
+                                         iot::CommandResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+
+    IOT_NS::CommandParams params(request->params().begin(), request->params().end());
+    auto receipt = mMessageRouter.submitCommand(request->device_id(), request->command(), request->user_id(),
+                                                request->auth_token(), params, request->idempotency_key(),
+                                                request->timestamp());
+
+    response->set_code(receipt.accepted ? 0 : 1);
+    response->set_message(receipt.message);
+    response->set_command_id(receipt.commandId);
+    if (!receipt.accepted || request->wait_ack_ms() == 0) {
+        if (receipt.accepted) {
+            response->set_state(iot::COMMAND_STATE_QUEUED);
+        }
+        reactor->Finish(grpc::Status::OK);
+        return reactor;
+    }
+
+    response->set_state(iot::COMMAND_STATE_QUEUED);
+    auto wait = std::min<std::chrono::milliseconds>(std::chrono::milliseconds(request->wait_ack_ms()), kMAX_ACK_WAIT);
+    mMessageRouter.watchCommand(receipt.commandId, wait,
+                                [reactor, response](const std::optional<IOT_NS::CommandStatus>& status) {
+                                    rpc_convert::applyCommandOutcome(status, response);
+                                    reactor->Finish(grpc::Status::OK);
+                                });
+    return reactor;
+}
+
+/**
+ * @brief 处理设备状态上报的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备ID、状态、用户ID、认证Token的状态请求
+ * @param response 返回确认应答，code为0表示成功，2表示重放被拒绝
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::reportStatus(grpc::CallbackServerContext* context, const iot::DeviceStatus* request,
+                                          iot::Ack* response) -> grpc::ServerUnaryReactor* {
+    bool accepted = mMessageRouter.handleStatusReport(request->device_id(), request->status(), request->user_id(),
+                                                      request->auth_token(), request->timestamp(),
+                                                      rpc_convert::toStatusDetails(request->details()));
+    response->set_code(accepted ? 0 : kREPLAY_REJECTED);
+    response->set_message(accepted ? "Status received" : "Replay rejected");
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 创建心跳流 reactor
+ *
+ * @param context gRPC 回调服务上下文
+ * @return grpc::ServerBidiReactor 心跳流 reactor，OnDone 时自行释放
+ */
+auto IoTCallbackServiceImpl::heartbeat(grpc::CallbackServerContext* context)
+    -> grpc::ServerBidiReactor<iot::HeartbeatRequest, iot::Ack>* {
+    return new HeartbeatReactor(mMessageRouter, kREPLAY_REJECTED);
+}
+
+/**
+ * @brief 创建命令订阅流 reactor
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 设备订阅请求
+ * @return grpc::ServerWriteReactor 订阅流 reactor，OnDone 时自行释放
+ */
+auto IoTCallbackServiceImpl::subscribeCommands(grpc::CallbackServerContext* context,
+                                               const iot::CommandSubscription* request)
+    -> grpc::ServerWriteReactor<iot::CommandBatch>* {
+    return SubscribeReactor::start(mMessageRouter, request);
+}
+
+/**
+ * @brief 处理设备命令回执的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备ID、命令ID、执行结果码与认证信息的回执
+ * @param response 返回确认应答，code为0表示回执被接受
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::ackCommand(grpc::CallbackServerContext* context, const iot::CommandAck* request,
+                                        iot::Ack* response) -> grpc::ServerUnaryReactor* {
+    bool accepted = mMessageRouter.acknowledgeCommand(request->device_id(), request->command_id(), request->code(),
+                                                      request->message(), request->user_id(), request->auth_token());
+    response->set_code(accepted ? 0 : 1);
+    response->set_message(accepted ? "Ack received" : "Ack rejected");
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理命令状态查询的异步 RPC 调用
+ *
+ * wait_ms 大于0时由回执跟踪器在命令进入终态或等待超时时回调结束 RPC，否则立即返回当前状态。
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含命令ID与等待时间的查询请求
+ * @param response 返回命令状态
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::getCommandStatus(grpc::CallbackServerContext* context,
+                                              const iot::CommandStatusRequest* request,
+                                              iot::CommandStatusResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    uint64_t commandId = request->command_id();
+    auto finish = [reactor, response, commandId](const std::optional<IOT_NS::CommandStatus>& status) {
+        if (!rpc_convert::fillCommandStatus(commandId, status, response)) {
+            reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown command"));
+            return;
+        }
+        reactor->Finish(grpc::Status::OK);
+    };
+
+    auto wait = std::min<std::chrono::milliseconds>(std::chrono::milliseconds(request->wait_ms()), kMAX_ACK_WAIT);
+    if (wait.count() > 0) {
+        mMessageRouter.watchCommand(commandId, wait, finish);
+    } else {
+        finish(mMessageRouter.commandStatus(commandId));
+    }
+    return reactor;
+}
+
+/**
+ * @brief 创建批量状态上报流 reactor
+ *
+ * @param context gRPC 回调服务上下文
+ * @param response 聚合应答
+ * @return grpc::ServerReadReactor 上报流 reactor，OnDone 时自行释放
+ */
+auto IoTCallbackServiceImpl::reportStatusBatch(grpc::CallbackServerContext* context, iot::Ack* response)
+    -> grpc::ServerReadReactor<iot::DeviceStatusBatch>* {
+    return new StatusBatchReactor(mMessageRouter, response);
+}
+
+/**
+ * @brief 批量状态上报（单次请求）：在回调线程上直接完成
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 状态批次
+ * @param response 聚合应答
+ * @return grpc::ServerUnaryReactor* 已结束的默认 reactor
+ */
+auto IoTCallbackServiceImpl::reportStatuses(grpc::CallbackServerContext* context,
+                                            const iot::DeviceStatusBatch* request,
+                                            iot::Ack* response) -> grpc::ServerUnaryReactor* {
+    std::vector<IOT_NS::DeviceStatusUpdate> updates;
+    rpc_convert::toStatusUpdates(*request, updates);
+    auto result = mMessageRouter.handleStatusBatch(request->user_id(), request->auth_token(), updates);
+    rpc_convert::accumulateStatusAck(result, 0, response);
+    rpc_convert::finishStatusAck(result.authenticated, response);
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 创建网关多路复用流 reactor
+ *
+ * @param context gRPC 回调服务上下文
+ * @return grpc::ServerBidiReactor 网关流 reactor，OnDone 时自行释放
+ */
+auto IoTCallbackServiceImpl::gatewaySession(grpc::CallbackServerContext* context)
+    -> grpc::ServerBidiReactor<iot::GatewayFrame, iot::GatewayFrameAck>* {
+    return new GatewayReactor(mMessageRouter);
+}
+
+/**
+ * @brief 创建设备状态订阅流 reactor
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 订阅请求
+ * @return grpc::ServerWriteReactor 订阅流 reactor，OnDone 后随最后一个引用释放
+ */
+auto IoTCallbackServiceImpl::watchDevices(grpc::CallbackServerContext* context,
+                                          const iot::DeviceWatchRequest* request)
+    -> grpc::ServerWriteReactor<iot::DeviceWatchBatch>* {
+    return WatchReactor::start(mMessageRouter, request);
+}
+
+/**
+ * @brief 处理单个设备查询的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备ID与认证信息的查询请求
+ * @param response 返回设备记录
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::getDevice(grpc::CallbackServerContext* context, const iot::DeviceGetRequest* request,
+                                       iot::DeviceRecord* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    if (!mMessageRouter.getDevices(request->user_id(), request->auth_token(), { request->device_id() }, found,
+                                   missing)) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+        return reactor;
+    }
+    if (found.empty()) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown device"));
+        return reactor;
+    }
+    rpc_convert::fillDeviceRecord(found.front(), std::chrono::steady_clock::now(), response);
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理设备批量查询的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备ID列表与认证信息的查询请求
+ * @param response 返回找到的设备与未注册的设备ID
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::batchGetDevices(grpc::CallbackServerContext* context,
+                                             const iot::DeviceBatchGetRequest* request,
+                                             iot::DeviceBatchGetResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    std::vector<std::string> deviceIds(request->device_ids().begin(), request->device_ids().end());
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    if (!mMessageRouter.getDevices(request->user_id(), request->auth_token(), deviceIds, found, missing)) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+        return reactor;
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (auto& record : found) {
+        rpc_convert::fillDeviceRecord(record, now, response->add_devices());
+    }
+    response->mutable_missing_ids()->Add(std::make_move_iterator(missing.begin()),
+                                         std::make_move_iterator(missing.end()));
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理设备分页列表的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含过滤条件、游标与认证信息的列表请求
+ * @param response 返回一页设备或匹配数量
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::listDevices(grpc::CallbackServerContext* context, const iot::DeviceListRequest* request,
+                                         iot::DeviceListResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    IOT_NS::DevicePage page;
+    switch (mMessageRouter.listDevices(request->user_id(), request->auth_token(), rpc_convert::toDeviceQuery(*request),
+                                       page)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+            reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid cursor"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Device not found"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillDeviceList(page, response);
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理设备属性历史查询的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含设备、属性、时间范围与认证信息的查询请求
+ * @param response 返回按时间排序的点
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::getDeviceHistory(grpc::CallbackServerContext* context,
+                                              const iot::DeviceHistoryRequest* request,
+                                              iot::DeviceHistoryResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    std::vector<IOT_NS::HistoryPoint> points;
+    switch (mMessageRouter.getDeviceHistory(request->user_id(), request->auth_token(),
+                                            rpc_convert::toHistoryQuery(*request), points)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Device not found"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillDeviceHistory(points, response);
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理状态聚合查询的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含聚合名称、分位点与认证信息的查询请求
+ * @param response 返回窗口内各设备分组的聚合结果
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::getAggregates(grpc::CallbackServerContext* context, const iot::AggregateRequest* request,
+                                           iot::AggregateResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    IOT_NS::AggregateWindow window;
+    switch (mMessageRouter.getAggregates(request->user_id(), request->auth_token(),
+                                         rpc_convert::toAggregateQuery(*request), window)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            reactor->Finish(grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown aggregation"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillAggregates(window, response);
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
+
+/**
+ * @brief 处理设备数量统计的异步 RPC 调用
+ *
+ * @param context gRPC 回调服务上下文
+ * @param request 包含认证信息的统计请求
+ * @param response 返回按状态统计的设备数量
+ * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+ */
+auto IoTCallbackServiceImpl::countDevices(grpc::CallbackServerContext* context, const iot::DeviceCountRequest* request,
+                                          iot::DeviceCountResponse* response) -> grpc::ServerUnaryReactor* {
+    auto* reactor = context->DefaultReactor();
+    IOT_NS::DeviceCounts counts;
+    switch (mMessageRouter.countDevices(request->user_id(), request->auth_token(), counts)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            reactor->Finish(grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            reactor->Finish(grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "Device counts unsupported"));
+            return reactor;
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillDeviceCounts(counts, response);
+
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "ArenaMessageAllocator.h"
+#include "MessageRouter.h"
+#include "iot_service.grpc.pb.h"
+#include <chrono>
+#include <grpcpp/grpcpp.h>
+
+/**
+ * @brief 基于 gRPC 回调（reactor）API 的 IoT 服务实现，继承自 iot::IoTService::CallbackService。
+ *
+ * 与同步实现 IoTServiceImpl 提供相同的接口语义，但长连接流不再各自占用一个服务线程：
+ * 心跳流与命令订阅流由 reactor 对象驱动，读写完成后在 gRPC 的回调线程池上继续处理；
+ * 等待命令回执时通过回执跟踪器的完成回调结束 RPC，不阻塞任何线程。
+ * 因此单节点可承载的并发流数量只受内存与文件描述符限制，而不是线程数。
+ * 心跳与批量上报的处理可能等待预写日志落盘，在路由器的处理线程上执行，不占用回调线程。
+ *
+ * Same RPC semantics as the sync IoTServiceImpl, but long-lived streams no longer pin a server thread each:
+ * heartbeat and command subscription streams are driven by reactor objects that resume on gRPC's callback
+ * thread pool, and waiting for a command ack completes the RPC from the ack tracker's completion callback
+ * without blocking any thread. Concurrent streams per node are bounded by memory and file descriptors rather
+ * than by thread count. Heartbeat and status batch handling may wait for the write-ahead log and runs on the
+ * router's handler threads rather than on a callback thread.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-28
+ */
+class IoTCallbackServiceImpl final : public iot::IoTService::CallbackService {
+public:
+    /**
+     * @brief 构造函数，为所有一元 RPC 注册基于 arena 的消息分配器
+     *
+     * @param options 消息路由器的运行时调优参数（处理线程数、队列容量、分片数等）
+     */
+    explicit IoTCallbackServiceImpl(const IOT_NS::RouterOptions& options = {});
+
+    /**
+     * @brief 发送设备命令接口（异步）
+     *
+     * 请求携带 wait_ack_ms 时，命令进入终态或等待超时后由完成回调结束 RPC。
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 客户端传入的设备命令请求
+     * @param response 服务器填充的命令执行响应
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto sendCommand(grpc::CallbackServerContext* context, const iot::DeviceCommand* request,
+                     iot::CommandResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 设备状态上报接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 客户端传入的设备状态信息
+     * @param response 服务器发送的确认应答
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto reportStatus(grpc::CallbackServerContext* context, const iot::DeviceStatus* request,
+                      iot::Ack* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 双向流心跳通信接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @return grpc::ServerBidiReactor 驱动该心跳流的 reactor
+     */
+    auto heartbeat(grpc::CallbackServerContext* context)
+        -> grpc::ServerBidiReactor<iot::HeartbeatRequest, iot::Ack>* override;
+
+    /**
+     * @brief 设备下行命令订阅接口（异步）
+     *
+     * 命令入队时由设备下行队列的就绪监听器唤醒 reactor 写出批次，不再周期性检查取消。
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 设备订阅请求
+     * @return grpc::ServerWriteReactor 驱动该订阅流的 reactor
+     */
+    auto subscribeCommands(grpc::CallbackServerContext* context, const iot::CommandSubscription* request)
+        -> grpc::ServerWriteReactor<iot::CommandBatch>* override;
+
+    /**
+     * @brief 设备命令回执接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 设备回执
+     * @param response 服务器发送的确认应答
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto ackCommand(grpc::CallbackServerContext* context, const iot::CommandAck* request,
+                    iot::Ack* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 命令状态查询接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 查询请求
+     * @param response 命令状态应答
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto getCommandStatus(grpc::CallbackServerContext* context, const iot::CommandStatusRequest* request,
+                          iot::CommandStatusResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 批量状态上报接口（异步客户端流）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param response 聚合应答
+     * @return grpc::ServerReadReactor 驱动该上报流的 reactor
+     */
+    auto reportStatusBatch(grpc::CallbackServerContext* context, iot::Ack* response)
+        -> grpc::ServerReadReactor<iot::DeviceStatusBatch>* override;
+
+    /**
+     * @brief 批量状态上报接口（异步单次请求）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 状态批次
+     * @param response 聚合应答
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto reportStatuses(grpc::CallbackServerContext* context, const iot::DeviceStatusBatch* request,
+                        iot::Ack* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 网关多路复用流接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @return grpc::ServerBidiReactor 驱动该网关流的 reactor
+     */
+    auto gatewaySession(grpc::CallbackServerContext* context)
+        -> grpc::ServerBidiReactor<iot::GatewayFrame, iot::GatewayFrameAck>* override;
+
+    /**
+     * @brief 设备状态订阅接口（异步）
+     *
+     * 事件写入订阅缓冲时由订阅者的就绪监听器唤醒 reactor 写出批次，不再周期性检查取消。
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 订阅请求
+     * @return grpc::ServerWriteReactor 驱动该订阅流的 reactor
+     */
+    auto watchDevices(grpc::CallbackServerContext* context, const iot::DeviceWatchRequest* request)
+        -> grpc::ServerWriteReactor<iot::DeviceWatchBatch>* override;
+
+    /**
+     * @brief 单个设备查询接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 查询请求
+     * @param response 设备记录
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto getDevice(grpc::CallbackServerContext* context, const iot::DeviceGetRequest* request,
+                   iot::DeviceRecord* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 设备批量查询接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 查询请求
+     * @param response 找到的设备与未注册的设备ID
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto batchGetDevices(grpc::CallbackServerContext* context, const iot::DeviceBatchGetRequest* request,
+                         iot::DeviceBatchGetResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 设备分页列表接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 列表请求
+     * @param response 一页设备或匹配数量
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto listDevices(grpc::CallbackServerContext* context, const iot::DeviceListRequest* request,
+                     iot::DeviceListResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 设备属性历史查询接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 查询请求
+     * @param response 按时间排序的点
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto getDeviceHistory(grpc::CallbackServerContext* context, const iot::DeviceHistoryRequest* request,
+                          iot::DeviceHistoryResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 状态聚合查询接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 查询请求
+     * @param response 窗口内各设备分组的聚合结果
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto getAggregates(grpc::CallbackServerContext* context, const iot::AggregateRequest* request,
+                       iot::AggregateResponse* response) -> grpc::ServerUnaryReactor* override;
+
+    /**
+     * @brief 设备数量统计接口（异步）
+     *
+     * @param context gRPC 回调服务上下文
+     * @param request 统计请求
+     * @param response 按状态统计的设备数量
+     * @return grpc::ServerUnaryReactor* 驱动该 RPC 的 reactor
+     */
+    auto countDevices(grpc::CallbackServerContext* context, const iot::DeviceCountRequest* request,
+                      iot::DeviceCountResponse* response) -> grpc::ServerUnaryReactor* override;
+
+private:
+    static constexpr const char* kTAG = "IoTCallbackServiceImpl";       // 日志标识符，用于日志输出
+    static constexpr std::chrono::milliseconds kMAX_ACK_WAIT { 30000 }; // 等待命令终态的最长时间
+    static constexpr int32_t kREPLAY_REJECTED = 2;                      // 重放被拒绝的应答码
+    IOT_NS::MessageRouter mMessageRouter;                               // 内部消息路由器，负责业务消息分发
+
+    // 一元 RPC 的消息分配器，请求与应答建在按调用复用的 arena 上；须比服务器存活更久，因此作为服务成员
+    ArenaMessageAllocator<iot::DeviceCommand, iot::CommandResponse> mSendCommandAllocator;
+    ArenaMessageAllocator<iot::DeviceStatus, iot::Ack> mReportStatusAllocator;
+    ArenaMessageAllocator<iot::CommandAck, iot::Ack> mAckCommandAllocator;
+    ArenaMessageAllocator<iot::CommandStatusRequest, iot::CommandStatusResponse> mCommandStatusAllocator;
+    ArenaMessageAllocator<iot::DeviceStatusBatch, iot::Ack> mReportStatusesAllocator;
+    ArenaMessageAllocator<iot::DeviceGetRequest, iot::DeviceRecord> mGetDeviceAllocator;
+    ArenaMessageAllocator<iot::DeviceBatchGetRequest, iot::DeviceBatchGetResponse> mBatchGetDevicesAllocator;
+    ArenaMessageAllocator<iot::DeviceListRequest, iot::DeviceListResponse> mListDevicesAllocator;
+    ArenaMessageAllocator<iot::DeviceHistoryRequest, iot::DeviceHistoryResponse> mDeviceHistoryAllocator;
+    ArenaMessageAllocator<iot::AggregateRequest, iot::AggregateResponse> mAggregatesAllocator;
+    ArenaMessageAllocator<iot::DeviceCountRequest, iot::DeviceCountResponse> mDeviceCountsAllocator;
+};
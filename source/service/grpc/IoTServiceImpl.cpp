@@ -1,4 +1,8 @@
 #include "IoTServiceImpl.h"
+#include "RpcConvert.h"
+
+#include <algorithm>
+#include <iterator>
 
 extern "C" {
 void show_device_info(const char* device_id, const char* message);
@@ -7,12 +11,13 @@ void show_device_info(const char* device_id, const char* message);
 /**
  * @brief 处理发送设备命令的 RPC 调用
  *
- * 调用内部消息路由器处理设备命令请求，返回执行结果。
+ * 调用内部消息路由器提交设备命令，返回分配的命令ID；携带 idempotency_key 的重试请求返回首次提交的结果。
+ * 请求携带 wait_ack_ms 时，等待命令进入终态（不超过 kMAX_ACK_WAIT）后再返回，设备执行失败或超时以非0 code 返回。
  * 并调用外部C函数打印设备信息用于调试。
  *
  * @param context gRPC 服务上下文
  * @param request 包含设备ID、命令、用户ID、认证Token的命令请求
- * @param response 返回命令执行结果代码及信息
+ * @param response 返回命令执行结果代码、信息、命令ID与命令状态
  * @return grpc::Status 返回RPC调用的状态，始终为 OK
  */
 auto IoTServiceImpl::sendCommand(grpc::ServerContext* context, const iot::DeviceCommand* request,
@@ -20,13 +25,27 @@ auto IoTServiceImpl::sendCommand(grpc::ServerContext* context, const iot::Device
     // 调用外部C函数打印调试信息
     show_device_info("solo", "tests");
 
-    // 通过消息路由器处理命令，获取处理结果字符串
-    auto result = mMessageRouter.handleCommand(request->device_id(), request->command(), request->user_id(),
-                                               request->auth_token());
+    // 通过消息路由器提交命令，获取提交结果
+    IOT_NS::CommandParams params(request->params().begin(), request->params().end());
+    auto receipt = mMessageRouter.submitCommand(request->device_id(), request->command(), request->user_id(),
+                                                request->auth_token(), params, request->idempotency_key(),
+                                                request->timestamp());
+
+    // 入队成功视为成功，code=0，否则code=1
+    response->set_code(receipt.accepted ? 0 : 1);
+    response->set_message(receipt.message);
+    response->set_command_id(receipt.commandId);
+    if (!receipt.accepted) {
+        return grpc::Status::OK;
+    }
+    response->set_state(iot::COMMAND_STATE_QUEUED);
 
-    // 根据处理结果设置响应code，"Command accepted"视为成功，code=0，否则code=1
-    response->set_code(result == "Command accepted" ? 0 : 1);
-    response->set_message(result);
+    // 调用方要求等待回执时，阻塞到命令进入终态或等待超时
+    if (request->wait_ack_ms() > 0) {
+        auto wait = std::min<std::chrono::milliseconds>(std::chrono::milliseconds(request->wait_ack_ms()),
+                                                        kMAX_ACK_WAIT);
+        rpc_convert::applyCommandOutcome(mMessageRouter.awaitCommand(receipt.commandId, wait), response);
+    }
 
     return grpc::Status::OK;
 }
@@ -34,11 +53,11 @@ auto IoTServiceImpl::sendCommand(grpc::ServerContext* context, const iot::Device
 /**
  * @brief 处理设备状态上报的 RPC 调用
  *
- * 通过消息路由器处理状态上报请求，并返回确认应答。
+ * 通过消息路由器处理状态上报请求，并返回确认应答；时间戳被判定为重放的上报不会被处理。
  *
  * @param context gRPC 服务上下文
  * @param request 包含设备ID、状态、用户ID、认证Token的状态请求
- * @param response 返回确认应答，code固定为0表示成功
+ * @param response 返回确认应答，code为0表示成功，2表示重放被拒绝
  * @return grpc::Status 返回RPC调用状态，始终为 OK
  */
 auto IoTServiceImpl::reportStatus(grpc::ServerContext* context, const iot::DeviceStatus* request,
@@ -46,13 +65,14 @@ auto IoTServiceImpl::reportStatus(grpc::ServerContext* context, const iot::Devic
     std::cout << "IoTServiceImpl::reportStatus called for device: " << request->device_id()
               << ", status: " << request->status() << std::endl;
     // 交由消息路由器处理状态上报
-    mMessageRouter.handleStatusReport(request->device_id(), request->status(), request->user_id(),
-                                      request->auth_token());
+    bool accepted = mMessageRouter.handleStatusReport(request->device_id(), request->status(), request->user_id(),
+                                                      request->auth_token(), request->timestamp(),
+                                                      rpc_convert::toStatusDetails(request->details()));
     std::cout << "IoTServiceImpl::reportStatus processed for device: " << request->device_id() << std::endl;
 
-    // 设置响应码和消息，表示状态已成功接收
-    response->set_code(0);
-    response->set_message("Status received");
+    // 设置响应码和消息，表示状态已成功接收或被判定为重放
+    response->set_code(accepted ? 0 : kREPLAY_REJECTED);
+    response->set_message(accepted ? "Status received" : "Replay rejected");
 
     return grpc::Status::OK;
 }
@@ -60,8 +80,10 @@ auto IoTServiceImpl::reportStatus(grpc::ServerContext* context, const iot::Devic
 /**
  * @brief 基于双向流的心跳通信实现
  *
- * 持续读取客户端发送的心跳请求，调用消息路由器处理心跳验证，
- * 并发送相应的确认消息。若客户端断开连接，调用断开处理。
+ * 流上的首条心跳（或会话过期后的第一条心跳）用于建立会话并完成一次鉴权，
+ * 之后的心跳只走会话快速路径，不再逐条校验 user_id / auth_token。
+ * 鉴权失败时返回确认消息并以 UNAUTHENTICATED 结束流；时间戳重放的心跳只回复拒绝，不结束流；
+ * 若客户端断开连接，调用断开处理。
  *
  * @param context gRPC 服务上下文
  * @param stream 双向流读写对象，用于接收心跳请求并发送确认
@@ -70,33 +92,433 @@ auto IoTServiceImpl::reportStatus(grpc::ServerContext* context, const iot::Devic
 auto IoTServiceImpl::heartbeat(grpc::ServerContext* context,
                                grpc::ServerReaderWriter<iot::Ack, iot::HeartbeatRequest>* stream) -> grpc::Status {
     iot::HeartbeatRequest request;
-    std::string last_device_id; // 记录最后一个有效的设备ID，用于断开处理
+    std::shared_ptr<IOT_NS::StreamSession> session; // 当前流绑定的会话
+    grpc::Status status = grpc::Status::OK;
 
     // 持续读取流中的心跳请求
     while (stream->Read(&request)) {
-        last_device_id = request.device_id();
+        // 首条消息、会话过期或设备切换时重新建立会话并鉴权
+        bool switched = !request.device_id().empty() && session && request.device_id() != session->deviceId;
+        if (!session || session->expired() || switched) {
+            session = mMessageRouter.openSession(request.device_id(), request.user_id(), request.auth_token());
+        }
 
-        // 调用消息路由器处理心跳请求，返回是否验证成功
-        bool ok = mMessageRouter.handleHeartbeat(request.device_id(), request.user_id(), request.auth_token());
+        // 会话快速路径处理心跳，返回是否有效；会话仍有效时的拒绝来自防重放校验
+        bool ok = mMessageRouter.handleHeartbeat(*session, request.timestamp());
+        bool replayed = !ok && session->authenticated && !session->expired();
 
-        // 构造应答，code为0表示成功，1表示认证失败
+        // 构造应答，code为0表示成功，1表示认证失败，2表示重放被拒绝
         iot::Ack ack;
-        ack.set_code(ok ? 0 : 1);
-        ack.set_message(ok ? "Alive" : "Auth failed");
+        ack.set_code(ok ? 0 : (replayed ? kREPLAY_REJECTED : 1));
+        ack.set_message(ok ? "Alive" : (replayed ? "Replay rejected" : "Auth failed"));
 
         // 向客户端写入应答，如果写失败则退出循环
         if (!stream->Write(ack)) {
             break;
         }
+
+        // 鉴权失败直接结束流，客户端需重新建立连接
+        if (!ok && !replayed) {
+            status = grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+            break;
+        }
     }
 
     // 流结束表示客户端断开，调用断开处理
-    if (!last_device_id.empty()) {
-        mMessageRouter.handleDisconnect(last_device_id);
+    if (session && session->authenticated) {
+        mMessageRouter.handleDisconnect(session->deviceId);
     } else {
-        // 设备ID为空时记录警告日志
-        std::cerr << "Heartbeat ended but device_id is empty" << std::endl;
+        // 未建立有效会话时记录警告日志
+        std::cerr << "Heartbeat ended without an authenticated session" << std::endl;
+    }
+
+    return status;
+}
+
+/**
+ * @brief 设备下行命令订阅流实现
+ *
+ * 建立会话完成一次鉴权后，挂接设备的下行命令队列；命令入队时立即被唤醒，
+ * 一次取出所有待发命令（不超过批次上限）合并为一个 CommandBatch 写出。
+ * 等待超时仅用于检查客户端是否已取消流；写失败时未送达的命令放回队首。流结束时退订，已空的队列随之被回收。
+ *
+ * @param context gRPC 服务上下文
+ * @param request 设备订阅请求
+ * @param writer 服务端流写对象
+ * @return grpc::Status 返回RPC调用状态
+ */
+auto IoTServiceImpl::subscribeCommands(grpc::ServerContext* context, const iot::CommandSubscription* request,
+                                       grpc::ServerWriter<iot::CommandBatch>* writer) -> grpc::Status {
+    auto session = mMessageRouter.openSession(request->device_id(), request->user_id(), request->auth_token());
+    if (!session->authenticated) {
+        return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+    }
+
+    auto outbox = mMessageRouter.subscribeOutbox(session->deviceId);
+    std::vector<IOT_NS::OutboundCommand> pending;
+
+    while (!context->IsCancelled()) {
+        if (outbox->waitAndDrain(pending, IOT_NS::CommandOutbox::kMAX_BATCH, kCANCEL_CHECK_INTERVAL) == 0) {
+            continue;
+        }
+
+        iot::CommandBatch batch;
+        rpc_convert::fillBatch(session->deviceId, pending, &batch);
+
+        // 写失败表示流已断开，命令放回队列等待设备重新订阅
+        if (!writer->Write(batch)) {
+            outbox->requeue(pending);
+            break;
+        }
+
+        // 写出成功后命令进入等待回执状态
+        for (const auto& command : pending) {
+            mMessageRouter.markCommandDelivered(command.commandId);
+        }
+        pending.clear();
+    }
+
+    mMessageRouter.unsubscribeOutbox(session->deviceId, outbox);
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理设备命令回执的 RPC 调用
+ *
+ * 通过消息路由器校验回执并更新命令状态，命令进入终态后等待中的 sendCommand / getCommandStatus 被唤醒。
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含设备ID、命令ID、执行结果码与认证信息的回执
+ * @param response 返回确认应答，code为0表示回执被接受
+ * @return grpc::Status 返回RPC调用状态，始终为 OK
+ */
+auto IoTServiceImpl::ackCommand(grpc::ServerContext* context, const iot::CommandAck* request,
+                                iot::Ack* response) -> grpc::Status {
+    bool accepted = mMessageRouter.acknowledgeCommand(request->device_id(), request->command_id(), request->code(),
+                                                      request->message(), request->user_id(), request->auth_token());
+
+    // 回执被拒绝可能是鉴权失败、命令未知或命令已是终态（例如重复回执）
+    response->set_code(accepted ? 0 : 1);
+    response->set_message(accepted ? "Ack received" : "Ack rejected");
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理命令状态查询的 RPC 调用
+ *
+ * wait_ms 大于0时等待命令进入终态（不超过 kMAX_ACK_WAIT），否则立即返回当前状态。
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含命令ID与等待时间的查询请求
+ * @param response 返回命令状态
+ * @return grpc::Status 返回RPC调用状态，命令不存在或记录已清理时为 NOT_FOUND
+ */
+auto IoTServiceImpl::getCommandStatus(grpc::ServerContext* context, const iot::CommandStatusRequest* request,
+                                      iot::CommandStatusResponse* response) -> grpc::Status {
+    auto wait = std::min<std::chrono::milliseconds>(std::chrono::milliseconds(request->wait_ms()), kMAX_ACK_WAIT);
+    auto status = wait.count() > 0 ? mMessageRouter.awaitCommand(request->command_id(), wait)
+                                   : mMessageRouter.commandStatus(request->command_id());
+    if (!rpc_convert::fillCommandStatus(request->command_id(), status, response)) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown command");
+    }
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理客户端流式批量状态上报的 RPC 调用
+ *
+ * 每个批次读取后立即处理，内存占用与单个批次大小相当；之后的批次未携带凭据时沿用首个批次的凭据。
+ * 鉴权失败时停止读取并返回 code 为 1 的应答。
+ *
+ * @param context gRPC 服务上下文
+ * @param reader 客户端流读取对象
+ * @param response 聚合应答
+ * @return grpc::Status 返回RPC调用状态，始终为 OK
+ */
+auto IoTServiceImpl::reportStatusBatch(grpc::ServerContext* context, grpc::ServerReader<iot::DeviceStatusBatch>* reader,
+                                       iot::Ack* response) -> grpc::Status {
+    iot::DeviceStatusBatch batch;
+    std::vector<IOT_NS::DeviceStatusUpdate> updates;
+    std::string userId;
+    std::string token;
+    uint32_t base = 0; // 当前批次首个条目在整条流中的下标
+    bool authenticated = true;
+
+    while (authenticated && reader->Read(&batch)) {
+        if (!batch.user_id().empty()) {
+            userId = batch.user_id();
+            token = batch.auth_token();
+        }
+        rpc_convert::toStatusUpdates(batch, updates);
+        auto count = static_cast<uint32_t>(updates.size());
+        auto result = mMessageRouter.handleStatusBatch(userId, token, updates);
+        authenticated = result.authenticated;
+        rpc_convert::accumulateStatusAck(result, base, response);
+        base += count;
+    }
+
+    rpc_convert::finishStatusAck(authenticated, response);
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理单次请求的批量状态上报 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 状态批次
+ * @param response 聚合应答
+ * @return grpc::Status 返回RPC调用状态，始终为 OK
+ */
+auto IoTServiceImpl::reportStatuses(grpc::ServerContext* context, const iot::DeviceStatusBatch* request,
+                                    iot::Ack* response) -> grpc::Status {
+    std::vector<IOT_NS::DeviceStatusUpdate> updates;
+    rpc_convert::toStatusUpdates(*request, updates);
+    auto result = mMessageRouter.handleStatusBatch(request->user_id(), request->auth_token(), updates);
+    rpc_convert::accumulateStatusAck(result, 0, response);
+    rpc_convert::finishStatusAck(result.authenticated, response);
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理网关多路复用流的 RPC 调用
+ *
+ * 首帧或会话过期后用帧中的用户凭据鉴权，此后每帧直接交给路由器的批量入口处理；
+ * 流结束时对该网关绑定的所有设备执行断开处理。
+ *
+ * @param context gRPC 服务上下文
+ * @param stream 双向流对象
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED
+ */
+auto IoTServiceImpl::gatewaySession(grpc::ServerContext* context,
+                                    grpc::ServerReaderWriter<iot::GatewayFrameAck, iot::GatewayFrame>* stream)
+    -> grpc::Status {
+    iot::GatewayFrame frame;
+    iot::GatewayFrameAck ack;
+    IOT_NS::GatewaySession session; // 当前流绑定的网关会话
+    bool opened = false;
+    grpc::Status status = grpc::Status::OK;
+
+    while (stream->Read(&frame)) {
+        // 首帧或会话过期时鉴权，已绑定的设备索引保持不变
+        if (!opened || session.expired()) {
+            opened = true;
+            mMessageRouter.authenticateGateway(session, frame.user_id(), frame.auth_token());
+        }
+
+        auto batch = rpc_convert::toGatewayBatch(frame);
+        auto result = mMessageRouter.handleGatewayBatch(session, batch);
+        rpc_convert::fillGatewayAck(frame.sequence(), result, &ack);
+
+        if (!stream->Write(ack)) {
+            break;
+        }
+
+        // 鉴权失败直接结束流，网关需重新建立连接
+        if (!result.authenticated) {
+            status = grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+            break;
+        }
+    }
+
+    mMessageRouter.closeGatewaySession(session);
+    return status;
+}
+
+/**
+ * @brief 处理设备状态订阅的 RPC 调用
+ *
+ * 鉴权后持续等待并推送事件批次，直到客户端取消或写失败；订阅者按 Drop 策略被断开时以 RESOURCE_EXHAUSTED 结束。
+ *
+ * @param context gRPC 服务上下文
+ * @param request 订阅请求
+ * @param writer 服务端流写对象
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED
+ */
+auto IoTServiceImpl::watchDevices(grpc::ServerContext* context, const iot::DeviceWatchRequest* request,
+                                  grpc::ServerWriter<iot::DeviceWatchBatch>* writer) -> grpc::Status {
+    auto watcher = mMessageRouter.watchDevices(request->user_id(), request->auth_token(),
+                                               rpc_convert::toWatchFilter(*request),
+                                               rpc_convert::toWatchPolicy(*request));
+    if (!watcher) {
+        return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+    }
+
+    std::vector<IOT_NS::DeviceWatchEvent> events;
+    grpc::Status status = grpc::Status::OK;
+    while (!context->IsCancelled()) {
+        if (!watcher->waitAndPoll(events, IOT_NS::DeviceWatchHub::kMAX_BATCH, kCANCEL_CHECK_INTERVAL)) {
+            status = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Watcher too slow");
+            break;
+        }
+        if (events.empty()) {
+            continue;
+        }
+
+        iot::DeviceWatchBatch batch;
+        rpc_convert::fillWatchBatch(events, &batch);
+        events.clear();
+        if (!writer->Write(batch)) {
+            break;
+        }
+    }
+
+    watcher->close();
+    return status;
+}
+
+/**
+ * @brief 处理单个设备查询的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含设备ID与认证信息的查询请求
+ * @param response 返回设备记录
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED，设备未注册时为 NOT_FOUND
+ */
+auto IoTServiceImpl::getDevice(grpc::ServerContext* context, const iot::DeviceGetRequest* request,
+                               iot::DeviceRecord* response) -> grpc::Status {
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    if (!mMessageRouter.getDevices(request->user_id(), request->auth_token(), { request->device_id() }, found,
+                                   missing)) {
+        return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+    }
+    if (found.empty()) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown device");
+    }
+    rpc_convert::fillDeviceRecord(found.front(), std::chrono::steady_clock::now(), response);
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理设备批量查询的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含设备ID列表与认证信息的查询请求
+ * @param response 返回找到的设备与未注册的设备ID
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED
+ */
+auto IoTServiceImpl::batchGetDevices(grpc::ServerContext* context, const iot::DeviceBatchGetRequest* request,
+                                     iot::DeviceBatchGetResponse* response) -> grpc::Status {
+    std::vector<std::string> deviceIds(request->device_ids().begin(), request->device_ids().end());
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    if (!mMessageRouter.getDevices(request->user_id(), request->auth_token(), deviceIds, found, missing)) {
+        return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (auto& record : found) {
+        rpc_convert::fillDeviceRecord(record, now, response->add_devices());
+    }
+    response->mutable_missing_ids()->Add(std::make_move_iterator(missing.begin()),
+                                         std::make_move_iterator(missing.end()));
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理设备分页列表的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含过滤条件、游标与认证信息的列表请求
+ * @param response 返回一页设备或匹配数量
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED，游标无效时为 INVALID_ARGUMENT
+ */
+auto IoTServiceImpl::listDevices(grpc::ServerContext* context, const iot::DeviceListRequest* request,
+                                 iot::DeviceListResponse* response) -> grpc::Status {
+    IOT_NS::DevicePage page;
+    switch (mMessageRouter.listDevices(request->user_id(), request->auth_token(), rpc_convert::toDeviceQuery(*request),
+                                       page)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+            return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid cursor");
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "Device not found");
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillDeviceList(page, response);
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理设备属性历史查询的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含设备、属性、时间范围与认证信息的查询请求
+ * @param response 返回按时间排序的点
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED，设备未注册时为 NOT_FOUND
+ */
+auto IoTServiceImpl::getDeviceHistory(grpc::ServerContext* context, const iot::DeviceHistoryRequest* request,
+                                      iot::DeviceHistoryResponse* response) -> grpc::Status {
+    std::vector<IOT_NS::HistoryPoint> points;
+    switch (mMessageRouter.getDeviceHistory(request->user_id(), request->auth_token(),
+                                            rpc_convert::toHistoryQuery(*request), points)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "Device not found");
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillDeviceHistory(points, response);
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理状态聚合查询的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含聚合名称、分位点与认证信息的查询请求
+ * @param response 返回窗口内各设备分组的聚合结果
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED，聚合名称未配置时为 NOT_FOUND
+ */
+auto IoTServiceImpl::getAggregates(grpc::ServerContext* context, const iot::AggregateRequest* request,
+                                   iot::AggregateResponse* response) -> grpc::Status {
+    IOT_NS::AggregateWindow window;
+    switch (mMessageRouter.getAggregates(request->user_id(), request->auth_token(),
+                                         rpc_convert::toAggregateQuery(*request), window)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "Unknown aggregation");
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
+    }
+    rpc_convert::fillAggregates(window, response);
+
+    return grpc::Status::OK;
+}
+
+/**
+ * @brief 处理设备数量统计的 RPC 调用
+ *
+ * @param context gRPC 服务上下文
+ * @param request 包含认证信息的统计请求
+ * @param response 返回按状态统计的设备数量
+ * @return grpc::Status 返回RPC调用状态，鉴权失败时为 UNAUTHENTICATED，设备管理器不支持计数时为 UNIMPLEMENTED
+ */
+auto IoTServiceImpl::countDevices(grpc::ServerContext* context, const iot::DeviceCountRequest* request,
+                                  iot::DeviceCountResponse* response) -> grpc::Status {
+    IOT_NS::DeviceCounts counts;
+    switch (mMessageRouter.countDevices(request->user_id(), request->auth_token(), counts)) {
+        case IOT_NS::DeviceQueryStatus::Unauthenticated:
+            return grpc::Status(grpc::StatusCode::UNAUTHENTICATED, "Auth failed");
+        case IOT_NS::DeviceQueryStatus::NotFound:
+            return grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "Device counts unsupported");
+        case IOT_NS::DeviceQueryStatus::InvalidCursor:
+        case IOT_NS::DeviceQueryStatus::Ok:
+            break;
     }
+    rpc_convert::fillDeviceCounts(counts, response);
 
     return grpc::Status::OK;
 }
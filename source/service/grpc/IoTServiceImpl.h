@@ -2,6 +2,7 @@
 
 #include "MessageRouter.h"
 #include "iot_service.grpc.pb.h"
+#include <chrono>
 #include <grpcpp/grpcpp.h>
 
 /**
@@ -16,6 +17,14 @@
  */
 class IoTServiceImpl final : public iot::IoTService::Service {
 public:
+    /**
+     * @brief 构造函数
+     *
+     * @param options 消息路由器的运行时调优参数（处理线程数、队列容量、分片数等）
+     */
+    explicit IoTServiceImpl(const IOT_NS::RouterOptions& options = {})
+        : mMessageRouter(MESSAGE_ROUTER_USER_MANAGER, options) {}
+
     /**
      * @brief 发送设备命令接口
      *
@@ -55,7 +64,176 @@ public:
     auto heartbeat(grpc::ServerContext* context,
                    grpc::ServerReaderWriter<iot::Ack, iot::HeartbeatRequest>* stream) -> grpc::Status override;
 
+    /**
+     * @brief 设备下行命令订阅接口
+     *
+     * 设备保持该流打开，服务器在有命令入队时立即推送，多条待发命令合并为一个 CommandBatch 写出。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 设备订阅请求，包含设备ID、用户ID与认证Token
+     * @param writer 服务端流写对象，用于推送命令批次
+     * @return grpc::Status 返回 RPC 调用的状态，指示流是否正常结束
+     */
+    auto subscribeCommands(grpc::ServerContext* context, const iot::CommandSubscription* request,
+                           grpc::ServerWriter<iot::CommandBatch>* writer) -> grpc::Status override;
+
+    /**
+     * @brief 设备命令回执接口
+     *
+     * 设备回报命令执行结果，命令进入成功或失败终态，不再重发。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 设备回执，包含命令ID、执行结果码与认证信息
+     * @param response 服务器发送的确认应答
+     * @return grpc::Status 返回 RPC 调用的状态，指示请求是否成功处理
+     */
+    auto ackCommand(grpc::ServerContext* context, const iot::CommandAck* request,
+                    iot::Ack* response) -> grpc::Status override;
+
+    /**
+     * @brief 命令状态查询接口
+     *
+     * 按命令ID查询命令状态；wait_ms 大于0时最多等待该时间直到命令进入终态。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 查询请求，包含命令ID与等待时间
+     * @param response 命令状态应答
+     * @return grpc::Status 返回 RPC 调用的状态，命令不存在时为 NOT_FOUND
+     */
+    auto getCommandStatus(grpc::ServerContext* context, const iot::CommandStatusRequest* request,
+                          iot::CommandStatusResponse* response) -> grpc::Status override;
+
+    /**
+     * @brief 批量状态上报接口（客户端流）
+     *
+     * 首个批次携带的凭据用于整条流；每读取一个批次立即交给路由器的批量入口处理，结束时返回一个聚合应答，
+     * failed_indexes 为被拒绝条目在整条流中的下标。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param reader 客户端流读取对象，读取 DeviceStatusBatch
+     * @param response 聚合应答
+     * @return grpc::Status 返回 RPC 调用的状态
+     */
+    auto reportStatusBatch(grpc::ServerContext* context, grpc::ServerReader<iot::DeviceStatusBatch>* reader,
+                           iot::Ack* response) -> grpc::Status override;
+
+    /**
+     * @brief 批量状态上报接口（单次请求）
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 状态批次
+     * @param response 聚合应答
+     * @return grpc::Status 返回 RPC 调用的状态
+     */
+    auto reportStatuses(grpc::ServerContext* context, const iot::DeviceStatusBatch* request,
+                        iot::Ack* response) -> grpc::Status override;
+
+    /**
+     * @brief 网关多路复用流接口
+     *
+     * 一条双向流上批量处理多个设备的心跳、状态上报与命令回执：首帧（或会话过期后）鉴权一次，
+     * 设备以流内索引引用；每读取一帧写出一条应答，鉴权失败时写出应答后结束流。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param stream 双向流对象，读取 GatewayFrame 并写入 GatewayFrameAck
+     * @return grpc::Status 返回 RPC 调用的状态
+     */
+    auto gatewaySession(grpc::ServerContext* context,
+                        grpc::ServerReaderWriter<iot::GatewayFrameAck, iot::GatewayFrame>* stream)
+        -> grpc::Status override;
+
+    /**
+     * @brief 设备状态订阅接口（服务端流）
+     *
+     * 先推送匹配设备的当前状态，再推送上线、离线与状态内容变化事件；多条待推送事件合并为一个 DeviceWatchBatch。
+     * 订阅流读取自己的游标，推送慢不会阻塞状态上报与心跳。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 订阅请求，包含过滤条件与认证信息
+     * @param writer 服务端流写对象，用于推送事件批次
+     * @return grpc::Status 返回 RPC 调用的状态，落后过多被断开时为 RESOURCE_EXHAUSTED
+     */
+    auto watchDevices(grpc::ServerContext* context, const iot::DeviceWatchRequest* request,
+                      grpc::ServerWriter<iot::DeviceWatchBatch>* writer) -> grpc::Status override;
+
+    /**
+     * @brief 单个设备查询接口
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 查询请求，包含设备ID与认证信息
+     * @param response 设备记录
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED，设备未注册时为 NOT_FOUND
+     */
+    auto getDevice(grpc::ServerContext* context, const iot::DeviceGetRequest* request,
+                   iot::DeviceRecord* response) -> grpc::Status override;
+
+    /**
+     * @brief 设备批量查询接口
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 查询请求，包含设备ID列表与认证信息
+     * @param response 找到的设备与未注册的设备ID
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED
+     */
+    auto batchGetDevices(grpc::ServerContext* context, const iot::DeviceBatchGetRequest* request,
+                         iot::DeviceBatchGetResponse* response) -> grpc::Status override;
+
+    /**
+     * @brief 设备分页列表接口
+     *
+     * 列表基于设备注册索引逐块复制，不会长时间持有注册表锁；以 next_cursor 翻页。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 列表请求，包含过滤条件、游标与认证信息
+     * @param response 一页设备或匹配数量
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED，游标无效时为 INVALID_ARGUMENT
+     */
+    auto listDevices(grpc::ServerContext* context, const iot::DeviceListRequest* request,
+                     iot::DeviceListResponse* response) -> grpc::Status override;
+
+    /**
+     * @brief 设备属性历史查询接口
+     *
+     * 只解码与时间范围重叠的压缩数据块；步长大于 0 时按时间桶降采样。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 查询请求，包含设备、属性、时间范围与认证信息
+     * @param response 按时间排序的点
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED，设备未注册时为 NOT_FOUND
+     */
+    auto getDeviceHistory(grpc::ServerContext* context, const iot::DeviceHistoryRequest* request,
+                          iot::DeviceHistoryResponse* response) -> grpc::Status override;
+
+    /**
+     * @brief 状态聚合查询接口
+     *
+     * 只合并各线程在窗口内的部分聚合结果，不扫描设备注册表。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 查询请求，包含聚合名称、分位点与认证信息
+     * @param response 窗口内各设备分组的聚合结果
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED，聚合名称未配置时为 NOT_FOUND
+     */
+    auto getAggregates(grpc::ServerContext* context, const iot::AggregateRequest* request,
+                       iot::AggregateResponse* response) -> grpc::Status override;
+
+    /**
+     * @brief 设备数量统计接口
+     *
+     * 只读取设备管理器随状态变化维护的计数器，不扫描设备注册表。
+     *
+     * @param context gRPC 服务上下文，包含调用相关信息
+     * @param request 统计请求，包含认证信息
+     * @param response 按状态统计的设备数量
+     * @return grpc::Status 返回 RPC 调用的状态，鉴权失败时为 UNAUTHENTICATED，设备管理器不支持计数时为 UNIMPLEMENTED
+     */
+    auto countDevices(grpc::ServerContext* context, const iot::DeviceCountRequest* request,
+                      iot::DeviceCountResponse* response) -> grpc::Status override;
+
 private:
-    static constexpr const char* kTAG = "IoTServiceImpl";            // 日志标识符，用于日志输出
-    IOT_NS::MessageRouter mMessageRouter = IOT_NS::MessageRouter {}; // 内部消息路由器，负责业务消息分发
+    static constexpr const char* kTAG = "IoTServiceImpl";                      // 日志标识符，用于日志输出
+    static constexpr std::chrono::milliseconds kCANCEL_CHECK_INTERVAL { 500 }; // 订阅流检查取消的间隔
+    static constexpr std::chrono::milliseconds kMAX_ACK_WAIT { 30000 };        // 等待命令终态的最长时间
+    static constexpr int32_t kREPLAY_REJECTED = 2;                             // 重放被拒绝的应答码
+    IOT_NS::MessageRouter mMessageRouter;                                      // 内部消息路由器，负责业务消息分发
 };
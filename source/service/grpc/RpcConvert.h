@@ -0,0 +1,389 @@
+#pragma once
+
+#include "MessageRouter.h"
+#include "iot_service.pb.h"
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 路由器结果与 protobuf 消息之间的转换函数，由同步与异步两种服务实现共用。
+ *
+ * Conversions between router results and protobuf messages, shared by the sync and async service
+ * implementations so both answer identically.
+ *
+ * @author Solo
+ * @version 1.0
+ * @date 2025-06-28
+ */
+namespace rpc_convert {
+
+/**
+ * @brief 用等待结束时的命令状态更新 sendCommand 应答；失败或超时以非0 code 返回
+ *
+ * @param status 命令状态，等待期间命令被清理时为空
+ * @param response 待更新的命令应答
+ */
+inline void applyCommandOutcome(const std::optional<IOT_NS::CommandStatus>& status, iot::CommandResponse* response) {
+    if (!status) {
+        return;
+    }
+    response->set_state(static_cast<iot::CommandState>(status->state));
+    if (status->state == IOT_NS::CommandState::Failed || status->state == IOT_NS::CommandState::TimedOut) {
+        response->set_code(1);
+        response->set_message(status->state == IOT_NS::CommandState::Failed ? status->message : "Command timed out");
+    }
+}
+
+/**
+ * @brief 填充命令状态查询应答
+ *
+ * @param commandId 查询的命令ID
+ * @param status 命令状态
+ * @param response 待填充的应答
+ * @return bool 命令存在返回 true
+ */
+inline auto fillCommandStatus(uint64_t commandId, const std::optional<IOT_NS::CommandStatus>& status,
+                              iot::CommandStatusResponse* response) -> bool {
+    response->set_command_id(commandId);
+    if (!status) {
+        response->set_state(iot::COMMAND_STATE_UNKNOWN);
+        return false;
+    }
+    response->set_device_id(status->deviceId);
+    response->set_state(static_cast<iot::CommandState>(status->state));
+    response->set_attempts(status->attempts);
+    response->set_code(status->code);
+    response->set_message(status->message);
+    return true;
+}
+
+/**
+ * @brief 将一批待下发命令转换为 CommandBatch
+ *
+ * @param deviceId 目标设备ID
+ * @param pending 待下发命令
+ * @param batch 输出的命令批次
+ */
+inline void fillBatch(const std::string& deviceId, const std::vector<IOT_NS::OutboundCommand>& pending,
+                      iot::CommandBatch* batch) {
+    for (const auto& command : pending) {
+        auto* out = batch->add_commands();
+        out->set_device_id(deviceId);
+        out->set_command(command.command);
+        out->mutable_params()->insert(command.params.begin(), command.params.end());
+        out->set_timestamp(command.timestamp);
+        out->set_command_id(command.commandId);
+    }
+}
+
+/**
+ * @brief 将上报的状态属性转换为路由器输入
+ *
+ * @param details 状态上报中的属性
+ * @return IOT_NS::StatusDetails 属性键值对
+ */
+inline auto toStatusDetails(const google::protobuf::Map<std::string, std::string>& details) -> IOT_NS::StatusDetails {
+    return IOT_NS::StatusDetails(details.begin(), details.end());
+}
+
+/**
+ * @brief 将网关帧转换为路由器的批次输入，帧中的字符串被移入批次
+ *
+ * @param frame 读取到的网关帧，转换后其中的设备ID与负载被取走
+ * @return IOT_NS::GatewayBatch 设备消息批次
+ */
+inline auto toGatewayBatch(iot::GatewayFrame& frame) -> IOT_NS::GatewayBatch {
+    IOT_NS::GatewayBatch batch;
+    batch.bindings.reserve(frame.devices_size());
+    for (auto& device : *frame.mutable_devices()) {
+        batch.bindings.push_back({ device.index(), std::move(*device.mutable_device_id()) });
+    }
+    batch.heartbeats.reserve(frame.heartbeats_size());
+    for (const auto& heartbeat : frame.heartbeats()) {
+        batch.heartbeats.push_back({ heartbeat.device(), heartbeat.timestamp() });
+    }
+    batch.statuses.reserve(frame.statuses_size());
+    for (auto& status : *frame.mutable_statuses()) {
+        batch.statuses.push_back({ status.device(), std::move(*status.mutable_status()), status.timestamp(),
+                                   toStatusDetails(status.details()) });
+    }
+    batch.acks.reserve(frame.acks_size());
+    for (auto& ack : *frame.mutable_acks()) {
+        batch.acks.push_back({ ack.device(), ack.command_id(), ack.code(), std::move(*ack.mutable_message()) });
+    }
+    return batch;
+}
+
+/**
+ * @brief 填充网关帧应答；会话无效时 code 为 1
+ *
+ * @param sequence 对应的帧序号
+ * @param result 批次处理结果
+ * @param ack 待填充的应答
+ */
+inline void fillGatewayAck(uint64_t sequence, const IOT_NS::GatewayBatchResult& result, iot::GatewayFrameAck* ack) {
+    ack->Clear();
+    ack->set_sequence(sequence);
+    ack->set_code(result.authenticated ? 0 : 1);
+    ack->set_message(result.authenticated ? "OK" : "Auth failed");
+    ack->set_accepted(result.accepted);
+    ack->set_rejected(result.rejected);
+    ack->mutable_rejected_devices()->Add(result.rejectedDevices.begin(), result.rejectedDevices.end());
+}
+
+/**
+ * @brief 将批量状态上报转换为路由器的批次输入，状态内容被移入批次
+ *
+ * @param batch 读取到的状态批次，转换后其中的设备ID与状态内容被取走
+ * @param updates 输出的状态上报批次，调用前被清空
+ */
+inline void toStatusUpdates(iot::DeviceStatusBatch& batch, std::vector<IOT_NS::DeviceStatusUpdate>& updates) {
+    updates.clear();
+    updates.reserve(batch.statuses_size());
+    for (auto& status : *batch.mutable_statuses()) {
+        updates.push_back({ std::move(*status.mutable_device_id()), std::move(*status.mutable_status()),
+                            status.timestamp(), toStatusDetails(status.details()) });
+    }
+}
+
+/**
+ * @brief 将只读的批量状态上报（单次请求）转换为路由器的批次输入，字符串各复制一次
+ *
+ * @param batch 状态批次
+ * @param updates 输出的状态上报批次，调用前被清空
+ */
+inline void toStatusUpdates(const iot::DeviceStatusBatch& batch, std::vector<IOT_NS::DeviceStatusUpdate>& updates) {
+    updates.clear();
+    updates.reserve(batch.statuses_size());
+    for (const auto& status : batch.statuses()) {
+        updates.push_back({ status.device_id(), status.status(), status.timestamp(), toStatusDetails(status.details()) });
+    }
+}
+
+/**
+ * @brief 将一个批次的处理结果累加到聚合应答中
+ *
+ * @param result 批次处理结果
+ * @param base 该批次首个条目在整条流中的下标
+ * @param ack 聚合应答
+ */
+inline void accumulateStatusAck(const IOT_NS::StatusBatchResult& result, uint32_t base, iot::Ack* ack) {
+    ack->set_accepted(ack->accepted() + result.accepted);
+    for (auto index : result.failedIndexes) {
+        ack->add_failed_indexes(base + index);
+    }
+}
+
+/**
+ * @brief 根据累加结果设置聚合应答的状态码：1 表示认证失败，3 表示部分条目被拒绝
+ *
+ * @param authenticated 鉴权是否通过
+ * @param ack 聚合应答
+ */
+inline void finishStatusAck(bool authenticated, iot::Ack* ack) {
+    if (!authenticated) {
+        ack->set_code(1);
+        ack->set_message("Auth failed");
+    } else if (ack->failed_indexes_size() > 0) {
+        ack->set_code(3);
+        ack->set_message("Statuses partially rejected");
+    } else {
+        ack->set_code(0);
+        ack->set_message("Statuses received");
+    }
+}
+
+/**
+ * @brief 由订阅请求生成过滤条件
+ *
+ * @param request 设备状态订阅请求
+ * @return IOT_NS::DeviceWatchFilter 过滤条件
+ */
+inline auto toWatchFilter(const iot::DeviceWatchRequest& request) -> IOT_NS::DeviceWatchFilter {
+    IOT_NS::DeviceWatchFilter filter;
+    filter.deviceIds.insert(request.device_ids().begin(), request.device_ids().end());
+    filter.idPrefix = request.id_prefix();
+    return filter;
+}
+
+/**
+ * @brief 订阅请求对应的溢出策略
+ *
+ * @param request 设备状态订阅请求
+ * @return IOT_NS::WatchOverflowPolicy 溢出策略
+ */
+inline auto toWatchPolicy(const iot::DeviceWatchRequest& request) -> IOT_NS::WatchOverflowPolicy {
+    return request.drop_when_slow() ? IOT_NS::WatchOverflowPolicy::Drop : IOT_NS::WatchOverflowPolicy::Resync;
+}
+
+/**
+ * @brief 将待推送的订阅事件移入批次，事件类型与设备状态的取值与 proto 枚举一一对应
+ *
+ * @param events 待推送的订阅事件
+ * @param batch 待填充的事件批次
+ */
+inline void fillWatchBatch(std::vector<IOT_NS::DeviceWatchEvent>& events, iot::DeviceWatchBatch* batch) {
+    for (auto& event : events) {
+        auto* out = batch->add_events();
+        out->set_type(static_cast<iot::DeviceWatchEventType>(event.type));
+        out->set_device_id(std::move(event.deviceId));
+        out->set_state(static_cast<iot::DeviceState>(event.status));
+        out->set_status(std::move(event.report));
+        out->set_sequence(event.sequence);
+        out->set_event(std::move(event.event));
+    }
+}
+
+/**
+ * @brief 填充设备查询结果，设备状态的取值与 proto 枚举一一对应
+ *
+ * @param record 设备查询结果
+ * @param now 计算心跳时长所用的当前时间点
+ * @param out 待填充的设备记录
+ */
+inline void fillDeviceRecord(IOT_NS::DeviceRecord& record, std::chrono::steady_clock::time_point now,
+                             iot::DeviceRecord* out) {
+    out->set_device_id(std::move(record.deviceId));
+    out->set_state(static_cast<iot::DeviceState>(record.info.status));
+    out->set_status(std::move(record.info.lastStatusReport));
+    out->set_heartbeat_age_ms(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - record.info.lastHeartbeat).count());
+    out->set_owner(std::move(record.info.owner));
+    auto& keys = IOT_NS::AttributeKeys::instance();
+    auto* details = out->mutable_details();
+    record.info.attributes.forEach([&keys, details](IOT_NS::AttributeKey key, const IOT_NS::AttributeValue& value) {
+        (*details)[keys.name(key)] = IOT_NS::formatAttributeValue(value);
+    });
+}
+
+/**
+ * @brief 由分页列表请求生成查询条件；page_size 为 0 时沿用默认每页数量
+ *
+ * @param request 设备分页列表请求
+ * @return IOT_NS::DeviceQuery 查询条件
+ */
+inline auto toDeviceQuery(const iot::DeviceListRequest& request) -> IOT_NS::DeviceQuery {
+    IOT_NS::DeviceQuery query;
+    if (request.has_state()) {
+        query.status = static_cast<IOT_NS::DeviceStatus>(request.state());
+    }
+    query.minHeartbeatAge = std::chrono::milliseconds(std::max<int64_t>(request.min_heartbeat_age_ms(), 0));
+    query.maxHeartbeatAge = std::chrono::milliseconds(std::max<int64_t>(request.max_heartbeat_age_ms(), 0));
+    query.cursor = request.cursor();
+    if (request.page_size() > 0) {
+        query.limit = request.page_size();
+    }
+    query.countOnly = request.count_only();
+    query.owner = request.owner();
+    query.attributes.reserve(request.attribute_filters_size());
+    for (const auto& filter : request.attribute_filters()) {
+        query.attributes.push_back(
+            { filter.key(), static_cast<IOT_NS::AttributeFilter::Op>(filter.op()), filter.value() });
+    }
+    return query;
+}
+
+/**
+ * @brief 将一页设备移入分页列表应答
+ *
+ * @param page 设备列表的一页
+ * @param response 待填充的应答
+ */
+inline void fillDeviceList(IOT_NS::DevicePage& page, iot::DeviceListResponse* response) {
+    auto now = std::chrono::steady_clock::now();
+    response->mutable_devices()->Reserve(static_cast<int>(page.devices.size()));
+    for (auto& record : page.devices) {
+        fillDeviceRecord(record, now, response->add_devices());
+    }
+    response->set_next_cursor(std::move(page.nextCursor));
+    response->set_count(page.count);
+}
+
+/**
+ * @brief 由属性历史请求生成查询条件；负的步长按 0 处理
+ *
+ * @param request 设备属性历史请求
+ * @return IOT_NS::HistoryQuery 查询条件
+ */
+inline auto toHistoryQuery(const iot::DeviceHistoryRequest& request) -> IOT_NS::HistoryQuery {
+    IOT_NS::HistoryQuery query;
+    query.deviceId = request.device_id();
+    query.attribute = request.attribute();
+    query.fromMs = request.from_ms();
+    query.toMs = request.to_ms();
+    query.step = std::chrono::milliseconds(std::max<int64_t>(request.step_ms(), 0));
+    return query;
+}
+
+/**
+ * @brief 将属性历史的点写入应答
+ *
+ * @param points 按时间排序的点
+ * @param response 待填充的应答
+ */
+inline void fillDeviceHistory(const std::vector<IOT_NS::HistoryPoint>& points, iot::DeviceHistoryResponse* response) {
+    response->mutable_points()->Reserve(static_cast<int>(points.size()));
+    for (const auto& point : points) {
+        auto* out = response->add_points();
+        out->set_timestamp_ms(point.timestampMs);
+        out->set_value(point.value);
+        out->set_min(point.min);
+        out->set_max(point.max);
+        out->set_count(point.count);
+    }
+}
+
+/**
+ * @brief 由状态聚合请求生成查询条件
+ *
+ * @param request 状态聚合请求
+ * @return IOT_NS::AggregateQuery 查询条件
+ */
+inline auto toAggregateQuery(const iot::AggregateRequest& request) -> IOT_NS::AggregateQuery {
+    IOT_NS::AggregateQuery query;
+    query.name = request.name();
+    query.quantiles.assign(request.quantiles().begin(), request.quantiles().end());
+    query.includeOpen = request.include_open();
+    return query;
+}
+
+/**
+ * @brief 将窗口聚合结果移入应答
+ *
+ * @param window 窗口聚合结果
+ * @param response 待填充的应答
+ */
+inline void fillAggregates(IOT_NS::AggregateWindow& window, iot::AggregateResponse* response) {
+    response->set_window_start_ms(window.startMs);
+    response->set_window_end_ms(window.endMs);
+    response->mutable_groups()->Reserve(static_cast<int>(window.groups.size()));
+    for (auto& group : window.groups) {
+        auto* out = response->add_groups();
+        out->set_group(std::move(group.group));
+        out->set_count(group.count);
+        out->set_sum(group.sum);
+        out->set_min(group.min);
+        out->set_max(group.max);
+        out->set_mean(group.mean);
+        out->mutable_quantiles()->Add(group.quantiles.begin(), group.quantiles.end());
+    }
+}
+
+/**
+ * @brief 填充设备数量统计应答
+ *
+ * @param counts 按状态统计的设备数量
+ * @param response 待填充的应答
+ */
+inline void fillDeviceCounts(const IOT_NS::DeviceCounts& counts, iot::DeviceCountResponse* response) {
+    response->set_total(counts.total);
+    response->set_online(counts.of(IOT_NS::DeviceStatus::ONLINE));
+    response->set_offline(counts.of(IOT_NS::DeviceStatus::OFFLINE));
+    response->set_unknown(counts.of(IOT_NS::DeviceStatus::UNKNOWN));
+    response->set_error(counts.of(IOT_NS::DeviceStatus::ERROR));
+}
+
+} // namespace rpc_convert
@@ -1,7 +1,10 @@
+#include "config/ServerConfig.h"
+#include "grpc/IoTCallbackServiceImpl.h"
 #include "grpc/IoTServiceImpl.h"
 
 #include <grpcpp/ext/proto_server_reflection_plugin.h>
 #include <grpcpp/grpcpp.h>
+#include <string>
 #include <thread>
 
 // 日志标签，用于区分日志来源
@@ -10,18 +13,18 @@ static constexpr const char* kTAG = "IOT-Server";
 /**
  * @brief 启动并运行 gRPC 服务器的函数
  *
- * - 监听 0.0.0.0:50051 地址上的客户端请求
- * - 注册 IoTServiceImpl 服务实例
+ * - 监听配置中的地址上的客户端请求
+ * - 按配置注册回调实现 IoTCallbackServiceImpl 或同步实现 IoTServiceImpl，并把路由器调优参数传给服务实现
+ * - 应用资源配额、并发流、消息大小、keepalive 与轮询线程等 gRPC 配置
  * - 启动服务器并阻塞等待，直到服务器关闭
  *
+ * @param config 服务器配置
  * @note 此函数会阻塞，直到服务器显式关闭。
  */
-void runGrpcServer() {
-    // 服务器监听地址和端口
-    std::string server_address("0.0.0.0:50051");
-
-    // 创建服务实现对象
-    IoTServiceImpl service;
+void runGrpcServer(const ServerConfig& config) {
+    // 创建服务实现对象，只注册其中之一
+    std::unique_ptr<IoTCallbackServiceImpl> callbackService;
+    std::unique_ptr<IoTServiceImpl> syncService;
 
     // 初始化 gRPC 反射插件，允许客户端查询服务信息
     grpc::reflection::InitProtoReflectionServerBuilderPlugin();
@@ -30,16 +33,28 @@ void runGrpcServer() {
     grpc::ServerBuilder builder;
 
     // 添加监听端口，使用不安全的服务器凭据（明文传输）
-    builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+    builder.AddListeningPort(config.address, grpc::InsecureServerCredentials());
 
     // 注册服务实例
-    builder.RegisterService(&service);
+    if (config.callbackApi) {
+        callbackService = std::make_unique<IoTCallbackServiceImpl>(config.router);
+        builder.RegisterService(callbackService.get());
+    } else {
+        syncService = std::make_unique<IoTServiceImpl>(config.router);
+        builder.RegisterService(syncService.get());
+    }
+    config.applyTo(builder);
 
     // 构建并启动服务器
     std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+    if (!server) {
+        std::cerr << kTAG << ": failed to start server on " << config.address << std::endl;
+        return;
+    }
 
     // 打印服务器启动日志
-    std::cout << "IoT gRPC server listening on " << server_address << std::endl;
+    std::cout << "IoT gRPC server (" << (config.callbackApi ? "callback" : "sync") << " API) listening on "
+              << config.address << std::endl;
 
     // 阻塞等待，直到服务器关闭
     server->Wait();
@@ -48,16 +63,24 @@ void runGrpcServer() {
 /**
  * @brief 程序入口函数
  *
+ * - 加载配置文件并应用命令行覆盖，打印生效配置
  * - 启动一个独立线程运行 gRPC 服务器
  * - 主线程等待 gRPC 线程结束
  *
  * @param argc 命令行参数数量
  * @param argv 命令行参数数组
- * @return int 程序退出码，通常为0表示正常退出
+ * @return int 程序退出码，0 表示正常退出，配置非法时为 1
  */
 auto main(int argc, char** argv) -> int {
+    ServerConfig config;
+    if (!config.parseArgs(argc, argv)) {
+        std::cerr << kTAG << ": usage: iot_service [--config=FILE] [--key=value ...]" << std::endl;
+        return 1;
+    }
+    config.print(std::cout);
+
     // 创建并启动运行gRPC服务器的线程
-    std::thread grpcThread(runGrpcServer);
+    std::thread grpcThread(runGrpcServer, config);
 
     // 主线程等待gRPC线程执行完毕（一般阻塞直到服务器关闭）
     grpcThread.join();
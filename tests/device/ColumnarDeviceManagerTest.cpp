@@ -0,0 +1,176 @@
+#include "ColumnScan.h"
+#include "DeviceManagerFactory.h"
+#include "common/NameSpaceDef.h"
+#include "device/DeviceInfo.h"
+
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class ColumnarDeviceManagerTest : public ::testing::Test {
+protected:
+    std::shared_ptr<IOT_DEVICE_NS::IDeviceManager> manager =
+        IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_COLUMNAR);
+};
+
+TEST(ColumnScanTest, MasksMatchScalarComparison) {
+    std::mt19937_64 rng(42);
+    alignas(64) uint8_t bytes[IOT_DEVICE_NS::ColumnScan::kBLOCK];
+    alignas(64) int64_t values[IOT_DEVICE_NS::ColumnScan::kBLOCK];
+    for (int round = 0; round < 100; ++round) {
+        for (size_t i = 0; i < IOT_DEVICE_NS::ColumnScan::kBLOCK; ++i) {
+            bytes[i] = static_cast<uint8_t>(rng() % 4 == 0 ? 0xFF : rng() % 4);
+            values[i] = static_cast<int64_t>(rng() % 1000) - 500;
+        }
+        uint64_t equal = 0;
+        uint64_t less = 0;
+        for (size_t i = 0; i < IOT_DEVICE_NS::ColumnScan::kBLOCK; ++i) {
+            equal |= static_cast<uint64_t>(bytes[i] == 0xFF) << i;
+            less |= static_cast<uint64_t>(values[i] < 17) << i;
+        }
+        EXPECT_EQ(IOT_DEVICE_NS::ColumnScan::equalMask(bytes, 0xFF), equal) << IOT_DEVICE_NS::ColumnScan::isa();
+        EXPECT_EQ(IOT_DEVICE_NS::ColumnScan::lessMask(values, 17), less) << IOT_DEVICE_NS::ColumnScan::isa();
+    }
+}
+
+TEST_F(ColumnarDeviceManagerTest, RegisterHeartbeatAndStatus) {
+    ASSERT_TRUE(manager);
+    IOT_NS::DeviceHandle handle;
+    EXPECT_TRUE(manager->registerDevice("col-1", handle));
+    EXPECT_FALSE(manager->registerDevice("col-1")); // 再次注册应失败
+    EXPECT_EQ(manager->acquireHandle("col-1"), handle);
+    EXPECT_EQ(manager->acquireSlot("col-1"), nullptr); // 列式存储没有槽位
+    EXPECT_TRUE(manager->isDeviceOnline("col-1"));
+
+    EXPECT_TRUE(manager->reportStatus(handle, "by-handle", { { "col_temp", "21.5" } }));
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo("col-1", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::ONLINE);
+    EXPECT_EQ(info.lastStatusReport, "by-handle");
+    EXPECT_EQ(info.attributes.size(), 1u);
+
+    manager->markDeviceOffline("col-1");
+    ASSERT_TRUE(manager->getDeviceInfo(handle, info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::OFFLINE);
+    manager->refreshDeviceHeartbeat(handle);
+    EXPECT_TRUE(manager->isDeviceOnline("col-1"));
+
+    EXPECT_FALSE(manager->getDeviceInfo("not_exist_device", info));
+    EXPECT_FALSE(manager->getDeviceInfo(IOT_NS::DeviceHandle { 1u << 20 }, info));
+
+    size_t visited = 0;
+    manager->forEachDevice([&visited](const IOT_NS::DeviceSlot& slot) {
+        EXPECT_EQ(slot.deviceId, "col-1");
+        EXPECT_EQ(slot.lastStatusReport, "by-handle");
+        ++visited;
+    });
+    EXPECT_EQ(visited, 1u);
+}
+
+TEST_F(ColumnarDeviceManagerTest, ListDevices_BlockScansMatchFilters) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 50ms;
+    options.expiryTick = 0ms; // 只验证查询时的折算
+    manager->configure(options);
+
+    // 跨越多个 64 设备的扫描块
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_TRUE(manager->registerDevice("col-l" + std::to_string(i)));
+    }
+    std::this_thread::sleep_for(100ms);
+    for (int i = 0; i < 300; i += 7) {
+        manager->refreshDeviceHeartbeat("col-l" + std::to_string(i)); // 43 台设备保持在线
+    }
+    manager->markDeviceOffline("col-l1");
+    manager->reportStatus("col-l14", "hot", { { "col_level", "9" } });
+    manager->reportStatus("col-l15", "cold", { { "col_level", "1" } });
+
+    IOT_NS::DeviceQuery query;
+    query.countOnly = true;
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 300u);
+
+    query.status = IOT_NS::DeviceStatus::ONLINE;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 44u); // 刚上报的 col-l15 重新在线
+    query.status = IOT_NS::DeviceStatus::OFFLINE;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 256u);
+
+    query.status.reset();
+    query.minHeartbeatAge = 50ms;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 256u);
+    query.minHeartbeatAge = 0ms;
+    query.maxHeartbeatAge = 50ms;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 44u);
+
+    query = {};
+    query.attributes = { { "col_level", IOT_NS::AttributeFilter::Op::Gt, 5 } };
+    ASSERT_TRUE(manager->listDevices(query, page));
+    ASSERT_EQ(page.devices.size(), 1u);
+    EXPECT_EQ(page.devices[0].deviceId, "col-l14");
+
+    // 分页遍历在线设备，每个设备恰好出现一次
+    query = {};
+    query.status = IOT_NS::DeviceStatus::ONLINE;
+    query.limit = 10;
+    std::vector<std::string> seen;
+    do {
+        ASSERT_TRUE(manager->listDevices(query, page));
+        EXPECT_LE(page.devices.size(), 10u);
+        for (const auto& record : page.devices) {
+            EXPECT_EQ(record.info.status, IOT_NS::DeviceStatus::ONLINE);
+            seen.push_back(record.deviceId);
+        }
+        query.cursor = page.nextCursor;
+    } while (!page.nextCursor.empty());
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(seen.size(), 44u);
+
+    query = {};
+    query.cursor = "not-a-cursor";
+    EXPECT_FALSE(manager->listDevices(query, page));
+    query.cursor = "301";
+    EXPECT_FALSE(manager->listDevices(query, page));
+}
+
+TEST_F(ColumnarDeviceManagerTest, ExpirySweep_MarksSilentDevicesOffline) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 60ms;
+    options.expiryTick = 10ms;
+    manager->configure(options);
+
+    std::mutex mutex;
+    std::vector<std::string> offline;
+    manager->setEventListener([&](const IOT_NS::DeviceEvent& event) {
+        if (event.type == IOT_NS::DeviceEvent::Type::Offline) {
+            std::lock_guard<std::mutex> lock(mutex);
+            offline.push_back(event.deviceId);
+        }
+    });
+
+    EXPECT_TRUE(manager->registerDevice("col-silent"));
+    EXPECT_TRUE(manager->registerDevice("col-busy"));
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(30ms);
+        manager->refreshDeviceHeartbeat("col-busy");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(offline, (std::vector<std::string> { "col-silent" }));
+    }
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo("col-silent", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::OFFLINE);
+    manager->setEventListener(nullptr);
+}
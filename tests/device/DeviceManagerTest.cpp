@@ -1,10 +1,21 @@
 #include "DeviceManagerFactory.h"
 #include "common/NameSpaceDef.h"
+#include "common/TimeSeries.h"
+#include "device/DeviceImportFile.h"
 #include "device/DeviceInfo.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <mutex>
+#include <random>
 #include <thread>
+#include <unistd.h>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -83,3 +94,939 @@ TEST_F(DeviceManagerTest, GetDeviceInfo_NotExist) {
     IOT_NS::DeviceInfo dummy;
     EXPECT_FALSE(manager->getDeviceInfo("not_exist_device", dummy));
 }
+
+TEST_F(DeviceManagerTest, SlotHeartbeat_EmitsOnlyTransitions) {
+    std::string deviceId = "device007";
+    std::vector<IOT_NS::DeviceEvent> events;
+    manager->setEventListener([&events](const IOT_NS::DeviceEvent& event) { events.push_back(event); });
+
+    EXPECT_TRUE(manager->registerDevice(deviceId));
+    auto slot = manager->acquireSlot(deviceId);
+    ASSERT_NE(slot, nullptr);
+
+    // 在线状态下的心跳不产生事件
+    manager->refreshDeviceHeartbeat(*slot);
+    manager->refreshDeviceHeartbeat(*slot);
+    ASSERT_EQ(events.size(), 1u); // 仅注册时的上线事件
+    EXPECT_EQ(events.back().type, IOT_NS::DeviceEvent::Type::Online);
+
+    // 离线后的第一次心跳产生上线事件
+    manager->markDeviceOffline(deviceId);
+    manager->refreshDeviceHeartbeat(*slot);
+    manager->refreshDeviceHeartbeat(*slot);
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[1].type, IOT_NS::DeviceEvent::Type::Offline);
+    EXPECT_EQ(events[2].type, IOT_NS::DeviceEvent::Type::Online);
+    EXPECT_EQ(events[2].deviceId, deviceId);
+    EXPECT_TRUE(manager->isDeviceOnline(deviceId));
+
+    manager->setEventListener(nullptr);
+}
+
+TEST_F(DeviceManagerTest, AcquireSlot_NotExist) {
+    EXPECT_EQ(manager->acquireSlot("not_exist_device"), nullptr);
+}
+
+TEST_F(DeviceManagerTest, Configure_ShardsAndHeartbeatTimeout) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 50ms;
+    manager->configure(options);
+
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_TRUE(manager->registerDevice("device-s" + std::to_string(i)));
+    }
+    EXPECT_TRUE(manager->isDeviceOnline("device-s3"));
+
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(manager->isDeviceOnline("device-s3")); // 超过配置的心跳超时
+    manager->refreshDeviceHeartbeat("device-s3");
+    EXPECT_TRUE(manager->isDeviceOnline("device-s3"));
+}
+
+TEST_F(DeviceManagerTest, ListDevices_PagesFiltersAndCounts) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 50ms;
+    manager->configure(options);
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(manager->registerDevice("device-l" + std::to_string(i)));
+    }
+    std::this_thread::sleep_for(100ms);
+    manager->refreshDeviceHeartbeat("device-l2");
+    manager->refreshDeviceHeartbeat("device-l7");
+
+    // 分页遍历全部设备，每个设备恰好出现一次
+    IOT_NS::DeviceQuery query;
+    query.limit = 3;
+    std::vector<std::string> seen;
+    IOT_NS::DevicePage page;
+    do {
+        ASSERT_TRUE(manager->listDevices(query, page));
+        EXPECT_LE(page.devices.size(), 3u);
+        for (const auto& record : page.devices) {
+            seen.push_back(record.deviceId);
+        }
+        query.cursor = page.nextCursor;
+    } while (!page.nextCursor.empty());
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(seen.size(), 10u);
+
+    // 心跳超时的设备按离线处理，但不改变设备状态
+    query = {};
+    query.status = IOT_NS::DeviceStatus::ONLINE;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    ASSERT_EQ(page.devices.size(), 2u);
+    EXPECT_TRUE(page.nextCursor.empty());
+
+    query.status = IOT_NS::DeviceStatus::OFFLINE;
+    query.minHeartbeatAge = 50ms;
+    query.countOnly = true;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_TRUE(page.devices.empty());
+    EXPECT_EQ(page.count, 8u);
+
+    query = {};
+    query.cursor = "not-a-cursor";
+    EXPECT_FALSE(manager->listDevices(query, page));
+    query.cursor = "99:0";
+    EXPECT_FALSE(manager->listDevices(query, page));
+}
+
+TEST_F(DeviceManagerTest, DeviceAttributes_TypedPartialMerge) {
+    auto& keys = IOT_NS::AttributeKeys::instance();
+    auto temp = *keys.intern("da_temp");
+    auto online = *keys.intern("da_online");
+    auto label = *keys.intern("da_label");
+    EXPECT_EQ(keys.intern("da_temp"), temp);
+    EXPECT_EQ(keys.name(label), "da_label");
+
+    IOT_NS::DeviceAttributes attributes;
+    EXPECT_TRUE(attributes.apply({ { temp, IOT_NS::parseAttributeValue("21.5") },
+                                   { online, IOT_NS::parseAttributeValue("true") },
+                                   { label, IOT_NS::parseAttributeValue("boiler room, level 2") } }));
+    EXPECT_EQ(attributes.number(temp), 21.5);
+    EXPECT_EQ(attributes.number(online), 1.0);
+    EXPECT_FALSE(attributes.number(label).has_value());
+
+    // 未变化的值不算变化；只列出的键被更新，其余保持不变
+    EXPECT_FALSE(attributes.apply({ { temp, IOT_NS::parseAttributeValue("21.5") } }));
+    EXPECT_TRUE(attributes.apply({ { label, IOT_NS::parseAttributeValue("attic") } }));
+    EXPECT_EQ(attributes.get(label), IOT_NS::AttributeValue(std::string("attic")));
+    EXPECT_EQ(attributes.number(temp), 21.5);
+
+    // 反复改写字符串后缓冲区会被压缩，内容保持正确
+    for (int i = 0; i < 200; ++i) {
+        attributes.apply({ { label, IOT_NS::AttributeValue("a-much-longer-label-" + std::to_string(i)) } });
+    }
+    EXPECT_EQ(attributes.get(label), IOT_NS::AttributeValue(std::string("a-much-longer-label-199")));
+    EXPECT_LT(attributes.memoryUsage(), 256u);
+
+    EXPECT_TRUE(attributes.apply({ { online, std::nullopt } }));
+    EXPECT_FALSE(attributes.get(online).has_value());
+    EXPECT_EQ(attributes.size(), 2u);
+    EXPECT_EQ(IOT_NS::formatAttributeValue(*attributes.get(temp)), "21.5");
+}
+
+TEST_F(DeviceManagerTest, ReportStatus_MergesDetailsAndFiltersByAttribute) {
+    EXPECT_TRUE(manager->registerDevice("device-a1"));
+    EXPECT_TRUE(manager->registerDevice("device-a2"));
+    manager->reportStatus("device-a1", "ok", { { "rm_battery", "80" }, { "rm_mode", "eco" } });
+    manager->reportStatus("device-a2", "ok", { { "rm_battery", "15" } });
+    manager->reportStatus("device-a1", "ok", { { "rm_battery", "75" }, { "rm_mode", "" } });
+
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo("device-a1", info));
+    auto battery = *IOT_NS::AttributeKeys::instance().find("rm_battery");
+    EXPECT_EQ(info.attributes.number(battery), 75.0);
+    EXPECT_EQ(info.attributes.size(), 1u);
+
+    IOT_NS::DeviceQuery query;
+    query.attributes.push_back({ "rm_battery", IOT_NS::AttributeFilter::Op::Lt, 20 });
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    ASSERT_EQ(page.devices.size(), 1u);
+    EXPECT_EQ(page.devices[0].deviceId, "device-a2");
+}
+
+TEST_F(DeviceManagerTest, ExpirySweeper_MarksSilentDevicesOffline) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 200ms;
+    options.expiryTick = 10ms;
+    options.heartbeatClasses = { { "sensor-", 60ms }, { "sensor-slow-", 10000ms } };
+    manager->configure(options);
+
+    std::mutex mutex;
+    std::vector<std::string> offline;
+    manager->setEventListener([&](const IOT_NS::DeviceEvent& event) {
+        if (event.type == IOT_NS::DeviceEvent::Type::Offline) {
+            std::lock_guard<std::mutex> lock(mutex);
+            offline.push_back(event.deviceId);
+        }
+    });
+
+    EXPECT_TRUE(manager->registerDevice("sensor-1"));      // 类别超时 60ms
+    EXPECT_TRUE(manager->registerDevice("sensor-slow-1")); // 前缀更长的类别，10s
+    EXPECT_TRUE(manager->registerDevice("plain-1"));       // 默认超时 200ms
+    EXPECT_TRUE(manager->registerDevice("plain-2"));
+    EXPECT_TRUE(manager->setHeartbeatTimeout("plain-2", 30ms)); // 单设备超时优先
+    EXPECT_FALSE(manager->setHeartbeatTimeout("no-such-device", 30ms));
+
+    // 无人查询，扫描线程自行发现超时的设备
+    std::this_thread::sleep_for(130ms);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::sort(offline.begin(), offline.end());
+        EXPECT_EQ(offline, (std::vector<std::string> { "plain-2", "sensor-1" }));
+    }
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo("plain-2", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::OFFLINE);
+
+    // 持续心跳的设备不会超时；重新上线的设备再次挂入时间轮
+    manager->refreshDeviceHeartbeat("sensor-1");
+    manager->refreshDeviceHeartbeat("plain-1");
+    for (int i = 0; i < 6; ++i) {
+        std::this_thread::sleep_for(40ms);
+        manager->refreshDeviceHeartbeat("plain-1");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(std::count(offline.begin(), offline.end(), "plain-1"), 0);
+        EXPECT_EQ(std::count(offline.begin(), offline.end(), "sensor-1"), 2);
+        EXPECT_EQ(std::count(offline.begin(), offline.end(), "sensor-slow-1"), 0);
+    }
+    manager->setEventListener(nullptr);
+}
+
+TEST_F(DeviceManagerTest, DeviceHandles_StableAndUsableWithoutId) {
+    IOT_NS::DeviceHandle first;
+    IOT_NS::DeviceHandle again;
+    EXPECT_TRUE(manager->registerDevice("device-h1", first));
+    EXPECT_FALSE(manager->registerDevice("device-h1", again)); // 已存在的设备返回原有句柄
+    EXPECT_EQ(first, again);
+    EXPECT_TRUE(IOT_NS::isValid(first));
+    EXPECT_EQ(manager->acquireHandle("device-h1"), first);
+    EXPECT_EQ(manager->acquireHandle("not_exist_device"), IOT_NS::kINVALID_DEVICE_HANDLE);
+
+    // 跨越多个句柄块，每个句柄都指向自己的设备
+    std::vector<IOT_NS::DeviceHandle> handles;
+    for (int i = 0; i < 5000; ++i) {
+        IOT_NS::DeviceHandle handle;
+        ASSERT_TRUE(manager->registerDevice("device-hb" + std::to_string(i), handle));
+        handles.push_back(handle);
+    }
+    EXPECT_EQ(manager->acquireHandle("device-hb4999"), handles.back());
+    EXPECT_NE(handles.front(), handles.back());
+
+    EXPECT_TRUE(manager->reportStatus(handles[4321], "by-handle", { { "hb_level", "3" } }));
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo(handles[4321], info));
+    EXPECT_EQ(info.lastStatusReport, "by-handle");
+    ASSERT_TRUE(manager->getDeviceInfo("device-hb4321", info));
+    EXPECT_EQ(info.lastStatusReport, "by-handle");
+
+    manager->markDeviceOffline("device-h1");
+    manager->refreshDeviceHeartbeat(first);
+    EXPECT_TRUE(manager->isDeviceOnline("device-h1"));
+
+    EXPECT_FALSE(manager->getDeviceInfo(IOT_NS::kINVALID_DEVICE_HANDLE, info));
+    EXPECT_FALSE(manager->reportStatus(IOT_NS::DeviceHandle { 1u << 27 }, "unknown", {}));
+}
+
+/**
+ * @brief 测试用的预写日志路径，按进程区分
+ */
+static auto walTestPath(const std::string& name) -> std::string {
+    auto path = std::filesystem::temp_directory_path() / (name + "-" + std::to_string(::getpid()) + ".wal");
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+TEST_F(DeviceManagerTest, WriteAheadLog_RestoresRegistryAfterRestart) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 50ms;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("wal-restore");
+    manager->configure(options);
+
+    ASSERT_TRUE(manager->registerDevice("wal-1"));
+    ASSERT_TRUE(manager->registerDevice("wal-2"));
+    manager->reportStatus("wal-1", "warm", { { "wal_temp", "21.5" }, { "wal_mode", "eco" } });
+    manager->reportStatus("wal-1", "warmer", { { "wal_temp", "23" }, { "wal_mode", "" } });
+    manager->markDeviceOffline("wal-2");
+    EXPECT_TRUE(manager->setHeartbeatTimeout("wal-1", 5min));
+    manager->shutdown();
+    manager.reset();
+
+    // 模拟崩溃时只写了一半的记录
+    {
+        std::ofstream out(options.walPath, std::ios::binary | std::ios::app);
+        out.write("\x40\0\0\0torn", 8);
+    }
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    std::this_thread::sleep_for(100ms);
+
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(restarted->getDeviceInfo("wal-1", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::ONLINE); // 恢复的 5 分钟超时仍在生效
+    EXPECT_EQ(info.lastStatusReport, "warmer");
+    EXPECT_EQ(info.attributes.number(*IOT_NS::AttributeKeys::instance().find("wal_temp")), 23.0);
+    EXPECT_EQ(info.attributes.size(), 1u);
+    ASSERT_TRUE(restarted->getDeviceInfo("wal-2", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::OFFLINE);
+    EXPECT_FALSE(restarted->registerDevice("wal-1"));
+
+    // 损坏的尾部被截掉，之后的追加在重启后仍可读出
+    EXPECT_TRUE(restarted->registerDevice("wal-3"));
+    restarted->shutdown();
+    restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    EXPECT_FALSE(restarted->registerDevice("wal-3"));
+    EXPECT_TRUE(restarted->getDeviceInfo("wal-1", info));
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+}
+
+TEST_F(DeviceManagerTest, WriteAheadLog_SyncCommitsConcurrentWriters) {
+    IOT_NS::DeviceManagerOptions options;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("wal-sync");
+    options.walDurability = IOT_NS::WalDurability::Sync;
+    manager->configure(options);
+
+    // Sync 级别下每次调用返回时记录已落盘，并发写入方共享 fdatasync
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([this, t]() {
+            for (int i = 0; i < 50; ++i) {
+                auto id = "wal-s" + std::to_string(t) + "-" + std::to_string(i);
+                manager->registerDevice(id);
+                manager->reportStatus(id, "ok", { { "wal_seq", std::to_string(i) } });
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    manager->shutdown();
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    IOT_NS::DeviceQuery query;
+    query.countOnly = true;
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 200u);
+    query.attributes = { { "wal_seq", IOT_NS::AttributeFilter::Op::Ge, 49 } };
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 4u);
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+}
+
+// 测试用例：日志写入失败后调用方得到错误且日志拒绝追加，快照轮转后恢复写入
+TEST_F(DeviceManagerTest, WriteAheadLog_WriteErrorIsStickyUntilRotation) {
+    IOT_NS::DeviceManagerOptions options;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("wal-error");
+    options.snapshotPath = walTestPath("wal-error-image");
+    options.snapshotInterval = 0ms;
+    options.walDurability = IOT_NS::WalDurability::Sync;
+    manager->configure(options);
+    ASSERT_TRUE(manager->registerDevice("walerr-1"));
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = { { "walerr-1", "before", 0, {} } };
+    EXPECT_TRUE(manager->reportStatusBatch(updates).empty());
+    EXPECT_FALSE(manager->storageFailed());
+
+    // 把日志文件描述符换成 /dev/full，之后的写入都以 ENOSPC 失败
+    int full = ::open("/dev/full", O_WRONLY | O_CLOEXEC);
+    ASSERT_GE(full, 0);
+    auto walFile = std::filesystem::canonical(options.walPath);
+    int walFd = -1;
+    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fd")) {
+        std::error_code ec;
+        if (std::filesystem::read_symlink(entry.path(), ec) == walFile) {
+            walFd = std::stoi(entry.path().filename().string());
+        }
+    }
+    ASSERT_GE(walFd, 0);
+    ASSERT_EQ(::dup2(full, walFd), walFd);
+    ::close(full);
+
+    updates = { { "walerr-1", "lost", 0, {} } };
+    EXPECT_EQ(manager->reportStatusBatch(updates), std::vector<uint32_t> { 0 });
+    EXPECT_TRUE(manager->storageFailed());
+    updates = { { "walerr-1", "refused", 0, {} } };
+    EXPECT_EQ(manager->reportStatusBatch(updates), std::vector<uint32_t> { 0 }); // 轮转前一律拒绝
+    EXPECT_FALSE(manager->setDeviceOwner("walerr-1", "walerr-owner"));
+    EXPECT_FALSE(manager->setHeartbeatTimeout("walerr-1", 5min));
+
+    // 关闭时的快照轮转掉损坏的日志，内存中的最新状态随快照保存
+    manager->shutdown();
+    manager.reset();
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    EXPECT_FALSE(restarted->storageFailed());
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(restarted->getDeviceInfo("walerr-1", info));
+    EXPECT_EQ(info.lastStatusReport, "refused");
+    updates = { { "walerr-1", "after", 0, {} } };
+    EXPECT_TRUE(restarted->reportStatusBatch(updates).empty());
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+    std::filesystem::remove(options.snapshotPath);
+}
+
+// 测试用例：同一设备的并发上报与上下线在日志中的顺序与内存一致；周期快照的日志轮转不会被持续写入拖住
+TEST_F(DeviceManagerTest, WriteAheadLog_ConcurrentUpdatesReplayInMemoryOrder) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("order-wal");
+    options.walDurability = IOT_NS::WalDurability::Sync;
+    options.snapshotPath = walTestPath("order-image");
+    options.snapshotInterval = 5ms;
+    manager->configure(options);
+    ASSERT_TRUE(manager->registerDevice("order-1"));
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 3; ++t) {
+        writers.emplace_back([this, t]() {
+            for (int i = 0; i < 200; ++i) {
+                auto seq = std::to_string(t * 1000 + i);
+                manager->reportStatus("order-1", "r" + seq, { { "order_seq", seq } });
+            }
+        });
+    }
+    writers.emplace_back([this]() {
+        for (int i = 0; i < 200; ++i) {
+            if (i % 2 == 0) {
+                manager->markDeviceOffline("order-1");
+            } else {
+                manager->refreshDeviceHeartbeat("order-1");
+            }
+        }
+    });
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    IOT_NS::DeviceInfo before;
+    ASSERT_TRUE(manager->getDeviceInfo("order-1", before));
+    manager.reset(); // 析构不写快照，最后的变更只在日志中
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    IOT_NS::DeviceInfo after;
+    ASSERT_TRUE(restarted->getDeviceInfo("order-1", after));
+    EXPECT_EQ(after.status, before.status);
+    EXPECT_EQ(after.lastStatusReport, before.lastStatusReport);
+    auto key = *IOT_NS::AttributeKeys::instance().find("order_seq");
+    EXPECT_EQ(after.attributes.number(key), before.attributes.number(key));
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+    std::filesystem::remove(options.snapshotPath);
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::temp_directory_path())) {
+        if (entry.path().filename().string().rfind("order-wal-", 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+TEST_F(DeviceManagerTest, Snapshot_RestoresRegistryWithLogTail) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 50ms;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("snap-wal");
+    options.snapshotPath = walTestPath("snap-image");
+    options.snapshotInterval = 0ms;
+    manager->configure(options);
+
+    ASSERT_TRUE(manager->registerDevice("snap-1"));
+    ASSERT_TRUE(manager->registerDevice("snap-2"));
+    manager->reportStatus("snap-1", "warm", { { "snap_temp", "21.5" }, { "snap_heat", "true" }, { "snap_mode", "eco" } });
+    EXPECT_TRUE(manager->setHeartbeatTimeout("snap-1", 5min));
+    manager->markDeviceOffline("snap-2");
+    manager->shutdown();
+    manager.reset();
+
+    // 关闭时写出快照，被覆盖的日志段随即删除
+    ASSERT_TRUE(std::filesystem::exists(options.snapshotPath));
+    EXPECT_FALSE(std::filesystem::exists(options.walPath + ".0"));
+
+    // 快照之后的变更只在日志中；析构不写快照，模拟崩溃
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    EXPECT_FALSE(restarted->registerDevice("snap-1"));
+    EXPECT_TRUE(restarted->registerDevice("snap-3"));
+    restarted->reportStatus("snap-2", "late", { { "snap_temp", "30" } });
+    restarted.reset();
+
+    restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(restarted->getDeviceInfo("snap-1", info));
+    EXPECT_EQ(info.status, IOT_NS::DeviceStatus::ONLINE); // 快照中的 5 分钟超时仍在生效
+    EXPECT_EQ(info.lastStatusReport, "warm");
+    ASSERT_EQ(info.attributes.size(), 3u);
+    EXPECT_EQ(info.attributes.number(*IOT_NS::AttributeKeys::instance().find("snap_temp")), 21.5);
+    EXPECT_EQ(info.attributes.get(*IOT_NS::AttributeKeys::instance().find("snap_heat")), IOT_NS::AttributeValue(true));
+    EXPECT_EQ(info.attributes.get(*IOT_NS::AttributeKeys::instance().find("snap_mode")),
+              IOT_NS::AttributeValue(std::string("eco")));
+    ASSERT_TRUE(restarted->getDeviceInfo("snap-2", info));
+    EXPECT_EQ(info.lastStatusReport, "late");
+    EXPECT_EQ(info.attributes.number(*IOT_NS::AttributeKeys::instance().find("snap_temp")), 30.0);
+    EXPECT_FALSE(restarted->registerDevice("snap-3"));
+    EXPECT_FALSE(restarted->getDeviceInfo("snap-4", info));
+
+    IOT_NS::DeviceQuery query;
+    query.countOnly = true;
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 3u);
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+    std::filesystem::remove(options.snapshotPath);
+}
+
+TEST_F(DeviceManagerTest, Snapshot_PeriodicWithoutLog) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 0ms;
+    options.snapshotPath = walTestPath("snap-periodic");
+    options.snapshotInterval = 20ms;
+    manager->configure(options);
+    for (int i = 0; i < 1000; ++i) {
+        manager->registerDevice("snap-p" + std::to_string(i));
+    }
+    manager->reportStatus("snap-p7", "seven");
+    std::this_thread::sleep_for(150ms);
+    manager.reset();
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(restarted->getDeviceInfo("snap-p7", info));
+    EXPECT_EQ(info.lastStatusReport, "seven");
+    IOT_NS::DeviceQuery query;
+    query.countOnly = true;
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 1000u);
+    restarted.reset();
+
+    // 文件头校验失败的快照被忽略，注册表从空开始
+    {
+        std::fstream image(options.snapshotPath, std::ios::binary | std::ios::in | std::ios::out);
+        image.seekp(40);
+        image.put('\x7f');
+    }
+    restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    EXPECT_FALSE(restarted->getDeviceInfo("snap-p7", info));
+    restarted.reset();
+    std::filesystem::remove(options.snapshotPath);
+}
+
+// 测试用例：快照恢复期间统计、列表与逐设备访问不等待恢复完成，结果仍覆盖快照中的全部设备
+TEST_F(DeviceManagerTest, Snapshot_QueriesServedWhileHydrating) {
+    IOT_NS::DeviceManagerOptions options;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 0ms;
+    options.snapshotPath = walTestPath("snap-hydrate");
+    options.snapshotInterval = 0ms;
+    manager->configure(options);
+    IOT_NS::DeviceHandle handle;
+    for (int i = 0; i < 3000; ++i) {
+        manager->registerDevice("snap-h" + std::to_string(i), i % 3 == 0 ? "snap-owner" : "", handle);
+    }
+    for (int i = 0; i < 3000; i += 10) {
+        manager->markDeviceOffline("snap-h" + std::to_string(i));
+    }
+    manager->shutdown();
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+
+    // 未恢复的行按快照中的状态计入；设备从快照行移入注册表的瞬间可能少计，稍后即稳定
+    IOT_NS::DeviceCounts counts;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        ASSERT_TRUE(restarted->countDevices(counts));
+        if (counts.total == 3000u) {
+            break;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(counts.total, 3000u);
+
+    IOT_NS::DeviceQuery query;
+    query.status = IOT_NS::DeviceStatus::OFFLINE;
+    query.limit = 64;
+    IOT_NS::DevicePage page;
+    size_t offline = 0;
+    do {
+        ASSERT_TRUE(restarted->listDevices(query, page));
+        offline += page.devices.size();
+        query.cursor = page.nextCursor;
+    } while (!page.nextCursor.empty());
+    EXPECT_EQ(offline, 300u);
+
+    query = {};
+    query.owner = "snap-owner";
+    query.countOnly = true;
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 1000u);
+
+    size_t visited = 0;
+    restarted->forEachDevice([&visited](const IOT_NS::DeviceSlot&) { ++visited; });
+    EXPECT_EQ(visited, 3000u);
+    ASSERT_TRUE(restarted->countDevices(counts));
+    EXPECT_EQ(counts.total, 3000u);
+    EXPECT_EQ(counts.byStatus[static_cast<size_t>(IOT_NS::DeviceStatus::OFFLINE)], 300u);
+    restarted->shutdown();
+    std::filesystem::remove(options.snapshotPath);
+}
+
+TEST_F(DeviceManagerTest, TimeSeries_CompressesAndRoundTrips) {
+    IOT_NS::TimeSeries series(120);
+    std::mt19937 random(46);
+    std::uniform_int_distribution<int> jitter(-20, 20);
+    std::vector<std::pair<int64_t, double>> samples;
+    int64_t timestamp = 1'750'000'000'000;
+    double temperature = 21.5;
+    for (int i = 0; i < 1000; ++i) {
+        timestamp += 10'000 + jitter(random);
+        if (i % 10 == 0) {
+            temperature += jitter(random) / 10.0;
+        }
+        samples.emplace_back(timestamp, temperature);
+        series.append(timestamp, temperature);
+    }
+    series.append(timestamp - 5000, 0.1); // 乱序样本按上一个样本的时间记录
+    samples.emplace_back(timestamp, 0.1);
+
+    std::vector<std::pair<int64_t, double>> decoded;
+    series.range(0, INT64_MAX, [&decoded](int64_t ts, double value) { decoded.emplace_back(ts, value); });
+    EXPECT_EQ(decoded, samples);
+    EXPECT_EQ(series.size(), samples.size());
+    EXPECT_LT(series.memoryUsage() / samples.size(), 8u) << "bytes per sample";
+
+    decoded.clear();
+    series.range(samples[500].first, samples[509].first,
+                 [&decoded](int64_t ts, double value) { decoded.emplace_back(ts, value); });
+    ASSERT_EQ(decoded.size(), 10u);
+    EXPECT_EQ(decoded.front(), samples[500]);
+
+    series.expire(samples[600].first);
+    EXPECT_EQ(series.size(), 401u); // 只淘汰整个数据块
+    series.expire(timestamp + 1);
+    EXPECT_TRUE(series.empty());
+}
+
+TEST_F(DeviceManagerTest, History_RangeAndDownsample) {
+    IOT_NS::DeviceManagerOptions options;
+    options.historyRetention = 1h;
+    options.historyChunkSamples = 4;
+    manager->configure(options);
+    ASSERT_TRUE(manager->registerDevice("hist-1"));
+    auto start = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+    for (int i = 1; i <= 10; ++i) {
+        manager->reportStatus("hist-1", "ok",
+                              { { "hist_temp", std::to_string(i) }, { "hist_on", i % 2 ? "true" : "false" },
+                                { "hist_mode", "eco" } });
+    }
+
+    IOT_NS::HistoryQuery query { "hist-1", "hist_temp", start };
+    std::vector<IOT_NS::HistoryPoint> points;
+    ASSERT_TRUE(manager->getDeviceHistory(query, points));
+    ASSERT_EQ(points.size(), 10u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(points[i].value, i + 1);
+        EXPECT_EQ(points[i].count, 1u);
+    }
+
+    query.step = 1h;
+    ASSERT_TRUE(manager->getDeviceHistory(query, points));
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(points[0].timestampMs, start);
+    EXPECT_DOUBLE_EQ(points[0].value, 5.5);
+    EXPECT_EQ(points[0].min, 1);
+    EXPECT_EQ(points[0].max, 10);
+    EXPECT_EQ(points[0].count, 10u);
+
+    query = { "hist-1", "hist_on", start };
+    ASSERT_TRUE(manager->getDeviceHistory(query, points));
+    ASSERT_EQ(points.size(), 10u);
+    EXPECT_EQ(points[0].value, 1);
+    EXPECT_EQ(points[1].value, 0);
+
+    query = { "hist-1", "hist_mode", start }; // 字符串属性不记录
+    ASSERT_TRUE(manager->getDeviceHistory(query, points));
+    EXPECT_TRUE(points.empty());
+    query = { "hist-1", "hist_temp", 0, start - 1 };
+    ASSERT_TRUE(manager->getDeviceHistory(query, points));
+    EXPECT_TRUE(points.empty());
+    query = { "hist-missing", "hist_temp" };
+    EXPECT_FALSE(manager->getDeviceHistory(query, points));
+}
+
+TEST_F(DeviceManagerTest, SecondaryIndexes_CountsAndStatusListing) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 10ms;
+    options.heartbeatClasses = { { "idx-fast-", 40ms } };
+    manager->configure(options);
+
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_TRUE(manager->registerDevice("idx-" + std::to_string(i)));
+    }
+    for (int i = 0; i < 300; i += 3) {
+        manager->markDeviceOffline("idx-" + std::to_string(i));
+    }
+    manager->markDeviceOffline("idx-0"); // 重复下线不重复计数
+    IOT_NS::DeviceCounts counts;
+    ASSERT_TRUE(manager->countDevices(counts));
+    EXPECT_EQ(counts.total, 300u);
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::ONLINE), 200u);
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::OFFLINE), 100u);
+
+    // 按状态分页遍历位图，每个设备恰好出现一次
+    IOT_NS::DeviceQuery query;
+    query.status = IOT_NS::DeviceStatus::OFFLINE;
+    query.limit = 7;
+    std::vector<std::string> seen;
+    IOT_NS::DevicePage page;
+    do {
+        ASSERT_TRUE(manager->listDevices(query, page));
+        for (const auto& record : page.devices) {
+            EXPECT_EQ(record.info.status, IOT_NS::DeviceStatus::OFFLINE);
+            seen.push_back(record.deviceId);
+        }
+        query.cursor = page.nextCursor;
+    } while (!page.nextCursor.empty());
+    std::sort(seen.begin(), seen.end());
+    EXPECT_EQ(std::unique(seen.begin(), seen.end()), seen.end());
+    EXPECT_EQ(seen.size(), 100u);
+
+    query = {};
+    query.status = IOT_NS::DeviceStatus::ONLINE;
+    query.countOnly = true;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 200u);
+    query.cursor = "#x";
+    EXPECT_FALSE(manager->listDevices(query, page));
+
+    // 心跳与超时扫描引起的状态变化同样反映在计数中
+    manager->refreshDeviceHeartbeat("idx-3");
+    ASSERT_TRUE(manager->registerDevice("idx-fast-1"));
+    ASSERT_TRUE(manager->countDevices(counts));
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::ONLINE), 202u);
+    std::this_thread::sleep_for(150ms);
+    ASSERT_TRUE(manager->countDevices(counts));
+    EXPECT_EQ(counts.total, 301u);
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::ONLINE), 201u);
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::OFFLINE), 100u);
+}
+
+TEST_F(DeviceManagerTest, SecondaryIndexes_OwnersPersistAcrossRestart) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("owner-wal");
+    options.snapshotPath = walTestPath("owner-image");
+    options.snapshotInterval = 0ms;
+    manager->configure(options);
+
+    IOT_NS::DeviceHandle handle;
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(manager->registerDevice("own-" + std::to_string(i), i % 2 ? "alice" : "bob", handle));
+    }
+    ASSERT_TRUE(manager->registerDevice("own-free"));
+    // 已绑定的设备不会被再次注册的用户认领，未绑定的设备则被认领
+    EXPECT_FALSE(manager->registerDevice("own-1", "bob", handle));
+    EXPECT_FALSE(manager->registerDevice("own-free", "carol", handle));
+    EXPECT_TRUE(manager->setDeviceOwner("own-3", "carol"));
+    EXPECT_FALSE(manager->setDeviceOwner("own-none", "carol"));
+
+    auto owned = [](IOT_DEVICE_NS::IDeviceManager& devices, const std::string& owner) {
+        IOT_NS::DeviceQuery query;
+        query.owner = owner;
+        query.limit = 4;
+        std::vector<std::string> ids;
+        IOT_NS::DevicePage page;
+        do {
+            EXPECT_TRUE(devices.listDevices(query, page));
+            for (const auto& record : page.devices) {
+                EXPECT_EQ(record.info.owner, owner);
+                ids.push_back(record.deviceId);
+            }
+            query.cursor = page.nextCursor;
+        } while (!page.nextCursor.empty());
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+    EXPECT_EQ(owned(*manager, "alice").size(), 9u);
+    EXPECT_EQ(owned(*manager, "bob").size(), 10u);
+    EXPECT_EQ(owned(*manager, "carol"), (std::vector<std::string> { "own-3", "own-free" }));
+    EXPECT_TRUE(owned(*manager, "dave").empty());
+    manager->shutdown();
+    manager.reset();
+
+    // 快照恢复所有者列，之后的重新绑定只在日志中
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    EXPECT_EQ(owned(*restarted, "carol"), (std::vector<std::string> { "own-3", "own-free" }));
+    EXPECT_TRUE(restarted->setDeviceOwner("own-free", "dave"));
+    restarted.reset();
+
+    restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(restarted->getDeviceInfo("own-free", info));
+    EXPECT_EQ(info.owner, "dave");
+    EXPECT_EQ(owned(*restarted, "carol"), (std::vector<std::string> { "own-3" }));
+    EXPECT_EQ(owned(*restarted, "alice").size(), 9u);
+    IOT_NS::DeviceCounts counts;
+    ASSERT_TRUE(restarted->countDevices(counts));
+    EXPECT_EQ(counts.total, 21u);
+    restarted->shutdown();
+    std::filesystem::remove(options.walPath);
+    std::filesystem::remove(options.snapshotPath);
+}
+
+TEST_F(DeviceManagerTest, RegisterDevices_BulkDeduplicatesAndPersists) {
+    IOT_NS::DeviceManagerOptions options;
+    options.shardCount = 4;
+    options.heartbeatTimeout = 5min;
+    options.expiryTick = 0ms;
+    options.walPath = walTestPath("bulk-wal");
+    manager->configure(options);
+
+    std::atomic<int> online { 0 };
+    std::atomic<int> resyncs { 0 };
+    manager->setEventListener([&online, &resyncs](const IOT_NS::DeviceEvent& event) {
+        if (event.type == IOT_NS::DeviceEvent::Type::Online) {
+            online.fetch_add(1, std::memory_order_relaxed);
+        } else if (event.type == IOT_NS::DeviceEvent::Type::Resync) {
+            resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    ASSERT_TRUE(manager->registerDevice("bulk-1"));
+    IOT_NS::DeviceHandle handle;
+    ASSERT_TRUE(manager->registerDevice("bulk-2", "alice", handle));
+
+    // 跨越多块的批次：批次内重复、空 ID 与已注册的设备都被计入各自的统计
+    std::vector<IOT_NS::DeviceRegistration> devices;
+    for (int i = 0; i < 5000; ++i) {
+        devices.push_back({ "bulk-" + std::to_string(i), i % 2 ? "carol" : "" });
+    }
+    devices.push_back({ "bulk-7", "dave" });
+    devices.push_back({ "", "nobody" });
+    devices.push_back({ "bulk-1", "bob" });
+    devices.push_back({ "bulk-2", "bob" });
+    IOT_NS::DeviceImportResult result;
+    ASSERT_TRUE(manager->registerDevices(devices, result));
+    EXPECT_EQ(result.registered, 4998u);
+    EXPECT_EQ(result.existing, 2u);
+    EXPECT_EQ(result.duplicates, 3u);
+    EXPECT_EQ(result.rejected, 1u);
+    EXPECT_EQ(online.load(), 2); // 批量注册不逐个发出上线事件，只发出一个 Resync
+    EXPECT_EQ(resyncs.load(), 1);
+    manager->setEventListener(nullptr);
+
+    // 新设备已分配句柄并计入全部索引；已有设备只在未绑定时被认领
+    IOT_NS::DeviceInfo info;
+    ASSERT_TRUE(manager->getDeviceInfo(manager->acquireHandle("bulk-4321"), info));
+    EXPECT_EQ(info.owner, "carol");
+    ASSERT_TRUE(manager->getDeviceInfo("bulk-7", info));
+    EXPECT_EQ(info.owner, "carol");
+    ASSERT_TRUE(manager->getDeviceInfo("bulk-1", info));
+    EXPECT_EQ(info.owner, "carol");
+    ASSERT_TRUE(manager->getDeviceInfo("bulk-2", info));
+    EXPECT_EQ(info.owner, "alice");
+    IOT_NS::DeviceCounts counts;
+    ASSERT_TRUE(manager->countDevices(counts));
+    EXPECT_EQ(counts.of(IOT_NS::DeviceStatus::ONLINE), 5000u);
+    IOT_NS::DeviceQuery query;
+    query.owner = "carol";
+    query.countOnly = true;
+    IOT_NS::DevicePage page;
+    ASSERT_TRUE(manager->listDevices(query, page));
+    EXPECT_EQ(page.count, 2500u);
+    EXPECT_FALSE(manager->registerDevice("bulk-4999"));
+    manager.reset();
+
+    auto restarted = IOT_DEVICE_NS::DeviceManagerFactory::instance().create(DEVICE_MANAGER_DEFAULT);
+    restarted->configure(options);
+    ASSERT_TRUE(restarted->countDevices(counts));
+    EXPECT_EQ(counts.total, 5000u);
+    ASSERT_TRUE(restarted->getDeviceInfo("bulk-1", info));
+    EXPECT_EQ(info.owner, "carol");
+    ASSERT_TRUE(restarted->listDevices(query, page));
+    EXPECT_EQ(page.count, 2500u);
+
+    // 全部已注册的批次不再写入任何记录
+    auto logged = std::filesystem::file_size(options.walPath);
+    ASSERT_TRUE(restarted->registerDevices(devices, result));
+    EXPECT_EQ(result.registered, 0u);
+    EXPECT_EQ(result.existing, 5000u);
+    restarted->shutdown();
+    EXPECT_EQ(std::filesystem::file_size(options.walPath), logged);
+    restarted.reset();
+    std::filesystem::remove(options.walPath);
+}
+
+TEST(DeviceImportFileTest, ParsesCsvAndBinary) {
+    std::vector<IOT_NS::DeviceRegistration> devices;
+    auto malformed = IOT_NS::DeviceImportFile::parseCsv("device_id,owner\r\n"
+                                                        "# comment\n"
+                                                        "dev-1\n"
+                                                        " dev-2 , alice \r\n"
+                                                        "\n"
+                                                        "dev-3,a,b\n"
+                                                        "dev-4,",
+                                                        devices);
+    EXPECT_EQ(malformed, 1u);
+    ASSERT_EQ(devices.size(), 3u);
+    EXPECT_EQ(devices[0].deviceId, "dev-1");
+    EXPECT_TRUE(devices[0].owner.empty());
+    EXPECT_EQ(devices[1].deviceId, "dev-2");
+    EXPECT_EQ(devices[1].owner, "alice");
+    EXPECT_EQ(devices[2].deviceId, "dev-4");
+
+    // 二进制格式往返一致；截断的数据返回 false，截断前的设备保留
+    auto data = IOT_NS::DeviceImportFile::encodeBinary(devices);
+    std::vector<IOT_NS::DeviceRegistration> decoded;
+    ASSERT_TRUE(IOT_NS::DeviceImportFile::parseBinary(data, decoded));
+    ASSERT_EQ(decoded.size(), 3u);
+    EXPECT_EQ(decoded[1].deviceId, "dev-2");
+    EXPECT_EQ(decoded[1].owner, "alice");
+    decoded.clear();
+    EXPECT_FALSE(IOT_NS::DeviceImportFile::parseBinary(std::string_view(data).substr(0, data.size() - 1), decoded));
+    EXPECT_EQ(decoded.size(), 2u);
+    EXPECT_FALSE(IOT_NS::DeviceImportFile::parseBinary("dev-1\n", decoded));
+
+    // 读取文件时按魔数区分格式
+    auto path = (std::filesystem::temp_directory_path() / ("import-" + std::to_string(::getpid()) + ".bin")).string();
+    std::ofstream(path, std::ios::binary) << data;
+    decoded.clear();
+    size_t skipped = 0;
+    ASSERT_TRUE(IOT_NS::DeviceImportFile::load(path, decoded, skipped));
+    EXPECT_EQ(decoded.size(), 3u);
+    std::ofstream(path, std::ios::binary) << "dev-9,bob\n";
+    decoded.clear();
+    ASSERT_TRUE(IOT_NS::DeviceImportFile::load(path, decoded, skipped));
+    ASSERT_EQ(decoded.size(), 1u);
+    EXPECT_EQ(decoded[0].owner, "bob");
+    std::filesystem::remove(path);
+    EXPECT_FALSE(IOT_NS::DeviceImportFile::load(path, decoded, skipped));
+}
@@ -0,0 +1,210 @@
+#include "CommandTracker.h"
+#include "common/TimingWheel.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class CommandTrackerTest : public ::testing::Test {
+protected:
+    using Clock = IOT_NS::CommandTracker::Clock;
+
+    /**
+     * @brief 取出设备下行队列中的全部命令
+     */
+    auto drain(const std::string& deviceId) -> std::vector<IOT_NS::OutboundCommand> {
+        std::vector<IOT_NS::OutboundCommand> batch;
+        outbox.attach(deviceId)->waitAndDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH, 0ms);
+        return batch;
+    }
+
+    IOT_NS::CommandOutbox outbox;
+    IOT_NS::CommandRetryPolicy policy { 1000ms, 200ms, 1000ms, 3, 5000ms };
+    IOT_NS::CommandTracker tracker { outbox, policy };
+    Clock::time_point start = Clock::now();
+};
+
+// 测试用例：时间轮定时器不会提前触发，跨圈定时器在正确的圈次触发
+TEST(TimingWheelTest, FiresOnDeadlineIncludingWrappedTimers) {
+    auto start = std::chrono::steady_clock::now();
+    IOT_NS::TimingWheel<int> wheel { 10ms, 8, start };
+    wheel.schedule(start + 25ms, 1);
+    wheel.schedule(start + 125ms, 2); // 超过一圈（80ms）
+
+    std::vector<int> fired;
+    auto collect = [&](int value) { fired.push_back(value); };
+    EXPECT_EQ(wheel.advance(start + 20ms, collect), 0u);
+    EXPECT_EQ(wheel.advance(start + 30ms, collect), 1u);
+    EXPECT_EQ(wheel.advance(start + 120ms, collect), 0u);
+    EXPECT_EQ(wheel.advance(start + 500ms, collect), 1u);
+    EXPECT_EQ(fired, (std::vector<int> { 1, 2 }));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+// 测试用例：未回执的命令按退避重发，重试耗尽后超时
+TEST_F(CommandTrackerTest, RetriesWithBackoffThenTimesOut) {
+    auto stream = outbox.subscribe("dev-a");
+    auto receipt = tracker.submit("dev-a", IOT_NS::OutboundCommand { "open", {}, 0 });
+    ASSERT_TRUE(receipt.accepted);
+    EXPECT_EQ(drain("dev-a").size(), 1u);
+
+    tracker.tick(start + 1100ms); // 回执超时，进入 200ms 退避
+    EXPECT_TRUE(drain("dev-a").empty());
+    tracker.tick(start + 1400ms); // 退避结束，第二次发送
+    auto resent = drain("dev-a");
+    ASSERT_EQ(resent.size(), 1u);
+    EXPECT_EQ(resent[0].commandId, receipt.commandId);
+    EXPECT_EQ(tracker.status(receipt.commandId)->attempts, 2u);
+
+    tracker.tick(start + 2500ms); // 第二次超时，进入 400ms 退避
+    tracker.tick(start + 3000ms); // 第三次发送
+    EXPECT_EQ(drain("dev-a").size(), 1u);
+    tracker.tick(start + 4100ms); // 重试耗尽
+
+    auto status = tracker.status(receipt.commandId);
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(status->state, IOT_NS::CommandState::TimedOut);
+    EXPECT_EQ(status->attempts, 3u);
+
+    tracker.tick(start + 10000ms); // 保留期过后记录被清理
+    EXPECT_FALSE(tracker.status(receipt.commandId).has_value());
+}
+
+// 测试用例：回执后不再重发，失败回执进入失败终态
+TEST_F(CommandTrackerTest, AckStopsRetries) {
+    auto acked = tracker.submit("dev-b", IOT_NS::OutboundCommand { "open", {}, 0 });
+    auto failed = tracker.submit("dev-b", IOT_NS::OutboundCommand { "close", {}, 0 });
+    drain("dev-b");
+
+    EXPECT_TRUE(tracker.acknowledge("dev-b", acked.commandId, 0, "done"));
+    EXPECT_TRUE(tracker.acknowledge("dev-b", failed.commandId, 7, "jammed"));
+    tracker.tick(start + 3000ms);
+
+    EXPECT_TRUE(drain("dev-b").empty());
+    EXPECT_EQ(tracker.status(acked.commandId)->state, IOT_NS::CommandState::Acked);
+    EXPECT_EQ(tracker.status(failed.commandId)->state, IOT_NS::CommandState::Failed);
+    EXPECT_EQ(tracker.status(failed.commandId)->code, 7);
+}
+
+// 测试用例：等待者在回执到达时被唤醒
+TEST_F(CommandTrackerTest, AwaitWakesOnAck) {
+    auto receipt = tracker.submit("dev-c", IOT_NS::OutboundCommand { "open", {}, 0 });
+    std::thread acker([&]() {
+        std::this_thread::sleep_for(20ms);
+        tracker.acknowledge("dev-c", receipt.commandId, 0, "done");
+    });
+
+    auto status = tracker.await(receipt.commandId, 2000ms);
+    acker.join();
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(status->state, IOT_NS::CommandState::Acked);
+}
+
+// 测试用例：非阻塞等待者在回执到达或等待超时时被回调
+TEST_F(CommandTrackerTest, WatchCompletesOnAckOrTimeout) {
+    auto acked = tracker.submit("dev-d", IOT_NS::OutboundCommand { "open", {}, 0 });
+    auto silent = tracker.submit("dev-d", IOT_NS::OutboundCommand { "close", {}, 0 });
+
+    std::optional<IOT_NS::CommandStatus> ackedStatus;
+    std::optional<IOT_NS::CommandStatus> silentStatus;
+    bool silentCalled = false;
+    tracker.watch(acked.commandId, 500ms, [&](const auto& status) { ackedStatus = status; });
+    tracker.watch(silent.commandId, 100ms, [&](const auto& status) {
+        silentCalled = true;
+        silentStatus = status;
+    });
+
+    EXPECT_TRUE(tracker.acknowledge("dev-d", acked.commandId, 0, "done"));
+    ASSERT_TRUE(ackedStatus.has_value());
+    EXPECT_EQ(ackedStatus->state, IOT_NS::CommandState::Acked);
+
+    EXPECT_FALSE(silentCalled);
+    tracker.tick(Clock::now() + 200ms);
+    EXPECT_TRUE(silentCalled);
+    ASSERT_TRUE(silentStatus.has_value());
+    EXPECT_FALSE(IOT_NS::CommandTracker::isTerminal(silentStatus->state));
+
+    // 未知命令立即回调 std::nullopt
+    bool unknownCalled = false;
+    tracker.watch(12345, 100ms, [&](const auto& status) { unknownCalled = !status.has_value(); });
+    EXPECT_TRUE(unknownCalled);
+}
+
+// 测试用例：设备未订阅时重试暂停而不重复入队，重新订阅后恢复；未恢复的命令在暂停超时后超时
+TEST_F(CommandTrackerTest, ParksRetriesWhileUnsubscribed) {
+    auto delivered = tracker.submit("dev-e", IOT_NS::OutboundCommand { "open", {}, 0 });
+    EXPECT_EQ(drain("dev-e").size(), 1u);
+    tracker.markDelivered(delivered.commandId);
+    auto queued = tracker.submit("dev-e", IOT_NS::OutboundCommand { "close", {}, 0 });
+    auto abandoned = tracker.submit("dev-f", IOT_NS::OutboundCommand { "open", {}, 0 });
+    drain("dev-f");
+
+    tracker.tick(start + 1100ms); // 回执超时，进入退避
+    tracker.tick(start + 1400ms); // 退避结束，设备未订阅，暂停
+    tracker.tick(start + 5000ms);
+    EXPECT_TRUE(drain("dev-f").empty());
+    EXPECT_EQ(tracker.status(delivered.commandId)->attempts, 1u);
+    EXPECT_EQ(tracker.status(delivered.commandId)->state, IOT_NS::CommandState::Delivered);
+
+    // 重新订阅：已送达的命令重发，仍在队列中的命令不重复入队
+    auto stream = outbox.subscribe("dev-e");
+    tracker.resume("dev-e");
+    auto resent = drain("dev-e");
+    ASSERT_EQ(resent.size(), 2u);
+    EXPECT_EQ(resent[0].commandId, queued.commandId);
+    EXPECT_EQ(resent[1].commandId, delivered.commandId);
+    EXPECT_EQ(tracker.status(delivered.commandId)->attempts, 2u);
+    EXPECT_EQ(tracker.status(queued.commandId)->attempts, 1u);
+
+    tracker.tick(start + 61500ms); // 暂停超时
+    EXPECT_EQ(tracker.status(abandoned.commandId)->state, IOT_NS::CommandState::TimedOut);
+    EXPECT_EQ(tracker.status(abandoned.commandId)->attempts, 1u);
+    EXPECT_TRUE(drain("dev-f").empty());
+}
+
+// 测试用例：暂停或重试耗尽而超时的命令从设备队列中撤回，设备之后订阅也不会收到
+TEST_F(CommandTrackerTest, TimedOutCommandsLeaveTheOutbox) {
+    auto parked = tracker.submit("dev-g", IOT_NS::OutboundCommand { "open", {}, 0 });
+    auto stream = outbox.subscribe("dev-h");
+    auto stuck = tracker.submit("dev-h", IOT_NS::OutboundCommand { "open", {}, 0 });
+    for (auto at : { 1100ms, 1400ms, 2500ms, 3000ms, 4100ms }) {
+        tracker.tick(start + at);
+    }
+
+    // 投递流一直没有取出的命令重试耗尽后超时并被撤回
+    EXPECT_EQ(tracker.status(stuck.commandId)->state, IOT_NS::CommandState::TimedOut);
+    EXPECT_TRUE(drain("dev-h").empty());
+    EXPECT_FALSE(tracker.acknowledge("dev-h", stuck.commandId, 0, "late"));
+
+    // 设备未订阅而暂停的命令在暂停超时后被撤回，空闲队列一并回收
+    EXPECT_TRUE(outbox.pending("dev-g", parked.commandId));
+    tracker.tick(start + 61500ms);
+    EXPECT_EQ(tracker.status(parked.commandId)->state, IOT_NS::CommandState::TimedOut);
+    EXPECT_FALSE(outbox.pending("dev-g", parked.commandId));
+    EXPECT_EQ(outbox.outboxCount(), 1u); // 只剩仍有投递流的 dev-h
+    EXPECT_TRUE(drain("dev-g").empty());
+}
+
+// 测试用例：上一份副本仍在队列中时重试不重复入队；回执到达时撤回尚未取出的重发副本
+TEST_F(CommandTrackerTest, NoResendWhilePreviousCopyIsQueued) {
+    auto stream = outbox.subscribe("dev-i");
+    auto receipt = tracker.submit("dev-i", IOT_NS::OutboundCommand { "open", {}, 0 });
+    tracker.tick(start + 1100ms); // 回执超时，投递流尚未取出
+    tracker.tick(start + 1400ms); // 退避结束，不再入队第二份
+    auto batch = drain("dev-i");
+    ASSERT_EQ(batch.size(), 1u);
+    EXPECT_EQ(batch[0].commandId, receipt.commandId);
+    EXPECT_EQ(tracker.status(receipt.commandId)->attempts, 2u);
+
+    tracker.tick(start + 2500ms); // 已取出仍未回执，进入退避
+    tracker.tick(start + 3000ms); // 重发
+    EXPECT_TRUE(outbox.pending("dev-i", receipt.commandId));
+    EXPECT_TRUE(tracker.acknowledge("dev-i", receipt.commandId, 0, "done")); // 首次发送的回执迟到
+    EXPECT_TRUE(drain("dev-i").empty());
+    EXPECT_EQ(tracker.status(receipt.commandId)->state, IOT_NS::CommandState::Acked);
+}
@@ -1,8 +1,16 @@
 #include "MessageRouter.h"
+#include "StreamWriteState.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
 #include <gtest/gtest.h>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 class MessageRouterTest : public ::testing::Test {
 protected:
@@ -14,7 +22,32 @@ protected:
         // 可选：清理资源
     }
 
-    IOT_NS::MessageRouter router;
+    /**
+     * @brief 创建配置了凭据文件的路由器，默认用户管理器只接受 user005、user015、user016 各自的令牌
+     */
+    static auto strictRouter() -> std::unique_ptr<IOT_NS::MessageRouter> {
+        std::string path = testing::TempDir() + "router-credentials.txt";
+        {
+            std::ofstream file(path);
+            file << "user005:token005\nuser015:token015\nuser016:token016\n";
+        }
+        IOT_NS::RouterOptions options;
+        options.user.credentialsFile = path;
+        auto strict = std::make_unique<IOT_NS::MessageRouter>(USER_MANAGER_DEFAULT, options);
+        std::remove(path.c_str()); // 凭据在构造时已加载
+        return strict;
+    }
+
+    /**
+     * @brief 显式开放模式的路由器参数：默认用户管理器未配置凭据时接受任意非空用户ID
+     */
+    static auto insecureOptions() -> IOT_NS::RouterOptions {
+        IOT_NS::RouterOptions options;
+        options.user.insecure = true;
+        return options;
+    }
+
+    IOT_NS::MessageRouter router { MESSAGE_ROUTER_USER_MANAGER, insecureOptions() };
 };
 
 // 测试用例：处理用户指令
@@ -59,3 +92,973 @@ TEST_F(MessageRouterTest, HandleDisconnect_ShouldNotThrow) {
 
     EXPECT_NO_THROW(router.handleDisconnect(deviceId));
 }
+
+// 测试用例：默认用户管理器未配置凭据时拒绝所有用户，显式开放模式放行非空用户，配置凭据后按令牌校验会话与查询
+TEST_F(MessageRouterTest, DefaultUserManager_ClosedUntilCredentialsConfigured) {
+    IOT_NS::MessageRouter closed { USER_MANAGER_DEFAULT };
+    EXPECT_FALSE(closed.openSession("device018", "user018", "any-token")->authenticated);
+    IOT_NS::DeviceCounts closedCounts;
+    EXPECT_EQ(closed.countDevices("user018", "any-token", closedCounts), IOT_NS::DeviceQueryStatus::Unauthenticated);
+
+    auto session = router.openSession("device018", "user018", "any-token");
+    ASSERT_TRUE(session->authenticated);
+    EXPECT_TRUE(router.handleHeartbeat(*session));
+    EXPECT_FALSE(router.openSession("device018", "", "any-token")->authenticated);
+
+    auto strict = strictRouter();
+    EXPECT_TRUE(strict->openSession("device018", "user016", "token016")->authenticated);
+    EXPECT_FALSE(strict->openSession("device018", "user016", "token015")->authenticated);
+    EXPECT_FALSE(strict->openSession("device018", "user018", "any-token")->authenticated);
+    IOT_NS::DeviceCounts counts;
+    EXPECT_EQ(strict->countDevices("user016", "wrong", counts), IOT_NS::DeviceQueryStatus::Unauthenticated);
+    EXPECT_EQ(strict->countDevices("user016", "token016", counts), IOT_NS::DeviceQueryStatus::Ok);
+}
+
+// 测试用例：心跳流会话鉴权通过后走快速路径
+TEST_F(MessageRouterTest, OpenSession_ValidToken_HeartbeatFastPath) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+
+    auto session = mockRouter.openSession("device004", "user004", "token004");
+
+    ASSERT_NE(session, nullptr);
+    EXPECT_TRUE(session->authenticated);
+    EXPECT_FALSE(session->expired());
+    ASSERT_TRUE(IOT_NS::isValid(session->handle)); // 首次出现的设备在建立会话时注册并缓存句柄
+    EXPECT_TRUE(mockRouter.handleHeartbeat(*session));
+    EXPECT_TRUE(mockRouter.handleHeartbeat(*session));
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    ASSERT_TRUE(mockRouter.getDevices("user004", "token004", { "device004" }, found, missing));
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].info.status, IOT_NS::DeviceStatus::ONLINE);
+}
+
+// 测试用例：鉴权失败的会话拒绝心跳
+TEST_F(MessageRouterTest, OpenSession_InvalidToken_RejectsHeartbeat) {
+    auto strict = strictRouter();
+
+    auto session = strict->openSession("device005", "user005", "bad-token");
+
+    ASSERT_NE(session, nullptr);
+    EXPECT_FALSE(session->authenticated);
+    EXPECT_FALSE(strict->handleHeartbeat(*session));
+}
+
+// 测试用例：会话过期后快速路径拒绝心跳，需要重新建立会话
+TEST_F(MessageRouterTest, HandleHeartbeat_ExpiredSession_Rejected) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+
+    auto session = mockRouter.openSession("device006", "user006", "token006");
+    session->expiresAt = IOT_NS::StreamSession::Clock::now() - std::chrono::seconds(1);
+
+    EXPECT_TRUE(session->expired());
+    EXPECT_FALSE(mockRouter.handleHeartbeat(*session));
+}
+
+// 测试用例：命令进入设备下行队列，并按批次取出
+TEST_F(MessageRouterTest, HandleCommand_QueuesForSubscribedDevice) {
+    std::string deviceId = "device007";
+    ASSERT_TRUE(router.openSession(deviceId, "user007", "token007")->authenticated);
+    auto outbox = router.attachOutbox(deviceId);
+
+    EXPECT_EQ(router.handleCommand(deviceId, "open", "user007", "token007", { { "mode", "safe" } }), "Command accepted");
+    EXPECT_EQ(router.handleCommand(deviceId, "close", "user007", "token007"), "Command accepted");
+
+    std::vector<IOT_NS::OutboundCommand> batch;
+    ASSERT_EQ(outbox->waitAndDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH, std::chrono::milliseconds(0)), 2u);
+    EXPECT_EQ(batch[0].command, "open");
+    EXPECT_EQ(batch[0].params.at("mode"), "safe");
+    EXPECT_EQ(batch[1].command, "close");
+}
+
+// 测试用例：下行队列满时拒绝命令，放回的命令保持原有顺序
+TEST_F(MessageRouterTest, DeviceOutbox_BoundedAndRequeuePreservesOrder) {
+    IOT_NS::DeviceOutbox outbox { 2 };
+    EXPECT_TRUE(outbox.push({ "a", {}, 0 }));
+    EXPECT_TRUE(outbox.push({ "b", {}, 0 }));
+    EXPECT_FALSE(outbox.push({ "c", {}, 0 }));
+
+    std::vector<IOT_NS::OutboundCommand> batch;
+    ASSERT_EQ(outbox.waitAndDrain(batch, 1, std::chrono::milliseconds(0)), 1u);
+    outbox.requeue(batch);
+    EXPECT_TRUE(batch.empty());
+
+    ASSERT_EQ(outbox.waitAndDrain(batch, 8, std::chrono::milliseconds(0)), 2u);
+    EXPECT_EQ(batch[0].command, "a");
+    EXPECT_EQ(batch[1].command, "b");
+}
+
+// 测试用例：提交命令分配命令ID，设备回执后命令进入成功终态
+TEST_F(MessageRouterTest, SubmitCommand_AckCompletesCommand) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    std::string deviceId = "device008";
+    ASSERT_TRUE(mockRouter.openSession(deviceId, "user008", "token008")->authenticated);
+    auto outbox = mockRouter.attachOutbox(deviceId);
+
+    auto receipt = mockRouter.submitCommand(deviceId, "open", "user008", "token008");
+    ASSERT_TRUE(receipt.accepted);
+    EXPECT_NE(receipt.commandId, 0u);
+
+    std::vector<IOT_NS::OutboundCommand> batch;
+    ASSERT_EQ(outbox->waitAndDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH, std::chrono::milliseconds(0)), 1u);
+    EXPECT_EQ(batch[0].commandId, receipt.commandId);
+    mockRouter.markCommandDelivered(receipt.commandId);
+    EXPECT_EQ(mockRouter.commandStatus(receipt.commandId)->state, IOT_NS::CommandState::Delivered);
+
+    EXPECT_FALSE(mockRouter.acknowledgeCommand("device999", receipt.commandId, 0, "ok", "user008", "token008"));
+    EXPECT_TRUE(mockRouter.acknowledgeCommand(deviceId, receipt.commandId, 0, "ok", "user008", "token008"));
+    EXPECT_FALSE(mockRouter.acknowledgeCommand(deviceId, receipt.commandId, 0, "ok", "user008", "token008"));
+
+    auto status = mockRouter.awaitCommand(receipt.commandId, std::chrono::milliseconds(100));
+    ASSERT_TRUE(status.has_value());
+    EXPECT_EQ(status->state, IOT_NS::CommandState::Acked);
+    EXPECT_EQ(status->message, "ok");
+}
+
+// 测试用例：鉴权失败、未注册或归属其他用户的设备不接受命令，也不会为其创建下行队列
+TEST_F(MessageRouterTest, SubmitCommand_RejectsNonOwner) {
+    auto strict = strictRouter();
+    ASSERT_TRUE(strict->openSession("device-own", "user016", "token016")->authenticated);
+
+    EXPECT_EQ(strict->handleCommand("device-own", "open", "user015", "token015"), "Unauthorized");
+    EXPECT_EQ(strict->handleCommand("device-own", "open", "user016", "token015"), "Unauthorized");
+    EXPECT_EQ(strict->handleCommand("device-none", "open", "user015", "token015"), "Unauthorized");
+    auto rejected = strict->submitCommand("device-own", "open", "user015", "token015", {}, "req-1");
+    EXPECT_FALSE(rejected.accepted);
+    EXPECT_EQ(rejected.commandId, 0u);
+
+    // 被拒绝的幂等键没有被记录，所有者使用同一键仍能提交
+    auto receipt = strict->submitCommand("device-own", "open", "user016", "token016", {}, "req-1");
+    EXPECT_TRUE(receipt.accepted);
+    EXPECT_NE(receipt.commandId, 0u);
+}
+
+// 测试用例：携带相同幂等键的重试返回首次结果，命令只入队一次
+TEST_F(MessageRouterTest, SubmitCommand_IdempotencyKeyReplaysOriginal) {
+    std::string deviceId = "device009";
+    ASSERT_TRUE(router.openSession(deviceId, "user009", "token009")->authenticated);
+    auto outbox = router.attachOutbox(deviceId);
+
+    auto first = router.submitCommand(deviceId, "open", "user009", "token009", {}, "req-1");
+    auto retry = router.submitCommand(deviceId, "open", "user009", "token009", {}, "req-1");
+    auto other = router.submitCommand(deviceId, "open", "user009", "token009", {}, "req-2");
+
+    ASSERT_TRUE(first.accepted);
+    EXPECT_EQ(retry.commandId, first.commandId);
+    EXPECT_NE(other.commandId, first.commandId);
+
+    std::vector<IOT_NS::OutboundCommand> batch;
+    EXPECT_EQ(outbox->waitAndDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH, std::chrono::milliseconds(0)), 2u);
+}
+
+// 测试用例：去重存储容量固定，超出窗口或容量的键被淘汰
+TEST_F(MessageRouterTest, CommandDeduplicator_BoundedWindow) {
+    using namespace std::chrono_literals;
+    IOT_NS::CommandDeduplicator dedup { 1000ms, 2 };
+    auto start = IOT_NS::CommandDeduplicator::Clock::now();
+    uint64_t next = 1;
+    auto submit = [&]() { return IOT_NS::CommandReceipt { true, next++, "Command accepted" }; };
+
+    EXPECT_EQ(dedup.submitOnce("dev", "k", submit, start).commandId, 1u);
+    EXPECT_EQ(dedup.submitOnce("dev", "k", submit, start + 500ms).commandId, 1u);
+    EXPECT_EQ(dedup.submitOnce("other", "k", submit, start + 500ms).commandId, 2u); // 键按设备隔离
+    EXPECT_EQ(dedup.submitOnce("dev", "k", submit, start + 1500ms).commandId, 3u);  // 超出窗口后重新提交
+    EXPECT_LE(dedup.size(), 2u * 64);
+}
+
+// 测试用例：时间戳与负载都重复才算重放；允许乱序，记录满后不晚于下限的消息被拒绝，过期记录被丢弃
+TEST_F(MessageRouterTest, ReplayWindow_RejectsRepeatsAndStaleTimestamps) {
+    IOT_NS::ReplayWindow window;
+    EXPECT_TRUE(window.accept(10000, 1, 0));
+    EXPECT_FALSE(window.accept(10000, 1, 0));
+    EXPECT_TRUE(window.accept(10000, 2, 0)); // 同一毫秒、负载不同
+    EXPECT_TRUE(window.accept(10050, 1, 0));
+    EXPECT_TRUE(window.accept(10020, 1, 0)); // 乱序
+    EXPECT_FALSE(window.accept(10020, 1, 0));
+
+    // 记录满后淘汰最早的记录，下限随之抬高
+    for (int64_t ts = 20000; window.size() < IOT_NS::ReplayWindow::kCAPACITY; ++ts) {
+        ASSERT_TRUE(window.accept(ts, 0, 0));
+    }
+    EXPECT_TRUE(window.accept(30000, 0, 0));
+    EXPECT_EQ(window.floor(), 10000);
+    EXPECT_FALSE(window.accept(10000, 3, 0)); // 不晚于下限
+    EXPECT_FALSE(window.accept(10050, 1, 0)); // 被淘汰前记录的重放仍被拒绝
+    EXPECT_TRUE(window.accept(10051, 1, 0));
+
+    // 落出接受窗口的记录被丢弃
+    EXPECT_TRUE(window.accept(40000, 0, 39000));
+    EXPECT_EQ(window.size(), 1u);
+}
+
+// 测试用例：离线设备的防重放状态只在一个接受窗口之后、且无人持有时回收
+TEST_F(MessageRouterTest, ReplayGuard_ReleasesIdleStateAfterWindow) {
+    IOT_NS::ReplayGuard guard { std::chrono::milliseconds(1000) };
+    EXPECT_TRUE(guard.accept("dev-a", IOT_NS::ReplayChannel::Status, 10000, 1, 10000));
+    EXPECT_TRUE(guard.accept("dev-b", IOT_NS::ReplayChannel::Status, 10000, 1, 10000));
+    auto held = guard.acquire("dev-b");
+    guard.release("dev-a", 10000);
+    guard.release("dev-b", 10000);
+    guard.release("dev-none", 10000); // 没有状态的设备不登记
+    EXPECT_EQ(guard.size(), 2u);
+
+    // 窗口内截获的消息仍被拒绝
+    guard.release("dev-none", 10500);
+    EXPECT_EQ(guard.size(), 2u);
+    EXPECT_FALSE(guard.accept("dev-a", IOT_NS::ReplayChannel::Status, 10000, 1, 10500));
+
+    // 一个窗口之后空闲的状态被回收，仍被会话持有的保留
+    guard.release("dev-none", 11001);
+    EXPECT_EQ(guard.size(), 1u);
+    held.reset();
+    guard.release("dev-b", 11001);
+    guard.release("dev-none", 12002);
+    EXPECT_EQ(guard.size(), 0u);
+}
+
+// 测试用例：同一毫秒内负载不同的批量与网关状态上报全部受理，原样重放的条目被拒绝
+TEST_F(MessageRouterTest, ReplayGuard_AcceptsBatchSharingOneMillisecond) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    mockRouter.openSession("device-m0", "user015", "token015");
+
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "device-m0", "s0", now, {} },
+        { "device-m0", "s1", now, {} },
+        { "device-m0", "s1", now, { { "temp", "21" } } },
+        { "device-m0", "s1", now, { { "temp", "22" } } },
+    };
+    auto replayed = updates;
+    auto result = mockRouter.handleStatusBatch("user015", "token015", updates);
+    EXPECT_EQ(result.accepted, 4u);
+    EXPECT_TRUE(result.failedIndexes.empty());
+    result = mockRouter.handleStatusBatch("user015", "token015", replayed);
+    EXPECT_EQ(result.accepted, 0u);
+    EXPECT_EQ(result.failedIndexes.size(), 4u);
+
+    IOT_NS::GatewaySession session;
+    ASSERT_TRUE(mockRouter.authenticateGateway(session, "user014", "token014"));
+    IOT_NS::GatewayBatch batch;
+    batch.bindings = { { 0, "device-m1" } };
+    batch.statuses = { { 0, "a", now, {} }, { 0, "b", now, {} }, { 0, "c", now, {} }, { 0, "a", now, {} } };
+    auto gateway = mockRouter.handleGatewayBatch(session, batch);
+    EXPECT_EQ(gateway.accepted, 3u);
+    EXPECT_EQ(gateway.rejectedDevices, std::vector<uint32_t> { 0 });
+    mockRouter.closeGatewaySession(session);
+}
+
+// 测试用例：超出接受窗口或重复的时间戳被拒绝，未提供时间戳按旧协议放行
+TEST_F(MessageRouterTest, ReplayGuard_RejectsReplayedMessages) {
+    ASSERT_TRUE(router.openSession("device010", "user010", "token010")->authenticated);
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+
+    EXPECT_TRUE(router.handleStatusReport("device010", "online", "user010", "token010", now));
+    EXPECT_FALSE(router.handleStatusReport("device010", "online", "user010", "token010", now));
+    EXPECT_FALSE(router.handleStatusReport("device010", "online", "user010", "token010", now - 3600 * 1000));
+    EXPECT_TRUE(router.handleStatusReport("device010", "online", "user010", "token010", 0));
+    EXPECT_TRUE(router.handleStatusReport("device010", "online", "user010", "token010", 0));
+
+    // 不同通道互不影响
+    EXPECT_TRUE(router.handleHeartbeat("device010", "user010", "token010", now));
+    EXPECT_EQ(router.handleCommand("device010", "open", "user010", "token010", {}, now), "Command accepted");
+    EXPECT_EQ(router.handleCommand("device010", "open", "user010", "token010", {}, now), "Replay rejected");
+}
+
+// 测试用例：会话快速路径拒绝重放的心跳，但会话保持有效
+TEST_F(MessageRouterTest, HandleHeartbeat_SessionRejectsReplay) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    auto session = mockRouter.openSession("device011", "user011", "token011");
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+
+    ASSERT_NE(session->replay, nullptr);
+    EXPECT_TRUE(mockRouter.handleHeartbeat(*session, now));
+    EXPECT_FALSE(mockRouter.handleHeartbeat(*session, now));
+    EXPECT_TRUE(mockRouter.handleHeartbeat(*session, now + 1000));
+    EXPECT_TRUE(session->authenticated);
+}
+
+// 测试用例：合并槽位只在由空变为非空时要求调度，新值原地覆盖旧值
+TEST_F(MessageRouterTest, CoalescingSlot_LastWriterWins) {
+    IOT_NS::CoalescingSlot<std::string> slot;
+
+    EXPECT_TRUE(slot.offer("v1"));
+    EXPECT_FALSE(slot.offer("v2"));
+    EXPECT_FALSE(slot.offer("v3"));
+    EXPECT_EQ(slot.take().value_or(""), "v3");
+    EXPECT_FALSE(slot.take().has_value());
+    EXPECT_TRUE(slot.offer("v4"));
+}
+
+// 测试用例：带合并函数写入时，新值并入槽位中尚未处理的旧值
+TEST_F(MessageRouterTest, CoalescingSlot_MergesIntoPendingValue) {
+    IOT_NS::CoalescingSlot<std::string> slot;
+    auto append = [](std::string& pending, std::string&& next) { pending += "," + next; };
+
+    EXPECT_TRUE(slot.offer("a", append));
+    EXPECT_FALSE(slot.offer("b", append));
+    EXPECT_EQ(slot.take().value_or(""), "a,b");
+    EXPECT_TRUE(slot.offer("c", append));
+    EXPECT_EQ(slot.take().value_or(""), "c");
+}
+
+// 测试用例：合并模式下心跳与状态上报正常受理，每类消息至少有一条真正入队
+TEST_F(MessageRouterTest, Coalescing_HeartbeatsCollapsePerDevice) {
+    router.setCoalescing(true);
+    constexpr int kMESSAGES = 2000;
+    for (int i = 0; i < kMESSAGES; ++i) {
+        EXPECT_TRUE(router.handleHeartbeat("device012", "user012", "token012"));
+        EXPECT_TRUE(router.handleStatusReport("device012", "status-" + std::to_string(i), "user012", "token012"));
+    }
+    EXPECT_LE(router.coalescedCount(), 2u * (kMESSAGES - 1));
+}
+
+// 测试用例：就绪监听器在命令入队时被调用，解除后不再调用
+TEST_F(MessageRouterTest, DeviceOutbox_ReadyListenerAndTryDrain) {
+    IOT_NS::DeviceOutbox outbox { 4 };
+    int notified = 0;
+    outbox.setReadyListener([&]() { ++notified; });
+
+    EXPECT_TRUE(outbox.push({ "a", {}, 0 }));
+    EXPECT_EQ(notified, 1);
+
+    std::vector<IOT_NS::OutboundCommand> batch;
+    EXPECT_EQ(outbox.tryDrain(batch, 8), 1u);
+    EXPECT_EQ(outbox.tryDrain(batch, 8), 0u);
+
+    outbox.setReadyListener(nullptr);
+    EXPECT_TRUE(outbox.push({ "b", {}, 0 }));
+    EXPECT_EQ(notified, 1);
+}
+
+// 测试用例：设备重连时新订阅流先装上监听器，旧流随后结束不会清掉新流的监听器
+TEST_F(MessageRouterTest, DeviceOutbox_ReconnectKeepsNewListener) {
+    ASSERT_TRUE(router.openSession("device017", "user017", "token017")->authenticated);
+    auto outbox = router.attachOutbox("device017");
+    int oldNotified = 0;
+    int newNotified = 0;
+    auto oldToken = outbox->setReadyListener([&]() { ++oldNotified; });
+    auto newToken = router.attachOutbox("device017")->setReadyListener([&]() { ++newNotified; });
+
+    outbox->clearReadyListener(oldToken); // 旧流的 OnDone
+    EXPECT_EQ(router.handleCommand("device017", "open", "user017", "token017"), "Command accepted");
+    EXPECT_EQ(oldNotified, 0);
+    EXPECT_EQ(newNotified, 1);
+
+    outbox->clearReadyListener(newToken);
+    EXPECT_EQ(router.handleCommand("device017", "close", "user017", "token017"), "Command accepted");
+    EXPECT_EQ(newNotified, 1);
+}
+
+// 测试用例：最后一个投递流退订且队列已空时回收队列，回收与并发入队交错时命令不会丢失
+TEST_F(MessageRouterTest, CommandOutbox_ReclaimsIdleOutboxOnUnsubscribe) {
+    IOT_NS::CommandOutbox outboxes;
+    auto first = outboxes.subscribe("device-r0");
+    auto second = outboxes.subscribe("device-r0");
+    ASSERT_EQ(first, second);
+    outboxes.unsubscribe("device-r0", second);
+    EXPECT_TRUE(first->subscribed());
+    EXPECT_EQ(outboxes.outboxCount(), 1u); // 仍有投递流
+
+    EXPECT_TRUE(outboxes.enqueue("device-r0", { "open", {}, 0 }));
+    outboxes.unsubscribe("device-r0", first);
+    EXPECT_EQ(outboxes.outboxCount(), 1u); // 仍有待发命令
+
+    auto again = outboxes.subscribe("device-r0");
+    ASSERT_EQ(again, first);
+    std::vector<IOT_NS::OutboundCommand> batch;
+    EXPECT_EQ(again->tryDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH), 1u);
+    outboxes.unsubscribe("device-r0", again);
+    EXPECT_EQ(outboxes.outboxCount(), 0u);
+    EXPECT_TRUE(again->retired());
+    EXPECT_FALSE(again->push({ "late", {}, 0 }));
+
+    EXPECT_TRUE(outboxes.enqueue("device-r0", { "next", {}, 0 }));
+    EXPECT_NE(outboxes.attach("device-r0"), again);
+    EXPECT_EQ(outboxes.attach("device-r0")->size(), 1u);
+
+    // 订阅流反复建立与结束，同时另一线程持续入队：每条受理的命令要么被取出，要么仍在当前队列中
+    constexpr int kCOMMANDS = 2000;
+    std::atomic<bool> done { false };
+    size_t drained = 0;
+    std::thread subscriber([&]() {
+        std::vector<IOT_NS::OutboundCommand> taken;
+        while (!done.load()) {
+            auto outbox = outboxes.subscribe("device-r1");
+            outbox->tryDrain(taken, IOT_NS::CommandOutbox::kMAX_BATCH);
+            outboxes.unsubscribe("device-r1", outbox);
+        }
+        drained += taken.size();
+    });
+    size_t accepted = 0;
+    for (int i = 0; i < kCOMMANDS; ++i) {
+        accepted += outboxes.enqueue("device-r1", { "c", {}, 0 }) ? 1 : 0;
+    }
+    done = true;
+    subscriber.join();
+    batch.clear();
+    auto rest = outboxes.attach("device-r1");
+    while (rest->tryDrain(batch, IOT_NS::CommandOutbox::kMAX_BATCH) > 0) {
+    }
+    EXPECT_EQ(drained + batch.size(), accepted);
+}
+
+// 测试用例：运行时参数生效：多处理线程按设备分派，下行队列容量取自配置
+TEST_F(MessageRouterTest, RouterOptions_WorkersAndOutboxCapacity) {
+    IOT_NS::RouterOptions options;
+    options.workerThreads = 4;
+    options.outboxCapacity = 2;
+    options.pendingShardCount = 8;
+    options.device.shardCount = 4;
+    options.user.insecure = true;
+    IOT_NS::MessageRouter tuned { MESSAGE_ROUTER_USER_MANAGER, options };
+
+    for (int i = 0; i < 64; ++i) {
+        std::string deviceId = "device-w" + std::to_string(i % 16);
+        EXPECT_TRUE(tuned.handleHeartbeat(deviceId, "user013", "token013"));
+    }
+
+    ASSERT_TRUE(tuned.openSession("device013", "user013", "token013")->authenticated);
+    auto outbox = tuned.attachOutbox("device013");
+    EXPECT_EQ(tuned.handleCommand("device013", "a", "user013", "token013"), "Command accepted");
+    EXPECT_EQ(tuned.handleCommand("device013", "b", "user013", "token013"), "Command accepted");
+    EXPECT_EQ(tuned.handleCommand("device013", "c", "user013", "token013"), "Command queue full");
+    EXPECT_EQ(outbox->size(), 2u);
+}
+
+// 测试用例：网关批次按流内索引处理多个设备，未绑定索引、重放与无效回执只拒绝对应条目
+TEST_F(MessageRouterTest, GatewayBatch_MultiplexesDevicesByIndex) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    IOT_NS::GatewaySession session;
+    IOT_NS::GatewayBatch empty;
+    EXPECT_FALSE(mockRouter.handleGatewayBatch(session, empty).authenticated); // 未鉴权的会话不处理任何条目
+    ASSERT_TRUE(mockRouter.authenticateGateway(session, "user014", "token014"));
+
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+    IOT_NS::GatewayBatch first;
+    first.bindings = { { 0, "device-g0" }, { 1, "device-g1" } };
+    first.heartbeats = { { 0, now }, { 1, now }, { 7, now } };
+    first.statuses = { { 1, "on", now, { { "gw_temp", "19.5" } } } };
+    auto result = mockRouter.handleGatewayBatch(session, first);
+    EXPECT_TRUE(result.authenticated);
+    EXPECT_EQ(result.accepted, 3u);
+    EXPECT_EQ(result.rejected, 1u);
+    EXPECT_EQ(result.rejectedDevices, std::vector<uint32_t> { 7 });
+
+    // 网关上报的结构化属性随状态一起写入设备
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT_TRUE(mockRouter.getDevices("user014", "token014", { "device-g1" }, found, missing));
+        ASSERT_EQ(found.size(), 1u);
+    } while (found[0].info.attributes.empty() && std::chrono::steady_clock::now() < deadline);
+    EXPECT_EQ(found[0].info.attributes.number(*IOT_NS::AttributeKeys::instance().find("gw_temp")), 19.5);
+
+    // 后续帧只携带索引；重放的心跳被拒绝
+    auto receipt = mockRouter.submitCommand("device-g1", "open", "user014", "token014");
+    ASSERT_TRUE(receipt.accepted);
+    IOT_NS::GatewayBatch second;
+    second.heartbeats = { { 0, now }, { 1, now + 1 } };
+    second.acks = { { 1, receipt.commandId, 0, "ok" }, { 0, receipt.commandId, 0, "ok" } };
+    result = mockRouter.handleGatewayBatch(session, second);
+    EXPECT_EQ(result.accepted, 2u);
+    EXPECT_EQ(result.rejectedDevices, (std::vector<uint32_t> { 0, 0 }));
+    EXPECT_EQ(mockRouter.commandStatus(receipt.commandId)->state, IOT_NS::CommandState::Acked);
+
+    mockRouter.closeGatewaySession(session);
+}
+
+// 测试用例：网关不能绑定归属其他用户的设备，重新绑定失败的索引不再指向原设备
+TEST_F(MessageRouterTest, GatewayBatch_RejectsOtherOwnersDevices) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    ASSERT_TRUE(mockRouter.openSession("device-go", "user016", "token016")->authenticated);
+
+    IOT_NS::GatewaySession session;
+    ASSERT_TRUE(mockRouter.authenticateGateway(session, "user014", "token014"));
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+    IOT_NS::GatewayBatch first;
+    first.bindings = { { 0, "device-go" }, { 1, "device-gm" } };
+    first.heartbeats = { { 0, now }, { 1, now } };
+    first.statuses = { { 0, "hijacked", now, {} } };
+    auto result = mockRouter.handleGatewayBatch(session, first);
+    EXPECT_EQ(result.accepted, 1u);
+    EXPECT_EQ(result.rejectedDevices, (std::vector<uint32_t> { 0, 0, 0 }));
+
+    IOT_NS::GatewayBatch rebind;
+    rebind.bindings = { { 1, "device-go" } };
+    rebind.heartbeats = { { 1, now + 1 } };
+    result = mockRouter.handleGatewayBatch(session, rebind);
+    EXPECT_EQ(result.accepted, 0u);
+    EXPECT_EQ(result.rejectedDevices, (std::vector<uint32_t> { 1, 1 }));
+
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    ASSERT_TRUE(mockRouter.getDevices("user016", "token016", { "device-go" }, found, missing));
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].info.owner, "user016");
+    EXPECT_TRUE(found[0].info.lastStatusReport.empty());
+    mockRouter.closeGatewaySession(session);
+}
+
+// 测试用例：批量状态上报只鉴权一次，返回被拒绝条目（重放、未注册设备、空设备ID）的原始下标
+TEST_F(MessageRouterTest, StatusBatch_AggregatesFailedIndexes) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    mockRouter.openSession("device-b0", "user015", "token015"); // 建立会话时注册设备
+    mockRouter.openSession("device-b1", "user015", "token015");
+
+    auto now = IOT_NS::ReplayGuard::nowMillis();
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "device-b0", "s0", now, {} }, { "device-unknown", "s1", now, {} }, { "device-b1", "s2", now, {} },
+        { "device-b0", "s0", now, {} }, { "", "s4", 0, {} },                 { "device-b1", "s5", 0, {} },
+    };
+    auto result = mockRouter.handleStatusBatch("user015", "token015", updates);
+    EXPECT_TRUE(result.authenticated);
+    EXPECT_EQ(result.accepted, 3u);
+    EXPECT_EQ(result.failedIndexes, (std::vector<uint32_t> { 1, 3, 4 }));
+
+    std::vector<IOT_NS::DeviceStatusUpdate> denied = { { "device-b0", "s6", 0, {} } };
+    EXPECT_FALSE(strictRouter()->handleStatusBatch("user015", "bad-token", denied).authenticated);
+}
+
+// 测试用例：订阅缓冲按游标读取，落后过多的订阅者按策略重新同步快照或被断开，写入方只唤醒已追上的订阅者
+TEST_F(MessageRouterTest, DeviceWatchHub_ResyncsOrDropsSlowWatchers) {
+    IOT_NS::DeviceWatchHub hub(4);
+    hub.setSnapshotProvider([](const IOT_NS::DeviceWatchFilter& filter, uint64_t sequence,
+                               std::vector<IOT_NS::DeviceWatchEvent>& out) {
+        for (const auto* id : { "a-1", "b-1" }) {
+            if (filter.matches(id)) {
+                out.push_back({ IOT_NS::DeviceWatchEvent::Type::Snapshot, id, IOT_NS::DeviceStatus::ONLINE, "",
+                                sequence, {}, {} });
+            }
+        }
+    });
+    auto online = [](const std::string& id) {
+        return IOT_NS::DeviceEvent { IOT_NS::DeviceEvent::Type::Online, id, IOT_NS::DeviceStatus::ONLINE, {}, {}, {} };
+    };
+
+    IOT_NS::DeviceWatchFilter prefix;
+    prefix.idPrefix = "a-";
+    auto resync = hub.subscribe(prefix, IOT_NS::WatchOverflowPolicy::Resync);
+    auto drop = hub.subscribe({}, IOT_NS::WatchOverflowPolicy::Drop);
+    EXPECT_EQ(hub.watcherCount(), 2u);
+
+    int wakeups = 0;
+    resync->setReadyListener([&wakeups]() { ++wakeups; });
+
+    // 初始快照按过滤条件生成，以 Synced 结束
+    std::vector<IOT_NS::DeviceWatchEvent> events;
+    ASSERT_TRUE(resync->poll(events, 16));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].deviceId, "a-1");
+    EXPECT_EQ(events[1].type, IOT_NS::DeviceWatchEvent::Type::Synced);
+
+    // 已追上的订阅者每轮只被唤醒一次，不匹配的事件被过滤
+    hub.publish(online("a-2"));
+    hub.publish(online("b-2"));
+    EXPECT_EQ(wakeups, 1);
+    events.clear();
+    ASSERT_TRUE(resync->poll(events, 16));
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].deviceId, "a-2");
+    EXPECT_EQ(events[0].type, IOT_NS::DeviceWatchEvent::Type::Online);
+    EXPECT_EQ(events[0].sequence, 1u);
+
+    // 超过缓冲容量的积压：Resync 策略以新快照代替，Drop 策略断开
+    for (int i = 0; i < 6; ++i) {
+        hub.publish(online("a-" + std::to_string(10 + i)));
+    }
+    events.clear();
+    ASSERT_TRUE(resync->poll(events, 16));
+    EXPECT_EQ(resync->resyncCount(), 1u);
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, IOT_NS::DeviceWatchEvent::Type::Snapshot);
+    EXPECT_EQ(events[1].type, IOT_NS::DeviceWatchEvent::Type::Synced);
+    EXPECT_EQ(events[1].sequence, 8u);
+
+    events.clear();
+    EXPECT_FALSE(drop->poll(events, 16));
+    EXPECT_EQ(hub.overflowCount(), 2u);
+    EXPECT_EQ(hub.watcherCount(), 1u);
+
+    resync->close();
+    EXPECT_EQ(hub.watcherCount(), 0u);
+}
+
+// 测试用例：批量变更的 Resync 事件让订阅者重新加载快照，标记本身与其后的事件不单独下发
+TEST_F(MessageRouterTest, DeviceWatchHub_BulkResyncReloadsSnapshot) {
+    IOT_NS::DeviceWatchHub hub(64);
+    hub.setSnapshotProvider([](const IOT_NS::DeviceWatchFilter&, uint64_t sequence,
+                               std::vector<IOT_NS::DeviceWatchEvent>& out) {
+        out.push_back({ IOT_NS::DeviceWatchEvent::Type::Snapshot, "bulk-1", IOT_NS::DeviceStatus::ONLINE, "", sequence,
+                        {}, {} });
+    });
+    auto watcher = hub.subscribe({}, IOT_NS::WatchOverflowPolicy::Drop);
+    std::vector<IOT_NS::DeviceWatchEvent> events;
+    ASSERT_TRUE(watcher->poll(events, 16));
+    ASSERT_EQ(events.size(), 2u);
+
+    auto event = [](IOT_NS::DeviceEvent::Type type, const std::string& id) {
+        return IOT_NS::DeviceEvent { type, id, IOT_NS::DeviceStatus::ONLINE, {}, {}, {} };
+    };
+    hub.publish(event(IOT_NS::DeviceEvent::Type::Online, "single-1"));
+    hub.publish(event(IOT_NS::DeviceEvent::Type::Resync, ""));
+    hub.publish(event(IOT_NS::DeviceEvent::Type::Online, "single-2"));
+    events.clear();
+    ASSERT_TRUE(watcher->poll(events, 16)); // Drop 策略同样重新加载，而不是断开
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[0].deviceId, "single-1");
+    EXPECT_EQ(events[1].type, IOT_NS::DeviceWatchEvent::Type::Snapshot);
+    EXPECT_EQ(events[2].type, IOT_NS::DeviceWatchEvent::Type::Synced);
+    EXPECT_EQ(events[2].sequence, 3u);
+    EXPECT_EQ(watcher->resyncCount(), 0u); // 只统计因落后引起的重新同步
+    EXPECT_EQ(hub.overflowCount(), 0u);
+}
+
+// 测试用例：订阅设备状态，先收到当前状态，再收到状态内容变化；内容不变的上报不产生事件
+TEST_F(MessageRouterTest, WatchDevices_SnapshotThenStatusChanges) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    mockRouter.openSession("watch-1", "user016", "token016");
+    mockRouter.openSession("other-1", "user016", "token016");
+
+    EXPECT_EQ(strictRouter()->watchDevices("user016", "bad-token", {}), nullptr);
+
+    IOT_NS::DeviceWatchFilter filter;
+    filter.idPrefix = "watch-";
+    auto watcher = mockRouter.watchDevices("user016", "token016", filter);
+    ASSERT_NE(watcher, nullptr);
+
+    std::vector<IOT_NS::DeviceWatchEvent> events;
+    ASSERT_TRUE(watcher->poll(events, 16));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].deviceId, "watch-1");
+    EXPECT_EQ(events[0].status, IOT_NS::DeviceStatus::ONLINE);
+    EXPECT_EQ(events[1].type, IOT_NS::DeviceWatchEvent::Type::Synced);
+
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "watch-1", "temp=20", 0, {} }, { "other-1", "temp=30", 0, {} }, { "watch-1", "temp=20", 0, {} }
+    };
+    mockRouter.handleStatusBatch("user016", "token016", updates);
+
+    events.clear();
+    ASSERT_TRUE(watcher->waitAndPoll(events, 16, std::chrono::milliseconds(100)));
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, IOT_NS::DeviceWatchEvent::Type::StatusChanged);
+    EXPECT_EQ(events[0].deviceId, "watch-1");
+    EXPECT_EQ(events[0].report, "temp=20");
+    watcher->close();
+}
+
+TEST_F(MessageRouterTest, DeviceQueries_AuthLookupAndCursor) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    mockRouter.openSession("query-1", "user016", "token016");
+    mockRouter.openSession("query-2", "user016", "token016");
+
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    auto strict = strictRouter();
+    EXPECT_FALSE(strict->getDevices("user016", "bad-token", { "query-1" }, found, missing));
+    ASSERT_TRUE(mockRouter.getDevices("user016", "token016", { "query-2", "query-x", "query-1" }, found, missing));
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0].deviceId, "query-2");
+    EXPECT_EQ(found[1].deviceId, "query-1");
+    EXPECT_EQ(found[1].info.status, IOT_NS::DeviceStatus::ONLINE);
+    EXPECT_EQ(missing, std::vector<std::string> { "query-x" });
+
+    IOT_NS::DeviceQuery query;
+    IOT_NS::DevicePage page;
+    EXPECT_EQ(strict->listDevices("user016", "bad-token", query, page), IOT_NS::DeviceQueryStatus::Unauthenticated);
+
+    query.limit = 1;
+    ASSERT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    ASSERT_EQ(page.devices.size(), 1u);
+    ASSERT_FALSE(page.nextCursor.empty());
+    query.cursor = page.nextCursor;
+    ASSERT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    ASSERT_EQ(page.devices.size(), 1u);
+
+    query.cursor = "0:x";
+    EXPECT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::InvalidCursor);
+}
+
+// 测试用例：设备归属首个建立会话的用户，其他用户不能为其建立会话，也查询不到该设备
+TEST_F(MessageRouterTest, DeviceOwner_OtherUsersRejectedAndScopedOut) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    ASSERT_TRUE(mockRouter.openSession("owned-1", "user016", "token016")->authenticated);
+
+    auto intruder = mockRouter.openSession("owned-1", "user015", "token015");
+    EXPECT_FALSE(intruder->authenticated);
+    EXPECT_FALSE(mockRouter.handleHeartbeat(*intruder, IOT_NS::ReplayGuard::nowMillis()));
+    EXPECT_TRUE(mockRouter.openSession("owned-1", "user016", "token016")->authenticated);
+
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    ASSERT_TRUE(mockRouter.getDevices("user015", "token015", { "owned-1" }, found, missing));
+    EXPECT_TRUE(found.empty());
+    EXPECT_EQ(missing, std::vector<std::string> { "owned-1" }); // 与未注册的设备无法区分
+    ASSERT_TRUE(mockRouter.getDevices("user016", "token016", { "owned-1" }, found, missing));
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].info.owner, "user016");
+
+    IOT_NS::DeviceQuery query;
+    query.owner = "user016";
+    IOT_NS::DevicePage page;
+    ASSERT_EQ(mockRouter.listDevices("user015", "token015", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    EXPECT_TRUE(page.devices.empty());
+    query.countOnly = true;
+    ASSERT_EQ(mockRouter.listDevices("user015", "token015", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    EXPECT_EQ(page.count, 0u);
+    query.countOnly = false;
+    ASSERT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    ASSERT_EQ(page.devices.size(), 1u);
+    EXPECT_EQ(page.devices[0].deviceId, "owned-1");
+}
+
+// 测试用例：合并模式下同一设备积压的状态上报按键合并属性，结构化属性可按数值条件查询
+TEST_F(MessageRouterTest, StatusDetails_CoalescedMergeAndAttributeQuery) {
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK };
+    mockRouter.setCoalescing(true);
+    mockRouter.openSession("attr-1", "user016", "token016");
+    mockRouter.openSession("attr-2", "user016", "token016");
+
+    mockRouter.handleStatusReport("attr-1", "ok", "user016", "token016", 0, { { "temp", "21.5" }, { "door", "true" } });
+    mockRouter.handleStatusReport("attr-1", "ok", "user016", "token016", 0, { { "temp", "23" }, { "fw", "1.2.0-rc" } });
+    mockRouter.handleStatusReport("attr-2", "ok", "user016", "token016", 0, { { "temp", "18" } });
+
+    // 状态上报在处理线程上异步写入，等待两个设备的属性都落地
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT_TRUE(mockRouter.getDevices("user016", "token016", { "attr-1", "attr-2" }, found, missing));
+        ASSERT_EQ(found.size(), 2u);
+    } while ((found[0].info.attributes.size() < 3 || found[1].info.attributes.empty()) &&
+             std::chrono::steady_clock::now() < deadline);
+
+    auto& keys = IOT_NS::AttributeKeys::instance();
+    const auto& attributes = found[0].info.attributes;
+    ASSERT_EQ(attributes.size(), 3u);
+    EXPECT_EQ(attributes.number(*keys.find("temp")), 23.0);
+    EXPECT_EQ(attributes.get(*keys.find("door")), IOT_NS::AttributeValue(true));
+    EXPECT_EQ(attributes.get(*keys.find("fw")), IOT_NS::AttributeValue(std::string("1.2.0-rc")));
+
+    IOT_NS::DeviceQuery query;
+    query.attributes.push_back({ "temp", IOT_NS::AttributeFilter::Op::Gt, 20 });
+    IOT_NS::DevicePage page;
+    ASSERT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    ASSERT_EQ(page.devices.size(), 1u);
+    EXPECT_EQ(page.devices[0].deviceId, "attr-1");
+
+    query.attributes = { { "no-such-attribute", IOT_NS::AttributeFilter::Op::Ge, 0 } };
+    ASSERT_EQ(mockRouter.listDevices("user016", "token016", query, page), IOT_NS::DeviceQueryStatus::Ok);
+    EXPECT_TRUE(page.devices.empty());
+}
+
+// 测试用例：批量上报按配置的聚合规则累计，未注册设备的上报不参与聚合
+TEST_F(MessageRouterTest, Aggregates_FedByStatusReports) {
+    IOT_NS::RouterOptions options;
+    options.aggregations = { { "temp", "temp", std::chrono::hours(2), std::chrono::hours(1) } };
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK, options };
+    mockRouter.openSession("agg-1", "user016", "token016");
+    mockRouter.openSession("agg-2", "user016", "token016");
+
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "agg-1", "ok", 0, { { "temp", "20" } } },
+        { "agg-2", "ok", 0, { { "temp", "30" } } },
+        { "agg-unknown", "ok", 0, { { "temp", "90" } } },
+    };
+    mockRouter.handleStatusBatch("user016", "token016", updates);
+
+    IOT_NS::AggregateQuery query { "temp", { 0.5 }, true };
+    IOT_NS::AggregateWindow window;
+    EXPECT_EQ(strictRouter()->getAggregates("user016", "bad-token", query, window),
+              IOT_NS::DeviceQueryStatus::Unauthenticated);
+    ASSERT_EQ(mockRouter.getAggregates("user016", "token016", query, window), IOT_NS::DeviceQueryStatus::Ok);
+    ASSERT_EQ(window.groups.size(), 1u);
+    EXPECT_EQ(window.groups[0].group, "agg");
+    EXPECT_EQ(window.groups[0].count, 2u);
+    EXPECT_EQ(window.groups[0].max, 30);
+    EXPECT_DOUBLE_EQ(window.groups[0].mean, 25);
+
+    query.name = "no-such-aggregation";
+    EXPECT_EQ(mockRouter.getAggregates("user016", "token016", query, window), IOT_NS::DeviceQueryStatus::NotFound);
+}
+
+// 测试用例：命中规则的状态上报推送规则事件并向设备下发命令，未注册设备的上报不运行规则
+TEST_F(MessageRouterTest, Rules_EmitEventsAndQueueCommands) {
+    IOT_NS::RouterOptions options;
+    options.rules = {
+        "overheat: temp > 80 && prev(temp) <= 80 => event; command fan speed=max",
+        "failed: changed($status) && $status == \"ERROR\" => event device_error",
+    };
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK, options };
+    mockRouter.openSession("rule-1", "user016", "token016");
+    auto outbox = mockRouter.attachOutbox("rule-1");
+    IOT_NS::DeviceWatchFilter filter;
+    filter.idPrefix = "rule-";
+    auto watcher = mockRouter.watchDevices("user016", "token016", filter);
+    ASSERT_NE(watcher, nullptr);
+    std::vector<IOT_NS::DeviceWatchEvent> events;
+    ASSERT_TRUE(watcher->poll(events, 16));
+
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "rule-1", "ok", 0, { { "temp", "70" } } },
+        { "rule-1", "ok", 0, { { "temp", "85" } } },
+        { "rule-unknown", "ok", 0, { { "temp", "90" } } },
+        { "rule-1", "ERROR", 0, { { "temp", "95" } } },
+    };
+    mockRouter.handleStatusBatch("user016", "token016", updates);
+
+    std::vector<IOT_NS::OutboundCommand> commands;
+    ASSERT_EQ(outbox->tryDrain(commands, IOT_NS::CommandOutbox::kMAX_BATCH), 1u);
+    EXPECT_EQ(commands[0].command, "fan");
+    EXPECT_EQ(commands[0].params.at("speed"), "max");
+
+    events.clear();
+    ASSERT_TRUE(watcher->poll(events, 16));
+    std::vector<std::string> fired;
+    for (const auto& event : events) {
+        if (event.type == IOT_NS::DeviceWatchEvent::Type::RuleMatched) {
+            EXPECT_EQ(event.deviceId, "rule-1");
+            fired.push_back(event.event + ":" + event.report);
+        }
+    }
+    EXPECT_EQ(fired, (std::vector<std::string> { "overheat:ok", "device_error:ERROR" }));
+    watcher->close();
+}
+
+// 测试用例：其他用户既看不到也改不了设备：订阅、历史、单条与批量上报、心跳和命令回执都按所有者校验
+TEST_F(MessageRouterTest, OwnerChecks_OtherUserCannotSeeOrMutate) {
+    using namespace std::chrono_literals;
+    IOT_NS::RouterOptions options;
+    options.device.historyRetention = 1h;
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK, options };
+    ASSERT_TRUE(mockRouter.openSession("own-16", "user016", "token016")->authenticated);
+    ASSERT_TRUE(mockRouter.openSession("own-15", "user015", "token015")->authenticated);
+
+    IOT_NS::DeviceWatchFilter filter;
+    filter.idPrefix = "own-";
+    auto mine = mockRouter.watchDevices("user016", "token016", filter);
+    auto other = mockRouter.watchDevices("user015", "token015", filter);
+    ASSERT_NE(mine, nullptr);
+    ASSERT_NE(other, nullptr);
+    auto seen = [](IOT_NS::DeviceWatcher& watcher) {
+        std::vector<IOT_NS::DeviceWatchEvent> events;
+        EXPECT_TRUE(watcher.poll(events, 64));
+        std::vector<std::string> ids;
+        for (const auto& event : events) {
+            if (!event.deviceId.empty()) {
+                ids.push_back(event.deviceId);
+            }
+        }
+        return ids;
+    };
+    EXPECT_EQ(seen(*mine), std::vector<std::string> { "own-16" });
+    EXPECT_EQ(seen(*other), std::vector<std::string> { "own-15" });
+
+    // 其他用户的上报、心跳与批量上报被拒绝
+    EXPECT_FALSE(mockRouter.handleStatusReport("own-16", "hijacked", "user015", "token015"));
+    EXPECT_FALSE(mockRouter.handleHeartbeat("own-16", "user015", "token015"));
+    std::vector<IOT_NS::DeviceStatusUpdate> updates = {
+        { "own-16", "hijacked", 0, { { "own_temp", "99" } } },
+        { "own-15", "ok", 0, {} },
+    };
+    auto result = mockRouter.handleStatusBatch("user015", "token015", updates);
+    EXPECT_EQ(result.accepted, 1u);
+    EXPECT_EQ(result.failedIndexes, std::vector<uint32_t> { 0 });
+
+    // 所有者的上报只推送给所有者，历史也只对所有者可见
+    auto start = IOT_NS::ReplayGuard::nowMillis();
+    updates = { { "own-16", "ok", 0, { { "own_temp", "21" } } } };
+    EXPECT_EQ(mockRouter.handleStatusBatch("user016", "token016", updates).accepted, 1u);
+    EXPECT_EQ(seen(*mine), std::vector<std::string> { "own-16" });
+    EXPECT_EQ(seen(*other), std::vector<std::string> { "own-15" });
+    IOT_NS::HistoryQuery query { "own-16", "own_temp", start };
+    std::vector<IOT_NS::HistoryPoint> points;
+    EXPECT_EQ(mockRouter.getDeviceHistory("user016", "token016", query, points), IOT_NS::DeviceQueryStatus::Ok);
+    EXPECT_EQ(points.size(), 1u);
+    EXPECT_EQ(mockRouter.getDeviceHistory("user015", "token015", query, points),
+              IOT_NS::DeviceQueryStatus::NotFound);
+
+    // 其他用户不能替设备回执命令
+    auto receipt = mockRouter.submitCommand("own-16", "open", "user016", "token016");
+    ASSERT_TRUE(receipt.accepted);
+    EXPECT_FALSE(mockRouter.acknowledgeCommand("own-16", receipt.commandId, 0, "ok", "user015", "token015"));
+    EXPECT_NE(mockRouter.commandStatus(receipt.commandId)->state, IOT_NS::CommandState::Acked);
+    EXPECT_TRUE(mockRouter.acknowledgeCommand("own-16", receipt.commandId, 0, "ok", "user016", "token016"));
+
+    // 单条接口同样校验 Token
+    auto strict = strictRouter();
+    ASSERT_TRUE(strict->openSession("own-strict", "user016", "token016")->authenticated);
+    EXPECT_FALSE(strict->handleHeartbeat("own-strict", "user016", "wrong"));
+    EXPECT_FALSE(strict->handleStatusReport("own-strict", "ok", "user016", "wrong"));
+    EXPECT_TRUE(strict->handleHeartbeat("own-strict", "user016", "token016"));
+    mine->close();
+    other->close();
+}
+
+// 测试用例：推送流先被取消、进行中的写操作随后失败时只结束一次，结束后不再写出
+TEST(StreamWriteStateTest, CancelThenFailedWriteFinishesOnce) {
+    IOT_NS::StreamWriteState state;
+    ASSERT_TRUE(state.beginWrite());
+    EXPECT_FALSE(state.beginWrite()); // 同一时刻最多一个写操作
+
+    EXPECT_TRUE(state.finish());         // OnCancel 结束流
+    EXPECT_FALSE(state.endWrite(false)); // 进行中的写随后失败，不再重复结束
+    EXPECT_FALSE(state.finish());
+    EXPECT_FALSE(state.beginWrite());
+
+    IOT_NS::StreamWriteState failed;
+    ASSERT_TRUE(failed.beginWrite());
+    EXPECT_TRUE(failed.endWrite(false)); // 写失败先结束流
+    EXPECT_FALSE(failed.finish());       // 随后的取消不再结束
+
+    IOT_NS::StreamWriteState written;
+    ASSERT_TRUE(written.beginWrite());
+    EXPECT_FALSE(written.endWrite(true));
+    EXPECT_FALSE(written.finished());
+    EXPECT_TRUE(written.beginWrite());
+    written.cancelWrite();
+    EXPECT_TRUE(written.beginWrite());
+}
+
+// 测试用例：合并模式下断开排队之后才到达处理线程的心跳被丢弃，设备保持离线
+TEST_F(MessageRouterTest, Coalescing_DisconnectDropsPendingHeartbeat) {
+    IOT_NS::RouterOptions options;
+    options.rules = { "hold: $status == \"hold\" => command hold" };
+    IOT_NS::MessageRouter mockRouter { USER_MANAGER_MOCK, options };
+    mockRouter.setCoalescing(true);
+    ASSERT_TRUE(mockRouter.openSession("coalesce-1", "user016", "token016")->authenticated);
+    ASSERT_TRUE(mockRouter.openSession("coalesce-gate", "user016", "token016")->authenticated);
+
+    // 规则命令的就绪回调在处理线程上阻塞，使随后的断开与心跳在队列中等待
+    std::promise<void> entered;
+    std::promise<void> release;
+    auto gate = mockRouter.attachOutbox("coalesce-gate");
+    auto token = gate->setReadyListener([&entered, held = release.get_future().share()]() {
+        entered.set_value();
+        held.wait();
+    });
+    mockRouter.handleStatusReport("coalesce-gate", "hold", "user016", "token016");
+    ASSERT_EQ(entered.get_future().wait_for(std::chrono::seconds(2)), std::future_status::ready);
+
+    mockRouter.handleDisconnect("coalesce-1");
+    EXPECT_TRUE(mockRouter.handleHeartbeat("coalesce-1", "user016", "token016"));
+    gate->clearReadyListener(token);
+    release.set_value();
+
+    // 之后的上报排在断开与心跳之后，落地即表示前面的任务都已处理
+    mockRouter.handleStatusReport("coalesce-gate", "done", "user016", "token016");
+    std::vector<IOT_NS::DeviceRecord> found;
+    std::vector<std::string> missing;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT_TRUE(mockRouter.getDevices("user016", "token016", { "coalesce-gate", "coalesce-1" }, found, missing));
+    } while ((found.size() < 2 || found[0].info.lastStatusReport != "done") &&
+             std::chrono::steady_clock::now() < deadline);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0].info.lastStatusReport, "done");
+    EXPECT_EQ(found[1].info.status, IOT_NS::DeviceStatus::OFFLINE);
+}
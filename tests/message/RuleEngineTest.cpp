@@ -0,0 +1,130 @@
+#include "RuleEngine.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 运行一次规则求值，返回命中的规则名
+ */
+auto fire(IOT_NS::RuleEngine& engine, const std::string& deviceId, const IOT_NS::StatusDetails& details,
+          const std::string& status = "ok") -> std::vector<std::string> {
+    std::vector<const IOT_NS::StatusRule*> matched;
+    engine.evaluate(deviceId, status, details, matched);
+    std::vector<std::string> names;
+    for (const auto* rule : matched) {
+        names.push_back(rule->name);
+    }
+    return names;
+}
+
+using Names = std::vector<std::string>;
+
+} // namespace
+
+// 测试用例：规则编译、动作解析与错误规则的忽略；相同的比较与条件只编译一份
+TEST(RuleEngineTest, CompilesAndSharesSubexpressions) {
+    IOT_NS::RuleEngine engine({
+        "hot: temp > 80 => event; command fan speed=max level=2",
+        "hot_alarm: temp > 80 => event alarm",
+        "hot_eco: temp > 80 && mode == \"eco\" => command boost",
+        "broken: temp > => event",
+        "no_action: temp > 1 =>",
+        "bad action: temp > 1 => event",
+        "bad_command: temp > 1 => command fan speed",
+        "trailing: temp > 1 ) => event",
+    });
+
+    const auto& rules = engine.rules();
+    ASSERT_EQ(rules.size(), 3u);
+    EXPECT_EQ(engine.conditionCount(), 2u);
+    EXPECT_EQ(engine.comparisonCount(), 2u);
+    EXPECT_EQ(rules[0].condition, rules[1].condition);
+    ASSERT_EQ(rules[0].actions.size(), 2u);
+    EXPECT_EQ(rules[0].actions[0].type, IOT_NS::RuleAction::Type::Event);
+    EXPECT_EQ(rules[0].actions[0].name, "hot");
+    EXPECT_EQ(rules[0].actions[1].type, IOT_NS::RuleAction::Type::Command);
+    EXPECT_EQ(rules[0].actions[1].name, "fan");
+    EXPECT_EQ(rules[0].actions[1].params, (IOT_NS::CommandParams { { "level", "2" }, { "speed", "max" } }));
+    EXPECT_EQ(rules[1].actions[0].name, "alarm");
+    EXPECT_FALSE(engine.readsStatus());
+
+    std::string error;
+    EXPECT_FALSE(engine.add("x: (temp > 1 => event", error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_EQ(engine.comparisonCount(), 2u);
+}
+
+// 测试用例：只运行引用了变化属性的规则，值未变的上报不运行任何规则；未变化的属性取保存的当前值
+TEST(RuleEngineTest, RunsOnlyRulesOfChangedAttributes) {
+    IOT_NS::RuleEngine engine({
+        "hot: temp > 80 => event",
+        "eco: mode == \"eco\" => event",
+        "hot_eco: temp > 80 && mode == \"eco\" => event",
+        "door: door => event",
+        "not_eco: !(mode == \"eco\") || door => event",
+    });
+
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "85" }, { "unrelated", "1" } }), (Names { "hot" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "85" } }), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "mode", "eco" } }), (Names { "eco", "hot_eco" }));
+    // temp 变化时 mode 取保存的值，但只引用 mode 的规则不运行
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "90" } }), (Names { "hot", "hot_eco" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "door", "true" } }), (Names { "door", "not_eco" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "mode", "" } }), (Names { "not_eco" }));
+    // 缺失属性的比较为假，取反后成立
+    EXPECT_EQ(fire(engine, "dev-2", { { "temp", "hot" }, { "door", "0" } }), (Names { "not_eco" }));
+}
+
+// 测试用例：prev() 与 changed() 描述状态变化，$status 引用上报的状态内容
+TEST(RuleEngineTest, TransitionsAndStatusPayload) {
+    IOT_NS::RuleEngine engine({
+        "crossed: temp > 80 && prev(temp) <= 80 => event",
+        "cooled: prev(temp) > 80 && temp <= 80 => event",
+        "failed: changed($status) && $status == \"ERROR\" => event",
+        "recovered: prev($status) == \"ERROR\" && $status != \"ERROR\" => command reset",
+        "firmware: changed(fw) => event",
+    });
+    ASSERT_EQ(engine.rules().size(), 5u);
+    EXPECT_TRUE(engine.readsStatus());
+
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "70" } }), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "81" } }), (Names { "crossed" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "95" } }), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "60" } }), (Names { "cooled" }));
+    EXPECT_EQ(fire(engine, "dev-1", {}, "ERROR"), (Names { "failed" }));
+    EXPECT_EQ(fire(engine, "dev-1", {}, "ERROR"), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "fw", "1.2" } }), (Names { "recovered", "firmware" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "fw", "1.2" } }), Names {});
+}
+
+// 测试用例：$online 只随设备上线与离线变化；离线丢弃设备保存的值，重新上线后 prev() 缺失
+TEST(RuleEngineTest, OnlineTransitionsAndOfflineEviction) {
+    IOT_NS::RuleEngine engine({
+        "lost: changed($online) && !$online => event",
+        "back: changed($online) && $online => event",
+        "crossed: temp > 80 && prev(temp) <= 80 => event",
+    });
+    ASSERT_EQ(engine.rules().size(), 3u);
+    auto transition = [&engine](bool online) {
+        std::vector<const IOT_NS::StatusRule*> matched;
+        engine.transition("dev-1", online, matched);
+        Names names;
+        for (const auto* rule : matched) {
+            names.push_back(rule->name);
+        }
+        return names;
+    };
+
+    EXPECT_EQ(transition(true), (Names { "back" }));
+    // 上报的同名属性不改变 $online
+    EXPECT_EQ(fire(engine, "dev-1", { { "$online", "false" }, { "temp", "70" } }), Names {});
+    EXPECT_EQ(transition(false), (Names { "lost" }));
+    // 离线后保存的值已丢弃：再次上线算作变化，之前的 temp 不再作为 prev()
+    EXPECT_EQ(transition(true), (Names { "back" }));
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "85" } }), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "70" } }), Names {});
+    EXPECT_EQ(fire(engine, "dev-1", { { "temp", "81" } }), (Names { "crossed" }));
+}
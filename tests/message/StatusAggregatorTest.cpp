@@ -0,0 +1,137 @@
+#include "StatusAggregator.h"
+#include "common/QuantileSketch.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr int64_t kSTART_MS = 1'750'000'020'000; // 测试起始时间，恰为 1 分钟窗格的起点
+
+/**
+ * @brief 取出结果中的某个分组
+ */
+auto findGroup(const IOT_NS::AggregateWindow& window, const std::string& group) -> const IOT_NS::AggregateGroup* {
+    auto it = std::find_if(window.groups.begin(), window.groups.end(),
+                           [&group](const IOT_NS::AggregateGroup& g) { return g.group == group; });
+    return it == window.groups.end() ? nullptr : &*it;
+}
+
+} // namespace
+
+// 测试用例：分位数草图的估计值在相对精度以内，分开累计再合并与写入同一个草图结果相同
+TEST(QuantileSketchTest, RelativeAccuracyAndMerge) {
+    std::mt19937 random(47);
+    std::lognormal_distribution<double> latency(3.0, 1.0);
+    std::vector<double> samples;
+    IOT_NS::QuantileSketch whole;
+    IOT_NS::QuantileSketch left;
+    IOT_NS::QuantileSketch right;
+    for (int i = 0; i < 20000; ++i) {
+        double value = i % 100 == 0 ? -latency(random) : latency(random);
+        samples.push_back(value);
+        whole.add(value);
+        (i % 2 == 0 ? left : right).add(value);
+    }
+    left.merge(right);
+    std::sort(samples.begin(), samples.end());
+    for (double q : { 0.0, 0.005, 0.5, 0.9, 0.99, 1.0 }) {
+        double truth = samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+        EXPECT_NEAR(whole.quantile(q), truth, std::fabs(truth) * 0.0101) << "q=" << q;
+        EXPECT_EQ(left.quantile(q), whole.quantile(q));
+    }
+    EXPECT_EQ(left.count(), whole.count());
+    EXPECT_TRUE(std::isnan(IOT_NS::QuantileSketch().quantile(0.5)));
+}
+
+// 测试用例：滚动窗口按设备分组聚合，查询返回最近一个完整窗口，进行中的窗口需显式请求
+TEST(StatusAggregatorTest, TumblingWindowsPerGroup) {
+    IOT_NS::StatusAggregator aggregator({ { "temp_1m", "temp", 60s } });
+    ASSERT_TRUE(aggregator.enabled());
+
+    for (int i = 0; i < 10; ++i) {
+        aggregator.record("sensor-" + std::to_string(i), { { "temp", std::to_string(20 + i) } }, kSTART_MS + i);
+    }
+    aggregator.record("gw-1", { { "temp", "40" }, { "mode", "eco" } }, kSTART_MS + 1000);
+    aggregator.record("gw-2", { { "mode", "eco" } }, kSTART_MS + 1000);  // 没有聚合的属性
+    aggregator.record("gw-3", { { "temp", "hot" } }, kSTART_MS + 1000);  // 字符串值不参与聚合
+    aggregator.record("gw-4", { { "temp", "50" } }, kSTART_MS + 60000); // 下一个窗口
+
+    IOT_NS::AggregateWindow window;
+    IOT_NS::AggregateQuery query { "temp_1m", { 0.5, 1.0 } };
+    ASSERT_TRUE(aggregator.query(query, window, kSTART_MS + 60500));
+    EXPECT_EQ(window.startMs, kSTART_MS);
+    EXPECT_EQ(window.endMs, kSTART_MS + 60000);
+    ASSERT_EQ(window.groups.size(), 2u);
+    EXPECT_EQ(window.groups[0].group, "gw");
+    EXPECT_EQ(window.groups[0].count, 1u);
+    const auto* sensors = findGroup(window, "sensor");
+    ASSERT_NE(sensors, nullptr);
+    EXPECT_EQ(sensors->count, 10u);
+    EXPECT_EQ(sensors->min, 20);
+    EXPECT_EQ(sensors->max, 29);
+    EXPECT_DOUBLE_EQ(sensors->mean, 24.5);
+    ASSERT_EQ(sensors->quantiles.size(), 2u);
+    EXPECT_NEAR(sensors->quantiles[0], 24, 24 * 0.01);
+    EXPECT_NEAR(sensors->quantiles[1], 29, 29 * 0.01);
+
+    query.includeOpen = true;
+    ASSERT_TRUE(aggregator.query(query, window, kSTART_MS + 60500));
+    EXPECT_EQ(window.startMs, kSTART_MS + 60000);
+    ASSERT_EQ(window.groups.size(), 1u);
+    EXPECT_EQ(window.groups[0].sum, 50);
+
+    query.name = "missing";
+    EXPECT_FALSE(aggregator.query(query, window, kSTART_MS));
+}
+
+// 测试用例：滑动窗口合并多个窗格，过期窗格被淘汰；多线程写入的部分结果在查询时合并
+TEST(StatusAggregatorTest, SlidingWindowsMergeThreadPartials) {
+    IOT_NS::StatusAggregator aggregator({ { "load_3m", "load", 180s, 60s }, { "on", "on", 60s } }, "");
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&aggregator, t]() {
+            for (int minute = 0; minute < 4; ++minute) {
+                for (int i = 0; i < 100; ++i) {
+                    aggregator.record("dev-" + std::to_string(t * 100 + i),
+                                      { { "load", std::to_string(minute) }, { "on", i % 4 == 0 ? "true" : "false" } },
+                                      kSTART_MS + minute * 60000 + i);
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    // 第 4 分钟内查询：完整窗口为第 1 到第 3 分钟
+    IOT_NS::AggregateWindow window;
+    ASSERT_TRUE(aggregator.query({ "load_3m", {} }, window, kSTART_MS + 4 * 60000));
+    EXPECT_EQ(window.endMs - window.startMs, 180000);
+    ASSERT_EQ(window.groups.size(), 1u);
+    EXPECT_EQ(window.groups[0].group, "");
+    EXPECT_EQ(window.groups[0].count, 1200u);
+    EXPECT_EQ(window.groups[0].min, 1);
+    EXPECT_EQ(window.groups[0].max, 3);
+    EXPECT_DOUBLE_EQ(window.groups[0].mean, 2);
+
+    // 布尔属性按 1 / 0 计，总和即为 true 的上报数
+    ASSERT_TRUE(aggregator.query({ "on", {} }, window, kSTART_MS + 4 * 60000));
+    ASSERT_EQ(window.groups.size(), 1u);
+    EXPECT_EQ(window.groups[0].sum, 100);
+    EXPECT_EQ(window.groups[0].count, 400u);
+
+    // 过期的样本被丢弃
+    aggregator.record("dev-late", { { "load", "100" } }, kSTART_MS);
+    ASSERT_TRUE(aggregator.query({ "load_3m", {} }, window, kSTART_MS + 4 * 60000));
+    EXPECT_EQ(window.groups[0].max, 3);
+}
@@ -0,0 +1,195 @@
+#include "grpc/IoTCallbackServiceImpl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <grpcpp/grpcpp.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+/**
+ * @brief 回调服务的进程内测试：服务注册在进程内 gRPC 服务器上，客户端经由进程内通道调用
+ *
+ * 设备注册表的预写日志使用 Sync 级别，上报与会话建立都会等待落盘，覆盖 reactor 把处理投递到路由器处理线程的路径。
+ */
+class IoTCallbackServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mCredentialsPath = testing::TempDir() + "callback-credentials.txt";
+        mWalPath = testing::TempDir() + "callback-devices.wal";
+        std::remove(mWalPath.c_str());
+        {
+            std::ofstream file(mCredentialsPath);
+            file << "user001:token001\n";
+        }
+
+        IOT_NS::RouterOptions options;
+        options.user.credentialsFile = mCredentialsPath;
+        options.device.walPath = mWalPath;
+        options.device.walDurability = IOT_NS::WalDurability::Sync;
+        mService = std::make_unique<IoTCallbackServiceImpl>(options);
+
+        grpc::ServerBuilder builder;
+        builder.RegisterService(mService.get());
+        mServer = builder.BuildAndStart();
+        ASSERT_NE(mServer, nullptr);
+        mStub = iot::IoTService::NewStub(mServer->InProcessChannel(grpc::ChannelArguments()));
+    }
+
+    void TearDown() override {
+        if (mServer) {
+            mServer->Shutdown();
+        }
+        mServer.reset();
+        mService.reset();
+        std::remove(mCredentialsPath.c_str());
+        std::remove(mWalPath.c_str());
+    }
+
+    /**
+     * @brief 构造一条心跳
+     */
+    static auto heartbeat(const std::string& deviceId, const std::string& token, int64_t timestamp)
+        -> iot::HeartbeatRequest {
+        iot::HeartbeatRequest request;
+        request.set_device_id(deviceId);
+        request.set_user_id("user001");
+        request.set_auth_token(token);
+        request.set_timestamp(timestamp);
+        return request;
+    }
+
+    /**
+     * @brief 当前 Unix 毫秒时间戳，防重放只接受窗口内的时间戳
+     */
+    static auto nowMs() -> int64_t {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    std::string mCredentialsPath;                     // 凭据文件
+    std::string mWalPath;                             // 设备注册表预写日志
+    std::unique_ptr<IoTCallbackServiceImpl> mService; // 被测服务
+    std::unique_ptr<grpc::Server> mServer;            // 进程内服务器
+    std::unique_ptr<iot::IoTService::Stub> mStub;     // 进程内通道上的客户端
+};
+
+// 心跳流：首条心跳注册设备并回复 Alive，重放的心跳只回复拒绝，流保持打开；设备随后可查到且在线
+TEST_F(IoTCallbackServiceTest, Heartbeat_AcksEachBeatAndRejectsReplays) {
+    grpc::ClientContext context;
+    auto stream = mStub->heartbeat(&context);
+    int64_t now = nowMs();
+
+    iot::Ack ack;
+    ASSERT_TRUE(stream->Write(heartbeat("cb-dev-1", "token001", now)));
+    ASSERT_TRUE(stream->Read(&ack));
+    EXPECT_EQ(ack.code(), 0);
+    EXPECT_EQ(ack.message(), "Alive");
+
+    ASSERT_TRUE(stream->Write(heartbeat("cb-dev-1", "token001", now)));
+    ASSERT_TRUE(stream->Read(&ack));
+    EXPECT_EQ(ack.code(), 2);
+
+    ASSERT_TRUE(stream->Write(heartbeat("", "", now + 1))); // 已建立会话后无需再携带凭据
+    ASSERT_TRUE(stream->Read(&ack));
+    EXPECT_EQ(ack.code(), 0);
+
+    grpc::ClientContext getContext;
+    iot::DeviceGetRequest request;
+    request.set_user_id("user001");
+    request.set_auth_token("token001");
+    request.set_device_id("cb-dev-1");
+    iot::DeviceRecord record;
+    ASSERT_TRUE(mStub->getDevice(&getContext, request, &record).ok());
+    EXPECT_EQ(record.state(), iot::DEVICE_STATE_ONLINE);
+    EXPECT_EQ(record.owner(), "user001");
+
+    stream->WritesDone();
+    EXPECT_TRUE(stream->Finish().ok());
+}
+
+// 心跳流：鉴权失败时先写出应答，再以 UNAUTHENTICATED 结束流
+TEST_F(IoTCallbackServiceTest, Heartbeat_BadTokenEndsStream) {
+    grpc::ClientContext context;
+    auto stream = mStub->heartbeat(&context);
+
+    iot::Ack ack;
+    ASSERT_TRUE(stream->Write(heartbeat("cb-dev-2", "wrong", nowMs())));
+    ASSERT_TRUE(stream->Read(&ack));
+    EXPECT_EQ(ack.code(), 1);
+    EXPECT_FALSE(stream->Read(&ack));
+    EXPECT_EQ(stream->Finish().error_code(), grpc::StatusCode::UNAUTHENTICATED);
+}
+
+// 批量上报流：之后的批次沿用首个批次的凭据，被拒绝条目的下标按整条流累计
+TEST_F(IoTCallbackServiceTest, StatusBatch_AccumulatesAcrossBatches) {
+    int64_t now = nowMs();
+    {
+        grpc::ClientContext context;
+        auto stream = mStub->heartbeat(&context);
+        iot::Ack ack;
+        ASSERT_TRUE(stream->Write(heartbeat("cb-dev-3", "token001", now)));
+        ASSERT_TRUE(stream->Read(&ack));
+        ASSERT_EQ(ack.code(), 0);
+        stream->WritesDone();
+        ASSERT_TRUE(stream->Finish().ok());
+    }
+
+    grpc::ClientContext context;
+    iot::Ack ack;
+    auto writer = mStub->reportStatusBatch(&context, &ack);
+
+    iot::DeviceStatusBatch first;
+    first.set_user_id("user001");
+    first.set_auth_token("token001");
+    auto* entry = first.add_statuses();
+    entry->set_device_id("cb-dev-3");
+    entry->set_status("running");
+    entry->set_timestamp(now);
+    ASSERT_TRUE(writer->Write(first));
+
+    iot::DeviceStatusBatch second;
+    entry = second.add_statuses();
+    entry->set_device_id("cb-dev-unknown");
+    entry->set_status("running");
+    entry = second.add_statuses();
+    entry->set_device_id("cb-dev-3");
+    entry->set_status("idle");
+    entry->set_timestamp(now + 1);
+    ASSERT_TRUE(writer->Write(second));
+
+    ASSERT_TRUE(writer->WritesDone());
+    ASSERT_TRUE(writer->Finish().ok());
+    EXPECT_EQ(ack.code(), 3);
+    EXPECT_EQ(ack.accepted(), 2u);
+    ASSERT_EQ(ack.failed_indexes_size(), 1);
+    EXPECT_EQ(ack.failed_indexes(0), 1u);
+
+    grpc::ClientContext getContext;
+    iot::DeviceGetRequest request;
+    request.set_user_id("user001");
+    request.set_auth_token("token001");
+    request.set_device_id("cb-dev-3");
+    iot::DeviceRecord record;
+    ASSERT_TRUE(mStub->getDevice(&getContext, request, &record).ok());
+    EXPECT_EQ(record.status(), "idle");
+}
+
+// 批量上报流：首个批次鉴权失败时立即以认证失败应答结束流
+TEST_F(IoTCallbackServiceTest, StatusBatch_BadTokenFinishesWithAuthFailed) {
+    grpc::ClientContext context;
+    iot::Ack ack;
+    auto writer = mStub->reportStatusBatch(&context, &ack);
+
+    iot::DeviceStatusBatch batch;
+    batch.set_user_id("user001");
+    batch.set_auth_token("wrong");
+    batch.add_statuses()->set_device_id("cb-dev-4");
+    writer->Write(batch); // 服务端可能已结束流，写入结果不作断言
+    writer->WritesDone();
+    ASSERT_TRUE(writer->Finish().ok());
+    EXPECT_EQ(ack.code(), 1);
+    EXPECT_EQ(ack.accepted(), 0u);
+}
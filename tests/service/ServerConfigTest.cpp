@@ -0,0 +1,176 @@
+#include "config/ServerConfig.h"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class ServerConfigTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        for (const auto& path : mFiles) {
+            std::remove(path.c_str());
+        }
+    }
+
+    /**
+     * @brief 在临时目录写出一个配置文件，测试结束时删除
+     */
+    auto writeFile(const std::string& name, const std::string& content) -> std::string {
+        std::string path = testing::TempDir() + name;
+        std::ofstream(path) << content;
+        mFiles.push_back(path);
+        return path;
+    }
+
+    /**
+     * @brief 以 argv 形式解析命令行参数，argv[0] 为程序名
+     */
+    static auto parse(ServerConfig& config, std::vector<std::string> args) -> bool {
+        args.insert(args.begin(), "iot_service");
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(arg.data());
+        }
+        return config.parseArgs(static_cast<int>(argv.size()), argv.data());
+    }
+
+    std::vector<std::string> mFiles; // 测试写出的配置文件
+};
+
+// 命令行 --键=值 总是覆盖配置文件中的同名键，与 --config 出现的先后无关；未覆盖的键取文件中的值
+TEST_F(ServerConfigTest, CommandLineOverridesFileRegardlessOfOrder) {
+    auto path = writeFile("server-precedence.conf", "# comment\n\n"
+                                                    "mode = sync\n"
+                                                    "router-workers = 4\n"
+                                                    "  replay-window-ms =  1500  \n");
+    ServerConfig config;
+    ASSERT_TRUE(parse(config, { "--router-workers=8", "--config=" + path, "--coalescing=on" }));
+
+    EXPECT_FALSE(config.callbackApi);
+    EXPECT_EQ(config.router.workerThreads, 8u);
+    EXPECT_EQ(config.router.replayWindow.count(), 1500);
+    EXPECT_TRUE(config.router.coalescing);
+    EXPECT_EQ(config.address, "0.0.0.0:50051"); // 两处都未设置的键保持默认值
+}
+
+// 配置文件中的非法行使加载失败，但其余合法行仍然生效；文件不存在时加载失败
+TEST_F(ServerConfigTest, FileReportsMalformedLinesAndKeepsTheRest) {
+    auto path = writeFile("server-malformed.conf", "router-workers = 3\n"
+                                                   "no equals sign here\n"
+                                                   "unknown-key = 1\n"
+                                                   "outbox-capacity = -5\n"
+                                                   "dedup-window-ms = 2000\n");
+    ServerConfig config;
+    EXPECT_FALSE(config.loadFile(path));
+    EXPECT_EQ(config.router.workerThreads, 3u);
+    EXPECT_EQ(config.router.outboxCapacity, ServerConfig {}.router.outboxCapacity);
+    EXPECT_EQ(config.router.dedupWindow.count(), 2000);
+
+    EXPECT_FALSE(config.loadFile(testing::TempDir() + "server-missing.conf"));
+    EXPECT_FALSE(parse(config, { "--config=" + testing::TempDir() + "server-missing.conf" }));
+}
+
+// 非法的标量值被拒绝且不修改原值；不是 --键=值 形式的参数被拒绝
+TEST_F(ServerConfigTest, RejectsMalformedScalars) {
+    ServerConfig config;
+    EXPECT_FALSE(config.set("router-workers", "-1"));
+    EXPECT_FALSE(config.set("router-workers", "12abc"));
+    EXPECT_FALSE(config.set("router-workers", ""));
+    EXPECT_FALSE(config.set("max-concurrent-streams", "99999999999"));
+    EXPECT_FALSE(config.set("coalescing", "yes"));
+    EXPECT_FALSE(config.set("mode", "async"));
+    EXPECT_FALSE(config.set("address", ""));
+    EXPECT_FALSE(config.set("device-manager", ""));
+    EXPECT_FALSE(config.set("no-such-key", "1"));
+    EXPECT_EQ(config.router.workerThreads, 1u);
+    EXPECT_FALSE(config.router.coalescing);
+    EXPECT_TRUE(config.callbackApi);
+    EXPECT_EQ(config.address, "0.0.0.0:50051");
+
+    EXPECT_FALSE(parse(config, { "router-workers=2" }));
+    EXPECT_FALSE(parse(config, { "--router-workers" }));
+    EXPECT_EQ(config.router.workerThreads, 1u);
+}
+
+// 按设备类别的心跳超时：逗号分隔的 前缀:毫秒，空值清空；格式错误时保留原值
+TEST_F(ServerConfigTest, ParsesHeartbeatClasses) {
+    ServerConfig config;
+    ASSERT_TRUE(config.set("heartbeat-classes", "sensor-:120000, gw-:10000"));
+    const auto& classes = config.router.device.heartbeatClasses;
+    ASSERT_EQ(classes.size(), 2u);
+    EXPECT_EQ(classes[0].prefix, "sensor-");
+    EXPECT_EQ(classes[0].timeout.count(), 120000);
+    EXPECT_EQ(classes[1].prefix, "gw-");
+    EXPECT_EQ(classes[1].timeout.count(), 10000);
+
+    for (const char* bad : { "sensor-", ":1000", "gw-:0", "gw-:abc", "gw-:-5", "sensor-:100,,gw-:10" }) {
+        EXPECT_FALSE(config.set("heartbeat-classes", bad)) << bad;
+        EXPECT_EQ(config.router.device.heartbeatClasses.size(), 2u) << bad;
+    }
+
+    ASSERT_TRUE(config.set("heartbeat-classes", ""));
+    EXPECT_TRUE(config.router.device.heartbeatClasses.empty());
+}
+
+// 状态聚合规则：名称:属性:窗口毫秒[:步长毫秒]，逗号分隔；格式错误时保留原值
+TEST_F(ServerConfigTest, ParsesAggregations) {
+    ServerConfig config;
+    ASSERT_TRUE(config.set("aggregations", "temp_1m:temp:60000,temp_5m:temp:300000:60000"));
+    const auto& specs = config.router.aggregations;
+    ASSERT_EQ(specs.size(), 2u);
+    EXPECT_EQ(specs[0].name, "temp_1m");
+    EXPECT_EQ(specs[0].attribute, "temp");
+    EXPECT_EQ(specs[0].window.count(), 60000);
+    EXPECT_EQ(specs[0].slide.count(), 0);
+    EXPECT_EQ(specs[1].name, "temp_5m");
+    EXPECT_EQ(specs[1].window.count(), 300000);
+    EXPECT_EQ(specs[1].slide.count(), 60000);
+
+    for (const char* bad : { "a:b", "a:b:0", "a::100", ":b:100", "a:b:x", "a:b:100:y", "a:b:1:2:3" }) {
+        EXPECT_FALSE(config.set("aggregations", bad)) << bad;
+        EXPECT_EQ(config.router.aggregations.size(), 2u) << bad;
+    }
+
+    ASSERT_TRUE(config.set("aggregations", ""));
+    EXPECT_TRUE(config.router.aggregations.empty());
+}
+
+// 预写日志持久化级别只接受 none、batched、sync
+TEST_F(ServerConfigTest, ParsesWalDurability) {
+    ServerConfig config;
+    EXPECT_EQ(config.router.device.walDurability, IOT_NS::WalDurability::Batched);
+    ASSERT_TRUE(config.set("wal-durability", "sync"));
+    EXPECT_EQ(config.router.device.walDurability, IOT_NS::WalDurability::Sync);
+    ASSERT_TRUE(config.set("wal-durability", "none"));
+    EXPECT_EQ(config.router.device.walDurability, IOT_NS::WalDurability::None);
+
+    EXPECT_FALSE(config.set("wal-durability", "fsync"));
+    EXPECT_FALSE(config.set("wal-durability", "SYNC"));
+    EXPECT_EQ(config.router.device.walDurability, IOT_NS::WalDurability::None);
+}
+
+// 打印结果可作为配置文件重新加载并得到相同的配置，轮询线程参数前注明只在同步模式下生效
+TEST_F(ServerConfigTest, PrintRoundTripsAndNotesSyncOnlyPollers) {
+    ServerConfig config;
+    ASSERT_TRUE(parse(config, { "--mode=sync", "--min-pollers=2", "--wal-durability=sync",
+                                "--heartbeat-classes=sensor-:120000", "--aggregations=t:temp:60000:10000" }));
+    std::ostringstream printed;
+    config.print(printed);
+    auto text = printed.str();
+
+    auto note = text.find("# cqs, min-pollers and max-pollers apply in sync mode only");
+    ASSERT_NE(note, std::string::npos);
+    EXPECT_LT(note, text.find("\ncqs = "));
+    EXPECT_NE(text.find("wal-durability = sync\n"), std::string::npos);
+    EXPECT_NE(text.find("heartbeat-classes = sensor-:120000\n"), std::string::npos);
+    EXPECT_NE(text.find("aggregations = t:temp:60000:10000\n"), std::string::npos);
+
+    ServerConfig reloaded;
+    ASSERT_TRUE(reloaded.loadFile(writeFile("server-printed.conf", text)));
+    std::ostringstream reprinted;
+    reloaded.print(reprinted);
+    EXPECT_EQ(reprinted.str(), text);
+}
@@ -3,6 +3,8 @@
 #include "common/NameSpaceDef.h"
 #include "user/User.h"
 
+#include <cstdio>
+#include <fstream>
 #include <gtest/gtest.h>
 
 using namespace std::chrono_literals;
@@ -30,9 +32,60 @@ TEST_F(UserManagerTest, ValidateMockUser_Success) {
     EXPECT_TRUE(result);
 }
 
+// 测试用例：未配置凭据文件时默认拒绝所有用户，显式开启 insecure 后只要求用户ID非空
+TEST_F(UserManagerTest, ValidateUser_ClosedByDefault) {
+    EXPECT_FALSE(manager->validateUser({ "mock_user", "valid_token" }));
+    manager->configure(IOT_NS::UserManagerOptions {});
+    EXPECT_FALSE(manager->validateUser({ "mock_user", "valid_token" }));
+}
+
 TEST_F(UserManagerTest, ValidateUser_Success) {
+    IOT_NS::UserManagerOptions options;
+    options.insecure = true;
+    manager->configure(options);
     IOT_NS::User user = { "mock_user", "valid_token" };
     bool result = manager->validateUser(user);
     std::cout << "[ValidateUser_Success] result = " << result << std::endl;
     EXPECT_TRUE(result);
 }
+
+// 测试用例：配置凭据文件后按用户ID比对令牌，文件无法打开时拒绝所有用户
+TEST_F(UserManagerTest, ValidateUser_CredentialsFile) {
+    std::string path = testing::TempDir() + "user-manager-credentials.txt";
+    {
+        std::ofstream file(path);
+        file << "# user:token\n"
+             << "alice: alice-token \r\n"
+             << "\n"
+             << "malformed\n"
+             << "bob:bob-token\n";
+    }
+    IOT_NS::UserManagerOptions options;
+    options.credentialsFile = path;
+    manager->configure(options);
+
+    EXPECT_TRUE(manager->validateUser({ "alice", "alice-token" }));
+    EXPECT_TRUE(manager->validateUser({ "bob", "bob-token" }));
+    EXPECT_FALSE(manager->validateUser({ "alice", "bob-token" }));
+    EXPECT_FALSE(manager->validateUser({ "mallory", "alice-token" }));
+    EXPECT_FALSE(manager->validateUser({ "malformed", "" }));
+    EXPECT_FALSE(manager->validateUser({ "", "" }));
+
+    options.credentialsFile = path + ".missing";
+    manager->configure(options);
+    EXPECT_FALSE(manager->validateUser({ "alice", "alice-token" }));
+
+    options.credentialsFile.clear(); // 未配置凭据文件时拒绝所有用户
+    manager->configure(options);
+    EXPECT_FALSE(manager->validateUser({ "alice", "alice-token" }));
+
+    options.insecure = true; // 显式开放模式只要求用户ID非空
+    manager->configure(options);
+    EXPECT_TRUE(manager->validateUser({ "alice", "" }));
+    EXPECT_FALSE(manager->validateUser({ "", "token" }));
+
+    options.credentialsFile = path; // 配置了凭据文件时 insecure 不生效
+    manager->configure(options);
+    EXPECT_FALSE(manager->validateUser({ "alice", "" }));
+    std::remove(path.c_str());
+}